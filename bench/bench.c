@@ -0,0 +1,517 @@
+/*
+ * bench.c - Microbenchmarks for the engine's pipeline stages
+ *
+ * Generates a seeded synthetic manifest and a ship sized to take it, then
+ * times each stage on its own: manifest parse, place_cargo_3d(),
+ * perform_analysis(), imdg_check_all(), the longitudinal strength
+ * calculation and JSON output. Each stage runs --runs times per manifest
+ * size; the output is one JSON object per line, so results can be
+ * collected and compared across releases.
+ *
+ * Build:   make bench        (runs the default sizes)
+ * Run:     ./bench/cargoforge_bench [--items=1000,100000] [--runs=5] ...
+ *          ./bench/cargoforge_bench --help
+ */
+
+#include "cargoforge.h"
+#include "placement_3d.h"
+#include "holds.h"
+#include "imdg.h"
+#include "longitudinal_strength.h"
+#include "json_output.h"
+#include "libcargoforge.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#define MAX_SIZES 16
+#define MAX_RUNS  1000
+
+/* ------------------------------------------------------------------ */
+/* OPTIONS                                                            */
+/* ------------------------------------------------------------------ */
+
+/* Cargo types the generator draws from, in --mix order */
+enum { MIX_STANDARD, MIX_REEFER, MIX_FRAGILE, MIX_HAZARDOUS, MIX_COUNT };
+static const char *const MIX_NAMES[MIX_COUNT] = { "standard", "reefer", "fragile", "hazardous" };
+
+typedef struct {
+    long     sizes[MAX_SIZES];
+    int      size_count;
+    int      runs;
+    unsigned seed;
+    double   dg_fraction;         /* share of hazardous items with a DG: field */
+    double   mix[MIX_COUNT];      /* relative weights of the cargo types */
+    double   fill;                /* cargo volume / hold volume of the ship */
+    int      skip_place;          /* shelf plan instead of place_cargo_3d() */
+    int      placer;              /* PlacementEngine */
+    const char *write_prefix;     /* write PREFIX_ship.cfg / PREFIX_cargo.txt and stop */
+} BenchOptions;
+
+static void bench_options_init(BenchOptions *o) {
+    memset(o, 0, sizeof(*o));
+    o->sizes[0] = 1000;
+    o->sizes[1] = 10000;
+    o->sizes[2] = 100000;
+    o->size_count = 3;
+    o->runs = 5;
+    o->seed = 42u;
+    o->dg_fraction = 0.5;
+    o->mix[MIX_STANDARD] = 70.0;
+    o->mix[MIX_REEFER] = 10.0;
+    o->mix[MIX_FRAGILE] = 10.0;
+    o->mix[MIX_HAZARDOUS] = 10.0;
+    o->fill = 0.8;
+}
+
+static void usage(FILE *fp) {
+    fprintf(fp,
+        "Usage: cargoforge_bench [options]\n"
+        "  --items=N[,N...]      manifest sizes, 1 to 1000000 (default 1000,10000,100000)\n"
+        "  --runs=N              timed runs per stage and size (default 5)\n"
+        "  --seed=N              generator seed (default 42)\n"
+        "  --mix=S,R,F,H         weights of standard, reefer, fragile, hazardous (default 70,10,10,10)\n"
+        "  --dg=F                share of hazardous items carrying a DG: field, 0-1 (default 0.5)\n"
+        "  --fill=F              cargo volume as a share of hold volume, 0.05-4 (default 0.8)\n"
+        "  --placer=NAME         guillotine (default) or extreme-points\n"
+        "  --skip-place          do not run the placer; later stages get a simple shelf plan\n"
+        "                        (placement is superlinear: use this for the largest sizes)\n"
+        "  --write=PREFIX        write PREFIX_ship.cfg and PREFIX_cargo.txt for the first size and exit\n"
+        "Output: one JSON object per line; times in milliseconds, peak RSS in KiB.\n");
+}
+
+static int parse_list(const char *s, double *out, int max) {
+    int n = 0;
+    while (*s && n < max) {
+        char *end;
+        double v = strtod(s, &end);
+        if (end == s) return -1;
+        out[n++] = v;
+        if (*end == ',') end++;
+        else if (*end) return -1;
+        s = end;
+    }
+    return *s ? -1 : n;
+}
+
+static int parse_args(int argc, char **argv, BenchOptions *o) {
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        double vals[MAX_SIZES];
+        int n;
+        if (strcmp(a, "--help") == 0 || strcmp(a, "-h") == 0) {
+            usage(stdout);
+            exit(0);
+        } else if (strncmp(a, "--items=", 8) == 0) {
+            n = parse_list(a + 8, vals, MAX_SIZES);
+            if (n <= 0) goto bad;
+            for (int k = 0; k < n; k++) {
+                if (vals[k] < 1 || vals[k] > 1000000 || vals[k] != (long)vals[k]) goto bad;
+                o->sizes[k] = (long)vals[k];
+            }
+            o->size_count = n;
+        } else if (strncmp(a, "--runs=", 7) == 0) {
+            o->runs = atoi(a + 7);
+            if (o->runs < 1 || o->runs > MAX_RUNS) goto bad;
+        } else if (strncmp(a, "--seed=", 7) == 0) {
+            o->seed = (unsigned)strtoul(a + 7, NULL, 10);
+        } else if (strncmp(a, "--mix=", 6) == 0) {
+            if (parse_list(a + 6, o->mix, MIX_COUNT) != MIX_COUNT) goto bad;
+            double sum = 0.0;
+            for (int k = 0; k < MIX_COUNT; k++) {
+                if (o->mix[k] < 0.0) goto bad;
+                sum += o->mix[k];
+            }
+            if (!(sum > 0.0)) goto bad;
+        } else if (strncmp(a, "--dg=", 5) == 0) {
+            o->dg_fraction = atof(a + 5);
+            if (!(o->dg_fraction >= 0.0 && o->dg_fraction <= 1.0)) goto bad;
+        } else if (strncmp(a, "--fill=", 7) == 0) {
+            o->fill = atof(a + 7);
+            if (!(o->fill >= 0.05 && o->fill <= 4.0)) goto bad;
+        } else if (strcmp(a, "--placer=guillotine") == 0) {
+            o->placer = PLACER_GUILLOTINE;
+        } else if (strcmp(a, "--placer=extreme-points") == 0) {
+            o->placer = PLACER_EXTREME_POINTS;
+        } else if (strcmp(a, "--skip-place") == 0) {
+            o->skip_place = 1;
+        } else if (strncmp(a, "--write=", 8) == 0 && a[8]) {
+            o->write_prefix = a + 8;
+        } else {
+            goto bad;
+        }
+        continue;
+bad:
+        fprintf(stderr, "Error: Invalid option '%s'\n", a);
+        usage(stderr);
+        return -1;
+    }
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* SYNTHETIC INPUT                                                    */
+/* ------------------------------------------------------------------ */
+
+/* Growable text buffer for the generated files */
+typedef struct {
+    char  *data;
+    size_t len, cap;
+} Text;
+
+static int text_printf(Text *t, const char *fmt, ...) {
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        size_t room = t->cap - t->len;
+        int n = vsnprintf(t->data ? t->data + t->len : NULL, room, fmt, ap);
+        va_end(ap);
+        if (n < 0) return -1;
+        if ((size_t)n < room) {
+            t->len += (size_t)n;
+            return 0;
+        }
+        size_t cap = t->cap ? t->cap * 2 : 4096;
+        while (cap - t->len <= (size_t)n) cap *= 2;
+        char *grown = realloc(t->data, cap);
+        if (!grown) return -1;
+        t->data = grown;
+        t->cap = cap;
+    }
+}
+
+static unsigned rng_state;
+
+static double rng_unit(void) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return (double)((rng_state >> 8) & 0xFFFFFF) / 16777216.0;
+}
+
+/* DG classes drawn for hazardous items (class, division, UN number).
+ * No explosives: they are incompatible with other DG at any distance, so
+ * the violation list would grow with the square of the manifest. */
+static const struct { int cls, div; const char *un; } DG_KINDS[] = {
+    { 2, 1, "1075" }, { 2, 2, "1066" }, { 3, 0, "1203" }, { 4, 1, "1325" },
+    { 4, 2, "1369" }, { 4, 3, "1415" }, { 5, 1, "1942" }, { 6, 1, "2810" },
+    { 8, 0, "1789" }, { 9, 0, "3082" },
+};
+#define DG_KIND_COUNT ((int)(sizeof(DG_KINDS) / sizeof(DG_KINDS[0])))
+
+/* Hold geometry of the generated ship */
+#define HOLD_LENGTH 20.0
+#define HOLD_WIDTH  38.0
+#define HOLD_HEIGHT 12.0
+#define SHIP_WIDTH  40.0
+
+/* Largest value the config parser takes */
+#define CONFIG_MAX  1e9
+
+/**
+ * generate_manifest - Seeded manifest of n items: 20 ft / 40 ft boxes and
+ * break-bulk pieces. Sums the volume and weight for the ship generator.
+ */
+static int generate_manifest(const BenchOptions *o, long n, Text *out,
+                             double *volume, double *weight_t) {
+    double mix_sum = 0.0;
+    for (int k = 0; k < MIX_COUNT; k++) mix_sum += o->mix[k];
+
+    rng_state = o->seed;
+    *volume = *weight_t = 0.0;
+    if (text_printf(out, "# Synthetic manifest: %ld items, seed %u\n", n, o->seed) != 0)
+        return -1;
+    for (long i = 0; i < n; i++) {
+        double l, w, h, r = rng_unit();
+        if (r < 0.45)      { l = 6.06;  w = 2.44; h = 2.59; }
+        else if (r < 0.85) { l = 12.19; w = 2.44; h = 2.59; }
+        else {
+            l = 1.0 + rng_unit() * 9.0;
+            w = 1.0 + rng_unit() * 2.0;
+            h = 0.5 + rng_unit() * 2.5;
+        }
+        double t = 2.0 + rng_unit() * 28.0;
+
+        double pick = rng_unit() * mix_sum;
+        int type = 0;
+        while (type < MIX_COUNT - 1 && pick >= o->mix[type]) pick -= o->mix[type++];
+
+        int rc = text_printf(out, "B%07ld %.1f %.2fx%.2fx%.2f %s", i, t, l, w, h, MIX_NAMES[type]);
+        if (rc == 0 && type == MIX_HAZARDOUS && rng_unit() < o->dg_fraction) {
+            int k = (int)(rng_unit() * DG_KIND_COUNT) % DG_KIND_COUNT;
+            rc = text_printf(out, " DG:%d.%d:UN%s:%c:F-E,S-D", DG_KINDS[k].cls, DG_KINDS[k].div,
+                             DG_KINDS[k].un, "ABCDE"[(int)(rng_unit() * 5) % 5]);
+        }
+        if (rc != 0 || text_printf(out, "\n") != 0) return -1;
+        *volume += l * w * h;
+        *weight_t += t;
+    }
+    return 0;
+}
+
+/**
+ * generate_ship - Box-hull ship with a row of holds whose total volume is
+ * volume / fill, plus strength limits so the strength stage has work.
+ */
+static int generate_ship(const BenchOptions *o, double volume, double weight_t, Text *out) {
+    double hold_volume = HOLD_LENGTH * HOLD_WIDTH * HOLD_HEIGHT;
+    long holds = (long)(volume / o->fill / hold_volume) + 1;
+    double length = holds * HOLD_LENGTH + 20.0;
+    double max_t = weight_t * 1.5 + 1000.0;
+    double hold_t = weight_t / (double)holds * 1.5 + 100.0;
+
+    int rc = text_printf(out,
+        "# Synthetic ship for %.0f m3 of cargo at fill %.2f\n"
+        "length_m=%.1f\nwidth_m=%.1f\nmax_weight_tonnes=%.1f\n"
+        "lightship_weight_tonnes=%.1f\nlightship_kg_m=%.1f\n"
+        "permissible_sf_tonnes=%.1f\npermissible_bm_hog_t_m=%.1f\npermissible_bm_sag_t_m=%.1f\n",
+        volume, o->fill, length, SHIP_WIDTH, max_t,
+        max_t * 0.2, HOLD_HEIGHT * 0.6,
+        fmin(max_t * 0.1, CONFIG_MAX), fmin(max_t * length * 0.05, CONFIG_MAX),
+        fmin(max_t * length * 0.05, CONFIG_MAX));
+    for (long h = 0; rc == 0 && h < holds; h++)
+        rc = text_printf(out, "hold=H%ld,%.1f,1,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+                         h + 1, 10.0 + h * HOLD_LENGTH, -HOLD_HEIGHT,
+                         HOLD_LENGTH, HOLD_WIDTH, HOLD_HEIGHT, hold_t);
+    return rc;
+}
+
+static int write_file(const char *prefix, const char *suffix, const Text *t) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s%s", prefix, suffix);
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "Error: Cannot write '%s'\n", path);
+        return -1;
+    }
+    size_t ok = fwrite(t->data, 1, t->len, f);
+    if (fclose(f) != 0 || ok != t->len) {
+        fprintf(stderr, "Error: Cannot write '%s'\n", path);
+        return -1;
+    }
+    fprintf(stderr, "Wrote %s\n", path);
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* TIMING AND REPORTING                                               */
+/* ------------------------------------------------------------------ */
+
+enum { ST_PARSE, ST_PLACE, ST_ANALYSIS, ST_IMDG, ST_STRENGTH, ST_JSON, ST_COUNT };
+static const char *const STAGE_NAMES[ST_COUNT] = {
+    "parse", "place_cargo_3d", "perform_analysis", "imdg_check_all",
+    "longitudinal_strength", "json_output"
+};
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static long peak_rss_kb(void) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return -1;
+    return ru.ru_maxrss;              /* KiB on Linux, bytes on macOS */
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static double percentile(const double *sorted, int n, double p) {
+    int rank = (int)(p / 100.0 * n + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return sorted[rank - 1];
+}
+
+static void report_stage(int stage, long items, double *ms, int runs, size_t bytes, long rss) {
+    qsort(ms, (size_t)runs, sizeof(*ms), cmp_double);
+    double sum = 0.0;
+    for (int r = 0; r < runs; r++) sum += ms[r];
+    double p50 = percentile(ms, runs, 50.0);
+    printf("{\"type\":\"stage\",\"stage\":\"%s\",\"items\":%ld,\"runs\":%d,"
+           "\"mean_ms\":%.4f,\"min_ms\":%.4f,\"p50_ms\":%.4f,\"p90_ms\":%.4f,"
+           "\"p99_ms\":%.4f,\"max_ms\":%.4f,\"items_per_sec\":%.0f",
+           STAGE_NAMES[stage], items, runs, sum / runs, ms[0], p50,
+           percentile(ms, runs, 90.0), percentile(ms, runs, 99.0), ms[runs - 1],
+           p50 > 0.0 ? (double)items / (p50 / 1e3) : 0.0);
+    if (bytes) printf(",\"mb_per_sec\":%.1f", p50 > 0.0 ? (double)bytes / 1e6 / (p50 / 1e3) : 0.0);
+    printf(",\"peak_rss_kb\":%ld}\n", rss);
+}
+
+/* ------------------------------------------------------------------ */
+/* BENCHMARK                                                          */
+/* ------------------------------------------------------------------ */
+
+static void unplace_all(Ship *ship) {
+    for (int i = 0; i < ship->cargo_count; i++) CARGO_UNPLACE(&ship->cargo[i]);
+}
+
+/**
+ * shelf_place - Stand-in plan for --skip-place. Other cargo goes in rows
+ * across the holds, aft to forward, then the next tier up; DG cargo is
+ * spread over the weather deck so the IMDG check sees neighbours, not
+ * every item stacked in the same columns. No constraints are checked; it
+ * only gives the later stages a plan of the full size.
+ */
+static void shelf_place(Ship *ship) {
+    enum { DG_ROWS = 4 };
+    int dg_count = 0;
+    for (int i = 0; i < ship->cargo_count; i++)
+        if (ship->cargo[i].dg) dg_count++;
+    float dg_pitch = (ship->length - 20.0f) / (float)((dg_count + DG_ROWS - 1) / DG_ROWS + 1);
+
+    float x = 10.0f, y = 1.0f, z = (float)-HOLD_HEIGHT;
+    float row_length = 0.0f, tier_height = 0.0f;
+    int dg_seen = 0;
+    for (int i = 0; i < ship->cargo_count; i++) {
+        Cargo *c = &ship->cargo[i];
+        if (c->dg) {
+            CARGO_PLACE(c, 10.0f + (float)(dg_seen / DG_ROWS) * dg_pitch,
+                        1.0f + (float)(dg_seen % DG_ROWS) * (float)(HOLD_WIDTH / DG_ROWS), 0.0f);
+            dg_seen++;
+            continue;
+        }
+        if (y + c->dimensions[1] > 1.0f + (float)HOLD_WIDTH) {       /* next row */
+            x += row_length;
+            y = 1.0f;
+            row_length = 0.0f;
+        }
+        if (x + c->dimensions[0] > ship->length - 10.0f) {           /* next tier */
+            x = 10.0f;
+            y = 1.0f;
+            z += tier_height;
+            row_length = tier_height = 0.0f;
+        }
+        CARGO_PLACE(c, x, y, z);
+        y += c->dimensions[1];
+        if (c->dimensions[0] > row_length) row_length = c->dimensions[0];
+        if (c->dimensions[2] > tier_height) tier_height = c->dimensions[2];
+    }
+}
+
+static int bench_size(const BenchOptions *o, long n) {
+    Text ship_text = {0}, cargo_text = {0};
+    double volume, weight_t;
+    int rc = -1;
+    double *ms[ST_COUNT] = {0};
+    Ship ship;
+    memset(&ship, 0, sizeof(ship));
+
+    if (generate_manifest(o, n, &cargo_text, &volume, &weight_t) != 0 ||
+        generate_ship(o, volume, weight_t, &ship_text) != 0) {
+        fprintf(stderr, "Error: Out of memory generating %ld items\n", n);
+        goto done;
+    }
+    if (o->write_prefix) {
+        rc = (write_file(o->write_prefix, "_ship.cfg", &ship_text) == 0 &&
+              write_file(o->write_prefix, "_cargo.txt", &cargo_text) == 0) ? 0 : -1;
+        goto done;
+    }
+
+    for (int s = 0; s < ST_COUNT; s++) {
+        ms[s] = calloc((size_t)o->runs, sizeof(double));
+        if (!ms[s]) goto done;
+    }
+
+    int placed = 0, imdg_violations = 0;
+    size_t json_bytes = 0;
+    double gm = 0.0;
+    for (int r = 0; r < o->runs; r++) {
+        ship_cleanup(&ship);
+        memset(&ship, 0, sizeof(ship));
+        ship.quiet = 1;
+        if (parse_ship_config_buffer(ship_text.data, ship_text.len, &ship) != 0) goto done;
+
+        double t0 = now_ms();
+        if (parse_cargo_list_buffer(cargo_text.data, cargo_text.len, &ship) != 0) goto done;
+        ms[ST_PARSE][r] = now_ms() - t0;
+
+        /* Each timed placement starts from an empty plan */
+        if (o->skip_place) {
+            shelf_place(&ship);
+        } else {
+            unplace_all(&ship);
+            PlacementOptions popts;
+            placement_options_init(&popts);
+            popts.engine = o->placer;
+            t0 = now_ms();
+            place_cargo_3d_opts(&ship, &popts);
+            ms[ST_PLACE][r] = now_ms() - t0;
+        }
+
+        t0 = now_ms();
+        AnalysisResult res = perform_analysis(&ship);
+        ms[ST_ANALYSIS][r] = now_ms() - t0;
+        placed = res.placed_item_count;
+        gm = res.gm_corrected;
+
+        t0 = now_ms();
+        IMDGCheckResult imdg = imdg_check_all(&ship);
+        ms[ST_IMDG][r] = now_ms() - t0;
+        imdg_violations = imdg.violation_count;
+        imdg_result_free(&imdg);
+
+        float displacement_t = (ship.lightship_weight + res.total_cargo_weight_kg) / 1000.0f;
+        t0 = now_ms();
+        LongStrengthResult ls = calculate_longitudinal_strength(&ship, res.draft, displacement_t,
+                                                                ship.length, ship.width);
+        ms[ST_STRENGTH][r] = now_ms() - t0;
+        (void)ls;
+
+        JsonWriter w;
+        json_writer_init(&w, 0);
+        t0 = now_ms();
+        json_write_results(&w, &ship, &res);
+        ms[ST_JSON][r] = now_ms() - t0;
+        json_bytes = w.len;
+        int oom = w.oom;
+        json_writer_free(&w);
+        if (oom) goto done;
+    }
+
+    long rss = peak_rss_kb();
+    printf("{\"type\":\"input\",\"items\":%ld,\"manifest_bytes\":%zu,\"holds\":%d,"
+           "\"ship_length_m\":%.1f,\"placed\":%d,\"imdg_violations\":%d,\"gm_m\":%.3f}\n",
+           n, cargo_text.len, ship.holds ? ((const HoldConfig *)ship.holds)->count : 0,
+           ship.length, placed, imdg_violations, gm);
+    for (int s = 0; s < ST_COUNT; s++) {
+        if (s == ST_PLACE && o->skip_place) continue;
+        size_t bytes = s == ST_PARSE ? cargo_text.len : s == ST_JSON ? json_bytes : 0;
+        report_stage(s, n, ms[s], o->runs, bytes, rss);
+    }
+    fflush(stdout);
+    rc = 0;
+
+done:
+    if (rc != 0 && !o->write_prefix) fprintf(stderr, "Error: Benchmark of %ld items failed\n", n);
+    for (int s = 0; s < ST_COUNT; s++) free(ms[s]);
+    ship_cleanup(&ship);
+    free(ship_text.data);
+    free(cargo_text.data);
+    return rc;
+}
+
+int main(int argc, char **argv) {
+    BenchOptions o;
+    bench_options_init(&o);
+    if (parse_args(argc, argv, &o) != 0) return 1;
+
+    if (o.write_prefix) return bench_size(&o, o.sizes[0]) == 0 ? 0 : 1;
+
+    printf("{\"type\":\"run\",\"version\":\"%s\",\"seed\":%u,\"runs\":%d,"
+           "\"mix\":[%g,%g,%g,%g],\"dg\":%g,\"fill\":%g,\"placer\":\"%s\"}\n",
+           cargoforge_version(), o.seed, o.runs, o.mix[MIX_STANDARD], o.mix[MIX_REEFER],
+           o.mix[MIX_FRAGILE], o.mix[MIX_HAZARDOUS], o.dg_fraction, o.fill,
+           o.placer == PLACER_EXTREME_POINTS ? "extreme-points" : "guillotine");
+    for (int i = 0; i < o.size_count; i++)
+        if (bench_size(&o, o.sizes[i]) != 0) return 1;
+    return 0;
+}
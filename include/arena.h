@@ -0,0 +1,69 @@
+/*
+ * arena.h - Bump allocator for memory that dies all at once
+ *
+ * An Arena hands out memory from a chain of large blocks by bumping an
+ * offset. Nothing is freed alone: arena_reset() rewinds to the first
+ * block, arena_rewind() back to an earlier mark, both in O(1), and the
+ * blocks stay allocated so a reused arena stops calling malloc once it
+ * has grown to its working size.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* First block size; later blocks double up to ARENA_MAX_BLOCK */
+#define ARENA_FIRST_BLOCK (64 * 1024)
+#define ARENA_MAX_BLOCK   (8 * 1024 * 1024)
+
+typedef struct ArenaBlock_ ArenaBlock;
+
+/**
+ * Arena - Block chain plus the block being filled. Zero-initialise (or
+ * arena_init()) and release with arena_free().
+ */
+typedef struct Arena_ {
+    ArenaBlock *head;        /* first block, where a reset starts again */
+    ArenaBlock *cur;         /* block being filled; later ones are spare */
+    size_t      reserved;    /* bytes held by all blocks */
+} Arena;
+
+/** ArenaMark - A position to arena_rewind() to */
+typedef struct {
+    ArenaBlock *block;
+    size_t      used;
+} ArenaMark;
+
+void arena_init(Arena *a);
+
+/** Release every block; leaves the arena empty. Safe on a zeroed arena. */
+void arena_free(Arena *a);
+
+/**
+ * arena_alloc - size bytes aligned for any type, or NULL if a new block
+ * could not be allocated. The memory is not zeroed.
+ */
+void *arena_alloc(Arena *a, size_t size);
+
+/**
+ * arena_realloc - Grow an allocation of old_size bytes to new_size. The
+ * most recent allocation grows in place when its block has room; anything
+ * else is copied and the old bytes stay unused until the next reset.
+ * ptr may be NULL (plain arena_alloc()).
+ */
+void *arena_realloc(Arena *a, void *ptr, size_t old_size, size_t new_size);
+
+/** Drop every allocation, keeping the blocks for reuse */
+void arena_reset(Arena *a);
+
+/** Current position, for dropping later allocations with arena_rewind() */
+ArenaMark arena_mark(const Arena *a);
+
+/** Drop every allocation made since m was taken */
+void arena_rewind(Arena *a, ArenaMark m);
+
+/** Bytes handed out since the last reset (alignment padding included) */
+size_t arena_used(const Arena *a);
+
+#endif /* ARENA_H */
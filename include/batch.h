@@ -0,0 +1,75 @@
+/*
+ * batch.h - Many voyages in one process
+ *
+ * A batch run reads a list of (ship config, cargo manifest) jobs and
+ * optimizes them on a pool of worker threads, each job on its own warm
+ * CargoForge handle. Ship configs are parsed once and shared between
+ * jobs as templates (CfShipTemplate), so a fleet of a few ships and
+ * thousands of manifests pays for its hydrostatic and tank tables once.
+ *
+ * Results stream out one line per job, in job order, as NDJSON (the
+ * optimize --format=json document plus the job's fields) or as a CSV
+ * summary row. Only a fixed window of jobs is held in memory: the job
+ * list is read as slots free up, so the run's footprint does not grow
+ * with the number of jobs.
+ *
+ * Job list: one job per line, "<ship_config> <cargo_manifest>", or just
+ * "<cargo_manifest>" to use the default ship config. Blank lines and
+ * lines starting with '#' are skipped. Paths are taken as written
+ * (relative ones from the working directory). A directory instead of a
+ * list runs every regular file in it, in name order, against the default
+ * ship config.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+/* Output formats */
+#define BATCH_NDJSON 0
+#define BATCH_CSV    1
+
+/**
+ * BatchOptions - Settings for batch_run().
+ */
+typedef struct {
+    const char *jobs;          /* job list file ("-" = stdin) or directory */
+    const char *ship_config;   /* default ship config, NULL = none */
+    int format;                /* BATCH_NDJSON or BATCH_CSV */
+    const char *output_file;   /* NULL = stdout */
+    int workers;               /* worker threads, 0 = one per CPU */
+    int in_flight;             /* jobs held at once, 0 = 4 per worker */
+    int max_templates;         /* parsed ship configs kept, 0 = none */
+    int strategy;              /* OptimizerStrategy */
+    int time_budget_ms;        /* multistart wall-clock budget (0 = none) */
+    int beam_width;            /* multistart orderings per round (0 = default) */
+    int placer;                /* CF_PLACER_* */
+} BatchOptions;
+
+/**
+ * BatchStats - What a batch_run() did.
+ */
+typedef struct {
+    long long jobs;            /* jobs run, including failed ones */
+    long long failed;          /* jobs whose line reports an error */
+    double elapsed_ms;         /* wall-clock time of the run */
+} BatchStats;
+
+/**
+ * batch_options_init - Fill opts with the defaults (NDJSON to stdout, one
+ * worker per CPU, 4 jobs in flight per worker, 64 ship templates, FFD).
+ */
+void batch_options_init(BatchOptions *opts);
+
+/**
+ * batch_run - Run every job in opts->jobs and write one line per job.
+ *
+ * A job that fails (unreadable file, parse error) gets an error line and
+ * the run goes on.
+ *
+ * @param stats Filled in when not NULL
+ * @return 0 when the run finished (check stats->failed), -1 if it could
+ *         not start or its output could not be written
+ */
+int batch_run(const BatchOptions *opts, BatchStats *stats);
+
+#endif /* BATCH_H */
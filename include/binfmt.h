@@ -0,0 +1,145 @@
+/*
+ * binfmt.h - Compact binary manifest and plan format (.cfb)
+ *
+ * A little-endian, versioned image of a ship's principal particulars, its
+ * cargo and, optionally, a placement plan with the stability results that
+ * go with it. Batch jobs convert a manifest once and then load it without
+ * any text parsing: records are fixed width, IDs and types live in a
+ * string table, and the file is memory-mapped and read in place.
+ *
+ * Layout (every section starts on an 8-byte boundary):
+ *
+ *   header   CFB_HEADER_SIZE bytes, see below
+ *   cargo    cargo_count records of record_size bytes:
+ *              u32 id, u32 type     string table offsets
+ *              f32 weight (kg), f32 dimensions[3] (m)
+ *              f32 pos_x, pos_y, pos_z (m, -1 = unplaced)
+ *              u32 dg               DG record index, 0xFFFFFFFF = none
+ *   dg       dg_count records of CFB_DG_SIZE bytes (optional):
+ *              u8 class, u8 division, u8 stowage, u8 reserved,
+ *              char un_number[8], char ems[16] (NUL padded)
+ *   result   CFB_RESULT_SIZE bytes of AnalysisResult fields (optional)
+ *   strings  NUL-terminated strings, the last byte always NUL
+ *
+ * Header: char magic[8] "CFBIN\x1a\r\n", u16 version, u16 flags,
+ * u32 header_size, f32 length, width, max_weight, lightship_weight,
+ * lightship_kg, u32 cargo_count, u32 dg_count, u32 strings_size,
+ * u64 cargo_offset, dg_offset, result_offset, strings_offset, file_size,
+ * u32 record_size, u32 reserved.
+ *
+ * Readers accept any header_size / record_size at least as large as the
+ * ones defined here, so later versions can append fields; a different
+ * version number is rejected. Hydrostatic tables, tanks and compartments
+ * are not stored: pair a .cfb manifest with its text ship config.
+ */
+
+#ifndef BINFMT_H
+#define BINFMT_H
+
+#include "cargoforge.h"
+#include <stdint.h>
+
+#define CFB_MAGIC        "CFBIN\x1a\r\n"
+#define CFB_MAGIC_LEN    8
+#define CFB_VERSION      1
+
+#define CFB_HEADER_SIZE  96
+#define CFB_RECORD_SIZE  40
+#define CFB_DG_SIZE      28
+#define CFB_RESULT_SIZE  100
+#define CFB_NO_DG        0xFFFFFFFFu
+
+/* Header flags */
+#define CFB_FLAG_PLAN    0x1u   /* cargo positions are a placement result */
+#define CFB_FLAG_RESULT  0x2u   /* result section present */
+
+/* CfbImage.owned */
+#define CFB_OWN_NONE     0      /* caller's buffer */
+#define CFB_OWN_MAP      1      /* mmap()ed file */
+#define CFB_OWN_HEAP     2      /* file read into malloc()ed memory */
+
+/**
+ * CfbImage - A validated, read-only .cfb image (mapped file or caller buffer).
+ */
+typedef struct {
+    const unsigned char *base;
+    size_t size;
+    int    owned;            /* CFB_OWN_*: what cfb_close() releases */
+
+    unsigned int flags;      /* CFB_FLAG_* */
+    float length, width, max_weight, lightship_weight, lightship_kg;
+    uint32_t cargo_count;
+    uint32_t dg_count;
+    uint32_t record_size;
+    uint32_t strings_size;
+    uint64_t cargo_offset, dg_offset, result_offset, strings_offset;
+} CfbImage;
+
+/**
+ * cfb_is_binary_file - 1 if path starts with the .cfb magic, else 0.
+ */
+int cfb_is_binary_file(const char *path);
+
+/**
+ * cfb_write - Write ship particulars, cargo and (if result is non-NULL)
+ * the plan and its analysis to fp. Works on pipes: nothing is seeked.
+ *
+ * @return 0 on success, -1 on allocation, size or write failure
+ */
+int cfb_write(FILE *fp, const Ship *ship, const AnalysisResult *result);
+
+/**
+ * cfb_open - Map path and validate its header and section bounds.
+ * Falls back to reading the file into memory where mmap is unavailable.
+ *
+ * @return 0 on success, -1 on I/O error or a malformed image
+ */
+int cfb_open(const char *path, CfbImage *img);
+
+/**
+ * cfb_open_buffer - Validate len bytes at data as an image, without
+ * copying. The buffer must outlive the image.
+ *
+ * @return 0 on success, -1 on a malformed image
+ */
+int cfb_open_buffer(const void *data, size_t len, CfbImage *img);
+
+/**
+ * cfb_close - Release an image from cfb_open() / cfb_open_buffer().
+ */
+void cfb_close(CfbImage *img);
+
+/**
+ * cfb_load - Fill ship's cargo from the image's records. Like
+ * parse_cargo_list(), expects a ship without cargo.
+ *
+ * Records are range-checked like parsed manifest lines. Positions are
+ * copied when the image holds a plan; DG records go to the ship's pool.
+ * Principal particulars are taken from the image only when the ship has
+ * none yet (length 0). result, if non-NULL, is filled from the result
+ * section, or zeroed when there is none.
+ *
+ * @return 0 on success, -1 on invalid records or allocation failure
+ *         (ship->cargo left NULL)
+ */
+int cfb_load(const CfbImage *img, Ship *ship, AnalysisResult *result);
+
+/**
+ * cfb_load_manifest - Load a cargo manifest that may be text or .cfb.
+ *
+ * Text goes through parse_cargo_list(); binary files are mapped and
+ * loaded with every item unplaced, whatever plan they carry.
+ *
+ * @return 0 on success, -1 on error
+ */
+int cfb_load_manifest(const char *path, Ship *ship);
+
+/**
+ * cfb_write_manifest_text - Write ship->cargo in the text manifest format.
+ * Weights are printed so that parse_cargo_list() reads back the same kg.
+ *
+ * @return 0 on success, -1 on write failure
+ */
+int cfb_write_manifest_text(FILE *fp, const Ship *ship);
+
+#endif /* BINFMT_H */
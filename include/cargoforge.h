@@ -13,9 +13,7 @@
 /* CONSTANTS                                                         */
 /* ------------------------------------------------------------------ */
 
-#define MAX_LINE_LENGTH 256
 #define MAX_DIMENSION 3
-#define MAX_FREE_RECTS 1024
 
 /* ------------------------------------------------------------------ */
 /* FORWARD DECLARATIONS                                              */
@@ -27,24 +25,64 @@ struct HydroTable_;
 struct TankConfig_;
 struct StrengthLimits_;
 struct DGInfo_;
+struct SpatialIndex_;
+struct StackGrid_;
+struct HoldConfig_;
+struct RecordPool_;
+struct Arena_;
+struct ThreadPool_;
 
 /* ------------------------------------------------------------------ */
 /* DATA STRUCTURES                                                   */
 /* ------------------------------------------------------------------ */
 
 /**
- * Cargo - A single piece of cargo.
- * pos_* fields are -1.0f until placed by the optimizer.
+ * CargoLabel - The strings naming a cargo item. Only reports and lookups
+ * read them, so they live apart from the Cargo record in Ship.label_pool.
+ */
+typedef struct CargoLabel_ {
+    char id[32];
+    char type[16];
+} CargoLabel;
+
+/* Cargo.flags; the type bits are set from the CARGO_TYPE_* names in constraints.h */
+#define CARGO_HAZARDOUS  0x01
+#define CARGO_REEFER     0x02
+#define CARGO_FRAGILE    0x04
+#define CARGO_PLACED     0x08   /* pos_* hold a placement */
+#define CARGO_TYPE_FLAGS (CARGO_HAZARDOUS | CARGO_REEFER | CARGO_FRAGILE)
+
+#define CARGO_IS_PLACED(c) (((c)->flags & CARGO_PLACED) != 0)
+
+/* Put c at (x, y, z), or take it off the plan */
+#define CARGO_PLACE(c, x, y, z) \
+    ((c)->pos_x = (x), (c)->pos_y = (y), (c)->pos_z = (z), (c)->flags |= CARGO_PLACED)
+#define CARGO_UNPLACE(c) \
+    ((c)->pos_x = (c)->pos_y = (c)->pos_z = -1.0f, \
+     (c)->flags &= (unsigned char)~CARGO_PLACED)
+
+/* Label strings of c; "" when it has none */
+#define CARGO_ID(c)   ((c)->label ? (c)->label->id : "")
+#define CARGO_TYPE(c) ((c)->label ? (c)->label->type : "")
+
+/**
+ * Cargo - A single piece of cargo: what the placement, constraint and
+ * analysis loops read, in 48 bytes. Unplaced items have CARGO_PLACED
+ * clear and pos_* at -1.0f.
  */
 typedef struct {
-    char  id[32];
     float weight;
     float dimensions[MAX_DIMENSION];
-    char  type[16];
     float pos_x;
     float pos_y;
     float pos_z;
-    struct DGInfo_ *dg; /* NULL for non-DG cargo; set when DG: field parsed */
+    unsigned char flags;    /* CARGO_* bits; the type bits follow label->type */
+    unsigned char dg_index; /* imdg_class_index() + 1, set with dg by the
+                             * parsers; 0 = resolve it from dg */
+    struct DGInfo_ *dg; /* NULL for non-DG cargo; set when DG: field parsed
+                         * (points into Ship.dg_pool, never freed alone) */
+    const CargoLabel *label; /* id and type (points into Ship.label_pool;
+                              * NULL reads as "") */
 } Cargo;
 
 /**
@@ -64,6 +102,23 @@ typedef struct {
     struct HydroTable_     *hydro;            /* Hydrostatic tables */
     struct TankConfig_     *tanks;            /* Tank configuration */
     struct StrengthLimits_ *strength_limits;  /* Permissible SF/BM limits */
+    struct HoldConfig_     *holds;            /* Compartments (NULL = legacy 3 bins) */
+    struct RecordPool_     *dg_pool;          /* Storage behind parsed Cargo.dg */
+    struct RecordPool_     *label_pool;       /* Storage behind Cargo.label */
+
+    /* Where the cargo array, DG records and the tables above come from:
+     * a caller-owned arena, or the heap when NULL. Arena memory is never
+     * freed alone; ship_cleanup() only drops the pointers into it. */
+    struct Arena_          *arena;
+
+    /* Placement-time index of placed cargo; non-NULL only while
+     * place_cargo_3d() runs (owned and freed by the placement engine) */
+    struct SpatialIndex_   *placed_index;
+    struct StackGrid_      *stack_grid;       /* same lifetime, stack pressure */
+
+    /* Non-zero to suppress per-item placement diagnostics (constraint
+     * notes, unplaced warnings, bin summary) on stderr */
+    int quiet;
 } Ship;
 
 typedef struct {
@@ -71,6 +126,25 @@ typedef struct {
     float perc_y;   /* transverse CG as % of ship width */
 } CG;
 
+/**
+ * CargoMoments - Running weight and moment sums of the placed cargo.
+ *
+ * perform_analysis() derives CG, KG, trim and heel from these sums; callers
+ * that change a plan a few items at a time can keep them up to date with
+ * cargo_moments_add()/cargo_moments_remove() instead of rescanning the
+ * manifest. Sums are kept in double so add/remove pairs do not drift.
+ */
+typedef struct {
+    int    placed_count;
+    double weight;      /* total placed cargo weight (kg) */
+    double moment_x;    /* sum of weight * longitudinal centroid (kg-m) */
+    double moment_y;    /* sum of weight * transverse centroid (kg-m) */
+    double moment_z;    /* sum of weight * vertical centroid (kg-m) */
+} CargoMoments;
+
+/* GZ curve samples in AnalysisResult: every degree from 0 to 80 */
+#define GZ_CURVE_POINTS 81
+
 /**
  * AnalysisResult - Complete stability analysis output.
  *
@@ -108,6 +182,7 @@ typedef struct {
     float area_0_40;     /* area under GZ curve 0-40 deg (m-rad) */
     float area_30_40;    /* area under GZ curve 30-40 deg (m-rad) */
     int   imo_compliant; /* 1 if all IMO criteria satisfied */
+    float gz_curve[GZ_CURVE_POINTS]; /* GZ at k degrees (m), wall-sided */
 
     /* Longitudinal strength */
     float max_shear_force;     /* max SWSF (t) */
@@ -118,16 +193,134 @@ typedef struct {
     int   hydro_table_used;    /* 1 if hydrostatic tables were used */
 } AnalysisResult;
 
+/**
+ * WeightDelta - A weight added to (or, when negative, removed from) a
+ * condition, with its centroid on the same axes as cargo centroids: x from
+ * the stern, y from the port side, z above the keel.
+ */
+typedef struct {
+    float weight_kg;
+    float x, y, z;
+} WeightDelta;
+
+/**
+ * LoadCondition - One what-if variation of a placed ship for
+ * perform_analysis_batch(). tank_fill holds one fill fraction (0-1) per
+ * ship tank, or is NULL to keep the ship's own fills. Weight deltas count
+ * in displacement, CG and stability and in total_cargo_weight_kg, and go
+ * into the strength weight distribution as point weights at x; like
+ * tank contents, fills do not.
+ */
+typedef struct {
+    const float       *tank_fill;
+    const WeightDelta *weights;
+    int                weight_count;
+} LoadCondition;
+
+/* SequenceMove.op */
+#define SEQ_LOAD       1
+#define SEQ_DISCHARGE  2
+
+/**
+ * SequenceMove - One crane move of a loading sequence: cargo (an index
+ * into ship->cargo, placed at its planned position) comes on board or
+ * goes ashore.
+ */
+typedef struct {
+    int cargo;
+    int op;                   /* SEQ_LOAD or SEQ_DISCHARGE */
+} SequenceMove;
+
+/**
+ * SequenceStep - The condition after one move of simulate_load_sequence().
+ * Strength fields are filled only when the ship has strength limits;
+ * stability fields are 0 when the step is overweight.
+ */
+typedef struct {
+    int   cargo;              /* item moved, -1 for the initial condition */
+    int   op;                 /* SEQ_*, 0 for the initial condition */
+    int   on_board;           /* cargo items on board */
+    float cargo_weight_t;
+    float displacement_t;     /* lightship + cargo + tanks */
+    float draft;              /* m */
+    float trim;               /* m, positive by the stern */
+    float heel;               /* deg */
+    float gm_corrected;       /* m */
+    float max_shear_force;    /* t */
+    float max_bending_moment; /* t-m */
+    signed char imo_compliant;
+    signed char strength_compliant; /* 1, 0, or -1 when not checked */
+    signed char overweight;
+} SequenceStep;
+
 /* ------------------------------------------------------------------ */
 /* FUNCTION PROTOTYPES                                               */
 /* ------------------------------------------------------------------ */
 
 /* --- parser.c --- */
+/* filename "-" reads stdin. The _buffer variants parse len bytes of text
+ * in place (no NUL terminator needed) with the same rules and messages. */
 int parse_ship_config(const char *filename, Ship *ship);
 int parse_cargo_list(const char *filename, Ship *ship);
+int parse_ship_config_buffer(const char *text, size_t len, Ship *ship);
+int parse_cargo_list_buffer(const char *text, size_t len, Ship *ship);
+/* Single pass over a stream in 1 MiB chunks; memory stays bounded by the
+ * cargo array, however large the manifest. */
+int parse_cargo_stream(FILE *file, Ship *ship);
+/* Maps regular files of 64 KiB and up and parses the mapping in place
+ * (parse_cargo_list() uses it for every path); streams anything else. */
+int parse_cargo_list_mapped(const char *filename, Ship *ship);
+/* Ship memory: from ship->arena when set, else malloc/realloc/free.
+ * ship_realloc() needs the old size; ship_free() is a no-op for arenas. */
+void *ship_alloc(Ship *ship, size_t size);
+void *ship_realloc(Ship *ship, void *ptr, size_t old_size, size_t new_size);
+void ship_free(Ship *ship, void *ptr);
+/* Next free DG record in ship->dg_pool (created on first use); NULL if OOM */
+struct DGInfo_ *dg_pool_alloc(Ship *ship);
+/* Next free label in ship->label_pool, zeroed; NULL if OOM */
+CargoLabel *label_pool_alloc(Ship *ship);
+/* Free both record pools (labels and DG info) and clear their pointers */
+void cargo_pools_destroy(Ship *ship);
+/* Store id and type in a new label for c and set its type flags; -1 if OOM.
+ * Either string may be truncated to fit. */
+int cargo_set_label(Ship *ship, Cargo *c, const char *id, size_t id_len,
+                    const char *type, size_t type_len);
+/* CARGO_TYPE_FLAGS bits of a type name */
+unsigned char cargo_type_flags(const char *type);
 
 /* --- analysis.c --- */
+/* perform_analysis_stages() stages. The cargo summary (counts, weights,
+ * CG percentages, gm = NAN when overweight) is always filled in; fields of
+ * stages not run stay 0 (strength_compliant -1). */
+#define ANALYSIS_STABILITY 0x1u  /* hydrostatics, free surface, trim, heel, GZ/IMO */
+#define ANALYSIS_STRENGTH  0x2u  /* longitudinal shear force and bending moment */
+#define ANALYSIS_ALL       (ANALYSIS_STABILITY | ANALYSIS_STRENGTH)
+
 AnalysisResult perform_analysis(const Ship *ship);
+AnalysisResult perform_analysis_moments(const Ship *ship, const CargoMoments *m);
+AnalysisResult perform_analysis_stages(const Ship *ship, const CargoMoments *m,
+                                       unsigned int stages);
+void cargo_moments_compute(const Ship *ship, CargoMoments *m);
+void cargo_moments_add(CargoMoments *m, const Cargo *c);
+void cargo_moments_remove(CargoMoments *m, const Cargo *c);
+/* Analyse count conditions of one placed ship into out[0..count). Cargo
+ * moments and per-tank coefficients are computed once for the batch; a
+ * condition's results equal perform_analysis() on a copy of the ship with
+ * the condition applied. Runs on pool when given (NULL = serial).
+ * Returns 0, or -1 on bad arguments (tank fills on a ship without tanks)
+ * or allocation failure. */
+int perform_analysis_batch(const Ship *ship, const LoadCondition *conds, int count,
+                           AnalysisResult *out, struct ThreadPool_ *pool);
+/* Simulate a loading sequence over a placed ship into out[0..count]:
+ * out[0] is the condition before the first move, out[k] the one after
+ * move k. An item starts on board when its first move is a discharge or
+ * when the sequence never moves it; loads and discharges of an item must
+ * alternate. Moments, draft, stability and the strength weight curve are
+ * updated per move, not rebuilt, and tanks keep the ship's fills.
+ * Returns 0, -1 on a bad move (unplaced or unknown item, wrong order) or
+ * -2 on allocation failure. */
+int simulate_load_sequence(const Ship *ship, const SequenceMove *moves, int count,
+                           SequenceStep *out);
 void print_loading_plan(const Ship *ship);
 
 /* --- ship cleanup --- */
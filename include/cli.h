@@ -24,7 +24,8 @@ typedef enum {
     FORMAT_JSON,
     FORMAT_CSV,
     FORMAT_TABLE,
-    FORMAT_MARKDOWN
+    FORMAT_MARKDOWN,
+    FORMAT_BINARY            /* .cfb plan image (binfmt.h) */
 } OutputFormat;
 
 /* CLI context — holds all parsed options */
@@ -40,7 +41,19 @@ typedef struct {
     bool color;
     bool only_placed;
     bool only_failed;
+    bool compact;            /* JSON without whitespace */
+    bool load_map;           /* JSON: add the compartment floor load map */
     char *cargo_type_filter;
+    int threads;             /* placement search threads (1 = serial, 0 = all CPUs) */
+    int strategy;            /* OptimizerStrategy */
+    int time_budget_ms;      /* multistart wall-clock budget (0 = none) */
+    int beam_width;          /* multistart orderings kept per round (0 = default) */
+    int placer;              /* PlacementEngine */
+    int port;                /* serve: TCP port */
+    int workers;             /* serve, batch: worker threads (0 = all CPUs) */
+    int queue_depth;         /* serve: requests in flight before 503 */
+    int cache_mb;            /* serve: result cache size in MiB (0 = off) */
+    char *moves_file;        /* sequence: load/discharge list (NULL = replay the plan) */
 } CLIContext;
 
 /* Core CLI functions */
@@ -53,7 +66,10 @@ int  dispatch_subcommand(CLIContext *ctx);
 int cmd_optimize(CLIContext *ctx);
 int cmd_validate(CLIContext *ctx);
 int cmd_info(CLIContext *ctx);
+int cmd_convert(CLIContext *ctx);
 int cmd_serve(CLIContext *ctx);
+int cmd_batch(CLIContext *ctx);
+int cmd_sequence(CLIContext *ctx);
 int cmd_version(CLIContext *ctx);
 int cmd_help(CLIContext *ctx);
 
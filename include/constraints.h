@@ -14,6 +14,7 @@
 
 #include "cargoforge.h"
 #include "placement_3d.h"
+#include "diagnostics.h"
 
 /* Cargo type classifications */
 #define CARGO_TYPE_STANDARD  "standard"
@@ -30,16 +31,32 @@
 #define MAX_STACK_PRESSURE_FRAGILE 5.0f /* max stacking pressure for fragile cargo */
 
 /**
- * check_cargo_constraints - Validates if a cargo placement is safe
+ * constraint_check - First constraint a candidate placement breaks
  *
- * Checks: point load, hazmat separation, reefer zones, fragile protection,
- * stacking weight, deck weight ratio.
+ * Checks, in order: point load, hazmat/IMDG separation, stacking weight,
+ * deck weight ratio. Prints nothing.
+ *
+ * @return DIAG_OK if all constraints are satisfied, else the failing DiagCode
+ */
+DiagCode constraint_check(const Ship *ship, const Cargo *cargo,
+                          const Bin3D *bin, const Space3D *space);
+
+/**
+ * check_cargo_constraints - Validates if a cargo placement is safe
  *
  * @return 1 if all constraints satisfied, 0 if any violation
  */
 int check_cargo_constraints(const Ship *ship, const Cargo *cargo,
                             const Bin3D *bin, const Space3D *space);
 
+/**
+ * constraint_notes - Set the note codes (reefer away from deck or plugs,
+ * fragile deep in a hold) that apply to the space an item was placed in.
+ */
+void constraint_notes(const Cargo *cargo, const Bin3D *bin, const Space3D *space,
+                      int counts[DIAG_CODE_COUNT]);
+
+/* Type tests, read from Cargo.flags */
 int is_hazardous(const Cargo *cargo);
 int is_fragile(const Cargo *cargo);
 int is_reefer(const Cargo *cargo);
@@ -52,8 +69,10 @@ float calculate_point_load(const Cargo *cargo);
 /**
  * calculate_stack_pressure - Calculate total weight pressing down at a position.
  *
- * Scans placed cargo to find items whose XY footprint overlaps the given
- * rectangle and whose Z position is above. Returns sum of weight / area in t/m2.
+ * Finds placed cargo whose XY footprint overlaps the given rectangle and
+ * whose Z position is above. Returns sum of weight / area in t/m2.
+ * Reads ship->stack_grid when present, else queries ship->placed_index,
+ * else scans the manifest.
  */
 float calculate_stack_pressure(const Ship *ship, float x, float y, float z,
                                float w, float d);
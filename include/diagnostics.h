@@ -0,0 +1,83 @@
+/*
+ * diagnostics.h - Structured placement diagnostics
+ *
+ * The placement search tests the cargo constraints against every
+ * candidate space, and most candidates fail. Instead of a stderr line per
+ * failed candidate, the placer tallies the reasons for one item and, once
+ * the item is placed or given up on, hands the tally to a DiagLog: a
+ * fixed-size ring of per-item records plus running totals per reason.
+ */
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+/**
+ * DiagCode - Why a candidate was rejected, or a note on where an item
+ * ended up. Values match the public CF_DIAG_* codes.
+ */
+typedef enum {
+    DIAG_OK = 0,
+    DIAG_POINT_LOAD,          /* item's own point load over the limit */
+    DIAG_IMDG_INCOMPATIBLE,   /* an incompatible DG class is on board */
+    DIAG_IMDG_DISTANCE,       /* too close to DG cargo needing segregation */
+    DIAG_HAZMAT_SEPARATION,   /* legacy 3 m hazmat rule */
+    DIAG_STACK_PRESSURE,      /* weight above would crush it */
+    DIAG_DECK_WEIGHT,         /* deck weight ratio exceeded */
+    DIAG_REEFER_PLACEMENT,    /* note: reefer placed away from deck/plugs */
+    DIAG_FRAGILE_PLACEMENT,   /* note: fragile placed deep in a hold */
+    DIAG_UNPLACED,            /* no candidate fitted and passed */
+    DIAG_CODE_COUNT
+} DiagCode;
+
+/**
+ * DiagRecord - One cargo item's diagnostics from a placement. counts[]
+ * holds the candidate spaces rejected per code; the note codes and
+ * DIAG_UNPLACED are 1 when they apply.
+ */
+typedef struct {
+    int  cargo_idx;
+    char cargo_id[32];
+    int  counts[DIAG_CODE_COUNT];
+} DiagRecord;
+
+/**
+ * DiagLog - Ring of the most recent records plus totals since the last
+ * clear. A zeroed log, or one with capacity 0, only keeps the totals.
+ */
+typedef struct DiagLog_ {
+    DiagRecord *ring;
+    int  capacity;
+    long long written;                   /* records ever pushed */
+    long long totals[DIAG_CODE_COUNT];   /* summed counts */
+} DiagLog;
+
+/**
+ * diag_log_init - Empty log holding up to capacity records.
+ *
+ * @return 0 on success, -1 on allocation failure (log left empty)
+ */
+int diag_log_init(DiagLog *log, int capacity);
+
+/** Release the ring; leaves the log zeroed. Safe on a zeroed log. */
+void diag_log_free(DiagLog *log);
+
+/** Drop all records and reset the totals, keeping the capacity */
+void diag_log_clear(DiagLog *log);
+
+/**
+ * diag_log_record - Add one item's tally. Nothing is stored when every
+ * count is zero; the oldest record is overwritten when the ring is full.
+ */
+void diag_log_record(DiagLog *log, int cargo_idx, const char *cargo_id,
+                     const int counts[DIAG_CODE_COUNT]);
+
+/** Records currently held (at most capacity) */
+int diag_log_count(const DiagLog *log);
+
+/** Record i, oldest first (0 <= i < diag_log_count()), or NULL */
+const DiagRecord *diag_log_get(const DiagLog *log, int i);
+
+/** Short lowercase name of a code, e.g. "stack pressure" */
+const char *diag_code_name(int code);
+
+#endif /* DIAGNOSTICS_H */
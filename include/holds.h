@@ -0,0 +1,78 @@
+/*
+ * holds.h - Cargo compartment (hold / bay / deck) definitions
+ *
+ * Each compartment becomes one placement bin. Vessels describe their own
+ * compartments in the ship config with repeated hold= lines; without any,
+ * the legacy three-bin layout (forward hold, aft hold, weather deck) is
+ * derived from the ship's dimensions.
+ *
+ * Config syntax (coordinates in the placement frame: x from AP, y from the
+ * port edge of the cargo area, z from the waterline, negative below):
+ *
+ *   hold=NAME,x_m,y_m,z_m,length_m,width_m,height_m,max_weight_t[,FLAGS]
+ *
+ * FLAGS is a '+'-separated list of: deck, reefer.
+ */
+
+#ifndef HOLDS_H
+#define HOLDS_H
+
+/* Compartment flags */
+#define HOLD_FLAG_DECK    0x1u   /* weather deck: deck weight-ratio limit applies */
+#define HOLD_FLAG_REEFER  0x2u   /* reefer plugs available */
+
+/**
+ * HoldDef - One cargo compartment.
+ */
+typedef struct {
+    char  name[32];
+    float x, y, z;           /* origin corner (m) */
+    float length;            /* extent along X (m) */
+    float width;             /* extent along Y (m) */
+    float height;            /* extent along Z (m) */
+    float max_weight;        /* weight capacity (kg) */
+    unsigned int flags;      /* HOLD_FLAG_* */
+} HoldDef;
+
+/**
+ * HoldConfig - All compartments of a vessel, in placement preference order.
+ */
+typedef struct HoldConfig_ {
+    HoldDef *holds;
+    int count;
+    int capacity;
+} HoldConfig;
+
+/**
+ * hold_config_parse_line - Parse one hold= value and append it.
+ *
+ * @return 0 on success, -1 on a malformed spec or allocation failure
+ */
+int hold_config_parse_line(HoldConfig *config, const char *spec);
+
+/**
+ * hold_config_add - Append a compartment (copied).
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int hold_config_add(HoldConfig *config, const HoldDef *hold);
+
+/**
+ * hold_config_legacy - Fill config with the three-bin default layout for a
+ * ship of the given dimensions (max_weight in kg).
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int hold_config_legacy(HoldConfig *config, float length, float width, float max_weight);
+
+/**
+ * hold_config_free - Release a config's storage (not the struct itself).
+ */
+void hold_config_free(HoldConfig *config);
+
+/**
+ * hold_flags_name - "deck", "reefer", "deck+reefer" or "hold".
+ */
+const char *hold_flags_name(unsigned int flags);
+
+#endif /* HOLDS_H */
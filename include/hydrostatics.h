@@ -28,14 +28,28 @@ typedef struct {
 /**
  * HydroTable - Collection of hydrostatic entries indexed by draft.
  *
- * When loaded == 1, the analysis engine uses table interpolation instead
- * of box-hull approximations. When loaded == 0 (or pointer is NULL),
- * the legacy box-hull model is used.
+ * When loaded == 1 and indexed == 1, the analysis engine uses table
+ * interpolation instead of box-hull approximations. Otherwise (or when the
+ * pointer is NULL) the legacy box-hull model is used.
+ *
+ * The lookup index is built once from the entries (parse_hydro_table()
+ * does it): the two search columns stored on their own for the binary
+ * search, and each segment's slopes, so a lookup is one search and one
+ * multiply-add per column. When the drafts are evenly spaced the segment
+ * is found by direct indexing instead.
  */
 typedef struct HydroTable_ {
     HydroEntry entries[MAX_HYDRO_ENTRIES];
     int count;
     int loaded;
+
+    /* Lookup index, valid when indexed == 1 */
+    float draft[MAX_HYDRO_ENTRIES];        /* entries[i].draft */
+    float displacement[MAX_HYDRO_ENTRIES]; /* entries[i].displacement */
+    HydroEntry slope[MAX_HYDRO_ENTRIES];   /* d(column)/d(draft) from i to i + 1 */
+    float draft_per_t[MAX_HYDRO_ENTRIES];  /* d(draft)/d(displacement) from i to i + 1 */
+    float inv_step;                        /* 1 / draft spacing if uniform, else 0 */
+    int indexed;
 } HydroTable;
 
 /**
@@ -44,12 +58,24 @@ typedef struct HydroTable_ {
  * Expected CSV columns (order matters):
  *   draft_m, displacement_t, KM_m, KB_m, BM_m, TPC_t_cm, MTC_t_m, waterplane_m2, LCB_m
  *
- * Lines starting with '#' are comments. Entries must be in ascending draft order.
+ * Lines starting with '#' are comments. Entries must be in ascending draft order
+ * with non-decreasing displacement. The lookup index is built on success.
  *
  * @return 0 on success, -1 on error
  */
 int parse_hydro_table(const char *filename, HydroTable *table);
 
+/**
+ * hydro_table_build_index - Build the lookup index from entries[0..count).
+ *
+ * Needed only for tables filled in by hand; lookups on a table without an
+ * index fail as if it were empty.
+ *
+ * @return 0 on success, -1 if there are fewer than 2 entries, drafts do not
+ *         ascend or displacement decreases
+ */
+int hydro_table_build_index(HydroTable *table);
+
 /**
  * hydro_interpolate - Linearly interpolate hydrostatic values at a given draft.
  *
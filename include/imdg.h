@@ -51,6 +51,24 @@ typedef struct DGInfo_ {
     char           ems[16];      /* Emergency Schedule reference */
 } DGInfo;
 
+/* Entries per side of the segregation matrix (class 1 has three rows) */
+#define IMDG_MATRIX_SIZE 17
+
+/**
+ * IMDGRule - One cell of the segregation matrix: the segregation a pair of
+ * classes needs and the horizontal distance that implies (imdg_min_distance).
+ */
+typedef struct {
+    SegregationType seg;
+    float           min_distance;
+} IMDGRule;
+
+/** Segregation matrix, indexed by imdg_class_index() of each item */
+extern const IMDGRule imdg_rules[IMDG_MATRIX_SIZE][IMDG_MATRIX_SIZE];
+
+/** Per matrix class: bit b set when imdg_rules[class][b].seg != SEG_NONE */
+extern const unsigned int imdg_conflicts[IMDG_MATRIX_SIZE];
+
 /**
  * IMDGViolation - A single segregation or stowage violation.
  */
@@ -62,14 +80,16 @@ typedef struct {
     char description[128];
 } IMDGViolation;
 
-#define MAX_IMDG_VIOLATIONS 100
-
 /**
  * IMDGCheckResult - Result of checking all DG cargo for IMDG compliance.
+ *
+ * Every violation is recorded, ordered by (cargo_idx_a, cargo_idx_b);
+ * the list is heap-allocated and released with imdg_result_free().
  */
 typedef struct {
     int violation_count;
-    IMDGViolation violations[MAX_IMDG_VIOLATIONS];
+    int violation_capacity;
+    IMDGViolation *violations;
     int compliant;  /* 1 if no violations, 0 otherwise */
 } IMDGCheckResult;
 
@@ -81,6 +101,19 @@ typedef struct {
 SegregationType imdg_get_segregation(int class_a, int div_a,
                                      int class_b, int div_b);
 
+/**
+ * imdg_class_index - Segregation matrix index (0 to IMDG_MATRIX_SIZE-1)
+ * of a class.division, or -1 for a class outside the matrix.
+ */
+int imdg_class_index(int dg_class, int dg_division);
+
+/**
+ * imdg_cargo_class - Matrix index of a DG item, -1 for non-DG cargo.
+ * Uses Cargo.dg_index when the parser filled it in, so the check does not
+ * touch the DGInfo record.
+ */
+int imdg_cargo_class(const Cargo *cargo);
+
 /**
  * imdg_min_distance - Minimum horizontal distance for a segregation type.
  *
@@ -96,10 +129,16 @@ const char *imdg_segregation_name(SegregationType seg);
 /**
  * imdg_check_all - Check all DG cargo pairs for IMDG compliance.
  *
- * Checks segregation distances and stowage categories.
+ * Checks segregation distances and stowage categories. Incompatible
+ * classes are paired up by class bucket; distance rules use a sweep along
+ * the ship's length, so only items within the largest required distance
+ * of each other are measured.
  *
- * @return result with violation count and details
+ * @return result with violation count and details (free with imdg_result_free)
  */
 IMDGCheckResult imdg_check_all(const Ship *ship);
 
+/** Release a result's violation list. Safe on a zeroed or freed result. */
+void imdg_result_free(IMDGCheckResult *result);
+
 #endif /* IMDG_H */
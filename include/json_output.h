@@ -1,17 +1,103 @@
 /*
  * json_output.h - JSON output formatting
+ *
+ * Results are serialized into a JsonWriter, an append-only growable
+ * buffer, and handed to the caller whole: one fwrite() for the CLI, the
+ * buffer itself for the library's cached result and the server's reply.
+ * Numbers are formatted without going through printf.
  */
 
 #ifndef JSON_OUTPUT_H
 #define JSON_OUTPUT_H
 
+#include <stdio.h>
 #include "cargoforge.h"
 
 /**
- * fprint_json_output - Write complete results in JSON format to a stream
+ * JsonWriter - Append-only output buffer. A zeroed writer is empty and
+ * compact; a failed allocation sets oom and drops everything appended
+ * after it, so callers check once at the end. data is NUL-terminated
+ * whenever len > 0.
+ */
+typedef struct {
+    char *data;
+    size_t len, cap;
+    int oom;
+    int pretty;              /* indent and break lines (the CLI layout) */
+    int load_map;            /* json_write_results() adds "load_map" */
+    unsigned int omit;       /* JSON_OMIT_* sections json_write_results() skips */
+    int cargo_first;         /* first cargo item it writes */
+    int cargo_limit;         /* items from there, 0 = to the end */
+} JsonWriter;
+
+/* JsonWriter.omit bits */
+#define JSON_OMIT_SHIP       0x1u   /* "ship" */
+#define JSON_OMIT_CARGO      0x2u   /* "cargo" (and "cargo_page") */
+#define JSON_OMIT_STABILITY  0x4u   /* hydrostatics through balance_status */
+#define JSON_OMIT_STRENGTH   0x8u   /* "longitudinal_strength" */
+
+/* fprint_json() flags */
+#define JSON_PRETTY    0x1
+#define JSON_LOAD_MAP  0x2
+
+/* Cell pitch (m) of the compartment floor load map */
+#define LOAD_MAP_CELL_SIZE 2.0f
+
+void json_writer_init(JsonWriter *w, int pretty);
+void json_writer_free(JsonWriter *w);
+
+/**
+ * json_writer_take - Detach the buffer (NUL-terminated, caller frees) and
+ * leave the writer empty. Returns NULL if an allocation failed.
+ */
+char *json_writer_take(JsonWriter *w);
+
+/** Make room for n more bytes plus a NUL; 0 on success, -1 once oom */
+int json_writer_reserve(JsonWriter *w, size_t n);
+
+/** Append bytes as they are (already JSON, or framing) */
+void json_put_raw(JsonWriter *w, const char *s, size_t n);
+void json_put_cstr(JsonWriter *w, const char *s);
+
+/** Append s as a quoted JSON string, escaping quotes, backslashes and
+ *  control characters */
+void json_put_string(JsonWriter *w, const char *s);
+
+void json_put_int(JsonWriter *w, long long v);
+
+/**
+ * json_put_fixed - Append v with a fixed number of decimals (0-9), the
+ * same text printf("%.*f") gives for every value. Values below 2^52 once
+ * scaled are formatted directly; larger and non-finite ones use snprintf.
+ */
+void json_put_fixed(JsonWriter *w, double v, int decimals);
+
+/**
+ * json_write_results - Append complete results: ship data, cargo
+ * placements and analysis. The pretty layout (w->pretty) ends with a
+ * newline; compact output has no whitespace at all.
+ *
+ * w->omit drops whole sections; the analysis always keeps its cargo
+ * summary, center of gravity and overweight flag. A cargo range
+ * (w->cargo_first, w->cargo_limit) writes only those items, followed by
+ * "cargo_page": {"first", "count", "total"}.
  *
- * Outputs all ship data, cargo placements, and analysis results
- * as valid JSON. Used by both CLI (stdout) and library (memstream).
+ * With w->load_map set, a "load_map" member follows the analysis: for
+ * each compartment (the configured holds, or the legacy layout), a grid
+ * of LOAD_MAP_CELL_SIZE cells over its floor giving the weight of the
+ * cargo standing in it above each cell, in t/m2, row by row from the
+ * compartment's origin corner.
+ *
+ * @param w Output buffer
+ * @param ship Ship structure with placed cargo
+ * @param result Analysis results
+ */
+void json_write_results(JsonWriter *w, const Ship *ship, const AnalysisResult *result);
+
+/**
+ * fprint_json_output - Write complete results in pretty JSON to a stream
+ *
+ * Builds the document with json_write_results() and writes it at once.
  *
  * @param fp Output stream
  * @param ship Ship structure with placed cargo
@@ -19,6 +105,16 @@
  */
 void fprint_json_output(FILE *fp, const Ship *ship, const AnalysisResult *result);
 
+/**
+ * fprint_json - fprint_json_output() with a choice of layout; compact
+ * output is followed by a newline.
+ *
+ * @param flags JSON_PRETTY for the indented layout, JSON_LOAD_MAP to
+ *              add the load map
+ * @return 0 on success, -1 on allocation or write failure
+ */
+int fprint_json(FILE *fp, const Ship *ship, const AnalysisResult *result, int flags);
+
 /* Convenience macro for backward compatibility */
 #define print_json_output(ship, result) fprint_json_output(stdout, ship, result)
 
@@ -0,0 +1,119 @@
+/*
+ * json_parse.h - Single-pass JSON reader
+ *
+ * A pull reader over a text buffer: the caller walks objects and arrays
+ * member by member, and every value comes back as a JsonSpan pointing
+ * into the input. Nothing is allocated and values the caller does not
+ * need are skipped (but still validated) without being decoded, so a
+ * document is read exactly once. Strings are decoded on demand, in place
+ * if the caller owns the buffer.
+ */
+
+#ifndef JSON_PARSE_H
+#define JSON_PARSE_H
+
+#include <stddef.h>
+
+#define JSON_MAX_DEPTH 64
+
+typedef enum {
+    JSON_NONE = 0,
+    JSON_NULL,
+    JSON_FALSE,
+    JSON_TRUE,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} JsonType;
+
+/**
+ * JsonSpan - One value's text within the input. For strings, start/len
+ * cover the contents between the quotes (still escaped); for everything
+ * else the value's full text, brackets included.
+ */
+typedef struct {
+    JsonType type;
+    const char *start;
+    size_t len;
+    int escaped;             /* string contains backslash escapes */
+} JsonSpan;
+
+/**
+ * JsonReader - Cursor over len bytes of JSON text.
+ */
+typedef struct {
+    const char *p;
+    const char *end;
+    const char *error;       /* first error, NULL while the input is good */
+    int depth;               /* open containers */
+    int first;               /* no member read yet in the innermost one */
+} JsonReader;
+
+void json_reader_init(JsonReader *r, const char *text, size_t len);
+
+/**
+ * json_peek - Type of the next value without consuming it (JSON_NONE at
+ * the end of input or on a character that cannot start a value).
+ */
+JsonType json_peek(JsonReader *r);
+
+/**
+ * json_read_value - Consume and validate the next value; *out (optional)
+ * receives its span. Containers are consumed whole.
+ *
+ * @return 0 on success, -1 on malformed input (r->error says why)
+ */
+int json_read_value(JsonReader *r, JsonSpan *out);
+
+/**
+ * json_object_begin / json_object_next - Walk an object's members:
+ *
+ *   if (json_object_begin(&r) == 0)
+ *       while ((rc = json_object_next(&r, &key)) > 0)
+ *           json_read_value(&r, &val);   // or descend into it
+ *
+ * json_object_next() consumes the key and colon, leaving the reader on
+ * the member's value, which the caller must read before the next call.
+ *
+ * @return begin: 0 or -1; next: 1 for a member, 0 at the closing brace,
+ *         -1 on malformed input
+ */
+int json_object_begin(JsonReader *r);
+int json_object_next(JsonReader *r, JsonSpan *key);
+
+/** Array counterparts: json_array_next() returns 1 with the reader on an element */
+int json_array_begin(JsonReader *r);
+int json_array_next(JsonReader *r);
+
+/**
+ * json_reader_finish - Check that only whitespace follows.
+ *
+ * @return 0 if the input is fully consumed, -1 otherwise
+ */
+int json_reader_finish(JsonReader *r);
+
+/**
+ * json_span_is - 1 if a string span equals the NUL-terminated lit.
+ */
+int json_span_is(const JsonSpan *s, const char *lit);
+
+/**
+ * json_span_int - Integer value of a number span that has no fraction or
+ * exponent and fits in a long long.
+ *
+ * @return 0 on success, -1 otherwise
+ */
+int json_span_int(const JsonSpan *s, long long *out);
+
+/**
+ * json_string_decode - Decode a string span's escapes (including \uXXXX
+ * and surrogate pairs, as UTF-8) into dst, which must hold s->len + 1
+ * bytes and may be s->start itself: the output never outgrows the input.
+ * The result is NUL-terminated.
+ *
+ * @return decoded length, or (size_t)-1 on an invalid escape
+ */
+size_t json_string_decode(const JsonSpan *s, char *dst);
+
+#endif /* JSON_PARSE_H */
@@ -5,7 +5,8 @@
  * opaque (CargoForge handle) or plain C structs with stable layout.
  *
  * Thread safety: Each CargoForge handle is independent. Do not share a
- * single handle across threads without external synchronization.
+ * single handle across threads without external synchronization. A job
+ * from cargoforge_submit() owns its handle until it completes.
  *
  * Example:
  *   CargoForge *cf;
@@ -22,6 +23,7 @@
 #define LIBCARGOFORGE_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -49,6 +51,66 @@ extern "C" {
 #define CF_ERR_NO_CARGO    -6   /* No cargo manifest loaded */
 #define CF_ERR_OVERWEIGHT  -7   /* Total weight exceeds ship capacity */
 #define CF_ERR_STATE       -8   /* Invalid operation for current state */
+#define CF_ERR_CANCELLED   -9   /* Job cancelled */
+#define CF_ERR_TIMEOUT    -10   /* Job deadline passed */
+
+/* ------------------------------------------------------------------ */
+/* OPTIONS                                                            */
+/* ------------------------------------------------------------------ */
+
+#define CF_OPT_THREADS      1   /* Worker threads: 1 = serial (default),
+                                   0 = one per CPU */
+#define CF_OPT_STRATEGY     2   /* CF_STRATEGY_* (default FFD) */
+#define CF_OPT_TIME_BUDGET  3   /* Multistart wall-clock budget in ms
+                                   (0 = none, default) */
+#define CF_OPT_BEAM_WIDTH   4   /* Multistart orderings kept per round
+                                   (default 4) */
+#define CF_OPT_JSON_COMPACT 5   /* 1 = cargoforge_result_json() without
+                                   whitespace; 0 = indented (default) */
+#define CF_OPT_DIAGNOSTICS  6   /* Placement diagnostics: keep the last N
+                                   items' rejection tallies (0 = off,
+                                   default) */
+#define CF_OPT_ARENA        7   /* 1 = ship, cargo and result JSON memory
+                                   comes from a handle-owned arena that
+                                   cargoforge_reset() rewinds and keeps;
+                                   0 = heap (default). Set with no ship
+                                   loaded. */
+#define CF_OPT_STATS        8   /* 1 = time each phase and count the
+                                   placement search into CfStats;
+                                   0 = off (default) */
+#define CF_OPT_PLACER       9   /* CF_PLACER_* (default guillotine) */
+#define CF_OPT_RESULT_MASK 10   /* CF_RESULT_* sections results compute and
+                                   cargoforge_result_json() writes
+                                   (default CF_RESULT_ALL) */
+#define CF_OPT_JSON_CARGO_FIRST 11 /* First cargo item in the result JSON
+                                   (default 0) */
+#define CF_OPT_JSON_CARGO_COUNT 12 /* Cargo items in the result JSON from
+                                   there (0 = to the end, default) */
+
+#define CF_STRATEGY_FFD        0   /* Single first-fit-decreasing pass */
+#define CF_STRATEGY_MULTISTART 1   /* Parallel multi-start / beam search over
+                                      cargo orderings; keeps the plan with the
+                                      most items placed, then IMO compliance,
+                                      smallest trim, largest GM */
+
+/*
+ * Result sections. Analysis stages run on first access to a result
+ * (cargoforge_result(), cargoforge_result_json()) and are kept until the
+ * plan changes, so a caller that never asks for strength never pays for
+ * it. The cargo summary (counts, weights, displacement, CG) is always
+ * there; CfResult fields of stages not run read 0 (strength_compliant -1).
+ */
+#define CF_RESULT_SHIP      0x1    /* JSON "ship" */
+#define CF_RESULT_CARGO     0x2    /* JSON "cargo" placements */
+#define CF_RESULT_STABILITY 0x4    /* hydrostatics, free surface, trim,
+                                      heel, GZ curve, IMO criteria */
+#define CF_RESULT_STRENGTH  0x8    /* longitudinal shear and bending */
+#define CF_RESULT_ALL       0xF
+
+#define CF_PLACER_GUILLOTINE     0 /* Free boxes split on every placement */
+#define CF_PLACER_EXTREME_POINTS 1 /* Candidate corners with residual spaces;
+                                      search cost stays near flat as holds
+                                      fill */
 
 /* ------------------------------------------------------------------ */
 /* OPAQUE HANDLE                                                      */
@@ -56,10 +118,25 @@ extern "C" {
 
 typedef struct CargoForge CargoForge;
 
+/**
+ * CfJob - An optimize or analyze call running in the background, from
+ * cargoforge_submit(). Reference counted.
+ */
+typedef struct CfJob CfJob;
+
+/**
+ * CfShipTemplate - A parsed ship configuration, with its hydrostatic
+ * table, tank layout, strength limits and compartments, shared read-only
+ * by any number of handles on any threads. Reference counted.
+ */
+typedef struct CfShipTemplate CfShipTemplate;
+
 /* ------------------------------------------------------------------ */
 /* RESULT STRUCTURES (stable ABI)                                     */
 /* ------------------------------------------------------------------ */
 
+#define CF_GZ_CURVE_POINTS 81      /* 0 to 80 degrees in 1-degree steps */
+
 /**
  * CfResult - Stability analysis output.
  * All distances in metres, angles in degrees, areas in m-rad.
@@ -103,6 +180,9 @@ typedef struct {
     float max_shear_force;         /* max SWSF (t) */
     float max_bending_moment;      /* max SWBM (t-m) */
     int   strength_compliant;      /* 1=pass, 0=fail, -1=not checked */
+
+    /* GZ curve for plotting: gz_curve[k] is GZ (m) at k degrees heel */
+    float gz_curve[CF_GZ_CURVE_POINTS];
 } CfResult;
 
 /**
@@ -125,6 +205,58 @@ typedef struct {
     const char *un_number;
 } CfCargoInfo;
 
+/**
+ * Plan view: the whole manifest and its placements as contiguous, typed,
+ * read-only arrays in one block owned by the handle, for hosts that wrap
+ * memory without copying (NumPy frombuffer, Arrow buffers).
+ *
+ * The block starts with a CfPlanHeader, and every array starts on a
+ * 64-byte boundary at the byte offset the header gives:
+ *
+ *   id_offsets  int32[count + 1]   ids of item i are bytes
+ *                                  [id_offsets[i], id_offsets[i+1]) of ids
+ *   ids         UTF-8 bytes, not NUL-terminated (an Arrow utf8 array)
+ *   pos         float32[count][3]  x, y, z (m, -1 = unplaced)
+ *   dims        float32[count][3]  length, width, height (m)
+ *   weight      float32[count]     kg
+ *   placed      uint8[count]       1 = placed
+ *
+ * Values are in host byte order. Offsets are from the start of the block,
+ * so a block written with cargoforge_plan_export() reads the same way
+ * through mmap.
+ */
+#define CF_PLAN_MAGIC      "CFPLAN\x1a\n"
+#define CF_PLAN_MAGIC_LEN  8
+#define CF_PLAN_VERSION    1
+
+typedef struct {
+    char     magic[CF_PLAN_MAGIC_LEN];
+    uint32_t version;              /* CF_PLAN_VERSION */
+    uint32_t count;                /* cargo items */
+    uint64_t size;                 /* bytes in the block, header included */
+    uint64_t id_offsets;           /* byte offsets of the arrays */
+    uint64_t ids;
+    uint64_t pos;
+    uint64_t dims;
+    uint64_t weight;
+    uint64_t placed;
+} CfPlanHeader;
+
+/**
+ * CfPlanView - Typed pointers into the plan block (see above).
+ */
+typedef struct {
+    int             count;
+    const int32_t  *id_offsets;
+    const char     *ids;
+    const float    *pos;
+    const float    *dims;
+    const float    *weight;
+    const uint8_t  *placed;
+    const void     *data;          /* the block, starting with its CfPlanHeader */
+    size_t          size;
+} CfPlanView;
+
 /**
  * CfIMDGViolation - A single IMDG segregation violation.
  */
@@ -136,6 +268,122 @@ typedef struct {
     const char *description;       /* human-readable description */
 } CfIMDGViolation;
 
+/**
+ * Placement diagnostic codes: indices into CfDiagnostic.counts. Codes 1-6
+ * count candidate spaces rejected for that reason; the notes and
+ * CF_DIAG_UNPLACED are 1 when they apply to the item.
+ */
+#define CF_DIAG_POINT_LOAD         1   /* item's point load over the limit */
+#define CF_DIAG_IMDG_INCOMPATIBLE  2   /* incompatible DG class on board */
+#define CF_DIAG_IMDG_DISTANCE      3   /* too close to segregated DG cargo */
+#define CF_DIAG_HAZMAT_SEPARATION  4   /* legacy 3 m hazmat rule */
+#define CF_DIAG_STACK_PRESSURE     5   /* weight above over the limit */
+#define CF_DIAG_DECK_WEIGHT        6   /* deck weight ratio exceeded */
+#define CF_DIAG_REEFER_PLACEMENT   7   /* note: reefer away from deck/plugs */
+#define CF_DIAG_FRAGILE_PLACEMENT  8   /* note: fragile deep in a hold */
+#define CF_DIAG_UNPLACED           9   /* no space fitted and passed */
+#define CF_DIAG_CODE_COUNT        10
+
+/**
+ * CfDiagnostic - One item's diagnostics from a placement (optimize, or an
+ * item fitted by cargoforge_add_cargo and friends).
+ */
+typedef struct {
+    int  cargo_index;              /* index of the item when it was placed */
+    char cargo_id[32];
+    int  counts[CF_DIAG_CODE_COUNT];
+} CfDiagnostic;
+
+/**
+ * CfStats - Instrumentation from CF_OPT_STATS. Each phase time is the
+ * wall-clock duration of its latest run (0 until it runs); the placement
+ * counters cover the latest cargoforge_optimize() and any cargo added or
+ * removed since. Multistart trials are not counted: with stats on, the
+ * winning order is replayed once and that pass is.
+ */
+typedef struct {
+    double ship_parse_ms;          /* ship config load (a template: ~0) */
+    double cargo_parse_ms;         /* cargo manifest load */
+    double place_ms;               /* packing, one optimize or edit */
+    double analysis_ms;            /* stability and strength */
+    double imdg_ms;                /* cargoforge_check_imdg() */
+    double serialize_ms;           /* cargoforge_result_json(), plan views */
+
+    long long items_searched;      /* best-fit searches run */
+    long long spaces_scanned;      /* candidate free spaces looked at */
+    long long counts[CF_DIAG_CODE_COUNT]; /* rejections per CF_DIAG_* code,
+                                      plus notes and unplaced items */
+    int   bin_count;               /* compartments in the kept plan (0 for
+                                      none), see cargoforge_bin_stats() */
+} CfStats;
+
+/**
+ * CfBinStats - One compartment of the kept plan.
+ */
+typedef struct {
+    char  name[32];
+    int   free_spaces;             /* free regions left in the bin */
+    float weight;                  /* cargo weight in it (kg) */
+    float max_weight;              /* its capacity (kg) */
+} CfBinStats;
+
+/**
+ * CfWeight - A weight added to a what-if condition (negative removes),
+ * with its centroid: x from the stern, y from the port side, z above the
+ * keel, in metres.
+ */
+typedef struct {
+    float weight;                  /* kg */
+    float x, y, z;
+} CfWeight;
+
+/**
+ * CfCondition - One what-if loading condition for cargoforge_analyze_batch().
+ */
+typedef struct {
+    const float    *tank_fill;     /* cargoforge_tank_count() fills (0-1),
+                                      NULL = the handle's current fills */
+    const CfWeight *weights;       /* added/removed weights, may be NULL */
+    int             weight_count;
+} CfCondition;
+
+/* CfMove.op */
+#define CF_MOVE_LOAD       1
+#define CF_MOVE_DISCHARGE  2
+
+/**
+ * CfMove - One move of a loading sequence: cargo item cargo (an index, as
+ * for cargoforge_cargo_info()) is loaded at its planned position or
+ * discharged.
+ */
+typedef struct {
+    int cargo;
+    int op;                        /* CF_MOVE_* */
+} CfMove;
+
+/**
+ * CfSequenceStep - The condition after one move (see
+ * cargoforge_simulate_sequence()). Stability fields are 0 on an
+ * overweight step; strength fields need strength limits in the ship
+ * config (strength_compliant is -1 without).
+ */
+typedef struct {
+    int   cargo;                   /* item moved, -1 for the initial condition */
+    int   op;                      /* CF_MOVE_*, 0 for the initial condition */
+    int   on_board;                /* cargo items on board */
+    float cargo_weight;            /* kg */
+    float displacement;            /* lightship + cargo + tanks (kg) */
+    float draft;                   /* m */
+    float trim;                    /* m, positive by the stern */
+    float heel;                    /* degrees */
+    float gm_corrected;            /* m */
+    float max_shear_force;         /* t */
+    float max_bending_moment;      /* t-m */
+    int   imo_compliant;           /* 1 or 0 */
+    int   strength_compliant;      /* 1, 0, or -1 if not checked */
+    int   overweight;              /* 1 if the step exceeds max weight */
+} CfSequenceStep;
+
 /* ------------------------------------------------------------------ */
 /* LIFECYCLE                                                          */
 /* ------------------------------------------------------------------ */
@@ -148,11 +396,27 @@ typedef struct {
 int cargoforge_open(CargoForge **cf);
 
 /**
- * Destroy a CargoForge context and free all resources.
+ * Destroy a CargoForge context and free all resources. A job still
+ * running on it is cancelled and waited for first.
  * Safe to call with NULL.
  */
 void cargoforge_close(CargoForge *cf);
 
+/**
+ * Set a handle option (CF_OPT_*). Options survive cargoforge_reset().
+ * Threaded FFD gives exactly the same plan as the serial search, and
+ * multistart without a time budget is deterministic for any thread
+ * count. Worker threads are started on the next optimize and reused.
+ * Returns CF_OK, or CF_ERROR for an unknown option or invalid value
+ * (CF_ERR_STATE for CF_OPT_ARENA changed with a ship loaded).
+ */
+int cargoforge_set_option(CargoForge *cf, int option, int value);
+
+/**
+ * Get the current value of a handle option, or CF_ERROR if unknown.
+ */
+int cargoforge_get_option(const CargoForge *cf, int option);
+
 /* ------------------------------------------------------------------ */
 /* DATA LOADING                                                       */
 /* ------------------------------------------------------------------ */
@@ -173,15 +437,74 @@ int cargoforge_load_cargo(CargoForge *cf, const char *manifest_path);
 /**
  * Load ship configuration from an in-memory string.
  * The string should be in the same key=value format as the config file.
+ * It is parsed in place; no temporary files are written.
  */
 int cargoforge_load_ship_string(CargoForge *cf, const char *config_text);
 
 /**
  * Load cargo manifest from an in-memory string.
- * Requires ship to be loaded first.
+ * Requires ship to be loaded first. Parsed in place, like the ship config.
  */
 int cargoforge_load_cargo_string(CargoForge *cf, const char *manifest_text);
 
+/**
+ * Length-delimited forms of the _string loaders: parse len bytes at text,
+ * which need not be NUL-terminated. For callers that already hold the
+ * text in a larger buffer (the server parses request bodies in place).
+ */
+int cargoforge_load_ship_buffer(CargoForge *cf, const char *text, size_t len);
+int cargoforge_load_cargo_buffer(CargoForge *cf, const char *text, size_t len);
+
+/* ------------------------------------------------------------------ */
+/* SHIP TEMPLATES                                                     */
+/* ------------------------------------------------------------------ */
+
+/**
+ * Parse a ship configuration (and the tables it names) once into a
+ * template holding one reference. Returns CF_OK, CF_ERR_PARSE or
+ * CF_ERR_NOMEM; *tpl is NULL on failure.
+ */
+int cargoforge_template_load(CfShipTemplate **tpl, const char *config_path);
+int cargoforge_template_load_buffer(CfShipTemplate **tpl, const char *text, size_t len);
+
+/**
+ * Take another reference. Returns tpl.
+ */
+CfShipTemplate *cargoforge_template_retain(CfShipTemplate *tpl);
+
+/**
+ * Drop a reference; the last one frees the template. Handles using it
+ * hold their own references. Safe to call with NULL.
+ */
+void cargoforge_template_release(CfShipTemplate *tpl);
+
+/**
+ * Use a template as the handle's ship, like cargoforge_load_ship() but
+ * without parsing: the tables are shared, and only the tank fill levels
+ * are copied so the handle can change them. Cargo must be loaded again.
+ */
+int cargoforge_load_ship_template(CargoForge *cf, CfShipTemplate *tpl);
+
+/**
+ * Number of tanks on the handle's ship (0 without a tank config).
+ */
+int cargoforge_tank_count(const CargoForge *cf);
+
+/**
+ * Set tank index's fill fraction (0.0 - 1.0) on this handle only. The
+ * plan is kept; call cargoforge_analyze() for updated results.
+ * Returns CF_OK, or CF_ERROR for a bad index or fraction.
+ */
+int cargoforge_set_tank_fill(CargoForge *cf, int index, float fill);
+
+/**
+ * Set tank index's fill from a sounding (liquid depth above the tank
+ * bottom, m), read through the tank's sounding table when it has one.
+ * Soundings beyond the tank are clamped to empty or full.
+ * Returns CF_OK, or CF_ERROR for a bad index or a non-finite sounding.
+ */
+int cargoforge_set_tank_sounding(CargoForge *cf, int index, float sounding_m);
+
 /* ------------------------------------------------------------------ */
 /* OPERATIONS                                                         */
 /* ------------------------------------------------------------------ */
@@ -199,6 +522,38 @@ int cargoforge_optimize(CargoForge *cf);
  */
 int cargoforge_analyze(CargoForge *cf);
 
+/**
+ * Analyse count what-if conditions of the current cargo positions in one
+ * call, writing results[i] for conds[i]. Each result equals changing the
+ * tank fills and adding the weights, then cargoforge_analyze(); the
+ * handle's own result and fills are left alone. Added weights count in
+ * cargo_weight, displacement and the strength weight curve.
+ * Large batches run on the handle's worker pool (CF_OPT_THREADS).
+ * Returns CF_ERROR if a fill is outside 0-1 or the ship has no tanks.
+ */
+int cargoforge_analyze_batch(CargoForge *cf, const CfCondition *conds, int count,
+                             CfResult *results);
+
+/**
+ * Simulate a loading sequence over the current cargo positions, writing
+ * steps[0] for the condition before the first move and steps[k] for the
+ * one after move k (count + 1 entries). An item starts on board when its
+ * first move is a discharge or when no move names it; its loads and
+ * discharges must alternate. Each move updates the moments, hydrostatics
+ * and strength weight curve incrementally, so a step costs O(stations),
+ * not O(cargo). Tanks keep the handle's fills; the handle's result is
+ * left alone.
+ *
+ * moves == NULL replays the plan: every placed item is loaded onto an
+ * empty ship, in manifest order (placement order after optimize), and
+ * count must be the number of placed items.
+ *
+ * Returns CF_OK, CF_ERROR for a move naming an unplaced or unknown item
+ * or out of order, CF_ERR_NO_SHIP / CF_ERR_NO_CARGO, or CF_ERR_NOMEM.
+ */
+int cargoforge_simulate_sequence(CargoForge *cf, const CfMove *moves, int count,
+                                 CfSequenceStep *steps);
+
 /**
  * Check IMDG dangerous goods segregation compliance.
  * Requires optimization to have run first.
@@ -206,24 +561,148 @@ int cargoforge_analyze(CargoForge *cf);
 int cargoforge_check_imdg(CargoForge *cf);
 
 /**
- * Reset the context for reuse. Clears ship, cargo, and results.
+ * Add one cargo item (weight in kg, dimensions in metres; type NULL means
+ * "standard") to the manifest. On an optimized handle the item is fitted
+ * into the plan's remaining free space without re-packing anything else,
+ * and the result is updated from running moment sums; it stays unplaced
+ * (placed == 0 in its CfCargoInfo) if nothing fits. Otherwise it is just
+ * appended. Returns CF_OK, or CF_ERROR for a duplicate id or bad values.
+ */
+int cargoforge_add_cargo(CargoForge *cf, const char *id, float weight,
+                         float length, float width, float height,
+                         const char *type);
+
+/**
+ * Remove a cargo item by id. On an optimized handle its space is handed
+ * back to the plan and only the items stacked on top of it are re-placed;
+ * the result is updated without a full re-analysis. Cargo indices after
+ * the removed item shift down by one. Returns CF_OK, or CF_ERROR if no
+ * item has that id.
+ */
+int cargoforge_remove_cargo(CargoForge *cf, const char *id);
+
+/**
+ * Reset the context for reuse. Clears ship, cargo, and results. With
+ * CF_OPT_ARENA set the arena is rewound in O(1) and its blocks kept, so a
+ * handle reused for inputs of similar size stops allocating for them.
  */
 void cargoforge_reset(CargoForge *cf);
 
+/**
+ * Arena fill: bytes in use since the last reset and bytes held by its
+ * blocks (both 0 without CF_OPT_ARENA). Either pointer may be NULL.
+ * Returns CF_OK, or CF_ERROR for a NULL handle.
+ */
+int cargoforge_arena_stats(const CargoForge *cf, size_t *used, size_t *reserved);
+
+/* ------------------------------------------------------------------ */
+/* ASYNCHRONOUS JOBS                                                  */
+/* ------------------------------------------------------------------ */
+
+/*
+ * cargoforge_submit() runs cargoforge_optimize() or cargoforge_analyze()
+ * on a worker thread the handle starts on first use, and returns at once.
+ * From then until the job completes, the handle belongs to the job: call
+ * nothing on it except the cargoforge_job_*() functions and
+ * cargoforge_close(). Once it has completed (poll or wait returns a
+ * status, or the callback has run) the handle is the caller's again and
+ * holds the job's results exactly as a direct call would leave them.
+ *
+ * Cancellation and deadlines are cooperative: placement checks before
+ * every item, and multistart between rounds and in each attempt, so a job
+ * stops within one item's best-fit search. A stopped optimize completes
+ * with CF_ERR_CANCELLED or CF_ERR_TIMEOUT and leaves the ship and cargo
+ * loaded with no plan or result; a job stopped before it started leaves
+ * the handle untouched. Analysis is not interrupted once started.
+ */
+
+#define CF_JOB_OPTIMIZE  0
+#define CF_JOB_ANALYZE   1
+
+#define CF_JOB_PENDING   1   /* cargoforge_job_poll/wait: not completed */
+
+/**
+ * Completion callback, run on the job's worker thread once the handle
+ * holds the results and before waiters wake. It may read the handle's
+ * results; it must not wait on the job, submit to or close the handle.
+ */
+typedef void (*CfJobCallback)(CfJob *job, int status, void *user);
+
+/**
+ * CfJobOptions - What cargoforge_submit() runs.
+ * Initialise with cargoforge_job_options_init().
+ */
+typedef struct {
+    int           op;              /* CF_JOB_OPTIMIZE (default) or CF_JOB_ANALYZE */
+    int           deadline_ms;     /* stop this long after submit, 0 = none */
+    CfJobCallback on_done;         /* optional */
+    void         *user;            /* passed to on_done */
+} CfJobOptions;
+
+/**
+ * Fill opts with the defaults (optimize, no deadline, no callback).
+ */
+void cargoforge_job_options_init(CfJobOptions *opts);
+
+/**
+ * Start a job on cf. *job receives a reference the caller releases with
+ * cargoforge_job_release(). opts may be NULL for the defaults. Returns
+ * CF_OK, CF_ERROR for bad options, CF_ERR_STATE if cf still has a job
+ * running, or CF_ERR_NOMEM.
+ */
+int cargoforge_submit(CargoForge *cf, const CfJobOptions *opts, CfJob **job);
+
+/**
+ * The job's status if it has completed (what the direct call returned,
+ * or CF_ERR_CANCELLED / CF_ERR_TIMEOUT), else CF_JOB_PENDING.
+ */
+int cargoforge_job_poll(CfJob *job);
+
+/**
+ * Block until the job completes or timeout_ms passes (< 0 = no limit).
+ * Returns the status, or CF_JOB_PENDING on timeout.
+ */
+int cargoforge_job_wait(CfJob *job, int timeout_ms);
+
+/**
+ * Ask the job to stop. Returns at once; the job completes with
+ * CF_ERR_CANCELLED unless it had already finished.
+ */
+void cargoforge_job_cancel(CfJob *job);
+
+/**
+ * The handle the job runs on.
+ */
+CargoForge *cargoforge_job_handle(const CfJob *job);
+
+/**
+ * Drop the caller's reference. A job still running carries on (cancel it
+ * first to abandon it); its memory goes with the last reference. Safe to
+ * call with NULL.
+ */
+void cargoforge_job_release(CfJob *job);
+
 /* ------------------------------------------------------------------ */
 /* RESULTS                                                            */
 /* ------------------------------------------------------------------ */
 
 /**
  * Get the analysis result. Returns NULL if optimize/analyze hasn't run.
- * The pointer is valid until the next optimize/analyze/reset/close call.
+ * Stages in CF_OPT_RESULT_MASK not computed yet are computed first and
+ * kept on the handle, so this call writes to cf: like every call that
+ * changes a handle, it must not run concurrently with others on it.
+ * The pointer is valid until the next optimize/analyze/add/remove/reset/close
+ * call.
  */
-const CfResult *cargoforge_result(const CargoForge *cf);
+const CfResult *cargoforge_result(CargoForge *cf);
 
 /**
- * Get the full result as a JSON string.
- * The returned pointer is valid until the next optimize/analyze/reset/close.
- * Returns NULL on error.
+ * Get the result as a JSON string, indented or compact per
+ * CF_OPT_JSON_COMPACT, with the sections in CF_OPT_RESULT_MASK and the
+ * cargo range set by CF_OPT_JSON_CARGO_FIRST / _COUNT (a range adds
+ * "cargo_page": {"first", "count", "total"}). The returned pointer is
+ * valid until the next optimize/analyze/add/remove/reset/close or a
+ * change to one of those options. Returns NULL on error.
  */
 const char *cargoforge_result_json(CargoForge *cf);
 
@@ -238,6 +717,27 @@ int cargoforge_cargo_info(const CargoForge *cf, int index, CfCargoInfo *info);
  */
 int cargoforge_cargo_count(const CargoForge *cf);
 
+/**
+ * Fill view with the plan block (see CfPlanView). The block is built on
+ * the first call after the manifest or plan changes and then reused, so
+ * repeated calls are free. Pointers stay valid until the next call that
+ * changes the cargo or the plan (load, optimize, analyze, add/remove,
+ * tank fill), reset or close; the block's memory may be reused by the
+ * next view. Not placed yet is fine: positions are then -1.
+ * Returns CF_OK, CF_ERR_NO_CARGO without a manifest, CF_ERR_NOMEM, or
+ * CF_ERROR if the ids exceed 2 GiB.
+ */
+int cargoforge_plan_view(CargoForge *cf, CfPlanView *view);
+
+/**
+ * Write the plan block to path, for a sidecar process to mmap() (a path
+ * under /dev/shm keeps it in shared memory). The block is written to
+ * "<path>.tmp" and renamed into place, so a reader opening path never
+ * sees a partial block.
+ * Returns CF_OK, CF_ERR_NO_CARGO, CF_ERR_NOMEM or CF_ERR_FILE.
+ */
+int cargoforge_plan_export(CargoForge *cf, const char *path);
+
 /**
  * Get the number of IMDG violations (after cargoforge_check_imdg).
  * Returns -1 if IMDG check hasn't been run.
@@ -256,6 +756,134 @@ int cargoforge_imdg_violation(const CargoForge *cf, int index,
  */
 int cargoforge_imdg_compliant(const CargoForge *cf);
 
+/* ------------------------------------------------------------------ */
+/* PLACEMENT DIAGNOSTICS                                              */
+/* ------------------------------------------------------------------ */
+
+/*
+ * With CF_OPT_DIAGNOSTICS set to N > 0, placement records one entry per
+ * item that had a candidate rejected, drew a note or stayed unplaced, in a
+ * ring of the last N entries, and keeps per-code totals. Nothing is
+ * printed. cargoforge_optimize() starts a fresh log.
+ */
+
+/** Entries held (0 to N), or -1 for a NULL handle */
+int cargoforge_diag_count(const CargoForge *cf);
+
+/**
+ * Get entry index (0 = oldest held). Returns CF_OK and fills d, or
+ * CF_ERROR if index is out of range.
+ */
+int cargoforge_diag_get(const CargoForge *cf, int index, CfDiagnostic *d);
+
+/**
+ * Sum of every entry's counts since the log was last cleared, including
+ * entries the ring has since overwritten. entries (optional) receives how
+ * many entries were recorded in that time.
+ */
+int cargoforge_diag_totals(const CargoForge *cf, long long totals[CF_DIAG_CODE_COUNT],
+                           long long *entries);
+
+/** Drop all entries and totals */
+void cargoforge_diag_clear(CargoForge *cf);
+
+/** Short name of a CF_DIAG_* code, e.g. "stack pressure" */
+const char *cargoforge_diag_name(int code);
+
+/* ------------------------------------------------------------------ */
+/* INSTRUMENTATION                                                    */
+/* ------------------------------------------------------------------ */
+
+/**
+ * Snapshot the handle's CF_OPT_STATS timers and counters (zero while the
+ * option is off; bin_count is always filled in). cargoforge_reset()
+ * clears them. Returns CF_OK, or CF_ERROR for a NULL argument.
+ */
+int cargoforge_stats(const CargoForge *cf, CfStats *stats);
+
+/**
+ * Compartment index (0 to CfStats.bin_count - 1) of the kept plan.
+ * Returns CF_OK and fills b, or CF_ERROR if index is out of range.
+ */
+int cargoforge_bin_stats(const CargoForge *cf, int index, CfBinStats *b);
+
+/* ------------------------------------------------------------------ */
+/* RESULT CACHE                                                       */
+/* ------------------------------------------------------------------ */
+
+/**
+ * CfCache - Thread-safe LRU store of serialized results, shared by any
+ * number of handles. Entries are keyed on a SHA-256 digest of the ship
+ * config and cargo manifest text, so a hit skips parsing and packing.
+ * Files the ship config names (hydrostatic_table, tank_config) are not
+ * part of the key: clear the cache if they change.
+ */
+typedef struct CfCache CfCache;
+
+typedef struct {
+    unsigned char digest[32];
+} CfCacheKey;
+
+typedef struct {
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;  /* entries dropped to stay within max_bytes */
+    size_t entries;
+    size_t bytes;                  /* stored results plus per-entry overhead */
+    size_t max_bytes;
+} CfCacheStats;
+
+/**
+ * Create a cache holding at most max_bytes. Returns CF_OK, CF_ERROR for
+ * a zero bound, or CF_ERR_NOMEM. Free it with cargoforge_cache_close().
+ */
+int cargoforge_cache_open(CfCache **cache, size_t max_bytes);
+
+/**
+ * Destroy a cache. Safe to call with NULL.
+ */
+void cargoforge_cache_close(CfCache *cache);
+
+/**
+ * Compute the key for a ship config / cargo manifest pair as cf would
+ * optimize it. Line endings, blank lines and '#' comment lines do not
+ * change the key; the options that change the result JSON (strategy,
+ * beam width, time budget, compact output, placer, result mask, cargo
+ * range) do. cf may be NULL for the
+ * default options.
+ */
+void cargoforge_cache_key(const CargoForge *cf,
+                          const char *ship_config, size_t ship_len,
+                          const char *cargo_manifest, size_t cargo_len,
+                          CfCacheKey *key);
+
+/**
+ * Look up a result. On a hit, *json receives a NUL-terminated copy the
+ * caller frees and *len (optional) its length, and the entry becomes the
+ * most recently used. Returns CF_OK on a hit, CF_ERROR on a miss, or
+ * CF_ERR_NOMEM.
+ */
+int cargoforge_cache_get(CfCache *cache, const CfCacheKey *key,
+                         char **json, size_t *len);
+
+/**
+ * Store a copy of a result, replacing any entry with the same key and
+ * evicting the least recently used ones to stay within the bound. A
+ * result larger than the whole bound is not stored (CF_ERROR).
+ */
+int cargoforge_cache_put(CfCache *cache, const CfCacheKey *key,
+                         const char *json, size_t len);
+
+/**
+ * Drop every entry; the counters are kept.
+ */
+void cargoforge_cache_clear(CfCache *cache);
+
+/**
+ * Snapshot the cache's counters.
+ */
+void cargoforge_cache_stats(CfCache *cache, CfCacheStats *stats);
+
 /* ------------------------------------------------------------------ */
 /* ERROR HANDLING                                                     */
 /* ------------------------------------------------------------------ */
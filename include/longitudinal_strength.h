@@ -14,6 +14,9 @@
 /* Standard 20-interval hull division = 21 stations (AP to FP) */
 #define LS_NUM_STATIONS 21
 
+/* Finest grid a ship config may ask for (strength_stations) */
+#define LS_MAX_STATIONS 2001
+
 /**
  * StrengthLimits - Permissible shear force and bending moment.
  * Typically from the class society approval documentation.
@@ -22,6 +25,7 @@ typedef struct StrengthLimits_ {
     float permissible_sf;       /* max allowable shear force (tonnes) */
     float permissible_bm_hog;   /* max allowable hogging BM (t-m), positive */
     float permissible_bm_sag;   /* max allowable sagging BM (t-m), positive value for the limit */
+    int   stations;             /* station grid, AP to FP; 0 = LS_NUM_STATIONS */
 } StrengthLimits;
 
 /**
@@ -43,10 +47,106 @@ typedef struct {
     float max_bm_position;     /* position of max |BM| from AP (m) */
 } LongStrengthResult;
 
+/**
+ * StrengthModel - Station grid and weight distribution (lightship plus
+ * placed cargo) for any number of stations, heap-backed.
+ *
+ * The weight curve depends only on the plan, so one model serves every
+ * condition that differs in tanks or displacement; a condition with added
+ * weights solves on a copy of the curve (strength_model_add_weight()).
+ * strength_model_solve() adds buoyancy and integrates in O(stations)
+ * without touching the model, so threads can share it.
+ */
+typedef struct {
+    int    station_count;
+    float  length;             /* ship length (m) */
+    float  spacing;            /* station spacing (m) */
+    float *station_pos;        /* position from AP (m) */
+    float *weight_dist;        /* weight per unit length (t/m) */
+} StrengthModel;
+
+/**
+ * StrengthSummary - Maxima of one solved condition.
+ */
+typedef struct {
+    float max_shear_force;     /* absolute max SF (t) */
+    float max_sf_position;     /* position of max SF from AP (m) */
+    float max_bm_hog;          /* max hogging BM (t-m), positive */
+    float max_bm_sag;          /* max sagging BM (t-m), positive */
+    float max_bm_position;     /* position of max |BM| from AP (m) */
+} StrengthSummary;
+
+/**
+ * StrengthProfile - Optional per-station output of strength_model_solve().
+ * Each non-NULL array receives station_count values.
+ */
+typedef struct {
+    float *buoyancy_dist;      /* t/m */
+    float *net_load;           /* t/m */
+    float *shear_force;        /* t */
+    float *bending_moment;     /* t-m */
+} StrengthProfile;
+
+/**
+ * strength_model_init - Build the station grid and weight distribution.
+ *
+ * Cargo is spread over the stations with a difference array: each item
+ * adds its partial end stations directly and marks the run of stations it
+ * covers fully, so the cost is O(cargo + stations).
+ *
+ * @param stations Station count (0 = LS_NUM_STATIONS, else 3 to LS_MAX_STATIONS)
+ * @return 0 on success, -1 on a bad count or allocation failure
+ */
+int strength_model_init(StrengthModel *model, const Ship *ship, int stations);
+
+/**
+ * strength_model_init_lightship - Like strength_model_init(), with the
+ * lightship curve only: no cargo is distributed.
+ */
+int strength_model_init_lightship(StrengthModel *model, const Ship *ship, int stations);
+
+/**
+ * strength_model_add_cargo - Add sign times one item's weight curve (t/m,
+ * as strength_model_init() spreads it) into dist[0..station_count).
+ * A no-op for unplaced items. Costs O(stations the item covers), so a
+ * loading sequence keeps its curve current move by move.
+ */
+void strength_model_add_cargo(const StrengthModel *model, const Cargo *cargo, double sign,
+                              double *dist);
+
+/**
+ * strength_model_add_weight - Add a point weight of weight_t (t, negative
+ * to take weight off) at x m from the AP into dist[0..station_count), on
+ * the nearest station as a short item there is spread. Weight beyond the
+ * end stations is not counted.
+ */
+void strength_model_add_weight(const StrengthModel *model, float weight_t, float x,
+                               double *dist);
+
+/** Free a model's arrays. Safe on a zeroed or already freed model. */
+void strength_model_free(StrengthModel *model);
+
+/**
+ * strength_model_solve - Shear force and bending moment for a displacement.
+ *
+ * @param profile Per-station output, or NULL for the maxima only
+ */
+void strength_model_solve(const StrengthModel *model, float displacement_t,
+                          StrengthSummary *summary, const StrengthProfile *profile);
+
+/**
+ * check_strength_summary - Compare maxima against permissible limits.
+ *
+ * @return 1 if within limits, 0 if exceeded, -1 on NULL arguments
+ */
+int check_strength_summary(const StrengthSummary *summary,
+                           const StrengthLimits *limits);
+
 /**
  * calculate_longitudinal_strength - Main SWSF/SWBM calculation.
  *
- * Divides the hull into 20 intervals (21 stations from AP to FP).
+ * Divides the hull into 20 intervals (21 stations from AP to FP); a
+ * fixed-size wrapper around strength_model_solve().
  * Distributes lightship weight as a trapezoidal curve, cargo weight
  * at actual positions, and buoyancy uniformly along the waterplane.
  * Integrates to get shear force and bending moment.
@@ -0,0 +1,101 @@
+/*
+ * optimizer.h - Multi-start / beam-search loading optimizer
+ *
+ * Runs many independent packing attempts with the guillotine placer, each
+ * with a different cargo ordering, and keeps the plan with the best score
+ * from perform_analysis(). Round 0 tries every deterministic sort key plus
+ * random perturbations of the volume order; each later round perturbs the
+ * beam_width best orderings found so far. Attempts within a round run in
+ * parallel on a thread pool.
+ */
+
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "cargoforge.h"
+
+struct ThreadPool_;
+
+/**
+ * OptimizerStrategy - Top-level loading strategy.
+ */
+typedef enum {
+    STRATEGY_FFD,            /* single first-fit-decreasing pass (default) */
+    STRATEGY_MULTISTART      /* parallel multi-start / beam search */
+} OptimizerStrategy;
+
+/**
+ * SortKey - Cargo orderings tried in round 0.
+ */
+typedef enum {
+    SORT_VOLUME,             /* largest volume first (plain FFD) */
+    SORT_WEIGHT,             /* heaviest first */
+    SORT_FOOTPRINT,          /* largest length x width first */
+    SORT_HEIGHT,             /* tallest first */
+    SORT_DG_FIRST,           /* dangerous goods / hazardous first, then volume */
+    SORT_KEY_COUNT,
+    SORT_PERTURBED = SORT_KEY_COUNT  /* random perturbation of a parent order */
+} SortKey;
+
+/**
+ * OptimizerOptions - Tuning for optimize_multi_start().
+ * Initialise with optimizer_options_init().
+ */
+typedef struct {
+    int threads;             /* worker threads (0 = one per CPU, default) */
+    struct ThreadPool_ *pool;/* optional caller-owned pool; overrides threads */
+    int random_starts;       /* perturbed attempts per round (default 8) */
+    int beam_width;          /* orderings kept between rounds (default 4) */
+    int max_rounds;          /* rounds including round 0 (default 4) */
+    int time_budget_ms;      /* wall-clock limit, 0 = none (default) */
+    unsigned int seed;       /* perturbation seed (default 1) */
+    int engine;              /* PlacementEngine for every attempt (default guillotine) */
+    int (*should_stop)(void *ctx); /* polled between rounds and by every attempt's */
+    void *stop_ctx;          /* placement (may be called from several threads) */
+} OptimizerOptions;
+
+/**
+ * OptimizerStats - What a multi-start run did.
+ */
+typedef struct {
+    int    attempts;         /* packing attempts completed */
+    int    rounds;           /* rounds started */
+    int    best_strategy;    /* SortKey of the winning attempt */
+    int    best_round;       /* round the winning attempt came from */
+    int    best_placed;      /* items placed by the winning plan */
+    int    budget_exhausted; /* 1 if the time budget cut the search short */
+    int    stopped;          /* 1 if should_stop ended the search */
+    double elapsed_ms;
+} OptimizerStats;
+
+/**
+ * optimizer_options_init - Fill opts with the defaults.
+ */
+void optimizer_options_init(OptimizerOptions *opts);
+
+/**
+ * optimize_multi_start - Search cargo orderings and apply the best plan.
+ *
+ * When should_stop fires, attempts still running stop placing and the
+ * search ends: the ship gets the best plan so far (possibly a partial
+ * one), or none.
+ *
+ * Plans are ranked by placed item count, then IMO compliance, then
+ * smallest |trim|, then largest corrected GM; ties go to the earlier
+ * attempt, and attempt 0 is the plain FFD pass, so the result is never
+ * worse than place_cargo_3d(). On return ship->cargo holds the winning
+ * plan (in that attempt's order). Without a time budget the outcome is
+ * deterministic for a given seed, whatever the thread count.
+ *
+ * @param opts  Options, or NULL for the defaults
+ * @param stats Optional run statistics
+ * @return 0 on success, -1 on allocation failure (ship left unplaced)
+ */
+int optimize_multi_start(Ship *ship, const OptimizerOptions *opts, OptimizerStats *stats);
+
+/**
+ * sort_key_name - Short name of a SortKey ("volume", "perturbed", ...).
+ */
+const char *sort_key_name(int key);
+
+#endif /* OPTIMIZER_H */
@@ -1,7 +1,8 @@
 /*
  * placement_3d.h - 3D bin-packing for realistic cargo placement
  *
- * Implements 3D guillotine bin-packing algorithm with:
+ * Implements 3D bin-packing with two engines, guillotine splitting
+ * (default) and extreme points, and:
  * - True 3D space utilization
  * - Multiple orientations per cargo item
  * - Stacking constraints
@@ -12,24 +13,75 @@
 #define PLACEMENT_3D_H
 
 #include "cargoforge.h"
+#include "diagnostics.h"
+
+struct ThreadPool_;
+
+/* Initial free-space capacity of a bin; storage grows geometrically after */
+#define BIN3D_INITIAL_SPACES 64
+
+/* Parallel search splits bins into chunks of this many free spaces; items
+ * whose candidate set is smaller than two chunks are searched serially. */
+#define PLACEMENT_CHUNK_SPACES 128
+
+/**
+ * PlacementEngine - How a bin tracks where cargo can go.
+ *
+ * PLACER_GUILLOTINE keeps disjoint free boxes: each placement splits its
+ * box into right, back and top remainders, merged with their neighbours
+ * where the union is again a box. PLACER_EXTREME_POINTS keeps candidate
+ * corners (extreme points) next to placed cargo, each with its residual
+ * space: the empty box an item placed there may use. Residual spaces may
+ * overlap, and points left with no usable room are dropped, so the set
+ * tracks the surface of the load and the search cost per item stays
+ * close to flat as a hold fills. Both leave placements in Cargo.pos_*.
+ */
+typedef enum {
+    PLACER_GUILLOTINE,
+    PLACER_EXTREME_POINTS
+} PlacementEngine;
 
 /**
  * Space3D - Represents a free 3D rectangular space in a bin
  *
- * Used by the guillotine algorithm to track available placement regions.
+ * A free box for the guillotine engine; for the extreme-point engine the
+ * corner is the point and the extents are its residual space.
  */
 typedef struct {
     float x, y, z;       // Bottom-left-back corner
     float width;         // X dimension
     float depth;         // Y dimension
     float height;        // Z dimension
-    int is_free;         // 1 if available, 0 if occupied
+    int is_free;         // Always 1 for spaces held in a bin's free list
 } Space3D;
 
+/**
+ * SpaceStore - A bin's free spaces (or extreme points) in structure-of-arrays layout.
+ *
+ * Each column is a separate float array (one shared allocation) so the
+ * candidate scan can load the extents of several spaces into one SIMD
+ * register. volume[] is kept alongside so the scan never recomputes it.
+ */
+typedef struct {
+    float *x, *y, *z;        // Bottom-left-back corners
+    float *width;            // X extents
+    float *depth;            // Y extents
+    float *height;           // Z extents
+    float *volume;           // width * depth * height
+    int count;
+    int capacity;
+} SpaceStore;
+
 /**
  * Bin3D - A 3D cargo compartment with free space tracking
  *
- * Represents a hold, deck, or other cargo area with realistic 3D constraints.
+ * Represents a hold, deck, or other cargo area with realistic 3D constraints,
+ * built from one HoldDef of the ship's compartment list.
+ * spaces holds only free regions: consumed spaces are swap-removed and
+ * new remainders are merged with face-adjacent neighbours, so the store
+ * stays compact as the bin fills (PLACER_EXTREME_POINTS keeps its points
+ * there instead). Initialise with bin3d_init() and release
+ * with bin3d_free().
  */
 typedef struct {
     char name[32];
@@ -39,24 +91,183 @@ typedef struct {
     float height;            // Z dimension
     float max_weight;        // Weight capacity (kg)
     float current_weight;    // Current load (kg)
-    Space3D spaces[MAX_FREE_RECTS];
-    int space_count;
+    unsigned int flags;      // HOLD_FLAG_* (holds.h): deck, reefer plugs
+    SpaceStore spaces;       // Free spaces (heap, grows on demand)
 } Bin3D;
 
+/**
+ * bin3d_init - Set up an empty bin whose whole volume is one free space.
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int bin3d_init(Bin3D *bin, const char *name, float x, float y, float z,
+               float width, float depth, float height, float max_weight);
+
+/**
+ * bin3d_free - Release a bin's free-space storage. Safe on a zeroed bin.
+ */
+void bin3d_free(Bin3D *bin);
+
+/**
+ * bin3d_add_space - Add a free space, merging it with any neighbour that
+ * shares a full face so adjacent remainders coalesce into one region.
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int bin3d_add_space(Bin3D *bin, const Space3D *space);
+
+/**
+ * bin3d_get_space - Copy free space space_idx out of the SoA store.
+ */
+void bin3d_get_space(const Bin3D *bin, int space_idx, Space3D *out);
+
+/**
+ * bin3d_remove_space - Drop a free space in O(1) by swapping in the last one.
+ *
+ * Invalidates the index of the previously last space.
+ */
+void bin3d_remove_space(Bin3D *bin, int space_idx);
+
+/**
+ * PlacementSlot - Where one cargo item went: bin index and orientation
+ * (0-5), or -1/-1 while unplaced. Indexed in parallel with ship->cargo.
+ */
+typedef struct {
+    int bin;
+    int orientation;
+} PlacementSlot;
+
+/**
+ * PlacementState - Bins and per-item slots kept after a placement run so a
+ * plan can be edited in place: placement_state_place() fits new or released
+ * items into the remaining free space, placement_state_release() hands an
+ * item's volume back to its bin. Zero-initialise (or placement_state_init())
+ * and release with placement_state_free().
+ */
+typedef struct {
+    Bin3D *bins;
+    int bin_count;
+    int engine;                  // PlacementEngine the bins were built for
+    PlacementSlot *slots;        // One per cargo item, same order as ship->cargo
+    int slot_count;
+    int slot_capacity;
+} PlacementState;
+
+/**
+ * PlacementStats - Search counters a run adds to (the caller zeroes them).
+ * spaces_scanned counts the free spaces of every bin with weight headroom
+ * that an item's search looked at; counts[] sums the items' diagnostic
+ * tallies (rejections per DiagCode, notes, unplaced items).
+ */
+typedef struct {
+    long long items;
+    long long spaces_scanned;
+    long long counts[DIAG_CODE_COUNT];
+} PlacementStats;
+
+/**
+ * PlacementOptions - Tuning knobs for place_cargo_3d_opts().
+ *
+ * Initialise with placement_options_init(). Threaded placement produces
+ * exactly the same plan as the serial path.
+ */
+typedef struct {
+    int threads;                 // 1 = serial (default), 0 = one per CPU
+    struct ThreadPool_ *pool;    // Optional caller-owned pool; overrides threads
+    int presorted;               // Place in current cargo order (skip volume sort)
+    PlacementState *state;       // If set, receives the bins and slots of the run
+    struct DiagLog_ *diag;       // If set, receives each item's rejection tally
+    PlacementStats *stats;       // If set, search counters are added to it
+    int engine;                  // PlacementEngine (default PLACER_GUILLOTINE)
+    int (*should_stop)(void *ctx); // If set, polled before each item; nonzero
+    void *stop_ctx;              //   ends the run with the rest unplaced
+} PlacementOptions;
+
+/**
+ * placement_options_init - Fill opts with the defaults (serial search).
+ */
+void placement_options_init(PlacementOptions *opts);
+
 /**
  * place_cargo_3d - Main 3D bin-packing function
  *
- * Places cargo items into ship's compartments using 3D guillotine algorithm.
+ * Places cargo items into ship's compartments (ship->holds, or the legacy
+ * forward hold / aft hold / deck layout) using 3D guillotine algorithm.
  * Sorts cargo by volume (largest first) and tries all 6 rotations per item.
  *
  * @param ship Ship structure with cargo manifest
  *
  * Side effects:
  * - Updates pos_x, pos_y, pos_z for each placed cargo item
- * - Prints warnings to stderr for unplaced items
+ * - Unless ship->quiet, prints one line per item that had candidates
+ *   rejected, was not placed, or drew a reefer/fragile note
  */
 void place_cargo_3d(Ship *ship);
 
+/**
+ * place_cargo_3d_opts - place_cargo_3d() with explicit options.
+ *
+ * With more than one thread, each item's best-fit search is split across
+ * (bin, space-chunk) work units whose results are reduced in bin and
+ * space order, so ties resolve exactly as in the serial scan.
+ *
+ * @param opts Options, or NULL for the defaults
+ */
+void place_cargo_3d_opts(Ship *ship, const PlacementOptions *opts);
+
+/**
+ * placement_state_init - Empty state (no bins, no slots).
+ */
+void placement_state_init(PlacementState *state);
+
+/**
+ * placement_state_free - Release a state's bins and slots. Safe on a
+ * zeroed state; leaves it empty.
+ */
+void placement_state_free(PlacementState *state);
+
+/**
+ * placement_state_place - Fit cargo items into a kept plan's free space.
+ *
+ * Items are placed in the order given, each by the same best-fit search
+ * as a full run, against the bins' current free spaces and weights. Slots
+ * are added for cargo appended to ship->cargo since the state was made.
+ *
+ * @param items Indices into ship->cargo; each must currently be unplaced
+ * @param opts  Threading options (presorted/state/engine are ignored: the
+ *              state keeps the engine it was built with), or NULL
+ * @return number of items placed, or -1 on allocation failure
+ */
+int placement_state_place(PlacementState *state, Ship *ship, const int *items,
+                          int n, const PlacementOptions *opts);
+
+/**
+ * placement_state_dependents - Collect an item and everything stacked on it.
+ *
+ * Fills out[] with idx followed by every placed item that rests, directly
+ * or through other items, on top of it in the same bin. These must be
+ * released together, or the upper ones would be left unsupported.
+ *
+ * @param out Room for ship->cargo_count indices
+ * @return number of indices written (0 if idx is unplaced)
+ */
+int placement_state_dependents(const PlacementState *state, const Ship *ship,
+                               int idx, int *out);
+
+/**
+ * placement_state_release - Return a placed item's volume and weight to its
+ * bin and mark it unplaced (pos_* = -1).
+ *
+ * @return 0 on success, -1 on allocation failure (item stays placed)
+ */
+int placement_state_release(PlacementState *state, Ship *ship, int idx);
+
+/**
+ * placement_state_erase - Drop the slot of a cargo item that is being
+ * removed from ship->cargo (release it first); later slots shift down.
+ */
+void placement_state_erase(PlacementState *state, int idx);
+
 int find_best_fit_3d(const Ship *ship, Bin3D *bins, int bin_count,
                      const Cargo *cargo, int *best_bin, int *best_space,
                      int *best_orientation);
@@ -65,7 +276,8 @@ int find_best_fit_3d(const Ship *ship, Bin3D *bins, int bin_count,
  * split_space_3d - Splits a space after placing cargo (guillotine split)
  *
  * After placing cargo in a space, this splits the remaining volume into
- * smaller free spaces using the guillotine heuristic.
+ * smaller free spaces using the guillotine heuristic. The consumed space
+ * is removed from the bin, so space indices are not stable across calls.
  *
  * @param bin Bin containing the space
  * @param space_idx Index of space being split
@@ -74,4 +286,19 @@ int find_best_fit_3d(const Ship *ship, Bin3D *bins, int bin_count,
  */
 void split_space_3d(Bin3D *bin, int space_idx, const Cargo *cargo, int orientation);
 
+/**
+ * extreme_point_commit - Place a w x d x h box at extreme point point_idx
+ *
+ * Adds the points at the box's right, back and top faces (with residual
+ * spaces cut from the used point's), shrinks every residual space the box
+ * cuts into along the axis that keeps the most volume, and drops points
+ * whose residual space is thinner than min_extent on some axis or that
+ * repeat a point with more room. Point indices are not stable across calls.
+ *
+ * @param min_extent Smallest item dimension still to place (0 keeps all)
+ * @return 0 on success, -1 on allocation failure (new points lost)
+ */
+int extreme_point_commit(Bin3D *bin, int point_idx, float w, float d, float h,
+                         float min_extent);
+
 #endif /* PLACEMENT_3D_H */
@@ -1,8 +1,10 @@
 /*
  * server.h - Minimal JSON-RPC 2.0 HTTP server for CargoForge
  *
- * Single-threaded, zero-dependency HTTP server that exposes the
- * libcargoforge API as JSON-RPC methods.
+ * Zero-dependency HTTP/1.1 server that exposes the libcargoforge API as
+ * JSON-RPC methods. An epoll/kqueue event loop serves keep-alive
+ * connections; requests run on a fixed pool of worker threads behind a
+ * bounded queue, and a full queue answers 503 instead of stalling.
  *
  * Methods:
  *   optimize   — Load ship + cargo, run optimization, return results
@@ -10,9 +12,10 @@
  *   analyze    — Run stability analysis (no placement)
  *   check_imdg — Check IMDG segregation compliance
  *   version    — Return library version
+ *   cache_stats — Result cache hits, misses, evictions and size
  *
  * Usage:
- *   cargoforge serve --port=8080
+ *   cargoforge serve --port=8080 [--workers=N] [--queue-depth=N]
  *
  * Request:
  *   POST / HTTP/1.1
@@ -25,13 +28,66 @@
  *
  * Response:
  *   {"jsonrpc":"2.0","result":{...},"id":1}
+ *
+ * A JSON array of requests is a batch: its calls run concurrently on the
+ * worker pool and the response is an array in the same order. Every call
+ * gets a response; one without an id is answered with "id":null.
+ *
+ * optimize takes an optional "stats":true param: the result object then
+ * gets a "stats" member with the call's phase times (ms), placement search
+ * counters and the free spaces left per compartment (CfStats).
+ *
+ * GET /metrics answers in the Prometheus text format: calls per method,
+ * errors, per-phase time summaries, placement search and rejection
+ * counters, result cache counters, and the queue and connection gauges.
+ *
+ * optimize results are kept in an LRU cache (CfCache) keyed on the
+ * ship_config and cargo_manifest text, so repeating a request returns
+ * the stored result without parsing or packing again. Parsed ship
+ * configs are kept as shared templates (CfShipTemplate), so a new
+ * manifest for a known ship skips the config and its table files.
  */
 
 #ifndef SERVER_H
 #define SERVER_H
 
+#include <stddef.h>
+
+/**
+ * ServerOptions - Tuning for cargoforge_serve_opts().
+ */
+typedef struct {
+    int port;                  /* TCP port to listen on */
+    int verbose;               /* print request logs to stderr */
+    int workers;               /* worker threads, 0 = one per CPU */
+    int queue_depth;           /* calls queued or running before 503 */
+    int max_connections;       /* open connections before accept() pauses */
+    int keepalive_timeout_s;   /* idle keep-alive connections closed after */
+    size_t max_request_bytes;  /* largest Content-Length accepted, else 413 */
+    int max_batch;             /* calls per JSON-RPC batch array */
+    size_t cache_bytes;        /* optimize result cache bound, 0 = no cache */
+    int max_templates;         /* parsed ship configs kept for reuse, 0 = none */
+} ServerOptions;
+
+/**
+ * server_options_init - Fill opts with the defaults (port 8080, one worker
+ * per CPU, queue depth 64, 1024 connections, 5 s keep-alive, 64 MiB
+ * request bodies, 256 calls per batch, 64 MiB result cache, 64 ship
+ * templates).
+ */
+void server_options_init(ServerOptions *opts);
+
+/**
+ * Start the JSON-RPC HTTP server with the given options.
+ * Blocks until terminated (SIGINT/SIGTERM); queued requests are finished
+ * before it returns.
+ *
+ * @return 0 on clean shutdown, -1 on error
+ */
+int cargoforge_serve_opts(const ServerOptions *opts);
+
 /**
- * Start the JSON-RPC HTTP server.
+ * Start the JSON-RPC HTTP server with default tuning.
  * Blocks until terminated (SIGINT/SIGTERM).
  *
  * @param port TCP port to listen on
@@ -0,0 +1,102 @@
+/*
+ * spatial_index.h - Uniform-grid spatial index over placed cargo
+ *
+ * Buckets the plan-view (XY) footprint of every placed cargo item into a
+ * uniform grid laid over the ship, so constraint checks only visit items
+ * near a candidate position instead of scanning the whole manifest.
+ *
+ * The index is maintained incrementally by the placement engine: each
+ * committed placement is inserted once, and queries are read-only (safe to
+ * run concurrently from several threads against the same index).
+ */
+
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include "cargoforge.h"
+
+/* Default grid pitch (m). Matches the IMDG "separated from" distance so most
+ * segregation and stacking queries touch a handful of cells. */
+#define SPATIAL_CELL_SIZE 6.0f
+
+/**
+ * SpatialEntry - Footprint of one placed cargo item.
+ */
+typedef struct {
+    float x0, y0, x1, y1;   /* plan-view AABB (m) */
+    int   col0, row0;       /* first grid cell covered (for query dedup) */
+    int   cargo_idx;        /* index into ship->cargo */
+} SpatialEntry;
+
+/**
+ * SpatialCell - Entries whose footprint overlaps one grid cell.
+ */
+typedef struct {
+    int *entries;           /* indices into SpatialIndex.entries */
+    int  count;
+    int  capacity;
+} SpatialCell;
+
+/**
+ * SpatialIndex - Grid of cells plus a flat list of placed DG items.
+ *
+ * dg_items lets the IMDG checks iterate only dangerous goods: the
+ * "incompatible" segregation applies regardless of distance, so it cannot
+ * be answered by a neighbourhood query alone. dg_classes lets a check skip
+ * the list when none of the placed classes needs segregation from its item.
+ */
+typedef struct SpatialIndex_ {
+    float cell_size;
+    int   cols, rows;
+    SpatialCell *cells;
+
+    SpatialEntry *entries;
+    int   entry_count;
+    int   entry_capacity;
+
+    int  *dg_items;         /* cargo indices of placed items with DG info */
+    int   dg_count;
+    int   dg_capacity;
+    unsigned int dg_classes;  /* bit imdg_class_index() of every placed DG item */
+} SpatialIndex;
+
+/**
+ * Visitor for spatial_index_query(). Return non-zero to stop the query.
+ */
+typedef int (*SpatialVisitFn)(int cargo_idx, void *ctx);
+
+/**
+ * spatial_index_create - Allocate an empty index covering length x width.
+ *
+ * @param cell_size Grid pitch in metres (<= 0 selects SPATIAL_CELL_SIZE)
+ * @return new index, or NULL on allocation failure
+ */
+SpatialIndex *spatial_index_create(float length, float width, float cell_size);
+
+/**
+ * spatial_index_destroy - Free an index. Safe to call with NULL.
+ */
+void spatial_index_destroy(SpatialIndex *idx);
+
+/**
+ * spatial_index_insert - Record a placed cargo item.
+ *
+ * Items outside the grid are clamped into the border cells.
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int spatial_index_insert(SpatialIndex *idx, const Cargo *cargo, int cargo_idx);
+
+/**
+ * spatial_index_query - Visit every item whose footprint touches a rectangle.
+ *
+ * Bounds are inclusive, so the visitor sees a superset of strictly
+ * overlapping items and must apply its own exact test. Each item is visited
+ * exactly once, in a deterministic order.
+ *
+ * @return 1 if the visitor stopped the query early, 0 otherwise
+ */
+int spatial_index_query(const SpatialIndex *idx, float x0, float y0,
+                        float x1, float y1, SpatialVisitFn fn, void *ctx);
+
+#endif /* SPATIAL_INDEX_H */
@@ -0,0 +1,85 @@
+/*
+ * stack_grid.h - Plan-view weight grid over placed cargo
+ *
+ * A uniform grid laid over the ship's plan whose cells keep, for every
+ * placed item whose footprint overlaps them, the footprint, the height
+ * the item stands at and its weight, highest item first. The weight
+ * bearing on a rectangle from above some height is then a walk down the
+ * columns of the cells the rectangle covers that stops at the first item
+ * standing lower: a candidate with nothing above it costs one read per
+ * cell, and no lookup ever goes back to the cargo array.
+ *
+ * The placement engine keeps one in Ship.stack_grid for the stack
+ * pressure check, inserting each placement as it is committed; queries
+ * are read-only (safe to run concurrently against the same grid). The
+ * JSON load map builds one from a finished plan.
+ */
+
+#ifndef STACK_GRID_H
+#define STACK_GRID_H
+
+#include "cargoforge.h"
+
+/* Default grid pitch (m): about a container's width, so a query covers a
+ * handful of cells and an item is listed in a handful of columns. */
+#define STACK_CELL_SIZE 3.0f
+
+/**
+ * StackEntry - One placed item, as seen from a cell its footprint overlaps.
+ */
+typedef struct {
+    float x0, y0, x1, y1;   /* plan-view footprint (m) */
+    float z;                /* bottom of the item (m) */
+    float weight_t;         /* item weight (t) */
+    float area;             /* footprint area (m2) */
+    int   col0, row0;       /* first grid cell covered (for query dedup) */
+} StackEntry;
+
+/**
+ * StackCell - Entries of one cell, sorted by z, highest first (ties in
+ * insertion order).
+ */
+typedef struct {
+    StackEntry *entries;
+    int count;
+    int capacity;
+} StackCell;
+
+typedef struct StackGrid_ {
+    float cell_size;
+    int   cols, rows;
+    StackCell *cells;       /* cols * rows, row-major */
+} StackGrid;
+
+/**
+ * stack_grid_create - Allocate an empty grid covering length x width.
+ *
+ * @param cell_size Grid pitch in metres (<= 0 selects STACK_CELL_SIZE)
+ * @return new grid, or NULL on allocation failure
+ */
+StackGrid *stack_grid_create(float length, float width, float cell_size);
+
+/**
+ * stack_grid_destroy - Free a grid. Safe to call with NULL.
+ */
+void stack_grid_destroy(StackGrid *grid);
+
+/**
+ * stack_grid_insert - Record a placed item (footprint dimensions[0] x
+ * dimensions[1] at pos_*). Items with a footprint of 0.01 m2 or less
+ * carry no load and are skipped; items outside the grid are clamped into
+ * the border cells.
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int stack_grid_insert(StackGrid *grid, const Cargo *cargo);
+
+/**
+ * stack_grid_weight - Weight (t) bearing on the rectangle at (x, y) of
+ * w x d from recorded items standing strictly between z_lo and z_hi.
+ * Each item counts with the share of its footprint the rectangle covers.
+ */
+float stack_grid_weight(const StackGrid *grid, float x, float y, float w, float d,
+                        float z_lo, float z_hi);
+
+#endif /* STACK_GRID_H */
@@ -2,17 +2,46 @@
  * tanks.h - Tank configuration and free surface correction
  *
  * Partially filled tanks create free surface effects that reduce
- * effective GM. This module calculates the free surface moment (FSM)
- * and virtual rise in KG for rectangular tanks.
+ * effective GM. This module calculates the tank contents (weight,
+ * vertical moment) and the free surface moment (FSM), and from them the
+ * virtual rise in KG.
+ *
+ * A tank is a rectangular box unless it has a sounding table. The table
+ * is the tank's calibration: at each sounding (depth of liquid above the
+ * tank bottom) the volume, the VCG of the liquid above the keel and the
+ * transverse inertia of its free surface. Contents of a tabled tank are
+ * interpolated from it by volume, so non-prismatic tanks (wing, hopper,
+ * fore peak) are as exact as their tables.
+ *
+ * CSV syntax, one tank per line:
+ *
+ *   id,length_m,breadth_m,height_m,pos_x_m,pos_y_m,pos_z_m,fill_fraction,density_t_m3
+ *
+ * and for a sounding table, one point per line after the tank's own line,
+ * in increasing sounding:
+ *
+ *   sounding,id,sounding_m,volume_m3,vcg_m,inertia_m4
  */
 
 #ifndef TANKS_H
 #define TANKS_H
 
-#define MAX_TANKS 50
+/**
+ * TankSoundingPoint - One row of a tank's sounding table.
+ */
+typedef struct {
+    float sounding;       /* liquid depth above the tank bottom (m) */
+    float volume;         /* liquid volume (m3), non-decreasing */
+    float vcg;            /* VCG of the liquid above keel (m) */
+    float inertia;        /* transverse free surface inertia (m4) */
+} TankSoundingPoint;
 
 /**
  * Tank - A single liquid tank on the vessel.
+ *
+ * With a sounding table, fill_fraction is the share of the table's last
+ * volume, and length and breadth only describe the envelope; height is
+ * still the top of the tank for ullages.
  */
 typedef struct {
     char  id[32];
@@ -24,30 +53,141 @@ typedef struct {
     float pos_z;          /* vertical position of tank bottom above keel (m) */
     float fill_fraction;  /* 0.0 to 1.0 */
     float density;        /* liquid density (t/m3): seawater=1.025, FO=0.95, FW=1.0 */
+    TankSoundingPoint *table;  /* sounding table, NULL = rectangular */
+    int   table_count;
+    int   table_capacity;
 } Tank;
 
 /**
- * TankConfig - Collection of all tanks on the vessel.
+ * TankConfig - Collection of all tanks on the vessel. Owns the tanks'
+ * sounding tables.
  */
 typedef struct TankConfig_ {
-    Tank tanks[MAX_TANKS];
+    Tank *tanks;
     int count;
+    int capacity;
 } TankConfig;
 
 /**
- * parse_tank_config - Parse a CSV tank configuration file.
+ * TankTotals - Contents of a set of tanks at some fill levels.
+ */
+typedef struct {
+    float weight_t;       /* liquid weight (t) */
+    float vmoment_t;      /* vertical moment about the keel (t-m) */
+    float fsm;            /* free surface moment of partly filled tanks (t-m) */
+} TankTotals;
+
+/**
+ * TankColumns - The fill-independent part of every tank of a config, by
+ * column, for evaluating many fill vectors against one config in a single
+ * contiguous pass (tank_columns_sum). Borrows the config's tables: valid
+ * while the config is unchanged.
+ */
+typedef struct {
+    int   count;
+    float *volume;        /* l * b * h, or the table's capacity (m3) */
+    float *density;
+    float *pos_z;
+    float *height;
+    float *fsm;           /* rho * l * b^3 / 12 (rectangular tanks) */
+    const Tank **tabled;  /* the tank when it has a table, else NULL */
+} TankColumns;
+
+/**
+ * tank_config_add - Append a tank (copied). A table the tank carries is
+ * taken over by the config.
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int tank_config_add(TankConfig *config, const Tank *tank);
+
+/**
+ * tank_config_find - Index of the tank called id, or -1.
+ */
+int tank_config_find(const TankConfig *config, const char *id);
+
+/**
+ * tank_add_sounding - Append a point to a tank's sounding table.
+ *
+ * Soundings must increase and volumes must not decrease from the point
+ * before; values must be finite and non-negative.
+ *
+ * @return 0 on success, -1 on an out-of-order point or allocation failure
+ */
+int tank_add_sounding(Tank *tank, const TankSoundingPoint *point);
+
+/**
+ * tank_config_copy - Deep copy of src, tables included, into an empty dst.
+ *
+ * @return 0 on success, -1 on allocation failure (dst is left empty)
+ */
+int tank_config_copy(TankConfig *dst, const TankConfig *src);
+
+/**
+ * tank_config_free - Release a config's storage (not the struct itself).
+ */
+void tank_config_free(TankConfig *config);
+
+/**
+ * parse_tank_config - Parse a CSV tank configuration file into config
+ * (overwritten: it must not own tanks yet).
  *
  * Expected columns:
  *   id, length_m, breadth_m, height_m, pos_x_m, pos_y_m, pos_z_m, fill_fraction, density_t_m3
+ * plus "sounding," rows for sounding tables (see above). A table must
+ * have at least two points.
  *
- * @return 0 on success, -1 on error
+ * @return 0 on success, -1 on error (config is left empty)
  */
 int parse_tank_config(const char *filename, TankConfig *config);
 
 /**
- * calculate_free_surface_moment - FSM for a single rectangular tank.
+ * tank_capacity - Volume of the full tank (m3).
+ */
+float tank_capacity(const Tank *tank);
+
+/**
+ * tank_fill_at_sounding - Fill fraction of a tank sounded at sounding_m
+ * (clamped to the tank). tank_fill_at_ullage takes the distance from the
+ * tank top (pos_z + height) down to the liquid instead.
+ */
+float tank_fill_at_sounding(const Tank *tank, float sounding_m);
+float tank_fill_at_ullage(const Tank *tank, float ullage_m);
+
+/**
+ * tank_contents - Weight, vertical moment and FSM of one tank at fill.
+ */
+void tank_contents(const Tank *tank, float fill, TankTotals *out);
+
+/**
+ * tank_config_totals - Contents of all tanks at their own fill levels, in
+ * one pass.
+ */
+void tank_config_totals(const TankConfig *config, TankTotals *out);
+
+/**
+ * tank_columns_init - Build the column form of config (NULL = no tanks).
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int tank_columns_init(TankColumns *cols, const TankConfig *config);
+
+/**
+ * tank_columns_free - Release the columns. Safe on a zeroed struct.
+ */
+void tank_columns_free(TankColumns *cols);
+
+/**
+ * tank_columns_sum - Contents of all tanks at fill[0..count-1], in one
+ * pass. Bit-identical to tank_config_totals at the same fills.
+ */
+void tank_columns_sum(const TankColumns *cols, const float *fill, TankTotals *out);
+
+/**
+ * calculate_free_surface_moment - FSM for a single tank.
  *
- * For a rectangular tank: FSM = rho * l * b^3 / 12
+ * For a rectangular tank: FSM = rho * l * b^3 / 12; a tabled tank uses
+ * rho * inertia at its fill.
  * Only applies to partially filled tanks (0 < fill < 1).
  * Full and empty tanks have no free surface effect.
  *
@@ -77,7 +217,7 @@ float calculate_virtual_kg_rise(const TankConfig *config, float displacement_t);
 float calculate_tank_weight(const TankConfig *config);
 
 /**
- * calculate_tank_moment - Vertical moment of tank contents about keel.
+ * calculate_tank_vertical_moment - Vertical moment of tank contents about keel.
  *
  * @return moment in t-m
  */
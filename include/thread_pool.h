@@ -0,0 +1,63 @@
+/*
+ * thread_pool.h - Fixed-size worker thread pool
+ *
+ * A small pthread pool shared by the parallel parts of the engine. Work is
+ * either submitted as independent tasks (FIFO) or run as a blocking
+ * parallel-for over an index range, where the calling thread takes part
+ * in the work instead of idling.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+typedef struct ThreadPool_ ThreadPool;
+
+/** Task run by a worker thread. */
+typedef void (*ThreadPoolFn)(void *arg);
+
+/** Body of a parallel-for: called once for every index in [0, n). */
+typedef void (*ThreadPoolRangeFn)(void *ctx, int index);
+
+/**
+ * thread_pool_cpu_count - Number of online CPUs (at least 1).
+ */
+int thread_pool_cpu_count(void);
+
+/**
+ * thread_pool_create - Start a pool of worker threads.
+ *
+ * @param nthreads Worker count (<= 0 selects thread_pool_cpu_count())
+ * @return new pool, or NULL if no thread could be started
+ */
+ThreadPool *thread_pool_create(int nthreads);
+
+/**
+ * thread_pool_destroy - Run all queued tasks, then join and free the pool.
+ * Safe to call with NULL.
+ */
+void thread_pool_destroy(ThreadPool *pool);
+
+/**
+ * thread_pool_size - Number of worker threads in the pool.
+ */
+int thread_pool_size(const ThreadPool *pool);
+
+/**
+ * thread_pool_submit - Queue fn(arg) for execution on a worker.
+ *
+ * @return 0 on success, -1 on allocation failure or shutdown
+ */
+int thread_pool_submit(ThreadPool *pool, ThreadPoolFn fn, void *arg);
+
+/**
+ * thread_pool_parallel_for - Call fn(ctx, i) for every i in [0, n), return
+ * once all calls have finished.
+ *
+ * Indices are handed out dynamically, so calls run in no particular order
+ * and fn must only write state owned by its index. The caller participates,
+ * which makes it safe to call from inside a pool task, and a NULL pool runs
+ * the loop serially on the calling thread.
+ */
+void thread_pool_parallel_for(ThreadPool *pool, int n, ThreadPoolRangeFn fn, void *ctx);
+
+#endif /* THREAD_POOL_H */
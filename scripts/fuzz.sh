@@ -21,7 +21,7 @@ mkdir -p build
 if [ ! -x "$SAN" ]; then
     echo "Building sanitized binary ($SAN)..."
     cc -O1 -g -std=c99 -D_POSIX_C_SOURCE=200809L -Iinclude \
-       -fsanitize=address,undefined -fno-omit-frame-pointer src/*.c -lm -o "$SAN" || exit 1
+       -fsanitize=address,undefined -fno-omit-frame-pointer src/*.c -lm -pthread -o "$SAN" || exit 1
 fi
 export ASAN_OPTIONS="abort_on_error=1"
 export UBSAN_OPTIONS="halt_on_error=1:abort_on_error=1:print_stacktrace=1"
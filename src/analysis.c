@@ -12,10 +12,13 @@
  * - IMO intact stability criteria (MSC.267/85 Part A, Ch 2.2)
  */
 #include <math.h>
+#include <pthread.h>
 #include "cargoforge.h"
 #include "hydrostatics.h"
 #include "tanks.h"
 #include "longitudinal_strength.h"
+#include "holds.h"
+#include "thread_pool.h"
 
 /* Physical constants */
 #define SEAWATER_DENSITY    1.025f  /* t/m3 at 15C */
@@ -35,126 +38,166 @@
 #define M_PI 3.14159265358979323846
 #endif
 
-/**
- * Wall-sided formula for GZ at angle theta.
- * GZ(theta) = sin(theta) * [GM + BM * tan^2(theta) / 2]
+/*
+ * GZ curve. The wall-sided formula
+ *   GZ(theta) = sin(theta) * [GM + BM * tan^2(theta) / 2]
+ * is valid for moderate angles (<~40 deg) and wall-sided hull forms, the
+ * industry-standard approximation for initial stability assessment.
  *
- * Valid for moderate angles (<~40 deg) and wall-sided hull forms.
- * Industry-standard approximation for initial stability assessment.
+ * The curve is sampled every degree into AnalysisResult.gz_curve from a
+ * shared sin/tan table, so a condition costs GZ_CURVE_POINTS multiply-adds
+ * rather than trig calls. The IMO areas come from the formula's integral,
+ *   int GZ dtheta = -GM cos(theta) + BM / 2 * (sec(theta) + cos(theta)),
+ * counting only the restoring (GZ > 0) part of the curve.
  */
-static float gz_at_angle(float gm, float bm, float theta_deg) {
-    float theta = theta_deg * (float)M_PI / 180.0f;
-    float tan_theta = tanf(theta);
-    return sinf(theta) * (gm + bm * tan_theta * tan_theta / 2.0f);
+static float gz_sin[GZ_CURVE_POINTS];
+static float gz_tan[GZ_CURVE_POINTS];
+static pthread_once_t gz_table_once = PTHREAD_ONCE_INIT;
+
+static void gz_table_init(void) {
+    for (int k = 0; k < GZ_CURVE_POINTS; k++) {
+        float theta = (float)k * (float)M_PI / 180.0f;
+        gz_sin[k] = sinf(theta);
+        gz_tan[k] = tanf(theta);
+    }
+}
+
+static void gz_curve_fill(float gm, float bm, float *curve) {
+    pthread_once(&gz_table_once, gz_table_init);
+    for (int k = 0; k < GZ_CURVE_POINTS; k++)
+        curve[k] = gz_sin[k] * (gm + bm * gz_tan[k] * gz_tan[k] / 2.0f);
+}
+
+static double gz_primitive(double gm, double bm, double theta) {
+    double c = cos(theta);
+    return -gm * c + bm * 0.5 * (1.0 / c + c);
 }
 
 /**
- * Integrate GZ curve from angle_start to angle_end using trapezoidal rule.
- * Result in m-rad (GZ in meters, angles in radians).
+ * Areas under the positive part of the curve (m-rad). With GM < 0 the
+ * curve is negative up to tan^2(theta) = -2 GM / BM, so each interval
+ * starts no lower than that angle.
  */
-static float integrate_gz(float gm, float bm, float start_deg, float end_deg) {
-    int steps = 100;
-    float step = (end_deg - start_deg) / steps;
-    float area = 0.0f;
-
-    for (int i = 0; i < steps; i++) {
-        float a1 = start_deg + i * step;
-        float a2 = a1 + step;
-        float gz1 = gz_at_angle(gm, bm, a1);
-        float gz2 = gz_at_angle(gm, bm, a2);
-        /* Only count positive GZ (restoring moment) */
-        if (gz1 < 0) gz1 = 0;
-        if (gz2 < 0) gz2 = 0;
-        float da = step * (float)M_PI / 180.0f;
-        area += (gz1 + gz2) * 0.5f * da;
+static void gz_areas(float gm, float bm, AnalysisResult *r) {
+    const double deg = M_PI / 180.0;
+    double start = 0.0;
+    if (gm < 0.0f) {
+        if (bm <= 0.0f) return;                    /* never restoring */
+        start = atan(sqrt(-2.0 * gm / bm));
     }
-    return area;
+    double f0  = gz_primitive(gm, bm, fmax(0.0, start));
+    double f30 = gz_primitive(gm, bm, fmax(30.0 * deg, start));
+    double f40 = gz_primitive(gm, bm, fmax(40.0 * deg, start));
+    r->area_0_30  = (float)(f30 - f0);
+    r->area_0_40  = (float)(f40 - f0);
+    r->area_30_40 = (float)(f40 - f30);
 }
 
 /**
- * Find angle of maximum GZ by scanning 1-degree increments.
+ * Add or subtract one item's weight and moments (no-op when unplaced).
  */
-static void find_gz_max(float gm, float bm, float *max_gz, float *max_angle) {
-    *max_gz = 0.0f;
-    *max_angle = 0.0f;
-    for (float a = 1.0f; a <= 80.0f; a += 1.0f) {
-        float gz = gz_at_angle(gm, bm, a);
-        if (gz > *max_gz) {
-            *max_gz = gz;
-            *max_angle = a;
-        }
-    }
+static void moments_apply(CargoMoments *m, const Cargo *c, double sign) {
+    if (!CARGO_IS_PLACED(c)) return;
+
+    double w  = c->weight;
+    double cx = c->pos_x + c->dimensions[0] / 2.0f;
+    double cy = c->pos_y + c->dimensions[1] / 2.0f;
+    double cz = c->pos_z + c->dimensions[2] / 2.0f;
+
+    m->placed_count += (sign > 0) ? 1 : -1;
+    m->weight   += sign * w;
+    m->moment_x += sign * w * cx;
+    m->moment_y += sign * w * cy;
+    m->moment_z += sign * w * cz;
 }
 
-AnalysisResult perform_analysis(const Ship *ship) {
-    AnalysisResult r;
-    memset(&r, 0, sizeof(r));
-    r.cg.perc_x = 50.0f;
-    r.cg.perc_y = 50.0f;
-    r.strength_compliant = -1; /* not checked by default */
-
-    /* --- Single-pass cargo accumulation --- */
-    float moment_x = 0.0f;
-    float moment_y = 0.0f;
-    float vertical_moment = ship->lightship_weight * ship->lightship_kg;
-    float lcg_moment = 0.0f; /* moment about midship */
-
-    for (int i = 0; i < ship->cargo_count; i++) {
-        const Cargo *c = &ship->cargo[i];
-        if (c->pos_x < 0) continue;
+void cargo_moments_add(CargoMoments *m, const Cargo *c) {
+    moments_apply(m, c, 1.0);
+}
 
-        r.placed_item_count++;
-        r.total_cargo_weight_kg += c->weight;
+void cargo_moments_remove(CargoMoments *m, const Cargo *c) {
+    moments_apply(m, c, -1.0);
+}
 
-        float cx = c->pos_x + c->dimensions[0] / 2.0f;
-        float cy = c->pos_y + c->dimensions[1] / 2.0f;
-        float cz = c->pos_z + c->dimensions[2] / 2.0f;
+void cargo_moments_compute(const Ship *ship, CargoMoments *m) {
+    memset(m, 0, sizeof(*m));
+    for (int i = 0; i < ship->cargo_count; i++)
+        moments_apply(m, &ship->cargo[i], 1.0);
+}
 
-        moment_x += c->weight * cx;
-        moment_y += c->weight * cy;
-        vertical_moment += c->weight * cz;
-        lcg_moment += c->weight * (cx - ship->length / 2.0f);
-    }
+AnalysisResult perform_analysis(const Ship *ship) {
+    CargoMoments m;
+    cargo_moments_compute(ship, &m);
+    return perform_analysis_moments(ship, &m);
+}
 
-    float displacement_kg = ship->lightship_weight + r.total_cargo_weight_kg;
+/**
+ * TankSums - What the analysis needs from the tank contents: their weight,
+ * vertical moment and free surface moment.
+ */
+typedef struct {
+    int   present;    /* ship has tanks */
+    float weight_t;   /* liquid weight (t) */
+    float vmoment_t;  /* vertical moment about the keel (t-m) */
+    float fsm;        /* free surface moment of partly filled tanks (t-m) */
+} TankSums;
+
+static void tank_sums_compute(const Ship *ship, TankSums *t) {
+    memset(t, 0, sizeof(*t));
+    if (!ship->tanks || ship->tanks->count <= 0) return;
+
+    TankTotals c;
+    tank_config_totals(ship->tanks, &c);
+    t->present   = 1;
+    t->weight_t  = c.weight_t;
+    t->vmoment_t = c.vmoment_t;
+    t->fsm       = c.fsm;
+}
 
-    /* Include tank weight in displacement if tanks are loaded */
-    float tank_weight_t = 0.0f;
-    if (ship->tanks && ship->tanks->count > 0) {
-        tank_weight_t = calculate_tank_weight(ship->tanks);
-        displacement_kg += tank_weight_t * 1000.0f;
-        vertical_moment += calculate_tank_vertical_moment(ship->tanks) * 1000.0f;
-    }
+static AnalysisResult analyse(const Ship *ship, const CargoMoments *m, const TankSums *tanks,
+                              const StrengthModel *strength, unsigned int stages);
 
-    /* Overweight check */
-    if (displacement_kg > ship->max_weight) {
-        r.gm = NAN;
-        return r;
-    }
+AnalysisResult perform_analysis_moments(const Ship *ship, const CargoMoments *m) {
+    return perform_analysis_stages(ship, m, ANALYSIS_ALL);
+}
 
-    /* --- CG as percentage of ship dimensions --- */
-    if (r.total_cargo_weight_kg > 0.01f) {
-        r.cg.perc_x = (moment_x / r.total_cargo_weight_kg) / ship->length * 100.0f;
-        r.cg.perc_y = (moment_y / r.total_cargo_weight_kg) / ship->width * 100.0f;
-    }
+AnalysisResult perform_analysis_stages(const Ship *ship, const CargoMoments *m,
+                                       unsigned int stages) {
+    TankSums t;
+    tank_sums_compute(ship, &t);
+    return analyse(ship, m, &t, NULL, stages);
+}
 
+/**
+ * Hydrostatics through IMO criteria for a condition that is within the
+ * ship's capacity. vertical_moment is about the keel and lcg_moment about
+ * midship, both in kg-m including the tanks.
+ */
+static void analyse_stability(const Ship *ship, const TankSums *tanks, float displacement_kg,
+                              float vertical_moment, float lcg_moment, float moment_y,
+                              AnalysisResult *r) {
     /* --- Hydrostatics --- */
     float displacement_t = displacement_kg / 1000.0f;
     float displaced_vol = displacement_t / SEAWATER_DENSITY;
     float bm_l = 0.0f; /* longitudinal BM, computed below */
 
-    r.kg = vertical_moment / displacement_kg;
+    r->kg = vertical_moment / displacement_kg;
 
-    if (ship->hydro && ship->hydro->loaded) {
-        /* ---- Table-based hydrostatics ---- */
-        r.hydro_table_used = 1;
-        r.draft = hydro_draft_from_displacement(ship->hydro, displacement_t);
+    /* The table lookups refuse a table that was never indexed; the box
+     * hull below covers that case as well as a missing table. */
+    HydroEntry he;
+    float table_draft = -1.0f;
+    if (ship->hydro && ship->hydro->loaded)
+        table_draft = hydro_draft_from_displacement(ship->hydro, displacement_t);
 
-        HydroEntry he;
-        hydro_interpolate(ship->hydro, r.draft, &he);
+    if (table_draft >= 0.0f &&
+        hydro_interpolate(ship->hydro, table_draft, &he) == 0) {
+        /* ---- Table-based hydrostatics ---- */
+        r->hydro_table_used = 1;
+        r->draft = table_draft;
 
-        r.kb = he.kb;
-        r.bm = he.bm;
+        r->kb = he.kb;
+        r->bm = he.bm;
 
         /* Use MTC from table for trim calculation */
         if (he.mtc > 0.01f) {
@@ -168,13 +211,13 @@ AnalysisResult perform_analysis(const Ship *ship) {
         }
     } else {
         /* ---- Legacy box-hull fallback ---- */
-        r.hydro_table_used = 0;
-        r.draft = displaced_vol / (ship->length * ship->width * BLOCK_COEFF);
-        r.kb = KB_FACTOR * r.draft;
+        r->hydro_table_used = 0;
+        r->draft = displaced_vol / (ship->length * ship->width * BLOCK_COEFF);
+        r->kb = KB_FACTOR * r->draft;
 
         /* BM: transverse metacentric radius = I_T / V */
         float inertia_t = (ship->length * powf(ship->width, 3) / 12.0f) * WATERPLANE_COEFF;
-        r.bm = inertia_t / displaced_vol;
+        r->bm = inertia_t / displaced_vol;
 
         /* Longitudinal BM */
         float inertia_l = (ship->width * powf(ship->length, 3) / 12.0f) * WATERPLANE_COEFF;
@@ -182,65 +225,382 @@ AnalysisResult perform_analysis(const Ship *ship) {
     }
 
     /* GM before free surface correction */
-    r.gm = r.kb + r.bm - r.kg;
+    r->gm = r->kb + r->bm - r->kg;
 
     /* --- Free Surface Correction --- */
-    r.free_surface_correction = 0.0f;
-    if (ship->tanks && ship->tanks->count > 0) {
-        r.free_surface_correction = calculate_virtual_kg_rise(ship->tanks, displacement_t);
+    r->free_surface_correction = 0.0f;
+    if (tanks->present && displacement_t >= 0.01f) {
+        r->free_surface_correction = tanks->fsm / displacement_t;
     }
-    r.gm_corrected = r.gm - r.free_surface_correction;
+    r->gm_corrected = r->gm - r->free_surface_correction;
 
     /* Use corrected GM for all subsequent calculations */
-    float gm_effective = r.gm_corrected;
+    float gm_effective = r->gm_corrected;
 
     /* --- Trim --- */
-    r.lcg = lcg_moment / displacement_kg;
-    float gm_l = r.kb + bm_l - r.kg;
+    r->lcg = lcg_moment / displacement_kg;
+    float gm_l = r->kb + bm_l - r->kg;
 
     if (gm_l > 0.01f)
-        r.trim = r.lcg * ship->length / gm_l;
+        r->trim = r->lcg * ship->length / gm_l;
 
     /* --- Heel --- */
     float tcg = 0.0f;
-    if (r.total_cargo_weight_kg > 0.01f) {
-        float avg_y = moment_y / r.total_cargo_weight_kg;
+    if (r->total_cargo_weight_kg > 0.01f) {
+        float avg_y = moment_y / r->total_cargo_weight_kg;
         tcg = avg_y - ship->width / 2.0f;
     }
     if (gm_effective > 0.01f)
-        r.heel = atanf(tcg / gm_effective) * 180.0f / (float)M_PI;
+        r->heel = atanf(tcg / gm_effective) * 180.0f / (float)M_PI;
 
     /* --- IMO GZ curve analysis (using corrected GM) --- */
-    r.gz_at_30 = gz_at_angle(gm_effective, r.bm, 30.0f);
-    find_gz_max(gm_effective, r.bm, &r.gz_max, &r.gz_max_angle);
-
-    r.area_0_30  = integrate_gz(gm_effective, r.bm, 0.0f, 30.0f);
-    r.area_0_40  = integrate_gz(gm_effective, r.bm, 0.0f, 40.0f);
-    r.area_30_40 = integrate_gz(gm_effective, r.bm, 30.0f, 40.0f);
+    gz_curve_fill(gm_effective, r->bm, r->gz_curve);
+    r->gz_at_30 = r->gz_curve[30];
+    for (int k = 1; k < GZ_CURVE_POINTS; k++) {
+        if (r->gz_curve[k] > r->gz_max) {
+            r->gz_max = r->gz_curve[k];
+            r->gz_max_angle = (float)k;
+        }
+    }
+    gz_areas(gm_effective, r->bm, r);
 
-    r.imo_compliant = (
+    r->imo_compliant = (
         gm_effective   >= IMO_GM_MIN &&
-        r.gz_at_30     >= IMO_GZ_AT_30_MIN &&
-        r.gz_max_angle >= IMO_GZ_MAX_ANGLE &&
-        r.area_0_30    >= IMO_AREA_0_30_MIN &&
-        r.area_0_40    >= IMO_AREA_0_40_MIN &&
-        r.area_30_40   >= IMO_AREA_30_40_MIN
+        r->gz_at_30     >= IMO_GZ_AT_30_MIN &&
+        r->gz_max_angle >= IMO_GZ_MAX_ANGLE &&
+        r->area_0_30    >= IMO_AREA_0_30_MIN &&
+        r->area_0_40    >= IMO_AREA_0_40_MIN &&
+        r->area_30_40   >= IMO_AREA_30_40_MIN
     ) ? 1 : 0;
+}
 
-    /* --- Longitudinal Strength --- */
+/**
+ * With strength limits set, strength is a prebuilt model for this plan
+ * (shared by batch conditions), or NULL to build one for the call.
+ */
+static void analyse_strength(const Ship *ship, const StrengthModel *strength,
+                             float displacement_t, AnalysisResult *r) {
     if (ship->strength_limits) {
-        LongStrengthResult ls = calculate_longitudinal_strength(
-            ship, r.draft, displacement_t, ship->length, ship->width);
+        StrengthModel own;
+        if (!strength && strength_model_init(&own, ship, ship->strength_limits->stations) == 0)
+            strength = &own;
+
+        /* Left unchecked (-1) if the model could not be allocated */
+        if (strength) {
+            StrengthSummary ls;
+            strength_model_solve(strength, displacement_t, &ls, NULL);
+
+            r->max_shear_force = ls.max_shear_force;
+            r->max_bending_moment = (ls.max_bm_hog > ls.max_bm_sag)
+                                   ? ls.max_bm_hog : ls.max_bm_sag;
+            r->strength_compliant = check_strength_summary(&ls, ship->strength_limits);
+        }
+        if (strength == &own) strength_model_free(&own);
+    }
+}
+
+static AnalysisResult analyse(const Ship *ship, const CargoMoments *m, const TankSums *tanks,
+                              const StrengthModel *strength, unsigned int stages) {
+    AnalysisResult r;
+    memset(&r, 0, sizeof(r));
+    r.cg.perc_x = 50.0f;
+    r.cg.perc_y = 50.0f;
+    r.strength_compliant = -1; /* not checked by default */
+
+    /* --- Cargo sums (from the caller's running totals) --- */
+    r.placed_item_count = m->placed_count;
+    r.total_cargo_weight_kg = (float)m->weight;
+
+    float moment_x = (float)m->moment_x;
+    float moment_y = (float)m->moment_y;
+    float vertical_moment = (float)(ship->lightship_weight * (double)ship->lightship_kg + m->moment_z);
+    float lcg_moment = (float)(m->moment_x - m->weight * (ship->length / 2.0f)); /* about midship */
+
+    float displacement_kg = ship->lightship_weight + r.total_cargo_weight_kg;
 
-        r.max_shear_force = ls.max_shear_force;
-        r.max_bending_moment = (ls.max_bm_hog > ls.max_bm_sag)
-                               ? ls.max_bm_hog : ls.max_bm_sag;
-        r.strength_compliant = check_strength_limits(&ls, ship->strength_limits);
+    /* Include tank weight in displacement if tanks are loaded */
+    if (tanks->present) {
+        displacement_kg += tanks->weight_t * 1000.0f;
+        vertical_moment += tanks->vmoment_t * 1000.0f;
     }
 
+    /* Overweight check */
+    if (displacement_kg > ship->max_weight) {
+        r.gm = NAN;
+        return r;
+    }
+
+    /* --- CG as percentage of ship dimensions --- */
+    if (r.total_cargo_weight_kg > 0.01f) {
+        r.cg.perc_x = (moment_x / r.total_cargo_weight_kg) / ship->length * 100.0f;
+        r.cg.perc_y = (moment_y / r.total_cargo_weight_kg) / ship->width * 100.0f;
+    }
+
+    if (stages & ANALYSIS_STABILITY)
+        analyse_stability(ship, tanks, displacement_kg, vertical_moment, lcg_moment,
+                          moment_y, &r);
+    if (stages & ANALYSIS_STRENGTH)
+        analyse_strength(ship, strength, displacement_kg / 1000.0f, &r);
     return r;
 }
 
+/* ------------------------------------------------------------------ */
+/* Batched what-if conditions                                         */
+/* ------------------------------------------------------------------ */
+
+/* Conditions per parallel-for index */
+#define BATCH_CHUNK 32
+
+static void tank_sums_fill(const TankColumns *c, const float *fill, TankSums *t) {
+    TankTotals sum;
+    tank_columns_sum(c, fill, &sum);
+    t->present   = c->count > 0;
+    t->weight_t  = sum.weight_t;
+    t->vmoment_t = sum.vmoment_t;
+    t->fsm       = sum.fsm;
+}
+
+typedef struct {
+    const Ship          *ship;
+    const LoadCondition *conds;
+    AnalysisResult      *out;
+    int                  count;
+    CargoMoments         moments;   /* placed cargo, shared by every condition */
+    TankSums             tanks;     /* the ship's own fills */
+    TankColumns          columns;   /* for the conditions' own fills */
+    const StrengthModel *strength;  /* weight curve of the plan, or NULL */
+} BatchCtx;
+
+/* Solve a weighted condition on a copy of the plan's curve with the
+ * deltas added; dist and scratch hold station_count values */
+static void batch_strength(const BatchCtx *b, const LoadCondition *c, double *dist,
+                           float *scratch, StrengthModel *own) {
+    const StrengthModel *m = b->strength;
+    for (int s = 0; s < m->station_count; s++) dist[s] = m->weight_dist[s];
+    for (int k = 0; k < c->weight_count; k++)
+        strength_model_add_weight(m, c->weights[k].weight_kg / 1000.0f, c->weights[k].x, dist);
+    for (int s = 0; s < m->station_count; s++) scratch[s] = (float)dist[s];
+
+    *own = *m;
+    own->weight_dist = scratch;
+}
+
+static void batch_chunk(void *arg, int chunk) {
+    const BatchCtx *b = arg;
+    int end = (chunk + 1) * BATCH_CHUNK;
+    if (end > b->count) end = b->count;
+    double *dist = NULL;
+    float *scratch = NULL;
+
+    for (int i = chunk * BATCH_CHUNK; i < end; i++) {
+        const LoadCondition *c = &b->conds[i];
+
+        CargoMoments m = b->moments;
+        for (int k = 0; k < c->weight_count; k++) {
+            const WeightDelta *d = &c->weights[k];
+            double w = d->weight_kg;
+            m.weight   += w;
+            m.moment_x += w * d->x;
+            m.moment_y += w * d->y;
+            m.moment_z += w * d->z;
+        }
+
+        TankSums t = b->tanks;
+        if (c->tank_fill) tank_sums_fill(&b->columns, c->tank_fill, &t);
+
+        /* Tank-only conditions share the plan's curve */
+        const StrengthModel *strength = b->strength;
+        unsigned int stages = ANALYSIS_ALL;
+        StrengthModel own;
+        if (strength && c->weight_count > 0) {
+            if (!dist) {
+                dist = malloc((size_t)strength->station_count * sizeof(*dist));
+                scratch = malloc((size_t)strength->station_count * sizeof(*scratch));
+            }
+            if (dist && scratch) {
+                batch_strength(b, c, dist, scratch, &own);
+                strength = &own;
+            } else {
+                stages = ANALYSIS_STABILITY;  /* strength left unchecked (-1) */
+            }
+        }
+
+        b->out[i] = analyse(b->ship, &m, &t, strength, stages);
+    }
+    free(dist);
+    free(scratch);
+}
+
+int perform_analysis_batch(const Ship *ship, const LoadCondition *conds, int count,
+                           AnalysisResult *out, struct ThreadPool_ *pool) {
+    if (!ship || count < 0 || (count > 0 && (!conds || !out))) return -1;
+
+    int has_tanks = ship->tanks && ship->tanks->count > 0;
+    for (int i = 0; i < count; i++) {
+        if (conds[i].tank_fill && !has_tanks) return -1;
+        if (conds[i].weight_count < 0 || (conds[i].weight_count > 0 && !conds[i].weights))
+            return -1;
+    }
+
+    BatchCtx b;
+    b.ship = ship;
+    b.conds = conds;
+    b.out = out;
+    b.count = count;
+    cargo_moments_compute(ship, &b.moments);
+    tank_sums_compute(ship, &b.tanks);
+    if (tank_columns_init(&b.columns, has_tanks ? ship->tanks : NULL) != 0) return -1;
+
+    /* The plan's weight curve, built once; weighted conditions copy it */
+    StrengthModel strength;
+    b.strength = NULL;
+    if (ship->strength_limits &&
+        strength_model_init(&strength, ship, ship->strength_limits->stations) == 0)
+        b.strength = &strength;
+
+    int chunks = (count + BATCH_CHUNK - 1) / BATCH_CHUNK;
+    thread_pool_parallel_for(chunks > 1 ? pool : NULL, chunks, batch_chunk, &b);
+
+    if (b.strength) strength_model_free(&strength);
+    tank_columns_free(&b.columns);
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* Load sequences                                                     */
+/* ------------------------------------------------------------------ */
+
+/* Item states while a sequence is checked */
+#define SEQ_UNMOVED  0
+#define SEQ_ASHORE   1
+#define SEQ_ABOARD   2
+
+/**
+ * Check every move and find the items on board before the first one.
+ * Fills aboard[0..cargo_count) with 1 for those items.
+ */
+static int sequence_initial(const Ship *ship, const SequenceMove *moves, int count,
+                            unsigned char *aboard) {
+    memset(aboard, SEQ_UNMOVED, (size_t)ship->cargo_count);
+    for (int k = 0; k < count; k++) {
+        int i = moves[k].cargo, op = moves[k].op;
+        if (i < 0 || i >= ship->cargo_count || !CARGO_IS_PLACED(&ship->cargo[i])) return -1;
+        if (op != SEQ_LOAD && op != SEQ_DISCHARGE) return -1;
+
+        unsigned char want = (op == SEQ_LOAD) ? SEQ_ASHORE : SEQ_ABOARD;
+        if (aboard[i] == SEQ_UNMOVED) aboard[i] = want;
+        if (aboard[i] != want) return -1;
+        aboard[i] = (op == SEQ_LOAD) ? SEQ_ABOARD : SEQ_ASHORE;
+    }
+
+    /* Walk back to each moved item's state before its first move */
+    for (int k = count - 1; k >= 0; k--) {
+        int i = moves[k].cargo;
+        aboard[i] = (moves[k].op == SEQ_LOAD) ? SEQ_ASHORE : SEQ_ABOARD;
+    }
+    for (int i = 0; i < ship->cargo_count; i++) {
+        if (aboard[i] == SEQ_UNMOVED)
+            aboard[i] = CARGO_IS_PLACED(&ship->cargo[i]) ? 1 : 0;
+        else
+            aboard[i] = (aboard[i] == SEQ_ABOARD);
+    }
+    return 0;
+}
+
+typedef struct {
+    const Ship    *ship;
+    CargoMoments   moments;
+    TankSums       tanks;
+    StrengthModel  strength;   /* lightship curve; weight_dist is refreshed per step */
+    double        *dist;       /* running weight curve, lightship + cargo on board (t/m) */
+    int            has_strength;
+} SequenceState;
+
+static void sequence_apply(SequenceState *st, const Cargo *c, double sign) {
+    if (sign > 0) cargo_moments_add(&st->moments, c);
+    else cargo_moments_remove(&st->moments, c);
+    if (st->has_strength) strength_model_add_cargo(&st->strength, c, sign, st->dist);
+}
+
+static void sequence_record(SequenceState *st, int cargo, int op, SequenceStep *out) {
+    const Ship *ship = st->ship;
+    if (st->has_strength) {
+        for (int s = 0; s < st->strength.station_count; s++)
+            st->strength.weight_dist[s] = (float)st->dist[s];
+    }
+    AnalysisResult r = analyse(ship, &st->moments, &st->tanks,
+                               st->has_strength ? &st->strength : NULL, ANALYSIS_ALL);
+
+    float displacement_kg = ship->lightship_weight + r.total_cargo_weight_kg;
+    if (st->tanks.present) displacement_kg += st->tanks.weight_t * 1000.0f;
+
+    memset(out, 0, sizeof(*out));
+    out->cargo              = cargo;
+    out->op                 = op;
+    out->on_board           = st->moments.placed_count;
+    out->cargo_weight_t     = r.total_cargo_weight_kg / 1000.0f;
+    out->displacement_t     = displacement_kg / 1000.0f;
+    out->overweight         = displacement_kg > ship->max_weight;
+    out->strength_compliant = (signed char)r.strength_compliant;
+    if (out->overweight) return;
+
+    out->draft              = r.draft;
+    out->trim               = r.trim;
+    out->heel               = r.heel;
+    out->gm_corrected       = r.gm_corrected;
+    out->imo_compliant      = (signed char)r.imo_compliant;
+    out->max_shear_force    = r.max_shear_force;
+    out->max_bending_moment = r.max_bending_moment;
+}
+
+int simulate_load_sequence(const Ship *ship, const SequenceMove *moves, int count,
+                           SequenceStep *out) {
+    if (!ship || count < 0 || !out || (count > 0 && !moves)) return -1;
+
+    unsigned char *aboard = malloc((size_t)ship->cargo_count + 1);
+    if (!aboard) return -2;
+    if (sequence_initial(ship, moves, count, aboard) != 0) {
+        free(aboard);
+        return -1;
+    }
+
+    SequenceState st;
+    memset(&st, 0, sizeof(st));
+    st.ship = ship;
+    tank_sums_compute(ship, &st.tanks);
+    if (ship->strength_limits) {
+        if (strength_model_init_lightship(&st.strength, ship,
+                                          ship->strength_limits->stations) != 0) {
+            free(aboard);
+            return -2;
+        }
+        st.dist = malloc((size_t)st.strength.station_count * sizeof(*st.dist));
+        if (!st.dist) {
+            strength_model_free(&st.strength);
+            free(aboard);
+            return -2;
+        }
+        for (int s = 0; s < st.strength.station_count; s++)
+            st.dist[s] = st.strength.weight_dist[s];
+        st.has_strength = 1;
+    }
+
+    for (int i = 0; i < ship->cargo_count; i++)
+        if (aboard[i]) sequence_apply(&st, &ship->cargo[i], 1.0);
+    free(aboard);
+
+    sequence_record(&st, -1, 0, &out[0]);
+    for (int k = 0; k < count; k++) {
+        const Cargo *c = &ship->cargo[moves[k].cargo];
+        sequence_apply(&st, c, moves[k].op == SEQ_LOAD ? 1.0 : -1.0);
+        sequence_record(&st, moves[k].cargo, moves[k].op, &out[k + 1]);
+    }
+
+    free(st.dist);
+    strength_model_free(&st.strength);
+    return 0;
+}
+
 void print_loading_plan(const Ship *ship) {
     AnalysisResult a = perform_analysis(ship);
 
@@ -260,9 +620,9 @@ void print_loading_plan(const Ship *ship) {
 
     for (int i = 0; i < ship->cargo_count; ++i) {
         const Cargo *c = &ship->cargo[i];
-        if (c->pos_x >= 0.0f) {
+        if (CARGO_IS_PLACED(c)) {
             printf("  - %-15s | Pos (%7.2f, %7.2f, %6.2f) | %.2f t\n",
-                   c->id, c->pos_x, c->pos_y, c->pos_z, c->weight / 1000.0f);
+                   CARGO_ID(c), c->pos_x, c->pos_y, c->pos_z, c->weight / 1000.0f);
         }
     }
 
@@ -328,25 +688,26 @@ void ship_cleanup(Ship *ship) {
     if (!ship) return;
 
     if (ship->cargo) {
-        for (int i = 0; i < ship->cargo_count; i++) {
-            if (ship->cargo[i].dg) {
-                free(ship->cargo[i].dg);
-                ship->cargo[i].dg = NULL;
-            }
-        }
-        free(ship->cargo);
+        ship_free(ship, ship->cargo);
         ship->cargo = NULL;
     }
+    cargo_pools_destroy(ship);
     if (ship->hydro) {
-        free(ship->hydro);
+        ship_free(ship, ship->hydro);
         ship->hydro = NULL;
     }
     if (ship->tanks) {
-        free(ship->tanks);
+        tank_config_free(ship->tanks);
+        ship_free(ship, ship->tanks);
         ship->tanks = NULL;
     }
     if (ship->strength_limits) {
-        free(ship->strength_limits);
+        ship_free(ship, ship->strength_limits);
         ship->strength_limits = NULL;
     }
+    if (ship->holds) {
+        hold_config_free(ship->holds);
+        ship_free(ship, ship->holds);
+        ship->holds = NULL;
+    }
 }
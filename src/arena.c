@@ -0,0 +1,134 @@
+/*
+ * arena.c - Bump allocator over a chain of reusable blocks
+ */
+
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Every allocation starts on this boundary (enough for any C99 type) */
+#define ARENA_ALIGN 16
+
+struct ArenaBlock_ {
+    ArenaBlock *next;
+    size_t used;
+    size_t capacity;
+    /* the data follows, ARENA_ALIGN-aligned */
+};
+
+#define BLOCK_HEADER ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static unsigned char *block_data(ArenaBlock *b) {
+    return (unsigned char *)b + BLOCK_HEADER;
+}
+
+static size_t align_up(size_t n) {
+    return (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+void arena_init(Arena *a) {
+    memset(a, 0, sizeof(*a));
+}
+
+void arena_free(Arena *a) {
+    if (!a) return;
+    ArenaBlock *b = a->head;
+    while (b) {
+        ArenaBlock *next = b->next;
+        free(b);
+        b = next;
+    }
+    memset(a, 0, sizeof(*a));
+}
+
+/** Make the block after cur (a spare one, or a new one) current for size bytes */
+static ArenaBlock *next_block(Arena *a, size_t size) {
+    ArenaBlock *spare = a->cur ? a->cur->next : a->head;
+    if (spare && spare->capacity >= size) {
+        spare->used = 0;
+        a->cur = spare;
+        return spare;
+    }
+
+    size_t cap = a->cur ? a->cur->capacity * 2 : ARENA_FIRST_BLOCK;
+    if (cap > ARENA_MAX_BLOCK) cap = ARENA_MAX_BLOCK;
+    if (cap < size) cap = align_up(size);
+    if (cap > (size_t)-1 - BLOCK_HEADER) return NULL;
+
+    ArenaBlock *b = malloc(BLOCK_HEADER + cap);
+    if (!b) return NULL;
+    b->used = 0;
+    b->capacity = cap;
+    b->next = spare;                  /* too-small spares stay behind it */
+    if (a->cur) a->cur->next = b;
+    else a->head = b;
+    a->cur = b;
+    a->reserved += cap;
+    return b;
+}
+
+void *arena_alloc(Arena *a, size_t size) {
+    if (size == 0) size = 1;
+    if (size > (size_t)-1 - ARENA_ALIGN) return NULL;
+    size = align_up(size);
+
+    ArenaBlock *b = a->cur;
+    if (!b || b->capacity - b->used < size) {
+        b = next_block(a, size);
+        if (!b) return NULL;
+    }
+    void *p = block_data(b) + b->used;
+    b->used += size;
+    return p;
+}
+
+void *arena_realloc(Arena *a, void *ptr, size_t old_size, size_t new_size) {
+    if (!ptr) return arena_alloc(a, new_size);
+    if (new_size <= old_size) return ptr;
+
+    /* The latest allocation ends at cur's fill mark: extend it there */
+    ArenaBlock *b = a->cur;
+    size_t old_aligned = align_up(old_size ? old_size : 1);
+    if (b && (unsigned char *)ptr + old_aligned == block_data(b) + b->used &&
+        new_size <= (size_t)-1 - ARENA_ALIGN) {
+        size_t offset = (size_t)((unsigned char *)ptr - block_data(b));
+        size_t want = align_up(new_size);
+        if (want <= b->capacity - offset) {
+            b->used = offset + want;
+            return ptr;
+        }
+    }
+
+    void *grown = arena_alloc(a, new_size);
+    if (grown) memcpy(grown, ptr, old_size);
+    return grown;
+}
+
+void arena_reset(Arena *a) {
+    a->cur = a->head;
+    if (a->cur) a->cur->used = 0;
+}
+
+ArenaMark arena_mark(const Arena *a) {
+    ArenaMark m;
+    m.block = a->cur;
+    m.used = a->cur ? a->cur->used : 0;
+    return m;
+}
+
+void arena_rewind(Arena *a, ArenaMark m) {
+    if (!m.block) {
+        arena_reset(a);
+        return;
+    }
+    a->cur = m.block;
+    a->cur->used = m.used;
+}
+
+size_t arena_used(const Arena *a) {
+    size_t n = 0;
+    if (!a->cur) return 0;
+    for (ArenaBlock *b = a->head; b != a->cur; b = b->next) n += b->used;
+    return n + a->cur->used;
+}
@@ -0,0 +1,577 @@
+/*
+ * batch.c - Batch runs: a job list in, one result line per job out
+ *
+ * The main thread reads jobs, resolves their ship templates and writes
+ * the finished lines; workers load, optimize and format. Jobs live in a
+ * ring of slots, job n in slot n % nslots, and a slot is refilled only
+ * once its line has been written: output stays in job order, and a slow
+ * job holds up the stream but never grows the window.
+ */
+
+#include "batch.h"
+#include "libcargoforge.h"
+#include "json_output.h"
+#include "thread_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define KEEP_ARENA_SIZE (64u << 20)   /* handles holding more are reopened */
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static char *dup_str(const char *s) {
+    size_t n = strlen(s) + 1;
+    char *d = malloc(n);
+    if (d) memcpy(d, s, n);
+    return d;
+}
+
+void batch_options_init(BatchOptions *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->format = BATCH_NDJSON;
+    opts->workers = 0;
+    opts->in_flight = 0;
+    opts->max_templates = 64;
+}
+
+/* ------------------------------------------------------------------ */
+/* SHIP TEMPLATES                                                     */
+/* ------------------------------------------------------------------ */
+
+/**
+ * TemplateSet - Parsed ships keyed by config path, least recently used
+ * dropped first. Only the main thread touches it; jobs hold their own
+ * reference, so dropping an entry never pulls a ship from under a job.
+ */
+typedef struct {
+    char *path;
+    CfShipTemplate *tpl;
+    unsigned long last_used;
+} TemplateEntry;
+
+typedef struct {
+    TemplateEntry *entries;
+    int count, capacity;     /* capacity 0 = disabled */
+    unsigned long clock;
+} TemplateSet;
+
+static void templates_init(TemplateSet *t, int capacity) {
+    memset(t, 0, sizeof(*t));
+    if (capacity > 0) {
+        t->entries = calloc((size_t)capacity, sizeof(TemplateEntry));
+        if (t->entries) t->capacity = capacity;
+    }
+}
+
+static void templates_free(TemplateSet *t) {
+    for (int i = 0; i < t->count; i++) {
+        free(t->entries[i].path);
+        cargoforge_template_release(t->entries[i].tpl);
+    }
+    free(t->entries);
+}
+
+/**
+ * Template for a ship config path: a new reference the caller releases,
+ * or NULL if the set is disabled or the config does not parse (the job
+ * then loads it directly, which reports the error).
+ */
+static CfShipTemplate *templates_get(TemplateSet *t, const char *path) {
+    if (t->capacity == 0) return NULL;
+
+    for (int i = 0; i < t->count; i++) {
+        TemplateEntry *e = &t->entries[i];
+        if (strcmp(e->path, path) == 0) {
+            e->last_used = ++t->clock;
+            return cargoforge_template_retain(e->tpl);
+        }
+    }
+
+    CfShipTemplate *tpl;
+    if (cargoforge_template_load(&tpl, path) != CF_OK) return NULL;
+    char *copy = dup_str(path);
+    if (!copy) return tpl;
+
+    TemplateEntry *slot;
+    if (t->count < t->capacity) {
+        slot = &t->entries[t->count++];
+    } else {
+        slot = &t->entries[0];
+        for (int i = 1; i < t->count; i++)
+            if (t->entries[i].last_used < slot->last_used) slot = &t->entries[i];
+        free(slot->path);
+        cargoforge_template_release(slot->tpl);
+    }
+    slot->path = copy;
+    slot->tpl = cargoforge_template_retain(tpl);
+    slot->last_used = ++t->clock;
+    return tpl;
+}
+
+/* ------------------------------------------------------------------ */
+/* JOB SOURCE                                                         */
+/* ------------------------------------------------------------------ */
+
+/**
+ * JobSource - Jobs from a list file, read a line at a time, or from a
+ * directory listing taken once and sorted by name.
+ */
+typedef struct {
+    const char *ship;        /* default ship config */
+    FILE *fp;
+    int close_fp;
+    char *line;
+    size_t line_cap;
+
+    const char *dir;
+    char **names;
+    size_t count, next;
+} JobSource;
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static char *join_path(const char *dir, const char *name) {
+    size_t dl = strlen(dir), nl = strlen(name);
+    char *p = malloc(dl + nl + 2);
+    if (!p) return NULL;
+    memcpy(p, dir, dl);
+    size_t at = dl;
+    if (dl > 0 && dir[dl - 1] != '/') p[at++] = '/';
+    memcpy(p + at, name, nl + 1);
+    return p;
+}
+
+static void source_close(JobSource *src) {
+    if (src->close_fp) fclose(src->fp);
+    free(src->line);
+    for (size_t i = 0; i < src->count; i++) free(src->names[i]);
+    free(src->names);
+}
+
+static int source_list_dir(JobSource *src, const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        fprintf(stderr, "Error: Cannot open directory %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    size_t cap = 0;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        char *path = join_path(dir, ent->d_name);
+        struct stat st;
+        if (!path || stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            free(path);
+            if (!path) break;
+            continue;
+        }
+        free(path);
+
+        if (src->count == cap) {
+            size_t ncap = cap ? cap * 2 : 64;
+            char **grown = realloc(src->names, ncap * sizeof(char *));
+            if (!grown) break;
+            src->names = grown;
+            cap = ncap;
+        }
+        char *name = dup_str(ent->d_name);
+        if (!name) break;
+        src->names[src->count++] = name;
+    }
+    int complete = (ent == NULL);
+    closedir(d);
+    if (!complete) {
+        fprintf(stderr, "Error: Out of memory listing %s\n", dir);
+        return -1;
+    }
+
+    qsort(src->names, src->count, sizeof(char *), compare_names);
+    src->dir = dir;
+    return 0;
+}
+
+static int source_open(JobSource *src, const BatchOptions *opts) {
+    memset(src, 0, sizeof(*src));
+    src->ship = opts->ship_config;
+
+    if (strcmp(opts->jobs, "-") == 0) {
+        src->fp = stdin;
+        return 0;
+    }
+
+    struct stat st;
+    if (stat(opts->jobs, &st) == 0 && S_ISDIR(st.st_mode)) {
+        if (!opts->ship_config) {
+            fprintf(stderr, "Error: A directory of manifests needs a ship config\n");
+            return -1;
+        }
+        return source_list_dir(src, opts->jobs);
+    }
+
+    src->fp = fopen(opts->jobs, "r");
+    if (!src->fp) {
+        fprintf(stderr, "Error: Cannot open job list %s: %s\n", opts->jobs, strerror(errno));
+        return -1;
+    }
+    src->close_fp = 1;
+    return 0;
+}
+
+/**
+ * Next job: 1 with *ship and *cargo set (malloc'd; *ship may be NULL and
+ * *error set for a job that fails without running), 0 at the end, -1 on
+ * a read or allocation error.
+ */
+static int source_next(JobSource *src, char **ship, char **cargo, const char **error) {
+    *ship = NULL;
+    *cargo = NULL;
+    *error = NULL;
+
+    if (src->dir) {
+        if (src->next == src->count) return 0;
+        *cargo = join_path(src->dir, src->names[src->next++]);
+        *ship = dup_str(src->ship);
+        if (!*cargo || !*ship) {
+            free(*cargo);
+            free(*ship);
+            return -1;
+        }
+        return 1;
+    }
+
+    for (;;) {
+        errno = 0;
+        ssize_t n = getline(&src->line, &src->line_cap, src->fp);
+        if (n < 0) return (ferror(src->fp) || errno == ENOMEM) ? -1 : 0;
+
+        /* Up to two whitespace-separated fields; blank and '#' lines skipped */
+        char *field[3] = { NULL, NULL, NULL };
+        int nf = 0;
+        char *p = src->line;
+        while (*p && nf < 3) {
+            while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') p++;
+            if (!*p || (nf == 0 && *p == '#')) break;
+            field[nf++] = p;
+            while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') p++;
+            if (*p) *p++ = '\0';
+        }
+        if (nf == 0) continue;
+
+        const char *ship_path = nf >= 2 ? field[0] : src->ship;
+        *cargo = dup_str(nf >= 2 ? field[1] : field[0]);
+        if (ship_path) *ship = dup_str(ship_path);
+        if (!*cargo || (ship_path && !*ship)) {
+            free(*cargo);
+            free(*ship);
+            return -1;
+        }
+        if (nf > 2) *error = "Job line has more than two fields";
+        else if (!ship_path) *error = "No ship config for manifest (give one per line or as the second argument)";
+        return 1;
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* JOBS                                                               */
+/* ------------------------------------------------------------------ */
+
+typedef struct Batch_ Batch;
+
+/**
+ * BatchSlot - One job in flight and the handle it runs on. The main
+ * thread fills the job fields before handing the slot to a worker and
+ * reads them back once done is set (under Batch.lock).
+ */
+typedef struct {
+    Batch *batch;
+    CargoForge *cf;          /* opened on first use, kept warm */
+    long long job;           /* 1-based position in the job list */
+    char *ship, *cargo;
+    CfShipTemplate *tpl;     /* NULL: load ship by path */
+    const char *error;       /* set: the job fails without running */
+    JsonWriter out;          /* the finished line */
+    int failed;
+    int done;
+} BatchSlot;
+
+struct Batch_ {
+    const BatchOptions *opts;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+static CargoForge *slot_handle(BatchSlot *s) {
+    if (s->cf) return s->cf;
+    const BatchOptions *opts = s->batch->opts;
+    if (cargoforge_open(&s->cf) != CF_OK) return NULL;
+    cargoforge_set_option(s->cf, CF_OPT_ARENA, 1);
+    cargoforge_set_option(s->cf, CF_OPT_JSON_COMPACT, 1);
+    cargoforge_set_option(s->cf, CF_OPT_STRATEGY, opts->strategy);
+    cargoforge_set_option(s->cf, CF_OPT_TIME_BUDGET, opts->time_budget_ms);
+    if (opts->beam_width > 0)
+        cargoforge_set_option(s->cf, CF_OPT_BEAM_WIDTH, opts->beam_width);
+    cargoforge_set_option(s->cf, CF_OPT_PLACER, opts->placer);
+    return s->cf;
+}
+
+/** Append s as a CSV field, quoted when it holds a separator or quote */
+static void put_csv_field(JsonWriter *w, const char *s) {
+    if (!s) return;
+    if (!strpbrk(s, ",\"\r\n")) {
+        json_put_cstr(w, s);
+        return;
+    }
+    json_put_raw(w, "\"", 1);
+    for (const char *q; (q = strchr(s, '"')) != NULL; s = q + 1) {
+        json_put_raw(w, s, (size_t)(q - s) + 1);
+        json_put_raw(w, "\"", 1);
+    }
+    json_put_cstr(w, s);
+    json_put_raw(w, "\"", 1);
+}
+
+static void format_csv(BatchSlot *s, const CfResult *r, const char *error) {
+    JsonWriter *w = &s->out;
+    char num[32];
+    snprintf(num, sizeof(num), "%lld,", s->job);
+    json_put_cstr(w, num);
+    put_csv_field(w, s->ship);
+    json_put_raw(w, ",", 1);
+    put_csv_field(w, s->cargo);
+
+    if (error) {
+        json_put_cstr(w, ",error,,,,,,,,,,,,");
+        put_csv_field(w, error);
+    } else {
+        char row[256];
+        snprintf(row, sizeof(row), ",ok,%d,%d,%.2f,%.2f,%.3f,%.3f,%.3f,%.3f,%.2f,%s,%s,",
+                 r->placed_count, r->total_count, r->cargo_weight, r->displacement,
+                 r->draft, r->gm, r->gm_corrected, r->trim, r->heel,
+                 r->imo_compliant ? "yes" : "no",
+                 r->strength_compliant < 0 ? "" : r->strength_compliant ? "yes" : "no");
+        json_put_cstr(w, row);
+    }
+    json_put_raw(w, "\n", 1);
+}
+
+static void format_ndjson(BatchSlot *s, const char *json, const char *error) {
+    JsonWriter *w = &s->out;
+    json_put_cstr(w, "{\"job\":");
+    json_put_int(w, s->job);
+    json_put_cstr(w, ",\"ship_config\":");
+    if (s->ship) json_put_string(w, s->ship);
+    else json_put_cstr(w, "null");
+    json_put_cstr(w, ",\"cargo_manifest\":");
+    json_put_string(w, s->cargo);
+
+    if (error) {
+        json_put_cstr(w, ",\"status\":\"error\",\"error\":");
+        json_put_string(w, error);
+        json_put_raw(w, "}", 1);
+    } else {
+        /* The optimize document's members follow the job's own */
+        json_put_cstr(w, ",\"status\":\"ok\",");
+        json_put_cstr(w, json + 1);
+    }
+    json_put_raw(w, "\n", 1);
+}
+
+/** Worker task: run one job and format its line */
+static void run_job(void *arg) {
+    BatchSlot *s = arg;
+    Batch *b = s->batch;
+    const char *error = s->error;
+    const char *json = NULL;
+    const CfResult *r = NULL;
+    int rc = CF_OK;
+
+    CargoForge *cf = error ? NULL : slot_handle(s);
+    if (!error && !cf) error = "Out of memory opening a handle";
+
+    if (!error) {
+        rc = s->tpl ? cargoforge_load_ship_template(cf, s->tpl)
+                    : cargoforge_load_ship(cf, s->ship);
+        if (rc == CF_OK) rc = cargoforge_load_cargo(cf, s->cargo);
+        if (rc == CF_OK) rc = cargoforge_optimize(cf);
+        if (rc == CF_OK && b->opts->format == BATCH_CSV) {
+            r = cargoforge_result(cf);
+            if (!r) rc = CF_ERR_STATE;
+        } else if (rc == CF_OK) {
+            json = cargoforge_result_json(cf);
+            if (!json) rc = CF_ERR_NOMEM;
+        }
+        if (rc != CF_OK) {
+            const char *msg = cargoforge_errmsg(cf);
+            error = (msg && *msg) ? msg : cargoforge_errstr(rc);
+        }
+    }
+
+    s->out.len = 0;
+    s->out.oom = 0;
+    if (b->opts->format == BATCH_CSV)
+        format_csv(s, r, error);
+    else
+        format_ndjson(s, json, error);
+    s->failed = (error != NULL);
+
+    if (cf) {
+        size_t reserved = 0;
+        cargoforge_reset(cf);
+        cargoforge_arena_stats(cf, NULL, &reserved);
+        if (reserved > KEEP_ARENA_SIZE) {
+            cargoforge_close(cf);
+            s->cf = NULL;
+        }
+    }
+
+    pthread_mutex_lock(&b->lock);
+    s->done = 1;
+    pthread_cond_broadcast(&b->cond);
+    pthread_mutex_unlock(&b->lock);
+}
+
+/** Write a finished slot's line; -1 if the output failed */
+static int write_line(FILE *out, const BatchSlot *s) {
+    if (s->out.oom) {
+        /* Could not build the line: report the job with what fits */
+        return fprintf(out, "{\"job\":%lld,\"status\":\"error\",\"error\":\"Out of memory\"}\n",
+                       s->job) < 0 ? -1 : 0;
+    }
+    return fwrite(s->out.data, 1, s->out.len, out) == s->out.len ? 0 : -1;
+}
+
+static void slot_clear(BatchSlot *s) {
+    free(s->ship);
+    free(s->cargo);
+    cargoforge_template_release(s->tpl);
+    s->ship = s->cargo = NULL;
+    s->tpl = NULL;
+    s->error = NULL;
+}
+
+int batch_run(const BatchOptions *opts, BatchStats *stats) {
+    if (stats) memset(stats, 0, sizeof(*stats));
+    if (!opts || !opts->jobs) return -1;
+    double t0 = now_ms();
+
+    JobSource src;
+    if (source_open(&src, opts) != 0) {
+        source_close(&src);
+        return -1;
+    }
+
+    FILE *out = stdout;
+    if (opts->output_file) {
+        out = fopen(opts->output_file, "w");
+        if (!out) {
+            fprintf(stderr, "Error: Cannot open output file %s\n", opts->output_file);
+            source_close(&src);
+            return -1;
+        }
+    }
+
+    int workers = opts->workers > 0 ? opts->workers : thread_pool_cpu_count();
+    ThreadPool *pool = thread_pool_create(workers);
+    if (pool) workers = thread_pool_size(pool);
+    int nslots = opts->in_flight > 0 ? opts->in_flight : 4 * workers;
+
+    Batch b;
+    b.opts = opts;
+    pthread_mutex_init(&b.lock, NULL);
+    pthread_cond_init(&b.cond, NULL);
+
+    TemplateSet templates;
+    templates_init(&templates, opts->max_templates);
+
+    BatchSlot *slots = calloc((size_t)nslots, sizeof(BatchSlot));
+    int rc = slots ? 0 : -1;
+    if (!slots) fprintf(stderr, "Error: Out of memory starting the batch\n");
+    for (int i = 0; slots && i < nslots; i++) {
+        slots[i].batch = &b;
+        json_writer_init(&slots[i].out, 0);
+    }
+
+    if (rc == 0 && opts->format == BATCH_CSV &&
+        fputs("job,ship_config,cargo_manifest,status,placed,total,cargo_weight_kg,"
+              "displacement_kg,draft_m,gm_m,gm_corrected_m,trim_m,heel_deg,"
+              "imo_compliant,strength_compliant,error\n", out) == EOF)
+        rc = -1;
+
+    long long next = 0, head = 0, failed = 0;
+    int eof = (rc != 0);
+    for (;;) {
+        while (!eof && next - head < nslots) {
+            BatchSlot *s = &slots[next % nslots];
+            int got = source_next(&src, &s->ship, &s->cargo, &s->error);
+            if (got <= 0) {
+                if (got < 0) {
+                    fprintf(stderr, "Error: Failed reading job list %s\n", opts->jobs);
+                    rc = -1;
+                }
+                eof = 1;
+                break;
+            }
+            s->job = ++next;
+            if (!s->error) s->tpl = templates_get(&templates, s->ship);
+            s->done = 0;
+            if (!pool || thread_pool_submit(pool, run_job, s) != 0) run_job(s);
+        }
+        if (head == next) break;
+
+        /* Lines go out in job order: wait for the oldest job */
+        BatchSlot *s = &slots[head % nslots];
+        pthread_mutex_lock(&b.lock);
+        if (!s->done) {
+            fflush(out);
+            while (!s->done) pthread_cond_wait(&b.cond, &b.lock);
+        }
+        pthread_mutex_unlock(&b.lock);
+
+        if (rc == 0 && write_line(out, s) != 0) {
+            fprintf(stderr, "Error: Failed writing batch output\n");
+            rc = -1;
+            eof = 1;
+        }
+        failed += s->failed;
+        slot_clear(s);
+        head++;
+    }
+
+    thread_pool_destroy(pool);
+    for (int i = 0; slots && i < nslots; i++) {
+        cargoforge_close(slots[i].cf);
+        json_writer_free(&slots[i].out);
+    }
+    free(slots);
+    templates_free(&templates);
+    pthread_cond_destroy(&b.cond);
+    pthread_mutex_destroy(&b.lock);
+    source_close(&src);
+
+    if (fflush(out) != 0 && rc == 0) {
+        fprintf(stderr, "Error: Failed writing batch output\n");
+        rc = -1;
+    }
+    if (out != stdout) fclose(out);
+
+    if (stats) {
+        stats->jobs = head;
+        stats->failed = failed;
+        stats->elapsed_ms = now_ms() - t0;
+    }
+    return rc;
+}
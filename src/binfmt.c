@@ -0,0 +1,679 @@
+/*
+ * binfmt.c - Compact binary manifest and plan format (.cfb)
+ */
+
+#include "binfmt.h"
+#include "imdg.h"
+#include <math.h>
+#include <stddef.h>
+
+#if !defined(CARGOFORGE_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_MMAP 1
+#endif
+
+/* Header field offsets */
+enum {
+    H_MAGIC = 0, H_VERSION = 8, H_FLAGS = 10, H_HEADER_SIZE = 12,
+    H_LENGTH = 16, H_WIDTH = 20, H_MAX_WEIGHT = 24, H_LIGHTSHIP = 28,
+    H_LIGHTSHIP_KG = 32, H_CARGO_COUNT = 36, H_DG_COUNT = 40, H_STRINGS_SIZE = 44,
+    H_CARGO_OFF = 48, H_DG_OFF = 56, H_RESULT_OFF = 64, H_STRINGS_OFF = 72,
+    H_FILE_SIZE = 80, H_RECORD_SIZE = 88
+};
+
+/* Cargo record field offsets */
+enum { R_ID = 0, R_TYPE = 4, R_WEIGHT = 8, R_DIMS = 12, R_POS = 24, R_DG = 36 };
+
+/* DG record field offsets */
+enum { D_CLASS = 0, D_DIVISION = 1, D_STOWAGE = 2, D_UN = 4, D_EMS = 12 };
+
+/**
+ * Result section: these AnalysisResult members, 4 bytes each, in order.
+ * Append only; never reorder.
+ */
+typedef struct {
+    size_t offset;
+    int    is_int;
+} ResultField;
+
+#define RF(m) { offsetof(AnalysisResult, m), 0 }
+#define RI(m) { offsetof(AnalysisResult, m), 1 }
+static const ResultField RESULT_FIELDS[] = {
+    RF(cg.perc_x), RF(cg.perc_y), RF(total_cargo_weight_kg), RI(placed_item_count),
+    RF(draft), RF(gm), RF(kb), RF(bm), RF(kg),
+    RF(free_surface_correction), RF(gm_corrected),
+    RF(trim), RF(heel), RF(lcg),
+    RF(gz_at_30), RF(gz_max), RF(gz_max_angle),
+    RF(area_0_30), RF(area_0_40), RF(area_30_40), RI(imo_compliant),
+    RF(max_shear_force), RF(max_bending_moment), RI(strength_compliant),
+    RI(hydro_table_used),
+};
+#define RESULT_FIELD_COUNT ((int)(sizeof(RESULT_FIELDS) / sizeof(RESULT_FIELDS[0])))
+
+typedef char result_size_matches[RESULT_FIELD_COUNT * 4 == CFB_RESULT_SIZE ? 1 : -1];
+
+/* ------------------------------------------------------------------ */
+/* LITTLE-ENDIAN FIELDS                                               */
+/* ------------------------------------------------------------------ */
+
+static uint16_t get_u16(const unsigned char *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t get_u64(const unsigned char *p) {
+    return (uint64_t)get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+
+static float get_f32(const unsigned char *p) {
+    uint32_t u = get_u32(p);
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+static void put_u16(unsigned char *p, uint16_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put_u32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_u64(unsigned char *p, uint64_t v) {
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static void put_f32(unsigned char *p, float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    put_u32(p, u);
+}
+
+static uint64_t align8(uint64_t x) {
+    return (x + 7) & ~(uint64_t)7;
+}
+
+/* ------------------------------------------------------------------ */
+/* WRITER                                                             */
+/* ------------------------------------------------------------------ */
+
+/** Buffered sequential output; keeps going after an error, checked once */
+typedef struct {
+    FILE *fp;
+    unsigned char buf[8192];
+    size_t len;
+    uint64_t pos;            /* bytes emitted so far */
+    int failed;
+} Writer;
+
+static void w_flush(Writer *w) {
+    if (w->len && fwrite(w->buf, 1, w->len, w->fp) != w->len) w->failed = 1;
+    w->len = 0;
+}
+
+/** Zeroed room for n (<= sizeof buf) bytes in the buffer */
+static unsigned char *w_space(Writer *w, size_t n) {
+    if (w->len + n > sizeof(w->buf)) w_flush(w);
+    unsigned char *p = w->buf + w->len;
+    memset(p, 0, n);
+    w->len += n;
+    w->pos += n;
+    return p;
+}
+
+static void w_bytes(Writer *w, const void *data, size_t n) {
+    if (n > sizeof(w->buf) / 2) {
+        w_flush(w);
+        if (fwrite(data, 1, n, w->fp) != n) w->failed = 1;
+        w->pos += n;
+        return;
+    }
+    memcpy(w_space(w, n), data, n);
+}
+
+static void w_pad8(Writer *w) {
+    size_t n = (size_t)(align8(w->pos) - w->pos);
+    if (n) w_space(w, n);
+}
+
+/** String table under construction; offsets must fit in u32 */
+typedef struct {
+    char *data;
+    size_t len, cap;
+} StrTab;
+
+/* Distinct cargo types are few; beyond this many they are stored per item */
+#define CFB_TYPE_INTERN_MAX 32
+
+static int strtab_add(StrTab *t, const char *s, uint32_t *off) {
+    size_t n = strlen(s) + 1;
+    if (t->len + n > UINT32_MAX) {
+        fprintf(stderr, "Error: Binary manifest string table exceeds 4 GiB\n");
+        return -1;
+    }
+    if (t->len + n > t->cap) {
+        size_t cap = t->cap ? t->cap * 2 : 4096;
+        while (cap < t->len + n) cap *= 2;
+        char *grown = realloc(t->data, cap);
+        if (!grown) {
+            fprintf(stderr, "Error: Failed to allocate memory for string table.\n");
+            return -1;
+        }
+        t->data = grown;
+        t->cap = cap;
+    }
+    memcpy(t->data + t->len, s, n);
+    *off = (uint32_t)t->len;
+    t->len += n;
+    return 0;
+}
+
+static void put_dg(unsigned char *p, const DGInfo *dg) {
+    p[D_CLASS] = (unsigned char)dg->dg_class;
+    p[D_DIVISION] = (unsigned char)dg->dg_division;
+    p[D_STOWAGE] = (unsigned char)dg->stowage;
+    memcpy(p + D_UN, dg->un_number, strnlen(dg->un_number, sizeof(dg->un_number) - 1));
+    memcpy(p + D_EMS, dg->ems, strnlen(dg->ems, sizeof(dg->ems) - 1));
+}
+
+int cfb_write(FILE *fp, const Ship *ship, const AnalysisResult *result) {
+    uint32_t n = ship->cargo_count > 0 ? (uint32_t)ship->cargo_count : 0;
+
+    /* Pass 1: string table and DG count, so the header can go first */
+    StrTab tab = {0};
+    uint32_t *offs = malloc(((size_t)n * 2 + 1) * sizeof(uint32_t));
+    if (!offs) {
+        fprintf(stderr, "Error: Failed to allocate memory for binary manifest.\n");
+        return -1;
+    }
+
+    uint32_t types[CFB_TYPE_INTERN_MAX];
+    int type_count = 0;
+    uint32_t dg_count = 0;
+    int rc = 0;
+
+    for (uint32_t i = 0; i < n && rc == 0; i++) {
+        const Cargo *c = &ship->cargo[i];
+        rc = strtab_add(&tab, CARGO_ID(c), &offs[2 * i]);
+        if (rc != 0) break;
+
+        int t;
+        for (t = 0; t < type_count; t++)
+            if (strcmp(tab.data + types[t], CARGO_TYPE(c)) == 0) break;
+        if (t < type_count) {
+            offs[2 * i + 1] = types[t];
+        } else {
+            rc = strtab_add(&tab, CARGO_TYPE(c), &offs[2 * i + 1]);
+            if (rc == 0 && type_count < CFB_TYPE_INTERN_MAX)
+                types[type_count++] = offs[2 * i + 1];
+        }
+        if (c->dg) dg_count++;
+    }
+    uint32_t empty;
+    if (rc == 0 && tab.len == 0) rc = strtab_add(&tab, "", &empty);
+    if (rc != 0) {
+        free(tab.data);
+        free(offs);
+        return -1;
+    }
+
+    unsigned int flags = result ? CFB_FLAG_PLAN | CFB_FLAG_RESULT : 0;
+    uint64_t cargo_off = CFB_HEADER_SIZE;
+    uint64_t dg_off = align8(cargo_off + (uint64_t)n * CFB_RECORD_SIZE);
+    uint64_t result_off = align8(dg_off + (uint64_t)dg_count * CFB_DG_SIZE);
+    uint64_t strings_off = align8(result_off + (result ? CFB_RESULT_SIZE : 0));
+    uint64_t file_size = strings_off + tab.len;
+
+    Writer *w = malloc(sizeof(Writer));
+    if (!w) {
+        fprintf(stderr, "Error: Failed to allocate memory for binary manifest.\n");
+        free(tab.data);
+        free(offs);
+        return -1;
+    }
+    w->fp = fp;
+    w->len = 0;
+    w->pos = 0;
+    w->failed = 0;
+
+    unsigned char *h = w_space(w, CFB_HEADER_SIZE);
+    memcpy(h + H_MAGIC, CFB_MAGIC, CFB_MAGIC_LEN);
+    put_u16(h + H_VERSION, CFB_VERSION);
+    put_u16(h + H_FLAGS, (uint16_t)flags);
+    put_u32(h + H_HEADER_SIZE, CFB_HEADER_SIZE);
+    put_f32(h + H_LENGTH, ship->length);
+    put_f32(h + H_WIDTH, ship->width);
+    put_f32(h + H_MAX_WEIGHT, ship->max_weight);
+    put_f32(h + H_LIGHTSHIP, ship->lightship_weight);
+    put_f32(h + H_LIGHTSHIP_KG, ship->lightship_kg);
+    put_u32(h + H_CARGO_COUNT, n);
+    put_u32(h + H_DG_COUNT, dg_count);
+    put_u32(h + H_STRINGS_SIZE, (uint32_t)tab.len);
+    put_u64(h + H_CARGO_OFF, cargo_off);
+    put_u64(h + H_DG_OFF, dg_off);
+    put_u64(h + H_RESULT_OFF, result ? result_off : 0);
+    put_u64(h + H_STRINGS_OFF, strings_off);
+    put_u64(h + H_FILE_SIZE, file_size);
+    put_u32(h + H_RECORD_SIZE, CFB_RECORD_SIZE);
+
+    uint32_t dg_next = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const Cargo *c = &ship->cargo[i];
+        unsigned char *r = w_space(w, CFB_RECORD_SIZE);
+        put_u32(r + R_ID, offs[2 * i]);
+        put_u32(r + R_TYPE, offs[2 * i + 1]);
+        put_f32(r + R_WEIGHT, c->weight);
+        for (int d = 0; d < MAX_DIMENSION; d++)
+            put_f32(r + R_DIMS + 4 * d, c->dimensions[d]);
+        /* Unplaced items are stored at -1 */
+        int placed = result && CARGO_IS_PLACED(c);
+        put_f32(r + R_POS, placed ? c->pos_x : -1.0f);
+        put_f32(r + R_POS + 4, placed ? c->pos_y : -1.0f);
+        put_f32(r + R_POS + 8, placed ? c->pos_z : -1.0f);
+        put_u32(r + R_DG, c->dg ? dg_next++ : CFB_NO_DG);
+    }
+
+    w_pad8(w);
+    for (uint32_t i = 0; i < n; i++)
+        if (ship->cargo[i].dg)
+            put_dg(w_space(w, CFB_DG_SIZE), (const DGInfo *)ship->cargo[i].dg);
+
+    w_pad8(w);
+    if (result) {
+        unsigned char *p = w_space(w, CFB_RESULT_SIZE);
+        for (int f = 0; f < RESULT_FIELD_COUNT; f++) {
+            const char *field = (const char *)result + RESULT_FIELDS[f].offset;
+            if (RESULT_FIELDS[f].is_int) {
+                int v;
+                memcpy(&v, field, sizeof(v));
+                put_u32(p + 4 * f, (uint32_t)v);
+            } else {
+                float v;
+                memcpy(&v, field, sizeof(v));
+                put_f32(p + 4 * f, v);
+            }
+        }
+    }
+
+    w_pad8(w);
+    w_bytes(w, tab.data, tab.len);
+    w_flush(w);
+
+    rc = (w->failed || ferror(fp)) ? -1 : 0;
+    if (rc != 0) fprintf(stderr, "Error: Failed to write binary manifest\n");
+    free(w);
+    free(tab.data);
+    free(offs);
+    return rc;
+}
+
+/* ------------------------------------------------------------------ */
+/* READER                                                             */
+/* ------------------------------------------------------------------ */
+
+/* lo <= v <= hi; false for NaN */
+static int in_range(float v, float lo, float hi) {
+    return v >= lo && v <= hi;
+}
+
+/** A ship particular is unset (0) or within the ship config parser's
+ * limits (0.1 .. 1e9 in the config's units: m, or t for weights) */
+static int particular_ok(float v, float unit) {
+    return v == 0.0f || in_range(v, 0.1f * unit, 1e9f * unit);
+}
+
+static int bad_image(const char *why) {
+    fprintf(stderr, "Error: Malformed binary manifest (%s)\n", why);
+    return -1;
+}
+
+/** Does [off, off + count * size) lie within [lo, len)? */
+static int section_fits(uint64_t off, uint64_t count, uint64_t size, uint64_t lo, uint64_t len) {
+    if (off < lo || off > len) return 0;
+    return count == 0 || count <= (len - off) / size;
+}
+
+int cfb_open_buffer(const void *data, size_t len, CfbImage *img) {
+    memset(img, 0, sizeof(*img));
+    const unsigned char *b = data;
+
+    if (len < CFB_MAGIC_LEN || memcmp(b + H_MAGIC, CFB_MAGIC, CFB_MAGIC_LEN) != 0) {
+        fprintf(stderr, "Error: Not a CargoForge binary manifest\n");
+        return -1;
+    }
+    if (len < CFB_HEADER_SIZE) return bad_image("truncated header");
+
+    unsigned int version = get_u16(b + H_VERSION);
+    if (version != CFB_VERSION) {
+        fprintf(stderr, "Error: Unsupported binary manifest version %u (expected %d)\n",
+                version, CFB_VERSION);
+        return -1;
+    }
+
+    uint32_t header_size = get_u32(b + H_HEADER_SIZE);
+    uint64_t file_size = get_u64(b + H_FILE_SIZE);
+    if (header_size < CFB_HEADER_SIZE || header_size > len)
+        return bad_image("bad header size");
+    if (file_size != (uint64_t)len) {
+        fprintf(stderr, "Error: Binary manifest is %zu bytes, header says %llu "
+                "(truncated file?)\n", len, (unsigned long long)file_size);
+        return -1;
+    }
+
+    img->flags = get_u16(b + H_FLAGS);
+    img->length = get_f32(b + H_LENGTH);
+    img->width = get_f32(b + H_WIDTH);
+    img->max_weight = get_f32(b + H_MAX_WEIGHT);
+    img->lightship_weight = get_f32(b + H_LIGHTSHIP);
+    img->lightship_kg = get_f32(b + H_LIGHTSHIP_KG);
+    if (!particular_ok(img->length, 1.0f) || !particular_ok(img->width, 1.0f) ||
+        !particular_ok(img->max_weight, 1000.0f) ||
+        !particular_ok(img->lightship_weight, 1000.0f) ||
+        !particular_ok(img->lightship_kg, 1.0f))
+        return bad_image("ship particulars out of range");
+    img->cargo_count = get_u32(b + H_CARGO_COUNT);
+    img->dg_count = get_u32(b + H_DG_COUNT);
+    img->strings_size = get_u32(b + H_STRINGS_SIZE);
+    img->record_size = get_u32(b + H_RECORD_SIZE);
+    img->cargo_offset = get_u64(b + H_CARGO_OFF);
+    img->dg_offset = get_u64(b + H_DG_OFF);
+    img->result_offset = get_u64(b + H_RESULT_OFF);
+    img->strings_offset = get_u64(b + H_STRINGS_OFF);
+
+    if (img->record_size < CFB_RECORD_SIZE) return bad_image("bad record size");
+    if (img->cargo_count > (uint32_t)(1u << 30)) return bad_image("too many records");
+    if (!section_fits(img->cargo_offset, img->cargo_count, img->record_size, header_size, len))
+        return bad_image("cargo section out of bounds");
+    if (!section_fits(img->dg_offset, img->dg_count, CFB_DG_SIZE, header_size, len))
+        return bad_image("DG section out of bounds");
+    if ((img->flags & CFB_FLAG_RESULT) &&
+        !section_fits(img->result_offset, 1, CFB_RESULT_SIZE, header_size, len))
+        return bad_image("result section out of bounds");
+    if (img->strings_size == 0 ||
+        !section_fits(img->strings_offset, img->strings_size, 1, header_size, len) ||
+        b[img->strings_offset + img->strings_size - 1] != '\0')
+        return bad_image("bad string table");
+
+    img->base = b;
+    img->size = len;
+    img->owned = CFB_OWN_NONE;
+    return 0;
+}
+
+static unsigned char *read_whole_file(FILE *f, size_t *len) {
+    size_t cap = 1 << 16, n = 0;
+    unsigned char *buf = malloc(cap);
+    if (!buf) return NULL;
+    size_t got;
+    while ((got = fread(buf + n, 1, cap - n, f)) > 0) {
+        n += got;
+        if (n == cap) {
+            unsigned char *grown = realloc(buf, cap * 2);
+            if (!grown) { free(buf); return NULL; }
+            buf = grown;
+            cap *= 2;
+        }
+    }
+    if (ferror(f)) { free(buf); return NULL; }
+    *len = n;
+    return buf;
+}
+
+int cfb_open(const char *path, CfbImage *img) {
+    memset(img, 0, sizeof(*img));
+#ifdef HAVE_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening binary manifest");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+        (uint64_t)st.st_size <= SIZE_MAX) {
+        size_t len = (size_t)st.st_size;
+        void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map != MAP_FAILED) {
+            if (cfb_open_buffer(map, len, img) != 0) {
+                munmap(map, len);
+                return -1;
+            }
+            img->owned = CFB_OWN_MAP;
+            return 0;
+        }
+    } else {
+        close(fd);
+    }
+#endif
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror("Error opening binary manifest");
+        return -1;
+    }
+    size_t len = 0;
+    unsigned char *buf = read_whole_file(f, &len);
+    fclose(f);
+    if (!buf) {
+        fprintf(stderr, "Error: Failed to read binary manifest %s\n", path);
+        return -1;
+    }
+    if (cfb_open_buffer(buf, len, img) != 0) {
+        free(buf);
+        return -1;
+    }
+    img->owned = CFB_OWN_HEAP;
+    return 0;
+}
+
+void cfb_close(CfbImage *img) {
+    if (!img) return;
+#ifdef HAVE_MMAP
+    if (img->owned == CFB_OWN_MAP) munmap((void *)img->base, img->size);
+#endif
+    if (img->owned == CFB_OWN_HEAP) free((void *)img->base);
+    memset(img, 0, sizeof(*img));
+}
+
+int cfb_is_binary_file(const char *path) {
+    if (!path || strcmp(path, "-") == 0) return 0;
+    FILE *f = fopen(path, "rb");
+    if (!f) return 0;
+    char magic[CFB_MAGIC_LEN];
+    int is_bin = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+                 memcmp(magic, CFB_MAGIC, CFB_MAGIC_LEN) == 0;
+    fclose(f);
+    return is_bin;
+}
+
+/** Same limits the text parser enforces (0.1 t .. 1e6 t, 0.1 m .. 1e4 m) */
+static int record_values_ok(const Cargo *c) {
+    if (!in_range(c->weight, 0.1f * 1000.0f, 1e6f * 1000.0f)) return 0;
+    for (int d = 0; d < MAX_DIMENSION; d++)
+        if (!in_range(c->dimensions[d], 0.1f, 1e4f)) return 0;
+    return isfinite(c->pos_x) && isfinite(c->pos_y) && isfinite(c->pos_z);
+}
+
+static int load_dg(const CfbImage *img, uint32_t idx, DGInfo *dg) {
+    const unsigned char *p = img->base + img->dg_offset + (uint64_t)idx * CFB_DG_SIZE;
+    memset(dg, 0, sizeof(*dg));
+    dg->dg_class = p[D_CLASS];
+    dg->dg_division = p[D_DIVISION];
+    if (p[D_STOWAGE] > STOW_UNDER_DECK) return -1;
+    dg->stowage = (StowageCategory)p[D_STOWAGE];
+    memcpy(dg->un_number, p + D_UN, sizeof(dg->un_number) - 1);
+    memcpy(dg->ems, p + D_EMS, sizeof(dg->ems) - 1);
+    return dg->dg_class >= 1 && dg->dg_class <= 9 ? 0 : -1;
+}
+
+int cfb_load(const CfbImage *img, Ship *ship, AnalysisResult *result) {
+    uint32_t n = img->cargo_count;
+    const char *strings = (const char *)img->base + img->strings_offset;
+    int plan = (img->flags & CFB_FLAG_PLAN) != 0;
+
+    Cargo *cargo = ship_alloc(ship, (n ? (size_t)n : 1) * sizeof(Cargo));
+    if (!cargo) {
+        fprintf(stderr, "Error: Failed to allocate memory for cargo.\n");
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        const unsigned char *r = img->base + img->cargo_offset + (uint64_t)i * img->record_size;
+        Cargo *c = &cargo[i];
+        memset(c, 0, sizeof(*c));
+
+        uint32_t id = get_u32(r + R_ID), type = get_u32(r + R_TYPE);
+        size_t id_len = id < img->strings_size ? strlen(strings + id) : 0;
+        size_t type_len = type < img->strings_size ? strlen(strings + type) : 0;
+        if (id_len == 0 || id_len >= sizeof(((CargoLabel *)0)->id) ||
+            type >= img->strings_size || type_len >= sizeof(((CargoLabel *)0)->type)) {
+            fprintf(stderr, "Error: Invalid ID or type in binary cargo record %u\n", i);
+            goto fail;
+        }
+        if (cargo_set_label(ship, c, strings + id, id_len, strings + type, type_len) != 0) {
+            fprintf(stderr, "Error: Failed to allocate memory for cargo.\n");
+            goto fail;
+        }
+
+        c->weight = get_f32(r + R_WEIGHT);
+        for (int d = 0; d < MAX_DIMENSION; d++)
+            c->dimensions[d] = get_f32(r + R_DIMS + 4 * d);
+        c->pos_x = plan ? get_f32(r + R_POS) : -1.0f;
+        c->pos_y = plan ? get_f32(r + R_POS + 4) : -1.0f;
+        c->pos_z = plan ? get_f32(r + R_POS + 8) : -1.0f;
+        if (c->pos_x >= 0.0f) c->flags |= CARGO_PLACED;
+        if (!record_values_ok(c)) {
+            fprintf(stderr, "Error: Out-of-range values for cargo '%s' in binary record %u\n",
+                    CARGO_ID(c), i);
+            goto fail;
+        }
+
+        uint32_t dg_idx = get_u32(r + R_DG);
+        if (dg_idx != CFB_NO_DG) {
+            DGInfo dg;
+            if (dg_idx >= img->dg_count || load_dg(img, dg_idx, &dg) != 0) {
+                fprintf(stderr, "Error: Invalid DG record for cargo '%s'\n", CARGO_ID(c));
+                goto fail;
+            }
+            DGInfo *slot = dg_pool_alloc(ship);
+            if (!slot) {
+                fprintf(stderr, "Error: Failed to allocate memory for DG info.\n");
+                goto fail;
+            }
+            *slot = dg;
+            c->dg = (struct DGInfo_ *)slot;
+            c->dg_index = (unsigned char)(imdg_class_index(dg.dg_class, dg.dg_division) + 1);
+        }
+    }
+
+    ship->cargo = cargo;
+    ship->cargo_count = (int)n;
+    ship->cargo_capacity = n ? (int)n : 1;
+
+    if (ship->length == 0.0f) {
+        ship->length = img->length;
+        ship->width = img->width;
+        ship->max_weight = img->max_weight;
+        ship->lightship_weight = img->lightship_weight;
+        ship->lightship_kg = img->lightship_kg;
+    }
+
+    if (result) {
+        memset(result, 0, sizeof(*result));
+        if (img->flags & CFB_FLAG_RESULT) {
+            const unsigned char *p = img->base + img->result_offset;
+            for (int f = 0; f < RESULT_FIELD_COUNT; f++) {
+                char *field = (char *)result + RESULT_FIELDS[f].offset;
+                if (RESULT_FIELDS[f].is_int) {
+                    int v = (int)(int32_t)get_u32(p + 4 * f);
+                    memcpy(field, &v, sizeof(v));
+                } else {
+                    float v = get_f32(p + 4 * f);
+                    memcpy(field, &v, sizeof(v));
+                }
+            }
+        }
+    }
+    return 0;
+
+fail:
+    ship_free(ship, cargo);
+    cargo_pools_destroy(ship);
+    ship->cargo = NULL;
+    ship->cargo_count = 0;
+    return -1;
+}
+
+int cfb_load_manifest(const char *path, Ship *ship) {
+    if (!cfb_is_binary_file(path))
+        return parse_cargo_list(path, ship);
+
+    CfbImage img;
+    if (cfb_open(path, &img) != 0) return -1;
+    int rc = cfb_load(&img, ship, NULL);
+    cfb_close(&img);
+    if (rc != 0) return -1;
+
+    for (int i = 0; i < ship->cargo_count; i++)
+        CARGO_UNPLACE(&ship->cargo[i]);
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* TEXT EXPORT                                                        */
+/* ------------------------------------------------------------------ */
+
+/** Tonnes value the parser turns back into exactly kg (it stores t * 1000) */
+static float tonnes_for(float kg) {
+    float t = kg / 1000.0f;
+    for (int step = 0; step < 4; step++) {
+        float back = t * 1000.0f;
+        if (back == kg) break;
+        t = nextafterf(t, back < kg ? INFINITY : -INFINITY);
+    }
+    return t;
+}
+
+/** Shortest %g form that strtof() reads back as exactly v */
+static const char *fmt_float(char buf[32], float v) {
+    for (int prec = 6; prec < 9; prec++) {
+        snprintf(buf, 32, "%.*g", prec, v);
+        if (strtof(buf, NULL) == v) return buf;
+    }
+    snprintf(buf, 32, "%.9g", v);
+    return buf;
+}
+
+int cfb_write_manifest_text(FILE *fp, const Ship *ship) {
+    char w[32], l[32], b[32], h[32];
+    for (int i = 0; i < ship->cargo_count; i++) {
+        const Cargo *c = &ship->cargo[i];
+        fprintf(fp, "%s %s %sx%sx%s %s", CARGO_ID(c), fmt_float(w, tonnes_for(c->weight)),
+                fmt_float(l, c->dimensions[0]), fmt_float(b, c->dimensions[1]),
+                fmt_float(h, c->dimensions[2]), CARGO_TYPE(c));
+
+        const DGInfo *dg = (const DGInfo *)c->dg;
+        if (dg) {
+            /* Trailing empty fields are dropped: the parser skips empty ones */
+            fprintf(fp, " DG:%d", dg->dg_class);
+            if (dg->dg_division) fprintf(fp, ".%d", dg->dg_division);
+            if (dg->un_number[0]) {
+                fprintf(fp, ":%s", dg->un_number);
+                if (dg->stowage != STOW_ANY || dg->ems[0])
+                    fprintf(fp, ":%c", dg->stowage == STOW_ON_DECK ? 'D' :
+                                       dg->stowage == STOW_UNDER_DECK ? 'U' : 'A');
+                if (dg->ems[0]) fprintf(fp, ":%s", dg->ems);
+            }
+        }
+        fputc('\n', fp);
+    }
+    return ferror(fp) ? -1 : 0;
+}
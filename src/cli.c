@@ -8,6 +8,10 @@
 #include "json_output.h"
 #include "imdg.h"
 #include "server.h"
+#include "batch.h"
+#include "optimizer.h"
+#include "holds.h"
+#include "binfmt.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -47,6 +51,22 @@ static void load_config_file(CLIContext *ctx, const char *config_path) {
         else if (strcmp(key, "show_viz") == 0) {
             ctx->show_viz = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
         }
+        else if (strcmp(key, "threads") == 0) {
+            int n = atoi(value);
+            if (n >= 0) ctx->threads = n;
+        }
+        else if (strcmp(key, "strategy") == 0) {
+            if (strcmp(value, "multistart") == 0) ctx->strategy = STRATEGY_MULTISTART;
+            else if (strcmp(value, "ffd") == 0) ctx->strategy = STRATEGY_FFD;
+        }
+        else if (strcmp(key, "placer") == 0) {
+            if (strcmp(value, "extreme-points") == 0) ctx->placer = PLACER_EXTREME_POINTS;
+            else if (strcmp(value, "guillotine") == 0) ctx->placer = PLACER_GUILLOTINE;
+        }
+        else if (strcmp(key, "time_budget_ms") == 0) {
+            int n = atoi(value);
+            if (n >= 0) ctx->time_budget_ms = n;
+        }
     }
 
     fclose(fp);
@@ -57,6 +77,10 @@ void init_cli_context(CLIContext *ctx) {
     ctx->format = FORMAT_HUMAN;
     ctx->show_viz = true;
     ctx->color = isatty(STDERR_FILENO);
+    ctx->threads = 1;
+    ctx->port = 8080;
+    ctx->queue_depth = 64;
+    ctx->cache_mb = 64;
     g_ctx = ctx;
 
     char *home = getenv("HOME");
@@ -92,7 +116,10 @@ void print_general_help(const char *prog_name) {
     printf("  optimize    Run 3D bin-packing optimization\n");
     printf("  validate    Validate ship config and cargo manifest\n");
     printf("  info        Display ship and cargo statistics\n");
+    printf("  convert     Convert manifests and plans between text and binary\n");
     printf("  serve       Start JSON-RPC HTTP server\n");
+    printf("  batch       Optimize many voyages in one run, one result per line\n");
+    printf("  sequence    Check stability and strength after every load/discharge move\n");
     printf("  version     Display version information\n");
     printf("  help        Show this help message\n\n");
 
@@ -106,19 +133,29 @@ void print_general_help(const char *prog_name) {
     printf("  %s optimize ship.cfg cargo.txt\n", prog_name);
     printf("  %s optimize ship.cfg cargo.txt --format=json\n", prog_name);
     printf("  %s validate ship.cfg cargo.txt\n", prog_name);
-    printf("  %s info ship.cfg cargo.txt\n\n", prog_name);
+    printf("  %s info ship.cfg cargo.txt\n", prog_name);
+    printf("  %s convert cargo.txt cargo.cfb\n", prog_name);
+    printf("  %s batch jobs.txt --format=csv --output=fleet.csv\n", prog_name);
+    printf("  %s sequence ship.cfg cargo.txt --moves=moves.txt\n\n", prog_name);
 }
 
 void print_subcommand_help(const char *subcommand) {
     if (strcmp(subcommand, "optimize") == 0) {
         printf("cargoforge optimize <ship_config> <cargo_manifest> [options]\n\n");
         printf("OPTIONS:\n");
-        printf("  --format=FORMAT      Output: human|json|csv|table|markdown\n");
+        printf("  --format=FORMAT      Output: human|json|csv|table|markdown|binary\n");
         printf("  --output=FILE        Write output to file\n");
+        printf("  --compact            JSON without indentation or line breaks\n");
+        printf("  --load-map           JSON: add per-compartment floor load (t/m2) grids\n");
         printf("  --no-viz             Disable ASCII visualization\n");
         printf("  --only-placed        Show only placed cargo\n");
         printf("  --only-failed        Show only failed cargo\n");
         printf("  --type=TYPE          Filter by cargo type\n");
+        printf("  --threads=N          Worker threads (0 = all CPUs, default 1)\n");
+        printf("  --strategy=NAME      ffd (default) | multistart\n");
+        printf("  --time-budget=MS     Wall-clock limit for multistart search\n");
+        printf("  --beam=K             Orderings kept between multistart rounds (default 4)\n");
+        printf("  --placer=NAME        guillotine (default) | extreme-points\n");
         printf("  -v, --verbose        Verbose output\n");
     }
     else if (strcmp(subcommand, "validate") == 0) {
@@ -131,16 +168,71 @@ void print_subcommand_help(const char *subcommand) {
         printf("OPTIONS:\n");
         printf("  --format=FORMAT      Output: human|json\n");
     }
+    else if (strcmp(subcommand, "convert") == 0) {
+        printf("cargoforge convert <input> <output> [options]\n\n");
+        printf("A text manifest is written as a binary .cfb manifest. A .cfb file is\n");
+        printf("written back as a text manifest, or with --format its stored plan is\n");
+        printf("rendered without re-optimizing. '-' is stdin/stdout. The optimize and\n");
+        printf("validate subcommands accept .cfb manifests directly.\n\n");
+        printf("OPTIONS:\n");
+        printf("  --format=FORMAT      Plan output: json|csv|table|markdown\n\n");
+        printf("EXAMPLES:\n");
+        printf("  cargoforge convert cargo.txt cargo.cfb\n");
+        printf("  cargoforge optimize ship.cfg cargo.cfb --format=binary --output=plan.cfb\n");
+        printf("  cargoforge convert plan.cfb plan.json --format=json\n");
+    }
     else if (strcmp(subcommand, "serve") == 0) {
         printf("cargoforge serve [options]\n\n");
         printf("Start a JSON-RPC 2.0 HTTP server exposing the CargoForge API.\n\n");
         printf("OPTIONS:\n");
         printf("  --port=PORT          TCP port (default: 8080)\n");
+        printf("  --workers=N          Worker threads (0 = all CPUs, default 0)\n");
+        printf("  --queue-depth=N      Requests in flight before 503 Busy (default: 64)\n");
+        printf("  --cache-mb=N         Result cache for repeated optimize calls (0 = off, default: 64)\n");
         printf("  -v, --verbose        Log requests to stderr\n\n");
+        printf("Connections are kept alive (HTTP/1.1); idle ones close after 5 s.\n");
+        printf("version calls are answered even when the worker queue is full.\n\n");
         printf("METHODS:\n");
         printf("  optimize    — params: {ship_config, cargo_manifest}\n");
         printf("  validate    — params: {ship_config, cargo_manifest?}\n");
         printf("  version     — no params\n");
+        printf("  cache_stats — no params: result cache hits, misses, evictions, size\n");
+    }
+    else if (strcmp(subcommand, "batch") == 0) {
+        printf("cargoforge batch <job_list|directory> [ship_config] [options]\n\n");
+        printf("Optimize many voyages in one process. Each line of the job list is\n");
+        printf("'<ship_config> <cargo_manifest>', or just '<cargo_manifest>' to use the\n");
+        printf("ship_config argument; '#' starts a comment and '-' reads the list from\n");
+        printf("stdin. A directory runs every file in it against ship_config. Ship\n");
+        printf("configs are parsed once and shared; jobs run on a worker pool and one\n");
+        printf("line per job is written, in job order, as soon as it is ready.\n\n");
+        printf("OPTIONS:\n");
+        printf("  --format=FORMAT      json (NDJSON, default) | csv (one summary row per job)\n");
+        printf("  --output=FILE        Write results to file\n");
+        printf("  --workers=N          Worker threads (0 = all CPUs, default 0)\n");
+        printf("  --strategy=NAME      ffd (default) | multistart\n");
+        printf("  --time-budget=MS     Wall-clock limit for each job's multistart search\n");
+        printf("  --beam=K             Orderings kept between multistart rounds (default 4)\n");
+        printf("  --placer=NAME        guillotine (default) | extreme-points\n");
+        printf("  -q, --quiet          No run summary on stderr\n\n");
+        printf("A job that fails gets a line with status \"error\" and the run goes on;\n");
+        printf("the exit status is then %d.\n", EXIT_OPTIMIZATION_ERROR);
+    }
+    else if (strcmp(subcommand, "sequence") == 0) {
+        printf("cargoforge sequence <ship_config> <cargo_manifest> [options]\n\n");
+        printf("Plan the cargo as optimize does, then walk a loading sequence and report\n");
+        printf("draft, trim, heel, GM and the shear force and bending moment peaks after\n");
+        printf("every move. The moves file has one 'load ID' or 'discharge ID' per line\n");
+        printf("(L / D for short, '#' comments); an item whose first move is a discharge\n");
+        printf("starts on board, as does a placed item the file never names. Without\n");
+        printf("--moves every placed item is loaded onto an empty ship in plan order.\n\n");
+        printf("OPTIONS:\n");
+        printf("  --moves=FILE         Load/discharge list ('-' = stdin)\n");
+        printf("  --format=FORMAT      human (default) | csv | json (one step per line)\n");
+        printf("  --output=FILE        Write the timeline to file\n");
+        printf("  --strategy, --placer, --threads, --time-budget, --beam as for optimize\n\n");
+        printf("Exit status is %d when a move is invalid for the plan (unplaced item,\n", EXIT_VALIDATION_ERROR);
+        printf("or loaded or discharged twice in a row).\n");
     }
     else {
         printf("No help available for: %s\n", subcommand);
@@ -204,6 +296,18 @@ int parse_cli_args(int argc, char *argv[], CLIContext *ctx) {
         {"only-failed", no_argument,       0, 'F'},
         {"type",        required_argument, 0, 't'},
         {"json",        no_argument,       0, 'j'},
+        {"compact",     no_argument,       0, 'C'},
+        {"load-map",    no_argument,       0, 'L'},
+        {"threads",     required_argument, 0, 'T'},
+        {"strategy",    required_argument, 0, 'S'},
+        {"time-budget", required_argument, 0, 'B'},
+        {"beam",        required_argument, 0, 'K'},
+        {"placer",      required_argument, 0, 'E'},
+        {"port",        required_argument, 0, 'P'},
+        {"workers",     required_argument, 0, 'W'},
+        {"queue-depth", required_argument, 0, 'Q'},
+        {"cache-mb",    required_argument, 0, 'M'},
+        {"moves",       required_argument, 0, 'm'},
         {0, 0, 0, 0}
     };
 
@@ -220,6 +324,7 @@ int parse_cli_args(int argc, char *argv[], CLIContext *ctx) {
                 else if (strcmp(optarg, "table") == 0) ctx->format = FORMAT_TABLE;
                 else if (strcmp(optarg, "markdown") == 0) ctx->format = FORMAT_MARKDOWN;
                 else if (strcmp(optarg, "human") == 0) ctx->format = FORMAT_HUMAN;
+                else if (strcmp(optarg, "binary") == 0) ctx->format = FORMAT_BINARY;
                 else { fprintf(stderr, "Error: Unknown format '%s'\n", optarg); return -1; }
                 break;
             case 'o': ctx->output_file = optarg; break;
@@ -229,6 +334,63 @@ int parse_cli_args(int argc, char *argv[], CLIContext *ctx) {
             case 'F': ctx->only_failed = true; break;
             case 't': ctx->cargo_type_filter = optarg; break;
             case 'j': ctx->format = FORMAT_JSON; ctx->show_viz = false; break;
+            case 'C': ctx->compact = true; break;
+            case 'L': ctx->load_map = true; break;
+            case 'm': ctx->moves_file = optarg; break;
+            case 'T': {
+                char *end;
+                long n = strtol(optarg, &end, 10);
+                if (*optarg == '\0' || *end != '\0' || n < 0 || n > 1024) {
+                    fprintf(stderr, "Error: Invalid thread count '%s'\n", optarg);
+                    return -1;
+                }
+                ctx->threads = (int)n;
+                break;
+            }
+            case 'S':
+                if (strcmp(optarg, "ffd") == 0) ctx->strategy = STRATEGY_FFD;
+                else if (strcmp(optarg, "multistart") == 0) ctx->strategy = STRATEGY_MULTISTART;
+                else { fprintf(stderr, "Error: Unknown strategy '%s'\n", optarg); return -1; }
+                break;
+            case 'E':
+                if (strcmp(optarg, "guillotine") == 0) ctx->placer = PLACER_GUILLOTINE;
+                else if (strcmp(optarg, "extreme-points") == 0) ctx->placer = PLACER_EXTREME_POINTS;
+                else { fprintf(stderr, "Error: Unknown placer '%s'\n", optarg); return -1; }
+                break;
+            case 'B':
+            case 'K': {
+                char *end;
+                long n = strtol(optarg, &end, 10);
+                if (*optarg == '\0' || *end != '\0' || n < 0 || n > 100000000L ||
+                    (opt == 'K' && (n < 1 || n > 1024))) {
+                    fprintf(stderr, "Error: Invalid value '%s' for --%s\n",
+                            optarg, opt == 'B' ? "time-budget" : "beam");
+                    return -1;
+                }
+                if (opt == 'B') ctx->time_budget_ms = (int)n;
+                else ctx->beam_width = (int)n;
+                break;
+            }
+            case 'P':
+            case 'W':
+            case 'Q':
+            case 'M': {
+                char *end;
+                long n = strtol(optarg, &end, 10);
+                long lo = (opt == 'W' || opt == 'M') ? 0 : 1;
+                long hi = (opt == 'P') ? 65535 : (opt == 'W') ? 1024 : 1000000;
+                if (*optarg == '\0' || *end != '\0' || n < lo || n > hi) {
+                    fprintf(stderr, "Error: Invalid value '%s' for --%s\n", optarg,
+                            opt == 'P' ? "port" : opt == 'W' ? "workers" :
+                            opt == 'Q' ? "queue-depth" : "cache-mb");
+                    return -1;
+                }
+                if (opt == 'P') ctx->port = (int)n;
+                else if (opt == 'W') ctx->workers = (int)n;
+                else if (opt == 'Q') ctx->queue_depth = (int)n;
+                else ctx->cache_mb = (int)n;
+                break;
+            }
             default: return -1;
         }
     }
@@ -250,7 +412,10 @@ int dispatch_subcommand(CLIContext *ctx) {
     if (strcmp(ctx->subcommand, "optimize") == 0) return cmd_optimize(ctx);
     if (strcmp(ctx->subcommand, "validate") == 0) return cmd_validate(ctx);
     if (strcmp(ctx->subcommand, "info") == 0)     return cmd_info(ctx);
+    if (strcmp(ctx->subcommand, "convert") == 0)  return cmd_convert(ctx);
     if (strcmp(ctx->subcommand, "serve") == 0)    return cmd_serve(ctx);
+    if (strcmp(ctx->subcommand, "batch") == 0)    return cmd_batch(ctx);
+    if (strcmp(ctx->subcommand, "sequence") == 0) return cmd_sequence(ctx);
     if (strcmp(ctx->subcommand, "version") == 0)  return cmd_version(ctx);
     if (strcmp(ctx->subcommand, "help") == 0)     return cmd_help(ctx);
 
@@ -260,32 +425,68 @@ int dispatch_subcommand(CLIContext *ctx) {
 
 /* --- SUBCOMMAND: optimize --- */
 
-int cmd_optimize(CLIContext *ctx) {
-    if (!ctx->ship_file || !ctx->cargo_file) {
-        fprintf(stderr, "Usage: cargoforge optimize <ship_config> <cargo_manifest> [options]\n");
-        return EXIT_INVALID_ARGS;
-    }
-
-    Ship ship = {0};
+/* Parse the ship and manifest and place the cargo as optimize does.
+ * Returns EXIT_SUCCESS or the exit code, with ship cleaned up on error. */
+static int load_and_place(CLIContext *ctx, Ship *ship) {
+    memset(ship, 0, sizeof(*ship));
 
     if (ctx->verbose) fprintf(stderr, "Parsing ship configuration...\n");
-    if (parse_ship_config(ctx->ship_file, &ship) != 0) {
+    if (parse_ship_config(ctx->ship_file, ship) != 0) {
         print_error_with_context(ctx->ship_file, 0, "Failed to parse ship configuration");
         return EXIT_PARSE_ERROR;
     }
     if (!ctx->quiet) print_success("Ship configuration loaded");
 
     if (ctx->verbose) fprintf(stderr, "Parsing cargo manifest...\n");
-    if (parse_cargo_list(ctx->cargo_file, &ship) != 0) {
+    if (cfb_load_manifest(ctx->cargo_file, ship) != 0) {
         print_error_with_context(ctx->cargo_file, 0, "Failed to parse cargo manifest");
-        ship_cleanup(&ship);
+        ship_cleanup(ship);
         return EXIT_PARSE_ERROR;
     }
     if (!ctx->quiet) print_success("Cargo manifest loaded");
 
     if (!ctx->quiet) fprintf(stderr, "\nRunning 3D bin-packing...\n");
-    place_cargo_3d(&ship);
+    if (ctx->strategy == STRATEGY_MULTISTART) {
+        OptimizerOptions oopts;
+        OptimizerStats stats;
+        optimizer_options_init(&oopts);
+        oopts.threads = ctx->threads;
+        oopts.time_budget_ms = ctx->time_budget_ms;
+        if (ctx->beam_width > 0) oopts.beam_width = ctx->beam_width;
+        oopts.engine = ctx->placer;
+
+        if (optimize_multi_start(ship, &oopts, &stats) != 0) {
+            print_error_with_context(ctx->cargo_file, 0, "Out of memory during multistart search");
+            ship_cleanup(ship);
+            return EXIT_OPTIMIZATION_ERROR;
+        }
+        if (!ctx->quiet)
+            fprintf(stderr, "Multistart: %d attempts in %d rounds (%.0f ms%s), best: %s "
+                    "(round %d), %d/%d items placed\n",
+                    stats.attempts, stats.rounds, stats.elapsed_ms,
+                    stats.budget_exhausted ? ", budget reached" : "",
+                    sort_key_name(stats.best_strategy), stats.best_round,
+                    stats.best_placed, ship->cargo_count);
+    } else {
+        PlacementOptions popts;
+        placement_options_init(&popts);
+        popts.threads = ctx->threads;
+        popts.engine = ctx->placer;
+        place_cargo_3d_opts(ship, &popts);
+    }
     if (!ctx->quiet) print_success("Optimization complete");
+    return EXIT_SUCCESS;
+}
+
+int cmd_optimize(CLIContext *ctx) {
+    if (!ctx->ship_file || !ctx->cargo_file) {
+        fprintf(stderr, "Usage: cargoforge optimize <ship_config> <cargo_manifest> [options]\n");
+        return EXIT_INVALID_ARGS;
+    }
+
+    Ship ship;
+    int rc = load_and_place(ctx, &ship);
+    if (rc != EXIT_SUCCESS) return rc;
 
     AnalysisResult result = perform_analysis(&ship);
     output_results(&ship, &result, ctx->format, ctx->output_file);
@@ -319,7 +520,7 @@ int cmd_validate(CLIContext *ctx) {
     }
 
     fprintf(stderr, "\nValidating cargo manifest: %s\n", ctx->cargo_file);
-    if (parse_cargo_list(ctx->cargo_file, &ship) != 0) {
+    if (cfb_load_manifest(ctx->cargo_file, &ship) != 0) {
         print_error_with_context(ctx->cargo_file, 0, "Invalid cargo manifest");
         errors++;
     } else {
@@ -363,7 +564,7 @@ int cmd_info(CLIContext *ctx) {
     }
 
     if (ctx->cargo_file) {
-        if (parse_cargo_list(ctx->cargo_file, &ship) != 0) {
+        if (cfb_load_manifest(ctx->cargo_file, &ship) != 0) {
             print_error_with_context(ctx->cargo_file, 0, "Failed to parse cargo manifest");
             ship_cleanup(&ship);
             return EXIT_PARSE_ERROR;
@@ -375,21 +576,381 @@ int cmd_info(CLIContext *ctx) {
     return EXIT_SUCCESS;
 }
 
+/* --- SUBCOMMAND: convert --- */
+
+static FILE *open_output(const char *path, const char *mode) {
+    if (is_stdin(path)) return stdout;
+    FILE *fp = fopen(path, mode);
+    if (!fp) fprintf(stderr, "Error: Cannot open output file %s\n", path);
+    return fp;
+}
+
+int cmd_convert(CLIContext *ctx) {
+    const char *in = ctx->ship_file, *out = ctx->cargo_file;
+    if (!in || !out) {
+        fprintf(stderr, "Usage: cargoforge convert <input> <output> [--format=FORMAT]\n");
+        return EXIT_INVALID_ARGS;
+    }
+
+    Ship ship = {0};
+    int rc = EXIT_SUCCESS;
+
+    if (cfb_is_binary_file(in)) {
+        CfbImage img;
+        AnalysisResult result;
+        if (cfb_open(in, &img) != 0) {
+            print_error_with_context(in, 0, "Failed to open binary manifest");
+            return EXIT_PARSE_ERROR;
+        }
+        int loaded = cfb_load(&img, &ship, &result);
+        unsigned int flags = img.flags;
+        cfb_close(&img);
+        if (loaded != 0) {
+            print_error_with_context(in, 0, "Invalid binary manifest");
+            return EXIT_PARSE_ERROR;
+        }
+
+        if (ctx->format == FORMAT_HUMAN) {
+            FILE *fp = open_output(out, "w");
+            if (!fp) rc = EXIT_FILE_ERROR;
+            else {
+                if (cfb_write_manifest_text(fp, &ship) != 0) rc = EXIT_FILE_ERROR;
+                if (fp != stdout && fclose(fp) != 0) rc = EXIT_FILE_ERROR;
+            }
+        } else if (!(flags & CFB_FLAG_RESULT) && ctx->format != FORMAT_BINARY) {
+            print_error_with_context(in, 0, "No stored plan; convert it to a text manifest instead");
+            rc = EXIT_INVALID_ARGS;
+        } else {
+            output_results(&ship, (flags & CFB_FLAG_RESULT) ? &result : NULL,
+                           ctx->format, is_stdin(out) ? NULL : out);
+        }
+    } else {
+        if (parse_cargo_list(in, &ship) != 0) {
+            print_error_with_context(in, 0, "Failed to parse cargo manifest");
+            ship_cleanup(&ship);
+            return EXIT_PARSE_ERROR;
+        }
+        FILE *fp = open_output(out, "wb");
+        if (!fp) rc = EXIT_FILE_ERROR;
+        else {
+            if (cfb_write(fp, &ship, NULL) != 0) rc = EXIT_FILE_ERROR;
+            if (fp != stdout && fclose(fp) != 0) rc = EXIT_FILE_ERROR;
+        }
+    }
+
+    if (rc == EXIT_SUCCESS && !ctx->quiet && !is_stdin(out)) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "Converted %d cargo items", ship.cargo_count);
+        print_success(msg);
+    }
+    ship_cleanup(&ship);
+    return rc;
+}
+
 /* --- SUBCOMMAND: serve --- */
 
 int cmd_serve(CLIContext *ctx) {
-    int port = 8080;
-
-    /* Check for --port=PORT in ship_file (first positional arg after subcommand) */
-    if (ctx->ship_file && strncmp(ctx->ship_file, "--port=", 7) == 0) {
-        port = atoi(ctx->ship_file + 7);
-        if (port <= 0 || port > 65535) {
-            fprintf(stderr, "Error: Invalid port number\n");
-            return EXIT_INVALID_ARGS;
+    ServerOptions opts;
+    server_options_init(&opts);
+    opts.port = ctx->port;
+    opts.verbose = ctx->verbose;
+    opts.workers = ctx->workers;
+    opts.queue_depth = ctx->queue_depth;
+    opts.cache_bytes = (size_t)ctx->cache_mb << 20;
+
+    return cargoforge_serve_opts(&opts);
+}
+
+/* --- SUBCOMMAND: batch --- */
+
+int cmd_batch(CLIContext *ctx) {
+    if (!ctx->ship_file) {
+        fprintf(stderr, "Usage: cargoforge batch <job_list|directory> [ship_config] [options]\n");
+        return EXIT_INVALID_ARGS;
+    }
+    if (ctx->format != FORMAT_HUMAN && ctx->format != FORMAT_JSON && ctx->format != FORMAT_CSV) {
+        fprintf(stderr, "Error: batch output is json or csv\n");
+        return EXIT_INVALID_ARGS;
+    }
+
+    BatchOptions opts;
+    batch_options_init(&opts);
+    opts.jobs = ctx->ship_file;
+    opts.ship_config = ctx->cargo_file;
+    opts.format = ctx->format == FORMAT_CSV ? BATCH_CSV : BATCH_NDJSON;
+    opts.output_file = ctx->output_file;
+    opts.workers = ctx->workers;
+    opts.strategy = ctx->strategy;
+    opts.time_budget_ms = ctx->time_budget_ms;
+    opts.beam_width = ctx->beam_width;
+    opts.placer = ctx->placer;
+
+    BatchStats stats;
+    if (batch_run(&opts, &stats) != 0) return EXIT_FILE_ERROR;
+
+    if (!ctx->quiet)
+        fprintf(stderr, "Batch: %lld jobs, %lld failed, %.0f ms (%.1f jobs/s)\n",
+                stats.jobs, stats.failed, stats.elapsed_ms,
+                stats.elapsed_ms > 0 ? stats.jobs * 1000.0 / stats.elapsed_ms : 0.0);
+    return stats.failed > 0 ? EXIT_OPTIMIZATION_ERROR : EXIT_SUCCESS;
+}
+
+/* --- SUBCOMMAND: sequence --- */
+
+typedef struct {
+    const char *id;
+    int index;
+} CargoIdEntry;
+
+static int cmp_cargo_id(const void *a, const void *b) {
+    return strcmp(((const CargoIdEntry *)a)->id, ((const CargoIdEntry *)b)->id);
+}
+
+/* Read "load ID" / "discharge ID" lines (L / D for short, '#' comments)
+ * into a move array. Returns the move count, or -1 after reporting the
+ * error. */
+static int read_moves(const char *path, const Ship *ship, SequenceMove **out) {
+    FILE *fp = is_stdin(path) ? stdin : fopen(path, "r");
+    if (!fp) {
+        print_error_with_context(path, 0, "Cannot open moves file");
+        return -1;
+    }
+
+    CargoIdEntry *index = malloc((size_t)(ship->cargo_count > 0 ? ship->cargo_count : 1) *
+                                 sizeof(*index));
+    SequenceMove *moves = NULL;
+    int count = 0, capacity = 0, line_no = 0, rc = 0;
+    char line[256];
+
+    if (!index) {
+        fprintf(stderr, "Error: Out of memory\n");
+        rc = -1;
+        goto done;
+    }
+    for (int i = 0; i < ship->cargo_count; i++) {
+        index[i].id = CARGO_ID(&ship->cargo[i]);
+        index[i].index = i;
+    }
+    qsort(index, (size_t)ship->cargo_count, sizeof(*index), cmp_cargo_id);
+
+    while (fgets(line, sizeof(line), fp)) {
+        line_no++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+
+        char op_word[16], id[32];
+        int fields = sscanf(line, "%15s %31s", op_word, id);
+        if (fields <= 0) continue;
+
+        int op = 0;
+        if (strcmp(op_word, "load") == 0 || strcmp(op_word, "L") == 0) op = SEQ_LOAD;
+        else if (strcmp(op_word, "discharge") == 0 || strcmp(op_word, "D") == 0) op = SEQ_DISCHARGE;
+        if (fields != 2 || op == 0) {
+            print_error_with_context(path, line_no, "Expected 'load ID' or 'discharge ID'");
+            rc = -1;
+            goto done;
+        }
+
+        CargoIdEntry key = { id, 0 };
+        const CargoIdEntry *hit = bsearch(&key, index, (size_t)ship->cargo_count,
+                                          sizeof(*index), cmp_cargo_id);
+        if (!hit) {
+            char msg[96];
+            snprintf(msg, sizeof(msg), "Unknown cargo ID '%s'", id);
+            print_error_with_context(path, line_no, msg);
+            rc = -1;
+            goto done;
+        }
+
+        if (count >= capacity) {
+            int new_cap = capacity > 0 ? capacity * 2 : 64;
+            SequenceMove *grown = realloc(moves, (size_t)new_cap * sizeof(*moves));
+            if (!grown) {
+                fprintf(stderr, "Error: Out of memory\n");
+                rc = -1;
+                goto done;
+            }
+            moves = grown;
+            capacity = new_cap;
+        }
+        moves[count].cargo = hit->index;
+        moves[count].op = op;
+        count++;
+    }
+
+done:
+    if (fp != stdin) fclose(fp);
+    free(index);
+    if (rc != 0) {
+        free(moves);
+        return -1;
+    }
+    *out = moves;
+    return count;
+}
+
+static const char *step_status(const SequenceStep *st) {
+    if (st->overweight) return "OVERWEIGHT";
+    if (!st->imo_compliant) return "UNSTABLE";
+    if (st->strength_compliant == 0) return "STRENGTH";
+    return "OK";
+}
+
+static const char *step_op_name(int op) {
+    return op == SEQ_LOAD ? "load" : op == SEQ_DISCHARGE ? "discharge" : "initial";
+}
+
+/* Worst case for an escaped or CSV-quoted cargo id: every byte doubled,
+ * plus two quotes and the terminator */
+#define ESCAPED_ID_SIZE (2 * sizeof(((CargoLabel *)0)->id) + 3)
+
+/** Copy s into buf as a CSV field, quoted when it holds a separator or quote */
+static const char *csv_field(const char *s, char *buf, size_t size) {
+    if (!strpbrk(s, ",\"\r\n"))
+        return s;
+    size_t j = 0;
+    buf[j++] = '"';
+    for (; *s && j + 3 < size; s++) {
+        if (*s == '"') buf[j++] = '"';
+        buf[j++] = *s;
+    }
+    buf[j++] = '"';
+    buf[j] = '\0';
+    return buf;
+}
+
+static void print_sequence(FILE *fp, const Ship *ship, const SequenceStep *steps,
+                           int count, OutputFormat format) {
+    float worst_gm = 0.0f, max_sf = 0.0f, max_bm = 0.0f;
+    int worst_gm_step = -1, failing = 0;
+    char esc[ESCAPED_ID_SIZE];
+
+    for (int k = 0; k <= count; k++) {
+        const SequenceStep *st = &steps[k];
+        if (!st->overweight && (worst_gm_step < 0 || st->gm_corrected < worst_gm)) {
+            worst_gm = st->gm_corrected;
+            worst_gm_step = k;
+        }
+        if (st->max_shear_force > max_sf) max_sf = st->max_shear_force;
+        if (st->max_bending_moment > max_bm) max_bm = st->max_bending_moment;
+        if (strcmp(step_status(st), "OK") != 0) failing++;
+    }
+
+    if (format == FORMAT_CSV) {
+        fprintf(fp, "step,op,cargo_id,on_board,cargo_weight_t,displacement_t,draft_m,trim_m,"
+                    "heel_deg,gm_m,max_shear_t,max_bending_tm,imo_compliant,"
+                    "strength_compliant,overweight\n");
+        for (int k = 0; k <= count; k++) {
+            const SequenceStep *st = &steps[k];
+            fprintf(fp, "%d,%s,%s,%d,%.2f,%.2f,%.3f,%.3f,%.2f,%.3f,%.1f,%.1f,%d,%d,%d\n",
+                    k, step_op_name(st->op),
+                    csv_field(st->cargo >= 0 ? CARGO_ID(&ship->cargo[st->cargo]) : "", esc, sizeof(esc)),
+                    st->on_board, st->cargo_weight_t, st->displacement_t, st->draft,
+                    st->trim, st->heel, st->gm_corrected, st->max_shear_force,
+                    st->max_bending_moment, st->imo_compliant, st->strength_compliant,
+                    st->overweight);
+        }
+        return;
+    }
+
+    if (format == FORMAT_JSON) {
+        fprintf(fp, "{\"steps\":[\n");
+        for (int k = 0; k <= count; k++) {
+            const SequenceStep *st = &steps[k];
+            escape_json_string(st->cargo >= 0 ? CARGO_ID(&ship->cargo[st->cargo]) : "", esc, sizeof(esc));
+            fprintf(fp, "{\"step\":%d,\"op\":\"%s\",\"cargo_id\":\"%s\",\"on_board\":%d,"
+                        "\"cargo_weight_t\":%.2f,\"displacement_t\":%.2f,\"draft_m\":%.3f,"
+                        "\"trim_m\":%.3f,\"heel_deg\":%.2f,\"gm_m\":%.3f,"
+                        "\"max_shear_t\":%.1f,\"max_bending_tm\":%.1f,\"status\":\"%s\"}%s\n",
+                    k, step_op_name(st->op), esc, st->on_board, st->cargo_weight_t,
+                    st->displacement_t, st->draft, st->trim, st->heel, st->gm_corrected,
+                    st->max_shear_force, st->max_bending_moment, step_status(st),
+                    k < count ? "," : "");
         }
+        fprintf(fp, "],\n\"summary\":{\"moves\":%d,\"worst_gm_m\":%.3f,\"worst_gm_step\":%d,"
+                    "\"max_shear_t\":%.1f,\"max_bending_tm\":%.1f,\"failing_steps\":%d}}\n",
+                count, worst_gm, worst_gm_step, max_sf, max_bm, failing);
+        return;
     }
 
-    return cargoforge_serve(port, ctx->verbose);
+    fprintf(fp, "%5s  %-9s  %-12s %5s %10s %10s %7s %7s %6s %7s %9s %10s  %s\n",
+            "Step", "Move", "Cargo", "On", "Cargo(t)", "Disp(t)", "Draft", "Trim",
+            "Heel", "GM", "SF(t)", "BM(t-m)", "Status");
+    for (int k = 0; k <= count; k++) {
+        const SequenceStep *st = &steps[k];
+        fprintf(fp, "%5d  %-9s  %-12.12s %5d %10.1f %10.1f %7.2f %7.2f %6.2f %7.3f %9.1f %10.1f  %s\n",
+                k, step_op_name(st->op), st->cargo >= 0 ? CARGO_ID(&ship->cargo[st->cargo]) : "-",
+                st->on_board, st->cargo_weight_t, st->displacement_t, st->draft, st->trim,
+                st->heel, st->gm_corrected, st->max_shear_force, st->max_bending_moment,
+                step_status(st));
+    }
+    fprintf(fp, "\n%d moves, %d step(s) not compliant\n", count, failing);
+    if (worst_gm_step >= 0)
+        fprintf(fp, "Worst GM: %.3f m at step %d\n", worst_gm, worst_gm_step);
+    fprintf(fp, "Max shear force: %.1f t, max bending moment: %.1f t-m\n", max_sf, max_bm);
+}
+
+int cmd_sequence(CLIContext *ctx) {
+    if (!ctx->ship_file || !ctx->cargo_file) {
+        fprintf(stderr, "Usage: cargoforge sequence <ship_config> <cargo_manifest> "
+                        "[--moves=FILE] [options]\n");
+        return EXIT_INVALID_ARGS;
+    }
+    if (ctx->format != FORMAT_HUMAN && ctx->format != FORMAT_JSON && ctx->format != FORMAT_CSV) {
+        fprintf(stderr, "Error: sequence output is human, json or csv\n");
+        return EXIT_INVALID_ARGS;
+    }
+
+    Ship ship;
+    int rc = load_and_place(ctx, &ship);
+    if (rc != EXIT_SUCCESS) return rc;
+
+    SequenceMove *moves = NULL;
+    int count = 0;
+    if (ctx->moves_file) {
+        count = read_moves(ctx->moves_file, &ship, &moves);
+        if (count < 0) {
+            ship_cleanup(&ship);
+            return EXIT_PARSE_ERROR;
+        }
+    } else {
+        // Replay the plan: load every placed item in placement order
+        moves = malloc((size_t)(ship.cargo_count > 0 ? ship.cargo_count : 1) * sizeof(*moves));
+        if (moves) {
+            for (int i = 0; i < ship.cargo_count; i++) {
+                if (!CARGO_IS_PLACED(&ship.cargo[i])) continue;
+                moves[count].cargo = i;
+                moves[count].op = SEQ_LOAD;
+                count++;
+            }
+        }
+    }
+
+    SequenceStep *steps = moves ? malloc(((size_t)count + 1) * sizeof(*steps)) : NULL;
+    int sim = steps ? simulate_load_sequence(&ship, moves, count, steps) : -2;
+    if (sim != 0) {
+        if (sim == -1)
+            fprintf(stderr, "Error: Invalid load sequence: a move names an unplaced item, "
+                            "or loads or discharges an item twice in a row\n");
+        else
+            fprintf(stderr, "Error: Out of memory\n");
+        free(steps);
+        free(moves);
+        ship_cleanup(&ship);
+        return sim == -1 ? EXIT_VALIDATION_ERROR : EXIT_OPTIMIZATION_ERROR;
+    }
+
+    FILE *fp = ctx->output_file ? open_output(ctx->output_file, "w") : stdout;
+    if (!fp) rc = EXIT_FILE_ERROR;
+    else {
+        print_sequence(fp, &ship, steps, count, ctx->format);
+        if (fp != stdout && fclose(fp) != 0) rc = EXIT_FILE_ERROR;
+    }
+
+    free(steps);
+    free(moves);
+    ship_cleanup(&ship);
+    return rc;
 }
 
 /* --- SUBCOMMAND: version / help --- */
@@ -412,23 +973,20 @@ int cmd_help(CLIContext *ctx) {
 
 void output_results(Ship *ship, AnalysisResult *result, OutputFormat format, const char *output_file) {
     FILE *fp = stdout;
-    FILE *old_stdout = NULL;
 
     if (output_file) {
-        fp = fopen(output_file, "w");
+        fp = fopen(output_file, format == FORMAT_BINARY ? "wb" : "w");
         if (!fp) {
             fprintf(stderr, "Error: Cannot open output file %s\n", output_file);
             fp = stdout;
-        } else if (format == FORMAT_JSON) {
-            old_stdout = stdout;
-            stdout = fp;
         }
     }
 
     switch (format) {
         case FORMAT_JSON:
-            print_json_output(ship, result);
-            if (old_stdout) { fflush(stdout); stdout = old_stdout; }
+            fprint_json(fp, ship, result,
+                        (!(g_ctx && g_ctx->compact) ? JSON_PRETTY : 0) |
+                        (g_ctx && g_ctx->load_map ? JSON_LOAD_MAP : 0));
             break;
         case FORMAT_CSV:
             output_csv(ship, result, fp);
@@ -439,6 +997,9 @@ void output_results(Ship *ship, AnalysisResult *result, OutputFormat format, con
         case FORMAT_MARKDOWN:
             output_markdown(ship, result, fp);
             break;
+        case FORMAT_BINARY:
+            cfb_write(fp, ship, result);
+            break;
         case FORMAT_HUMAN:
         default:
             print_loading_plan(ship);
@@ -462,9 +1023,9 @@ void output_csv(Ship *ship, AnalysisResult *result, FILE *fp) {
     for (int i = 0; i < ship->cargo_count; i++) {
         Cargo *c = &ship->cargo[i];
         fprintf(fp, "%s,%.2f,%.2f,%.2f,%.2f,%s,%s,%.2f,%.2f,%.2f\n",
-                c->id, c->weight,
+                CARGO_ID(c), c->weight,
                 c->dimensions[0], c->dimensions[1], c->dimensions[2],
-                c->type, (c->pos_x >= 0) ? "yes" : "no",
+                CARGO_TYPE(c), CARGO_IS_PLACED(c) ? "yes" : "no",
                 c->pos_x, c->pos_y, c->pos_z);
     }
 }
@@ -476,20 +1037,20 @@ void output_table(Ship *ship, AnalysisResult *result, FILE *fp) {
 
     for (int i = 0; i < ship->cargo_count; i++) {
         Cargo *c = &ship->cargo[i];
-        if (g_ctx && g_ctx->only_placed && c->pos_x < 0) continue;
-        if (g_ctx && g_ctx->only_failed && c->pos_x >= 0) continue;
-        if (g_ctx && g_ctx->cargo_type_filter && strcmp(c->type, g_ctx->cargo_type_filter) != 0) continue;
+        if (g_ctx && g_ctx->only_placed && !CARGO_IS_PLACED(c)) continue;
+        if (g_ctx && g_ctx->only_failed && CARGO_IS_PLACED(c)) continue;
+        if (g_ctx && g_ctx->cargo_type_filter && strcmp(CARGO_TYPE(c), g_ctx->cargo_type_filter) != 0) continue;
 
         char pos[30];
-        if (c->pos_x >= 0)
+        if (CARGO_IS_PLACED(c))
             snprintf(pos, sizeof(pos), "(%.1f, %.1f, %.1f)", c->pos_x, c->pos_y, c->pos_z);
         else
             snprintf(pos, sizeof(pos), "-");
 
         fprintf(fp, "%-16s %9.2f %.1fx%.1fx%.1f%7s %-12s %7s %22s\n",
-                c->id, c->weight / 1000.0f,
+                CARGO_ID(c), c->weight / 1000.0f,
                 c->dimensions[0], c->dimensions[1], c->dimensions[2], "",
-                c->type, (c->pos_x >= 0) ? "YES" : "NO", pos);
+                CARGO_TYPE(c), CARGO_IS_PLACED(c) ? "YES" : "NO", pos);
     }
 
     fprintf(fp, "\nPlaced: %d / %d | Weight: %.2f t | GM: %.2f m\n",
@@ -513,10 +1074,10 @@ void output_markdown(Ship *ship, AnalysisResult *result, FILE *fp) {
     for (int i = 0; i < ship->cargo_count; i++) {
         Cargo *c = &ship->cargo[i];
         fprintf(fp, "| %s | %.2f | %.1fx%.1fx%.1f | %s | %s | ",
-                c->id, c->weight / 1000.0f,
+                CARGO_ID(c), c->weight / 1000.0f,
                 c->dimensions[0], c->dimensions[1], c->dimensions[2],
-                c->type, (c->pos_x >= 0) ? "Placed" : "Failed");
-        if (c->pos_x >= 0)
+                CARGO_TYPE(c), CARGO_IS_PLACED(c) ? "Placed" : "Failed");
+        if (CARGO_IS_PLACED(c))
             fprintf(fp, "(%.1f, %.1f, %.1f)", c->pos_x, c->pos_y, c->pos_z);
         else
             fprintf(fp, "N/A");
@@ -581,6 +1142,19 @@ void output_ship_info(Ship *ship, OutputFormat format) {
         printf("  Lightship: %.2f t\n", ship->lightship_weight / 1000.0f);
         printf("  Lightship KG: %.2f m\n", ship->lightship_kg);
 
+        const HoldConfig *hc = ship->holds;
+        if (hc && hc->count > 0) {
+            printf("\nCompartments (%d):\n", hc->count);
+            for (int h = 0; h < hc->count; h++) {
+                const HoldDef *d = &hc->holds[h];
+                printf("  %-12s %6.1f x %5.1f x %4.1f m at (%.1f, %.1f, %.1f), %.0f t, %s\n",
+                       d->name, d->length, d->width, d->height, d->x, d->y, d->z,
+                       d->max_weight / 1000.0f, hold_flags_name(d->flags));
+            }
+        } else {
+            printf("\nCompartments: default layout (forward hold, aft hold, deck)\n");
+        }
+
         if (ship->cargo_count > 0) {
             printf("\nCargo Summary:\n");
             printf("  Items: %d\n", ship->cargo_count);
@@ -588,9 +1162,10 @@ void output_ship_info(Ship *ship, OutputFormat format) {
             int hazardous = 0, reefer = 0, fragile = 0;
             for (int i = 0; i < ship->cargo_count; i++) {
                 total_weight += ship->cargo[i].weight;
-                if (strcmp(ship->cargo[i].type, "hazardous") == 0) hazardous++;
-                if (strcmp(ship->cargo[i].type, "reefer") == 0) reefer++;
-                if (strcmp(ship->cargo[i].type, "fragile") == 0) fragile++;
+                unsigned char flags = ship->cargo[i].flags;
+                if (flags & CARGO_HAZARDOUS) hazardous++;
+                if (flags & CARGO_REEFER) reefer++;
+                if (flags & CARGO_FRAGILE) fragile++;
             }
             printf("  Total weight: %.2f t\n", total_weight / 1000.0f);
             printf("  Utilization: %.1f%%\n", (total_weight / ship->max_weight) * 100.0f);
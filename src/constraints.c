@@ -8,24 +8,29 @@
  * - Deck weight ratio
  * - Fragile cargo protection
  * - Reefer zone preferences
+ *
+ * Checks return a DiagCode and print nothing; the placer aggregates the
+ * reasons per cargo item (diagnostics.h).
  */
 
 #include "constraints.h"
 #include "imdg.h"
-#include <string.h>
+#include "spatial_index.h"
+#include "stack_grid.h"
+#include "holds.h"
+#include <float.h>
 #include <math.h>
-#include <stdio.h>
 
 int is_hazardous(const Cargo *cargo) {
-    return (strcmp(cargo->type, CARGO_TYPE_HAZARDOUS) == 0);
+    return (cargo->flags & CARGO_HAZARDOUS) != 0;
 }
 
 int is_fragile(const Cargo *cargo) {
-    return (strcmp(cargo->type, CARGO_TYPE_FRAGILE) == 0);
+    return (cargo->flags & CARGO_FRAGILE) != 0;
 }
 
 int is_reefer(const Cargo *cargo) {
-    return (strcmp(cargo->type, CARGO_TYPE_REEFER) == 0);
+    return (cargo->flags & CARGO_REEFER) != 0;
 }
 
 float calculate_point_load(const Cargo *cargo) {
@@ -34,26 +39,86 @@ float calculate_point_load(const Cargo *cargo) {
     return (cargo->weight / 1000.0f) / area;  /* t/m2 */
 }
 
+/* Legacy 3m rule for one already-placed item; returns 1 if too close */
+static int hazmat_too_close(const Cargo *c, const Cargo *new_cargo,
+                            float x, float y, float z) {
+    if (!CARGO_IS_PLACED(c) || c == new_cargo || !is_hazardous(c)) return 0;
+
+    float dx = c->pos_x - x;
+    float dy = c->pos_y - y;
+    float dz = c->pos_z - z;
+    float dist = sqrtf(dx*dx + dy*dy + dz*dz);
+    return dist < MIN_HAZMAT_SEPARATION;
+}
+
+typedef struct {
+    const Ship  *ship;
+    const Cargo *new_cargo;
+    float x, y, z;
+} HazmatQuery;
+
+static int visit_hazmat(int cargo_idx, void *ctx) {
+    const HazmatQuery *q = ctx;
+    return hazmat_too_close(&q->ship->cargo[cargo_idx], q->new_cargo, q->x, q->y, q->z);
+}
+
 int check_hazmat_separation(const Ship *ship, const Cargo *new_cargo,
                             float x, float y, float z) {
     if (!is_hazardous(new_cargo))
         return 1;
 
+    if (ship->placed_index) {
+        HazmatQuery q = { ship, new_cargo, x, y, z };
+        float r = MIN_HAZMAT_SEPARATION;
+        return !spatial_index_query(ship->placed_index, x - r, y - r, x + r, y + r,
+                                    visit_hazmat, &q);
+    }
+
     for (int i = 0; i < ship->cargo_count; i++) {
-        const Cargo *c = &ship->cargo[i];
-        if (c->pos_x < 0 || c == new_cargo) continue;
+        if (hazmat_too_close(&ship->cargo[i], new_cargo, x, y, z))
+            return 0;
+    }
+    return 1;
+}
+
+/* Weight (t) of one placed item bearing on the footprint at (x, y, z) */
+static float stack_contribution(const Cargo *c, float x, float y, float z,
+                                float w, float d) {
+    if (!CARGO_IS_PLACED(c)) return 0.0f;
+
+    /* Only count cargo above this position */
+    if (c->pos_z <= z) return 0.0f;
 
-        if (is_hazardous(c)) {
-            float dx = c->pos_x - x;
-            float dy = c->pos_y - y;
-            float dz = c->pos_z - z;
-            float dist = sqrtf(dx*dx + dy*dy + dz*dz);
+    /* Check XY overlap (AABB intersection) */
+    float cx2 = c->pos_x + c->dimensions[0];
+    float cy2 = c->pos_y + c->dimensions[1];
+    float bx2 = x + w;
+    float by2 = y + d;
 
-            if (dist < MIN_HAZMAT_SEPARATION)
-                return 0;
+    float overlap_x = fminf(cx2, bx2) - fmaxf(c->pos_x, x);
+    float overlap_y = fminf(cy2, by2) - fmaxf(c->pos_y, y);
+
+    if (overlap_x > 0 && overlap_y > 0) {
+        float c_area = c->dimensions[0] * c->dimensions[1];
+        if (c_area > 0.01f) {
+            float overlap_frac = (overlap_x * overlap_y) / c_area;
+            return (c->weight / 1000.0f) * overlap_frac;
         }
     }
-    return 1;
+    return 0.0f;
+}
+
+typedef struct {
+    const Ship *ship;
+    float x, y, z, w, d;
+    float total;
+} StackQuery;
+
+static int visit_stack(int cargo_idx, void *ctx) {
+    StackQuery *q = ctx;
+    q->total += stack_contribution(&q->ship->cargo[cargo_idx],
+                                   q->x, q->y, q->z, q->w, q->d);
+    return 0;
 }
 
 float calculate_stack_pressure(const Ship *ship, float x, float y, float z,
@@ -62,81 +127,60 @@ float calculate_stack_pressure(const Ship *ship, float x, float y, float z,
     float footprint = w * d;
     if (footprint < 0.01f) return 0.0f;
 
-    for (int i = 0; i < ship->cargo_count; i++) {
-        const Cargo *c = &ship->cargo[i];
-        if (c->pos_x < 0) continue;
-
-        /* Only count cargo above this position */
-        if (c->pos_z <= z) continue;
-
-        /* Check XY overlap (AABB intersection) */
-        float cx2 = c->pos_x + c->dimensions[0];
-        float cy2 = c->pos_y + c->dimensions[1];
-        float bx2 = x + w;
-        float by2 = y + d;
-
-        float overlap_x = fminf(cx2, bx2) - fmaxf(c->pos_x, x);
-        float overlap_y = fminf(cy2, by2) - fmaxf(c->pos_y, y);
-
-        if (overlap_x > 0 && overlap_y > 0) {
-            float c_area = c->dimensions[0] * c->dimensions[1];
-            if (c_area > 0.01f) {
-                float overlap_frac = (overlap_x * overlap_y) / c_area;
-                total_weight_above += (c->weight / 1000.0f) * overlap_frac;
-            }
-        }
+    if (ship->stack_grid) {
+        total_weight_above = stack_grid_weight(ship->stack_grid, x, y, w, d, z, FLT_MAX);
+    } else if (ship->placed_index) {
+        StackQuery q = { ship, x, y, z, w, d, 0.0f };
+        spatial_index_query(ship->placed_index, x, y, x + w, y + d, visit_stack, &q);
+        total_weight_above = q.total;
+    } else {
+        for (int i = 0; i < ship->cargo_count; i++)
+            total_weight_above += stack_contribution(&ship->cargo[i], x, y, z, w, d);
     }
 
     return total_weight_above / footprint;
 }
 
-int check_cargo_constraints(const Ship *ship, const Cargo *cargo,
-                            const Bin3D *bin, const Space3D *space) {
+DiagCode constraint_check(const Ship *ship, const Cargo *cargo,
+                          const Bin3D *bin, const Space3D *space) {
 
     /* 1. Point load */
-    float point_load = calculate_point_load(cargo);
-    if (point_load > MAX_POINT_LOAD) {
-        fprintf(stderr, "Constraint: %s exceeds point load (%.1f > %.1f t/m2)\n",
-                cargo->id, point_load, MAX_POINT_LOAD);
-        return 0;
-    }
+    if (calculate_point_load(cargo) > MAX_POINT_LOAD)
+        return DIAG_POINT_LOAD;
 
     /* 2. Hazmat separation (IMDG-aware when DG info available) */
     if (is_hazardous(cargo) || cargo->dg) {
         if (cargo->dg) {
-            /* Full IMDG segregation check */
-            for (int i = 0; i < ship->cargo_count; i++) {
-                const Cargo *c = &ship->cargo[i];
-                if (c->pos_x < 0 || c == cargo || !c->dg) continue;
-
-                SegregationType req = imdg_get_segregation(
-                    cargo->dg->dg_class, cargo->dg->dg_division,
-                    c->dg->dg_class, c->dg->dg_division);
-
-                if (req == SEG_INCOMPATIBLE) {
-                    fprintf(stderr, "Constraint: %s incompatible with %s (IMDG)\n",
-                            cargo->id, c->id);
-                    return 0;
-                }
-
-                float min_dist = imdg_min_distance(req);
-                if (min_dist > 0.0f) {
+            /* Full IMDG segregation check. "Incompatible" applies at any
+             * distance, so every placed DG item is visited — but with an
+             * index that is only the DG subset, and not at all when no
+             * placed class needs segregation from this one. */
+            const SpatialIndex *idx = ship->placed_index;
+            int cls = imdg_cargo_class(cargo);
+            int n = idx ? idx->dg_count : ship->cargo_count;
+            if (cls < 0 || (idx && !(idx->dg_classes & imdg_conflicts[cls])))
+                n = 0;
+            for (int k = 0; k < n; k++) {
+                const Cargo *c = &ship->cargo[idx ? idx->dg_items[k] : k];
+                if (!CARGO_IS_PLACED(c) || c == cargo || !c->dg) continue;
+
+                int other = imdg_cargo_class(c);
+                if (other < 0) continue;
+                const IMDGRule *rule = &imdg_rules[cls][other];
+
+                if (rule->seg == SEG_INCOMPATIBLE)
+                    return DIAG_IMDG_INCOMPATIBLE;
+
+                if (rule->min_distance > 0.0f) {
                     float dx = c->pos_x - space->x;
                     float dy = c->pos_y - space->y;
-                    float dist = sqrtf(dx*dx + dy*dy);
-                    if (dist < min_dist) {
-                        fprintf(stderr, "Constraint: %s too close to %s (IMDG %s: %.1fm < %.1fm)\n",
-                                cargo->id, c->id, imdg_segregation_name(req), dist, min_dist);
-                        return 0;
-                    }
+                    if (sqrtf(dx*dx + dy*dy) < rule->min_distance)
+                        return DIAG_IMDG_DISTANCE;
                 }
             }
-        } else {
+        } else if (!check_hazmat_separation(ship, cargo, space->x, space->y, space->z)) {
             /* Legacy 3m hazmat separation fallback */
-            if (!check_hazmat_separation(ship, cargo, space->x, space->y, space->z)) {
-                fprintf(stderr, "Constraint: %s too close to other hazmat cargo\n", cargo->id);
-                return 0;
-            }
+            return DIAG_HAZMAT_SEPARATION;
         }
     }
 
@@ -146,33 +190,31 @@ int check_cargo_constraints(const Ship *ship, const Cargo *cargo,
         cargo->dimensions[0], cargo->dimensions[1]);
 
     float max_pressure = is_fragile(cargo) ? MAX_STACK_PRESSURE_FRAGILE : MAX_STACK_PRESSURE;
-    if (stack_pressure > max_pressure) {
-        fprintf(stderr, "Constraint: %s stacking pressure %.1f t/m2 exceeds limit %.1f\n",
-                cargo->id, stack_pressure, max_pressure);
-        return 0;
-    }
+    if (stack_pressure > max_pressure)
+        return DIAG_STACK_PRESSURE;
 
-    /* 4. Reefer cargo: prefer deck */
-    if (is_reefer(cargo) && strcmp(bin->name, "Deck") != 0) {
-        fprintf(stderr, "Note: Reefer %s placed in %s (deck preferred)\n",
-                cargo->id, bin->name);
+    /* 4. Deck weight ratio */
+    if (bin->flags & HOLD_FLAG_DECK) {
+        float deck_weight_ratio = (bin->current_weight + cargo->weight) / ship->max_weight;
+        if (deck_weight_ratio > MAX_DECK_WEIGHT_RATIO)
+            return DIAG_DECK_WEIGHT;
     }
 
-    /* 5. Fragile cargo: warn if deep in hold */
-    if (is_fragile(cargo) && space->z < -5.0f) {
-        fprintf(stderr, "Note: Fragile %s placed deep in hold (z=%.1f)\n",
-                cargo->id, space->z);
-    }
+    return DIAG_OK;
+}
 
-    /* 6. Deck weight ratio */
-    if (strcmp(bin->name, "Deck") == 0) {
-        float deck_weight_ratio = (bin->current_weight + cargo->weight) / ship->max_weight;
-        if (deck_weight_ratio > MAX_DECK_WEIGHT_RATIO) {
-            fprintf(stderr, "Constraint: Deck weight exceeds %.0f%% limit\n",
-                    MAX_DECK_WEIGHT_RATIO * 100.0f);
-            return 0;
-        }
-    }
+int check_cargo_constraints(const Ship *ship, const Cargo *cargo,
+                            const Bin3D *bin, const Space3D *space) {
+    return constraint_check(ship, cargo, bin, space) == DIAG_OK;
+}
 
-    return 1;
+void constraint_notes(const Cargo *cargo, const Bin3D *bin, const Space3D *space,
+                      int counts[DIAG_CODE_COUNT]) {
+    /* Reefer cargo: prefer deck or a compartment with reefer plugs */
+    if (is_reefer(cargo) && !(bin->flags & (HOLD_FLAG_DECK | HOLD_FLAG_REEFER)))
+        counts[DIAG_REEFER_PLACEMENT] = 1;
+
+    /* Fragile cargo: flag it deep in a hold */
+    if (is_fragile(cargo) && space->z < -5.0f)
+        counts[DIAG_FRAGILE_PLACEMENT] = 1;
 }
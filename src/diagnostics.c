@@ -0,0 +1,76 @@
+/*
+ * diagnostics.c - Ring buffer of per-item placement diagnostics
+ */
+
+#include "diagnostics.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int diag_log_init(DiagLog *log, int capacity) {
+    memset(log, 0, sizeof(*log));
+    if (capacity <= 0) return 0;
+
+    log->ring = malloc((size_t)capacity * sizeof(*log->ring));
+    if (!log->ring) return -1;
+    log->capacity = capacity;
+    return 0;
+}
+
+void diag_log_free(DiagLog *log) {
+    if (!log) return;
+    free(log->ring);
+    memset(log, 0, sizeof(*log));
+}
+
+void diag_log_clear(DiagLog *log) {
+    log->written = 0;
+    memset(log->totals, 0, sizeof(log->totals));
+}
+
+void diag_log_record(DiagLog *log, int cargo_idx, const char *cargo_id,
+                     const int counts[DIAG_CODE_COUNT]) {
+    int any = 0;
+    for (int k = 0; k < DIAG_CODE_COUNT; k++) {
+        log->totals[k] += counts[k];
+        any |= counts[k];
+    }
+    if (!any) return;
+
+    if (log->capacity > 0) {
+        DiagRecord *r = &log->ring[log->written % log->capacity];
+        r->cargo_idx = cargo_idx;
+        memset(r->cargo_id, 0, sizeof(r->cargo_id));
+        if (cargo_id) strncpy(r->cargo_id, cargo_id, sizeof(r->cargo_id) - 1);
+        memcpy(r->counts, counts, sizeof(r->counts));
+    }
+    log->written++;
+}
+
+int diag_log_count(const DiagLog *log) {
+    if (log->written < log->capacity) return (int)log->written;
+    return log->capacity;
+}
+
+const DiagRecord *diag_log_get(const DiagLog *log, int i) {
+    int n = diag_log_count(log);
+    if (i < 0 || i >= n) return NULL;
+    long long first = log->written - n;
+    return &log->ring[(first + i) % log->capacity];
+}
+
+const char *diag_code_name(int code) {
+    switch (code) {
+        case DIAG_OK:                return "ok";
+        case DIAG_POINT_LOAD:        return "point load";
+        case DIAG_IMDG_INCOMPATIBLE: return "IMDG incompatible";
+        case DIAG_IMDG_DISTANCE:     return "IMDG distance";
+        case DIAG_HAZMAT_SEPARATION: return "hazmat separation";
+        case DIAG_STACK_PRESSURE:    return "stack pressure";
+        case DIAG_DECK_WEIGHT:       return "deck weight";
+        case DIAG_REEFER_PLACEMENT:  return "reefer placement";
+        case DIAG_FRAGILE_PLACEMENT: return "fragile placement";
+        case DIAG_UNPLACED:          return "unplaced";
+        default:                     return "unknown";
+    }
+}
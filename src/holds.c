@@ -0,0 +1,115 @@
+/*
+ * holds.c - Cargo compartment definitions
+ */
+
+#include "holds.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+int hold_config_add(HoldConfig *config, const HoldDef *hold) {
+    if (config->count >= config->capacity) {
+        int new_cap = (config->capacity > 0) ? config->capacity * 2 : 8;
+        HoldDef *grown = realloc(config->holds, (size_t)new_cap * sizeof(HoldDef));
+        if (!grown) return -1;
+        config->holds = grown;
+        config->capacity = new_cap;
+    }
+    config->holds[config->count++] = *hold;
+    return 0;
+}
+
+static int parse_flags(const char *s, unsigned int *flags) {
+    *flags = 0;
+    while (*s == ' ' || *s == '\t') s++;
+    if (*s == '\0') return 0;
+
+    char buf[64];
+    strncpy(buf, s, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    char *saveptr;
+    for (char *tok = strtok_r(buf, "+| \t\r\n", &saveptr); tok;
+         tok = strtok_r(NULL, "+| \t\r\n", &saveptr)) {
+        if (strcmp(tok, "deck") == 0) *flags |= HOLD_FLAG_DECK;
+        else if (strcmp(tok, "reefer") == 0) *flags |= HOLD_FLAG_REEFER;
+        else if (strcmp(tok, "hold") == 0) continue;
+        else {
+            fprintf(stderr, "Error: Unknown hold flag '%s'\n", tok);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int hold_config_parse_line(HoldConfig *config, const char *spec) {
+    HoldDef h;
+    memset(&h, 0, sizeof(h));
+
+    float max_t = 0.0f;
+    int consumed = 0;
+    int n = sscanf(spec, " %31[^,],%f,%f,%f,%f,%f,%f,%f%n",
+                   h.name, &h.x, &h.y, &h.z, &h.length, &h.width, &h.height,
+                   &max_t, &consumed);
+    if (n != 8) {
+        fprintf(stderr, "Error: Invalid hold definition '%s' "
+                "(expected NAME,x,y,z,length,width,height,max_weight_t[,flags])\n", spec);
+        return -1;
+    }
+
+    if (!isfinite(h.x) || !isfinite(h.y) || !isfinite(h.z) ||
+        !(h.length > 0.0f) || !(h.width > 0.0f) || !(h.height > 0.0f) ||
+        !(max_t > 0.0f) || h.length > 1e5f || h.width > 1e5f || h.height > 1e5f ||
+        max_t > 1e9f) {
+        fprintf(stderr, "Error: Out-of-range values in hold '%s'\n", h.name);
+        return -1;
+    }
+    h.max_weight = max_t * 1000.0f;
+
+    const char *rest = spec + consumed;
+    while (*rest == ' ' || *rest == '\t') rest++;
+    if (*rest == ',') {
+        if (parse_flags(rest + 1, &h.flags) != 0) return -1;
+    } else if (*rest != '\0' && *rest != '\r' && *rest != '\n') {
+        fprintf(stderr, "Error: Unexpected text after hold '%s': '%s'\n", h.name, rest);
+        return -1;
+    }
+
+    return hold_config_add(config, &h);
+}
+
+int hold_config_legacy(HoldConfig *config, float length, float width, float max_weight) {
+    HoldDef legacy[3] = {
+        // Forward hold (30% of length), below waterline, leaving space for side tanks
+        { "ForwardHold", 0.0f, 0.0f, -8.0f, length * 0.3f, width * 0.8f, 8.0f,
+          max_weight * 0.3f, 0 },
+        // Aft hold (30% of length)
+        { "AftHold", length * 0.7f, 0.0f, -8.0f, length * 0.3f, width * 0.8f, 8.0f,
+          max_weight * 0.3f, 0 },
+        // Deck (full length, lower stacking and weight capacity), at waterline
+        { "Deck", 0.0f, 0.0f, 0.0f, length, width, 4.0f,
+          max_weight * 0.4f, HOLD_FLAG_DECK },
+    };
+
+    for (int i = 0; i < 3; i++)
+        if (hold_config_add(config, &legacy[i]) != 0) return -1;
+    return 0;
+}
+
+void hold_config_free(HoldConfig *config) {
+    if (!config) return;
+    free(config->holds);
+    config->holds = NULL;
+    config->count = 0;
+    config->capacity = 0;
+}
+
+const char *hold_flags_name(unsigned int flags) {
+    switch (flags & (HOLD_FLAG_DECK | HOLD_FLAG_REEFER)) {
+        case HOLD_FLAG_DECK:                    return "deck";
+        case HOLD_FLAG_REEFER:                  return "reefer";
+        case HOLD_FLAG_DECK | HOLD_FLAG_REEFER: return "deck+reefer";
+        default:                                return "hold";
+    }
+}
@@ -11,27 +11,62 @@
 #include <string.h>
 #include <math.h>
 
-/**
- * Linear interpolation helper: lerp between a and b by fraction t.
- */
-static float lerp(float a, float b, float t) {
-    return a + t * (b - a);
+/* Relative tolerance for treating draft spacing as uniform */
+#define UNIFORM_STEP_TOL 1e-5f
+
+int hydro_table_build_index(HydroTable *table) {
+    if (!table) return -1;
+    table->indexed = 0;
+    if (table->count < 2) return -1;
+
+    int n = table->count;
+    for (int i = 0; i < n; i++) {
+        table->draft[i] = table->entries[i].draft;
+        table->displacement[i] = table->entries[i].displacement;
+    }
+
+    float step = table->draft[1] - table->draft[0];
+    int uniform = step > 0.0f;
+    for (int i = 0; i < n - 1; i++) {
+        const HydroEntry *lo = &table->entries[i];
+        const HydroEntry *hi = &table->entries[i + 1];
+        float dd = hi->draft - lo->draft;
+        float dv = hi->displacement - lo->displacement;
+        if (dd <= 0.0f || dv < 0.0f) return -1;
+        if (fabsf(dd - step) > UNIFORM_STEP_TOL * step) uniform = 0;
+
+        HydroEntry *s = &table->slope[i];
+        s->draft           = 1.0f;
+        s->displacement    = dv / dd;
+        s->km              = (hi->km - lo->km) / dd;
+        s->kb              = (hi->kb - lo->kb) / dd;
+        s->bm              = (hi->bm - lo->bm) / dd;
+        s->tpc             = (hi->tpc - lo->tpc) / dd;
+        s->mtc             = (hi->mtc - lo->mtc) / dd;
+        s->waterplane_area = (hi->waterplane_area - lo->waterplane_area) / dd;
+        s->lcb             = (hi->lcb - lo->lcb) / dd;
+        table->draft_per_t[i] = dv > 1e-6f ? dd / dv : 0.0f;
+    }
+    table->slope[n - 1] = table->slope[n - 2];
+    table->draft_per_t[n - 1] = table->draft_per_t[n - 2];
+
+    table->inv_step = uniform ? 1.0f / step : 0.0f;
+    table->indexed = 1;
+    return 0;
 }
 
 /**
- * Interpolate all fields of a HydroEntry between two entries.
+ * Index of the first segment [i, i + 1] with col[i + 1] >= x, for
+ * col[0] < x < col[n - 1] on a non-decreasing column.
  */
-static void interpolate_entries(const HydroEntry *lo, const HydroEntry *hi,
-                                float t, HydroEntry *out) {
-    out->draft           = lerp(lo->draft,           hi->draft,           t);
-    out->displacement    = lerp(lo->displacement,    hi->displacement,    t);
-    out->km              = lerp(lo->km,              hi->km,              t);
-    out->kb              = lerp(lo->kb,              hi->kb,              t);
-    out->bm              = lerp(lo->bm,              hi->bm,              t);
-    out->tpc             = lerp(lo->tpc,             hi->tpc,             t);
-    out->mtc             = lerp(lo->mtc,             hi->mtc,             t);
-    out->waterplane_area = lerp(lo->waterplane_area, hi->waterplane_area, t);
-    out->lcb             = lerp(lo->lcb,             hi->lcb,             t);
+static int find_segment(const float *col, int n, float x) {
+    int lo = 0, hi = n - 2;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (col[mid + 1] >= x) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
 }
 
 int parse_hydro_table(const char *filename, HydroTable *table) {
@@ -104,63 +139,69 @@ int parse_hydro_table(const char *filename, HydroTable *table) {
         return -1;
     }
 
+    if (hydro_table_build_index(table) != 0) {
+        fprintf(stderr, "Error: Hydrostatic table displacement decreases with draft\n");
+        return -1;
+    }
+
     table->loaded = 1;
     return 0;
 }
 
 int hydro_interpolate(const HydroTable *table, float draft, HydroEntry *result) {
-    if (!table || !result || table->count == 0)
+    if (!table || !result || !table->indexed)
         return -1;
 
+    int n = table->count;
+
     /* Clamp to table boundaries */
-    if (draft <= table->entries[0].draft) {
+    if (draft <= table->draft[0]) {
         *result = table->entries[0];
         return 0;
     }
-    if (draft >= table->entries[table->count - 1].draft) {
-        *result = table->entries[table->count - 1];
+    if (draft >= table->draft[n - 1]) {
+        *result = table->entries[n - 1];
         return 0;
     }
 
-    /* Find bounding entries */
-    for (int i = 0; i < table->count - 1; i++) {
-        const HydroEntry *lo = &table->entries[i];
-        const HydroEntry *hi = &table->entries[i + 1];
-
-        if (draft >= lo->draft && draft <= hi->draft) {
-            float range = hi->draft - lo->draft;
-            float t = (range > 1e-6f) ? (draft - lo->draft) / range : 0.0f;
-            interpolate_entries(lo, hi, t, result);
-            return 0;
-        }
+    int i;
+    if (table->inv_step > 0.0f) {
+        /* Even spacing: index directly, then correct for rounding */
+        i = (int)((draft - table->draft[0]) * table->inv_step);
+        if (i > n - 2) i = n - 2;
+        while (i > 0 && draft <= table->draft[i]) i--;
+        while (draft > table->draft[i + 1]) i++;
+    } else {
+        i = find_segment(table->draft, n, draft);
     }
 
-    /* Should not reach here, but return last entry as fallback */
-    *result = table->entries[table->count - 1];
+    const HydroEntry *lo = &table->entries[i];
+    const HydroEntry *s = &table->slope[i];
+    float dt = draft - lo->draft;
+    result->draft           = draft;
+    result->displacement    = lo->displacement    + s->displacement    * dt;
+    result->km              = lo->km              + s->km              * dt;
+    result->kb              = lo->kb              + s->kb              * dt;
+    result->bm              = lo->bm              + s->bm              * dt;
+    result->tpc             = lo->tpc             + s->tpc             * dt;
+    result->mtc             = lo->mtc             + s->mtc             * dt;
+    result->waterplane_area = lo->waterplane_area + s->waterplane_area * dt;
+    result->lcb             = lo->lcb             + s->lcb             * dt;
     return 0;
 }
 
 float hydro_draft_from_displacement(const HydroTable *table, float displacement_t) {
-    if (!table || table->count == 0)
+    if (!table || !table->indexed)
         return -1.0f;
 
+    int n = table->count;
+
     /* Clamp to table boundaries */
-    if (displacement_t <= table->entries[0].displacement)
-        return table->entries[0].draft;
-    if (displacement_t >= table->entries[table->count - 1].displacement)
-        return table->entries[table->count - 1].draft;
-
-    /* Find bounding entries by displacement and inverse-interpolate */
-    for (int i = 0; i < table->count - 1; i++) {
-        float disp_lo = table->entries[i].displacement;
-        float disp_hi = table->entries[i + 1].displacement;
-
-        if (displacement_t >= disp_lo && displacement_t <= disp_hi) {
-            float range = disp_hi - disp_lo;
-            float t = (range > 1e-6f) ? (displacement_t - disp_lo) / range : 0.0f;
-            return lerp(table->entries[i].draft, table->entries[i + 1].draft, t);
-        }
-    }
+    if (displacement_t <= table->displacement[0])
+        return table->draft[0];
+    if (displacement_t >= table->displacement[n - 1])
+        return table->draft[n - 1];
 
-    return table->entries[table->count - 1].draft;
+    int i = find_segment(table->displacement, n, displacement_t);
+    return table->draft[i] + table->draft_per_t[i] * (displacement_t - table->displacement[i]);
 }
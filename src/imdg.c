@@ -18,11 +18,19 @@
 
 #include "imdg.h"
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-/* Number of entries in the segregation matrix */
-#define MATRIX_SIZE 17
+/* Minimum horizontal distance (m) for a segregation type; -1 = never together */
+#define SEG_MIN_DISTANCE(v) ((v) == SEG_AWAY_FROM          ?  3.0f : \
+                             (v) == SEG_SEPARATED          ?  6.0f : \
+                             (v) == SEG_SEPARATED_COMPLETE ? 12.0f : \
+                             (v) == SEG_SEPARATED_LONG     ? 24.0f : \
+                             (v) == SEG_INCOMPATIBLE       ? -1.0f : 0.0f)
+
+/* One matrix cell: the segregation and its distance, fixed at compile time */
+#define R(v) { (SegregationType)(v), SEG_MIN_DISTANCE(v) }
 
 /**
  * IMDG Code Table 7.2.4 - Segregation matrix
@@ -46,33 +54,54 @@
  *   [15] Class 8       (Corrosive substances)
  *   [16] Class 9       (Misc dangerous substances)
  *
- * Source: IMDG Code Amendment 41-22, Table 7.2.4
+ * Index with imdg_class_index(). Source: IMDG Code Amendment 41-22,
+ * Table 7.2.4
  */
-static const int seg_matrix[MATRIX_SIZE][MATRIX_SIZE] = {
-/*             1.1-6  1.7  1.8  2.1  2.2  2.3   3   4.1  4.2  4.3  5.1  5.2  6.1  6.2   7    8    9  */
-/* 1.1-6 */ {  5,     5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5,   5  },
-/* 1.7   */ {  5,     0,   0,   2,   1,   2,   2,   1,   2,   2,   2,   2,   1,   0,   2,   1,   0  },
-/* 1.8   */ {  5,     0,   0,   1,   0,   1,   1,   0,   1,   1,   1,   1,   0,   0,   1,   0,   0  },
-/* 2.1   */ {  5,     2,   1,   0,   0,   0,   2,   1,   2,   0,   2,   2,   0,   0,   2,   1,   0  },
-/* 2.2   */ {  5,     1,   0,   0,   0,   0,   1,   0,   1,   0,   1,   1,   0,   0,   1,   0,   0  },
-/* 2.3   */ {  5,     2,   1,   0,   0,   0,   2,   0,   1,   0,   2,   2,   0,   0,   2,   1,   0  },
-/* 3     */ {  5,     2,   1,   2,   1,   2,   0,   0,   2,   1,   2,   2,   0,   0,   2,   1,   0  },
-/* 4.1   */ {  5,     1,   0,   1,   0,   0,   0,   0,   1,   0,   1,   2,   0,   0,   1,   0,   0  },
-/* 4.2   */ {  5,     2,   1,   2,   1,   1,   2,   1,   0,   1,   2,   2,   1,   0,   2,   1,   0  },
-/* 4.3   */ {  5,     2,   1,   0,   0,   0,   1,   0,   1,   0,   2,   2,   0,   0,   2,   1,   0  },
-/* 5.1   */ {  5,     2,   1,   2,   1,   2,   2,   1,   2,   2,   0,   2,   1,   0,   1,   2,   0  },
-/* 5.2   */ {  5,     2,   1,   2,   1,   2,   2,   2,   2,   2,   2,   0,   1,   0,   2,   2,   0  },
-/* 6.1   */ {  5,     1,   0,   0,   0,   0,   0,   0,   1,   0,   1,   1,   0,   0,   1,   0,   0  },
-/* 6.2   */ {  5,     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0  },
-/* 7     */ {  5,     2,   1,   2,   1,   2,   2,   1,   2,   2,   1,   2,   1,   0,   0,   2,   0  },
-/* 8     */ {  5,     1,   0,   1,   0,   1,   1,   0,   1,   1,   2,   2,   0,   0,   2,   0,   0  },
-/* 9     */ {  5,     0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0  },
+const IMDGRule imdg_rules[IMDG_MATRIX_SIZE][IMDG_MATRIX_SIZE] = {
+/*            1.1-6 1.7   1.8   2.1   2.2   2.3   3     4.1   4.2   4.3   5.1   5.2   6.1   6.2   7     8     9   */
+/* 1.1-6 */ { R(5), R(5), R(5), R(5), R(5), R(5), R(5), R(5), R(5), R(5), R(5), R(5), R(5), R(5), R(5), R(5), R(5) },
+/* 1.7   */ { R(5), R(0), R(0), R(2), R(1), R(2), R(2), R(1), R(2), R(2), R(2), R(2), R(1), R(0), R(2), R(1), R(0) },
+/* 1.8   */ { R(5), R(0), R(0), R(1), R(0), R(1), R(1), R(0), R(1), R(1), R(1), R(1), R(0), R(0), R(1), R(0), R(0) },
+/* 2.1   */ { R(5), R(2), R(1), R(0), R(0), R(0), R(2), R(1), R(2), R(0), R(2), R(2), R(0), R(0), R(2), R(1), R(0) },
+/* 2.2   */ { R(5), R(1), R(0), R(0), R(0), R(0), R(1), R(0), R(1), R(0), R(1), R(1), R(0), R(0), R(1), R(0), R(0) },
+/* 2.3   */ { R(5), R(2), R(1), R(0), R(0), R(0), R(2), R(0), R(1), R(0), R(2), R(2), R(0), R(0), R(2), R(1), R(0) },
+/* 3     */ { R(5), R(2), R(1), R(2), R(1), R(2), R(0), R(0), R(2), R(1), R(2), R(2), R(0), R(0), R(2), R(1), R(0) },
+/* 4.1   */ { R(5), R(1), R(0), R(1), R(0), R(0), R(0), R(0), R(1), R(0), R(1), R(2), R(0), R(0), R(1), R(0), R(0) },
+/* 4.2   */ { R(5), R(2), R(1), R(2), R(1), R(1), R(2), R(1), R(0), R(1), R(2), R(2), R(1), R(0), R(2), R(1), R(0) },
+/* 4.3   */ { R(5), R(2), R(1), R(0), R(0), R(0), R(1), R(0), R(1), R(0), R(2), R(2), R(0), R(0), R(2), R(1), R(0) },
+/* 5.1   */ { R(5), R(2), R(1), R(2), R(1), R(2), R(2), R(1), R(2), R(2), R(0), R(2), R(1), R(0), R(1), R(2), R(0) },
+/* 5.2   */ { R(5), R(2), R(1), R(2), R(1), R(2), R(2), R(2), R(2), R(2), R(2), R(0), R(1), R(0), R(2), R(2), R(0) },
+/* 6.1   */ { R(5), R(1), R(0), R(0), R(0), R(0), R(0), R(0), R(1), R(0), R(1), R(1), R(0), R(0), R(1), R(0), R(0) },
+/* 6.2   */ { R(5), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0) },
+/* 7     */ { R(5), R(2), R(1), R(2), R(1), R(2), R(2), R(1), R(2), R(2), R(1), R(2), R(1), R(0), R(0), R(2), R(0) },
+/* 8     */ { R(5), R(1), R(0), R(1), R(0), R(1), R(1), R(0), R(1), R(1), R(2), R(2), R(0), R(0), R(2), R(0), R(0) },
+/* 9     */ { R(5), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0), R(0) },
 };
 
-/**
- * Map an IMDG class+division to the segregation matrix index.
- */
-static int class_to_index(int dg_class, int dg_division) {
+/* Bit b of row a is set when imdg_rules[a][b] is not SEG_NONE */
+const unsigned int imdg_conflicts[IMDG_MATRIX_SIZE] = {
+    0x1ffff,  /* 1.1-6 */
+    0x0dff9,  /* 1.7 */
+    0x04f69,  /* 1.8 */
+    0x0cdc7,  /* 2.1 */
+    0x04d43,  /* 2.2 */
+    0x0cd47,  /* 2.3 */
+    0x0cf3f,  /* 3 */
+    0x04d0b,  /* 4.1 */
+    0x0deff,  /* 4.2 */
+    0x0cd47,  /* 4.3 */
+    0x0dbff,  /* 5.1 */
+    0x0d7ff,  /* 5.2 */
+    0x04d03,  /* 6.1 */
+    0x00001,  /* 6.2 */
+    0x09fff,  /* 7 */
+    0x04f6b,  /* 8 */
+    0x00001,  /* 9 */
+};
+
+#undef R
+
+int imdg_class_index(int dg_class, int dg_division) {
     switch (dg_class) {
         case 1:
             if (dg_division >= 1 && dg_division <= 6) return 0;  /* 1.1-1.6 */
@@ -107,27 +136,22 @@ static int class_to_index(int dg_class, int dg_division) {
 
 SegregationType imdg_get_segregation(int class_a, int div_a,
                                      int class_b, int div_b) {
-    int idx_a = class_to_index(class_a, div_a);
-    int idx_b = class_to_index(class_b, div_b);
+    int idx_a = imdg_class_index(class_a, div_a);
+    int idx_b = imdg_class_index(class_b, div_b);
 
-    if (idx_a < 0 || idx_b < 0 || idx_a >= MATRIX_SIZE || idx_b >= MATRIX_SIZE)
+    if (idx_a < 0 || idx_b < 0)
         return SEG_NONE;
+    return imdg_rules[idx_a][idx_b].seg;
+}
 
-    int val = seg_matrix[idx_a][idx_b];
-    if (val < 0 || val > 5) return SEG_NONE;
-    return (SegregationType)val;
+int imdg_cargo_class(const Cargo *cargo) {
+    if (!cargo->dg) return -1;
+    if (cargo->dg_index) return cargo->dg_index - 1;
+    return imdg_class_index(cargo->dg->dg_class, cargo->dg->dg_division);
 }
 
 float imdg_min_distance(SegregationType seg) {
-    switch (seg) {
-        case SEG_NONE:               return 0.0f;
-        case SEG_AWAY_FROM:          return 3.0f;
-        case SEG_SEPARATED:          return 6.0f;
-        case SEG_SEPARATED_COMPLETE: return 12.0f;
-        case SEG_SEPARATED_LONG:     return 24.0f;
-        case SEG_INCOMPATIBLE:       return -1.0f; /* cannot be on same vessel */
-        default:                     return 0.0f;
-    }
+    return SEG_MIN_DISTANCE(seg);
 }
 
 const char *imdg_segregation_name(SegregationType seg) {
@@ -162,54 +186,185 @@ static float cargo_horizontal_distance(const Cargo *a, const Cargo *b) {
     return sqrtf(dx * dx + dy * dy);
 }
 
+/* Slack on the broad-phase bounds so float rounding never drops a pair
+ * the exact distance test would flag */
+#define SWEEP_SLACK 0.01f
+
+/** A placed DG item as the broad phase sees it */
+typedef struct {
+    int   idx;            /* index in ship->cargo */
+    int   cls;            /* segregation matrix index */
+    float x0, x1;         /* longitudinal extent */
+    float y0, y1;         /* transverse extent */
+} DGItem;
+
+static int dg_item_cmp_x(const void *pa, const void *pb) {
+    const DGItem *a = pa, *b = pb;
+    if (a->x0 != b->x0) return a->x0 < b->x0 ? -1 : 1;
+    return a->idx - b->idx;
+}
+
+static int violation_cmp(const void *pa, const void *pb) {
+    const IMDGViolation *a = pa, *b = pb;
+    if (a->cargo_idx_a != b->cargo_idx_a) return a->cargo_idx_a - b->cargo_idx_a;
+    return a->cargo_idx_b - b->cargo_idx_b;
+}
+
+/** Segregation for the pair as the all-pairs check orients it (lower index first) */
+static SegregationType pair_segregation(const DGItem *p, const DGItem *q) {
+    const DGItem *a = p->idx < q->idx ? p : q;
+    const DGItem *b = p->idx < q->idx ? q : p;
+    return imdg_rules[a->cls][b->cls].seg;
+}
+
+/** Append a violation; on allocation failure the check stays non-compliant */
+static void add_violation(IMDGCheckResult *r, const Ship *ship, int i, int j,
+                          SegregationType required, float dist) {
+    const Cargo *a = &ship->cargo[i];
+    const Cargo *b = &ship->cargo[j];
+
+    r->compliant = 0;
+    if (r->violation_count == r->violation_capacity) {
+        int cap = r->violation_capacity ? r->violation_capacity * 2 : 16;
+        IMDGViolation *grown = realloc(r->violations, (size_t)cap * sizeof(*grown));
+        if (!grown) return;
+        r->violations = grown;
+        r->violation_capacity = cap;
+    }
+
+    IMDGViolation *v = &r->violations[r->violation_count++];
+    v->cargo_idx_a = i;
+    v->cargo_idx_b = j;
+    v->required = required;
+    v->actual_distance = dist;
+    snprintf(v->description, sizeof(v->description),
+             "%s (Class %d.%d) vs %s (Class %d.%d): %s required, "
+             "actual distance %.1fm",
+             CARGO_ID(a), a->dg->dg_class, a->dg->dg_division,
+             CARGO_ID(b), b->dg->dg_class, b->dg->dg_division,
+             imdg_segregation_name(required), dist);
+}
+
 IMDGCheckResult imdg_check_all(const Ship *ship) {
     IMDGCheckResult result;
     memset(&result, 0, sizeof(result));
     result.compliant = 1;
 
-    if (!ship) return result;
+    if (!ship || ship->cargo_count < 2) return result;
 
+    /* Placed DG items, in manifest order, with their matrix class */
+    DGItem *items = malloc((size_t)ship->cargo_count * sizeof(*items));
+    if (!items) {
+        result.compliant = 0;
+        return result;
+    }
+    int n = 0;
+    unsigned present = 0;
     for (int i = 0; i < ship->cargo_count; i++) {
-        const Cargo *a = &ship->cargo[i];
-        if (a->pos_x < 0 || !a->dg) continue;
-
-        for (int j = i + 1; j < ship->cargo_count; j++) {
-            const Cargo *b = &ship->cargo[j];
-            if (b->pos_x < 0 || !b->dg) continue;
+        const Cargo *c = &ship->cargo[i];
+        if (!CARGO_IS_PLACED(c) || !c->dg) continue;
+        int cls = imdg_cargo_class(c);
+        if (cls < 0) continue;     /* no segregation */
+        DGItem *it = &items[n++];
+        it->idx = i;
+        it->cls = cls;
+        it->x0 = c->pos_x;
+        it->x1 = c->pos_x + c->dimensions[0];
+        it->y0 = c->pos_y;
+        it->y1 = c->pos_y + c->dimensions[1];
+        present |= 1u << cls;
+    }
 
-            SegregationType required = imdg_get_segregation(
-                a->dg->dg_class, a->dg->dg_division,
-                b->dg->dg_class, b->dg->dg_division);
+    /* Which classes each class must keep a distance from, or never meet,
+     * and the largest distance any present pair needs */
+    unsigned spaced[IMDG_MATRIX_SIZE] = {0}, barred[IMDG_MATRIX_SIZE] = {0};
+    float reach = 0.0f;
+    for (int a = 0; a < IMDG_MATRIX_SIZE; a++) {
+        if (!(present & (1u << a))) continue;
+        for (int b = 0; b < IMDG_MATRIX_SIZE; b++) {
+            if (!(present & (1u << b))) continue;
+            SegregationType seg = imdg_rules[a][b].seg;
+            if (seg == SEG_INCOMPATIBLE) {
+                barred[a] |= 1u << b;
+                barred[b] |= 1u << a;
+            } else if (seg > SEG_NONE && seg < SEG_INCOMPATIBLE) {
+                spaced[a] |= 1u << b;
+                spaced[b] |= 1u << a;
+                float d = imdg_rules[a][b].min_distance;
+                if (d > reach) reach = d;
+            }
+        }
+    }
 
-            if (required == SEG_NONE) continue;
+    /* Incompatible classes violate at any distance: pair up their buckets */
+    int barred_any = 0;
+    for (int a = 0; a < IMDG_MATRIX_SIZE; a++) barred_any |= barred[a] != 0;
+    if (barred_any) {
+        int start[IMDG_MATRIX_SIZE + 1] = {0};
+        for (int k = 0; k < n; k++) start[items[k].cls + 1]++;
+        for (int c = 0; c < IMDG_MATRIX_SIZE; c++) start[c + 1] += start[c];
+        int *bucket = malloc((size_t)(n ? n : 1) * sizeof(*bucket));
+        int fill[IMDG_MATRIX_SIZE];
+        memcpy(fill, start, sizeof(fill));
+        if (!bucket) {
+            result.compliant = 0;
+        } else {
+            for (int k = 0; k < n; k++) bucket[fill[items[k].cls]++] = k;
+            for (int a = 0; a < IMDG_MATRIX_SIZE; a++) {
+                for (int b = a; b < IMDG_MATRIX_SIZE; b++) {
+                    if (!(barred[a] & (1u << b))) continue;
+                    for (int p = start[a]; p < start[a + 1]; p++) {
+                        for (int q = (a == b) ? p + 1 : start[b]; q < start[b + 1]; q++) {
+                            const DGItem *x = &items[bucket[p]], *y = &items[bucket[q]];
+                            if (pair_segregation(x, y) != SEG_INCOMPATIBLE) continue;
+                            int i = x->idx < y->idx ? x->idx : y->idx;
+                            int j = x->idx < y->idx ? y->idx : x->idx;
+                            add_violation(&result, ship, i, j, SEG_INCOMPATIBLE,
+                                          cargo_horizontal_distance(&ship->cargo[i],
+                                                                    &ship->cargo[j]));
+                        }
+                    }
+                }
+            }
+            free(bucket);
+        }
+    }
 
-            float dist = cargo_horizontal_distance(a, b);
-            float min_dist = imdg_min_distance(required);
-            int violated = 0;
+    /* Distance rules: sweep along x; a pair is measured only when its gap
+     * on both axes is within the largest required distance */
+    if (reach > 0.0f) {
+        qsort(items, (size_t)n, sizeof(*items), dg_item_cmp_x);
+        float limit = reach + SWEEP_SLACK;
+        for (int k = 0; k < n; k++) {
+            const DGItem *a = &items[k];
+            for (int m = k + 1; m < n && items[m].x0 < a->x1 + limit; m++) {
+                const DGItem *b = &items[m];
+                if (!(spaced[a->cls] & (1u << b->cls))) continue;
+                if (b->y0 >= a->y1 + limit || a->y0 >= b->y1 + limit) continue;
 
-            if (required == SEG_INCOMPATIBLE) {
-                violated = 1; /* Can never be on same vessel */
-            } else if (dist < min_dist) {
-                violated = 1;
-            }
+                SegregationType required = pair_segregation(a, b);
+                if (required == SEG_NONE || required == SEG_INCOMPATIBLE) continue;
 
-            if (violated && result.violation_count < MAX_IMDG_VIOLATIONS) {
-                IMDGViolation *v = &result.violations[result.violation_count];
-                v->cargo_idx_a = i;
-                v->cargo_idx_b = j;
-                v->required = required;
-                v->actual_distance = dist;
-                snprintf(v->description, sizeof(v->description),
-                         "%s (Class %d.%d) vs %s (Class %d.%d): %s required, "
-                         "actual distance %.1fm",
-                         a->id, a->dg->dg_class, a->dg->dg_division,
-                         b->id, b->dg->dg_class, b->dg->dg_division,
-                         imdg_segregation_name(required), dist);
-                result.violation_count++;
-                result.compliant = 0;
+                int i = a->idx < b->idx ? a->idx : b->idx;
+                int j = a->idx < b->idx ? b->idx : a->idx;
+                float dist = cargo_horizontal_distance(&ship->cargo[i], &ship->cargo[j]);
+                if (dist < imdg_min_distance(required))
+                    add_violation(&result, ship, i, j, required, dist);
             }
         }
     }
 
+    free(items);
+    if (result.violation_count > 1)
+        qsort(result.violations, (size_t)result.violation_count,
+              sizeof(*result.violations), violation_cmp);
     return result;
 }
+
+void imdg_result_free(IMDGCheckResult *result) {
+    if (!result) return;
+    free(result->violations);
+    result->violations = NULL;
+    result->violation_count = 0;
+    result->violation_capacity = 0;
+}
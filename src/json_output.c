@@ -3,144 +3,574 @@
  */
 
 #include "json_output.h"
+#include "holds.h"
+#include "stack_grid.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
-void escape_json_string(const char *str, char *buffer, size_t buffer_size) {
-    size_t i = 0, j = 0;
+/* ------------------------------------------------------------------ */
+/* WRITER                                                             */
+/* ------------------------------------------------------------------ */
 
-    while (str[i] != '\0' && j < buffer_size - 2) {
-        if (str[i] == '"' || str[i] == '\\') {
-            buffer[j++] = '\\';
+void json_writer_init(JsonWriter *w, int pretty) {
+    memset(w, 0, sizeof(*w));
+    w->pretty = pretty;
+}
+
+void json_writer_free(JsonWriter *w) {
+    int pretty = w->pretty;
+    free(w->data);
+    json_writer_init(w, pretty);
+}
+
+char *json_writer_take(JsonWriter *w) {
+    char *data = NULL;
+    if (!w->oom && json_writer_reserve(w, 0) == 0) {
+        data = w->data;
+        w->data = NULL;
+    }
+    json_writer_free(w);
+    return data;
+}
+
+int json_writer_reserve(JsonWriter *w, size_t n) {
+    if (w->oom) return -1;
+    if (w->len + n + 1 > w->cap) {
+        size_t cap = w->cap ? w->cap : 256;
+        while (cap < w->len + n + 1) cap *= 2;
+        char *grown = realloc(w->data, cap);
+        if (!grown) { w->oom = 1; return -1; }
+        w->data = grown;
+        w->cap = cap;
+        if (w->len == 0) w->data[0] = '\0';
+    }
+    return 0;
+}
+
+void json_put_raw(JsonWriter *w, const char *s, size_t n) {
+    if (json_writer_reserve(w, n) != 0) return;
+    memcpy(w->data + w->len, s, n);
+    w->len += n;
+    w->data[w->len] = '\0';
+}
+
+void json_put_cstr(JsonWriter *w, const char *s) {
+    json_put_raw(w, s, strlen(s));
+}
+
+static void put_char(JsonWriter *w, char c) {
+    if (json_writer_reserve(w, 1) != 0) return;
+    w->data[w->len++] = c;
+    w->data[w->len] = '\0';
+}
+
+void json_put_string(JsonWriter *w, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+    put_char(w, '"');
+    for (;;) {
+        /* Copy the run that needs no escaping in one go */
+        const char *run = s;
+        while ((unsigned char)*s >= 0x20 && *s != '"' && *s != '\\') s++;
+        json_put_raw(w, run, (size_t)(s - run));
+        if (*s == '\0') break;
+
+        char esc[6] = { '\\', 0 };
+        size_t n = 2;
+        switch (*s) {
+            case '"':  esc[1] = '"';  break;
+            case '\\': esc[1] = '\\'; break;
+            case '\b': esc[1] = 'b';  break;
+            case '\f': esc[1] = 'f';  break;
+            case '\n': esc[1] = 'n';  break;
+            case '\r': esc[1] = 'r';  break;
+            case '\t': esc[1] = 't';  break;
+            default:
+                esc[1] = 'u'; esc[2] = '0'; esc[3] = '0';
+                esc[4] = hex[(unsigned char)*s >> 4];
+                esc[5] = hex[*s & 0xF];
+                n = 6;
+                break;
         }
-        buffer[j++] = str[i++];
+        json_put_raw(w, esc, n);
+        s++;
     }
-    buffer[j] = '\0';
+    put_char(w, '"');
 }
 
-void fprint_json_output(FILE *fp, const Ship *ship, const AnalysisResult *result) {
-    char escaped[128];
+/** Digits of v, right-aligned ending at end; returns the first digit */
+static char *format_u64(unsigned long long v, char *end) {
+    do {
+        *--end = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    return end;
+}
 
-    fprintf(fp,"{\n");
+void json_put_int(JsonWriter *w, long long v) {
+    char buf[24];
+    char *end = buf + sizeof(buf);
+    unsigned long long u = v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+    char *p = format_u64(u, end);
+    if (v < 0) *--p = '-';
+    json_put_raw(w, p, (size_t)(end - p));
+}
 
-    /* Ship specifications */
-    fprintf(fp,"  \"ship\": {\n");
-    fprintf(fp,"    \"length\": %.2f,\n", ship->length);
-    fprintf(fp,"    \"width\": %.2f,\n", ship->width);
-    fprintf(fp,"    \"max_weight\": %.2f,\n", ship->max_weight);
-    fprintf(fp,"    \"lightship_weight\": %.2f,\n", ship->lightship_weight);
-    fprintf(fp,"    \"lightship_kg\": %.2f\n", ship->lightship_kg);
-    fprintf(fp,"  },\n");
+void json_put_fixed(JsonWriter *w, double v, int decimals) {
+    static const double scale[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+    };
+    if (decimals < 0) decimals = 0;
+    if (decimals > 9) decimals = 9;
 
-    /* Cargo placements */
-    fprintf(fp,"  \"cargo\": [\n");
+    double x = fabs(v);
+    double scaled = x * scale[decimals];
+    if (!isfinite(v) || scaled >= 4503599627370496.0) {   /* 2^52 */
+        char buf[352];
+        int n = snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+        if (n > 0) json_put_raw(w, buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+        return;
+    }
+
+    /*
+     * printf rounds the exact value of v; rint() rounds the product, which
+     * is the same unless the product itself was rounded onto a tie. Below
+     * 2^52 a tie is representable, so that is the only case to check, and
+     * fma() gives the product's rounding error to settle it. (A float
+     * times a power of ten up to 1e9 never rounds.)
+     */
+    double q = rint(scaled);
+    if (scaled - floor(scaled) == 0.5) {
+        double err = fma(x, scale[decimals], -scaled);
+        if (err > 0) q = floor(scaled) + 1;
+        else if (err < 0) q = floor(scaled);
+    }
+
+    unsigned long long digits = (unsigned long long)q;
+    unsigned long long pow10 = (unsigned long long)scale[decimals];
+    char buf[48];
+    char *end = buf + sizeof(buf);
+    char *p = end;
+    if (decimals > 0) {
+        unsigned long long frac = digits % pow10;
+        for (int i = 0; i < decimals; i++) {
+            *--p = (char)('0' + frac % 10);
+            frac /= 10;
+        }
+        *--p = '.';
+    }
+    p = format_u64(digits / pow10, p);
+    if (signbit(v)) *--p = '-';
+    json_put_raw(w, p, (size_t)(end - p));
+}
+
+/* ------------------------------------------------------------------ */
+/* RESULT DOCUMENT                                                    */
+/* ------------------------------------------------------------------ */
+
+static void indent(JsonWriter *w, int depth) {
+    static const char spaces[] = "                ";
+    put_char(w, '\n');
+    json_put_raw(w, spaces, (size_t)depth * 2);
+}
+
+/** Start a member of an object nested depth levels deep */
+static void key(JsonWriter *w, int depth, int first, const char *name) {
+    if (!first) put_char(w, ',');
+    if (w->pretty) indent(w, depth);
+    put_char(w, '"');
+    json_put_cstr(w, name);
+    json_put_raw(w, "\":", 2);
+    if (w->pretty) put_char(w, ' ');
+}
+
+/** Start an array element nested depth levels deep */
+static void element(JsonWriter *w, int depth, int first) {
+    if (!first) put_char(w, ',');
+    if (w->pretty) indent(w, depth);
+}
+
+/** Close the container whose opening line is depth levels deep */
+static void close_container(JsonWriter *w, int depth, char bracket) {
+    if (w->pretty) indent(w, depth);
+    put_char(w, bracket);
+}
+
+/** Separator and key inside a one-line container ([a, b] or {"x": 1}) */
+static void inline_sep(JsonWriter *w) {
+    json_put_raw(w, ", ", w->pretty ? 2 : 1);
+}
+
+static void inline_key(JsonWriter *w, const char *name) {
+    put_char(w, '"');
+    json_put_cstr(w, name);
+    json_put_raw(w, "\": ", w->pretty ? 3 : 2);
+}
+
+static void put_bool(JsonWriter *w, int v) {
+    json_put_cstr(w, v ? "true" : "false");
+}
+
+static void write_cargo(JsonWriter *w, const Cargo *c) {
+    put_char(w, '{');
+    key(w, 3, 1, "id");
+    json_put_string(w, CARGO_ID(c));
+    key(w, 3, 0, "weight");
+    json_put_fixed(w, c->weight, 2);
+
+    key(w, 3, 0, "dimensions");
+    put_char(w, '[');
+    json_put_fixed(w, c->dimensions[0], 2);
+    inline_sep(w);
+    json_put_fixed(w, c->dimensions[1], 2);
+    inline_sep(w);
+    json_put_fixed(w, c->dimensions[2], 2);
+    put_char(w, ']');
+
+    key(w, 3, 0, "type");
+    json_put_string(w, CARGO_TYPE(c));
+
+    key(w, 3, 0, "position");
+    if (CARGO_IS_PLACED(c)) {
+        put_char(w, '{');
+        inline_key(w, "x");
+        json_put_fixed(w, c->pos_x, 2);
+        inline_sep(w);
+        inline_key(w, "y");
+        json_put_fixed(w, c->pos_y, 2);
+        inline_sep(w);
+        inline_key(w, "z");
+        json_put_fixed(w, c->pos_z, 2);
+        put_char(w, '}');
+    } else {
+        json_put_cstr(w, "null");
+    }
+    key(w, 3, 0, "placed");
+    put_bool(w, CARGO_IS_PLACED(c));
+    close_container(w, 2, '}');
+}
+
+/** One compartment of the load map: floor cells, row by row */
+static void write_hold_load(JsonWriter *w, const HoldDef *h, const StackGrid *grid) {
+    const float cell = LOAD_MAP_CELL_SIZE;
+    int cols = h->length > 0 ? (int)ceilf(h->length / cell - 1e-4f) : 0;
+    int rows = h->width > 0 ? (int)ceilf(h->width / cell - 1e-4f) : 0;
+    if (cols < 1) cols = 1;
+    if (rows < 1) rows = 1;
+
+    /* Items standing on the floor (within a millimetre) up to the roof */
+    float z_lo = h->z - 1e-3f, z_hi = h->z + h->height;
+
+    put_char(w, '{');
+    key(w, 3, 1, "name");
+    json_put_string(w, h->name);
+    key(w, 3, 0, "deck");
+    put_bool(w, (h->flags & HOLD_FLAG_DECK) != 0);
+    key(w, 3, 0, "cell_m");
+    json_put_fixed(w, cell, 2);
+    key(w, 3, 0, "cols");
+    json_put_int(w, cols);
+    key(w, 3, 0, "rows");
+    json_put_int(w, rows);
+
+    /* The peak needs every cell first; write the rows after it */
+    double peak = 0.0;
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            key(w, 3, 0, "max_t_m2");
+            json_put_fixed(w, peak, 3);
+            key(w, 3, 0, "t_m2");
+            put_char(w, '[');
+        }
+        for (int r = 0; r < rows; r++) {
+            float cy = h->y + r * cell;
+            float cd = fminf(cell, h->y + h->width - cy);
+            if (pass == 1) {
+                element(w, 4, r == 0);
+                put_char(w, '[');
+            }
+            for (int c = 0; c < cols; c++) {
+                float cx = h->x + c * cell;
+                float cw = fminf(cell, h->x + h->length - cx);
+                double load = 0.0;
+                if (grid && cw > 0 && cd > 0)
+                    load = stack_grid_weight(grid, cx, cy, cw, cd, z_lo, z_hi) / (cw * cd);
+                if (pass == 0) {
+                    if (load > peak) peak = load;
+                } else {
+                    if (c > 0) inline_sep(w);
+                    json_put_fixed(w, load, 3);
+                }
+            }
+            if (pass == 1) put_char(w, ']');
+        }
+    }
+    close_container(w, 3, ']');
+    close_container(w, 2, '}');
+}
+
+/** "load_map": floor load of every compartment from the placed cargo */
+static void write_load_map(JsonWriter *w, const Ship *ship) {
+    HoldConfig legacy = {0};
+    const HoldConfig *holds = ship->holds;
+    if (!holds || holds->count == 0) {
+        if (hold_config_legacy(&legacy, ship->length, ship->width, ship->max_weight) != 0) {
+            w->oom = 1;
+            return;
+        }
+        holds = &legacy;
+    }
+
+    StackGrid *grid = stack_grid_create(ship->length, ship->width, STACK_CELL_SIZE);
+    if (!grid) {
+        w->oom = 1;
+        hold_config_free(&legacy);
+        return;
+    }
     for (int i = 0; i < ship->cargo_count; i++) {
         const Cargo *c = &ship->cargo[i];
+        if (CARGO_IS_PLACED(c) && stack_grid_insert(grid, c) != 0) {
+            w->oom = 1;
+            break;
+        }
+    }
+
+    key(w, 1, 0, "load_map");
+    put_char(w, '[');
+    for (int i = 0; i < holds->count; i++) {
+        element(w, 2, i == 0);
+        write_hold_load(w, &holds->holds[i], grid);
+    }
+    close_container(w, 1, ']');
 
-        escape_json_string(c->id, escaped, sizeof(escaped));
-        fprintf(fp,"    {\n");
-        fprintf(fp,"      \"id\": \"%s\",\n", escaped);
-        fprintf(fp,"      \"weight\": %.2f,\n", c->weight);
-        fprintf(fp,"      \"dimensions\": [%.2f, %.2f, %.2f],\n",
-               c->dimensions[0], c->dimensions[1], c->dimensions[2]);
-
-        escape_json_string(c->type, escaped, sizeof(escaped));
-        fprintf(fp,"      \"type\": \"%s\",\n", escaped);
-
-        if (c->pos_x >= 0) {
-            fprintf(fp,"      \"position\": {\"x\": %.2f, \"y\": %.2f, \"z\": %.2f},\n",
-                   c->pos_x, c->pos_y, c->pos_z);
-            fprintf(fp,"      \"placed\": true\n");
-        } else {
-            fprintf(fp,"      \"position\": null,\n");
-            fprintf(fp,"      \"placed\": false\n");
+    stack_grid_destroy(grid);
+    hold_config_free(&legacy);
+}
+
+/** Hydrostatics through balance_status, or their nulls when overweight */
+static void write_stability(JsonWriter *w, const AnalysisResult *result) {
+    if (isnan(result->gm)) {
+        key(w, 2, 0, "hydrostatics");
+        json_put_cstr(w, "null");
+        key(w, 2, 0, "trim");
+        json_put_cstr(w, "null");
+        key(w, 2, 0, "heel");
+        json_put_cstr(w, "null");
+        key(w, 2, 0, "imo_stability");
+        json_put_cstr(w, "null");
+        key(w, 2, 0, "stability_status");
+        json_put_string(w, "rejected");
+        key(w, 2, 0, "balance_status");
+        json_put_string(w, "unknown");
+        return;
+    }
+
+    /* Hydrostatics */
+    key(w, 2, 0, "hydrostatics");
+    put_char(w, '{');
+    key(w, 3, 1, "draft");
+    json_put_fixed(w, result->draft, 3);
+    key(w, 3, 0, "kg");
+    json_put_fixed(w, result->kg, 3);
+    key(w, 3, 0, "kb");
+    json_put_fixed(w, result->kb, 3);
+    key(w, 3, 0, "bm");
+    json_put_fixed(w, result->bm, 3);
+    key(w, 3, 0, "gm");
+    json_put_fixed(w, result->gm, 3);
+    key(w, 3, 0, "free_surface_correction");
+    json_put_fixed(w, result->free_surface_correction, 3);
+    key(w, 3, 0, "gm_corrected");
+    json_put_fixed(w, result->gm_corrected, 3);
+    key(w, 3, 0, "hydro_table_used");
+    put_bool(w, result->hydro_table_used);
+    close_container(w, 2, '}');
+
+    /* Trim and heel */
+    key(w, 2, 0, "trim");
+    json_put_fixed(w, result->trim, 4);
+    key(w, 2, 0, "heel");
+    json_put_fixed(w, result->heel, 3);
+    key(w, 2, 0, "lcg_from_midship");
+    json_put_fixed(w, result->lcg, 3);
+
+    /* IMO criteria */
+    key(w, 2, 0, "imo_stability");
+    put_char(w, '{');
+    key(w, 3, 1, "gz_at_30");
+    json_put_fixed(w, result->gz_at_30, 4);
+    key(w, 3, 0, "gz_max");
+    json_put_fixed(w, result->gz_max, 4);
+    key(w, 3, 0, "gz_max_angle");
+    json_put_fixed(w, result->gz_max_angle, 1);
+    key(w, 3, 0, "area_0_30");
+    json_put_fixed(w, result->area_0_30, 5);
+    key(w, 3, 0, "area_0_40");
+    json_put_fixed(w, result->area_0_40, 5);
+    key(w, 3, 0, "area_30_40");
+    json_put_fixed(w, result->area_30_40, 5);
+    key(w, 3, 0, "compliant");
+    put_bool(w, result->imo_compliant);
+    close_container(w, 2, '}');
+
+    /* Stability classification */
+    const char *stability;
+    if (result->gm < 0.3f) stability = "critical";
+    else if (result->gm > 3.0f) stability = "overstiff";
+    else if (result->gm >= 0.5f && result->gm <= 2.5f) stability = "optimal";
+    else stability = "acceptable";
+    key(w, 2, 0, "stability_status");
+    json_put_string(w, stability);
+
+    const char *balance;
+    if (result->cg.perc_x >= 45 && result->cg.perc_x <= 55 &&
+        result->cg.perc_y >= 40 && result->cg.perc_y <= 60)
+        balance = "good";
+    else
+        balance = "warning";
+    key(w, 2, 0, "balance_status");
+    json_put_string(w, balance);
+}
+
+void json_write_results(JsonWriter *w, const Ship *ship, const AnalysisResult *result) {
+    int first = w->cargo_first > 0 ? w->cargo_first : 0;
+    if (first > ship->cargo_count) first = ship->cargo_count;
+    int end = ship->cargo_count;
+    if (w->cargo_limit > 0 && w->cargo_limit < end - first) end = first + w->cargo_limit;
+    int items = (w->omit & JSON_OMIT_CARGO) ? 0 : end - first;
+
+    /* Roughly what the pretty layout takes per item, so the buffer grows once */
+    json_writer_reserve(w, 2048 + (size_t)items * 256);
+
+    put_char(w, '{');
+    int first_member = 1;
+
+    /* Ship specifications */
+    if (!(w->omit & JSON_OMIT_SHIP)) {
+        key(w, 1, 1, "ship");
+        put_char(w, '{');
+        key(w, 2, 1, "length");
+        json_put_fixed(w, ship->length, 2);
+        key(w, 2, 0, "width");
+        json_put_fixed(w, ship->width, 2);
+        key(w, 2, 0, "max_weight");
+        json_put_fixed(w, ship->max_weight, 2);
+        key(w, 2, 0, "lightship_weight");
+        json_put_fixed(w, ship->lightship_weight, 2);
+        key(w, 2, 0, "lightship_kg");
+        json_put_fixed(w, ship->lightship_kg, 2);
+        close_container(w, 1, '}');
+        first_member = 0;
+    }
+
+    /* Cargo placements */
+    if (!(w->omit & JSON_OMIT_CARGO)) {
+        key(w, 1, first_member, "cargo");
+        put_char(w, '[');
+        for (int i = first; i < end; i++) {
+            element(w, 2, i == first);
+            write_cargo(w, &ship->cargo[i]);
         }
+        close_container(w, 1, ']');
 
-        fprintf(fp,"    }%s\n", (i < ship->cargo_count - 1) ? "," : "");
+        if (w->cargo_first > 0 || w->cargo_limit > 0) {
+            key(w, 1, 0, "cargo_page");
+            put_char(w, '{');
+            inline_key(w, "first");
+            json_put_int(w, first);
+            inline_sep(w);
+            inline_key(w, "count");
+            json_put_int(w, end - first);
+            inline_sep(w);
+            inline_key(w, "total");
+            json_put_int(w, ship->cargo_count);
+            put_char(w, '}');
+        }
+        first_member = 0;
     }
-    fprintf(fp,"  ],\n");
 
     /* Analysis results */
-    fprintf(fp,"  \"analysis\": {\n");
-    fprintf(fp,"    \"placed_count\": %d,\n", result->placed_item_count);
-    fprintf(fp,"    \"total_count\": %d,\n", ship->cargo_count);
-    fprintf(fp,"    \"total_cargo_weight\": %.2f,\n", result->total_cargo_weight_kg);
-    fprintf(fp,"    \"total_ship_weight\": %.2f,\n",
-           ship->lightship_weight + result->total_cargo_weight_kg);
-    fprintf(fp,"    \"capacity_used_percent\": %.2f,\n",
-           ((ship->lightship_weight + result->total_cargo_weight_kg) / ship->max_weight) * 100.0f);
-
-    fprintf(fp,"    \"center_of_gravity\": {\n");
-    fprintf(fp,"      \"longitudinal_percent\": %.2f,\n", result->cg.perc_x);
-    fprintf(fp,"      \"transverse_percent\": %.2f\n", result->cg.perc_y);
-    fprintf(fp,"    },\n");
-
-    if (!isnan(result->gm)) {
-        /* Hydrostatics */
-        fprintf(fp,"    \"hydrostatics\": {\n");
-        fprintf(fp,"      \"draft\": %.3f,\n", result->draft);
-        fprintf(fp,"      \"kg\": %.3f,\n", result->kg);
-        fprintf(fp,"      \"kb\": %.3f,\n", result->kb);
-        fprintf(fp,"      \"bm\": %.3f,\n", result->bm);
-        fprintf(fp,"      \"gm\": %.3f,\n", result->gm);
-        fprintf(fp,"      \"free_surface_correction\": %.3f,\n", result->free_surface_correction);
-        fprintf(fp,"      \"gm_corrected\": %.3f,\n", result->gm_corrected);
-        fprintf(fp,"      \"hydro_table_used\": %s\n", result->hydro_table_used ? "true" : "false");
-        fprintf(fp,"    },\n");
-
-        /* Trim and heel */
-        fprintf(fp,"    \"trim\": %.4f,\n", result->trim);
-        fprintf(fp,"    \"heel\": %.3f,\n", result->heel);
-        fprintf(fp,"    \"lcg_from_midship\": %.3f,\n", result->lcg);
-
-        /* IMO criteria */
-        fprintf(fp,"    \"imo_stability\": {\n");
-        fprintf(fp,"      \"gz_at_30\": %.4f,\n", result->gz_at_30);
-        fprintf(fp,"      \"gz_max\": %.4f,\n", result->gz_max);
-        fprintf(fp,"      \"gz_max_angle\": %.1f,\n", result->gz_max_angle);
-        fprintf(fp,"      \"area_0_30\": %.5f,\n", result->area_0_30);
-        fprintf(fp,"      \"area_0_40\": %.5f,\n", result->area_0_40);
-        fprintf(fp,"      \"area_30_40\": %.5f,\n", result->area_30_40);
-        fprintf(fp,"      \"compliant\": %s\n", result->imo_compliant ? "true" : "false");
-        fprintf(fp,"    },\n");
-
-        /* Stability classification */
-        const char *stability;
-        if (result->gm < 0.3f) stability = "critical";
-        else if (result->gm > 3.0f) stability = "overstiff";
-        else if (result->gm >= 0.5f && result->gm <= 2.5f) stability = "optimal";
-        else stability = "acceptable";
-        fprintf(fp,"    \"stability_status\": \"%s\",\n", stability);
-
-        const char *balance;
-        if (result->cg.perc_x >= 45 && result->cg.perc_x <= 55 &&
-            result->cg.perc_y >= 40 && result->cg.perc_y <= 60)
-            balance = "good";
-        else
-            balance = "warning";
-        fprintf(fp,"    \"balance_status\": \"%s\",\n", balance);
-
-        /* Longitudinal strength */
-        if (result->strength_compliant >= 0) {
-            fprintf(fp,"    \"longitudinal_strength\": {\n");
-            fprintf(fp,"      \"max_shear_force\": %.1f,\n", result->max_shear_force);
-            fprintf(fp,"      \"max_bending_moment\": %.1f,\n", result->max_bending_moment);
-            fprintf(fp,"      \"compliant\": %s\n", result->strength_compliant ? "true" : "false");
-            fprintf(fp,"    },\n");
-        }
+    float total_weight = ship->lightship_weight + result->total_cargo_weight_kg;
+    float capacity = (total_weight / ship->max_weight) * 100.0f;
 
-        fprintf(fp,"    \"overweight\": false\n");
-    } else {
-        fprintf(fp,"    \"hydrostatics\": null,\n");
-        fprintf(fp,"    \"trim\": null,\n");
-        fprintf(fp,"    \"heel\": null,\n");
-        fprintf(fp,"    \"imo_stability\": null,\n");
-        fprintf(fp,"    \"stability_status\": \"rejected\",\n");
-        fprintf(fp,"    \"balance_status\": \"unknown\",\n");
-        fprintf(fp,"    \"overweight\": true\n");
+    key(w, 1, first_member, "analysis");
+    put_char(w, '{');
+    key(w, 2, 1, "placed_count");
+    json_put_int(w, result->placed_item_count);
+    key(w, 2, 0, "total_count");
+    json_put_int(w, ship->cargo_count);
+    key(w, 2, 0, "total_cargo_weight");
+    json_put_fixed(w, result->total_cargo_weight_kg, 2);
+    key(w, 2, 0, "total_ship_weight");
+    json_put_fixed(w, total_weight, 2);
+    key(w, 2, 0, "capacity_used_percent");
+    json_put_fixed(w, capacity, 2);
+
+    key(w, 2, 0, "center_of_gravity");
+    put_char(w, '{');
+    key(w, 3, 1, "longitudinal_percent");
+    json_put_fixed(w, result->cg.perc_x, 2);
+    key(w, 3, 0, "transverse_percent");
+    json_put_fixed(w, result->cg.perc_y, 2);
+    close_container(w, 2, '}');
+
+    int overweight = isnan(result->gm);
+    if (!(w->omit & JSON_OMIT_STABILITY)) write_stability(w, result);
+
+    /* Longitudinal strength */
+    if (!overweight && !(w->omit & JSON_OMIT_STRENGTH) && result->strength_compliant >= 0) {
+        key(w, 2, 0, "longitudinal_strength");
+        put_char(w, '{');
+        key(w, 3, 1, "max_shear_force");
+        json_put_fixed(w, result->max_shear_force, 1);
+        key(w, 3, 0, "max_bending_moment");
+        json_put_fixed(w, result->max_bending_moment, 1);
+        key(w, 3, 0, "compliant");
+        put_bool(w, result->strength_compliant);
+        close_container(w, 2, '}');
     }
 
-    fprintf(fp,"  }\n");
-    fprintf(fp,"}\n");
+    key(w, 2, 0, "overweight");
+    put_bool(w, overweight);
+    close_container(w, 1, '}');
+
+    if (w->load_map) write_load_map(w, ship);
+
+    close_container(w, 0, '}');
+    if (w->pretty) put_char(w, '\n');
+}
+
+int fprint_json(FILE *fp, const Ship *ship, const AnalysisResult *result, int flags) {
+    JsonWriter w;
+    json_writer_init(&w, (flags & JSON_PRETTY) != 0);
+    w.load_map = (flags & JSON_LOAD_MAP) != 0;
+    json_write_results(&w, ship, result);
+    if (!w.pretty) put_char(&w, '\n');
+
+    int rc = 0;
+    if (w.oom) {
+        fprintf(stderr, "Error: Out of memory formatting JSON output\n");
+        rc = -1;
+    } else if (fwrite(w.data, 1, w.len, fp) != w.len) {
+        rc = -1;
+    }
+    json_writer_free(&w);
+    return rc;
+}
+
+void fprint_json_output(FILE *fp, const Ship *ship, const AnalysisResult *result) {
+    fprint_json(fp, ship, result, JSON_PRETTY);
+}
+
+void escape_json_string(const char *str, char *buffer, size_t buffer_size) {
+    size_t i = 0, j = 0;
+
+    while (str[i] != '\0' && j < buffer_size - 2) {
+        if (str[i] == '"' || str[i] == '\\') {
+            buffer[j++] = '\\';
+        }
+        buffer[j++] = str[i++];
+    }
+    buffer[j] = '\0';
 }
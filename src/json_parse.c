@@ -0,0 +1,342 @@
+/*
+ * json_parse.c - Single-pass JSON reader
+ */
+
+#include "json_parse.h"
+#include <string.h>
+#include <limits.h>
+
+static int fail(JsonReader *r, const char *msg) {
+    if (!r->error) r->error = msg;
+    return -1;
+}
+
+static void skip_ws(JsonReader *r) {
+    while (r->p < r->end &&
+           (*r->p == ' ' || *r->p == '\t' || *r->p == '\n' || *r->p == '\r'))
+        r->p++;
+}
+
+void json_reader_init(JsonReader *r, const char *text, size_t len) {
+    r->p = text;
+    r->end = text + len;
+    r->error = NULL;
+    r->depth = 0;
+    r->first = 0;
+}
+
+JsonType json_peek(JsonReader *r) {
+    skip_ws(r);
+    if (r->error || r->p >= r->end) return JSON_NONE;
+    switch (*r->p) {
+        case '{': return JSON_OBJECT;
+        case '[': return JSON_ARRAY;
+        case '"': return JSON_STRING;
+        case 't': return JSON_TRUE;
+        case 'f': return JSON_FALSE;
+        case 'n': return JSON_NULL;
+        default:
+            return (*r->p == '-' || (*r->p >= '0' && *r->p <= '9')) ? JSON_NUMBER : JSON_NONE;
+    }
+}
+
+static int is_hex(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static int hex_val(char c) {
+    return (c <= '9') ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+static int read_string(JsonReader *r, JsonSpan *out) {
+    const char *p = r->p + 1;           /* past the opening quote */
+    const char *end = r->end;
+    int escaped = 0;
+
+    while (p < end) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"') break;
+        if (c < 0x20) return fail(r, "control character in string");
+        if (c == '\\') {
+            escaped = 1;
+            if (++p >= end) break;
+            switch (*p) {
+                case '"': case '\\': case '/': case 'b':
+                case 'f': case 'n': case 'r': case 't':
+                    break;
+                case 'u':
+                    if (end - p < 5 || !is_hex(p[1]) || !is_hex(p[2]) ||
+                        !is_hex(p[3]) || !is_hex(p[4]))
+                        return fail(r, "bad \\u escape");
+                    p += 4;
+                    break;
+                default:
+                    return fail(r, "bad escape in string");
+            }
+        }
+        p++;
+    }
+    if (p >= end) return fail(r, "unterminated string");
+
+    out->type = JSON_STRING;
+    out->start = r->p + 1;
+    out->len = (size_t)(p - out->start);
+    out->escaped = escaped;
+    r->p = p + 1;
+    return 0;
+}
+
+static int read_number(JsonReader *r, JsonSpan *out) {
+    const char *p = r->p, *end = r->end;
+
+    if (p < end && *p == '-') p++;
+    if (p >= end || *p < '0' || *p > '9') return fail(r, "bad number");
+    if (*p == '0') p++;
+    else while (p < end && *p >= '0' && *p <= '9') p++;
+
+    if (p < end && *p == '.') {
+        p++;
+        if (p >= end || *p < '0' || *p > '9') return fail(r, "bad number");
+        while (p < end && *p >= '0' && *p <= '9') p++;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) p++;
+        if (p >= end || *p < '0' || *p > '9') return fail(r, "bad number");
+        while (p < end && *p >= '0' && *p <= '9') p++;
+    }
+
+    out->type = JSON_NUMBER;
+    out->start = r->p;
+    out->len = (size_t)(p - r->p);
+    out->escaped = 0;
+    r->p = p;
+    return 0;
+}
+
+static int read_literal(JsonReader *r, JsonSpan *out, const char *word, JsonType type) {
+    size_t n = strlen(word);
+    if ((size_t)(r->end - r->p) < n || memcmp(r->p, word, n) != 0)
+        return fail(r, "invalid literal");
+    out->type = type;
+    out->start = r->p;
+    out->len = n;
+    out->escaped = 0;
+    r->p += n;
+    return 0;
+}
+
+int json_read_value(JsonReader *r, JsonSpan *out) {
+    JsonSpan tmp;
+    if (!out) out = &tmp;
+
+    JsonType type = json_peek(r);
+    if (r->error) return -1;
+    const char *start = r->p;
+
+    switch (type) {
+        case JSON_STRING: return read_string(r, out);
+        case JSON_NUMBER: return read_number(r, out);
+        case JSON_TRUE:   return read_literal(r, out, "true", JSON_TRUE);
+        case JSON_FALSE:  return read_literal(r, out, "false", JSON_FALSE);
+        case JSON_NULL:   return read_literal(r, out, "null", JSON_NULL);
+        case JSON_OBJECT: {
+            if (json_object_begin(r) != 0) return -1;
+            JsonSpan key;
+            int rc;
+            while ((rc = json_object_next(r, &key)) > 0)
+                if (json_read_value(r, NULL) != 0) return -1;
+            if (rc < 0) return -1;
+            break;
+        }
+        case JSON_ARRAY: {
+            if (json_array_begin(r) != 0) return -1;
+            int rc;
+            while ((rc = json_array_next(r)) > 0)
+                if (json_read_value(r, NULL) != 0) return -1;
+            if (rc < 0) return -1;
+            break;
+        }
+        default:
+            return fail(r, r->p >= r->end ? "unexpected end of input" : "unexpected character");
+    }
+
+    out->type = type;
+    out->start = start;
+    out->len = (size_t)(r->p - start);
+    out->escaped = 0;
+    return 0;
+}
+
+static int container_begin(JsonReader *r, char open) {
+    skip_ws(r);
+    if (r->error) return -1;
+    if (r->p >= r->end || *r->p != open)
+        return fail(r, open == '{' ? "expected object" : "expected array");
+    if (r->depth >= JSON_MAX_DEPTH) return fail(r, "nesting too deep");
+    r->p++;
+    r->depth++;
+    r->first = 1;
+    return 0;
+}
+
+/** Shared head of *_next: 0 at the closing bracket, 1 before a member */
+static int container_next(JsonReader *r, char close) {
+    skip_ws(r);
+    if (r->error) return -1;
+    if (r->p >= r->end) return fail(r, "unexpected end of input");
+
+    int first = r->first;
+    r->first = 0;
+    if (*r->p == close) {
+        r->p++;
+        r->depth--;
+        return 0;
+    }
+    if (!first) {
+        if (*r->p != ',') return fail(r, "expected ',' between members");
+        r->p++;
+        skip_ws(r);
+    }
+    return 1;
+}
+
+int json_object_begin(JsonReader *r) {
+    return container_begin(r, '{');
+}
+
+int json_object_next(JsonReader *r, JsonSpan *key) {
+    int rc = container_next(r, '}');
+    if (rc <= 0) return rc;
+
+    JsonSpan tmp;
+    if (!key) key = &tmp;
+    if (r->p >= r->end || *r->p != '"') return fail(r, "expected member name");
+    if (read_string(r, key) != 0) return -1;
+    skip_ws(r);
+    if (r->p >= r->end || *r->p != ':') return fail(r, "expected ':' after member name");
+    r->p++;
+    return 1;
+}
+
+int json_array_begin(JsonReader *r) {
+    return container_begin(r, '[');
+}
+
+int json_array_next(JsonReader *r) {
+    return container_next(r, ']');
+}
+
+int json_reader_finish(JsonReader *r) {
+    skip_ws(r);
+    if (r->error) return -1;
+    return (r->p == r->end) ? 0 : fail(r, "trailing characters after value");
+}
+
+int json_span_is(const JsonSpan *s, const char *lit) {
+    if (s->type != JSON_STRING) return 0;
+    size_t n = strlen(lit);
+    if (!s->escaped) return s->len == n && memcmp(s->start, lit, n) == 0;
+
+    char buf[256];
+    if (s->len >= sizeof(buf)) return 0;
+    size_t len = json_string_decode(s, buf);
+    return len == n && memcmp(buf, lit, n) == 0;
+}
+
+int json_span_int(const JsonSpan *s, long long *out) {
+    if (s->type != JSON_NUMBER || s->len == 0) return -1;
+    const char *p = s->start, *end = s->start + s->len;
+    int neg = (*p == '-');
+    if (neg) p++;
+
+    unsigned long long v = 0;
+    const unsigned long long limit = neg ? (unsigned long long)LLONG_MAX + 1 : LLONG_MAX;
+    for (; p < end; p++) {
+        if (*p < '0' || *p > '9') return -1;     /* fraction or exponent */
+        unsigned d = (unsigned)(*p - '0');
+        if (v > (limit - d) / 10) return -1;
+        v = v * 10 + d;
+    }
+    *out = neg ? (long long)(0 - v) : (long long)v;
+    return 0;
+}
+
+static unsigned read_u4(const char *p) {
+    return (unsigned)(hex_val(p[0]) << 12 | hex_val(p[1]) << 8 |
+                      hex_val(p[2]) << 4 | hex_val(p[3]));
+}
+
+size_t json_string_decode(const JsonSpan *s, char *dst) {
+    const char *p = s->start, *end = s->start + s->len;
+    char *o = dst;
+
+    if (!s->escaped) {
+        memmove(o, p, s->len);
+        o[s->len] = '\0';
+        return s->len;
+    }
+
+    while (p < end) {
+        const char *bs = memchr(p, '\\', (size_t)(end - p));
+        size_t run = (size_t)((bs ? bs : end) - p);
+        memmove(o, p, run);
+        o += run;
+        p += run;
+        if (!bs) break;
+
+        if (end - p < 2) return (size_t)-1;
+        char c = p[1];
+        p += 2;
+        switch (c) {
+            case '"':  *o++ = '"';  break;
+            case '\\': *o++ = '\\'; break;
+            case '/':  *o++ = '/';  break;
+            case 'b':  *o++ = '\b'; break;
+            case 'f':  *o++ = '\f'; break;
+            case 'n':  *o++ = '\n'; break;
+            case 'r':  *o++ = '\r'; break;
+            case 't':  *o++ = '\t'; break;
+            case 'u': {
+                if (end - p < 4 || !is_hex(p[0]) || !is_hex(p[1]) ||
+                    !is_hex(p[2]) || !is_hex(p[3]))
+                    return (size_t)-1;
+                unsigned cp = read_u4(p);
+                p += 4;
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    /* High surrogate: must pair with a low one */
+                    if (end - p < 6 || p[0] != '\\' || p[1] != 'u' ||
+                        !is_hex(p[2]) || !is_hex(p[3]) || !is_hex(p[4]) || !is_hex(p[5]))
+                        return (size_t)-1;
+                    unsigned lo = read_u4(p + 2);
+                    if (lo < 0xDC00 || lo > 0xDFFF) return (size_t)-1;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    p += 6;
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    return (size_t)-1;
+                }
+
+                if (cp < 0x80) {
+                    *o++ = (char)cp;
+                } else if (cp < 0x800) {
+                    *o++ = (char)(0xC0 | (cp >> 6));
+                    *o++ = (char)(0x80 | (cp & 0x3F));
+                } else if (cp < 0x10000) {
+                    *o++ = (char)(0xE0 | (cp >> 12));
+                    *o++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+                    *o++ = (char)(0x80 | (cp & 0x3F));
+                } else {
+                    *o++ = (char)(0xF0 | (cp >> 18));
+                    *o++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+                    *o++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+                    *o++ = (char)(0x80 | (cp & 0x3F));
+                }
+                break;
+            }
+            default:
+                return (size_t)-1;
+        }
+    }
+    *o = '\0';
+    return (size_t)(o - dst);
+}
@@ -12,23 +12,47 @@
 #include "placement_3d.h"
 #include "imdg.h"
 #include "json_output.h"
-
+#include "thread_pool.h"
+#include "optimizer.h"
+#include "binfmt.h"
+#include "diagnostics.h"
+#include "tanks.h"
+#include "arena.h"
+
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
+#include <time.h>
+
+typedef char gz_curve_size_matches[CF_GZ_CURVE_POINTS == GZ_CURVE_POINTS ? 1 : -1];
+typedef char diag_codes_match[CF_DIAG_CODE_COUNT == DIAG_CODE_COUNT &&
+                              CF_DIAG_STACK_PRESSURE == DIAG_STACK_PRESSURE &&
+                              CF_DIAG_UNPLACED == DIAG_UNPLACED ? 1 : -1];
+typedef char bin_names_match[sizeof(((CfBinStats *)0)->name) ==
+                             sizeof(((Bin3D *)0)->name) ? 1 : -1];
 
 /* ------------------------------------------------------------------ */
 /* INTERNAL STATE                                                     */
 /* ------------------------------------------------------------------ */
 
+struct CfShipTemplate {
+    Ship            ship;         /* parsed config; no cargo */
+    pthread_mutex_t lock;         /* guards refs */
+    int             refs;
+};
+
 struct CargoForge {
     Ship            ship;
     int             ship_loaded;
+    CfShipTemplate *tpl;          /* ship tables borrowed from, or NULL */
     int             cargo_loaded;
 
     AnalysisResult  analysis;
-    int             analyzed;
+    int             analyzed;     /* analysis may run: moments are current */
+    unsigned int    stages_done;  /* ANALYSIS_* stages held in analysis */
 
     IMDGCheckResult imdg;
     int             imdg_checked;
@@ -36,8 +60,59 @@ struct CargoForge {
     CfResult        result;       /* public result cache */
     int             result_valid;
 
-    char           *json_cache;   /* cached JSON output */
+    JsonWriter      json;         /* buffer behind json_cache */
+    char           *json_cache;   /* cached JSON output (json.data), or NULL */
+    unsigned char  *plan_block;   /* CfPlanView block, kept for reuse */
+    size_t          plan_capacity;
+    int             plan_valid;   /* plan_block matches the cargo */
     char            errmsg[512];
+
+    int             threads;      /* CF_OPT_THREADS */
+    int             strategy;     /* CF_OPT_STRATEGY */
+    int             time_budget_ms; /* CF_OPT_TIME_BUDGET */
+    int             beam_width;   /* CF_OPT_BEAM_WIDTH */
+    int             placer;       /* CF_OPT_PLACER */
+    int             plan_placer;  /* placer of the kept plan, for replays */
+    int             json_compact; /* CF_OPT_JSON_COMPACT */
+    int             result_mask;  /* CF_OPT_RESULT_MASK */
+    int             json_first;   /* CF_OPT_JSON_CARGO_FIRST */
+    int             json_count;   /* CF_OPT_JSON_CARGO_COUNT */
+    DiagLog         diag;         /* CF_OPT_DIAGNOSTICS entries (capacity) */
+    int             stats_on;     /* CF_OPT_STATS */
+    CfStats         stats;        /* phase timers; counters live in pstats */
+    PlacementStats  pstats;       /* search counters since the last optimize */
+    ThreadPool     *pool;         /* started lazily when threads != 1 */
+
+    /* CF_OPT_ARENA: the ship's tables, then its cargo, come from arena */
+    int             use_arena;
+    Arena           arena;
+    ArenaMark       cargo_mark;   /* where the cargo region starts */
+
+    /* Kept plan for cargoforge_add_cargo/remove_cargo */
+    int             planned;      /* positions come from cargoforge_optimize */
+    PlacementState  placement;    /* bins/slots; bins == NULL until needed */
+    CargoMoments    moments;      /* running sums behind cf->analysis */
+
+    /* cargoforge_submit() */
+    ThreadPool     *executor;     /* one worker, started by the first submit */
+    CfJob          *job;          /* latest job (a reference), or NULL */
+    CfJob          *running;      /* set by the worker while a job runs */
+};
+
+struct CfJob {
+    CargoForge     *cf;
+    int             op;           /* CF_JOB_* */
+    double          deadline;     /* monotonic ms, 0 = none */
+    CfJobCallback   on_done;
+    void           *user;
+
+    pthread_mutex_t lock;         /* guards the fields below */
+    pthread_cond_t  done_cond;
+    int             refs;         /* caller, handle and worker */
+    int             done;
+    int             status;
+    int             cancel;       /* cargoforge_job_cancel() was called */
+    int             stop_status;  /* why the job was stopped, 0 = it was not */
 };
 
 /* ------------------------------------------------------------------ */
@@ -53,36 +128,27 @@ static void clear_error(CargoForge *cf) {
     cf->errmsg[0] = '\0';
 }
 
-/**
- * Write a string to a temporary file, return the path.
- * Caller must unlink() the path when done.
- * Returns 0 on success, -1 on failure.
- */
-static int write_temp_file(const char *text, char *path, size_t pathsz) {
-    snprintf(path, pathsz, "/tmp/cargoforge_XXXXXX");
-    int fd = mkstemp(path);
-    if (fd < 0) return -1;
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
 
-    size_t len = strlen(text);
-    ssize_t written = write(fd, text, len);
-    close(fd);
+/* CF_OPT_STATS phase timer: the clock is only read while stats are on */
+static double phase_begin(const CargoForge *cf) {
+    return cf->stats_on ? now_ms() : 0.0;
+}
 
-    if (written < 0 || (size_t)written != len) {
-        unlink(path);
-        return -1;
-    }
-    return 0;
+static void phase_end(const CargoForge *cf, double start, double *slot) {
+    if (cf->stats_on) *slot = now_ms() - start;
 }
 
 /** Convert internal AnalysisResult to public CfResult */
-static void fill_result(CargoForge *cf) {
-    const AnalysisResult *a = &cf->analysis;
-    CfResult *r = &cf->result;
-
+static void convert_result(const Ship *ship, const AnalysisResult *a, CfResult *r) {
     r->placed_count   = a->placed_item_count;
-    r->total_count    = cf->ship.cargo_count;
+    r->total_count    = ship->cargo_count;
     r->cargo_weight   = a->total_cargo_weight_kg;
-    r->displacement   = cf->ship.lightship_weight + a->total_cargo_weight_kg;
+    r->displacement   = ship->lightship_weight + a->total_cargo_weight_kg;
 
     r->draft          = a->draft;
     r->kg             = a->kg;
@@ -111,19 +177,181 @@ static void fill_result(CargoForge *cf) {
     r->max_bending_moment = a->max_bending_moment;
     r->strength_compliant = a->strength_compliant;
 
+    memcpy(r->gz_curve, a->gz_curve, sizeof(r->gz_curve));
+}
+
+/** ANALYSIS_* stages behind a CF_RESULT_* mask */
+static unsigned int mask_stages(int mask) {
+    return ((mask & CF_RESULT_STABILITY) ? ANALYSIS_STABILITY : 0u) |
+           ((mask & CF_RESULT_STRENGTH) ? ANALYSIS_STRENGTH : 0u);
+}
+
+/**
+ * Run the analysis stages not held yet and refresh the public result.
+ * Stability is cheap and rerun with any other stage; a strength solve
+ * already done is carried over.
+ */
+static void materialize(CargoForge *cf, unsigned int stages) {
+    unsigned int missing = stages & ~cf->stages_done;
+    if (!cf->analyzed || (cf->result_valid && !missing)) return;
+
+    unsigned int run = missing | (cf->stages_done & ANALYSIS_STABILITY);
+    double t0 = phase_begin(cf);
+    AnalysisResult r = perform_analysis_stages(&cf->ship, &cf->moments, run);
+    phase_end(cf, t0, &cf->stats.analysis_ms);
+
+    if (cf->stages_done & ~run & ANALYSIS_STRENGTH) {
+        r.max_shear_force    = cf->analysis.max_shear_force;
+        r.max_bending_moment = cf->analysis.max_bending_moment;
+        r.strength_compliant = cf->analysis.strength_compliant;
+    }
+    cf->analysis = r;
+    cf->stages_done |= run;
+
+    convert_result(&cf->ship, &cf->analysis, &cf->result);
     cf->result_valid = 1;
 }
 
+/** The plan or tank state changed: analysis is due again, on demand */
+static void mark_analyzed(CargoForge *cf) {
+    cf->analyzed = 1;
+    cf->stages_done = 0;
+    cf->result_valid = 0;
+}
+
+/** Forget the cached JSON; an arena handle keeps the buffer warm */
+static void drop_json(CargoForge *cf) {
+    cf->json_cache = NULL;
+    if (cf->use_arena) {
+        cf->json.len = 0;
+        cf->json.oom = 0;
+    } else {
+        json_writer_free(&cf->json);
+    }
+}
+
 static void invalidate_results(CargoForge *cf) {
     cf->analyzed = 0;
+    cf->stages_done = 0;
     cf->result_valid = 0;
     cf->imdg_checked = 0;
-    if (cf->json_cache) {
-        free(cf->json_cache);
-        cf->json_cache = NULL;
+    cf->plan_valid = 0;
+    imdg_result_free(&cf->imdg);
+    drop_json(cf);
+}
+
+/** Free the handle's ship, handing borrowed tables back to the template */
+static void release_ship(CargoForge *cf) {
+    if (cf->tpl) {
+        cf->ship.hydro = NULL;
+        cf->ship.strength_limits = NULL;
+        cf->ship.holds = NULL;
+        cargoforge_template_release(cf->tpl);
+        cf->tpl = NULL;
+    }
+    ship_cleanup(&cf->ship);
+}
+
+static void drop_plan(CargoForge *cf) {
+    cf->planned = 0;
+    placement_state_free(&cf->placement);
+}
+
+/** Close cargo item i's gap in the manifest (its DG record stays pooled) */
+static void erase_cargo(Ship *ship, int i) {
+    memmove(&ship->cargo[i], &ship->cargo[i + 1],
+            (size_t)(ship->cargo_count - i - 1) * sizeof(Cargo));
+    ship->cargo_count--;
+}
+
+/**
+ * Placement's stop hook for a running job. The first poll after a cancel
+ * or past the deadline latches the reason, so every caller agrees.
+ */
+static int job_should_stop(void *ctx) {
+    CfJob *job = ctx;
+    double now = job->deadline > 0.0 ? now_ms() : 0.0;
+    pthread_mutex_lock(&job->lock);
+    if (!job->stop_status) {
+        if (job->cancel) job->stop_status = CF_ERR_CANCELLED;
+        else if (job->deadline > 0.0 && now >= job->deadline) job->stop_status = CF_ERR_TIMEOUT;
+    }
+    int stopped = job->stop_status != 0;
+    pthread_mutex_unlock(&job->lock);
+    return stopped;
+}
+
+/** CF_ERR_CANCELLED or CF_ERR_TIMEOUT once the running job was stopped, else 0 */
+static int stop_status(CargoForge *cf) {
+    CfJob *job = cf->running;
+    if (!job) return 0;
+    pthread_mutex_lock(&job->lock);
+    int status = job->stop_status;
+    pthread_mutex_unlock(&job->lock);
+    return status;
+}
+
+/** Throw away a stopped optimize: no plan, no result, cargo unplaced */
+static int abandon_optimize(CargoForge *cf, int status) {
+    for (int i = 0; i < cf->ship.cargo_count; i++)
+        CARGO_UNPLACE(&cf->ship.cargo[i]);
+    invalidate_results(cf);
+    drop_plan(cf);
+    set_error(cf, status == CF_ERR_TIMEOUT ? "Job deadline passed" : "Job cancelled");
+    return status;
+}
+
+/* Placement never writes to stderr from the library; with
+ * CF_OPT_DIAGNOSTICS set it reports into cf->diag instead */
+static void placement_opts(CargoForge *cf, PlacementOptions *popts) {
+    cf->ship.quiet = 1;
+    placement_options_init(popts);
+    popts->pool = cf->pool;
+    popts->engine = cf->plan_placer;
+    if (cf->diag.capacity > 0) popts->diag = &cf->diag;
+    if (cf->stats_on) popts->stats = &cf->pstats;
+    if (cf->running) {
+        popts->should_stop = job_should_stop;
+        popts->stop_ctx = cf->running;
     }
 }
 
+/**
+ * Make sure the kept plan has its bins. Multistart does not hand its bins
+ * back, so they are rebuilt by replaying the winning order, which the
+ * placer reproduces exactly.
+ */
+static int ensure_placement(CargoForge *cf) {
+    if (cf->placement.bins) return CF_OK;
+
+    Ship *ship = &cf->ship;
+    for (int i = 0; i < ship->cargo_count; i++)
+        CARGO_UNPLACE(&ship->cargo[i]);
+
+    PlacementOptions popts;
+    placement_opts(cf, &popts);
+    popts.presorted = 1;
+    popts.state = &cf->placement;
+
+    int quiet = ship->quiet;
+    ship->quiet = 1;
+    place_cargo_3d_opts(ship, &popts);
+    ship->quiet = quiet;
+
+    cargo_moments_compute(ship, &cf->moments);
+    if (!cf->placement.bins) {
+        set_error(cf, "Out of memory rebuilding placement state");
+        return CF_ERR_NOMEM;
+    }
+    return CF_OK;
+}
+
+/** The analysis is re-derived from the running moment sums after an edit */
+static void refresh_results(CargoForge *cf) {
+    invalidate_results(cf);
+    mark_analyzed(cf);
+}
+
 /* ------------------------------------------------------------------ */
 /* LIFECYCLE                                                          */
 /* ------------------------------------------------------------------ */
@@ -135,47 +363,176 @@ int cargoforge_open(CargoForge **out) {
     if (!cf) return CF_ERR_NOMEM;
 
     cf->result.strength_compliant = -1;
+    cf->threads = 1;
+    cf->strategy = CF_STRATEGY_FFD;
+    cf->beam_width = 4;
+    cf->result_mask = CF_RESULT_ALL;
     *out = cf;
     return CF_OK;
 }
 
 void cargoforge_close(CargoForge *cf) {
     if (!cf) return;
+    if (cf->job) cargoforge_job_cancel(cf->job);
+    thread_pool_destroy(cf->executor);    /* returns once the job is done */
+    cargoforge_job_release(cf->job);
     if (cf->ship_loaded || cf->cargo_loaded)
-        ship_cleanup(&cf->ship);
-    if (cf->json_cache)
-        free(cf->json_cache);
+        release_ship(cf);
+    json_writer_free(&cf->json);
+    free(cf->plan_block);
+    imdg_result_free(&cf->imdg);
+    diag_log_free(&cf->diag);
+    placement_state_free(&cf->placement);
+    thread_pool_destroy(cf->pool);
+    arena_free(&cf->arena);
     free(cf);
 }
 
+int cargoforge_set_option(CargoForge *cf, int option, int value) {
+    if (!cf) return CF_ERROR;
+
+    switch (option) {
+        case CF_OPT_THREADS:
+            if (value < 0) return CF_ERROR;
+            if (value != cf->threads) {
+                thread_pool_destroy(cf->pool);
+                cf->pool = NULL;
+                cf->threads = value;
+            }
+            return CF_OK;
+        case CF_OPT_STRATEGY:
+            if (value != CF_STRATEGY_FFD && value != CF_STRATEGY_MULTISTART) return CF_ERROR;
+            cf->strategy = value;
+            return CF_OK;
+        case CF_OPT_TIME_BUDGET:
+            if (value < 0) return CF_ERROR;
+            cf->time_budget_ms = value;
+            return CF_OK;
+        case CF_OPT_BEAM_WIDTH:
+            if (value < 1) return CF_ERROR;
+            cf->beam_width = value;
+            return CF_OK;
+        case CF_OPT_JSON_COMPACT:
+            if (value != 0 && value != 1) return CF_ERROR;
+            if (value != cf->json_compact) {
+                drop_json(cf);
+                cf->json_compact = value;
+            }
+            return CF_OK;
+        case CF_OPT_DIAGNOSTICS:
+            if (value < 0) return CF_ERROR;
+            if (value != cf->diag.capacity) {
+                diag_log_free(&cf->diag);
+                if (diag_log_init(&cf->diag, value) != 0) return CF_ERR_NOMEM;
+            }
+            return CF_OK;
+        case CF_OPT_STATS:
+            if (value != 0 && value != 1) return CF_ERROR;
+            cf->stats_on = value;
+            return CF_OK;
+        case CF_OPT_PLACER:
+            if (value != CF_PLACER_GUILLOTINE && value != CF_PLACER_EXTREME_POINTS)
+                return CF_ERROR;
+            cf->placer = value;
+            return CF_OK;
+        case CF_OPT_RESULT_MASK:
+            if (value & ~CF_RESULT_ALL) return CF_ERROR;
+            if (value != cf->result_mask) {
+                drop_json(cf);
+                cf->result_mask = value;
+            }
+            return CF_OK;
+        case CF_OPT_JSON_CARGO_FIRST:
+        case CF_OPT_JSON_CARGO_COUNT: {
+            if (value < 0) return CF_ERROR;
+            int *slot = option == CF_OPT_JSON_CARGO_FIRST ? &cf->json_first : &cf->json_count;
+            if (value != *slot) {
+                drop_json(cf);
+                *slot = value;
+            }
+            return CF_OK;
+        }
+        case CF_OPT_ARENA:
+            if (value != 0 && value != 1) return CF_ERROR;
+            if (value == cf->use_arena) return CF_OK;
+            if (cf->ship_loaded || cf->cargo_loaded) return CF_ERR_STATE;
+            drop_json(cf);
+            json_writer_free(&cf->json);
+            arena_free(&cf->arena);
+            cf->use_arena = value;
+            return CF_OK;
+        default:
+            return CF_ERROR;
+    }
+}
+
+int cargoforge_get_option(const CargoForge *cf, int option) {
+    if (!cf) return CF_ERROR;
+
+    switch (option) {
+        case CF_OPT_THREADS:     return cf->threads;
+        case CF_OPT_STRATEGY:    return cf->strategy;
+        case CF_OPT_TIME_BUDGET: return cf->time_budget_ms;
+        case CF_OPT_BEAM_WIDTH:  return cf->beam_width;
+        case CF_OPT_JSON_COMPACT: return cf->json_compact;
+        case CF_OPT_DIAGNOSTICS: return cf->diag.capacity;
+        case CF_OPT_ARENA:       return cf->use_arena;
+        case CF_OPT_STATS:       return cf->stats_on;
+        case CF_OPT_PLACER:      return cf->placer;
+        case CF_OPT_RESULT_MASK: return cf->result_mask;
+        case CF_OPT_JSON_CARGO_FIRST: return cf->json_first;
+        case CF_OPT_JSON_CARGO_COUNT: return cf->json_count;
+        default:                 return CF_ERROR;
+    }
+}
+
 /* ------------------------------------------------------------------ */
 /* DATA LOADING                                                       */
 /* ------------------------------------------------------------------ */
 
-int cargoforge_load_ship(CargoForge *cf, const char *config_path) {
-    if (!cf || !config_path) return CF_ERROR;
-    clear_error(cf);
-
-    /* Reset if reloading */
+/** Drop the ship, cargo and plan before another ship is loaded */
+static void unload_ship(CargoForge *cf) {
     if (cf->ship_loaded || cf->cargo_loaded) {
-        ship_cleanup(&cf->ship);
+        release_ship(cf);
         memset(&cf->ship, 0, sizeof(cf->ship));
         cf->ship_loaded = 0;
         cf->cargo_loaded = 0;
         invalidate_results(cf);
     }
+    drop_plan(cf);
+    arena_reset(&cf->arena);
+    cf->ship.arena = cf->use_arena ? &cf->arena : NULL;
+}
+
+/** The ship is in: cargo goes after its tables in the arena */
+static void mark_ship_loaded(CargoForge *cf) {
+    cf->ship_loaded = 1;
+    cf->cargo_mark = arena_mark(&cf->arena);
+}
 
-    if (parse_ship_config(config_path, &cf->ship) != 0) {
+/**
+ * Load a ship config from a file path, or from len bytes of text when
+ * path is NULL.
+ */
+static int load_ship(CargoForge *cf, const char *path, const char *text, size_t len) {
+    clear_error(cf);
+    unload_ship(cf);
+
+    double t0 = phase_begin(cf);
+    int rc = path ? parse_ship_config(path, &cf->ship)
+                  : parse_ship_config_buffer(text, len, &cf->ship);
+    phase_end(cf, t0, &cf->stats.ship_parse_ms);
+    if (rc != 0) {
         set_error(cf, "Failed to parse ship configuration");
         return CF_ERR_PARSE;
     }
 
-    cf->ship_loaded = 1;
+    mark_ship_loaded(cf);
     return CF_OK;
 }
 
-int cargoforge_load_cargo(CargoForge *cf, const char *manifest_path) {
-    if (!cf || !manifest_path) return CF_ERROR;
+/** Cargo counterpart of load_ship() */
+static int load_cargo(CargoForge *cf, const char *path, const char *text, size_t len) {
     clear_error(cf);
 
     if (!cf->ship_loaded) {
@@ -185,23 +542,22 @@ int cargoforge_load_cargo(CargoForge *cf, const char *manifest_path) {
 
     /* Free existing cargo if reloading */
     if (cf->cargo_loaded) {
-        if (cf->ship.cargo) {
-            for (int i = 0; i < cf->ship.cargo_count; i++) {
-                if (cf->ship.cargo[i].dg) {
-                    free(cf->ship.cargo[i].dg);
-                    cf->ship.cargo[i].dg = NULL;
-                }
-            }
-            free(cf->ship.cargo);
-            cf->ship.cargo = NULL;
-        }
+        ship_free(&cf->ship, cf->ship.cargo);
+        cf->ship.cargo = NULL;
+        cargo_pools_destroy(&cf->ship);
         cf->ship.cargo_count = 0;
         cf->ship.cargo_capacity = 0;
         cf->cargo_loaded = 0;
         invalidate_results(cf);
     }
-
-    if (parse_cargo_list(manifest_path, &cf->ship) != 0) {
+    drop_plan(cf);
+    arena_rewind(&cf->arena, cf->cargo_mark);
+
+    double t0 = phase_begin(cf);
+    int rc = path ? cfb_load_manifest(path, &cf->ship)
+                  : parse_cargo_list_buffer(text, len, &cf->ship);
+    phase_end(cf, t0, &cf->stats.cargo_parse_ms);
+    if (rc != 0) {
         set_error(cf, "Failed to parse cargo manifest");
         return CF_ERR_PARSE;
     }
@@ -210,32 +566,135 @@ int cargoforge_load_cargo(CargoForge *cf, const char *manifest_path) {
     return CF_OK;
 }
 
+int cargoforge_load_ship(CargoForge *cf, const char *config_path) {
+    if (!cf || !config_path) return CF_ERROR;
+    return load_ship(cf, config_path, NULL, 0);
+}
+
+int cargoforge_load_cargo(CargoForge *cf, const char *manifest_path) {
+    if (!cf || !manifest_path) return CF_ERROR;
+    return load_cargo(cf, manifest_path, NULL, 0);
+}
+
 int cargoforge_load_ship_string(CargoForge *cf, const char *config_text) {
     if (!cf || !config_text) return CF_ERROR;
+    return load_ship(cf, NULL, config_text, strlen(config_text));
+}
 
-    char tmppath[256];
-    if (write_temp_file(config_text, tmppath, sizeof(tmppath)) != 0) {
-        set_error(cf, "Failed to create temporary file for ship config");
-        return CF_ERR_FILE;
+int cargoforge_load_cargo_string(CargoForge *cf, const char *manifest_text) {
+    if (!cf || !manifest_text) return CF_ERROR;
+    return load_cargo(cf, NULL, manifest_text, strlen(manifest_text));
+}
+
+int cargoforge_load_ship_buffer(CargoForge *cf, const char *text, size_t len) {
+    if (!cf || (!text && len > 0)) return CF_ERROR;
+    return load_ship(cf, NULL, text ? text : "", len);
+}
+
+int cargoforge_load_cargo_buffer(CargoForge *cf, const char *text, size_t len) {
+    if (!cf || (!text && len > 0)) return CF_ERROR;
+    return load_cargo(cf, NULL, text ? text : "", len);
+}
+
+/* ------------------------------------------------------------------ */
+/* SHIP TEMPLATES                                                     */
+/* ------------------------------------------------------------------ */
+
+static int template_load(CfShipTemplate **out, const char *path, const char *text, size_t len) {
+    *out = NULL;
+    CfShipTemplate *tpl = calloc(1, sizeof(CfShipTemplate));
+    if (!tpl) return CF_ERR_NOMEM;
+
+    int rc = path ? parse_ship_config(path, &tpl->ship)
+                  : parse_ship_config_buffer(text, len, &tpl->ship);
+    if (rc != 0) {
+        ship_cleanup(&tpl->ship);
+        free(tpl);
+        return CF_ERR_PARSE;
     }
+    pthread_mutex_init(&tpl->lock, NULL);
+    tpl->refs = 1;
+    *out = tpl;
+    return CF_OK;
+}
 
-    int rc = cargoforge_load_ship(cf, tmppath);
-    unlink(tmppath);
-    return rc;
+int cargoforge_template_load(CfShipTemplate **tpl, const char *config_path) {
+    if (!tpl || !config_path) return CF_ERROR;
+    return template_load(tpl, config_path, NULL, 0);
 }
 
-int cargoforge_load_cargo_string(CargoForge *cf, const char *manifest_text) {
-    if (!cf || !manifest_text) return CF_ERROR;
+int cargoforge_template_load_buffer(CfShipTemplate **tpl, const char *text, size_t len) {
+    if (!tpl || (!text && len > 0)) return CF_ERROR;
+    return template_load(tpl, NULL, text ? text : "", len);
+}
 
-    char tmppath[256];
-    if (write_temp_file(manifest_text, tmppath, sizeof(tmppath)) != 0) {
-        set_error(cf, "Failed to create temporary file for cargo manifest");
-        return CF_ERR_FILE;
+CfShipTemplate *cargoforge_template_retain(CfShipTemplate *tpl) {
+    if (!tpl) return NULL;
+    pthread_mutex_lock(&tpl->lock);
+    tpl->refs++;
+    pthread_mutex_unlock(&tpl->lock);
+    return tpl;
+}
+
+void cargoforge_template_release(CfShipTemplate *tpl) {
+    if (!tpl) return;
+    pthread_mutex_lock(&tpl->lock);
+    int last = (--tpl->refs == 0);
+    pthread_mutex_unlock(&tpl->lock);
+    if (!last) return;
+
+    ship_cleanup(&tpl->ship);
+    pthread_mutex_destroy(&tpl->lock);
+    free(tpl);
+}
+
+int cargoforge_load_ship_template(CargoForge *cf, CfShipTemplate *tpl) {
+    if (!cf || !tpl) return CF_ERROR;
+    clear_error(cf);
+    unload_ship(cf);
+    double t0 = phase_begin(cf);
+
+    /* Tanks are the one per-handle table: fill levels change per voyage */
+    TankConfig *tanks = NULL;
+    if (tpl->ship.tanks) {
+        tanks = ship_alloc(&cf->ship, sizeof(TankConfig));
+        if (!tanks || tank_config_copy(tanks, tpl->ship.tanks) != 0) {
+            ship_free(&cf->ship, tanks);
+            set_error(cf, "Out of memory copying tank configuration");
+            return CF_ERR_NOMEM;
+        }
     }
 
-    int rc = cargoforge_load_cargo(cf, tmppath);
-    unlink(tmppath);
-    return rc;
+    Arena *arena = cf->ship.arena;
+    cf->ship = tpl->ship;
+    cf->ship.tanks = tanks;
+    cf->ship.arena = arena;
+    cf->tpl = cargoforge_template_retain(tpl);
+    mark_ship_loaded(cf);
+    phase_end(cf, t0, &cf->stats.ship_parse_ms);
+    return CF_OK;
+}
+
+int cargoforge_tank_count(const CargoForge *cf) {
+    if (!cf || !cf->ship_loaded || !cf->ship.tanks) return 0;
+    return cf->ship.tanks->count;
+}
+
+int cargoforge_set_tank_fill(CargoForge *cf, int index, float fill) {
+    if (index < 0 || index >= cargoforge_tank_count(cf)) return CF_ERROR;
+    if (!(fill >= 0.0f && fill <= 1.0f)) return CF_ERROR;
+
+    cf->ship.tanks->tanks[index].fill_fraction = fill;
+    invalidate_results(cf);
+    return CF_OK;
+}
+
+int cargoforge_set_tank_sounding(CargoForge *cf, int index, float sounding_m) {
+    if (index < 0 || index >= cargoforge_tank_count(cf)) return CF_ERROR;
+    if (!isfinite(sounding_m)) return CF_ERROR;
+
+    Tank *t = &cf->ship.tanks->tanks[index];
+    return cargoforge_set_tank_fill(cf, index, tank_fill_at_sounding(t, sounding_m));
 }
 
 /* ------------------------------------------------------------------ */
@@ -256,15 +715,52 @@ int cargoforge_optimize(CargoForge *cf) {
     }
 
     invalidate_results(cf);
+    drop_plan(cf);
+    diag_log_clear(&cf->diag);
+    memset(&cf->pstats, 0, sizeof(cf->pstats));
+
+    /* Run 3D bin-packing, on the handle's worker pool when threaded */
+    double t0 = phase_begin(cf);
+    if (cf->threads != 1 && !cf->pool)
+        cf->pool = thread_pool_create(cf->threads);
+    cf->plan_placer = cf->placer;
+
+    if (cf->strategy == CF_STRATEGY_MULTISTART) {
+        OptimizerOptions oopts;
+        optimizer_options_init(&oopts);
+        oopts.threads = 1;            /* serial unless the handle has a pool */
+        oopts.pool = cf->pool;
+        oopts.engine = cf->placer;
+        oopts.time_budget_ms = cf->time_budget_ms;
+        oopts.beam_width = cf->beam_width;
+        if (cf->running) {
+            oopts.should_stop = job_should_stop;
+            oopts.stop_ctx = cf->running;
+        }
+        if (optimize_multi_start(&cf->ship, &oopts, NULL) != 0) {
+            if (stop_status(cf)) return abandon_optimize(cf, stop_status(cf));
+            set_error(cf, "Out of memory during multistart search");
+            return CF_ERR_NOMEM;
+        }
+        /* The trials record nothing; replay the winner for the log */
+        if ((cf->diag.capacity > 0 || cf->stats_on) && !stop_status(cf)) {
+            int rc = ensure_placement(cf);
+            if (rc != CF_OK && !stop_status(cf)) return rc;
+        }
+    } else {
+        /* Keep the bins so late manifest changes can be applied in place */
+        PlacementOptions popts;
+        placement_opts(cf, &popts);
+        popts.state = &cf->placement;
+        place_cargo_3d_opts(&cf->ship, &popts);
+    }
+    if (stop_status(cf)) return abandon_optimize(cf, stop_status(cf));
+    cf->planned = 1;
+    phase_end(cf, t0, &cf->stats.place_ms);
 
-    /* Run 3D bin-packing */
-    place_cargo_3d(&cf->ship);
-
-    /* Run stability analysis */
-    cf->analysis = perform_analysis(&cf->ship);
-    cf->analyzed = 1;
-
-    fill_result(cf);
+    /* Stability analysis runs when a result is first read */
+    cargo_moments_compute(&cf->ship, &cf->moments);
+    mark_analyzed(cf);
     return CF_OK;
 }
 
@@ -278,11 +774,163 @@ int cargoforge_analyze(CargoForge *cf) {
     }
 
     invalidate_results(cf);
+    cargo_moments_compute(&cf->ship, &cf->moments);
+    mark_analyzed(cf);
+    return CF_OK;
+}
 
-    cf->analysis = perform_analysis(&cf->ship);
-    cf->analyzed = 1;
+int cargoforge_analyze_batch(CargoForge *cf, const CfCondition *conds, int count,
+                             CfResult *results) {
+    if (!cf || count < 0 || (count > 0 && (!conds || !results))) return CF_ERROR;
+    clear_error(cf);
+
+    if (!cf->ship_loaded) {
+        set_error(cf, "No ship configuration loaded");
+        return CF_ERR_NO_SHIP;
+    }
+    if (count == 0) return CF_OK;
+
+    int tanks = cargoforge_tank_count(cf);
+    size_t nweights = 0;
+    for (int i = 0; i < count; i++) {
+        const CfCondition *c = &conds[i];
+        if (c->weight_count < 0 || (c->weight_count > 0 && !c->weights)) {
+            snprintf(cf->errmsg, sizeof(cf->errmsg), "Bad weight list in condition %d", i);
+            return CF_ERROR;
+        }
+        nweights += (size_t)c->weight_count;
+        if (!c->tank_fill) continue;
+        if (tanks == 0) {
+            set_error(cf, "Tank fills given but the ship has no tanks");
+            return CF_ERROR;
+        }
+        for (int t = 0; t < tanks; t++) {
+            if (!(c->tank_fill[t] >= 0.0f && c->tank_fill[t] <= 1.0f)) {
+                snprintf(cf->errmsg, sizeof(cf->errmsg),
+                         "Tank %d fill out of range in condition %d", t, i);
+                return CF_ERROR;
+            }
+        }
+    }
+
+    LoadCondition *lc = malloc((size_t)count * sizeof(*lc));
+    WeightDelta *wd = nweights ? malloc(nweights * sizeof(*wd)) : NULL;
+    AnalysisResult *ar = malloc((size_t)count * sizeof(*ar));
+    if (!lc || !ar || (nweights && !wd)) {
+        free(lc);
+        free(wd);
+        free(ar);
+        set_error(cf, "Out of memory");
+        return CF_ERR_NOMEM;
+    }
+
+    size_t w = 0;
+    for (int i = 0; i < count; i++) {
+        lc[i].tank_fill = conds[i].tank_fill;
+        lc[i].weights = wd ? wd + w : NULL;
+        lc[i].weight_count = conds[i].weight_count;
+        for (int k = 0; k < conds[i].weight_count; k++, w++) {
+            wd[w].weight_kg = conds[i].weights[k].weight;
+            wd[w].x = conds[i].weights[k].x;
+            wd[w].y = conds[i].weights[k].y;
+            wd[w].z = conds[i].weights[k].z;
+        }
+    }
+
+    if (cf->threads != 1 && !cf->pool)
+        cf->pool = thread_pool_create(cf->threads);
+    int rc = perform_analysis_batch(&cf->ship, lc, count, ar, cf->pool);
+    if (rc == 0) {
+        for (int i = 0; i < count; i++)
+            convert_result(&cf->ship, &ar[i], &results[i]);
+    } else {
+        set_error(cf, "Out of memory");
+    }
+
+    free(lc);
+    free(wd);
+    free(ar);
+    return rc == 0 ? CF_OK : CF_ERR_NOMEM;
+}
+
+int cargoforge_simulate_sequence(CargoForge *cf, const CfMove *moves, int count,
+                                 CfSequenceStep *steps) {
+    if (!cf || count < 0 || !steps) return CF_ERROR;
+    clear_error(cf);
+
+    if (!cf->ship_loaded) {
+        set_error(cf, "No ship configuration loaded");
+        return CF_ERR_NO_SHIP;
+    }
+    if (!cf->cargo_loaded) {
+        set_error(cf, "No cargo manifest loaded");
+        return CF_ERR_NO_CARGO;
+    }
+
+    const Ship *ship = &cf->ship;
+    SequenceMove *seq = malloc(((size_t)count + 1) * sizeof(*seq));
+    SequenceStep *out = malloc(((size_t)count + 1) * sizeof(*out));
+    if (!seq || !out) {
+        free(seq);
+        free(out);
+        set_error(cf, "Out of memory");
+        return CF_ERR_NOMEM;
+    }
+
+    int n = 0;
+    if (moves) {
+        for (n = 0; n < count; n++) {
+            seq[n].cargo = moves[n].cargo;
+            seq[n].op = moves[n].op == CF_MOVE_LOAD ? SEQ_LOAD :
+                        moves[n].op == CF_MOVE_DISCHARGE ? SEQ_DISCHARGE : 0;
+        }
+    } else {
+        for (int i = 0; i < ship->cargo_count && n <= count; i++) {
+            if (!CARGO_IS_PLACED(&ship->cargo[i])) continue;
+            if (n < count) {
+                seq[n].cargo = i;
+                seq[n].op = SEQ_LOAD;
+            }
+            n++;
+        }
+    }
+
+    double t0 = phase_begin(cf);
+    int rc = (n == count) ? simulate_load_sequence(ship, seq, count, out) : -1;
+    phase_end(cf, t0, &cf->stats.analysis_ms);
+    free(seq);
+    if (rc != 0) {
+        free(out);
+        if (rc == -2) {
+            set_error(cf, "Out of memory");
+            return CF_ERR_NOMEM;
+        }
+        set_error(cf, moves ? "Invalid move: unknown or unplaced item, bad op, or "
+                              "loads and discharges out of order"
+                            : "Replay count does not match the placed items");
+        return CF_ERROR;
+    }
 
-    fill_result(cf);
+    for (int k = 0; k <= count; k++) {
+        const SequenceStep *a = &out[k];
+        CfSequenceStep *r = &steps[k];
+        r->cargo              = a->cargo;
+        r->op                 = a->op == SEQ_LOAD ? CF_MOVE_LOAD :
+                                a->op == SEQ_DISCHARGE ? CF_MOVE_DISCHARGE : 0;
+        r->on_board           = a->on_board;
+        r->cargo_weight       = a->cargo_weight_t * 1000.0f;
+        r->displacement       = a->displacement_t * 1000.0f;
+        r->draft              = a->draft;
+        r->trim               = a->trim;
+        r->heel               = a->heel;
+        r->gm_corrected       = a->gm_corrected;
+        r->max_shear_force    = a->max_shear_force;
+        r->max_bending_moment = a->max_bending_moment;
+        r->imo_compliant      = a->imo_compliant;
+        r->strength_compliant = a->strength_compliant;
+        r->overweight         = a->overweight;
+    }
+    free(out);
     return CF_OK;
 }
 
@@ -295,44 +943,441 @@ int cargoforge_check_imdg(CargoForge *cf) {
         return CF_ERR_STATE;
     }
 
+    imdg_result_free(&cf->imdg);
+    double t0 = phase_begin(cf);
     cf->imdg = imdg_check_all(&cf->ship);
+    phase_end(cf, t0, &cf->stats.imdg_ms);
     cf->imdg_checked = 1;
     return CF_OK;
 }
 
+static int find_cargo(const Ship *ship, const char *id) {
+    for (int i = 0; i < ship->cargo_count; i++)
+        if (strcmp(CARGO_ID(&ship->cargo[i]), id) == 0) return i;
+    return -1;
+}
+
+int cargoforge_add_cargo(CargoForge *cf, const char *id, float weight,
+                         float length, float width, float height,
+                         const char *type) {
+    if (!cf || !id) return CF_ERROR;
+    clear_error(cf);
+
+    if (!cf->ship_loaded) {
+        set_error(cf, "Ship configuration must be loaded before cargo");
+        return CF_ERR_NO_SHIP;
+    }
+    if (id[0] == '\0' || strlen(id) >= sizeof(((CargoLabel *)0)->id) ||
+        !(weight > 0.0f) || !(length > 0.0f) || !(width > 0.0f) || !(height > 0.0f) ||
+        weight > 1e9f || length > 1e4f || width > 1e4f || height > 1e4f) {
+        set_error(cf, "Invalid cargo id, weight or dimensions");
+        return CF_ERROR;
+    }
+
+    Ship *ship = &cf->ship;
+    if (find_cargo(ship, id) >= 0) {
+        set_error(cf, "Cargo id already in manifest");
+        return CF_ERROR;
+    }
+
+    /* Rebuild a multistart plan's bins before the new item joins the manifest */
+    double t0 = phase_begin(cf);
+    if (cf->planned) {
+        int rc = ensure_placement(cf);
+        if (rc != CF_OK) return rc;
+    }
+
+    if (ship->cargo_count >= ship->cargo_capacity) {
+        int cap = ship->cargo_capacity > 0 ? ship->cargo_capacity * 2 : 16;
+        Cargo *grown = ship_realloc(ship, ship->cargo,
+                                    (size_t)ship->cargo_capacity * sizeof(Cargo),
+                                    (size_t)cap * sizeof(Cargo));
+        if (!grown) {
+            set_error(cf, "Out of memory adding cargo");
+            return CF_ERR_NOMEM;
+        }
+        ship->cargo = grown;
+        ship->cargo_capacity = cap;
+    }
+
+    int idx = ship->cargo_count;
+    Cargo *c = &ship->cargo[idx];
+    memset(c, 0, sizeof(*c));
+    if (!type) type = "standard";
+    /* Over-long types are truncated like the text parser does */
+    if (cargo_set_label(ship, c, id, strlen(id), type, strlen(type)) != 0) {
+        set_error(cf, "Out of memory adding cargo");
+        return CF_ERR_NOMEM;
+    }
+    c->weight = weight;
+    c->dimensions[0] = length;
+    c->dimensions[1] = width;
+    c->dimensions[2] = height;
+    CARGO_UNPLACE(c);
+    ship->cargo_count++;
+    cf->cargo_loaded = 1;
+
+    if (!cf->planned) {
+        invalidate_results(cf);
+        return CF_OK;
+    }
+
+    PlacementOptions popts;
+    placement_opts(cf, &popts);
+    if (placement_state_place(&cf->placement, ship, &idx, 1, &popts) < 0) {
+        set_error(cf, "Out of memory placing cargo");
+        drop_plan(cf);
+        invalidate_results(cf);
+        return CF_ERR_NOMEM;
+    }
+    cargo_moments_add(&cf->moments, c);
+    phase_end(cf, t0, &cf->stats.place_ms);
+
+    refresh_results(cf);
+    return CF_OK;
+}
+
+static float cargo_volume(const Cargo *c) {
+    return c->dimensions[0] * c->dimensions[1] * c->dimensions[2];
+}
+
+/* Re-place released items largest first, as a full FFD pass would
+ * (insertion sort: only a handful of items are ever released) */
+static void sort_by_volume_desc(const Ship *ship, int *items, int n) {
+    for (int i = 1; i < n; i++) {
+        int item = items[i];
+        float v = cargo_volume(&ship->cargo[item]);
+        int j = i;
+        for (; j > 0 && cargo_volume(&ship->cargo[items[j - 1]]) < v; j--)
+            items[j] = items[j - 1];
+        items[j] = item;
+    }
+}
+
+int cargoforge_remove_cargo(CargoForge *cf, const char *id) {
+    if (!cf || !id) return CF_ERROR;
+    clear_error(cf);
+
+    Ship *ship = &cf->ship;
+    int idx = cf->cargo_loaded ? find_cargo(ship, id) : -1;
+    if (idx < 0) {
+        set_error(cf, "No cargo with that id in manifest");
+        return CF_ERROR;
+    }
+
+    if (!cf->planned) {
+        erase_cargo(ship, idx);
+        invalidate_results(cf);
+        return CF_OK;
+    }
+
+    double t0 = phase_begin(cf);
+    int rc = ensure_placement(cf);
+    if (rc != CF_OK) return rc;
+
+    /* The item and everything stacked on it give their space back */
+    int *affected = malloc((size_t)ship->cargo_count * sizeof(int));
+    if (!affected) {
+        set_error(cf, "Out of memory removing cargo");
+        return CF_ERR_NOMEM;
+    }
+    int n = placement_state_dependents(&cf->placement, ship, idx, affected);
+    for (int k = 0; k < n; k++) {
+        Cargo saved = ship->cargo[affected[k]];
+        if (placement_state_release(&cf->placement, ship, affected[k]) != 0) {
+            free(affected);
+            set_error(cf, "Out of memory removing cargo");
+            drop_plan(cf);
+            invalidate_results(cf);
+            return CF_ERR_NOMEM;
+        }
+        cargo_moments_remove(&cf->moments, &saved);
+    }
+
+    placement_state_erase(&cf->placement, idx);
+    erase_cargo(ship, idx);
+
+    /* Put the items that were resting on it back, skipping the removed one */
+    int m = 0;
+    for (int k = 0; k < n; k++) {
+        if (affected[k] == idx) continue;
+        affected[m++] = affected[k] > idx ? affected[k] - 1 : affected[k];
+    }
+    sort_by_volume_desc(ship, affected, m);
+
+    PlacementOptions popts;
+    placement_opts(cf, &popts);
+    if (m > 0 && placement_state_place(&cf->placement, ship, affected, m, &popts) < 0) {
+        free(affected);
+        set_error(cf, "Out of memory re-placing cargo");
+        drop_plan(cf);
+        invalidate_results(cf);
+        return CF_ERR_NOMEM;
+    }
+    for (int k = 0; k < m; k++)
+        cargo_moments_add(&cf->moments, &ship->cargo[affected[k]]);
+    free(affected);
+    phase_end(cf, t0, &cf->stats.place_ms);
+
+    refresh_results(cf);
+    return CF_OK;
+}
+
 void cargoforge_reset(CargoForge *cf) {
     if (!cf) return;
 
     if (cf->ship_loaded || cf->cargo_loaded)
-        ship_cleanup(&cf->ship);
+        release_ship(cf);
+    drop_plan(cf);
 
     memset(&cf->ship, 0, sizeof(cf->ship));
     memset(&cf->analysis, 0, sizeof(cf->analysis));
+    imdg_result_free(&cf->imdg);
     memset(&cf->imdg, 0, sizeof(cf->imdg));
     memset(&cf->result, 0, sizeof(cf->result));
 
     cf->ship_loaded = 0;
     cf->cargo_loaded = 0;
     cf->analyzed = 0;
+    cf->stages_done = 0;
     cf->result_valid = 0;
     cf->imdg_checked = 0;
+    cf->plan_valid = 0;
     cf->result.strength_compliant = -1;
+    memset(&cf->stats, 0, sizeof(cf->stats));
+    memset(&cf->pstats, 0, sizeof(cf->pstats));
+
+    drop_json(cf);
+    arena_reset(&cf->arena);
+    clear_error(cf);
+}
+
+int cargoforge_arena_stats(const CargoForge *cf, size_t *used, size_t *reserved) {
+    if (!cf) return CF_ERROR;
+    if (used) *used = arena_used(&cf->arena);
+    if (reserved) *reserved = cf->arena.reserved;
+    return CF_OK;
+}
+
+/* ------------------------------------------------------------------ */
+/* PLACEMENT DIAGNOSTICS                                              */
+/* ------------------------------------------------------------------ */
+
+int cargoforge_diag_count(const CargoForge *cf) {
+    if (!cf) return -1;
+    return diag_log_count(&cf->diag);
+}
+
+int cargoforge_diag_get(const CargoForge *cf, int index, CfDiagnostic *d) {
+    if (!cf || !d) return CF_ERROR;
+    const DiagRecord *r = diag_log_get(&cf->diag, index);
+    if (!r) return CF_ERROR;
+
+    d->cargo_index = r->cargo_idx;
+    memcpy(d->cargo_id, r->cargo_id, sizeof(d->cargo_id));
+    memcpy(d->counts, r->counts, sizeof(d->counts));
+    return CF_OK;
+}
+
+int cargoforge_diag_totals(const CargoForge *cf, long long totals[CF_DIAG_CODE_COUNT],
+                           long long *entries) {
+    if (!cf || !totals) return CF_ERROR;
+    memcpy(totals, cf->diag.totals, sizeof(cf->diag.totals));
+    if (entries) *entries = cf->diag.written;
+    return CF_OK;
+}
+
+void cargoforge_diag_clear(CargoForge *cf) {
+    if (cf) diag_log_clear(&cf->diag);
+}
+
+const char *cargoforge_diag_name(int code) {
+    return diag_code_name(code);
+}
+
+/* ------------------------------------------------------------------ */
+/* INSTRUMENTATION                                                    */
+/* ------------------------------------------------------------------ */
+
+int cargoforge_stats(const CargoForge *cf, CfStats *stats) {
+    if (!cf || !stats) return CF_ERROR;
+    memset(stats, 0, sizeof(*stats));
+    if (cf->stats_on) {
+        *stats = cf->stats;
+        stats->items_searched = cf->pstats.items;
+        stats->spaces_scanned = cf->pstats.spaces_scanned;
+        memcpy(stats->counts, cf->pstats.counts, sizeof(stats->counts));
+    }
+    stats->bin_count = cf->placement.bins ? cf->placement.bin_count : 0;
+    return CF_OK;
+}
+
+int cargoforge_bin_stats(const CargoForge *cf, int index, CfBinStats *b) {
+    if (!cf || !b || !cf->placement.bins) return CF_ERROR;
+    if (index < 0 || index >= cf->placement.bin_count) return CF_ERROR;
+
+    const Bin3D *bin = &cf->placement.bins[index];
+    memcpy(b->name, bin->name, sizeof(b->name));
+    b->free_spaces = bin->spaces.count;
+    b->weight      = bin->current_weight;
+    b->max_weight  = bin->max_weight;
+    return CF_OK;
+}
+
+/* ------------------------------------------------------------------ */
+/* ASYNCHRONOUS JOBS                                                  */
+/* ------------------------------------------------------------------ */
+
+void cargoforge_job_options_init(CfJobOptions *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->op = CF_JOB_OPTIMIZE;
+}
 
-    if (cf->json_cache) {
-        free(cf->json_cache);
-        cf->json_cache = NULL;
+/** Worker side of a job: run the call, report, then let waiters go */
+static void job_run(void *arg) {
+    CfJob *job = arg;
+    CargoForge *cf = job->cf;
+    int status;
+
+    if (job_should_stop(job)) {
+        pthread_mutex_lock(&job->lock);
+        status = job->stop_status;
+        pthread_mutex_unlock(&job->lock);
+        set_error(cf, status == CF_ERR_TIMEOUT ? "Job deadline passed" : "Job cancelled");
+    } else {
+        cf->running = job;
+        status = job->op == CF_JOB_ANALYZE ? cargoforge_analyze(cf) : cargoforge_optimize(cf);
+        cf->running = NULL;
+        /* Results are the job's work too, not the first reader's */
+        if (status == CF_OK) materialize(cf, mask_stages(cf->result_mask));
     }
 
+    if (job->on_done) job->on_done(job, status, job->user);
+
+    pthread_mutex_lock(&job->lock);
+    job->status = status;
+    job->done = 1;
+    pthread_cond_broadcast(&job->done_cond);
+    pthread_mutex_unlock(&job->lock);
+    cargoforge_job_release(job);
+}
+
+int cargoforge_submit(CargoForge *cf, const CfJobOptions *opts, CfJob **out) {
+    if (!cf || !out) return CF_ERROR;
+    *out = NULL;
+
+    CfJobOptions defaults;
+    if (!opts) {
+        cargoforge_job_options_init(&defaults);
+        opts = &defaults;
+    }
+    if ((opts->op != CF_JOB_OPTIMIZE && opts->op != CF_JOB_ANALYZE) || opts->deadline_ms < 0)
+        return CF_ERROR;
+    if (cf->job && cargoforge_job_poll(cf->job) == CF_JOB_PENDING)
+        return CF_ERR_STATE;     /* the handle's error text belongs to that job */
     clear_error(cf);
+
+    if (!cf->executor) {
+        cf->executor = thread_pool_create(1);
+        if (!cf->executor) {
+            set_error(cf, "Cannot start the job worker thread");
+            return CF_ERR_NOMEM;
+        }
+    }
+
+    CfJob *job = calloc(1, sizeof(CfJob));
+    if (!job) {
+        set_error(cf, "Out of memory");
+        return CF_ERR_NOMEM;
+    }
+    job->cf = cf;
+    job->op = opts->op;
+    job->deadline = opts->deadline_ms > 0 ? now_ms() + opts->deadline_ms : 0.0;
+    job->on_done = opts->on_done;
+    job->user = opts->user;
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->done_cond, NULL);
+    job->refs = 3;
+
+    if (thread_pool_submit(cf->executor, job_run, job) != 0) {
+        pthread_cond_destroy(&job->done_cond);
+        pthread_mutex_destroy(&job->lock);
+        free(job);
+        set_error(cf, "Out of memory");
+        return CF_ERR_NOMEM;
+    }
+
+    cargoforge_job_release(cf->job);
+    cf->job = job;
+    *out = job;
+    return CF_OK;
+}
+
+int cargoforge_job_poll(CfJob *job) {
+    if (!job) return CF_ERROR;
+    pthread_mutex_lock(&job->lock);
+    int status = job->done ? job->status : CF_JOB_PENDING;
+    pthread_mutex_unlock(&job->lock);
+    return status;
+}
+
+int cargoforge_job_wait(CfJob *job, int timeout_ms) {
+    if (!job) return CF_ERROR;
+
+    struct timespec until;
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += timeout_ms / 1000;
+        until.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (until.tv_nsec >= 1000000000L) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+    }
+
+    pthread_mutex_lock(&job->lock);
+    while (!job->done) {
+        if (timeout_ms < 0)
+            pthread_cond_wait(&job->done_cond, &job->lock);
+        else if (pthread_cond_timedwait(&job->done_cond, &job->lock, &until) == ETIMEDOUT)
+            break;
+    }
+    int status = job->done ? job->status : CF_JOB_PENDING;
+    pthread_mutex_unlock(&job->lock);
+    return status;
+}
+
+void cargoforge_job_cancel(CfJob *job) {
+    if (!job) return;
+    pthread_mutex_lock(&job->lock);
+    job->cancel = 1;
+    pthread_mutex_unlock(&job->lock);
+}
+
+CargoForge *cargoforge_job_handle(const CfJob *job) {
+    return job ? job->cf : NULL;
+}
+
+void cargoforge_job_release(CfJob *job) {
+    if (!job) return;
+    pthread_mutex_lock(&job->lock);
+    int last = --job->refs == 0;
+    pthread_mutex_unlock(&job->lock);
+    if (!last) return;
+
+    pthread_cond_destroy(&job->done_cond);
+    pthread_mutex_destroy(&job->lock);
+    free(job);
 }
 
 /* ------------------------------------------------------------------ */
 /* RESULTS                                                            */
 /* ------------------------------------------------------------------ */
 
-const CfResult *cargoforge_result(const CargoForge *cf) {
-    if (!cf || !cf->result_valid) return NULL;
-    return &cf->result;
+const CfResult *cargoforge_result(CargoForge *cf) {
+    if (!cf || !cf->analyzed) return NULL;
+    materialize(cf, mask_stages(cf->result_mask));
+    return cf->result_valid ? &cf->result : NULL;
 }
 
 const char *cargoforge_result_json(CargoForge *cf) {
@@ -341,17 +1386,27 @@ const char *cargoforge_result_json(CargoForge *cf) {
     /* Return cached version if available */
     if (cf->json_cache) return cf->json_cache;
 
-    /* Generate JSON into a memory buffer */
-    size_t size = 0;
-    FILE *stream = open_memstream(&cf->json_cache, &size);
-    if (!stream) {
-        set_error(cf, "Failed to create memory stream for JSON");
+    materialize(cf, mask_stages(cf->result_mask));
+
+    JsonWriter *w = &cf->json;
+    w->len = 0;
+    w->pretty = !cf->json_compact;
+    w->omit = ((cf->result_mask & CF_RESULT_SHIP) ? 0u : JSON_OMIT_SHIP) |
+              ((cf->result_mask & CF_RESULT_CARGO) ? 0u : JSON_OMIT_CARGO) |
+              ((cf->result_mask & CF_RESULT_STABILITY) ? 0u : JSON_OMIT_STABILITY) |
+              ((cf->result_mask & CF_RESULT_STRENGTH) ? 0u : JSON_OMIT_STRENGTH);
+    w->cargo_first = cf->json_first;
+    w->cargo_limit = cf->json_count;
+    double t0 = phase_begin(cf);
+    json_write_results(w, &cf->ship, &cf->analysis);
+    phase_end(cf, t0, &cf->stats.serialize_ms);
+    if (w->oom || json_writer_reserve(w, 0) != 0) {
+        json_writer_free(w);
+        set_error(cf, "Out of memory formatting JSON");
         return NULL;
     }
 
-    fprint_json_output(stream, &cf->ship, &cf->analysis);
-    fclose(stream);
-
+    cf->json_cache = w->data;
     return cf->json_cache;
 }
 
@@ -361,13 +1416,13 @@ int cargoforge_cargo_info(const CargoForge *cf, int index, CfCargoInfo *info) {
 
     const Cargo *c = &cf->ship.cargo[index];
 
-    info->id     = c->id;
+    info->id     = CARGO_ID(c);
     info->weight = c->weight;
     info->length = c->dimensions[0];
     info->width  = c->dimensions[1];
     info->height = c->dimensions[2];
-    info->type   = c->type;
-    info->placed = (c->pos_x >= 0) ? 1 : 0;
+    info->type   = CARGO_TYPE(c);
+    info->placed = CARGO_IS_PLACED(c);
     info->pos_x  = c->pos_x;
     info->pos_y  = c->pos_y;
     info->pos_z  = c->pos_z;
@@ -390,6 +1445,141 @@ int cargoforge_cargo_count(const CargoForge *cf) {
     return cf->ship.cargo_count;
 }
 
+/* ------------------------------------------------------------------ */
+/* PLAN VIEW                                                          */
+/* ------------------------------------------------------------------ */
+
+static uint64_t align64(uint64_t n) {
+    return (n + 63u) & ~(uint64_t)63u;
+}
+
+/** Lay out and fill the plan block for the current cargo */
+static int build_plan_block(CargoForge *cf) {
+    const Ship *ship = &cf->ship;
+    uint64_t n = (uint64_t)ship->cargo_count;
+
+    uint64_t id_bytes = 0;
+    for (int i = 0; i < ship->cargo_count; i++)
+        id_bytes += strlen(CARGO_ID(&ship->cargo[i]));
+    if (id_bytes > INT32_MAX) {
+        set_error(cf, "Cargo ids too long for a plan view");
+        return CF_ERROR;
+    }
+
+    CfPlanHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CF_PLAN_MAGIC, CF_PLAN_MAGIC_LEN);
+    h.version    = CF_PLAN_VERSION;
+    h.count      = (uint32_t)n;
+    h.id_offsets = align64(sizeof(h));
+    h.ids        = align64(h.id_offsets + (n + 1) * sizeof(int32_t));
+    h.pos        = align64(h.ids + id_bytes);
+    h.dims       = align64(h.pos + n * 3 * sizeof(float));
+    h.weight     = align64(h.dims + n * 3 * sizeof(float));
+    h.placed     = align64(h.weight + n * sizeof(float));
+    h.size       = align64(h.placed + n);
+
+    if (h.size > cf->plan_capacity) {
+        void *block = NULL;
+        if (h.size > SIZE_MAX || posix_memalign(&block, 64, (size_t)h.size) != 0) {
+            set_error(cf, "Out of memory building plan view");
+            return CF_ERR_NOMEM;
+        }
+        free(cf->plan_block);
+        cf->plan_block = block;
+        cf->plan_capacity = (size_t)h.size;
+    }
+
+    unsigned char *b = cf->plan_block;
+    memset(b, 0, (size_t)h.size);    /* padding too, so exports are reproducible */
+    memcpy(b, &h, sizeof(h));
+
+    int32_t *offsets = (int32_t *)(b + h.id_offsets);
+    char    *ids     = (char *)(b + h.ids);
+    float   *pos     = (float *)(b + h.pos);
+    float   *dims    = (float *)(b + h.dims);
+    float   *weight  = (float *)(b + h.weight);
+    uint8_t *placed  = b + h.placed;
+
+    int32_t at = 0;
+    for (int i = 0; i < ship->cargo_count; i++) {
+        const Cargo *c = &ship->cargo[i];
+        const char *id = CARGO_ID(c);
+        size_t len = strlen(id);
+        offsets[i] = at;
+        memcpy(ids + at, id, len);
+        at += (int32_t)len;
+
+        pos[3 * i]      = c->pos_x;
+        pos[3 * i + 1]  = c->pos_y;
+        pos[3 * i + 2]  = c->pos_z;
+        dims[3 * i]     = c->dimensions[0];
+        dims[3 * i + 1] = c->dimensions[1];
+        dims[3 * i + 2] = c->dimensions[2];
+        weight[i]       = c->weight;
+        placed[i]       = CARGO_IS_PLACED(c) ? 1 : 0;
+    }
+    offsets[n] = at;
+
+    cf->plan_valid = 1;
+    return CF_OK;
+}
+
+int cargoforge_plan_view(CargoForge *cf, CfPlanView *view) {
+    if (!cf || !view) return CF_ERROR;
+    clear_error(cf);
+    if (!cf->cargo_loaded) {
+        set_error(cf, "No cargo manifest loaded");
+        return CF_ERR_NO_CARGO;
+    }
+    if (!cf->plan_valid) {
+        double t0 = phase_begin(cf);
+        int rc = build_plan_block(cf);
+        if (rc != CF_OK) return rc;
+        phase_end(cf, t0, &cf->stats.serialize_ms);
+    }
+
+    const unsigned char *b = cf->plan_block;
+    const CfPlanHeader *h = (const CfPlanHeader *)b;
+    view->count      = (int)h->count;
+    view->id_offsets = (const int32_t *)(b + h->id_offsets);
+    view->ids        = (const char *)(b + h->ids);
+    view->pos        = (const float *)(b + h->pos);
+    view->dims       = (const float *)(b + h->dims);
+    view->weight     = (const float *)(b + h->weight);
+    view->placed     = b + h->placed;
+    view->data       = b;
+    view->size       = (size_t)h->size;
+    return CF_OK;
+}
+
+int cargoforge_plan_export(CargoForge *cf, const char *path) {
+    if (!cf || !path) return CF_ERROR;
+
+    CfPlanView view;
+    int rc = cargoforge_plan_view(cf, &view);
+    if (rc != CF_OK) return rc;
+
+    char tmp[4096];
+    if ((size_t)snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= sizeof(tmp)) {
+        set_error(cf, "Plan export path too long");
+        return CF_ERROR;
+    }
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        set_error(cf, "Cannot create plan export file");
+        return CF_ERR_FILE;
+    }
+    int ok = fwrite(view.data, 1, view.size, fp) == view.size;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp, path) != 0) {
+        remove(tmp);
+        set_error(cf, "Cannot write plan export file");
+        return CF_ERR_FILE;
+    }
+    return CF_OK;
+}
+
 int cargoforge_imdg_violation_count(const CargoForge *cf) {
     if (!cf || !cf->imdg_checked) return -1;
     return cf->imdg.violation_count;
@@ -435,6 +1625,8 @@ const char *cargoforge_errstr(int code) {
         case CF_ERR_NO_CARGO:  return "No cargo manifest loaded";
         case CF_ERR_OVERWEIGHT: return "Total weight exceeds ship capacity";
         case CF_ERR_STATE:     return "Invalid operation for current state";
+        case CF_ERR_CANCELLED: return "Job cancelled";
+        case CF_ERR_TIMEOUT:   return "Job deadline passed";
         default:               return "Unknown error";
     }
 }
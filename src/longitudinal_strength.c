@@ -1,14 +1,15 @@
 /*
  * longitudinal_strength.c - SWSF and SWBM calculations
  *
- * Implements still water shear force and bending moment analysis
- * using standard 20-interval hull station division.
+ * Implements still water shear force and bending moment analysis on a
+ * station grid, by default the standard 20-interval hull division.
  */
 
 #include "longitudinal_strength.h"
 #include <math.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 /**
  * Distribute lightship weight as a trapezoidal curve along the hull.
@@ -27,216 +28,331 @@ static void distribute_lightship(float *dist, const float *stations,
      *   20-80% length: constant at 1.15*avg
      *   80-100% length: linearly ramp from 1.0*avg to 0.5*avg
      *
-     * These factors are chosen so the integral equals lightship_t.
+     * The raw shape is then scaled so its integral equals lightship_t.
      */
     float avg_wt = lightship_t / length; /* average weight per metre */
 
-    /* First pass: compute raw distribution */
-    float raw_total = 0.0f;
-    float raw[LS_NUM_STATIONS];
-
     for (int i = 0; i < count; i++) {
         float frac = stations[i] / length; /* 0 at AP, 1 at FP */
 
         if (frac < 0.2f) {
             /* Ramp up from stern */
             float t = frac / 0.2f;
-            raw[i] = avg_wt * (0.6f + 0.4f * t);
+            dist[i] = avg_wt * (0.6f + 0.4f * t);
         } else if (frac < 0.8f) {
             /* Midship region */
-            raw[i] = avg_wt * 1.15f;
+            dist[i] = avg_wt * 1.15f;
         } else {
             /* Ramp down to bow */
             float t = (frac - 0.8f) / 0.2f;
-            raw[i] = avg_wt * (1.0f - 0.5f * t);
+            dist[i] = avg_wt * (1.0f - 0.5f * t);
         }
-        raw_total += raw[i];
     }
 
-    /* Normalize so total matches lightship weight */
-    float scale = (raw_total > 1e-6f) ? (lightship_t / length) / (raw_total / count) : 0.0f;
-    /* More precise: use trapezoidal integration */
+    /* Trapezoidal integration of the raw shape */
     float integrated = 0.0f;
     for (int i = 0; i < count - 1; i++) {
         float dx = stations[i + 1] - stations[i];
-        integrated += (raw[i] + raw[i + 1]) * 0.5f * dx;
+        integrated += (dist[i] + dist[i + 1]) * 0.5f * dx;
     }
-    scale = (integrated > 1e-6f) ? lightship_t / integrated : 0.0f;
+    float scale = (integrated > 1e-6f) ? lightship_t / integrated : 0.0f;
 
     for (int i = 0; i < count; i++) {
-        dist[i] = raw[i] * scale;
+        dist[i] *= scale;
     }
 }
 
 /**
- * Add cargo weight to the station-based distribution.
+ * CargoSpan - Where one item's weight lands on the station grid: head
+ * goes to station first, tail to station last (when last > first), and
+ * every station in between carries wt_per_m.
+ */
+typedef struct {
+    int   first, last;
+    float head, tail;
+    float wt_per_m;
+} CargoSpan;
+
+/**
+ * Station s stands for the interval [pos - dx/2, pos + dx/2], cut to the
+ * hull at AP and FP, and receives the cargo weight in that interval per
+ * metre of spacing.
  *
- * Each cargo item's weight is distributed across the stations it spans.
- * For items smaller than one station interval, weight is split between
- * the two nearest stations.
+ * @return 1 if the item adds weight, 0 if it is unplaced, too short or
+ *         beyond the end stations
  */
-static void distribute_cargo(float *dist, const float *stations, int count,
-                             const Ship *ship) {
-    float dx = stations[1] - stations[0]; /* station spacing */
+static int cargo_span(const float *stations, int count, const Cargo *c, CargoSpan *span) {
+    if (!CARGO_IS_PLACED(c)) return 0;
 
-    for (int i = 0; i < ship->cargo_count; i++) {
-        const Cargo *c = &ship->cargo[i];
-        if (c->pos_x < 0) continue; /* not placed */
+    float dx = stations[1] - stations[0]; /* station spacing */
+    float aft = 0.0f, fwd = stations[count - 1];
+    float cargo_t = c->weight / 1000.0f;
+    float x_start = c->pos_x;
+    float x_end = c->pos_x + c->dimensions[0];
+    float cargo_length = x_end - x_start;
+
+    if (cargo_length < 0.01f) return 0;
+
+    float wt_per_m = cargo_t / cargo_length;
+
+    /* Weight beyond the end stations is not counted */
+    float lo = fmaxf(x_start, aft), hi = fminf(x_end, fwd);
+    if (hi <= lo) return 0;
+
+    int first = (int)floorf(lo / dx + 0.5f);
+    int last = (int)floorf(hi / dx + 0.5f);
+    if (first > count - 1) first = count - 1;
+    if (last > count - 1) last = count - 1;
+
+    span->first = first;
+    span->last = last;
+    span->wt_per_m = wt_per_m;
+    if (first == last) {
+        span->head = wt_per_m * (hi - lo) / dx;
+        span->tail = 0.0f;
+        return 1;
+    }
 
-        float cargo_t = c->weight / 1000.0f;
-        float x_start = c->pos_x;
-        float x_end = c->pos_x + c->dimensions[0];
-        float cargo_length = x_end - x_start;
+    float first_hi = stations[first] + dx / 2.0f;
+    float last_lo = stations[last] - dx / 2.0f;
+    span->head = wt_per_m * fmaxf(first_hi - lo, 0.0f) / dx;
+    span->tail = wt_per_m * fmaxf(hi - last_lo, 0.0f) / dx;
+    return 1;
+}
 
-        if (cargo_length < 0.01f) continue;
+/**
+ * Add cargo weight to the station-based distribution.
+ *
+ * An item covers a run of stations: the two end stations get their
+ * partial overlap directly, and the full stations in between are marked
+ * in a difference array (run holds count + 1 values) that one prefix sum
+ * turns into per-station weight.
+ */
+static void distribute_cargo(float *dist, const float *stations, int count,
+                             const Ship *ship, double *run) {
+    memset(run, 0, (size_t)(count + 1) * sizeof(*run));
 
-        float wt_per_m = cargo_t / cargo_length;
+    for (int i = 0; i < ship->cargo_count; i++) {
+        CargoSpan sp;
+        if (!cargo_span(stations, count, &ship->cargo[i], &sp)) continue;
 
-        /* Distribute across overlapping stations */
-        for (int s = 0; s < count; s++) {
-            float s_lo = stations[s] - dx / 2.0f;
-            float s_hi = stations[s] + dx / 2.0f;
-            if (s == 0) s_lo = 0.0f;
-            if (s == count - 1) s_hi = stations[count - 1];
+        dist[sp.first] += sp.head;
+        if (sp.first == sp.last) continue;
+        dist[sp.last] += sp.tail;
 
-            float overlap_lo = fmaxf(s_lo, x_start);
-            float overlap_hi = fminf(s_hi, x_end);
+        /* Stations first + 1 .. last - 1 each carry a full spacing */
+        run[sp.first + 1] += sp.wt_per_m;
+        run[sp.last] -= sp.wt_per_m;
+    }
 
-            if (overlap_hi > overlap_lo) {
-                float overlap_len = overlap_hi - overlap_lo;
-                dist[s] += wt_per_m * overlap_len / dx;
-            }
-        }
+    double acc = 0.0;
+    for (int s = 0; s < count; s++) {
+        acc += run[s];
+        dist[s] += (float)acc;
     }
 }
 
-/**
- * Distribute buoyancy uniformly along the waterplane.
- *
- * For a box-hull approximation, buoyancy per unit length is:
- *   b(x) = rho * B * T * Cb (constant)
- *
- * The total buoyancy equals displacement.
- */
-static void distribute_buoyancy(float *dist, const float *stations, int count,
-                                float displacement_t, float length) {
-    float buoy_per_m = displacement_t / length;
+/** Buoyancy end taper: bow and stern carry less than the parallel body */
+static float buoyancy_taper(float frac) {
+    if (frac < 0.05f) return 0.5f + (frac / 0.05f) * 0.5f;
+    if (frac > 0.95f) return 0.5f + ((1.0f - frac) / 0.05f) * 0.5f;
+    return 1.0f;
+}
+
+/** Station grid and weight curve into caller storage (count floats each);
+ * run == NULL leaves the cargo out */
+static void model_build(StrengthModel *m, const Ship *ship, int count,
+                        float *pos, float *weight, double *run) {
+    m->station_count = count;
+    m->length = ship->length;
+    m->spacing = ship->length / (float)(count - 1);
+    m->station_pos = pos;
+    m->weight_dist = weight;
 
     for (int i = 0; i < count; i++) {
-        dist[i] = buoy_per_m;
+        pos[i] = i * m->spacing;
     }
 
-    /* Refine: taper at ends (bow/stern have less buoyancy) */
-    for (int i = 0; i < count; i++) {
-        float frac = stations[i] / length;
-        float taper = 1.0f;
+    float lightship_t = ship->lightship_weight / 1000.0f;
+    distribute_lightship(weight, pos, count, lightship_t, ship->length);
+    if (run) distribute_cargo(weight, pos, count, ship, run);
+}
 
-        if (frac < 0.05f) {
-            taper = 0.5f + (frac / 0.05f) * 0.5f;
-        } else if (frac > 0.95f) {
-            taper = 0.5f + ((1.0f - frac) / 0.05f) * 0.5f;
-        }
-        dist[i] *= taper;
-    }
+static int model_init(StrengthModel *model, const Ship *ship, int stations, int with_cargo) {
+    if (!model || !ship) return -1;
+    memset(model, 0, sizeof(*model));
 
-    /* Normalize to match total displacement */
-    float integrated = 0.0f;
-    for (int i = 0; i < count - 1; i++) {
-        float dx = stations[i + 1] - stations[i];
-        integrated += (dist[i] + dist[i + 1]) * 0.5f * dx;
-    }
-    if (integrated > 1e-6f) {
-        float scale = displacement_t / integrated;
-        for (int i = 0; i < count; i++) {
-            dist[i] *= scale;
-        }
+    if (stations == 0) stations = LS_NUM_STATIONS;
+    if (stations < 3 || stations > LS_MAX_STATIONS || ship->length <= 0.0f) return -1;
+
+    float *store = malloc((size_t)stations * 2 * sizeof(*store));
+    double *run = with_cargo ? malloc((size_t)(stations + 1) * sizeof(*run)) : NULL;
+    if (!store || (with_cargo && !run)) {
+        free(store);
+        free(run);
+        return -1;
     }
+
+    model_build(model, ship, stations, store, store + stations, run);
+    free(run);
+    return 0;
 }
 
-LongStrengthResult calculate_longitudinal_strength(
-    const Ship *ship, float draft, float displacement_t,
-    float ship_length, float ship_width) {
+int strength_model_init(StrengthModel *model, const Ship *ship, int stations) {
+    return model_init(model, ship, stations, 1);
+}
 
-    LongStrengthResult r;
-    memset(&r, 0, sizeof(r));
-    r.station_count = LS_NUM_STATIONS;
+int strength_model_init_lightship(StrengthModel *model, const Ship *ship, int stations) {
+    return model_init(model, ship, stations, 0);
+}
 
-    (void)draft;
-    (void)ship_width;
+void strength_model_add_cargo(const StrengthModel *model, const Cargo *cargo, double sign,
+                              double *dist) {
+    CargoSpan sp;
+    if (!cargo_span(model->station_pos, model->station_count, cargo, &sp)) return;
 
-    /* Set up station positions (evenly spaced, AP to FP) */
-    float dx = ship_length / (float)(LS_NUM_STATIONS - 1);
-    for (int i = 0; i < LS_NUM_STATIONS; i++) {
-        r.station_pos[i] = i * dx;
-    }
+    dist[sp.first] += sign * sp.head;
+    if (sp.first == sp.last) return;
+    dist[sp.last] += sign * sp.tail;
+    for (int s = sp.first + 1; s < sp.last; s++)
+        dist[s] += sign * sp.wt_per_m;
+}
 
-    /* Build weight distribution */
-    float lightship_t = ship->lightship_weight / 1000.0f;
-    distribute_lightship(r.weight_dist, r.station_pos, LS_NUM_STATIONS,
-                         lightship_t, ship_length);
-    distribute_cargo(r.weight_dist, r.station_pos, LS_NUM_STATIONS, ship);
+void strength_model_add_weight(const StrengthModel *model, float weight_t, float x,
+                               double *dist) {
+    float fwd = model->station_pos[model->station_count - 1];
+    if (x < 0.0f || x > fwd) return;
 
-    /* Build buoyancy distribution */
-    distribute_buoyancy(r.buoyancy_dist, r.station_pos, LS_NUM_STATIONS,
-                        displacement_t, ship_length);
+    int s = (int)floorf(x / model->spacing + 0.5f);
+    if (s > model->station_count - 1) s = model->station_count - 1;
+    dist[s] += weight_t / model->spacing;
+}
 
-    /* Net load = weight - buoyancy (positive = excess weight) */
-    for (int i = 0; i < LS_NUM_STATIONS; i++) {
-        r.net_load[i] = r.weight_dist[i] - r.buoyancy_dist[i];
-    }
+void strength_model_free(StrengthModel *model) {
+    if (!model) return;
+    free(model->station_pos);             /* one block with weight_dist */
+    model->station_pos = NULL;
+    model->weight_dist = NULL;
+    model->station_count = 0;
+}
 
-    /* Integrate net load to get shear force (trapezoidal rule) */
-    r.shear_force[0] = 0.0f;
-    for (int i = 1; i < LS_NUM_STATIONS; i++) {
-        r.shear_force[i] = r.shear_force[i - 1] +
-            (r.net_load[i - 1] + r.net_load[i]) * 0.5f * dx;
-    }
+void strength_model_solve(const StrengthModel *m, float displacement_t,
+                          StrengthSummary *out, const StrengthProfile *profile) {
+    const float *pos = m->station_pos;
+    int n = m->station_count;
+    float dx = m->spacing;
 
-    /* Integrate shear force to get bending moment */
-    r.bending_moment[0] = 0.0f;
-    for (int i = 1; i < LS_NUM_STATIONS; i++) {
-        r.bending_moment[i] = r.bending_moment[i - 1] +
-            (r.shear_force[i - 1] + r.shear_force[i]) * 0.5f * dx;
+    /*
+     * Buoyancy: uniform along the waterplane (box-hull approximation),
+     * tapered at the ends, then normalised so it integrates to the
+     * displacement.
+     */
+    float buoy_per_m = displacement_t / m->length;
+    float integrated = 0.0f;
+    float prev = buoy_per_m * buoyancy_taper(pos[0] / m->length);
+    for (int i = 0; i < n - 1; i++) {
+        float next = buoy_per_m * buoyancy_taper(pos[i + 1] / m->length);
+        integrated += (prev + next) * 0.5f * (pos[i + 1] - pos[i]);
+        prev = next;
     }
+    float scale = (integrated > 1e-6f) ? displacement_t / integrated : 1.0f;
+
+    memset(out, 0, sizeof(*out));
+
+    /* Net load = weight - buoyancy (positive = excess weight), integrated
+     * once for shear force and again for bending moment (trapezoidal) */
+    float net_prev = 0.0f, sf = 0.0f, bm = 0.0f;
+    for (int i = 0; i < n; i++) {
+        float buoy = buoy_per_m * buoyancy_taper(pos[i] / m->length);
+        if (integrated > 1e-6f) buoy *= scale;
+        float net = m->weight_dist[i] - buoy;
+
+        if (i > 0) {
+            float sf_next = sf + (net_prev + net) * 0.5f * dx;
+            bm += (sf + sf_next) * 0.5f * dx;
+            sf = sf_next;
+        }
+        net_prev = net;
 
-    /* Find maxima */
-    r.max_shear_force = 0.0f;
-    r.max_bm_hog = 0.0f;
-    r.max_bm_sag = 0.0f;
+        if (profile) {
+            if (profile->buoyancy_dist) profile->buoyancy_dist[i] = buoy;
+            if (profile->net_load) profile->net_load[i] = net;
+            if (profile->shear_force) profile->shear_force[i] = sf;
+            if (profile->bending_moment) profile->bending_moment[i] = bm;
+        }
 
-    for (int i = 0; i < LS_NUM_STATIONS; i++) {
-        float abs_sf = fabsf(r.shear_force[i]);
-        if (abs_sf > r.max_shear_force) {
-            r.max_shear_force = abs_sf;
-            r.max_sf_position = r.station_pos[i];
+        /* Maxima */
+        float abs_sf = fabsf(sf);
+        if (abs_sf > out->max_shear_force) {
+            out->max_shear_force = abs_sf;
+            out->max_sf_position = pos[i];
         }
 
         /* Hogging = positive BM (deck in tension), Sagging = negative BM */
-        if (r.bending_moment[i] > r.max_bm_hog) {
-            r.max_bm_hog = r.bending_moment[i];
-            r.max_bm_position = r.station_pos[i];
+        if (bm > out->max_bm_hog) {
+            out->max_bm_hog = bm;
+            out->max_bm_position = pos[i];
         }
-        if (r.bending_moment[i] < 0 && fabsf(r.bending_moment[i]) > r.max_bm_sag) {
-            r.max_bm_sag = fabsf(r.bending_moment[i]);
-            if (fabsf(r.bending_moment[i]) > r.max_bm_hog) {
-                r.max_bm_position = r.station_pos[i];
+        if (bm < 0 && fabsf(bm) > out->max_bm_sag) {
+            out->max_bm_sag = fabsf(bm);
+            if (fabsf(bm) > out->max_bm_hog) {
+                out->max_bm_position = pos[i];
             }
         }
     }
+}
+
+LongStrengthResult calculate_longitudinal_strength(
+    const Ship *ship, float draft, float displacement_t,
+    float ship_length, float ship_width) {
+
+    LongStrengthResult r;
+    memset(&r, 0, sizeof(r));
+    r.station_count = LS_NUM_STATIONS;
 
+    (void)draft;
+    (void)ship_width;
+
+    /* The fixed 21-station grid lives in the result itself */
+    Ship hull = *ship;
+    hull.length = ship_length;
+    StrengthModel m;
+    double run[LS_NUM_STATIONS + 1];
+    model_build(&m, &hull, LS_NUM_STATIONS, r.station_pos, r.weight_dist, run);
+
+    StrengthProfile profile = { r.buoyancy_dist, r.net_load, r.shear_force, r.bending_moment };
+    StrengthSummary sum;
+    strength_model_solve(&m, displacement_t, &sum, &profile);
+
+    r.max_shear_force = sum.max_shear_force;
+    r.max_sf_position = sum.max_sf_position;
+    r.max_bm_hog = sum.max_bm_hog;
+    r.max_bm_sag = sum.max_bm_sag;
+    r.max_bm_position = sum.max_bm_position;
     return r;
 }
 
-int check_strength_limits(const LongStrengthResult *result,
-                          const StrengthLimits *limits) {
-    if (!result || !limits) return -1;
+int check_strength_summary(const StrengthSummary *summary,
+                           const StrengthLimits *limits) {
+    if (!summary || !limits) return -1;
 
-    if (result->max_shear_force > limits->permissible_sf)
+    if (summary->max_shear_force > limits->permissible_sf)
         return 0;
-    if (result->max_bm_hog > limits->permissible_bm_hog)
+    if (summary->max_bm_hog > limits->permissible_bm_hog)
         return 0;
-    if (result->max_bm_sag > limits->permissible_bm_sag)
+    if (summary->max_bm_sag > limits->permissible_bm_sag)
         return 0;
 
     return 1;
 }
+
+int check_strength_limits(const LongStrengthResult *result,
+                          const StrengthLimits *limits) {
+    if (!result) return -1;
+
+    StrengthSummary sum = {
+        result->max_shear_force, result->max_sf_position,
+        result->max_bm_hog, result->max_bm_sag, result->max_bm_position
+    };
+    return check_strength_summary(&sum, limits);
+}
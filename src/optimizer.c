@@ -0,0 +1,403 @@
+/*
+ * optimizer.c - Multi-start / beam-search loading optimizer
+ *
+ * Every attempt packs a private copy of the manifest with the serial
+ * guillotine placer and scores it with perform_analysis(); attempts never
+ * share mutable state, so a round is a plain parallel_for. Perturbation
+ * seeds depend only on (seed, round, attempt), and the ranking is a total
+ * order, so without a time budget the chosen plan does not depend on the
+ * thread count or on which attempt finishes first.
+ */
+
+#include "optimizer.h"
+#include "placement_3d.h"
+#include "constraints.h"
+#include "thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+/**
+ * Plan - One packed ordering of the manifest and its score.
+ */
+typedef struct {
+    Cargo *cargo;            /* ordering + placed positions (cargo_count items) */
+    int    key;              /* SortKey that produced the ordering */
+    int    round;
+    int    seq;              /* global attempt number, final tie-break */
+    int    valid;            /* 0 if the attempt was skipped (budget) */
+
+    int    feasible;         /* 0 if overweight (stability not computed) */
+    int    placed;
+    int    imo_compliant;
+    float  abs_trim;
+    float  gm_corrected;
+} Plan;
+
+typedef struct {
+    const Ship  *ship;       /* template: dimensions, tables, tanks */
+    const Cargo *origin;     /* manifest in its original order */
+    Plan        *slots;
+    const Plan  *beam;
+    int          beam_count;
+    int          round;
+    int          seq_base;
+    unsigned int seed;
+    int          engine;     /* PlacementEngine */
+    double       deadline_ms;/* monotonic, 0 = none */
+    int        (*should_stop)(void *ctx);
+    void        *stop_ctx;
+} RoundJob;
+
+const char *sort_key_name(int key) {
+    switch (key) {
+        case SORT_VOLUME:    return "volume";
+        case SORT_WEIGHT:    return "weight";
+        case SORT_FOOTPRINT: return "footprint";
+        case SORT_HEIGHT:    return "height";
+        case SORT_DG_FIRST:  return "dg-first";
+        case SORT_PERTURBED: return "perturbed";
+        default:             return "unknown";
+    }
+}
+
+void optimizer_options_init(OptimizerOptions *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->threads = 0;
+    opts->random_starts = 8;
+    opts->beam_width = 4;
+    opts->max_rounds = 4;
+    opts->time_budget_ms = 0;
+    opts->seed = 1;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+/* ------------------------------------------------------------------ */
+/* ORDERINGS                                                          */
+/* ------------------------------------------------------------------ */
+
+static float cargo_volume(const Cargo *c) {
+    return c->dimensions[0] * c->dimensions[1] * c->dimensions[2];
+}
+
+/* Shared tail of every comparator: volume desc, then ID, so no sort key
+ * leaves the order to qsort's unspecified handling of equal elements. */
+static int cmp_volume_then_id(const Cargo *a, const Cargo *b) {
+    float va = cargo_volume(a), vb = cargo_volume(b);
+    if (va < vb) return 1;
+    if (va > vb) return -1;
+    return strcmp(CARGO_ID(a), CARGO_ID(b));
+}
+
+static int cmp_volume(const void *pa, const void *pb) {
+    return cmp_volume_then_id(pa, pb);
+}
+
+static int cmp_weight(const void *pa, const void *pb) {
+    const Cargo *a = pa, *b = pb;
+    if (a->weight < b->weight) return 1;
+    if (a->weight > b->weight) return -1;
+    return cmp_volume_then_id(a, b);
+}
+
+static int cmp_footprint(const void *pa, const void *pb) {
+    const Cargo *a = pa, *b = pb;
+    float fa = a->dimensions[0] * a->dimensions[1];
+    float fb = b->dimensions[0] * b->dimensions[1];
+    if (fa < fb) return 1;
+    if (fa > fb) return -1;
+    return cmp_volume_then_id(a, b);
+}
+
+static int cmp_height(const void *pa, const void *pb) {
+    const Cargo *a = pa, *b = pb;
+    if (a->dimensions[2] < b->dimensions[2]) return 1;
+    if (a->dimensions[2] > b->dimensions[2]) return -1;
+    return cmp_volume_then_id(a, b);
+}
+
+static int cmp_dg_first(const void *pa, const void *pb) {
+    const Cargo *a = pa, *b = pb;
+    int da = (a->dg != NULL) || is_hazardous(a);
+    int db = (b->dg != NULL) || is_hazardous(b);
+    if (da != db) return db - da;
+    return cmp_volume_then_id(a, b);
+}
+
+static unsigned int xorshift32(unsigned int *state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/* Swap a tenth of the items with a near neighbour (keeps the order roughly
+ * size-descending, which is what makes FFD work in the first place). */
+static void perturb_order(Cargo *cargo, int n, unsigned int seed) {
+    if (n < 2) return;
+    unsigned int rng = seed ? seed : 0x9e3779b9u;
+    int swaps = n / 10 > 0 ? n / 10 : 1;
+
+    for (int s = 0; s < swaps; s++) {
+        int j = (int)(xorshift32(&rng) % (unsigned int)n);
+        int k = j + 1 + (int)(xorshift32(&rng) % 8u);
+        if (k >= n) k = n - 1;
+        if (k == j) continue;
+        Cargo tmp = cargo[j];
+        cargo[j] = cargo[k];
+        cargo[k] = tmp;
+    }
+}
+
+static unsigned int attempt_seed(unsigned int seed, int round, int index) {
+    unsigned int h = seed * 2654435761u;
+    h ^= (unsigned int)round * 40503u + 0x7f4a7c15u;
+    h ^= (unsigned int)index * 2246822519u;
+    h ^= h >> 15;
+    return h ? h : 1u;
+}
+
+/* ------------------------------------------------------------------ */
+/* ATTEMPTS                                                           */
+/* ------------------------------------------------------------------ */
+
+/* a strictly better than b; an overweight plan ranks below every
+ * feasible one, since its trim and GM are left at 0 */
+static int plan_better(const Plan *a, const Plan *b) {
+    if (a->feasible != b->feasible) return a->feasible > b->feasible;
+    if (a->placed != b->placed) return a->placed > b->placed;
+    if (a->imo_compliant != b->imo_compliant) return a->imo_compliant > b->imo_compliant;
+    if (a->abs_trim != b->abs_trim) return a->abs_trim < b->abs_trim;
+    if (a->gm_corrected != b->gm_corrected) return a->gm_corrected > b->gm_corrected;
+    return a->seq < b->seq;
+}
+
+static void run_attempt(void *ctx, int index) {
+    RoundJob *job = ctx;
+    Plan *p = &job->slots[index];
+    int n = job->ship->cargo_count;
+    int baseline = (job->round == 0 && index == 0);
+
+    p->valid = 0;
+    p->round = job->round;
+    p->seq = job->seq_base + index;
+
+    // The baseline FFD attempt always runs so there is a plan to return
+    if (!baseline && job->deadline_ms > 0.0 && now_ms() >= job->deadline_ms)
+        return;
+    if (!baseline && job->should_stop && job->should_stop(job->stop_ctx))
+        return;
+
+    int presorted = 1;
+    if (job->round == 0 && index < SORT_KEY_COUNT) {
+        static int (*const cmps[SORT_KEY_COUNT])(const void *, const void *) = {
+            NULL, cmp_weight, cmp_footprint, cmp_height, cmp_dg_first
+        };
+        memcpy(p->cargo, job->origin, (size_t)n * sizeof(Cargo));
+        p->key = index;
+        if (index == SORT_VOLUME)
+            presorted = 0;   // exactly what place_cargo_3d() would do
+        else
+            qsort(p->cargo, (size_t)n, sizeof(Cargo), cmps[index]);
+    } else {
+        if (job->round == 0) {
+            memcpy(p->cargo, job->origin, (size_t)n * sizeof(Cargo));
+            qsort(p->cargo, (size_t)n, sizeof(Cargo), cmp_volume);
+        } else {
+            const Plan *parent = &job->beam[index % job->beam_count];
+            memcpy(p->cargo, parent->cargo, (size_t)n * sizeof(Cargo));
+        }
+        p->key = SORT_PERTURBED;
+        perturb_order(p->cargo, n, attempt_seed(job->seed, job->round, index));
+    }
+
+    // Positions from a parent plan must not look like placed cargo
+    for (int i = 0; i < n; i++)
+        CARGO_UNPLACE(&p->cargo[i]);
+
+    Ship trial = *job->ship;
+    trial.cargo = p->cargo;
+    trial.cargo_capacity = n;
+    trial.placed_index = NULL;
+    trial.stack_grid = NULL;
+    trial.quiet = 1;
+
+    PlacementOptions popts;
+    placement_options_init(&popts);
+    popts.presorted = presorted;
+    popts.engine = job->engine;
+    popts.should_stop = job->should_stop;
+    popts.stop_ctx = job->stop_ctx;
+    place_cargo_3d_opts(&trial, &popts);
+
+    // The score reads stability only; strength would be solved for nothing
+    CargoMoments m;
+    cargo_moments_compute(&trial, &m);
+    AnalysisResult a = perform_analysis_stages(&trial, &m, ANALYSIS_STABILITY);
+    p->feasible = !isnan(a.gm);
+    p->placed = a.placed_item_count;
+    p->imo_compliant = a.imo_compliant;
+    p->abs_trim = fabsf(a.trim);
+    p->gm_corrected = a.gm_corrected;
+    p->valid = 1;
+}
+
+/* ------------------------------------------------------------------ */
+/* SEARCH                                                             */
+/* ------------------------------------------------------------------ */
+
+static Cargo *alloc_cargo_block(int plans, int n) {
+    return malloc((size_t)plans * (size_t)(n > 0 ? n : 1) * sizeof(Cargo));
+}
+
+/* Keep the k best of the current beam and this round's attempts */
+static int merge_beam(const Plan *beam, int beam_count, const Plan *slots, int slot_count,
+                      Plan *next, int k, int n) {
+    int total = beam_count + slot_count;
+    const Plan **cand = malloc((size_t)(total > 0 ? total : 1) * sizeof(Plan *));
+    if (!cand) return -1;
+
+    int m = 0;
+    for (int i = 0; i < beam_count; i++) cand[m++] = &beam[i];
+    for (int i = 0; i < slot_count; i++)
+        if (slots[i].valid) cand[m++] = &slots[i];
+
+    int kept = 0;
+    for (; kept < k && kept < m; kept++) {
+        int best = kept;
+        for (int i = kept + 1; i < m; i++)
+            if (plan_better(cand[i], cand[best])) best = i;
+        const Plan *tmp = cand[kept];
+        cand[kept] = cand[best];
+        cand[best] = tmp;
+
+        Cargo *buf = next[kept].cargo;
+        next[kept] = *cand[kept];
+        next[kept].cargo = buf;
+        memcpy(buf, cand[kept]->cargo, (size_t)n * sizeof(Cargo));
+    }
+
+    free(cand);
+    return kept;
+}
+
+int optimize_multi_start(Ship *ship, const OptimizerOptions *opts, OptimizerStats *stats) {
+    OptimizerOptions defaults;
+    if (!opts) {
+        optimizer_options_init(&defaults);
+        opts = &defaults;
+    }
+
+    OptimizerStats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+
+    double start = now_ms();
+    int n = ship->cargo_count;
+    int random_starts = opts->random_starts > 0 ? opts->random_starts : 0;
+    int k = opts->beam_width > 0 ? opts->beam_width : 1;
+    int max_rounds = opts->max_rounds > 0 ? opts->max_rounds : 1;
+    int slot_count = SORT_KEY_COUNT + random_starts;
+
+    Plan *slots = calloc((size_t)slot_count, sizeof(Plan));
+    Plan *beam = calloc((size_t)k, sizeof(Plan));
+    Plan *next = calloc((size_t)k, sizeof(Plan));
+    Cargo *origin = alloc_cargo_block(1, n);
+    Cargo *slot_buf = alloc_cargo_block(slot_count, n);
+    Cargo *beam_buf = alloc_cargo_block(2 * k, n);
+
+    if (!slots || !beam || !next || !origin || !slot_buf || !beam_buf) {
+        free(slots); free(beam); free(next);
+        free(origin); free(slot_buf); free(beam_buf);
+        return -1;
+    }
+
+    memcpy(origin, ship->cargo, (size_t)n * sizeof(Cargo));
+    for (int i = 0; i < slot_count; i++) slots[i].cargo = slot_buf + (size_t)i * (size_t)n;
+    for (int i = 0; i < k; i++) {
+        beam[i].cargo = beam_buf + (size_t)i * (size_t)n;
+        next[i].cargo = beam_buf + (size_t)(k + i) * (size_t)n;
+    }
+
+    ThreadPool *pool = opts->pool;
+    ThreadPool *owned_pool = NULL;
+    if (!pool && opts->threads != 1) {
+        owned_pool = thread_pool_create(opts->threads);
+        pool = owned_pool;
+    }
+
+    RoundJob job;
+    job.ship = ship;
+    job.origin = origin;
+    job.slots = slots;
+    job.beam = beam;
+    job.beam_count = 0;
+    job.seq_base = 0;
+    job.seed = opts->seed;
+    job.engine = opts->engine;
+    job.deadline_ms = opts->time_budget_ms > 0 ? start + opts->time_budget_ms : 0.0;
+    job.should_stop = opts->should_stop;
+    job.stop_ctx = opts->stop_ctx;
+
+    int rc = 0;
+    for (int round = 0; round < max_rounds; round++) {
+        int count = (round == 0) ? slot_count : random_starts;
+        if (count == 0) break;
+        if (round > 0 && job.deadline_ms > 0.0 && now_ms() >= job.deadline_ms) {
+            stats->budget_exhausted = 1;
+            break;
+        }
+
+        job.round = round;
+        thread_pool_parallel_for(pool, count, run_attempt, &job);
+        stats->rounds++;
+
+        // Attempts skipped or cut short by a stop request are not the budget's doing
+        if (job.should_stop && job.should_stop(job.stop_ctx))
+            stats->stopped = 1;
+        for (int i = 0; i < count; i++) {
+            if (slots[i].valid) stats->attempts++;
+            else if (!stats->stopped) stats->budget_exhausted = 1;
+        }
+
+        int kept = merge_beam(beam, job.beam_count, slots, count, next, k, n);
+        if (kept < 0) { rc = -1; break; }
+
+        Plan *swap = beam;
+        beam = next;
+        next = swap;
+        job.beam = beam;
+        job.beam_count = kept;
+        job.seq_base += count;
+        if (stats->stopped) break;
+    }
+
+    thread_pool_destroy(owned_pool);
+
+    if (rc == 0 && job.beam_count > 0) {
+        // beam[0] is the best plan seen; it is a permutation of the
+        // manifest, so every DGInfo pointer is still owned exactly once
+        memcpy(ship->cargo, beam[0].cargo, (size_t)n * sizeof(Cargo));
+        stats->best_strategy = beam[0].key;
+        stats->best_round = beam[0].round;
+        stats->best_placed = beam[0].placed;
+    } else {
+        for (int i = 0; i < n; i++)
+            CARGO_UNPLACE(&ship->cargo[i]);
+        rc = -1;
+    }
+
+    stats->elapsed_ms = now_ms() - start;
+
+    free(slots); free(beam); free(next);
+    free(origin); free(slot_buf); free(beam_buf);
+    return rc;
+}
@@ -6,17 +6,34 @@
  * - Cargo manifest (whitespace-delimited with optional DG: field)
  * - Hydrostatic tables (via hydrostatics.h)
  * - Tank configuration (via tanks.h)
+ * - Cargo compartments (hold= lines, via holds.h)
+ *
+ * Both formats are parsed straight out of an in-memory buffer with a small
+ * span tokenizer (no line copies, no NUL-termination required); the file
+ * and stdin entry points read their input into memory and hand it over.
  */
 #include <errno.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "cargoforge.h"
 #include "hydrostatics.h"
 #include "tanks.h"
 #include "longitudinal_strength.h"
 #include "imdg.h"
+#include "holds.h"
+#include "arena.h"
+#include "constraints.h"
+
+#if !defined(CARGOFORGE_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_MMAP 1
+#endif
 
 /**
  * @brief Safely parses a string into a positive float within a given range.
@@ -38,77 +55,322 @@
     return val;
 }
 
-// Parses ship configuration using the safe parser.
-int parse_ship_config(const char *filename, Ship *ship) {
-    FILE *file;
-    bool use_stdin = (strcmp(filename, "-") == 0);
+/* ------------------------------------------------------------------ */
+/* SPAN TOKENIZER                                                     */
+/* ------------------------------------------------------------------ */
 
-    if (use_stdin) {
-        file = stdin;
-    } else {
-        file = fopen(filename, "r");
-        if (!file) {
-            perror("Error opening ship config file");
-            return -1;
+/**
+ * TextSpan - A non-owning slice of the input buffer.
+ */
+typedef struct {
+    const char *p;
+    size_t n;
+} TextSpan;
+
+/**
+ * Take the next line from [*cur, end), without its "\n" or "\r\n".
+ * Returns false at end of input.
+ */
+static bool next_line(const char **cur, const char *end, TextSpan *line) {
+    if (*cur >= end) return false;
+
+    const char *start = *cur;
+    const char *nl = memchr(start, '\n', (size_t)(end - start));
+    const char *stop = nl ? nl : end;
+    *cur = nl ? nl + 1 : end;
+
+    if (stop > start && stop[-1] == '\r') stop--;
+    line->p = start;
+    line->n = (size_t)(stop - start);
+    return true;
+}
+
+/** Lines that hold no data: blank, or a '#' comment */
+static bool skip_line(const TextSpan *line) {
+    return line->n == 0 || line->p[0] == '#';
+}
+
+/* Delimiter sets are one or two literal characters; an inlined loop beats
+ * a strchr() call per input byte */
+static inline bool is_delim(char c, const char *delims) {
+    for (; *delims; delims++)
+        if (c == *delims) return true;
+    return false;
+}
+
+/**
+ * Split the next token off the front of *rest, skipping leading delimiters
+ * (strtok semantics). Returns false when no token is left.
+ */
+static inline bool next_token(TextSpan *rest, const char *delims, TextSpan *tok) {
+    const char *p = rest->p, *end = rest->p + rest->n;
+    while (p < end && is_delim(*p, delims)) p++;
+    if (p == end) {
+        rest->p = end;
+        rest->n = 0;
+        return false;
+    }
+
+    const char *start = p;
+    while (p < end && !is_delim(*p, delims)) p++;
+    tok->p = start;
+    tok->n = (size_t)(p - start);
+    rest->p = p;
+    rest->n = (size_t)(end - p);
+    return true;
+}
+
+/** Copy a span into a NUL-terminated buffer, truncating to fit */
+static void span_copy(char *dst, size_t dstsz, TextSpan s) {
+    size_t n = s.n < dstsz - 1 ? s.n : dstsz - 1;
+    memcpy(dst, s.p, n);
+    dst[n] = '\0';
+}
+
+/* Exactly representable powers of ten */
+static const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8 };
+
+/* Fast-path limits. With at most 9 significant digits and a decimal scale
+ * in [-8, 6], m * 10^scale is either exact in double or (one correctly
+ * rounded division) lies further from any float rounding midpoint than
+ * double's rounding error, so narrowing to float rounds as strtof() does. */
+#define FAST_FLOAT_DIGITS    9
+#define FAST_FLOAT_MIN_SCALE (-8)
+#define FAST_FLOAT_MAX_SCALE 6
+
+/**
+ * Decimal to float for the plain [+-]digits[.digits][e[+-]digits] form
+ * manifests use, without a copy or strtof(). Returns false for anything
+ * else (long significands, hex, inf/nan, stray characters) so the caller
+ * falls back to strtof() and keeps its exact results and messages.
+ */
+static bool fast_span_float(TextSpan s, float *out) {
+    const char *p = s.p, *end = s.p + s.n;
+    bool neg = false;
+    if (p < end && (*p == '+' || *p == '-')) neg = (*p++ == '-');
+
+    uint32_t mant = 0;
+    int digits = 0, scale = 0;
+    bool any = false;
+    while (p < end && *p >= '0' && *p <= '9') {
+        any = true;
+        if (digits > 0 || *p != '0') {
+            if (++digits > FAST_FLOAT_DIGITS) return false;
+            mant = mant * 10u + (uint32_t)(*p - '0');
+        }
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            any = true;
+            if (digits > 0 || *p != '0') {
+                if (++digits > FAST_FLOAT_DIGITS) return false;
+                mant = mant * 10u + (uint32_t)(*p - '0');
+            }
+            scale--;
+            p++;
+        }
+    }
+    if (!any) return false;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool eneg = false;
+        if (p < end && (*p == '+' || *p == '-')) eneg = (*p++ == '-');
+        if (p == end) return false;
+        int e = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (e > 100) return false;
+            e = e * 10 + (*p++ - '0');
+        }
+        scale += eneg ? -e : e;
+    }
+    if (p != end) return false;
+    if (scale < FAST_FLOAT_MIN_SCALE || scale > FAST_FLOAT_MAX_SCALE) return false;
+
+    double v = (double)mant;
+    v = scale < 0 ? v / POW10[-scale] : v * POW10[scale];
+    *out = (float)(neg ? -v : v);
+    return true;
+}
+
+/** safe_atof() on a span (numbers are short, so a stack copy suffices) */
+static float span_atof(TextSpan s, float min, float max, const char *field_name) {
+    float fast;
+    if (fast_span_float(s, &fast) && fast >= min && fast <= max)
+        return fast;
+
+    char buf[64];
+    if (s.n >= sizeof(buf)) {
+        fprintf(stderr, "Error: Invalid or out-of-range %s value '%.*s'\n",
+                field_name, (int)s.n, s.p);
+        return NAN;
+    }
+    span_copy(buf, sizeof(buf), s);
+    return safe_atof(buf, min, max, field_name);
+}
+
+static bool span_eq(TextSpan s, const char *lit) {
+    size_t n = strlen(lit);
+    return s.n == n && memcmp(s.p, lit, n) == 0;
+}
+
+/**
+ * Read a whole stream into a heap buffer (caller frees).
+ * Returns NULL on allocation or read failure.
+ */
+static char *read_stream(FILE *file, size_t *len) {
+    size_t cap = 64 * 1024, n = 0;
+    char *buf = malloc(cap);
+    if (!buf) return NULL;
+
+    for (;;) {
+        n += fread(buf + n, 1, cap - n, file);
+        if (n < cap) break;
+        char *grown = realloc(buf, cap * 2);
+        if (!grown) {
+            free(buf);
+            return NULL;
         }
+        buf = grown;
+        cap *= 2;
+    }
+    if (ferror(file)) {
+        free(buf);
+        return NULL;
+    }
+    *len = n;
+    return buf;
+}
+
+/**
+ * Open filename ("-" = stdin) and read it into memory.
+ * Returns NULL (after printing why) on failure.
+ */
+static char *read_input(const char *filename, const char *what, size_t *len) {
+    bool use_stdin = (strcmp(filename, "-") == 0);
+    FILE *file = use_stdin ? stdin : fopen(filename, "r");
+    if (!file) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "Error opening %s file", what);
+        perror(msg);
+        return NULL;
     }
 
+    char *buf = read_stream(file, len);
+    if (!use_stdin) fclose(file);
+    if (!buf)
+        fprintf(stderr, "Error: Failed to read %s file.\n", what);
+    return buf;
+}
+
+/* ------------------------------------------------------------------ */
+/* SHIP CONFIGURATION                                                 */
+/* ------------------------------------------------------------------ */
+
+// Parses ship configuration using the safe parser.
+int parse_ship_config(const char *filename, Ship *ship) {
+    size_t len = 0;
+    char *text = read_input(filename, "ship config", &len);
+    if (!text) return -1;
+
+    int rc = parse_ship_config_buffer(text, len, ship);
+    free(text);
+    return rc;
+}
+
+int parse_ship_config_buffer(const char *text, size_t len, Ship *ship) {
     /* Temporary storage for file paths (parsed first, loaded after) */
     char hydro_path[256] = {0};
     char tanks_path[256] = {0};
 
     /* Temporary storage for strength limits */
     float perm_sf = 0, perm_bm_hog = 0, perm_bm_sag = 0;
+    int strength_stations = 0;
     int has_strength = 0;
 
-    char line[MAX_LINE_LENGTH];
-    while (fgets(line, sizeof(line), file)) {
-        if (line[0] == '#' || line[0] == '\n') continue;
+    /* Compartments, attached to the ship once the whole file parsed */
+    HoldConfig holds = {0};
+
+    const char *cur = text, *end = text + len;
+    TextSpan line;
+    while (next_line(&cur, end, &line)) {
+        if (skip_line(&line)) continue;
 
-        char *key = strtok(line, "=");
-        char *value = strtok(NULL, "\n");
-        if (!key || !value) continue;
+        /* key is everything up to the first '=', value the rest */
+        TextSpan key, value;
+        if (!next_token(&line, "=", &key) || line.n < 2) continue;
+        value.p = line.p + 1;
+        value.n = line.n - 1;
 
         /* Trim leading whitespace from value */
-        while (*value == ' ' || *value == '\t') value++;
+        while (value.n > 0 && (*value.p == ' ' || *value.p == '\t')) {
+            value.p++;
+            value.n--;
+        }
 
         /* String-valued config keys (no numeric conversion) */
-        if (strcmp(key, "hydrostatic_table") == 0) {
-            strncpy(hydro_path, value, sizeof(hydro_path) - 1);
+        if (span_eq(key, "hydrostatic_table")) {
+            span_copy(hydro_path, sizeof(hydro_path), value);
+            continue;
+        }
+        if (span_eq(key, "tank_config")) {
+            span_copy(tanks_path, sizeof(tanks_path), value);
             continue;
         }
-        if (strcmp(key, "tank_config") == 0) {
-            strncpy(tanks_path, value, sizeof(tanks_path) - 1);
+        if (span_eq(key, "hold")) {
+            char *spec = malloc(value.n + 1);
+            if (!spec) {
+                fprintf(stderr, "Error: Failed to allocate memory for hold spec.\n");
+                hold_config_free(&holds);
+                return -1;
+            }
+            span_copy(spec, value.n + 1, value);
+            int rc = hold_config_parse_line(&holds, spec);
+            free(spec);
+            if (rc != 0) {
+                hold_config_free(&holds);
+                return -1;
+            }
             continue;
         }
 
         /* Numeric-valued config keys */
-        float v = safe_atof(value, 0.1f, 1e9f, key);
+        char key_name[64];
+        span_copy(key_name, sizeof(key_name), key);
+        float v = span_atof(value, 0.1f, 1e9f, key_name);
         if (isnan(v)) {
-            if (!use_stdin) fclose(file);
+            hold_config_free(&holds);
             return -1; // Abort on invalid data
         }
 
-        if (strcmp(key, "length_m") == 0) ship->length = v;
-        else if (strcmp(key, "width_m") == 0) ship->width = v;
-        else if (strcmp(key, "max_weight_tonnes") == 0) ship->max_weight = v * 1000.0f;
-        else if (strcmp(key, "lightship_weight_tonnes") == 0) ship->lightship_weight = v * 1000.0f;
-        else if (strcmp(key, "lightship_kg_m") == 0) ship->lightship_kg = v;
-        else if (strcmp(key, "permissible_sf_tonnes") == 0) { perm_sf = v; has_strength = 1; }
-        else if (strcmp(key, "permissible_bm_hog_t_m") == 0) { perm_bm_hog = v; has_strength = 1; }
-        else if (strcmp(key, "permissible_bm_sag_t_m") == 0) { perm_bm_sag = v; has_strength = 1; }
-    }
-
-    if (!use_stdin) {
-        fclose(file);
+        if (span_eq(key, "length_m")) ship->length = v;
+        else if (span_eq(key, "width_m")) ship->width = v;
+        else if (span_eq(key, "max_weight_tonnes")) ship->max_weight = v * 1000.0f;
+        else if (span_eq(key, "lightship_weight_tonnes")) ship->lightship_weight = v * 1000.0f;
+        else if (span_eq(key, "lightship_kg_m")) ship->lightship_kg = v;
+        else if (span_eq(key, "permissible_sf_tonnes")) { perm_sf = v; has_strength = 1; }
+        else if (span_eq(key, "permissible_bm_hog_t_m")) { perm_bm_hog = v; has_strength = 1; }
+        else if (span_eq(key, "permissible_bm_sag_t_m")) { perm_bm_sag = v; has_strength = 1; }
+        else if (span_eq(key, "strength_stations")) {
+            if (v != floorf(v) || v < 3.0f || v > (float)LS_MAX_STATIONS) {
+                fprintf(stderr, "Error: strength_stations must be a whole number from 3 to %d\n",
+                        LS_MAX_STATIONS);
+                hold_config_free(&holds);
+                return -1;
+            }
+            strength_stations = (int)v;
+        }
     }
 
     /* Load hydrostatic table if specified */
     if (hydro_path[0] != '\0') {
-        ship->hydro = calloc(1, sizeof(HydroTable));
+        ship->hydro = ship_alloc(ship, sizeof(HydroTable));
         if (ship->hydro) {
+            memset(ship->hydro, 0, sizeof(HydroTable));
             if (parse_hydro_table(hydro_path, (HydroTable *)ship->hydro) != 0) {
-                free(ship->hydro);
+                ship_free(ship, ship->hydro);
                 ship->hydro = NULL;
                 fprintf(stderr, "Warning: Failed to load hydrostatic table, using box-hull fallback\n");
             }
@@ -117,48 +379,189 @@ int parse_ship_config(const char *filename, Ship *ship) {
 
     /* Load tank configuration if specified */
     if (tanks_path[0] != '\0') {
-        ship->tanks = calloc(1, sizeof(TankConfig));
+        ship->tanks = ship_alloc(ship, sizeof(TankConfig));
         if (ship->tanks) {
+            memset(ship->tanks, 0, sizeof(TankConfig));
             if (parse_tank_config(tanks_path, (TankConfig *)ship->tanks) != 0) {
-                free(ship->tanks);
+                ship_free(ship, ship->tanks);
                 ship->tanks = NULL;
                 fprintf(stderr, "Warning: Failed to load tank config, no free surface correction\n");
             }
         }
     }
 
+    /* Attach compartments if any were defined */
+    if (holds.count > 0) {
+        ship->holds = ship_alloc(ship, sizeof(HoldConfig));
+        if (!ship->holds) {
+            hold_config_free(&holds);
+            fprintf(stderr, "Error: Out of memory storing hold definitions\n");
+            return -1;
+        }
+        *(HoldConfig *)ship->holds = holds;
+    }
+
     /* Set strength limits if specified */
     if (has_strength) {
-        ship->strength_limits = calloc(1, sizeof(StrengthLimits));
+        ship->strength_limits = ship_alloc(ship, sizeof(StrengthLimits));
         if (ship->strength_limits) {
             StrengthLimits *sl = (StrengthLimits *)ship->strength_limits;
+            memset(sl, 0, sizeof(*sl));
             sl->permissible_sf = perm_sf;
             sl->permissible_bm_hog = perm_bm_hog;
             sl->permissible_bm_sag = perm_bm_sag;
+            sl->stations = strength_stations;
         }
     }
 
     return 0;
 }
 
+/* ------------------------------------------------------------------ */
+/* SHIP MEMORY                                                        */
+/* ------------------------------------------------------------------ */
+
+void *ship_alloc(Ship *ship, size_t size) {
+    if (ship->arena) return arena_alloc(ship->arena, size);
+    return malloc(size);
+}
+
+void *ship_realloc(Ship *ship, void *ptr, size_t old_size, size_t new_size) {
+    if (ship->arena) return arena_realloc(ship->arena, ptr, old_size, new_size);
+    return realloc(ptr, new_size);
+}
+
+void ship_free(Ship *ship, void *ptr) {
+    if (!ship->arena) free(ptr);
+}
+
+/* ------------------------------------------------------------------ */
+/* RECORD POOLS                                                       */
+/* ------------------------------------------------------------------ */
+
+/* First pool block holds this many records; each later block doubles */
+#define POOL_FIRST_BLOCK 64
+#define POOL_MAX_BLOCK   65536
+
+typedef struct PoolBlock_ {
+    struct PoolBlock_ *next;
+    int used;
+    int capacity;
+    double records[];        /* record_size * capacity bytes; double for alignment */
+} PoolBlock;
+
+/**
+ * RecordPool - Storage for one kind of fixed-size record parsed into a
+ * ship (DG info, cargo labels). Records live in a chain of contiguous
+ * blocks that never move, so pointers into them stay valid while the
+ * cargo array grows; the pool is freed as a whole.
+ */
+typedef struct RecordPool_ {
+    PoolBlock *head;         /* newest block (the one being filled) */
+    size_t record_size;
+    int count;
+    int in_arena;            /* pool and blocks are ship->arena memory */
+} RecordPool;
+
+static void *pool_alloc(Ship *ship, RecordPool **slot, size_t record_size) {
+    RecordPool *pool = *slot;
+    if (!pool) {
+        pool = ship_alloc(ship, sizeof(RecordPool));
+        if (!pool) return NULL;
+        memset(pool, 0, sizeof(*pool));
+        pool->record_size = record_size;
+        pool->in_arena = ship->arena != NULL;
+        *slot = pool;
+    }
+
+    PoolBlock *blk = pool->head;
+    if (!blk || blk->used == blk->capacity) {
+        int cap = blk ? blk->capacity * 2 : POOL_FIRST_BLOCK;
+        if (cap > POOL_MAX_BLOCK) cap = POOL_MAX_BLOCK;
+        PoolBlock *next = ship_alloc(ship, sizeof(PoolBlock) + (size_t)cap * record_size);
+        if (!next) return NULL;
+        next->next = blk;
+        next->used = 0;
+        next->capacity = cap;
+        pool->head = blk = next;
+    }
+
+    pool->count++;
+    return (unsigned char *)blk->records + (size_t)blk->used++ * record_size;
+}
+
+static void pool_destroy(RecordPool *pool) {
+    if (!pool || pool->in_arena) return;
+    PoolBlock *blk = pool->head;
+    while (blk) {
+        PoolBlock *next = blk->next;
+        free(blk);
+        blk = next;
+    }
+    free(pool);
+}
+
+DGInfo *dg_pool_alloc(Ship *ship) {
+    return pool_alloc(ship, &ship->dg_pool, sizeof(DGInfo));
+}
+
+CargoLabel *label_pool_alloc(Ship *ship) {
+    CargoLabel *l = pool_alloc(ship, &ship->label_pool, sizeof(CargoLabel));
+    if (l) memset(l, 0, sizeof(*l));
+    return l;
+}
+
+void cargo_pools_destroy(Ship *ship) {
+    pool_destroy(ship->dg_pool);
+    pool_destroy(ship->label_pool);
+    ship->dg_pool = NULL;
+    ship->label_pool = NULL;
+}
+
+/* ------------------------------------------------------------------ */
+/* CARGO LABELS AND FLAGS                                             */
+/* ------------------------------------------------------------------ */
+
+typedef char cargo_record_is_compact[sizeof(Cargo) <= 48 ? 1 : -1];
+
+unsigned char cargo_type_flags(const char *type) {
+    if (strcmp(type, CARGO_TYPE_HAZARDOUS) == 0) return CARGO_HAZARDOUS;
+    if (strcmp(type, CARGO_TYPE_REEFER) == 0) return CARGO_REEFER;
+    if (strcmp(type, CARGO_TYPE_FRAGILE) == 0) return CARGO_FRAGILE;
+    return 0;
+}
+
+int cargo_set_label(Ship *ship, Cargo *c, const char *id, size_t id_len,
+                    const char *type, size_t type_len) {
+    CargoLabel *l = label_pool_alloc(ship);
+    if (!l) return -1;
+    span_copy(l->id, sizeof(l->id), (TextSpan){ id, id_len });
+    span_copy(l->type, sizeof(l->type), (TextSpan){ type, type_len });
+    c->label = l;
+    c->flags = (unsigned char)((c->flags & ~CARGO_TYPE_FLAGS) | cargo_type_flags(l->type));
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* CARGO MANIFEST                                                     */
+/* ------------------------------------------------------------------ */
+
 /**
  * Parse optional DG info field from cargo line.
  * Format: DG:class.division:UNnnnn:stowage:EmS:reference
  * Example: DG:3.1:UN1203:A:F-E,S-D
  *
- * Returns a heap-allocated DGInfo, or NULL if not a DG field.
+ * Returns true and fills *dg if the field is valid DG info.
  */
-static DGInfo *parse_dg_field(const char *field) {
-    if (!field || strncmp(field, "DG:", 3) != 0)
-        return NULL;
+static bool parse_dg_field(TextSpan field, DGInfo *dg) {
+    if (field.n < 3 || memcmp(field.p, "DG:", 3) != 0)
+        return false;
 
-    DGInfo *dg = calloc(1, sizeof(DGInfo));
-    if (!dg) return NULL;
+    memset(dg, 0, sizeof(*dg));
 
     /* Work on a copy */
     char buf[64];
-    strncpy(buf, field + 3, sizeof(buf) - 1);
-    buf[sizeof(buf) - 1] = '\0';
+    span_copy(buf, sizeof(buf), (TextSpan){ field.p + 3, field.n - 3 });
 
     /* Parse class.division */
     char *saveptr;
@@ -197,198 +600,253 @@ static DGInfo *parse_dg_field(const char *field) {
     }
 
     /* Validate class range */
-    if (dg->dg_class < 1 || dg->dg_class > 9) {
-        free(dg);
-        return NULL;
-    }
-
-    return dg;
+    return dg->dg_class >= 1 && dg->dg_class <= 9;
 }
 
-// Parses a cargo list using the safe parser.
-int parse_cargo_list(const char *filename, Ship *ship) {
-    FILE *file;
-    bool use_stdin = (strcmp(filename, "-") == 0);
+/* Bytes read per fread() in streaming mode; a longer line grows the buffer */
+#define CARGO_STREAM_CHUNK (1 << 20)
+#define CARGO_INITIAL_CAPACITY 64
 
-    if (use_stdin) {
-        file = stdin;
-    } else {
-        file = fopen(filename, "r");
-        if (!file) {
-            perror("Error opening cargo list file");
-            return -1;
-        }
+/**
+ * CargoParser - State carried between lines (and chunks) of one manifest.
+ */
+typedef struct {
+    Ship *ship;
+    int line_num;            /* data lines seen, for messages */
+} CargoParser;
+
+/** Drop everything parsed so far after a fatal error */
+static int abort_cargo_parse(Ship *ship) {
+    ship_free(ship, ship->cargo);
+    ship->cargo = NULL;   // avoid a dangling pointer -> use-after-free/double-free in ship_cleanup
+    ship->cargo_count = 0;
+    ship->cargo_capacity = 0;
+    cargo_pools_destroy(ship);
+    return -1;
+}
+
+static int cargo_parser_begin(CargoParser *cp, Ship *ship, int capacity) {
+    cp->ship = ship;
+    cp->line_num = 0;
+    if (capacity < CARGO_INITIAL_CAPACITY) capacity = CARGO_INITIAL_CAPACITY;
+    ship->cargo = ship_alloc(ship, (size_t)capacity * sizeof(Cargo));
+    if (!ship->cargo) {
+        fprintf(stderr, "Error: Failed to allocate memory for cargo.\n");
+        return -1;
     }
+    ship->cargo_capacity = capacity;
+    ship->cargo_count = 0;
+    return 0;
+}
 
-    // For stdin, we need to read all lines into memory first since we can't rewind
-    // For files, we can still do two-pass reading
-    char **lines = NULL;
-    int line_count = 0;
-    int line_capacity = 100; // Initial capacity
+/**
+ * Parse one manifest line into the next cargo slot.
+ * Returns 0 (also for skipped lines) or -1 after a fatal error.
+ */
+static int cargo_parse_line(CargoParser *cp, TextSpan line) {
+    Ship *ship = cp->ship;
+    if (skip_line(&line)) return 0;
 
-    if (use_stdin) {
-        // Read all lines from stdin into memory
-        lines = malloc(line_capacity * sizeof(char*));
-        if (!lines) {
-            fprintf(stderr, "Error: Failed to allocate memory for line buffer.\n");
-            return -1;
-        }
+    cp->line_num++;
 
-        char line[MAX_LINE_LENGTH];
-        while (fgets(line, sizeof(line), file)) {
-            if (line[0] == '#' || line[0] == '\n') continue;
-
-            if (line_count >= line_capacity) {
-                line_capacity *= 2;
-                char **new_lines = realloc(lines, line_capacity * sizeof(char*));
-                if (!new_lines) {
-                    fprintf(stderr, "Error: Failed to reallocate line buffer.\n");
-                    for (int i = 0; i < line_count; i++) free(lines[i]);
-                    free(lines);
-                    return -1;
-                }
-                lines = new_lines;
-            }
+    TextSpan id, w_str, dim_str, type, dg_field = { NULL, 0 };
+    if (!next_token(&line, " \t", &id) || !next_token(&line, " \t", &w_str) ||
+        !next_token(&line, " \t", &dim_str) || !next_token(&line, " \t", &type)) {
+        fprintf(stderr, "Warning: Skipping malformed cargo data on line %d.\n", cp->line_num);
+        return 0;
+    }
 
-            lines[line_count] = strdup(line);
-            if (!lines[line_count]) {
-                fprintf(stderr, "Error: Failed to duplicate line.\n");
-                for (int i = 0; i < line_count; i++) free(lines[i]);
-                free(lines);
-                return -1;
-            }
-            line_count++;
-        }
+    /* Optional 5th field: DG info */
+    bool has_dg = next_token(&line, " \t", &dg_field);
 
-        ship->cargo = malloc(line_count * sizeof(Cargo));
-        if (!ship->cargo) {
+    if (ship->cargo_count >= ship->cargo_capacity) {
+        int cap = ship->cargo_capacity * 2;
+        Cargo *grown = ship_realloc(ship, ship->cargo,
+                                    (size_t)ship->cargo_capacity * sizeof(Cargo),
+                                    (size_t)cap * sizeof(Cargo));
+        if (!grown) {
             fprintf(stderr, "Error: Failed to allocate memory for cargo.\n");
-            for (int i = 0; i < line_count; i++) free(lines[i]);
-            free(lines);
-            return -1;
-        }
-        ship->cargo_capacity = line_count;
-        ship->cargo_count = 0;
-    } else {
-        // File-based: count lines first
-        int count = 0;
-        char line[MAX_LINE_LENGTH];
-        while (fgets(line, sizeof(line), file)) {
-            if (line[0] != '#' && line[0] != '\n') count++;
+            return abort_cargo_parse(ship);
         }
+        ship->cargo = grown;
+        ship->cargo_capacity = cap;
+    }
 
-        ship->cargo = malloc(count * sizeof(Cargo));
-        if (!ship->cargo) {
-            fprintf(stderr, "Error: Failed to allocate memory for cargo.\n");
-            fclose(file);
-            return -1;
-        }
-        ship->cargo_capacity = count;
-        ship->cargo_count = 0;
-        rewind(file);
+    Cargo *c = &ship->cargo[ship->cargo_count];
+    memset(c, 0, sizeof(*c));
+    if (cargo_set_label(ship, c, id.p, id.n, type.p, type.n) != 0) {
+        fprintf(stderr, "Error: Failed to allocate memory for cargo.\n");
+        return abort_cargo_parse(ship);
+    }
+    c->pos_x = -1.0f;
+    c->pos_y = -1.0f;
+    c->pos_z = -1.0f;
+    c->dg = NULL;
+
+    float weight_t = span_atof(w_str, 0.1f, 1e6f, "weight");
+    if (isnan(weight_t)) return abort_cargo_parse(ship);
+    c->weight = weight_t * 1000.0f; // tonnes -> kg
+
+    // Parse dimensions (e.g., "12.2x2.4x2.6")
+    TextSpan tok;
+    bool dims_ok = true;
+    for (int d = 0; d < MAX_DIMENSION; ++d) {
+        if (!next_token(&dim_str, "x", &tok)) { dims_ok = false; break; }
+        float dv = span_atof(tok, 0.1f, 1e4f, "dimension");
+        if (isnan(dv)) { dims_ok = false; break; }
+        c->dimensions[d] = dv;
     }
 
-    int line_num = 0;
-    char line[MAX_LINE_LENGTH];
+    if (!dims_ok) {
+        fprintf(stderr, "Error: Incomplete or invalid dimensions for cargo '%s' on line %d\n", CARGO_ID(c), cp->line_num);
+        return abort_cargo_parse(ship);
+    }
 
-    for (int i = 0; ship->cargo_count < ship->cargo_capacity; i++) {
-        // Read from either lines array (stdin) or file
-        if (use_stdin) {
-            if (i >= line_count) break;
-            strncpy(line, lines[i], MAX_LINE_LENGTH - 1);
-            line[MAX_LINE_LENGTH - 1] = '\0';
-        } else {
-            if (!fgets(line, sizeof(line), file)) break;
-            if (line[0] == '#' || line[0] == '\n') continue;
+    /* Parse DG info if present; records go to the ship's pool */
+    DGInfo dg;
+    if (has_dg && parse_dg_field(dg_field, &dg)) {
+        DGInfo *slot = dg_pool_alloc(ship);
+        if (!slot) {
+            fprintf(stderr, "Error: Failed to allocate memory for DG info.\n");
+            return abort_cargo_parse(ship);
         }
+        *slot = dg;
+        c->dg = (struct DGInfo_ *)slot;
+        c->dg_index = (unsigned char)(imdg_class_index(dg.dg_class, dg.dg_division) + 1);
+    }
 
-        line_num++;
+    ship->cargo_count++;
+    return 0;
+}
 
-        char *saveptr;
-        char *id = strtok_r(line, " \t", &saveptr);
-        char *w_str = strtok_r(NULL, " \t", &saveptr);
-        char *dim_str = strtok_r(NULL, " \t", &saveptr);
-        char *type = strtok_r(NULL, " \t\n", &saveptr);
+/**
+ * Parse every complete line in [text, text + len). With final set the
+ * trailing unterminated line is parsed too; otherwise its length is left
+ * in *rest for the caller to carry into the next chunk.
+ */
+static int cargo_parse_text(CargoParser *cp, const char *text, size_t len,
+                            bool final, size_t *rest) {
+    const char *cur = text, *end = text + len;
+    if (!final) {
+        const char *last_nl = text + len;
+        while (last_nl > text && last_nl[-1] != '\n') last_nl--;
+        end = last_nl;
+        *rest = (size_t)(text + len - last_nl);
+    }
 
-        if (!id || !w_str || !dim_str || !type) {
-            fprintf(stderr, "Warning: Skipping malformed cargo data on line %d.\n", line_num);
-            continue;
-        }
+    TextSpan line;
+    while (next_line(&cur, end, &line))
+        if (cargo_parse_line(cp, line) != 0) return -1;
+    return 0;
+}
+
+int parse_cargo_list_buffer(const char *text, size_t len, Ship *ship) {
+    CargoParser cp;
+    if (cargo_parser_begin(&cp, ship, 0) != 0) return -1;
+    return cargo_parse_text(&cp, text, len, true, NULL);
+}
+
+int parse_cargo_stream(FILE *file, Ship *ship) {
+    CargoParser cp;
+    if (cargo_parser_begin(&cp, ship, 0) != 0) return -1;
 
-        /* Optional 5th field: DG info */
-        char *dg_field = strtok_r(NULL, " \t\n", &saveptr);
-
-        Cargo *c = &ship->cargo[ship->cargo_count];
-        memset(c, 0, sizeof(*c));
-        strncpy(c->id, id, sizeof(c->id) - 1);
-        c->id[sizeof(c->id) - 1] = '\0';
-        strncpy(c->type, type, sizeof(c->type) - 1);
-        c->type[sizeof(c->type) - 1] = '\0';
-        c->pos_x = -1.0f;
-        c->pos_y = -1.0f;
-        c->pos_z = -1.0f;
-        c->dg = NULL;
-
-        float weight_t = safe_atof(w_str, 0.1f, 1e6f, "weight");
-        if (isnan(weight_t)) {
-            for (int j = 0; j < ship->cargo_count; j++) free(ship->cargo[j].dg);
-            free(ship->cargo);
-            ship->cargo = NULL;   // avoid a dangling pointer -> use-after-free/double-free in ship_cleanup
-            ship->cargo_count = 0;
-            if (use_stdin) {
-                for (int j = 0; j < line_count; j++) free(lines[j]);
-                free(lines);
-            } else {
-                fclose(file);
+    size_t cap = CARGO_STREAM_CHUNK, have = 0;
+    char *buf = malloc(cap);
+    if (!buf) {
+        fprintf(stderr, "Error: Failed to allocate manifest read buffer.\n");
+        return abort_cargo_parse(ship);
+    }
+
+    for (;;) {
+        // A line longer than the whole buffer: make room for more of it
+        if (have == cap) {
+            char *grown = realloc(buf, cap * 2);
+            if (!grown) {
+                fprintf(stderr, "Error: Failed to allocate manifest read buffer.\n");
+                free(buf);
+                return abort_cargo_parse(ship);
             }
-            return -1;
+            buf = grown;
+            cap *= 2;
         }
-        c->weight = weight_t * 1000.0f; // tonnes -> kg
-
-        // Parse dimensions (e.g., "12.2x2.4x2.6")
-        char *dim_saveptr;
-        char *tok = strtok_r(dim_str, "x", &dim_saveptr);
-        bool dims_ok = true;
-        for (int d = 0; d < MAX_DIMENSION; ++d) {
-            if (!tok) { dims_ok = false; break; }
-            float dv = safe_atof(tok, 0.1f, 1e4f, "dimension");
-            if (isnan(dv)) { dims_ok = false; break; }
-            c->dimensions[d] = dv;
-            tok = strtok_r(NULL, "x", &dim_saveptr);
+
+        size_t got = fread(buf + have, 1, cap - have, file);
+        have += got;
+        bool final = (got == 0);
+        if (final && ferror(file)) {
+            fprintf(stderr, "Error: Failed to read cargo list file.\n");
+            free(buf);
+            return abort_cargo_parse(ship);
         }
 
-        if (!dims_ok) {
-            fprintf(stderr, "Error: Incomplete or invalid dimensions for cargo '%s' on line %d\n", id, line_num);
-            for (int j = 0; j < ship->cargo_count; j++) free(ship->cargo[j].dg);
-            free(ship->cargo);
-            ship->cargo = NULL;   // avoid a dangling pointer -> use-after-free/double-free in ship_cleanup
-            ship->cargo_count = 0;
-            if (use_stdin) {
-                for (int j = 0; j < line_count; j++) free(lines[j]);
-                free(lines);
-            } else {
-                fclose(file);
-            }
+        size_t rest = 0;
+        if (cargo_parse_text(&cp, buf, have, final, &rest) != 0) {
+            free(buf);
             return -1;
         }
+        if (final) break;
 
-        /* Parse DG info if present */
-        if (dg_field) {
-            c->dg = (struct DGInfo_ *)parse_dg_field(dg_field);
-        }
+        // Carry the partial last line to the front for the next read
+        memmove(buf, buf + have - rest, rest);
+        have = rest;
+    }
+
+    free(buf);
+    return 0;
+}
+
+/* Files smaller than this are streamed; mapping them is not worth it */
+#define CARGO_MMAP_MIN_SIZE (64 * 1024)
 
-        ship->cargo_count++;
+int parse_cargo_list_mapped(const char *filename, Ship *ship) {
+#ifdef HAVE_MMAP
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening cargo list file");
+        return -1;
     }
 
-    // Cleanup
-    if (use_stdin) {
-        for (int i = 0; i < line_count; i++) {
-            free(lines[i]);
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+        st.st_size >= CARGO_MMAP_MIN_SIZE && (uint64_t)st.st_size <= SIZE_MAX) {
+        size_t len = (size_t)st.st_size;
+        void *map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map != MAP_FAILED) {
+            posix_madvise(map, len, POSIX_MADV_SEQUENTIAL);
+            const char *text = map;
+
+            // One memchr() sweep sizes the cargo array exactly
+            size_t lines = 0;
+            for (const char *p = text, *end = text + len;
+                 p < end && (p = memchr(p, '\n', (size_t)(end - p))) != NULL; p++)
+                lines++;
+            int hint = lines < (size_t)(1 << 30) ? (int)lines + 1 : (1 << 30);
+
+            CargoParser cp;
+            int rc = cargo_parser_begin(&cp, ship, hint);
+            if (rc == 0) rc = cargo_parse_text(&cp, text, len, true, NULL);
+            munmap(map, len);
+            return rc;
         }
-        free(lines);
     } else {
-        fclose(file);
+        close(fd);
     }
+#endif
+    // Pipes, small files, or no mmap: stream it
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        perror("Error opening cargo list file");
+        return -1;
+    }
+    int rc = parse_cargo_stream(file, ship);
+    fclose(file);
+    return rc;
+}
 
-    return 0;
+// Parses a cargo list using the safe parser.
+int parse_cargo_list(const char *filename, Ship *ship) {
+    if (strcmp(filename, "-") == 0)
+        return parse_cargo_stream(stdin, ship);
+    return parse_cargo_list_mapped(filename, ship);
 }
@@ -1,14 +1,20 @@
 /*
  * placement_3d.c - 3D bin-packing implementation
  *
- * Implements guillotine-based 3D bin-packing for realistic cargo placement.
+ * Implements 3D bin-packing for realistic cargo placement, with guillotine
+ * splitting or extreme points tracking where cargo can go.
  */
 
 #include "placement_3d.h"
 #include "constraints.h"
+#include "spatial_index.h"
+#include "stack_grid.h"
+#include "thread_pool.h"
+#include "holds.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 // Comparator for sorting cargo by volume (descending)
 static int cargo_cmp_by_volume_desc(const void *a, const void *b) {
@@ -38,26 +44,345 @@ static void get_orientation_dims(const Cargo *c, int orientation,
     }
 }
 
-// Check if cargo fits in space with given orientation
-static int fits_in_space(const Space3D *space, const Cargo *cargo, int orientation) {
-    float w, d, h;
-    get_orientation_dims(cargo, orientation, &w, &d, &h);
-    return (w <= space->width && d <= space->depth && h <= space->height);
+/* SIMD width for the candidate scan; the scalar path handles the tail */
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FIT_LANES 8
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FIT_LANES 4
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FIT_LANES 4
+#else
+#define FIT_LANES 1
+#endif
+
+/**
+ * OrientDims - All 6 orientation tuples of one cargo item, precomputed once
+ * per search so the scan never goes back through get_orientation_dims().
+ */
+typedef struct {
+    float w[6], d[6], h[6];
+} OrientDims;
+
+static void orient_dims_init(OrientDims *od, const Cargo *c) {
+    for (int o = 0; o < 6; o++)
+        get_orientation_dims(c, o, &od->w[o], &od->d[o], &od->h[o]);
 }
 
-// Calculate volume of a space
-static float space_volume(const Space3D *space) {
-    return space->width * space->depth * space->height;
+// First orientation (0-5) that fits free space s, or -1
+static int first_fitting_orientation(const SpaceStore *st, int s, const OrientDims *od) {
+    for (int o = 0; o < 6; o++) {
+        if (od->w[o] <= st->width[s] && od->d[o] <= st->depth[s] && od->h[o] <= st->height[s])
+            return o;
+    }
+    return -1;
 }
 
-int find_best_fit_3d(const Ship *ship, Bin3D *bins, int bin_count,
-                     const Cargo *cargo, int *best_bin, int *best_space,
-                     int *best_orientation) {
+#if FIT_LANES > 1
+/**
+ * Test FIT_LANES spaces starting at s against all 6 orientations at once.
+ * Returns a lane bitmask of spaces where some orientation fits and whose
+ * volume is strictly below best_vol.
+ */
+static int fit_mask_block(const SpaceStore *st, int s, const OrientDims *od, float best_vol) {
+#if defined(__AVX__)
+    __m256 sw = _mm256_loadu_ps(st->width + s);
+    __m256 sd = _mm256_loadu_ps(st->depth + s);
+    __m256 sh = _mm256_loadu_ps(st->height + s);
+    __m256 any = _mm256_setzero_ps();
+    for (int o = 0; o < 6; o++) {
+        __m256 m = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(_mm256_set1_ps(od->w[o]), sw, _CMP_LE_OQ),
+                          _mm256_cmp_ps(_mm256_set1_ps(od->d[o]), sd, _CMP_LE_OQ)),
+            _mm256_cmp_ps(_mm256_set1_ps(od->h[o]), sh, _CMP_LE_OQ));
+        any = _mm256_or_ps(any, m);
+    }
+    any = _mm256_and_ps(any, _mm256_cmp_ps(_mm256_loadu_ps(st->volume + s),
+                                           _mm256_set1_ps(best_vol), _CMP_LT_OQ));
+    return _mm256_movemask_ps(any);
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 sw = _mm_loadu_ps(st->width + s);
+    __m128 sd = _mm_loadu_ps(st->depth + s);
+    __m128 sh = _mm_loadu_ps(st->height + s);
+    __m128 any = _mm_setzero_ps();
+    for (int o = 0; o < 6; o++) {
+        __m128 m = _mm_and_ps(
+            _mm_and_ps(_mm_cmple_ps(_mm_set1_ps(od->w[o]), sw),
+                       _mm_cmple_ps(_mm_set1_ps(od->d[o]), sd)),
+            _mm_cmple_ps(_mm_set1_ps(od->h[o]), sh));
+        any = _mm_or_ps(any, m);
+    }
+    any = _mm_and_ps(any, _mm_cmplt_ps(_mm_loadu_ps(st->volume + s), _mm_set1_ps(best_vol)));
+    return _mm_movemask_ps(any);
+#else /* NEON */
+    float32x4_t sw = vld1q_f32(st->width + s);
+    float32x4_t sd = vld1q_f32(st->depth + s);
+    float32x4_t sh = vld1q_f32(st->height + s);
+    uint32x4_t any = vdupq_n_u32(0);
+    for (int o = 0; o < 6; o++) {
+        uint32x4_t m = vandq_u32(
+            vandq_u32(vcleq_f32(vdupq_n_f32(od->w[o]), sw),
+                      vcleq_f32(vdupq_n_f32(od->d[o]), sd)),
+            vcleq_f32(vdupq_n_f32(od->h[o]), sh));
+        any = vorrq_u32(any, m);
+    }
+    any = vandq_u32(any, vcltq_f32(vld1q_f32(st->volume + s), vdupq_n_f32(best_vol)));
+    return (int)((vgetq_lane_u32(any, 0) & 1u) | (vgetq_lane_u32(any, 1) & 2u) |
+                 (vgetq_lane_u32(any, 2) & 4u) | (vgetq_lane_u32(any, 3) & 8u));
+#endif
+}
+#endif
+
+/* Coordinates closer than this are treated as the same plane when merging */
+#define MERGE_EPSILON 1e-4f
+
+static int same_coord(float a, float b) {
+    float d = a - b;
+    return d < MERGE_EPSILON && d > -MERGE_EPSILON;
+}
+
+/**
+ * Try to merge b into a. Two boxes merge when they touch along one axis and
+ * match exactly in the other two, so their union is again a box.
+ */
+static int try_merge(Space3D *a, const Space3D *b) {
+    int same_yz = same_coord(a->y, b->y) && same_coord(a->depth, b->depth) &&
+                  same_coord(a->z, b->z) && same_coord(a->height, b->height);
+    int same_xz = same_coord(a->x, b->x) && same_coord(a->width, b->width) &&
+                  same_coord(a->z, b->z) && same_coord(a->height, b->height);
+    int same_xy = same_coord(a->x, b->x) && same_coord(a->width, b->width) &&
+                  same_coord(a->y, b->y) && same_coord(a->depth, b->depth);
+
+    if (same_yz) {
+        if (same_coord(a->x + a->width, b->x)) { a->width += b->width; return 1; }
+        if (same_coord(b->x + b->width, a->x)) { a->x = b->x; a->width += b->width; return 1; }
+    }
+    if (same_xz) {
+        if (same_coord(a->y + a->depth, b->y)) { a->depth += b->depth; return 1; }
+        if (same_coord(b->y + b->depth, a->y)) { a->y = b->y; a->depth += b->depth; return 1; }
+    }
+    if (same_xy) {
+        if (same_coord(a->z + a->height, b->z)) { a->height += b->height; return 1; }
+        if (same_coord(b->z + b->height, a->z)) { a->z = b->z; a->height += b->height; return 1; }
+    }
+    return 0;
+}
+
+/* Number of float columns in a SpaceStore allocation */
+#define SPACE_COLUMNS 7
+
+static int space_store_reserve(SpaceStore *st, int capacity) {
+    if (capacity <= st->capacity) return 0;
+
+    float *block = malloc((size_t)capacity * SPACE_COLUMNS * sizeof(float));
+    if (!block) return -1;
+
+    float *cols[SPACE_COLUMNS];
+    for (int c = 0; c < SPACE_COLUMNS; c++)
+        cols[c] = block + (size_t)c * (size_t)capacity;
+
+    if (st->count > 0) {
+        const float *old[SPACE_COLUMNS] = {
+            st->x, st->y, st->z, st->width, st->depth, st->height, st->volume
+        };
+        for (int c = 0; c < SPACE_COLUMNS; c++)
+            memcpy(cols[c], old[c], (size_t)st->count * sizeof(float));
+    }
+
+    free(st->x);  /* x is the start of the previous block */
+    st->x = cols[0];      st->y = cols[1];     st->z = cols[2];
+    st->width = cols[3];  st->depth = cols[4]; st->height = cols[5];
+    st->volume = cols[6];
+    st->capacity = capacity;
+    return 0;
+}
+
+/* Append a space as it is (no merging) */
+static int space_store_push(SpaceStore *st, const Space3D *sp) {
+    if (st->count >= st->capacity) {
+        int new_cap = (st->capacity > 0) ? st->capacity * 2 : BIN3D_INITIAL_SPACES;
+        if (space_store_reserve(st, new_cap) != 0) return -1;
+    }
+
+    int s = st->count++;
+    st->x[s] = sp->x;
+    st->y[s] = sp->y;
+    st->z[s] = sp->z;
+    st->width[s] = sp->width;
+    st->depth[s] = sp->depth;
+    st->height[s] = sp->height;
+    st->volume[s] = sp->width * sp->depth * sp->height;
+    return 0;
+}
+
+int bin3d_init(Bin3D *bin, const char *name, float x, float y, float z,
+               float width, float depth, float height, float max_weight) {
+    memset(bin, 0, sizeof(*bin));
+    strncpy(bin->name, name, sizeof(bin->name) - 1);
+    bin->x = x;
+    bin->y = y;
+    bin->z = z;
+    bin->width = width;
+    bin->depth = depth;
+    bin->height = height;
+    bin->max_weight = max_weight;
+
+    Space3D whole = {
+        .x = x, .y = y, .z = z,
+        .width = width, .depth = depth, .height = height,
+        .is_free = 1
+    };
+    return bin3d_add_space(bin, &whole);
+}
+
+void bin3d_free(Bin3D *bin) {
+    if (!bin) return;
+    free(bin->spaces.x);
+    memset(&bin->spaces, 0, sizeof(bin->spaces));
+}
+
+void bin3d_get_space(const Bin3D *bin, int space_idx, Space3D *out) {
+    const SpaceStore *st = &bin->spaces;
+    out->x = st->x[space_idx];
+    out->y = st->y[space_idx];
+    out->z = st->z[space_idx];
+    out->width = st->width[space_idx];
+    out->depth = st->depth[space_idx];
+    out->height = st->height[space_idx];
+    out->is_free = 1;
+}
+
+void bin3d_remove_space(Bin3D *bin, int space_idx) {
+    SpaceStore *st = &bin->spaces;
+    if (space_idx < 0 || space_idx >= st->count) return;
+
+    int last = --st->count;
+    st->x[space_idx] = st->x[last];
+    st->y[space_idx] = st->y[last];
+    st->z[space_idx] = st->z[last];
+    st->width[space_idx] = st->width[last];
+    st->depth[space_idx] = st->depth[last];
+    st->height[space_idx] = st->height[last];
+    st->volume[space_idx] = st->volume[last];
+}
+
+int bin3d_add_space(Bin3D *bin, const Space3D *space) {
+    SpaceStore *st = &bin->spaces;
+    Space3D merged = *space;
+    merged.is_free = 1;
+
+    /* Absorb neighbours until no more merges apply: each merge can expose a
+     * new shared face with another space. */
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int s = 0; s < st->count; s++) {
+            Space3D other;
+            bin3d_get_space(bin, s, &other);
+            if (try_merge(&merged, &other)) {
+                bin3d_remove_space(bin, s);
+                changed = 1;
+                break;
+            }
+        }
+    }
+
+    return space_store_push(st, &merged);
+}
+
+/**
+ * RejectLog - Rejections of one parallel chunk in scan order, with each
+ * candidate's volume. A chunk starts without the serial scan's running
+ * best, so it rejects spaces the serial scan never reaches; the fold
+ * keeps only those below the best of the chunks before it.
+ */
+typedef struct {
+    int count;
+    float volume[PLACEMENT_CHUNK_SPACES];
+    unsigned char code[PLACEMENT_CHUNK_SPACES];
+} RejectLog;
+
+/**
+ * Consider free space s as a candidate: if it beats the current best volume
+ * and passes the cargo constraints, it becomes the new best. A rejection
+ * is counted in reject[code] when reject is non-NULL, and appended to log
+ * when log is non-NULL.
+ */
+static void consider_space(const Ship *ship, const Bin3D *bin, int s,
+                           const Cargo *cargo, const OrientDims *od, int *reject,
+                           RejectLog *log, float *best_vol, int *best_space,
+                           int *best_orientation) {
+    const SpaceStore *st = &bin->spaces;
+    if (!(st->volume[s] < *best_vol)) return;
+
+    int o = first_fitting_orientation(st, s, od);
+    if (o < 0) return;
+
+    if (ship) {
+        Space3D space;
+        bin3d_get_space(bin, s, &space);
+        DiagCode why = constraint_check(ship, cargo, bin, &space);
+        if (why != DIAG_OK) {
+            if (reject) reject[why]++;
+            if (log) {
+                log->volume[log->count] = st->volume[s];
+                log->code[log->count++] = (unsigned char)why;
+            }
+            return;  // Constraint violation, skip this placement
+        }
+    }
+
+    *best_vol = st->volume[s];
+    *best_space = s;
+    *best_orientation = o;
+}
+
+/**
+ * Tightest fit among free spaces [s0, s1) of one bin: the first space (in
+ * store order) of minimum volume below *best_vol that fits in some
+ * orientation and passes the constraints. Fit tests run FIT_LANES spaces
+ * at a time; only lanes that fit reach the (much more expensive)
+ * constraint checks.
+ */
+static void scan_range(const Ship *ship, const Bin3D *bin, int s0, int s1,
+                       const Cargo *cargo, const OrientDims *od, int *reject,
+                       RejectLog *log, float *best_vol, int *best_space,
+                       int *best_orientation) {
+    const SpaceStore *st = &bin->spaces;
+    int s = s0;
+
+#if FIT_LANES > 1
+    for (; s + FIT_LANES <= s1; s += FIT_LANES) {
+        int mask = fit_mask_block(st, s, od, *best_vol);
+        while (mask) {
+            int lane = 0;
+            while (!(mask & (1 << lane))) lane++;
+            mask &= ~(1 << lane);
+            consider_space(ship, bin, s + lane, cargo, od, reject, log,
+                           best_vol, best_space, best_orientation);
+        }
+    }
+#endif
+
+    for (; s < s1; s++)
+        consider_space(ship, bin, s, cargo, od, reject, log,
+                       best_vol, best_space, best_orientation);
+}
+
+/* find_best_fit_3d(), tallying rejected candidates in reject (may be NULL) */
+static int best_fit_serial(const Ship *ship, Bin3D *bins, int bin_count,
+                           const Cargo *cargo, int *reject, int *best_bin,
+                           int *best_space, int *best_orientation) {
     *best_bin = -1;
     *best_space = -1;
     *best_orientation = -1;
     float best_fit_volume = 1e9f;  // Find tightest fit (minimize wasted space)
 
+    OrientDims od;
+    orient_dims_init(&od, cargo);
+
     for (int b = 0; b < bin_count; b++) {
         Bin3D *bin = &bins[b];
 
@@ -66,28 +391,127 @@ int find_best_fit_3d(const Ship *ship, Bin3D *bins, int bin_count,
             continue;
         }
 
-        for (int s = 0; s < bin->space_count; s++) {
-            Space3D *space = &bin->spaces[s];
-            if (!space->is_free) continue;
+        // Prefer smaller spaces (tighter fit = less waste); strict improvement
+        // keeps the earliest bin on ties
+        int space = -1, orientation = -1;
+        scan_range(ship, bin, 0, bin->spaces.count, cargo, &od, reject, NULL,
+                   &best_fit_volume, &space, &orientation);
+        if (space >= 0) {
+            *best_bin = b;
+            *best_space = space;
+            *best_orientation = orientation;
+        }
+    }
 
-            // Check cargo-specific constraints
-            if (ship && !check_cargo_constraints(ship, cargo, bin, space)) {
-                continue;  // Constraint violation, skip this placement
-            }
+    return (*best_bin != -1);
+}
+
+int find_best_fit_3d(const Ship *ship, Bin3D *bins, int bin_count,
+                     const Cargo *cargo, int *best_bin, int *best_space,
+                     int *best_orientation) {
+    return best_fit_serial(ship, bins, bin_count, cargo, NULL,
+                           best_bin, best_space, best_orientation);
+}
+
+/* ------------------------------------------------------------------ */
+/* PARALLEL SEARCH                                                    */
+/* ------------------------------------------------------------------ */
+
+/**
+ * FitChunk - One unit of parallel work: spaces [s0, s1) of one bin, and
+ * the best candidate found there.
+ */
+typedef struct {
+    int bin;
+    int s0, s1;
+    float volume;
+    int space;
+    int orientation;
+    RejectLog rejects;             /* filled when the caller tallies rejections */
+} FitChunk;
+
+typedef struct {
+    const Ship *ship;
+    const Bin3D *bins;
+    const Cargo *cargo;
+    const OrientDims *od;
+    FitChunk *chunks;
+    int log_rejects;
+} FitJob;
+
+static void fit_chunk_task(void *ctx, int index) {
+    FitJob *job = ctx;
+    FitChunk *ch = &job->chunks[index];
+
+    ch->volume = 1e9f;
+    ch->space = -1;
+    ch->orientation = -1;
+    ch->rejects.count = 0;
+    scan_range(job->ship, &job->bins[ch->bin], ch->s0, ch->s1, job->cargo, job->od, NULL,
+               job->log_rejects ? &ch->rejects : NULL,
+               &ch->volume, &ch->space, &ch->orientation);
+}
 
-            // Try all 6 orientations
-            for (int o = 0; o < 6; o++) {
-                if (fits_in_space(space, cargo, o)) {
-                    float vol = space_volume(space);
-                    // Prefer smaller spaces (tighter fit = less waste)
-                    if (vol < best_fit_volume) {
-                        best_fit_volume = vol;
-                        *best_bin = b;
-                        *best_space = s;
-                        *best_orientation = o;
-                    }
-                }
+/**
+ * Threaded find_best_fit_3d(). Each chunk finds its own first minimum;
+ * folding the chunks in (bin, space) order with a strict comparison picks
+ * the same space the serial scan would, whatever order chunks finish in.
+ * The fold also counts a chunk's rejections only when they are below the
+ * best so far, so reject matches the serial tally too.
+ * chunks/chunk_cap is scratch storage reused across items.
+ */
+static int find_best_fit_parallel(ThreadPool *pool, FitChunk **chunks, int *chunk_cap,
+                                  const Ship *ship, Bin3D *bins, int bin_count,
+                                  const Cargo *cargo, int *reject, int *best_bin,
+                                  int *best_space, int *best_orientation) {
+    int n = 0;
+    for (int b = 0; b < bin_count; b++) {
+        if (bins[b].current_weight + cargo->weight > bins[b].max_weight) continue;
+
+        for (int s0 = 0; s0 < bins[b].spaces.count; s0 += PLACEMENT_CHUNK_SPACES) {
+            if (n >= *chunk_cap) {
+                int new_cap = (*chunk_cap > 0) ? *chunk_cap * 2 : 16;
+                FitChunk *grown = realloc(*chunks, (size_t)new_cap * sizeof(FitChunk));
+                if (!grown)
+                    return best_fit_serial(ship, bins, bin_count, cargo, reject,
+                                           best_bin, best_space, best_orientation);
+                *chunks = grown;
+                *chunk_cap = new_cap;
             }
+            int s1 = s0 + PLACEMENT_CHUNK_SPACES;
+            if (s1 > bins[b].spaces.count) s1 = bins[b].spaces.count;
+            (*chunks)[n].bin = b;
+            (*chunks)[n].s0 = s0;
+            (*chunks)[n].s1 = s1;
+            n++;
+        }
+    }
+
+    // Not enough candidates to be worth waking the workers
+    if (n < 2)
+        return best_fit_serial(ship, bins, bin_count, cargo, reject,
+                               best_bin, best_space, best_orientation);
+
+    OrientDims od;
+    orient_dims_init(&od, cargo);
+
+    FitJob job = { ship, bins, cargo, &od, *chunks, reject != NULL };
+    thread_pool_parallel_for(pool, n, fit_chunk_task, &job);
+
+    *best_bin = -1;
+    *best_space = -1;
+    *best_orientation = -1;
+    float best_fit_volume = 1e9f;
+    for (int k = 0; k < n; k++) {
+        const FitChunk *ch = &(*chunks)[k];
+        if (reject)
+            for (int j = 0; j < ch->rejects.count; j++)
+                if (ch->rejects.volume[j] < best_fit_volume) reject[ch->rejects.code[j]]++;
+        if (ch->space >= 0 && ch->volume < best_fit_volume) {
+            best_fit_volume = ch->volume;
+            *best_bin = ch->bin;
+            *best_space = ch->space;
+            *best_orientation = ch->orientation;
         }
     }
 
@@ -95,163 +519,620 @@ int find_best_fit_3d(const Ship *ship, Bin3D *bins, int bin_count,
 }
 
 void split_space_3d(Bin3D *bin, int space_idx, const Cargo *cargo, int orientation) {
-    if (bin->space_count >= MAX_FREE_RECTS - 3) {
-        fprintf(stderr, "Warning: Max free rects reached in bin %s\n", bin->name);
-        return;
-    }
-
-    Space3D *original = &bin->spaces[space_idx];
+    Space3D original;
+    bin3d_get_space(bin, space_idx, &original);
     float cargo_w, cargo_d, cargo_h;
     get_orientation_dims(cargo, orientation, &cargo_w, &cargo_d, &cargo_h);
 
-    // Mark original space as occupied
-    original->is_free = 0;
+    // The consumed space leaves the free list
+    bin3d_remove_space(bin, space_idx);
 
     // Guillotine split: create up to 3 new spaces
     // Right remainder (along width)
-    if (original->width > cargo_w) {
+    if (original.width > cargo_w) {
         Space3D right = {
-            .x = original->x + cargo_w,
-            .y = original->y,
-            .z = original->z,
-            .width = original->width - cargo_w,
-            .depth = original->depth,
-            .height = original->height,
+            .x = original.x + cargo_w,
+            .y = original.y,
+            .z = original.z,
+            .width = original.width - cargo_w,
+            .depth = original.depth,
+            .height = original.height,
             .is_free = 1
         };
-        bin->spaces[bin->space_count++] = right;
+        if (bin3d_add_space(bin, &right) != 0)
+            fprintf(stderr, "Warning: Out of memory splitting space in bin %s\n", bin->name);
     }
 
     // Back remainder (along depth)
-    if (original->depth > cargo_d) {
+    if (original.depth > cargo_d) {
         Space3D back = {
-            .x = original->x,
-            .y = original->y + cargo_d,
-            .z = original->z,
+            .x = original.x,
+            .y = original.y + cargo_d,
+            .z = original.z,
             .width = cargo_w,  // Only the width of placed cargo
-            .depth = original->depth - cargo_d,
-            .height = original->height,
+            .depth = original.depth - cargo_d,
+            .height = original.height,
             .is_free = 1
         };
-        bin->spaces[bin->space_count++] = back;
+        if (bin3d_add_space(bin, &back) != 0)
+            fprintf(stderr, "Warning: Out of memory splitting space in bin %s\n", bin->name);
     }
 
     // Top remainder (along height)
-    if (original->height > cargo_h) {
+    if (original.height > cargo_h) {
         Space3D top = {
-            .x = original->x,
-            .y = original->y,
-            .z = original->z + cargo_h,
+            .x = original.x,
+            .y = original.y,
+            .z = original.z + cargo_h,
             .width = cargo_w,  // Only the width of placed cargo
             .depth = cargo_d,  // Only the depth of placed cargo
-            .height = original->height - cargo_h,
+            .height = original.height - cargo_h,
             .is_free = 1
         };
-        bin->spaces[bin->space_count++] = top;
+        if (bin3d_add_space(bin, &top) != 0)
+            fprintf(stderr, "Warning: Out of memory splitting space in bin %s\n", bin->name);
     }
 }
 
-void place_cargo_3d(Ship *ship) {
-    // Sort cargo by volume (largest first - FFD heuristic)
-    qsort(ship->cargo, ship->cargo_count, sizeof(Cargo), cargo_cmp_by_volume_desc);
-
-    // Define realistic bins for a typical cargo ship
-    // Using ship dimensions to create proportional holds
-    Bin3D bins[3];
-    int bin_count = 3;
-
-    // Forward hold (30% of length)
-    bins[0] = (Bin3D){
-        .name = "ForwardHold",
-        .x = 0.0f, .y = 0.0f, .z = -8.0f,  // Below waterline
-        .width = ship->length * 0.3f,
-        .depth = ship->width * 0.8f,  // Leave space for side tanks
-        .height = 8.0f,  // Typical hold height
-        .max_weight = ship->max_weight * 0.3f,
-        .current_weight = 0.0f,
-        .space_count = 1
-    };
-    bins[0].spaces[0] = (Space3D){
-        .x = 0.0f, .y = 0.0f, .z = -8.0f,
-        .width = bins[0].width,
-        .depth = bins[0].depth,
-        .height = bins[0].height,
-        .is_free = 1
-    };
+/* ------------------------------------------------------------------ */
+/* EXTREME POINTS                                                     */
+/* ------------------------------------------------------------------ */
 
-    // Aft hold (30% of length)
-    bins[1] = (Bin3D){
-        .name = "AftHold",
-        .x = ship->length * 0.7f, .y = 0.0f, .z = -8.0f,
-        .width = ship->length * 0.3f,
-        .depth = ship->width * 0.8f,
-        .height = 8.0f,
-        .max_weight = ship->max_weight * 0.3f,
-        .current_weight = 0.0f,
-        .space_count = 1
-    };
-    bins[1].spaces[0] = (Space3D){
-        .x = ship->length * 0.7f, .y = 0.0f, .z = -8.0f,
-        .width = bins[1].width,
-        .depth = bins[1].depth,
-        .height = bins[1].height,
-        .is_free = 1
-    };
+/*
+ * Every residual space is kept empty with a supported floor (the bin
+ * floor or the top of placed cargo), so the fit test alone decides
+ * whether an item can go at a point. The new points' spaces are cut from
+ * the used point's: the right and back ones keep its full height and
+ * overlap each other, the top one covers only the placed box.
+ */
 
-    // Deck (full length, lower weight capacity)
-    bins[2] = (Bin3D){
-        .name = "Deck",
-        .x = 0.0f, .y = 0.0f, .z = 0.0f,  // At waterline
-        .width = ship->length,
-        .depth = ship->width,
-        .height = 4.0f,  // Lower stacking on deck
-        .max_weight = ship->max_weight * 0.4f,
-        .current_weight = 0.0f,
-        .space_count = 1
-    };
-    bins[2].spaces[0] = (Space3D){
-        .x = 0.0f, .y = 0.0f, .z = 0.0f,
-        .width = bins[2].width,
-        .depth = bins[2].depth,
-        .height = bins[2].height,
-        .is_free = 1
+/* Room for some item on every axis */
+static int point_usable(const Space3D *sp, float min_extent) {
+    float least = min_extent > MERGE_EPSILON ? min_extent - MERGE_EPSILON : MERGE_EPSILON;
+    return sp->width >= least && sp->depth >= least && sp->height >= least;
+}
+
+int extreme_point_commit(Bin3D *bin, int point_idx, float w, float d, float h,
+                         float min_extent) {
+    SpaceStore *st = &bin->spaces;
+    Space3D used;
+    bin3d_get_space(bin, point_idx, &used);
+    bin3d_remove_space(bin, point_idx);
+
+    float x1 = used.x + w, y1 = used.y + d, z1 = used.z + h;
+    Space3D fresh[3] = {
+        { x1, used.y, used.z, used.width - w, used.depth, used.height, 1 },
+        { used.x, y1, used.z, used.width, used.depth - d, used.height, 1 },
+        { used.x, used.y, z1, w, d, used.height - h, 1 },
     };
+    int keep[3];
+    for (int k = 0; k < 3; k++) keep[k] = point_usable(&fresh[k], min_extent);
 
-    // Place each cargo item
-    int placed_count = 0;
+    for (int s = 0; s < st->count; s++) {
+        float px = st->x[s], py = st->y[s], pz = st->z[s];
+
+        // Cut back any residual space the box now occupies part of
+        if (px < x1 - MERGE_EPSILON && px + st->width[s] > used.x + MERGE_EPSILON &&
+            py < y1 - MERGE_EPSILON && py + st->depth[s] > used.y + MERGE_EPSILON &&
+            pz < z1 - MERGE_EPSILON && pz + st->height[s] > used.z + MERGE_EPSILON) {
+            float keep_w = used.x - px, keep_d = used.y - py, keep_h = used.z - pz;
+            float vx = keep_w > MERGE_EPSILON ? keep_w * st->depth[s] * st->height[s] : 0.0f;
+            float vy = keep_d > MERGE_EPSILON ? st->width[s] * keep_d * st->height[s] : 0.0f;
+            float vz = keep_h > MERGE_EPSILON ? st->width[s] * st->depth[s] * keep_h : 0.0f;
+
+            // No axis left (the point is inside the box): the point goes
+            if (vx <= 0.0f && vy <= 0.0f && vz <= 0.0f) {
+                bin3d_remove_space(bin, s--);
+                continue;
+            }
+            if (vx >= vy && vx >= vz)  { st->width[s] = keep_w;  st->volume[s] = vx; }
+            else if (vy >= vz)         { st->depth[s] = keep_d;  st->volume[s] = vy; }
+            else                       { st->height[s] = keep_h; st->volume[s] = vz; }
+
+            Space3D cut;
+            bin3d_get_space(bin, s, &cut);
+            if (!point_usable(&cut, min_extent)) {
+                bin3d_remove_space(bin, s--);
+                continue;
+            }
+        }
+
+        // One entry per point: the one with more room stays
+        for (int k = 0; k < 3; k++) {
+            if (!keep[k] || !same_coord(px, fresh[k].x) || !same_coord(py, fresh[k].y) ||
+                !same_coord(pz, fresh[k].z))
+                continue;
+            float v = fresh[k].width * fresh[k].depth * fresh[k].height;
+            if (st->volume[s] >= v) {
+                keep[k] = 0;
+            } else {
+                bin3d_remove_space(bin, s--);
+                break;
+            }
+        }
+    }
+
+    int rc = 0;
+    for (int k = 0; k < 3; k++)
+        if (keep[k] && space_store_push(st, &fresh[k]) != 0) rc = -1;
+    return rc;
+}
+
+/* Smallest dimension of any item, below which a residual space is no use */
+static float smallest_extent(const Ship *ship) {
+    float least = 0.0f;
     for (int i = 0; i < ship->cargo_count; i++) {
-        Cargo *c = &ship->cargo[i];
-        int best_bin, best_space, best_orientation;
+        const float *dim = ship->cargo[i].dimensions;
+        float m = fminf(dim[0], fminf(dim[1], dim[2]));
+        if (i == 0 || m < least) least = m;
+    }
+    return least > 0.0f ? least : 0.0f;
+}
+
+/**
+ * Build the placement bins from ship->holds, or from the legacy layout
+ * when the config defines none. Returns NULL on allocation failure.
+ */
+static Bin3D *create_bins(const Ship *ship, int *bin_count) {
+    HoldConfig legacy = {0};
+    const HoldConfig *holds = ship->holds;
+    if (!holds || holds->count == 0) {
+        if (hold_config_legacy(&legacy, ship->length, ship->width, ship->max_weight) != 0) {
+            hold_config_free(&legacy);
+            return NULL;
+        }
+        holds = &legacy;
+    }
 
-        if (find_best_fit_3d(ship, bins, bin_count, c, &best_bin, &best_space, &best_orientation)) {
-            Bin3D *bin = &bins[best_bin];
-            Space3D *space = &bin->spaces[best_space];
+    Bin3D *bins = calloc((size_t)holds->count, sizeof(Bin3D));
+    int rc = bins ? 0 : -1;
+    for (int b = 0; rc == 0 && b < holds->count; b++) {
+        const HoldDef *h = &holds->holds[b];
+        rc = bin3d_init(&bins[b], h->name, h->x, h->y, h->z,
+                        h->length, h->width, h->height, h->max_weight);
+        bins[b].flags = h->flags;
+    }
 
-            // Set cargo position
-            c->pos_x = space->x;
-            c->pos_y = space->y;
-            c->pos_z = space->z;
+    if (rc != 0 && bins) {
+        for (int b = 0; b < holds->count; b++) bin3d_free(&bins[b]);
+        free(bins);
+        bins = NULL;
+    }
 
-            // Update bin weight
-            bin->current_weight += c->weight;
+    *bin_count = bins ? holds->count : 0;
+    hold_config_free(&legacy);
+    return bins;
+}
 
-            // Split the space
-            split_space_3d(bin, best_space, c, best_orientation);
+void placement_options_init(PlacementOptions *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->threads = 1;
+}
 
-            placed_count++;
+/**
+ * PlaceRun - Per-run placement context shared by full runs and edits of a
+ * kept plan: bins, the placed-cargo index, the worker pool and scratch.
+ */
+typedef struct {
+    Ship *ship;
+    Bin3D *bins;
+    int bin_count;
+    ThreadPool *pool;
+    ThreadPool *owned_pool;
+    FitChunk *chunks;
+    int chunk_cap;
+    DiagLog *diag;
+    PlacementStats *stats;
+    int engine;                  // PlacementEngine of the bins
+    float min_extent;            // extreme points: thinnest useful residual
+} PlaceRun;
+
+static void place_run_begin(PlaceRun *run, Ship *ship, Bin3D *bins, int bin_count,
+                            int engine, const PlacementOptions *opts) {
+    memset(run, 0, sizeof(*run));
+    run->ship = ship;
+    run->bins = bins;
+    run->bin_count = bin_count;
+    run->diag = opts->diag;
+    run->stats = opts->stats;
+    run->engine = engine;
+    if (engine == PLACER_EXTREME_POINTS) run->min_extent = smallest_extent(ship);
+
+    // Index committed placements so constraint checks stay local
+    ship->placed_index = spatial_index_create(ship->length, ship->width, SPATIAL_CELL_SIZE);
+    if (!ship->placed_index)
+        fprintf(stderr, "Warning: No memory for placement index, using linear scans\n");
+    ship->stack_grid = stack_grid_create(ship->length, ship->width, STACK_CELL_SIZE);
+    if (!ship->stack_grid)
+        fprintf(stderr, "Warning: No memory for stack weight grid, using the placement index\n");
+
+    // Worker pool for the best-fit search (caller's, or one for this run)
+    run->pool = opts->pool;
+    if (!run->pool && opts->threads != 1) {
+        run->owned_pool = thread_pool_create(opts->threads);
+        if (!run->owned_pool)
+            fprintf(stderr, "Warning: Could not start placement threads, searching serially\n");
+        run->pool = run->owned_pool;
+    }
+}
+
+static void place_run_index(PlaceRun *run, int i) {
+    Ship *ship = run->ship;
+    if (ship->placed_index &&
+        spatial_index_insert(ship->placed_index, &ship->cargo[i], i) != 0) {
+        fprintf(stderr, "Warning: No memory for placement index, using linear scans\n");
+        spatial_index_destroy(ship->placed_index);
+        ship->placed_index = NULL;
+    }
+    if (ship->stack_grid && stack_grid_insert(ship->stack_grid, &ship->cargo[i]) != 0) {
+        fprintf(stderr, "Warning: No memory for stack weight grid, using the placement index\n");
+        stack_grid_destroy(ship->stack_grid);
+        ship->stack_grid = NULL;
+    }
+}
+
+/* The CLI's stderr lines for one item, from its diagnostics tally */
+static void report_item(const Cargo *c, const Bin3D *bin, const Space3D *space,
+                        const int counts[DIAG_CODE_COUNT]) {
+    int rejected = 0;
+    for (int k = DIAG_POINT_LOAD; k <= DIAG_DECK_WEIGHT; k++) rejected += counts[k];
+    if (rejected > 0) {
+        char reasons[256];
+        size_t len = 0;
+        reasons[0] = '\0';
+        for (int k = DIAG_POINT_LOAD; k <= DIAG_DECK_WEIGHT; k++) {
+            if (!counts[k] || len >= sizeof(reasons)) continue;
+            len += (size_t)snprintf(reasons + len, sizeof(reasons) - len, "%s%s %d",
+                                    len ? ", " : "", diag_code_name(k), counts[k]);
+        }
+        fprintf(stderr, "Constraint: %s: %d candidate space%s rejected (%s)\n",
+                CARGO_ID(c), rejected, rejected == 1 ? "" : "s", reasons);
+    }
+
+    if (counts[DIAG_UNPLACED])
+        fprintf(stderr, "Warning: Could not place cargo %s (%.1f x %.1f x %.1f m, %.1f kg)\n",
+                CARGO_ID(c), c->dimensions[0], c->dimensions[1], c->dimensions[2], c->weight);
+    if (counts[DIAG_REEFER_PLACEMENT])
+        fprintf(stderr, "Note: Reefer %s placed in %s (deck preferred)\n", CARGO_ID(c), bin->name);
+    if (counts[DIAG_FRAGILE_PLACEMENT])
+        fprintf(stderr, "Note: Fragile %s placed deep in hold (z=%.1f)\n", CARGO_ID(c), space->z);
+}
+
+/* Free spaces the search for c will scan: both paths skip the same bins */
+static long long spaces_to_scan(const PlaceRun *run, const Cargo *c) {
+    long long n = 0;
+    for (int b = 0; b < run->bin_count; b++)
+        if (run->bins[b].current_weight + c->weight <= run->bins[b].max_weight)
+            n += run->bins[b].spaces.count;
+    return n;
+}
+
+/**
+ * Place ship->cargo[i] at its best fit, or mark it unplaced.
+ * Returns 1 if placed. slot (optional) records the bin and orientation.
+ * Rejections are tallied while someone is listening (a diagnostics log,
+ * run statistics, or stderr when the ship is not quiet) and reported
+ * once per item.
+ */
+static int place_run_item(PlaceRun *run, int i, PlacementSlot *slot) {
+    Ship *ship = run->ship;
+    Cargo *c = &ship->cargo[i];
+    int best_bin, best_space, best_orientation;
+    int counts[DIAG_CODE_COUNT] = {0};
+    int *reject = (run->diag || run->stats || !ship->quiet) ? counts : NULL;
+    if (run->stats) run->stats->spaces_scanned += spaces_to_scan(run, c);
+
+    int found = run->pool
+        ? find_best_fit_parallel(run->pool, &run->chunks, &run->chunk_cap, ship,
+                                 run->bins, run->bin_count, c, reject,
+                                 &best_bin, &best_space, &best_orientation)
+        : best_fit_serial(ship, run->bins, run->bin_count, c, reject,
+                          &best_bin, &best_space, &best_orientation);
+
+    Bin3D *bin = NULL;
+    Space3D space = {0};
+    if (!found) {
+        CARGO_UNPLACE(c);
+        if (slot) slot->bin = slot->orientation = -1;
+        counts[DIAG_UNPLACED] = 1;
+    } else {
+        bin = &run->bins[best_bin];
+        bin3d_get_space(bin, best_space, &space);
+
+        CARGO_PLACE(c, space.x, space.y, space.z);
+
+        // Update bin weight
+        bin->current_weight += c->weight;
+
+        // Split the space, or move the extreme points past the new item
+        if (run->engine == PLACER_EXTREME_POINTS) {
+            float w, d, h;
+            get_orientation_dims(c, best_orientation, &w, &d, &h);
+            if (extreme_point_commit(bin, best_space, w, d, h, run->min_extent) != 0)
+                fprintf(stderr, "Warning: Out of memory adding extreme points in bin %s\n",
+                        bin->name);
         } else {
-            fprintf(stderr, "Warning: Could not place cargo %s (%.1f x %.1f x %.1f m, %.1f kg)\n",
-                    c->id, c->dimensions[0], c->dimensions[1], c->dimensions[2], c->weight);
-            // Mark as unplaced
-            c->pos_x = c->pos_y = c->pos_z = -1.0f;
+            split_space_3d(bin, best_space, c, best_orientation);
+        }
+
+        place_run_index(run, i);
+        if (slot) {
+            slot->bin = best_bin;
+            slot->orientation = best_orientation;
         }
+        if (reject) constraint_notes(c, bin, &space, counts);
+    }
+
+    if (run->diag) diag_log_record(run->diag, i, CARGO_ID(c), counts);
+    if (run->stats) {
+        run->stats->items++;
+        for (int k = 0; k < DIAG_CODE_COUNT; k++) run->stats->counts[k] += counts[k];
     }
+    if (!ship->quiet) report_item(c, bin, &space, counts);
+    return found;
+}
+
+static void place_run_end(PlaceRun *run) {
+    free(run->chunks);
+    thread_pool_destroy(run->owned_pool);
+    spatial_index_destroy(run->ship->placed_index);
+    run->ship->placed_index = NULL;
+    stack_grid_destroy(run->ship->stack_grid);
+    run->ship->stack_grid = NULL;
+}
+
+void placement_state_init(PlacementState *state) {
+    memset(state, 0, sizeof(*state));
+}
+
+void placement_state_free(PlacementState *state) {
+    if (!state) return;
+    for (int b = 0; b < state->bin_count; b++)
+        bin3d_free(&state->bins[b]);
+    free(state->bins);
+    free(state->slots);
+    placement_state_init(state);
+}
+
+// Grow the slot array to one entry per cargo item; new entries are unplaced
+static int state_sync_slots(PlacementState *state, int cargo_count) {
+    if (cargo_count > state->slot_capacity) {
+        int cap = state->slot_capacity > 0 ? state->slot_capacity : 16;
+        while (cap < cargo_count) cap *= 2;
+        PlacementSlot *grown = realloc(state->slots, (size_t)cap * sizeof(PlacementSlot));
+        if (!grown) return -1;
+        state->slots = grown;
+        state->slot_capacity = cap;
+    }
+    for (int i = state->slot_count; i < cargo_count; i++)
+        state->slots[i].bin = state->slots[i].orientation = -1;
+    state->slot_count = cargo_count;
+    return 0;
+}
+
+int placement_state_place(PlacementState *state, Ship *ship, const int *items,
+                          int n, const PlacementOptions *opts) {
+    PlacementOptions defaults;
+    if (!opts) {
+        placement_options_init(&defaults);
+        opts = &defaults;
+    }
+    if (state_sync_slots(state, ship->cargo_count) != 0) return -1;
+
+    PlaceRun run;
+    place_run_begin(&run, ship, state->bins, state->bin_count, state->engine, opts);
+    for (int i = 0; i < ship->cargo_count; i++)
+        if (state->slots[i].bin >= 0) place_run_index(&run, i);
+
+    int placed = 0;
+    for (int k = 0; k < n; k++)
+        placed += place_run_item(&run, items[k], &state->slots[items[k]]);
+
+    place_run_end(&run);
+    return placed;
+}
+
+static void slot_dims(const PlacementState *state, const Ship *ship, int idx,
+                      float *w, float *d, float *h) {
+    get_orientation_dims(&ship->cargo[idx], state->slots[idx].orientation, w, d, h);
+}
+
+int placement_state_dependents(const PlacementState *state, const Ship *ship,
+                               int idx, int *out) {
+    if (idx < 0 || idx >= state->slot_count || state->slots[idx].bin < 0) return 0;
+
+    // Breadth-first over "rests on": out[] doubles as the queue
+    int n = 0;
+    out[n++] = idx;
+    for (int q = 0; q < n; q++) {
+        const Cargo *below = &ship->cargo[out[q]];
+        float bw, bd, bh;
+        slot_dims(state, ship, out[q], &bw, &bd, &bh);
+        float top = below->pos_z + bh;
+
+        for (int j = 0; j < state->slot_count; j++) {
+            if (state->slots[j].bin != state->slots[out[q]].bin) continue;
+            const Cargo *c = &ship->cargo[j];
+            if (fabsf(c->pos_z - top) > 1e-3f) continue;
+
+            float w, d, h;
+            slot_dims(state, ship, j, &w, &d, &h);
+            if (c->pos_x >= below->pos_x + bw || c->pos_x + w <= below->pos_x ||
+                c->pos_y >= below->pos_y + bd || c->pos_y + d <= below->pos_y)
+                continue;
+
+            int seen = 0;
+            for (int k = 0; k < n && !seen; k++) seen = (out[k] == j);
+            if (!seen) out[n++] = j;
+        }
+    }
+    return n;
+}
+
+/* Overlap of [a0, a0 + al) and [b0, b0 + bl), 0 if they only touch */
+static float span_overlap(float a0, float al, float b0, float bl) {
+    float lo = fmaxf(a0, b0), hi = fminf(a0 + al, b0 + bl);
+    return hi - lo > MERGE_EPSILON ? hi - lo : 0.0f;
+}
+
+/* Whether sp's whole floor is the bin floor or the tops of items still
+ * placed in bin b (skip excluded) */
+static int floor_supported(const PlacementState *state, const Ship *ship, int b,
+                           int skip, const Space3D *sp) {
+    if (sp->z <= state->bins[b].z + MERGE_EPSILON) return 1;
+    float area = 0.0f;
+    for (int j = 0; j < state->slot_count; j++) {
+        if (j == skip || state->slots[j].bin != b) continue;
+        const Cargo *o = &ship->cargo[j];
+        float w, d, h;
+        slot_dims(state, ship, j, &w, &d, &h);
+        if (same_coord(o->pos_z + h, sp->z))
+            area += span_overlap(sp->x, sp->width, o->pos_x, w) *
+                    span_overlap(sp->y, sp->depth, o->pos_y, d);
+    }
+    return area >= sp->width * sp->depth * (1.0f - 1e-4f);
+}
+
+/* Same footprint, and b starts where a ends vertically */
+static int stacks_on(const Space3D *a, float bx, float by, float bz, float bw, float bd) {
+    return same_coord(a->x, bx) && same_coord(a->width, bw) && same_coord(a->y, by) &&
+           same_coord(a->depth, bd) && same_coord(a->z + a->height, bz);
+}
+
+/* Give a freed box back to an extreme-point bin. A point standing on the
+ * box joins it when it has the same footprint and otherwise loses its
+ * floor. The result is kept while its floor holds, or stacked onto the
+ * space left by the item it stood on. */
+static int extreme_point_release(PlacementState *state, const Ship *ship, int idx,
+                                 const Space3D *box) {
+    int b = state->slots[idx].bin;
+    Bin3D *bin = &state->bins[b];
+    SpaceStore *st = &bin->spaces;
+    Space3D freed = *box;
+    for (int s = 0; s < st->count; s++) {
+        if (!same_coord(st->z[s], box->z + box->height) ||
+            span_overlap(st->x[s], st->width[s], box->x, box->width) <= 0.0f ||
+            span_overlap(st->y[s], st->depth[s], box->y, box->depth) <= 0.0f)
+            continue;
+        if (stacks_on(box, st->x[s], st->y[s], st->z[s], st->width[s], st->depth[s]) &&
+            same_coord(freed.height, box->height))
+            freed.height += st->height[s];
+        bin3d_remove_space(bin, s--);
+    }
+
+    if (floor_supported(state, ship, b, idx, &freed))
+        return bin3d_add_space(bin, &freed) != 0 ? -1 : 0;
+
+    for (int s = 0; s < st->count; s++) {
+        Space3D below;
+        bin3d_get_space(bin, s, &below);
+        if (stacks_on(&below, freed.x, freed.y, freed.z, freed.width, freed.depth)) {
+            st->height[s] += freed.height;
+            st->volume[s] = st->width[s] * st->depth[s] * st->height[s];
+            break;
+        }
+    }
+    return 0;
+}
+
+int placement_state_release(PlacementState *state, Ship *ship, int idx) {
+    if (idx < 0 || idx >= state->slot_count || state->slots[idx].bin < 0) return 0;
+
+    Cargo *c = &ship->cargo[idx];
+    Bin3D *bin = &state->bins[state->slots[idx].bin];
+    Space3D space = { c->pos_x, c->pos_y, c->pos_z, 0.0f, 0.0f, 0.0f, 1 };
+    slot_dims(state, ship, idx, &space.width, &space.depth, &space.height);
+
+    int rc = state->engine == PLACER_EXTREME_POINTS
+        ? extreme_point_release(state, ship, idx, &space)
+        : bin3d_add_space(bin, &space);
+    if (rc != 0) return -1;
+
+    bin->current_weight -= c->weight;
+    if (bin->current_weight < 0.0f) bin->current_weight = 0.0f;
+    CARGO_UNPLACE(c);
+    state->slots[idx].bin = state->slots[idx].orientation = -1;
+    return 0;
+}
+
+void placement_state_erase(PlacementState *state, int idx) {
+    if (idx < 0 || idx >= state->slot_count) return;
+    memmove(&state->slots[idx], &state->slots[idx + 1],
+            (size_t)(state->slot_count - idx - 1) * sizeof(PlacementSlot));
+    state->slot_count--;
+}
+
+void place_cargo_3d(Ship *ship) {
+    place_cargo_3d_opts(ship, NULL);
+}
+
+void place_cargo_3d_opts(Ship *ship, const PlacementOptions *opts) {
+    PlacementOptions defaults;
+    if (!opts) {
+        placement_options_init(&defaults);
+        opts = &defaults;
+    }
+
+    // Sort cargo by volume (largest first - FFD heuristic)
+    if (!opts->presorted)
+        qsort(ship->cargo, ship->cargo_count, sizeof(Cargo), cargo_cmp_by_volume_desc);
+
+    // One bin per configured compartment (legacy 3-bin layout otherwise)
+    int bin_count = 0;
+    Bin3D *bins = create_bins(ship, &bin_count);
+    if (!bins) {
+        fprintf(stderr, "Error: Out of memory initialising cargo bins\n");
+        for (int i = 0; i < ship->cargo_count; i++)
+            CARGO_UNPLACE(&ship->cargo[i]);
+        if (opts->state) placement_state_free(opts->state);
+        return;
+    }
+
+    // Keep the bins for later edits when the caller asked for the state
+    PlacementState *state = opts->state;
+    if (state) {
+        placement_state_free(state);
+        if (state_sync_slots(state, ship->cargo_count) != 0) {
+            fprintf(stderr, "Warning: No memory to keep placement state\n");
+            placement_state_free(state);
+            state = NULL;
+        }
+    }
+
+    int engine = opts->engine == PLACER_EXTREME_POINTS ? PLACER_EXTREME_POINTS
+                                                        : PLACER_GUILLOTINE;
+    PlaceRun run;
+    place_run_begin(&run, ship, bins, bin_count, engine, opts);
+
+    // Place each cargo item, until the caller asks to stop
+    int placed_count = 0;
+    int i = 0;
+    for (; i < ship->cargo_count; i++) {
+        if (opts->should_stop && opts->should_stop(opts->stop_ctx)) break;
+        placed_count += place_run_item(&run, i, state ? &state->slots[i] : NULL);
+    }
+    for (int k = i; k < ship->cargo_count; k++)
+        CARGO_UNPLACE(&ship->cargo[k]);
+
+    place_run_end(&run);
 
     // Print placement summary
-    fprintf(stderr, "3D Placement complete: %d/%d items placed\n", placed_count, ship->cargo_count);
+    if (!ship->quiet)
+        fprintf(stderr, "3D Placement complete: %d/%d items placed\n", placed_count, ship->cargo_count);
     for (int b = 0; b < bin_count; b++) {
-        fprintf(stderr, "  %s: %.1f / %.1f kg (%.1f%% capacity)\n",
-                bins[b].name, bins[b].current_weight, bins[b].max_weight,
-                (bins[b].current_weight / bins[b].max_weight) * 100.0f);
+        if (!ship->quiet)
+            fprintf(stderr, "  %s: %.1f / %.1f kg (%.1f%% capacity)\n",
+                    bins[b].name, bins[b].current_weight, bins[b].max_weight,
+                    (bins[b].current_weight / bins[b].max_weight) * 100.0f);
+    }
+
+    if (state) {
+        state->bins = bins;
+        state->bin_count = bin_count;
+        state->engine = engine;
+        return;
     }
+    for (int b = 0; b < bin_count; b++)
+        bin3d_free(&bins[b]);
+    free(bins);
 }
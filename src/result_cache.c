@@ -0,0 +1,390 @@
+/*
+ * result_cache.c - LRU cache of serialized optimize results
+ *
+ * Entries sit in a chained hash table indexed by the key digest and on a
+ * doubly linked recency list; one mutex guards both. Keys are SHA-256
+ * digests of the normalized input text, so a hit is trusted without
+ * keeping the inputs around.
+ */
+
+#include "libcargoforge.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ------------------------------------------------------------------ */
+/* SHA-256 (FIPS 180-4)                                               */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    uint32_t h[8];
+    uint64_t total;          /* bytes hashed */
+    unsigned char block[64];
+    size_t fill;
+} Sha256;
+
+static const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_init(Sha256 *s) {
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(s->h, iv, sizeof(iv));
+    s->total = 0;
+    s->fill = 0;
+}
+
+static void sha256_block(Sha256 *s, const unsigned char *p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 |
+               (uint32_t)p[4 * i + 2] << 8 | (uint32_t)p[4 * i + 3];
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = s->h[0], b = s->h[1], c = s->h[2], d = s->h[3];
+    uint32_t e = s->h[4], f = s->h[5], g = s->h[6], h = s->h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) +
+                      ((e & f) ^ (~e & g)) + K256[i] + w[i];
+        uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) +
+                      ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    s->h[0] += a; s->h[1] += b; s->h[2] += c; s->h[3] += d;
+    s->h[4] += e; s->h[5] += f; s->h[6] += g; s->h[7] += h;
+}
+
+static void sha256_update(Sha256 *s, const void *data, size_t len) {
+    const unsigned char *p = data;
+    s->total += len;
+    if (s->fill) {
+        size_t take = 64 - s->fill < len ? 64 - s->fill : len;
+        memcpy(s->block + s->fill, p, take);
+        s->fill += take;
+        p += take;
+        len -= take;
+        if (s->fill < 64) return;
+        sha256_block(s, s->block);
+        s->fill = 0;
+    }
+    for (; len >= 64; p += 64, len -= 64)
+        sha256_block(s, p);
+    memcpy(s->block, p, len);
+    s->fill = len;
+}
+
+static void sha256_final(Sha256 *s, unsigned char out[32]) {
+    uint64_t bits = s->total * 8;
+    unsigned char pad[72] = { 0x80 };
+    size_t pad_len = (s->fill < 56 ? 56 : 120) - s->fill;
+    for (int i = 0; i < 8; i++)
+        pad[pad_len + i] = (unsigned char)(bits >> (56 - 8 * i));
+    sha256_update(s, pad, pad_len + 8);
+    for (int i = 0; i < 8; i++) {
+        out[4 * i]     = (unsigned char)(s->h[i] >> 24);
+        out[4 * i + 1] = (unsigned char)(s->h[i] >> 16);
+        out[4 * i + 2] = (unsigned char)(s->h[i] >> 8);
+        out[4 * i + 3] = (unsigned char)s->h[i];
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* KEYS                                                               */
+/* ------------------------------------------------------------------ */
+
+/**
+ * Hash text the way the parsers see it: each data line, without its "\n"
+ * or "\r\n", followed by "\n". Blank and '#' lines are skipped, as
+ * next_line()/skip_line() in parser.c skip them.
+ */
+static void hash_lines(const char *text, size_t len, unsigned char out[32]) {
+    Sha256 s;
+    sha256_init(&s);
+    const char *cur = text, *end = text + len;
+    while (cur < end) {
+        const char *nl = memchr(cur, '\n', (size_t)(end - cur));
+        const char *stop = nl ? nl : end;
+        const char *start = cur;
+        cur = nl ? nl + 1 : end;
+
+        if (stop > start && stop[-1] == '\r') stop--;
+        if (stop == start || *start == '#') continue;
+        sha256_update(&s, start, (size_t)(stop - start));
+        sha256_update(&s, "\n", 1);
+    }
+    sha256_final(&s, out);
+}
+
+void cargoforge_cache_key(const CargoForge *cf,
+                          const char *ship_config, size_t ship_len,
+                          const char *cargo_manifest, size_t cargo_len,
+                          CfCacheKey *key) {
+    /* Result-shaping options; a NULL handle means the defaults */
+    static const int opts[] = {
+        CF_OPT_STRATEGY, CF_OPT_BEAM_WIDTH, CF_OPT_TIME_BUDGET, CF_OPT_JSON_COMPACT,
+        CF_OPT_PLACER, CF_OPT_RESULT_MASK, CF_OPT_JSON_CARGO_FIRST, CF_OPT_JSON_CARGO_COUNT
+    };
+    enum { NOPTS = sizeof(opts) / sizeof(opts[0]) };
+    unsigned char header[16 + 4 * NOPTS] = "cargoforge-rc-1";
+    for (int i = 0; i < NOPTS; i++) {
+        int v = -1;
+        if (cf) v = cargoforge_get_option(cf, opts[i]);
+        uint32_t u = (uint32_t)v;
+        for (int b = 0; b < 4; b++)
+            header[16 + 4 * i + b] = (unsigned char)(u >> (8 * b));
+    }
+
+    unsigned char ship_digest[32], cargo_digest[32];
+    hash_lines(ship_config, ship_len, ship_digest);
+    hash_lines(cargo_manifest, cargo_len, cargo_digest);
+
+    Sha256 s;
+    sha256_init(&s);
+    sha256_update(&s, header, sizeof(header));
+    sha256_update(&s, ship_digest, sizeof(ship_digest));
+    sha256_update(&s, cargo_digest, sizeof(cargo_digest));
+    sha256_final(&s, key->digest);
+}
+
+/* ------------------------------------------------------------------ */
+/* CACHE                                                              */
+/* ------------------------------------------------------------------ */
+
+typedef struct CacheEntry {
+    CfCacheKey key;
+    char *json;
+    size_t len;
+    struct CacheEntry *chain;          /* next in the hash bucket */
+    struct CacheEntry *newer, *older;  /* recency list */
+} CacheEntry;
+
+struct CfCache {
+    pthread_mutex_t lock;
+    CacheEntry **buckets;
+    size_t nbuckets;                   /* power of two */
+    CacheEntry *newest, *oldest;
+    CfCacheStats stats;
+};
+
+static size_t entry_cost(size_t len) {
+    return sizeof(CacheEntry) + len + 1;
+}
+
+static size_t bucket_of(const CfCache *c, const CfCacheKey *key) {
+    size_t h;
+    memcpy(&h, key->digest, sizeof(h));
+    return h & (c->nbuckets - 1);
+}
+
+int cargoforge_cache_open(CfCache **cache, size_t max_bytes) {
+    if (!cache) return CF_ERROR;
+    *cache = NULL;
+    if (max_bytes == 0) return CF_ERROR;
+
+    CfCache *c = calloc(1, sizeof(CfCache));
+    if (!c) return CF_ERR_NOMEM;
+    c->nbuckets = 64;
+    c->buckets = calloc(c->nbuckets, sizeof(CacheEntry *));
+    if (!c->buckets) {
+        free(c);
+        return CF_ERR_NOMEM;
+    }
+    pthread_mutex_init(&c->lock, NULL);
+    c->stats.max_bytes = max_bytes;
+    *cache = c;
+    return CF_OK;
+}
+
+/** Unlink e from its bucket and the recency list (lock held) */
+static void unlink_entry(CfCache *c, CacheEntry *e) {
+    CacheEntry **pp = &c->buckets[bucket_of(c, &e->key)];
+    while (*pp != e) pp = &(*pp)->chain;
+    *pp = e->chain;
+
+    if (e->newer) e->newer->older = e->older;
+    else c->newest = e->older;
+    if (e->older) e->older->newer = e->newer;
+    else c->oldest = e->newer;
+
+    c->stats.entries--;
+    c->stats.bytes -= entry_cost(e->len);
+}
+
+static void push_newest(CfCache *c, CacheEntry *e) {
+    e->older = c->newest;
+    e->newer = NULL;
+    if (c->newest) c->newest->newer = e;
+    else c->oldest = e;
+    c->newest = e;
+}
+
+static void free_entry(CacheEntry *e) {
+    free(e->json);
+    free(e);
+}
+
+static CacheEntry *find_entry(const CfCache *c, const CfCacheKey *key) {
+    CacheEntry *e = c->buckets[bucket_of(c, key)];
+    while (e && memcmp(e->key.digest, key->digest, sizeof(key->digest)) != 0)
+        e = e->chain;
+    return e;
+}
+
+/** Double the bucket array once entries outnumber buckets (lock held) */
+static void maybe_grow(CfCache *c) {
+    if (c->stats.entries < c->nbuckets) return;
+    size_t n = c->nbuckets * 2;
+    CacheEntry **grown = calloc(n, sizeof(CacheEntry *));
+    if (!grown) return;                 /* keep the longer chains */
+
+    CacheEntry **old = c->buckets;
+    size_t old_n = c->nbuckets;
+    c->buckets = grown;
+    c->nbuckets = n;
+    for (size_t i = 0; i < old_n; i++) {
+        CacheEntry *e = old[i];
+        while (e) {
+            CacheEntry *next = e->chain;
+            size_t b = bucket_of(c, &e->key);
+            e->chain = grown[b];
+            grown[b] = e;
+            e = next;
+        }
+    }
+    free(old);
+}
+
+int cargoforge_cache_get(CfCache *c, const CfCacheKey *key, char **json, size_t *len) {
+    if (!c || !key || !json) return CF_ERROR;
+    *json = NULL;
+
+    pthread_mutex_lock(&c->lock);
+    CacheEntry *e = find_entry(c, key);
+    int rc = CF_ERROR;
+    if (!e) {
+        c->stats.misses++;
+    } else {
+        char *copy = malloc(e->len + 1);
+        if (!copy) {
+            rc = CF_ERR_NOMEM;
+        } else {
+            memcpy(copy, e->json, e->len + 1);
+            if (len) *len = e->len;
+            *json = copy;
+            c->stats.hits++;
+            rc = CF_OK;
+
+            if (c->newest != e) {
+                /* Move to the front of the recency list */
+                e->newer->older = e->older;
+                if (e->older) e->older->newer = e->newer;
+                else c->oldest = e->newer;
+                push_newest(c, e);
+            }
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+    return rc;
+}
+
+int cargoforge_cache_put(CfCache *c, const CfCacheKey *key, const char *json, size_t len) {
+    if (!c || !key || !json) return CF_ERROR;
+    if (entry_cost(len) > c->stats.max_bytes) return CF_ERROR;
+
+    /* Copy outside the lock; results can be megabytes */
+    CacheEntry *e = malloc(sizeof(CacheEntry));
+    char *copy = malloc(len + 1);
+    if (!e || !copy) {
+        free(e);
+        free(copy);
+        return CF_ERR_NOMEM;
+    }
+    memcpy(copy, json, len);
+    copy[len] = '\0';
+    e->key = *key;
+    e->json = copy;
+    e->len = len;
+
+    CacheEntry *evicted = NULL;
+    pthread_mutex_lock(&c->lock);
+    CacheEntry *old = find_entry(c, key);
+    if (old) {
+        unlink_entry(c, old);
+        old->chain = evicted;
+        evicted = old;
+    }
+    while (c->oldest && c->stats.bytes + entry_cost(len) > c->stats.max_bytes) {
+        CacheEntry *victim = c->oldest;
+        unlink_entry(c, victim);
+        victim->chain = evicted;
+        evicted = victim;
+        c->stats.evictions++;
+    }
+
+    size_t b = bucket_of(c, key);
+    e->chain = c->buckets[b];
+    c->buckets[b] = e;
+    push_newest(c, e);
+    c->stats.entries++;
+    c->stats.bytes += entry_cost(len);
+    maybe_grow(c);
+    pthread_mutex_unlock(&c->lock);
+
+    while (evicted) {
+        CacheEntry *next = evicted->chain;
+        free_entry(evicted);
+        evicted = next;
+    }
+    return CF_OK;
+}
+
+void cargoforge_cache_clear(CfCache *c) {
+    if (!c) return;
+    pthread_mutex_lock(&c->lock);
+    CacheEntry *e = c->newest;
+    c->newest = c->oldest = NULL;
+    memset(c->buckets, 0, c->nbuckets * sizeof(CacheEntry *));
+    c->stats.entries = 0;
+    c->stats.bytes = 0;
+    pthread_mutex_unlock(&c->lock);
+
+    while (e) {
+        CacheEntry *next = e->older;
+        free_entry(e);
+        e = next;
+    }
+}
+
+void cargoforge_cache_stats(CfCache *c, CfCacheStats *stats) {
+    if (!c || !stats) return;
+    pthread_mutex_lock(&c->lock);
+    *stats = c->stats;
+    pthread_mutex_unlock(&c->lock);
+}
+
+void cargoforge_cache_close(CfCache *c) {
+    if (!c) return;
+    cargoforge_cache_clear(c);
+    pthread_mutex_destroy(&c->lock);
+    free(c->buckets);
+    free(c);
+}
@@ -1,247 +1,672 @@
 /*
- * server.c - Minimal JSON-RPC 2.0 HTTP server for CargoForge
+ * server.c - JSON-RPC 2.0 HTTP server for CargoForge
  *
- * Single-threaded, zero-dependency server using POSIX sockets.
- * Handles one request at a time. Designed for integration testing
- * and lightweight deployments — not a production HTTP server.
+ * One event thread multiplexes every connection with epoll (Linux) or
+ * kqueue (BSD/macOS): it accepts, reads and frames requests, and writes
+ * responses, never blocking on a socket. Cheap calls (version, CORS
+ * preflight) are answered on the event thread; everything else goes to
+ * a bounded pool of worker threads, each call on its own CargoForge
+ * handle, taken warm from an idle list and reset afterwards. Workers
+ * hand finished responses back through a completion list and a wake-up
+ * pipe. Connections are kept alive per HTTP/1.1.
  */
 
 #include "server.h"
 #include "libcargoforge.h"
+#include "json_output.h"
+#include "json_parse.h"
+#include "thread_pool.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <signal.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
-#define MAX_REQUEST_SIZE (1024 * 1024)  /* 1 MB max request body */
-#define RECV_BUF_SIZE    4096
-
-static volatile int server_running = 1;
+#if defined(__linux__)
+#include <sys/epoll.h>
+#define USE_EPOLL 1
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || \
+      defined(__OpenBSD__) || defined(__DragonFly__)
+#include <sys/event.h>
+#define USE_KQUEUE 1
+#else
+#error "server.c needs epoll or kqueue"
+#endif
+
+#define MAX_HEADER_SIZE  (16 * 1024)
+#define RECV_BUF_SIZE    (16 * 1024)
+#define KEEP_BUF_SIZE    (256 * 1024)   /* larger input buffers shrink between requests */
+#define KEEP_ARENA_SIZE  (64u << 20)    /* handles holding more are closed, not kept */
+#define MAX_EVENTS       64
+
+static volatile sig_atomic_t server_running = 1;
 
 static void signal_handler(int sig) {
     (void)sig;
     server_running = 0;
 }
 
+void server_options_init(ServerOptions *opts) {
+    memset(opts, 0, sizeof(*opts));
+    opts->port = 8080;
+    opts->workers = 0;
+    opts->queue_depth = 64;
+    opts->max_connections = 1024;
+    opts->keepalive_timeout_s = 5;
+    opts->max_request_bytes = (size_t)64 * 1024 * 1024;
+    opts->max_batch = 256;
+    opts->cache_bytes = (size_t)64 * 1024 * 1024;
+    opts->max_templates = 64;
+}
+
 /* ------------------------------------------------------------------ */
-/* MINIMAL JSON FIELD EXTRACTION                                      */
+/* JSON-RPC REQUESTS                                                  */
 /* ------------------------------------------------------------------ */
 
 /**
- * Extract a JSON string value for a given key.
- * Handles escaped quotes within the value.
- * Returns pointer to start of value (within json), sets *len.
- * Returns NULL if key not found.
+ * RpcCall - One request object of a single or batch request, located by
+ * one pass of the JSON reader over the body. Spans point into the body,
+ * which the call's handler may decode in place: calls never share bytes.
  */
-static const char *json_find_string(const char *json, const char *key,
-                                    size_t *len) {
-    char search[128];
-    snprintf(search, sizeof(search), "\"%s\"", key);
+typedef struct RpcCall_ {
+    JsonSpan method;         /* JSON_NONE if missing */
+    JsonSpan id;             /* echoed verbatim; JSON_NONE = null */
+    JsonSpan params;         /* JSON_NONE if missing */
+    JsonSpan envelope;       /* the whole request object */
+    int error;               /* JSON-RPC code if the envelope is invalid */
+    const char *message;
+    JsonWriter out;          /* this call's response object */
+    struct Job_ *job;
+} RpcCall;
 
-    const char *p = strstr(json, search);
-    if (!p) return NULL;
+/**
+ * RpcRequest - A parsed HTTP body: a single call, a batch, or an error
+ * that applies to the whole body (parse error, empty or oversized batch).
+ */
+typedef struct {
+    int batch;
+    int count;
+    RpcCall *calls;          /* &single, or a heap array for batches */
+    RpcCall single;
+    int error;
+    const char *message;
+} RpcRequest;
+
+/** Read the request object at r into call (envelope errors go to call->error) */
+static int rpc_parse_call(JsonReader *r, RpcCall *call) {
+    memset(call, 0, sizeof(*call));
+    if (json_peek(r) != JSON_OBJECT) {
+        if (json_read_value(r, &call->envelope) != 0) return -1;
+        call->error = -32600;
+        call->message = "Invalid request: not an object";
+        return 0;
+    }
 
-    /* Skip key and colon */
-    p += strlen(search);
-    while (*p == ' ' || *p == ':' || *p == '\t' || *p == '\n' || *p == '\r')
-        p++;
+    const char *start = r->p;
+    JsonSpan key, val;
+    int rc, version_ok = 1;
+    if (json_object_begin(r) != 0) return -1;
+    while ((rc = json_object_next(r, &key)) > 0) {
+        if (json_read_value(r, &val) != 0) return -1;
+        if (json_span_is(&key, "method")) call->method = val;
+        else if (json_span_is(&key, "id")) call->id = val;
+        else if (json_span_is(&key, "params")) call->params = val;
+        else if (json_span_is(&key, "jsonrpc")) version_ok = json_span_is(&val, "2.0");
+    }
+    if (rc < 0) return -1;
+    call->envelope.type = JSON_OBJECT;
+    call->envelope.start = start;
+    call->envelope.len = (size_t)(r->p - start);
+
+    if (call->id.type != JSON_NONE && call->id.type != JSON_NULL &&
+        call->id.type != JSON_NUMBER && call->id.type != JSON_STRING) {
+        call->id.type = JSON_NONE;
+        call->error = -32600;
+        call->message = "Invalid request: id must be a string, number or null";
+    } else if (!version_ok) {
+        call->error = -32600;
+        call->message = "Invalid request: jsonrpc must be \"2.0\"";
+    } else if (call->method.type != JSON_STRING) {
+        call->error = -32600;
+        call->message = "Invalid request: missing method";
+    }
+    return 0;
+}
 
-    if (*p != '"') return NULL;
-    p++; /* skip opening quote */
+/**
+ * Locate every call in body[0..len) in one pass. Malformed JSON fails the
+ * whole body with -32700; batches of more than max_batch calls fail it
+ * with -32600. The caller frees req->calls via rpc_request_free().
+ */
+static void rpc_parse(RpcRequest *req, const char *body, size_t len, int max_batch) {
+    memset(req, 0, sizeof(*req));
+    JsonReader r;
+    json_reader_init(&r, body, len);
+
+    if (json_peek(&r) != JSON_ARRAY) {
+        req->calls = &req->single;
+        req->count = 1;
+        if (json_peek(&r) == JSON_NONE || rpc_parse_call(&r, &req->single) != 0 ||
+            json_reader_finish(&r) != 0) {
+            req->error = -32700;
+            req->message = "Parse error: invalid JSON";
+        }
+        return;
+    }
 
-    /* Find closing quote (handle escapes) */
-    const char *start = p;
-    while (*p && !(*p == '"' && *(p - 1) != '\\'))
-        p++;
+    req->batch = 1;
+    int cap = 0, rc;
+    json_array_begin(&r);
+    while ((rc = json_array_next(&r)) > 0) {
+        if (req->count == max_batch) {
+            req->error = -32600;
+            req->message = "Invalid request: batch too large";
+            return;
+        }
+        if (req->count == cap) {
+            int new_cap = cap ? cap * 2 : 8;
+            if (new_cap > max_batch) new_cap = max_batch;
+            RpcCall *grown = realloc(req->calls, (size_t)new_cap * sizeof(RpcCall));
+            if (!grown) {
+                req->error = -32603;
+                req->message = "Internal error";
+                return;
+            }
+            req->calls = grown;
+            cap = new_cap;
+        }
+        if (rpc_parse_call(&r, &req->calls[req->count]) != 0) break;
+        req->count++;
+    }
+    if (rc < 0 || r.error || json_reader_finish(&r) != 0) {
+        req->error = -32700;
+        req->message = "Parse error: invalid JSON";
+    } else if (req->count == 0) {
+        req->error = -32600;
+        req->message = "Invalid request: empty batch";
+    }
+}
 
-    *len = (size_t)(p - start);
-    return start;
+static void rpc_request_free(RpcRequest *req) {
+    for (int i = 0; i < req->count; i++) json_writer_free(&req->calls[i].out);
+    if (req->calls != &req->single) free(req->calls);
+    req->calls = NULL;
+    req->count = 0;
 }
 
-/**
- * Extract a JSON integer value for a given key.
- * Returns the integer value, or -1 if not found.
- */
-static int json_find_int(const char *json, const char *key) {
-    char search[128];
-    snprintf(search, sizeof(search), "\"%s\"", key);
+/* ------------------------------------------------------------------ */
+/* JSON-RPC RESPONSES                                                 */
+/* ------------------------------------------------------------------ */
 
-    const char *p = strstr(json, search);
-    if (!p) return -1;
+static void put_id(JsonWriter *out, const JsonSpan *id) {
+    if (!id || id->type == JSON_NONE) {
+        json_put_cstr(out, "null");
+    } else if (id->type == JSON_STRING) {
+        json_put_cstr(out, "\"");
+        json_put_raw(out, id->start, id->len);
+        json_put_cstr(out, "\"");
+    } else {
+        json_put_raw(out, id->start, id->len);
+    }
+}
 
-    p += strlen(search);
-    while (*p == ' ' || *p == ':' || *p == '\t' || *p == '\n' || *p == '\r')
-        p++;
+static void jsonrpc_error(JsonWriter *out, const JsonSpan *id, int code, const char *message) {
+    json_put_cstr(out, "{\"jsonrpc\":\"2.0\",\"error\":{\"code\":");
+    json_put_int(out, code);
+    json_put_cstr(out, ",\"message\":");
+    json_put_string(out, message);
+    json_put_cstr(out, "},\"id\":");
+    put_id(out, id);
+    json_put_cstr(out, "}");
+}
 
-    return atoi(p);
+static void jsonrpc_result(JsonWriter *out, const JsonSpan *id, const char *result) {
+    /* result is already a JSON value/object */
+    json_put_cstr(out, "{\"jsonrpc\":\"2.0\",\"result\":");
+    json_put_cstr(out, result ? result : "null");
+    json_put_cstr(out, ",\"id\":");
+    put_id(out, id);
+    json_put_cstr(out, "}");
 }
 
+/* ------------------------------------------------------------------ */
+/* SHIP TEMPLATES                                                     */
+/* ------------------------------------------------------------------ */
+
 /**
- * Copy a JSON string value (unescaping \n, \t, \\, \").
- * Returns heap-allocated string. Caller must free.
+ * TemplateSet - Parsed ships, keyed by their exact ship_config text. A
+ * fleet sends the same few configs over and over; handles built from a
+ * template share its tables instead of parsing the config and reading
+ * its hydrostatic and tank files on every request.
  */
-static char *json_extract_string(const char *json, const char *key) {
+typedef struct {
+    char *text;
     size_t len;
-    const char *val = json_find_string(json, key, &len);
-    if (!val) return NULL;
-
-    char *buf = malloc(len + 1);
-    if (!buf) return NULL;
-
-    size_t j = 0;
-    for (size_t i = 0; i < len; i++) {
-        if (val[i] == '\\' && i + 1 < len) {
-            i++;
-            switch (val[i]) {
-                case 'n':  buf[j++] = '\n'; break;
-                case 't':  buf[j++] = '\t'; break;
-                case '\\': buf[j++] = '\\'; break;
-                case '"':  buf[j++] = '"';  break;
-                case 'r':  buf[j++] = '\r'; break;
-                default:   buf[j++] = '\\'; buf[j++] = val[i]; break;
-            }
-        } else {
-            buf[j++] = val[i];
+    CfShipTemplate *tpl;
+    unsigned long last_used;
+} TemplateEntry;
+
+typedef struct {
+    pthread_mutex_t lock;
+    TemplateEntry *entries;
+    int count, capacity;     /* capacity 0 = disabled */
+    unsigned long clock;
+} TemplateSet;
+
+static void templates_init(TemplateSet *t, int capacity) {
+    memset(t, 0, sizeof(*t));
+    pthread_mutex_init(&t->lock, NULL);
+    if (capacity > 0) {
+        t->entries = calloc((size_t)capacity, sizeof(TemplateEntry));
+        if (t->entries) t->capacity = capacity;
+    }
+}
+
+static void templates_free(TemplateSet *t) {
+    for (int i = 0; i < t->count; i++) {
+        free(t->entries[i].text);
+        cargoforge_template_release(t->entries[i].tpl);
+    }
+    free(t->entries);
+    pthread_mutex_destroy(&t->lock);
+}
+
+/**
+ * Template for a ship config: a new reference the caller releases, or
+ * NULL if the set is disabled or the config does not parse (the caller
+ * then loads it directly, which reports the error).
+ */
+static CfShipTemplate *templates_get(TemplateSet *t, const char *text, size_t len) {
+    if (!t || t->capacity == 0) return NULL;
+
+    pthread_mutex_lock(&t->lock);
+    for (int i = 0; i < t->count; i++) {
+        TemplateEntry *e = &t->entries[i];
+        if (e->len == len && memcmp(e->text, text, len) == 0) {
+            e->last_used = ++t->clock;
+            CfShipTemplate *tpl = cargoforge_template_retain(e->tpl);
+            pthread_mutex_unlock(&t->lock);
+            return tpl;
         }
     }
-    buf[j] = '\0';
-    return buf;
+    pthread_mutex_unlock(&t->lock);
+
+    /* Parse outside the lock; a racing request may parse the same config */
+    CfShipTemplate *tpl;
+    if (cargoforge_template_load_buffer(&tpl, text, len) != CF_OK) return NULL;
+    char *copy = malloc(len + 1);
+    if (!copy) return tpl;
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+
+    pthread_mutex_lock(&t->lock);
+    TemplateEntry *slot = NULL;
+    if (t->count < t->capacity) {
+        slot = &t->entries[t->count++];
+    } else {
+        slot = &t->entries[0];            /* replace the least recently used */
+        for (int i = 1; i < t->count; i++)
+            if (t->entries[i].last_used < slot->last_used) slot = &t->entries[i];
+        free(slot->text);
+        cargoforge_template_release(slot->tpl);
+    }
+    slot->text = copy;
+    slot->len = len;
+    slot->tpl = cargoforge_template_retain(tpl);
+    slot->last_used = ++t->clock;
+    pthread_mutex_unlock(&t->lock);
+    return tpl;
 }
 
 /* ------------------------------------------------------------------ */
-/* HTTP RESPONSE HELPERS                                              */
+/* WORKER HANDLES                                                     */
 /* ------------------------------------------------------------------ */
 
-static void send_response(int client_fd, int status, const char *body) {
-    const char *status_text = (status == 200) ? "OK" : "Bad Request";
-    size_t body_len = body ? strlen(body) : 0;
-
-    char header[512];
-    int header_len = snprintf(header, sizeof(header),
-        "HTTP/1.1 %d %s\r\n"
-        "Content-Type: application/json\r\n"
-        "Content-Length: %zu\r\n"
-        "Access-Control-Allow-Origin: *\r\n"
-        "Access-Control-Allow-Methods: POST, OPTIONS\r\n"
-        "Access-Control-Allow-Headers: Content-Type\r\n"
-        "Connection: close\r\n"
-        "\r\n",
-        status, status_text, body_len);
+/**
+ * HandlePool - Idle CargoForge handles. A call takes one and gives it
+ * back reset; their arenas (CF_OPT_ARENA) and JSON buffers keep the
+ * memory of earlier requests, so steady-state calls on inputs of similar
+ * size do not allocate for the ship, cargo or result. At most capacity
+ * handles are kept; any beyond that, or with an arena grown past
+ * KEEP_ARENA_SIZE, are closed.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    CargoForge **idle;
+    int count, capacity;
+} HandlePool;
+
+static void handles_init(HandlePool *h, int capacity) {
+    memset(h, 0, sizeof(*h));
+    pthread_mutex_init(&h->lock, NULL);
+    h->idle = calloc((size_t)capacity, sizeof(CargoForge *));
+    if (h->idle) h->capacity = capacity;
+}
 
-    write(client_fd, header, (size_t)header_len);
-    if (body && body_len > 0)
-        write(client_fd, body, body_len);
+static void handles_free(HandlePool *h) {
+    for (int i = 0; i < h->count; i++) cargoforge_close(h->idle[i]);
+    free(h->idle);
+    pthread_mutex_destroy(&h->lock);
 }
 
-static void send_jsonrpc_error(int client_fd, int id, int code,
-                               const char *message) {
-    char buf[1024];
-    snprintf(buf, sizeof(buf),
-        "{\"jsonrpc\":\"2.0\",\"error\":{\"code\":%d,\"message\":\"%s\"},\"id\":%d}",
-        code, message, id);
-    send_response(client_fd, 200, buf);
+/** An idle handle, or a new one; NULL if out of memory */
+static CargoForge *handles_acquire(HandlePool *h) {
+    CargoForge *cf = NULL;
+    pthread_mutex_lock(&h->lock);
+    if (h->count > 0) cf = h->idle[--h->count];
+    pthread_mutex_unlock(&h->lock);
+    if (cf) return cf;
+
+    if (cargoforge_open(&cf) != CF_OK) return NULL;
+    cargoforge_set_option(cf, CF_OPT_ARENA, 1);
+    cargoforge_set_option(cf, CF_OPT_JSON_COMPACT, 1);
+    cargoforge_set_option(cf, CF_OPT_STATS, 1);
+    return cf;
 }
 
-static void send_jsonrpc_result(int client_fd, int id, const char *result) {
-    /* result is already a JSON value/object */
-    size_t result_len = result ? strlen(result) : 4;
-    size_t buf_size = result_len + 128;
-    char *buf = malloc(buf_size);
-    if (!buf) {
-        send_jsonrpc_error(client_fd, id, -32603, "Internal error");
-        return;
+static void handles_release(HandlePool *h, CargoForge *cf) {
+    size_t reserved = 0;
+    cargoforge_reset(cf);
+    cargoforge_arena_stats(cf, NULL, &reserved);
+    pthread_mutex_lock(&h->lock);
+    if (h->count < h->capacity && reserved <= KEEP_ARENA_SIZE) {
+        h->idle[h->count++] = cf;
+        cf = NULL;
     }
+    pthread_mutex_unlock(&h->lock);
+    cargoforge_close(cf);
+}
+
+/* ------------------------------------------------------------------ */
+/* METRICS                                                            */
+/* ------------------------------------------------------------------ */
+
+/* Methods counted by name in ServerMetrics.calls; the rest are "other" */
+static const char *const METRIC_METHODS[] = {
+    "optimize", "validate", "version", "cache_stats", "other"
+};
+#define METRIC_METHOD_COUNT 5
+
+/* CfStats phases, in the order of its *_ms fields */
+static const char *const METRIC_PHASES[] = {
+    "ship_parse", "cargo_parse", "place", "analysis", "imdg", "serialize"
+};
+#define METRIC_PHASE_COUNT 6
+
+/** MetricTotals - Counters since the server started */
+typedef struct {
+    unsigned long long calls[METRIC_METHOD_COUNT];
+    unsigned long long errors;                     /* calls answered with an error */
+    double phase_ms[METRIC_PHASE_COUNT];
+    unsigned long long phase_runs[METRIC_PHASE_COUNT];
+    unsigned long long items_searched;
+    unsigned long long spaces_scanned;
+    unsigned long long counts[CF_DIAG_CODE_COUNT];
+} MetricTotals;
 
-    snprintf(buf, buf_size,
-        "{\"jsonrpc\":\"2.0\",\"result\":%s,\"id\":%d}",
-        result ? result : "null", id);
+/**
+ * ServerMetrics - Totals behind GET /metrics. Workers fold each call's
+ * CfStats in after the call; the event thread renders a snapshot.
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    MetricTotals totals;
+} ServerMetrics;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
 
-    send_response(client_fd, 200, buf);
-    free(buf);
+static void stats_phases(const CfStats *st, double ms[METRIC_PHASE_COUNT]) {
+    ms[0] = st->ship_parse_ms;
+    ms[1] = st->cargo_parse_ms;
+    ms[2] = st->place_ms;
+    ms[3] = st->analysis_ms;
+    ms[4] = st->imdg_ms;
+    ms[5] = st->serialize_ms;
+}
+
+/** Add one call's handle statistics; a phase that did not run reads 0 */
+static void metrics_add(ServerMetrics *m, const CargoForge *cf) {
+    CfStats st;
+    double ms[METRIC_PHASE_COUNT];
+    if (cargoforge_stats(cf, &st) != CF_OK) return;
+    stats_phases(&st, ms);
+
+    pthread_mutex_lock(&m->lock);
+    MetricTotals *t = &m->totals;
+    for (int p = 0; p < METRIC_PHASE_COUNT; p++) {
+        if (ms[p] <= 0.0) continue;
+        t->phase_ms[p] += ms[p];
+        t->phase_runs[p]++;
+    }
+    t->items_searched += (unsigned long long)st.items_searched;
+    t->spaces_scanned += (unsigned long long)st.spaces_scanned;
+    for (int k = 0; k < CF_DIAG_CODE_COUNT; k++)
+        t->counts[k] += (unsigned long long)st.counts[k];
+    pthread_mutex_unlock(&m->lock);
+}
+
+/** Metric label for a CF_DIAG_* code: its name in snake case */
+static void diag_label(int code, char *buf, size_t size) {
+    const char *name = cargoforge_diag_name(code);
+    size_t i = 0;
+    for (; name[i] && i + 1 < size; i++) {
+        char ch = name[i];
+        buf[i] = (ch == ' ') ? '_' : (ch >= 'A' && ch <= 'Z') ? (char)(ch - 'A' + 'a') : ch;
+    }
+    buf[i] = '\0';
 }
 
 /* ------------------------------------------------------------------ */
 /* JSON-RPC METHOD DISPATCH                                           */
 /* ------------------------------------------------------------------ */
 
-static void handle_method_optimize(int client_fd, const char *params, int id) {
-    char *ship_config = json_extract_string(params, "ship_config");
-    char *cargo_manifest = json_extract_string(params, "cargo_manifest");
+/** Server state the method handlers use */
+typedef struct {
+    int verbose;
+    CfCache *cache;          /* optimize results; NULL when disabled */
+    TemplateSet templates;
+    HandlePool handles;
+    ServerMetrics metrics;
+} RpcContext;
+
+/** Load a ship config into cf, from a shared template when possible */
+static int load_ship_config(RpcContext *ctx, CargoForge *cf, const char *text, size_t len) {
+    CfShipTemplate *tpl = templates_get(&ctx->templates, text, len);
+    if (!tpl) return cargoforge_load_ship_buffer(cf, text, len);
+    int rc = cargoforge_load_ship_template(cf, tpl);
+    cargoforge_template_release(tpl);
+    return rc;
+}
 
-    if (!ship_config || !cargo_manifest) {
-        send_jsonrpc_error(client_fd, id, -32602,
-            "Missing required params: ship_config, cargo_manifest");
-        free(ship_config);
-        free(cargo_manifest);
-        return;
+/**
+ * Find the ship_config / cargo_manifest strings in the object obj and
+ * decode them in place. A member that is absent, not a string, or badly
+ * escaped is left NULL. want_stats (optional) is set if "stats" is true.
+ */
+static void find_inputs(const JsonSpan *obj, char **ship, size_t *ship_len,
+                        char **cargo, size_t *cargo_len, int *want_stats) {
+    JsonSpan ship_span = {0}, cargo_span = {0}, key, val;
+    JsonReader r;
+    json_reader_init(&r, obj->start, obj->len);
+    *ship = *cargo = NULL;
+    *ship_len = *cargo_len = 0;
+    if (want_stats) *want_stats = 0;
+
+    if (obj->type != JSON_OBJECT || json_object_begin(&r) != 0) return;
+    while (json_object_next(&r, &key) > 0 && json_read_value(&r, &val) == 0) {
+        if (want_stats && json_span_is(&key, "stats")) *want_stats = (val.type == JSON_TRUE);
+        if (val.type != JSON_STRING) continue;
+        if (json_span_is(&key, "ship_config")) ship_span = val;
+        else if (json_span_is(&key, "cargo_manifest")) cargo_span = val;
     }
 
-    CargoForge *cf;
-    if (cargoforge_open(&cf) != CF_OK) {
-        send_jsonrpc_error(client_fd, id, -32603, "Failed to create context");
-        free(ship_config);
-        free(cargo_manifest);
-        return;
+    /* Decode only after the walk: decoding rewrites the bytes it covers */
+    size_t n;
+    if (ship_span.type == JSON_STRING &&
+        (n = json_string_decode(&ship_span, (char *)ship_span.start)) != (size_t)-1) {
+        *ship = (char *)ship_span.start;
+        *ship_len = n;
+    }
+    if (cargo_span.type == JSON_STRING &&
+        (n = json_string_decode(&cargo_span, (char *)cargo_span.start)) != (size_t)-1) {
+        *cargo = (char *)cargo_span.start;
+        *cargo_len = n;
     }
+}
 
-    int rc = cargoforge_load_ship_string(cf, ship_config);
-    if (rc != CF_OK) {
-        send_jsonrpc_error(client_fd, id, -32602, cargoforge_errmsg(cf));
-        cargoforge_close(cf);
-        free(ship_config);
-        free(cargo_manifest);
+/** The optimize "stats" block: the handle's CfStats and the call's time */
+static void put_stats(JsonWriter *out, const CargoForge *cf, int cached, double total_ms) {
+    CfStats st;
+    double ms[METRIC_PHASE_COUNT];
+    char label[32];
+    cargoforge_stats(cf, &st);
+    stats_phases(&st, ms);
+
+    json_put_cstr(out, cached ? "{\"cached\":true" : "{\"cached\":false");
+    json_put_cstr(out, ",\"total_ms\":");
+    json_put_fixed(out, total_ms, 3);
+    json_put_cstr(out, ",\"phases_ms\":{");
+    for (int p = 0; p < METRIC_PHASE_COUNT; p++) {
+        json_put_cstr(out, p ? ",\"" : "\"");
+        json_put_cstr(out, METRIC_PHASES[p]);
+        json_put_cstr(out, "\":");
+        json_put_fixed(out, ms[p], 3);
+    }
+    json_put_cstr(out, "},\"items_searched\":");
+    json_put_int(out, st.items_searched);
+    json_put_cstr(out, ",\"spaces_scanned\":");
+    json_put_int(out, st.spaces_scanned);
+    json_put_cstr(out, ",\"diagnostics\":{");
+    for (int k = 1; k < CF_DIAG_CODE_COUNT; k++) {
+        diag_label(k, label, sizeof(label));
+        json_put_cstr(out, k > 1 ? ",\"" : "\"");
+        json_put_cstr(out, label);
+        json_put_cstr(out, "\":");
+        json_put_int(out, st.counts[k]);
+    }
+    json_put_cstr(out, "},\"bins\":[");
+    for (int b = 0; b < st.bin_count; b++) {
+        CfBinStats bs;
+        if (cargoforge_bin_stats(cf, b, &bs) != CF_OK) break;
+        json_put_cstr(out, b ? ",{\"name\":" : "{\"name\":");
+        json_put_string(out, bs.name);
+        json_put_cstr(out, ",\"free_spaces\":");
+        json_put_int(out, bs.free_spaces);
+        json_put_cstr(out, ",\"weight_kg\":");
+        json_put_fixed(out, bs.weight, 1);
+        json_put_cstr(out, ",\"max_weight_kg\":");
+        json_put_fixed(out, bs.max_weight, 1);
+        json_put_cstr(out, "}");
+    }
+    json_put_cstr(out, "]}");
+}
+
+/**
+ * Answer an optimize call with result, plus a "stats" member added to the
+ * result object when asked for.
+ */
+static void optimize_result(JsonWriter *out, const JsonSpan *id, const char *result,
+                            int want_stats, const CargoForge *cf, int cached, double start) {
+    size_t n = result ? strlen(result) : 0;
+    while (n > 0 && result[n - 1] != '}') n--;
+    if (!want_stats || n == 0) {
+        jsonrpc_result(out, id, result);
         return;
     }
+    json_put_cstr(out, "{\"jsonrpc\":\"2.0\",\"result\":");
+    json_put_raw(out, result, n - 1);
+    json_put_cstr(out, ",\"stats\":");
+    put_stats(out, cf, cached, now_ms() - start);
+    json_put_cstr(out, "},\"id\":");
+    put_id(out, id);
+    json_put_cstr(out, "}");
+}
 
-    rc = cargoforge_load_cargo_string(cf, cargo_manifest);
-    if (rc != CF_OK) {
-        send_jsonrpc_error(client_fd, id, -32602, cargoforge_errmsg(cf));
-        cargoforge_close(cf);
-        free(ship_config);
-        free(cargo_manifest);
+static void handle_method_optimize(JsonWriter *out, const JsonSpan *params, const JsonSpan *id,
+                                   RpcContext *ctx) {
+    double start = now_ms();
+    char *ship_config, *cargo_manifest;
+    size_t ship_len, cargo_len;
+    int want_stats;
+    find_inputs(params, &ship_config, &ship_len, &cargo_manifest, &cargo_len, &want_stats);
+
+    if (!ship_config || !cargo_manifest) {
+        jsonrpc_error(out, id, -32602,
+            "Missing required params: ship_config, cargo_manifest");
         return;
     }
 
-    rc = cargoforge_optimize(cf);
-    if (rc != CF_OK) {
-        send_jsonrpc_error(client_fd, id, -32603, cargoforge_errmsg(cf));
-        cargoforge_close(cf);
-        free(ship_config);
-        free(cargo_manifest);
+    CargoForge *cf = handles_acquire(&ctx->handles);
+    if (!cf) {
+        jsonrpc_error(out, id, -32603, "Failed to create context");
         return;
     }
 
-    const char *json = cargoforge_result_json(cf);
-    send_jsonrpc_result(client_fd, id, json);
+    /* Identical inputs were answered before: skip parsing and packing */
+    CfCache *cache = ctx->cache;
+    CfCacheKey key;
+    if (cache) {
+        char *cached;
+        cargoforge_cache_key(cf, ship_config, ship_len, cargo_manifest, cargo_len, &key);
+        if (cargoforge_cache_get(cache, &key, &cached, NULL) == CF_OK) {
+            if (ctx->verbose) fprintf(stderr, "[cargoforge] optimize served from cache\n");
+            optimize_result(out, id, cached, want_stats, cf, 1, start);
+            free(cached);
+            handles_release(&ctx->handles, cf);
+            return;
+        }
+    }
 
-    cargoforge_close(cf);
-    free(ship_config);
-    free(cargo_manifest);
+    int rc = load_ship_config(ctx, cf, ship_config, ship_len);
+    if (rc == CF_OK) rc = cargoforge_load_cargo_buffer(cf, cargo_manifest, cargo_len);
+    if (rc != CF_OK) {
+        jsonrpc_error(out, id, -32602, cargoforge_errmsg(cf));
+    } else if (cargoforge_optimize(cf) != CF_OK) {
+        jsonrpc_error(out, id, -32603, cargoforge_errmsg(cf));
+    } else {
+        const char *json = cargoforge_result_json(cf);
+        if (json && cache) cargoforge_cache_put(cache, &key, json, strlen(json));
+        optimize_result(out, id, json, want_stats, cf, 0, start);
+    }
+
+    metrics_add(&ctx->metrics, cf);
+    handles_release(&ctx->handles, cf);
 }
 
-static void handle_method_validate(int client_fd, const char *params, int id) {
-    char *ship_config = json_extract_string(params, "ship_config");
-    char *cargo_manifest = json_extract_string(params, "cargo_manifest");
+static void handle_method_validate(JsonWriter *out, const JsonSpan *params, const JsonSpan *id,
+                                   RpcContext *ctx) {
+    char *ship_config, *cargo_manifest;
+    size_t ship_len, cargo_len;
+    find_inputs(params, &ship_config, &ship_len, &cargo_manifest, &cargo_len, NULL);
 
     if (!ship_config) {
-        send_jsonrpc_error(client_fd, id, -32602, "Missing param: ship_config");
-        free(cargo_manifest);
+        jsonrpc_error(out, id, -32602, "Missing param: ship_config");
         return;
     }
 
-    CargoForge *cf;
-    cargoforge_open(&cf);
+    CargoForge *cf = handles_acquire(&ctx->handles);
+    if (!cf) {
+        jsonrpc_error(out, id, -32603, "Failed to create context");
+        return;
+    }
 
-    int ship_ok = (cargoforge_load_ship_string(cf, ship_config) == CF_OK);
+    int ship_ok = (load_ship_config(ctx, cf, ship_config, ship_len) == CF_OK);
     int cargo_ok = 1;
     if (cargo_manifest)
-        cargo_ok = (cargoforge_load_cargo_string(cf, cargo_manifest) == CF_OK);
+        cargo_ok = (cargoforge_load_cargo_buffer(cf, cargo_manifest, cargo_len) == CF_OK);
 
     char result[256];
     snprintf(result, sizeof(result),
@@ -250,135 +675,816 @@ static void handle_method_validate(int client_fd, const char *params, int id) {
         cargo_ok ? "true" : "false",
         (ship_ok && cargo_ok) ? "true" : "false");
 
-    send_jsonrpc_result(client_fd, id, result);
+    jsonrpc_result(out, id, result);
 
-    cargoforge_close(cf);
-    free(ship_config);
-    free(cargo_manifest);
+    metrics_add(&ctx->metrics, cf);
+    handles_release(&ctx->handles, cf);
 }
 
-static void handle_method_version(int client_fd, int id) {
+static void handle_method_version(JsonWriter *out, const JsonSpan *id) {
     char result[128];
     snprintf(result, sizeof(result), "\"%s\"", cargoforge_version());
-    send_jsonrpc_result(client_fd, id, result);
+    jsonrpc_result(out, id, result);
 }
 
-static void dispatch_request(int client_fd, const char *body, int verbose) {
-    /* Extract JSON-RPC fields */
-    size_t method_len;
-    const char *method_raw = json_find_string(body, "method", &method_len);
-    int id = json_find_int(body, "id");
+static void handle_method_cache_stats(JsonWriter *out, const JsonSpan *id, CfCache *cache) {
+    CfCacheStats st;
+    memset(&st, 0, sizeof(st));
+    if (cache) cargoforge_cache_stats(cache, &st);
 
-    if (!method_raw) {
-        send_jsonrpc_error(client_fd, id >= 0 ? id : 0, -32600,
-            "Invalid request: missing method");
+    char result[256];
+    snprintf(result, sizeof(result),
+        "{\"enabled\":%s,\"hits\":%llu,\"misses\":%llu,\"evictions\":%llu,"
+        "\"entries\":%zu,\"bytes\":%zu,\"max_bytes\":%zu}",
+        cache ? "true" : "false", st.hits, st.misses, st.evictions,
+        st.entries, st.bytes, st.max_bytes);
+    jsonrpc_result(out, id, result);
+}
+
+/** Answer one call into call->out */
+static void rpc_dispatch(RpcCall *call, RpcContext *ctx) {
+    JsonWriter *out = &call->out;
+    if (call->error) {
+        jsonrpc_error(out, &call->id, call->error, call->message);
         return;
     }
 
-    /* Copy method name */
-    char method[64];
-    size_t copy_len = method_len < sizeof(method) - 1 ? method_len : sizeof(method) - 1;
-    memcpy(method, method_raw, copy_len);
-    method[copy_len] = '\0';
-
-    if (verbose)
-        fprintf(stderr, "[cargoforge] method=%s id=%d\n", method, id);
-
-    /* Find params object (rough extraction) */
-    const char *params = strstr(body, "\"params\"");
-    if (params) {
-        params = strchr(params, '{');
-    }
+    if (ctx->verbose)
+        fprintf(stderr, "[cargoforge] method=%.*s id=%.*s\n",
+                (int)call->method.len, call->method.start,
+                call->id.type == JSON_NONE ? 4 : (int)call->id.len,
+                call->id.type == JSON_NONE ? "null" : call->id.start);
 
-    /* Dispatch */
-    if (strcmp(method, "optimize") == 0) {
-        if (!params) {
-            send_jsonrpc_error(client_fd, id, -32602, "Missing params");
+    const JsonSpan *params = &call->params;
+    if (json_span_is(&call->method, "optimize")) {
+        if (params->type != JSON_OBJECT) {
+            jsonrpc_error(out, &call->id, -32602, "Missing params");
             return;
         }
-        handle_method_optimize(client_fd, params, id);
+        handle_method_optimize(out, params, &call->id, ctx);
     }
-    else if (strcmp(method, "validate") == 0) {
-        handle_method_validate(client_fd, params ? params : body, id);
+    else if (json_span_is(&call->method, "validate")) {
+        /* Older clients put ship_config next to method, without params */
+        handle_method_validate(out, params->type == JSON_OBJECT ? params : &call->envelope,
+                               &call->id, ctx);
     }
-    else if (strcmp(method, "version") == 0) {
-        handle_method_version(client_fd, id);
+    else if (json_span_is(&call->method, "version")) {
+        handle_method_version(out, &call->id);
+    }
+    else if (json_span_is(&call->method, "cache_stats")) {
+        handle_method_cache_stats(out, &call->id, ctx->cache);
     }
     else {
-        send_jsonrpc_error(client_fd, id, -32601, "Method not found");
+        jsonrpc_error(out, &call->id, -32601, "Method not found");
+    }
+}
+
+/** Answer one call into call->out, counting it for /metrics */
+static void rpc_execute(RpcCall *call, RpcContext *ctx) {
+    int m = 0;
+    while (m < METRIC_METHOD_COUNT - 1 && !json_span_is(&call->method, METRIC_METHODS[m])) m++;
+    if (call->error) m = METRIC_METHOD_COUNT - 1;
+
+    rpc_dispatch(call, ctx);
+
+    /* Every error response starts the same way (jsonrpc_error) */
+    static const char error_prefix[] = "{\"jsonrpc\":\"2.0\",\"error\"";
+    int failed = call->out.len >= sizeof(error_prefix) - 1 &&
+                 memcmp(call->out.data, error_prefix, sizeof(error_prefix) - 1) == 0;
+
+    ServerMetrics *metrics = &ctx->metrics;
+    pthread_mutex_lock(&metrics->lock);
+    metrics->totals.calls[m]++;
+    if (failed) metrics->totals.errors++;
+    pthread_mutex_unlock(&metrics->lock);
+}
+
+/** Join the calls' responses: one object, or an array for a batch */
+static void rpc_collect(const RpcRequest *req, JsonWriter *out) {
+    if (!req->batch) {
+        json_put_raw(out, req->calls[0].out.data, req->calls[0].out.len);
+        if (req->calls[0].out.oom) out->oom = 1;
+        return;
+    }
+    json_put_cstr(out, "[");
+    for (int i = 0; i < req->count; i++) {
+        if (i) json_put_cstr(out, ",");
+        json_put_raw(out, req->calls[i].out.data, req->calls[i].out.len);
+        if (req->calls[i].out.oom) out->oom = 1;
     }
+    json_put_cstr(out, "]");
 }
 
 /* ------------------------------------------------------------------ */
-/* HTTP REQUEST PARSING                                               */
+/* EVENT BACKEND                                                      */
 /* ------------------------------------------------------------------ */
 
-static int handle_client(int client_fd, int verbose) {
-    char *buf = malloc(MAX_REQUEST_SIZE);
-    if (!buf) return -1;
-
-    size_t total = 0;
-    ssize_t n;
-
-    /* Read until we have full headers + body */
-    while (total < MAX_REQUEST_SIZE - 1) {
-        n = recv(client_fd, buf + total, RECV_BUF_SIZE, 0);
-        if (n <= 0) break;
-        total += (size_t)n;
-        buf[total] = '\0';
-
-        /* Check if we have the full body */
-        char *header_end = strstr(buf, "\r\n\r\n");
-        if (header_end) {
-            size_t header_len = (size_t)(header_end - buf) + 4;
-
-            /* Find Content-Length */
-            char *cl = strstr(buf, "Content-Length:");
-            if (!cl) cl = strstr(buf, "content-length:");
-            size_t content_length = 0;
-            if (cl) content_length = (size_t)atoi(cl + 15);
-
-            if (total >= header_len + content_length)
-                break;
+typedef struct {
+    void *ptr;
+    int readable;
+    int writable;
+} EvEvent;
+
+static int ev_create(void) {
+#ifdef USE_EPOLL
+    return epoll_create1(0);
+#else
+    return kqueue();
+#endif
+}
+
+/** Register fd, or change its interest set, to want_read / want_write */
+static int ev_watch(int ev, int fd, void *ptr, int want_read, int want_write, int add) {
+#ifdef USE_EPOLL
+    struct epoll_event e;
+    memset(&e, 0, sizeof(e));
+    e.events = (want_read ? EPOLLIN : 0u) | (want_write ? EPOLLOUT : 0u);
+    e.data.ptr = ptr;
+    return epoll_ctl(ev, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &e);
+#else
+    (void)add;
+    struct kevent ch[2];
+    EV_SET(&ch[0], fd, EVFILT_READ, EV_ADD | (want_read ? EV_ENABLE : EV_DISABLE), 0, 0, ptr);
+    EV_SET(&ch[1], fd, EVFILT_WRITE, EV_ADD | (want_write ? EV_ENABLE : EV_DISABLE), 0, 0, ptr);
+    return kevent(ev, ch, 2, NULL, 0, NULL);
+#endif
+}
+
+/** Stop watching fd */
+static void ev_forget(int ev, int fd) {
+#ifdef USE_EPOLL
+    epoll_ctl(ev, EPOLL_CTL_DEL, fd, NULL);
+#else
+    struct kevent ch[2];
+    EV_SET(&ch[0], fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+    EV_SET(&ch[1], fd, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
+    kevent(ev, ch, 2, NULL, 0, NULL);
+#endif
+}
+
+static int ev_wait(int ev, EvEvent *out, int max, int timeout_ms) {
+#ifdef USE_EPOLL
+    struct epoll_event events[MAX_EVENTS];
+    if (max > MAX_EVENTS) max = MAX_EVENTS;
+    int n = epoll_wait(ev, events, max, timeout_ms);
+    for (int i = 0; i < n; i++) {
+        out[i].ptr = events[i].data.ptr;
+        out[i].readable = (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0;
+        out[i].writable = (events[i].events & (EPOLLOUT | EPOLLERR)) != 0;
+    }
+    return n;
+#else
+    struct kevent events[MAX_EVENTS];
+    struct timespec ts = { timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L };
+    if (max > MAX_EVENTS) max = MAX_EVENTS;
+    int n = kevent(ev, NULL, 0, events, max, &ts);
+    for (int i = 0; i < n; i++) {
+        out[i].ptr = events[i].udata;
+        out[i].readable = events[i].filter == EVFILT_READ;
+        out[i].writable = events[i].filter == EVFILT_WRITE;
+    }
+    return n;
+#endif
+}
+
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return (flags < 0) ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/* ------------------------------------------------------------------ */
+/* CONNECTIONS AND JOBS                                               */
+/* ------------------------------------------------------------------ */
+
+/**
+ * Conn - One client connection, owned by the event thread. While busy a
+ * worker is computing its response; the Conn then outlives a client
+ * hang-up until the job comes back.
+ */
+typedef struct Conn_ {
+    int fd;
+    int busy;                /* a request is with a worker */
+    int closing;             /* closed by the peer while busy, or closed and
+                              * waiting on Server.closed (busy clear) */
+    int keep_alive;          /* current request allows reuse */
+    int preflight;           /* current request is an OPTIONS */
+    int metrics;             /* current request is a GET /metrics */
+    JsonWriter in;           /* received, not yet consumed bytes */
+    size_t scan_pos;         /* header terminator search resumes here */
+    size_t header_len;       /* parsed request head incl. blank line, 0 = not yet */
+    size_t body_len;         /* its Content-Length */
+    JsonWriter out;          /* framed response being written */
+    size_t out_sent;
+    time_t last_active;
+    struct Conn_ *prev, *next;
+} Conn;
+
+/**
+ * Job - One HTTP request handed to the workers, one pool task per call.
+ * The body is the request's bytes in the connection's input buffer, which
+ * stays put while the connection is busy.
+ */
+typedef struct Job_ {
+    Conn *conn;
+    char *body;              /* NUL-terminated in place */
+    char saved;              /* byte the terminator replaced */
+    RpcRequest req;
+    int remaining;           /* calls not yet answered (server lock) */
+    struct Server_ *server;
+    struct Job_ *next;
+} Job;
+
+typedef struct Server_ {
+    ServerOptions opts;
+    int ev;
+    int listen_fd;
+    int wake_rd, wake_wr;    /* worker -> event thread notification pipe */
+    int listening;           /* listener registered for reads */
+    ThreadPool *pool;
+    RpcContext rpc;          /* shared with the workers */
+
+    pthread_mutex_t lock;    /* guards done and Job.remaining */
+    Job *done;               /* finished jobs, newest first */
+    int queued;              /* calls submitted, not yet collected (event thread) */
+
+    Conn *conns;
+    int conn_count;
+    Conn *closed;            /* closed in this event batch, freed after it */
+} Server;
+
+/* Distinct addresses identifying the non-connection descriptors */
+static char LISTENER_TAG, WAKE_TAG;
+
+static const char *status_text(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 413: return "Payload Too Large";
+        case 411: return "Length Required";
+        case 431: return "Request Header Fields Too Large";
+        case 503: return "Service Unavailable";
+        default:  return "Bad Request";
+    }
+}
+
+/** Frame body (of the given Content-Type) as the connection's next HTTP response */
+static void conn_respond(Conn *c, int status, const char *type,
+                         const char *body, size_t body_len) {
+    char header[512];
+    int header_len = snprintf(header, sizeof(header),
+        "HTTP/1.1 %d %s\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Length: %zu\r\n"
+        "Access-Control-Allow-Origin: *\r\n"
+        "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
+        "Access-Control-Allow-Headers: Content-Type\r\n"
+        "%s"
+        "Connection: %s\r\n"
+        "\r\n",
+        status, status_text(status), type, body_len,
+        status == 503 ? "Retry-After: 1\r\n" : "",
+        c->keep_alive ? "keep-alive" : "close");
+
+    c->out.len = 0;
+    c->out_sent = 0;
+    json_put_raw(&c->out, header, (size_t)header_len);
+    if (body_len) json_put_raw(&c->out, body, body_len);
+}
+
+static void conn_close(Server *s, Conn *c) {
+    if (c->busy) {           /* the worker's job still points here */
+        c->closing = 1;
+        return;
+    }
+    /* Events for c may still be pending in the current batch, so it is
+     * only freed once the batch is done (free_closed()) */
+    c->closing = 1;
+    ev_forget(s->ev, c->fd);
+    close(c->fd);
+    if (c->prev) c->prev->next = c->next;
+    else s->conns = c->next;
+    if (c->next) c->next->prev = c->prev;
+    c->prev = NULL;
+    c->next = s->closed;
+    s->closed = c;
+    s->conn_count--;
+
+    if (!s->listening && s->conn_count < s->opts.max_connections &&
+        ev_watch(s->ev, s->listen_fd, &LISTENER_TAG, 1, 0, 0) == 0)
+        s->listening = 1;
+}
+
+/** Free the connections conn_close() queued */
+static void free_closed(Server *s) {
+    while (s->closed) {
+        Conn *c = s->closed;
+        s->closed = c->next;
+        json_writer_free(&c->in);
+        json_writer_free(&c->out);
+        free(c);
+    }
+}
+
+/** Count one call of j as answered; the last one queues j for the event thread */
+static void job_call_done(Job *j) {
+    Server *s = j->server;
+    pthread_mutex_lock(&s->lock);
+    int last = (--j->remaining == 0);
+    if (last) {
+        j->next = s->done;
+        s->done = j;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    char wake = 1;
+    if (last && write(s->wake_wr, &wake, 1) < 0) { /* pipe full: a wake-up is pending anyway */ }
+}
+
+static void worker_run_call(void *arg) {
+    RpcCall *call = arg;
+    rpc_execute(call, &call->job->server->rpc);
+    job_call_done(call->job);
+}
+
+static void conn_process(Server *s, Conn *c);
+
+/**
+ * Write what the socket takes. Returns -1 if the connection was closed,
+ * 0 while output is pending, 1 once a keep-alive connection is done with
+ * its response and back to reading.
+ */
+static int conn_flush(Server *s, Conn *c) {
+    while (c->out_sent < c->out.len) {
+        ssize_t n = send(c->fd, c->out.data + c->out_sent, c->out.len - c->out_sent, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            conn_close(s, c);
+            return -1;
         }
+        c->out_sent += (size_t)n;
     }
 
-    if (total == 0) {
-        free(buf);
+    c->out.len = c->out_sent = 0;
+    c->last_active = time(NULL);
+    if (!c->keep_alive) {
+        shutdown(c->fd, SHUT_WR);
+        conn_close(s, c);
+        return -1;
+    }
+    ev_watch(s->ev, c->fd, c, 1, 0, 0);
+    return 1;
+}
+
+/**
+ * Start writing a framed response: try now, finish on writability, then
+ * serve any pipelined request. c may be freed on return.
+ */
+static void conn_send(Server *s, Conn *c) {
+    if (c->out.oom) {
+        conn_close(s, c);
+        return;
+    }
+    int rc = conn_flush(s, c);
+    if (rc == 0) ev_watch(s->ev, c->fd, c, 0, 1, 0);
+    else if (rc == 1) conn_process(s, c);
+}
+
+/** Reply on the event thread (errors, preflight, cheap methods) */
+static void conn_reply_now(Server *s, Conn *c, int status, const JsonWriter *body) {
+    conn_respond(c, status, "application/json", body ? body->data : NULL, body ? body->len : 0);
+    conn_send(s, c);
+}
+
+static void conn_reply_error(Server *s, Conn *c, int status, int code, const char *message) {
+    JsonWriter b = {0};
+    jsonrpc_error(&b, NULL, code, message);
+    if (status != 200 && status != 503) c->keep_alive = 0;   /* framing lost */
+    conn_reply_now(s, c, status, &b);
+    json_writer_free(&b);
+}
+
+/** Value of header name (case-insensitive) in [hdr, end), or NULL */
+static const char *find_header(const char *hdr, const char *end, const char *name) {
+    size_t n = strlen(name);
+    for (const char *p = hdr; p < end; ) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) eol = end;
+        if ((size_t)(eol - p) > n && strncasecmp(p, name, n) == 0 && p[n] == ':') {
+            p += n + 1;
+            while (p < eol && (*p == ' ' || *p == '\t')) p++;
+            return p;
+        }
+        p = eol + 1;
+    }
+    return NULL;
+}
+
+/**
+ * Parse the head of the request at the start of c->in, resuming the
+ * terminator search where the last call stopped, and size the buffer for
+ * its body. Returns 1 once parsed, 0 if more input is needed, -1 if the
+ * request was rejected (or the connection closed).
+ */
+static int conn_parse_head(Server *s, Conn *c) {
+    const char *buf = c->in.data;
+    size_t len = c->in.len;
+    const char *header_end = NULL;
+
+    for (size_t i = c->scan_pos > 3 ? c->scan_pos - 3 : 0; i < len; ) {
+        const char *cr = memchr(buf + i, '\r', len - i);
+        if (!cr || (size_t)(cr - buf) + 4 > len) break;
+        if (memcmp(cr, "\r\n\r\n", 4) == 0) {
+            header_end = cr;
+            break;
+        }
+        i = (size_t)(cr - buf) + 1;
+    }
+    if (!header_end) {
+        c->scan_pos = len;
+        if (len > MAX_HEADER_SIZE) {
+            conn_reply_error(s, c, 431, -32600, "Request headers too large");
+            return -1;
+        }
         return 0;
     }
+    size_t header_len = (size_t)(header_end - buf) + 4;
+
+    if (find_header(buf, header_end, "Transfer-Encoding")) {
+        conn_reply_error(s, c, 411, -32600, "Chunked bodies are not supported; send Content-Length");
+        return -1;
+    }
+
+    unsigned long long content_length = 0;
+    const char *cl = find_header(buf, header_end, "Content-Length");
+    if (cl) {
+        char *end;
+        errno = 0;
+        content_length = strtoull(cl, &end, 10);
+        while (*end == ' ' || *end == '\t') end++;
+        if (cl == end || *cl == '-' || errno != 0 || (*end != '\r' && *end != '\n')) {
+            conn_reply_error(s, c, 400, -32600, "Invalid Content-Length");
+            return -1;
+        }
+    }
+    if (content_length > s->opts.max_request_bytes) {
+        conn_reply_error(s, c, 413, -32600, "Request body too large");
+        return -1;
+    }
+
+    /* Room for the whole request and its terminator, allocated once */
+    size_t need = header_len + (size_t)content_length;
+    if (c->in.cap < need + 1) {
+        char *grown = realloc(c->in.data, need + 1);
+        if (!grown) {
+            conn_close(s, c);
+            return -1;
+        }
+        c->in.data = grown;
+        c->in.cap = need + 1;
+        buf = grown;
+    }
+
+    /* HTTP/1.1 keeps the connection unless told otherwise; 1.0 the reverse */
+    const char *eol = memchr(buf, '\r', header_len);
+    int http10 = eol && eol - buf >= 8 && memcmp(eol - 8, "HTTP/1.0", 8) == 0;
+    const char *conn_hdr = find_header(buf, header_end, "Connection");
+    if (conn_hdr && strncasecmp(conn_hdr, "close", 5) == 0) c->keep_alive = 0;
+    else if (conn_hdr && strncasecmp(conn_hdr, "keep-alive", 10) == 0) c->keep_alive = 1;
+    else c->keep_alive = !http10;
+
+    c->preflight = strncmp(buf, "OPTIONS", 7) == 0;
+    c->metrics = strncmp(buf, "GET /metrics", 12) == 0 &&
+                 (buf[12] == ' ' || buf[12] == '?');
+    c->header_len = header_len;
+    c->body_len = (size_t)content_length;
+    return 1;
+}
+
+static void metric_header(JsonWriter *out, const char *name, const char *type,
+                          const char *help) {
+    char line[256];
+    int n = snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    json_put_raw(out, line, (size_t)n);
+}
+
+/* One sample: name{labels} value; labels may be NULL */
+static void metric_value(JsonWriter *out, const char *name, const char *labels, double value) {
+    char line[256];
+    int n = snprintf(line, sizeof(line), "%s%s%s%s %.9g\n", name,
+                     labels ? "{" : "", labels ? labels : "", labels ? "}" : "", value);
+    json_put_raw(out, line, (size_t)n);
+}
+
+/**
+ * The Prometheus text exposition for GET /metrics: call counts, request
+ * phase time, placement search counters, the result cache and the queue.
+ * Runs on the event thread, so queued and connections are read directly.
+ */
+static void render_metrics(Server *s, JsonWriter *out) {
+    MetricTotals m;
+    ServerMetrics *live = &s->rpc.metrics;
+    pthread_mutex_lock(&live->lock);
+    m = live->totals;
+    pthread_mutex_unlock(&live->lock);
+
+    char labels[96];
+    metric_header(out, "cargoforge_calls_total", "counter", "JSON-RPC calls answered, by method.");
+    for (int k = 0; k < METRIC_METHOD_COUNT; k++) {
+        snprintf(labels, sizeof(labels), "method=\"%s\"", METRIC_METHODS[k]);
+        metric_value(out, "cargoforge_calls_total", labels, (double)m.calls[k]);
+    }
+    metric_header(out, "cargoforge_call_errors_total", "counter",
+                  "JSON-RPC calls answered with an error.");
+    metric_value(out, "cargoforge_call_errors_total", NULL, (double)m.errors);
+
+    metric_header(out, "cargoforge_phase_seconds", "summary",
+                  "Time spent in each phase of optimize and validate calls.");
+    for (int p = 0; p < METRIC_PHASE_COUNT; p++) {
+        snprintf(labels, sizeof(labels), "phase=\"%s\"", METRIC_PHASES[p]);
+        metric_value(out, "cargoforge_phase_seconds_sum", labels, m.phase_ms[p] / 1000.0);
+        metric_value(out, "cargoforge_phase_seconds_count", labels, (double)m.phase_runs[p]);
+    }
+
+    metric_header(out, "cargoforge_placement_items_total", "counter",
+                  "Cargo items the placement search was run for.");
+    metric_value(out, "cargoforge_placement_items_total", NULL, (double)m.items_searched);
+    metric_header(out, "cargoforge_placement_spaces_scanned_total", "counter",
+                  "Candidate free spaces the placement search looked at.");
+    metric_value(out, "cargoforge_placement_spaces_scanned_total", NULL, (double)m.spaces_scanned);
+    metric_header(out, "cargoforge_placement_rejections_total", "counter",
+                  "Candidate spaces rejected by a cargo constraint, by reason.");
+    for (int k = CF_DIAG_POINT_LOAD; k <= CF_DIAG_DECK_WEIGHT; k++) {
+        char reason[32];
+        diag_label(k, reason, sizeof(reason));
+        snprintf(labels, sizeof(labels), "reason=\"%s\"", reason);
+        metric_value(out, "cargoforge_placement_rejections_total", labels, (double)m.counts[k]);
+    }
+    metric_header(out, "cargoforge_placement_unplaced_total", "counter",
+                  "Cargo items no free space could take.");
+    metric_value(out, "cargoforge_placement_unplaced_total", NULL,
+                 (double)m.counts[CF_DIAG_UNPLACED]);
+
+    CfCacheStats cs;
+    memset(&cs, 0, sizeof(cs));
+    if (s->rpc.cache) cargoforge_cache_stats(s->rpc.cache, &cs);
+    metric_header(out, "cargoforge_cache_hits_total", "counter", "optimize results served from the cache.");
+    metric_value(out, "cargoforge_cache_hits_total", NULL, (double)cs.hits);
+    metric_header(out, "cargoforge_cache_misses_total", "counter", "optimize results computed.");
+    metric_value(out, "cargoforge_cache_misses_total", NULL, (double)cs.misses);
+    metric_header(out, "cargoforge_cache_evictions_total", "counter",
+                  "Cache entries dropped to stay within the bound.");
+    metric_value(out, "cargoforge_cache_evictions_total", NULL, (double)cs.evictions);
+    metric_header(out, "cargoforge_cache_bytes", "gauge", "Bytes held by the result cache.");
+    metric_value(out, "cargoforge_cache_bytes", NULL, (double)cs.bytes);
+
+    metric_header(out, "cargoforge_queued_calls", "gauge", "Calls queued or running on the workers.");
+    metric_value(out, "cargoforge_queued_calls", NULL, (double)s->queued);
+    metric_header(out, "cargoforge_connections", "gauge", "Open client connections.");
+    metric_value(out, "cargoforge_connections", NULL, (double)s->conn_count);
+}
+
+/** Drop the current request from c->in, keeping pipelined bytes after it */
+static void conn_consume(Conn *c) {
+    size_t used = c->header_len + c->body_len;
+    memmove(c->in.data, c->in.data + used, c->in.len - used + 1);
+    c->in.len -= used;
+    c->header_len = c->body_len = c->scan_pos = 0;
+
+    /* Don't let one large upload pin its buffer for the connection's life */
+    if (c->in.cap > KEEP_BUF_SIZE && c->in.len < RECV_BUF_SIZE) {
+        char *shrunk = realloc(c->in.data, RECV_BUF_SIZE + 1);
+        if (shrunk) {
+            c->in.data = shrunk;
+            c->in.cap = RECV_BUF_SIZE + 1;
+        }
+    }
+}
+
+/**
+ * Frame and route the next complete request buffered on c, if any.
+ * Requests on one connection are served in order, one at a time. The
+ * body is handled where it was received: no copy is made for workers.
+ */
+static void conn_process(Server *s, Conn *c) {
+    if (c->busy || c->out.len > 0 || c->in.len == 0) return;
+    if (!c->header_len && conn_parse_head(s, c) <= 0) return;
+    if (c->in.len < c->header_len + c->body_len) return;   /* need more */
+
+    char *body = c->in.data + c->header_len;
+    char saved = body[c->body_len];
+    body[c->body_len] = '\0';
 
     /* Handle CORS preflight */
-    if (strncmp(buf, "OPTIONS", 7) == 0) {
-        send_response(client_fd, 200, "");
-        free(buf);
-        return 0;
+    if (c->preflight) {
+        body[c->body_len] = saved;
+        conn_consume(c);
+        conn_reply_now(s, c, 200, NULL);
+        return;
+    }
+    if (c->metrics) {
+        JsonWriter out = {0};
+        body[c->body_len] = saved;
+        conn_consume(c);
+        render_metrics(s, &out);
+        if (out.oom) {
+            json_writer_free(&out);
+            conn_close(s, c);
+            return;
+        }
+        conn_respond(c, 200, "text/plain; version=0.0.4", out.data, out.len);
+        conn_send(s, c);
+        json_writer_free(&out);
+        return;
+    }
+    if (c->body_len == 0) {
+        body[c->body_len] = saved;
+        conn_consume(c);
+        conn_reply_error(s, c, 200, -32700, "Parse error: empty body");
+        return;
     }
 
-    /* Find body */
-    char *body = strstr(buf, "\r\n\r\n");
-    if (body) body += 4;
+    Job *j = calloc(1, sizeof(Job));
+    if (!j) {
+        body[c->body_len] = saved;
+        conn_close(s, c);
+        return;
+    }
+    rpc_parse(&j->req, body, c->body_len, s->opts.max_batch);
+    RpcCall *first = &j->req.calls[0];
+
+    /* Whole-body errors and health checks are answered right here: the
+       latter must not wait behind a queue of optimize calls */
+    int inline_reply = j->req.error ||
+        (!j->req.batch && !first->error && (json_span_is(&first->method, "version") ||
+                                            json_span_is(&first->method, "cache_stats")));
+    int n = j->req.count;
+    int full = s->queued > 0 && s->queued + n > s->opts.queue_depth;
+
+    if (inline_reply || full) {
+        JsonWriter out = {0};
+        if (j->req.error) {
+            jsonrpc_error(&out, NULL, j->req.error, j->req.message);
+        } else if (inline_reply) {
+            rpc_execute(first, &s->rpc);
+            rpc_collect(&j->req, &out);
+        }
+        rpc_request_free(&j->req);
+        free(j);
+        body[c->body_len] = saved;
+        conn_consume(c);
 
-    if (!body || *body == '\0') {
-        send_jsonrpc_error(client_fd, 0, -32700, "Parse error: empty body");
-        free(buf);
-        return 0;
+        if (inline_reply) {
+            conn_reply_now(s, c, 200, &out);
+        } else {
+            if (s->opts.verbose) fprintf(stderr, "[cargoforge] queue full, rejecting request\n");
+            conn_reply_error(s, c, 503, -32000, "Server busy, retry later");
+        }
+        json_writer_free(&out);
+        return;
     }
 
-    dispatch_request(client_fd, body, verbose);
-    free(buf);
-    return 0;
+    j->conn = c;
+    j->body = body;
+    j->saved = saved;
+    j->server = s;
+    j->remaining = n;
+    s->queued += n;
+    c->busy = 1;
+    ev_watch(s->ev, c->fd, c, 0, 0, 0);      /* quiet until the response is ready */
+
+    /* Batch calls run concurrently; a call the pool cannot take runs here */
+    for (int i = 0; i < n; i++) {
+        RpcCall *call = &j->req.calls[i];
+        call->job = j;
+        if (thread_pool_submit(s->pool, worker_run_call, call) != 0)
+            worker_run_call(call);
+    }
+}
+
+/** Fold finished jobs into their connections' output */
+static void collect_jobs(Server *s) {
+    char drain[64];
+    while (read(s->wake_rd, drain, sizeof(drain)) > 0) {}
+
+    pthread_mutex_lock(&s->lock);
+    Job *j = s->done;
+    s->done = NULL;
+    pthread_mutex_unlock(&s->lock);
+
+    while (j) {
+        Job *next = j->next;
+        Conn *c = j->conn;
+        JsonWriter out = {0};
+        rpc_collect(&j->req, &out);
+
+        s->queued -= j->req.count;
+        c->busy = 0;
+        c->last_active = time(NULL);
+        j->body[c->body_len] = j->saved;
+        conn_consume(c);
+        if (c->closing) {
+            conn_close(s, c);
+        } else if (out.oom) {
+            c->keep_alive = 0;
+            conn_reply_error(s, c, 200, -32603, "Internal error");
+        } else {
+            conn_reply_now(s, c, 200, &out);
+        }
+        json_writer_free(&out);
+        rpc_request_free(&j->req);
+        free(j);
+        j = next;
+    }
+}
+
+/**
+ * Read what the socket has. Once a request's head is parsed its body is
+ * received straight into the space reserved for it.
+ */
+static void conn_read(Server *s, Conn *c) {
+    for (;;) {
+        size_t want = RECV_BUF_SIZE;
+        size_t need = c->header_len + c->body_len;
+        if (c->header_len && c->in.len < need) {
+            want = need - c->in.len;             /* already reserved */
+        } else if (json_writer_reserve(&c->in, RECV_BUF_SIZE) != 0) {
+            conn_close(s, c);
+            return;
+        }
+
+        ssize_t n = recv(c->fd, c->in.data + c->in.len, want, 0);
+        if (n > 0) {
+            c->in.len += (size_t)n;
+            c->in.data[c->in.len] = '\0';
+            c->last_active = time(NULL);
+            if (!c->header_len) {
+                int rc = conn_parse_head(s, c);
+                if (rc < 0) return;
+                if (rc == 0) continue;
+            }
+            if (c->in.len >= c->header_len + c->body_len) break;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        conn_close(s, c);            /* EOF or error */
+        return;
+    }
+    conn_process(s, c);
+}
+
+static void accept_clients(Server *s) {
+    while (s->conn_count < s->opts.max_connections) {
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        int fd = accept(s->listen_fd, (struct sockaddr *)&client_addr, &client_len);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+            return;
+        }
+
+        Conn *c = calloc(1, sizeof(Conn));
+        if (!c || set_nonblocking(fd) != 0 || ev_watch(s->ev, fd, c, 1, 0, 1) != 0) {
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->keep_alive = 1;
+        c->last_active = time(NULL);
+        c->next = s->conns;
+        if (s->conns) s->conns->prev = c;
+        s->conns = c;
+        s->conn_count++;
+
+        if (s->opts.verbose) {
+            fprintf(stderr, "[cargoforge] Connection from %s:%d\n",
+                    inet_ntoa(client_addr.sin_addr),
+                    ntohs(client_addr.sin_port));
+        }
+    }
+
+    /* At the connection limit: leave new clients in the kernel backlog */
+    if (ev_watch(s->ev, s->listen_fd, &LISTENER_TAG, 0, 0, 0) == 0)
+        s->listening = 0;
+}
+
+/** Drop keep-alive connections idle past the timeout */
+static void sweep_idle(Server *s, time_t now) {
+    for (Conn *c = s->conns, *next; c; c = next) {
+        next = c->next;
+        if (!c->busy && c->out.len == 0 &&
+            now - c->last_active >= s->opts.keepalive_timeout_s)
+            conn_close(s, c);
+    }
 }
 
 /* ------------------------------------------------------------------ */
 /* SERVER MAIN LOOP                                                   */
 /* ------------------------------------------------------------------ */
 
-int cargoforge_serve(int port, int verbose) {
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
-    signal(SIGPIPE, SIG_IGN);
-
+static int open_listener(int port) {
     int server_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (server_fd < 0) {
         perror("socket");
@@ -400,39 +1506,146 @@ int cargoforge_serve(int port, int verbose) {
         return -1;
     }
 
-    if (listen(server_fd, 8) < 0) {
+    if (listen(server_fd, SOMAXCONN) < 0 || set_nonblocking(server_fd) != 0) {
         perror("listen");
         close(server_fd);
         return -1;
     }
+    return server_fd;
+}
 
-    fprintf(stderr, "CargoForge JSON-RPC server v%s\n", cargoforge_version());
-    fprintf(stderr, "Listening on http://0.0.0.0:%d\n", port);
-    fprintf(stderr, "Press Ctrl+C to stop\n\n");
+int cargoforge_serve_opts(const ServerOptions *opts) {
+    Server s;
+    memset(&s, 0, sizeof(s));
+    s.opts = *opts;
+    if (s.opts.queue_depth < 1) s.opts.queue_depth = 1;
+    if (s.opts.max_connections < 1) s.opts.max_connections = 1;
+    if (s.opts.keepalive_timeout_s < 1) s.opts.keepalive_timeout_s = 1;
+    if (s.opts.max_batch < 1) s.opts.max_batch = 1;
 
-    while (server_running) {
-        struct sockaddr_in client_addr;
-        socklen_t client_len = sizeof(client_addr);
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
 
-        int client_fd = accept(server_fd, (struct sockaddr *)&client_addr,
-                               &client_len);
-        if (client_fd < 0) {
-            if (errno == EINTR) continue;
-            perror("accept");
-            continue;
+    s.listen_fd = open_listener(s.opts.port);
+    if (s.listen_fd < 0) return -1;
+
+    int pipe_fds[2];
+    s.ev = ev_create();
+    if (s.ev < 0 || pipe(pipe_fds) != 0) {
+        perror("event setup");
+        if (s.ev >= 0) close(s.ev);
+        close(s.listen_fd);
+        return -1;
+    }
+    s.wake_rd = pipe_fds[0];
+    s.wake_wr = pipe_fds[1];
+    set_nonblocking(s.wake_rd);
+    set_nonblocking(s.wake_wr);
+    pthread_mutex_init(&s.lock, NULL);
+
+    /* Workers inherit a mask without SIGINT/SIGTERM, so the event thread gets them */
+    sigset_t block, old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    sigaddset(&block, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    s.pool = thread_pool_create(s.opts.workers);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    s.rpc.verbose = s.opts.verbose;
+    pthread_mutex_init(&s.rpc.metrics.lock, NULL);
+    templates_init(&s.rpc.templates, s.opts.max_templates);
+    /* One per worker, plus the event thread for calls the pool refuses */
+    handles_init(&s.rpc.handles, thread_pool_size(s.pool) + 1);
+    if (s.opts.cache_bytes > 0 && cargoforge_cache_open(&s.rpc.cache, s.opts.cache_bytes) != CF_OK)
+        fprintf(stderr, "Error: Could not allocate the result cache; serving without it\n");
+
+    int rc = -1;
+    if (!s.pool) {
+        fprintf(stderr, "Error: Could not start server worker threads\n");
+    } else if (ev_watch(s.ev, s.listen_fd, &LISTENER_TAG, 1, 0, 1) != 0 ||
+               ev_watch(s.ev, s.wake_rd, &WAKE_TAG, 1, 0, 1) != 0) {
+        perror("event setup");
+    } else {
+        s.listening = 1;
+        rc = 0;
+    }
+
+    if (rc == 0) {
+        fprintf(stderr, "CargoForge JSON-RPC server v%s\n", cargoforge_version());
+        fprintf(stderr, "Listening on http://0.0.0.0:%d (%d workers, queue depth %d, "
+                "result cache %zu MiB)\n", s.opts.port, thread_pool_size(s.pool),
+                s.opts.queue_depth, s.rpc.cache ? s.opts.cache_bytes >> 20 : 0);
+        fprintf(stderr, "Press Ctrl+C to stop\n\n");
+    }
+
+    time_t last_sweep = time(NULL);
+    EvEvent events[MAX_EVENTS];
+    while (rc == 0 && server_running) {
+        int n = ev_wait(s.ev, events, MAX_EVENTS, 1000);
+        if (n < 0 && errno != EINTR) {
+            perror("event wait");
+            rc = -1;
+            break;
         }
 
-        if (verbose) {
-            fprintf(stderr, "[cargoforge] Connection from %s:%d\n",
-                    inet_ntoa(client_addr.sin_addr),
-                    ntohs(client_addr.sin_port));
+        for (int i = 0; i < n; i++) {
+            void *ptr = events[i].ptr;
+            if (ptr == &LISTENER_TAG) {
+                accept_clients(&s);
+            } else if (ptr == &WAKE_TAG) {
+                collect_jobs(&s);
+            } else {
+                /* Closed earlier in this batch: not freed until it ends */
+                Conn *c = ptr;
+                if (c->closing && !c->busy) continue;
+                if (c->busy) {
+                    /* Only errors and hang-ups are reported while busy */
+                    c->closing = 1;
+                    ev_forget(s.ev, c->fd);
+                } else if (c->out_sent < c->out.len) {
+                    if (events[i].writable && conn_flush(&s, c) == 1) conn_process(&s, c);
+                } else if (events[i].readable) {
+                    conn_read(&s, c);
+                }
+            }
         }
 
-        handle_client(client_fd, verbose);
-        close(client_fd);
+        time_t now = time(NULL);
+        if (now != last_sweep) {
+            sweep_idle(&s, now);
+            last_sweep = now;
+        }
+        free_closed(&s);
     }
 
-    close(server_fd);
-    fprintf(stderr, "\nServer stopped.\n");
-    return 0;
+    /* Finish queued work, then drop every connection */
+    thread_pool_destroy(s.pool);
+    if (s.pool) collect_jobs(&s);
+    while (s.conns) {
+        s.conns->busy = 0;
+        conn_close(&s, s.conns);
+    }
+    free_closed(&s);
+
+    cargoforge_cache_close(s.rpc.cache);
+    templates_free(&s.rpc.templates);
+    handles_free(&s.rpc.handles);
+    pthread_mutex_destroy(&s.rpc.metrics.lock);
+    pthread_mutex_destroy(&s.lock);
+    close(s.wake_rd);
+    close(s.wake_wr);
+    close(s.ev);
+    close(s.listen_fd);
+    if (rc == 0) fprintf(stderr, "\nServer stopped.\n");
+    return rc;
+}
+
+int cargoforge_serve(int port, int verbose) {
+    ServerOptions opts;
+    server_options_init(&opts);
+    opts.port = port;
+    opts.verbose = verbose;
+    return cargoforge_serve_opts(&opts);
 }
@@ -0,0 +1,145 @@
+/*
+ * spatial_index.c - Uniform-grid spatial index over placed cargo
+ *
+ * Each placed item is appended to a flat entry array and referenced from
+ * every grid cell its footprint overlaps. A query walks only the cells the
+ * query rectangle covers and reports an entry from the first cell that both
+ * the entry and the query share, which deduplicates multi-cell items
+ * without any per-query scratch state.
+ */
+
+#include "spatial_index.h"
+#include "imdg.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static int clamp_cell(int v, int max) {
+    if (v < 0) return 0;
+    if (v >= max) return max - 1;
+    return v;
+}
+
+static int cell_col(const SpatialIndex *idx, float x) {
+    return clamp_cell((int)floorf(x / idx->cell_size), idx->cols);
+}
+
+static int cell_row(const SpatialIndex *idx, float y) {
+    return clamp_cell((int)floorf(y / idx->cell_size), idx->rows);
+}
+
+/* Grow an int array geometrically. Returns 0 on success, -1 on failure. */
+static int push_int(int **arr, int *count, int *capacity, int value) {
+    if (*count >= *capacity) {
+        int new_cap = (*capacity > 0) ? *capacity * 2 : 8;
+        int *grown = realloc(*arr, (size_t)new_cap * sizeof(int));
+        if (!grown) return -1;
+        *arr = grown;
+        *capacity = new_cap;
+    }
+    (*arr)[(*count)++] = value;
+    return 0;
+}
+
+SpatialIndex *spatial_index_create(float length, float width, float cell_size) {
+    if (cell_size <= 0.0f) cell_size = SPATIAL_CELL_SIZE;
+
+    SpatialIndex *idx = calloc(1, sizeof(SpatialIndex));
+    if (!idx) return NULL;
+
+    idx->cell_size = cell_size;
+    idx->cols = (int)ceilf(length / cell_size);
+    idx->rows = (int)ceilf(width / cell_size);
+    if (idx->cols < 1) idx->cols = 1;
+    if (idx->rows < 1) idx->rows = 1;
+
+    idx->cells = calloc((size_t)idx->cols * (size_t)idx->rows, sizeof(SpatialCell));
+    if (!idx->cells) {
+        free(idx);
+        return NULL;
+    }
+    return idx;
+}
+
+void spatial_index_destroy(SpatialIndex *idx) {
+    if (!idx) return;
+
+    int n = idx->cols * idx->rows;
+    for (int i = 0; i < n; i++)
+        free(idx->cells[i].entries);
+    free(idx->cells);
+    free(idx->entries);
+    free(idx->dg_items);
+    free(idx);
+}
+
+int spatial_index_insert(SpatialIndex *idx, const Cargo *cargo, int cargo_idx) {
+    if (!idx || !cargo) return -1;
+
+    if (idx->entry_count >= idx->entry_capacity) {
+        int new_cap = (idx->entry_capacity > 0) ? idx->entry_capacity * 2 : 64;
+        SpatialEntry *grown = realloc(idx->entries, (size_t)new_cap * sizeof(SpatialEntry));
+        if (!grown) return -1;
+        idx->entries = grown;
+        idx->entry_capacity = new_cap;
+    }
+
+    SpatialEntry *e = &idx->entries[idx->entry_count];
+    e->x0 = cargo->pos_x;
+    e->y0 = cargo->pos_y;
+    e->x1 = cargo->pos_x + cargo->dimensions[0];
+    e->y1 = cargo->pos_y + cargo->dimensions[1];
+    e->col0 = cell_col(idx, e->x0);
+    e->row0 = cell_row(idx, e->y0);
+    e->cargo_idx = cargo_idx;
+
+    int col1 = cell_col(idx, e->x1);
+    int row1 = cell_row(idx, e->y1);
+    int entry = idx->entry_count;
+
+    for (int r = e->row0; r <= row1; r++) {
+        for (int c = e->col0; c <= col1; c++) {
+            SpatialCell *cell = &idx->cells[r * idx->cols + c];
+            if (push_int(&cell->entries, &cell->count, &cell->capacity, entry) != 0)
+                return -1;
+        }
+    }
+    idx->entry_count++;
+
+    if (cargo->dg) {
+        if (push_int(&idx->dg_items, &idx->dg_count, &idx->dg_capacity, cargo_idx) != 0)
+            return -1;
+        int cls = imdg_cargo_class(cargo);
+        if (cls >= 0) idx->dg_classes |= 1u << cls;
+    }
+
+    return 0;
+}
+
+int spatial_index_query(const SpatialIndex *idx, float x0, float y0,
+                        float x1, float y1, SpatialVisitFn fn, void *ctx) {
+    if (!idx || !fn || idx->entry_count == 0) return 0;
+
+    int qc0 = cell_col(idx, x0), qc1 = cell_col(idx, x1);
+    int qr0 = cell_row(idx, y0), qr1 = cell_row(idx, y1);
+
+    for (int r = qr0; r <= qr1; r++) {
+        for (int c = qc0; c <= qc1; c++) {
+            const SpatialCell *cell = &idx->cells[r * idx->cols + c];
+
+            for (int k = 0; k < cell->count; k++) {
+                const SpatialEntry *e = &idx->entries[cell->entries[k]];
+
+                /* Report each entry only from the first cell it shares with the query */
+                int home_c = (e->col0 > qc0) ? e->col0 : qc0;
+                int home_r = (e->row0 > qr0) ? e->row0 : qr0;
+                if (c != home_c || r != home_r) continue;
+
+                if (e->x1 < x0 || e->x0 > x1 || e->y1 < y0 || e->y0 > y1) continue;
+
+                if (fn(e->cargo_idx, ctx)) return 1;
+            }
+        }
+    }
+    return 0;
+}
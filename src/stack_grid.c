@@ -0,0 +1,133 @@
+/*
+ * stack_grid.c - Plan-view weight grid over placed cargo
+ *
+ * Each placed item is copied into every cell its footprint overlaps, at
+ * the position that keeps the cell sorted by height. A query walks each
+ * covered cell from the top and stops at the first entry at or below its
+ * floor. An item spanning several cells is counted in the first cell
+ * both it and the query share, so nothing is added twice.
+ */
+
+#include "stack_grid.h"
+#include <stdlib.h>
+#include <math.h>
+
+static int clamp_cell(int v, int max) {
+    if (v < 0) return 0;
+    if (v >= max) return max - 1;
+    return v;
+}
+
+static int cell_col(const StackGrid *g, float x) {
+    return clamp_cell((int)floorf(x / g->cell_size), g->cols);
+}
+
+static int cell_row(const StackGrid *g, float y) {
+    return clamp_cell((int)floorf(y / g->cell_size), g->rows);
+}
+
+StackGrid *stack_grid_create(float length, float width, float cell_size) {
+    if (cell_size <= 0.0f) cell_size = STACK_CELL_SIZE;
+
+    StackGrid *g = calloc(1, sizeof(StackGrid));
+    if (!g) return NULL;
+
+    g->cell_size = cell_size;
+    g->cols = (int)ceilf(length / cell_size);
+    g->rows = (int)ceilf(width / cell_size);
+    if (g->cols < 1) g->cols = 1;
+    if (g->rows < 1) g->rows = 1;
+
+    g->cells = calloc((size_t)g->cols * (size_t)g->rows, sizeof(StackCell));
+    if (!g->cells) {
+        free(g);
+        return NULL;
+    }
+    return g;
+}
+
+void stack_grid_destroy(StackGrid *grid) {
+    if (!grid) return;
+
+    int n = grid->cols * grid->rows;
+    for (int i = 0; i < n; i++)
+        free(grid->cells[i].entries);
+    free(grid->cells);
+    free(grid);
+}
+
+/* Insert below every entry standing at least as high. Plans are mostly
+ * built bottom-up, so the new entry usually goes in first place after a
+ * short shift. */
+static int cell_insert(StackCell *cell, const StackEntry *e) {
+    if (cell->count >= cell->capacity) {
+        int new_cap = cell->capacity > 0 ? cell->capacity * 2 : 4;
+        StackEntry *grown = realloc(cell->entries, (size_t)new_cap * sizeof(StackEntry));
+        if (!grown) return -1;
+        cell->entries = grown;
+        cell->capacity = new_cap;
+    }
+    int k = cell->count++;
+    while (k > 0 && cell->entries[k - 1].z < e->z) {
+        cell->entries[k] = cell->entries[k - 1];
+        k--;
+    }
+    cell->entries[k] = *e;
+    return 0;
+}
+
+int stack_grid_insert(StackGrid *grid, const Cargo *cargo) {
+    if (!grid || !cargo) return -1;
+
+    StackEntry e;
+    e.area = cargo->dimensions[0] * cargo->dimensions[1];
+    if (!(e.area > 0.01f)) return 0;
+    e.x0 = cargo->pos_x;
+    e.y0 = cargo->pos_y;
+    e.x1 = cargo->pos_x + cargo->dimensions[0];
+    e.y1 = cargo->pos_y + cargo->dimensions[1];
+    e.z = cargo->pos_z;
+    e.weight_t = cargo->weight / 1000.0f;
+    e.col0 = cell_col(grid, e.x0);
+    e.row0 = cell_row(grid, e.y0);
+
+    int col1 = cell_col(grid, e.x1);
+    int row1 = cell_row(grid, e.y1);
+    for (int r = e.row0; r <= row1; r++) {
+        for (int c = e.col0; c <= col1; c++) {
+            if (cell_insert(&grid->cells[r * grid->cols + c], &e) != 0)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+float stack_grid_weight(const StackGrid *grid, float x, float y, float w, float d,
+                        float z_lo, float z_hi) {
+    float x1 = x + w, y1 = y + d;
+    int col0 = cell_col(grid, x), col1 = cell_col(grid, x1);
+    int row0 = cell_row(grid, y), row1 = cell_row(grid, y1);
+    float total = 0.0f;
+
+    for (int r = row0; r <= row1; r++) {
+        for (int c = col0; c <= col1; c++) {
+            const StackCell *cell = &grid->cells[r * grid->cols + c];
+            for (int k = 0; k < cell->count; k++) {
+                const StackEntry *e = &cell->entries[k];
+                if (!(e->z > z_lo)) break;
+                if (!(e->z < z_hi)) continue;
+
+                // Count the entry once, in the first cell it shares with the query
+                if ((e->col0 > col0 ? e->col0 : col0) != c ||
+                    (e->row0 > row0 ? e->row0 : row0) != r)
+                    continue;
+
+                float overlap_x = fminf(e->x1, x1) - fmaxf(e->x0, x);
+                float overlap_y = fminf(e->y1, y1) - fmaxf(e->y0, y);
+                if (overlap_x > 0 && overlap_y > 0)
+                    total += e->weight_t * ((overlap_x * overlap_y) / e->area);
+            }
+        }
+    }
+    return total;
+}
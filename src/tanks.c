@@ -8,6 +8,104 @@
 #include <string.h>
 #include <math.h>
 
+int tank_config_add(TankConfig *config, const Tank *tank) {
+    if (config->count >= config->capacity) {
+        int new_cap = (config->capacity > 0) ? config->capacity * 2 : 16;
+        Tank *grown = realloc(config->tanks, (size_t)new_cap * sizeof(Tank));
+        if (!grown) return -1;
+        config->tanks = grown;
+        config->capacity = new_cap;
+    }
+    config->tanks[config->count++] = *tank;
+    return 0;
+}
+
+int tank_config_find(const TankConfig *config, const char *id) {
+    for (int i = 0; i < config->count; i++)
+        if (strcmp(config->tanks[i].id, id) == 0) return i;
+    return -1;
+}
+
+int tank_add_sounding(Tank *tank, const TankSoundingPoint *p) {
+    if (!isfinite(p->sounding) || !isfinite(p->volume) || !isfinite(p->vcg) ||
+        !isfinite(p->inertia) || p->sounding < 0.0f || p->volume < 0.0f ||
+        p->inertia < 0.0f)
+        return -1;
+    if (tank->table_count > 0) {
+        const TankSoundingPoint *last = &tank->table[tank->table_count - 1];
+        if (!(p->sounding > last->sounding) || p->volume < last->volume) return -1;
+    }
+
+    if (tank->table_count >= tank->table_capacity) {
+        int new_cap = (tank->table_capacity > 0) ? tank->table_capacity * 2 : 8;
+        TankSoundingPoint *grown = realloc(tank->table, (size_t)new_cap * sizeof(*grown));
+        if (!grown) return -1;
+        tank->table = grown;
+        tank->table_capacity = new_cap;
+    }
+    tank->table[tank->table_count++] = *p;
+    return 0;
+}
+
+int tank_config_copy(TankConfig *dst, const TankConfig *src) {
+    memset(dst, 0, sizeof(*dst));
+    if (src->count == 0) return 0;
+
+    dst->tanks = malloc((size_t)src->count * sizeof(Tank));
+    if (!dst->tanks) return -1;
+    dst->capacity = src->count;
+
+    for (int i = 0; i < src->count; i++) {
+        Tank *t = &dst->tanks[i];
+        *t = src->tanks[i];
+        dst->count = i + 1;
+        if (!t->table) continue;
+
+        t->table = malloc((size_t)t->table_count * sizeof(TankSoundingPoint));
+        if (!t->table) {
+            t->table_count = t->table_capacity = 0;
+            tank_config_free(dst);
+            return -1;
+        }
+        memcpy(t->table, src->tanks[i].table, (size_t)t->table_count * sizeof(TankSoundingPoint));
+        t->table_capacity = t->table_count;
+    }
+    return 0;
+}
+
+void tank_config_free(TankConfig *config) {
+    if (!config) return;
+    for (int i = 0; i < config->count; i++)
+        free(config->tanks[i].table);
+    free(config->tanks);
+    config->tanks = NULL;
+    config->count = 0;
+    config->capacity = 0;
+}
+
+/* "sounding,ID,sounding_m,volume_m3,vcg_m,inertia_m4" */
+static int parse_sounding_line(TankConfig *config, const char *line, int line_num) {
+    char id[32];
+    TankSoundingPoint p;
+    if (sscanf(line, "sounding,%31[^,],%f,%f,%f,%f",
+               id, &p.sounding, &p.volume, &p.vcg, &p.inertia) != 5) {
+        fprintf(stderr, "Error: Malformed sounding entry at line %d\n", line_num);
+        return -1;
+    }
+    int i = tank_config_find(config, id);
+    if (i < 0) {
+        fprintf(stderr, "Error: Sounding entry at line %d names unknown tank '%s'\n",
+                line_num, id);
+        return -1;
+    }
+    if (tank_add_sounding(&config->tanks[i], &p) != 0) {
+        fprintf(stderr, "Error: Invalid or out-of-order sounding for tank '%s' at line %d\n",
+                id, line_num);
+        return -1;
+    }
+    return 0;
+}
+
 int parse_tank_config(const char *filename, TankConfig *config) {
     if (!filename || !config) return -1;
 
@@ -21,6 +119,7 @@ int parse_tank_config(const char *filename, TankConfig *config) {
 
     char line[512];
     int line_num = 0;
+    int rc = 0;
 
     while (fgets(line, sizeof(line), fp)) {
         line_num++;
@@ -32,13 +131,17 @@ int parse_tank_config(const char *filename, TankConfig *config) {
         if (line[0] == '#' || line[0] == '\n' || line[0] == '\0')
             continue;
 
-        if (config->count >= MAX_TANKS) {
-            fprintf(stderr, "Warning: Tank config exceeds %d entries, truncating\n",
-                    MAX_TANKS);
-            break;
+        if (strncmp(line, "sounding,", 9) == 0) {
+            if (parse_sounding_line(config, line, line_num) != 0) {
+                rc = -1;
+                break;
+            }
+            continue;
         }
 
-        Tank *t = &config->tanks[config->count];
+        Tank tank;
+        Tank *t = &tank;
+        memset(t, 0, sizeof(*t));
 
         /* Parse: id,length,breadth,height,pos_x,pos_y,pos_z,fill,density */
         char id_buf[32];
@@ -59,32 +162,214 @@ int parse_tank_config(const char *filename, TankConfig *config) {
         if (t->fill_fraction < 0.0f) t->fill_fraction = 0.0f;
         if (t->fill_fraction > 1.0f) t->fill_fraction = 1.0f;
 
-        config->count++;
+        if (tank_config_add(config, t) != 0) {
+            fprintf(stderr, "Error: Out of memory reading tank config\n");
+            rc = -1;
+            break;
+        }
     }
-
     fclose(fp);
-    return 0;
+
+    for (int i = 0; rc == 0 && i < config->count; i++) {
+        const Tank *t = &config->tanks[i];
+        if (t->table && (t->table_count < 2 || !(t->table[t->table_count - 1].volume > 0.0f))) {
+            fprintf(stderr, "Error: Sounding table of tank '%s' needs two points "
+                    "and a non-zero capacity\n", t->id);
+            rc = -1;
+        }
+    }
+    if (rc != 0) tank_config_free(config);
+    return rc;
 }
 
-float calculate_free_surface_moment(const Tank *tank) {
-    if (!tank) return 0.0f;
+/* ------------------------------------------------------------------ */
+/* Tank contents                                                      */
+/* ------------------------------------------------------------------ */
 
-    /* No free surface for empty or full tanks */
-    if (tank->fill_fraction <= 0.0f || tank->fill_fraction >= 1.0f)
-        return 0.0f;
+float tank_capacity(const Tank *tank) {
+    if (tank->table) return tank->table[tank->table_count - 1].volume;
+    return tank->length * tank->breadth * tank->height;
+}
 
-    /* FSM = rho * l * b^3 / 12 for rectangular tank */
-    return tank->density * tank->length * tank->breadth * tank->breadth * tank->breadth / 12.0f;
+/**
+ * First table row whose volume is above v, within [1, count-1], so the
+ * segment [k-1, k] brackets v (or is the end segment v lies beyond).
+ */
+static int table_segment_by_volume(const Tank *t, float v) {
+    int lo = 1, hi = t->table_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (t->table[mid].volume > v) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
 }
 
-float calculate_total_fsm(const TankConfig *config) {
-    if (!config) return 0.0f;
+/* Interpolate the liquid's VCG and free surface inertia at volume v */
+static void table_at_volume(const Tank *t, float v, float *vcg, float *inertia) {
+    const TankSoundingPoint *tab = t->table;
+    if (v <= tab[0].volume) {
+        *vcg = tab[0].vcg;
+        *inertia = tab[0].inertia;
+        return;
+    }
+    int k = table_segment_by_volume(t, v);
+    const TankSoundingPoint *a = &tab[k - 1], *b = &tab[k];
+    float span = b->volume - a->volume;
+    float u = span > 0.0f ? (v - a->volume) / span : 1.0f;
+    if (u > 1.0f) u = 1.0f;
+    *vcg = a->vcg + u * (b->vcg - a->vcg);
+    *inertia = a->inertia + u * (b->inertia - a->inertia);
+}
+
+static float clamp_fill(float f) {
+    if (!(f > 0.0f)) return 0.0f;
+    return f < 1.0f ? f : 1.0f;
+}
+
+float tank_fill_at_sounding(const Tank *tank, float sounding_m) {
+    if (!tank->table)
+        return tank->height > 0.0f ? clamp_fill(sounding_m / tank->height) : 0.0f;
+
+    const TankSoundingPoint *tab = tank->table;
+    int n = tank->table_count;
+    float cap = tab[n - 1].volume;
+    if (!(sounding_m > tab[0].sounding)) return clamp_fill(tab[0].volume / cap);
+    if (sounding_m >= tab[n - 1].sounding) return 1.0f;
+
+    int lo = 1, hi = n - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (tab[mid].sounding > sounding_m) hi = mid;
+        else lo = mid + 1;
+    }
+    const TankSoundingPoint *a = &tab[lo - 1], *b = &tab[lo];
+    float u = (sounding_m - a->sounding) / (b->sounding - a->sounding);
+    return clamp_fill((a->volume + u * (b->volume - a->volume)) / cap);
+}
+
+float tank_fill_at_ullage(const Tank *tank, float ullage_m) {
+    return tank_fill_at_sounding(tank, tank->height - ullage_m);
+}
+
+/*
+ * The rectangular terms are formed in the order the original per-sum
+ * loops used (volume = l * b * h, then * fill, then * density), and both
+ * the row and the column form go through here, so every path gives the
+ * same bits.
+ */
+static void rect_contents(float volume, float density, float pos_z, float height,
+                          float fsm, float f, TankTotals *out) {
+    float w = volume * f * density;
+    out->weight_t  = w;
+    /* CG of liquid in a partially filled rectangular tank is at half the fill height */
+    out->vmoment_t = w * (pos_z + (height * f) / 2.0f);
+    out->fsm       = (f <= 0.0f || f >= 1.0f) ? 0.0f : fsm;
+}
+
+static void tabled_contents(const Tank *t, float f, TankTotals *out) {
+    float v = tank_capacity(t) * f;
+    float vcg, inertia;
+    table_at_volume(t, v, &vcg, &inertia);
+    out->weight_t  = v * t->density;
+    out->vmoment_t = out->weight_t * vcg;
+    out->fsm       = (f <= 0.0f || f >= 1.0f) ? 0.0f : t->density * inertia;
+}
+
+static float rect_fsm(const Tank *t) {
+    return t->density * t->length * t->breadth * t->breadth * t->breadth / 12.0f;
+}
+
+void tank_contents(const Tank *t, float fill, TankTotals *out) {
+    if (t->table)
+        tabled_contents(t, fill, out);
+    else
+        rect_contents(t->length * t->breadth * t->height, t->density, t->pos_z, t->height,
+                      rect_fsm(t), fill, out);
+}
+
+void tank_config_totals(const TankConfig *config, TankTotals *out) {
+    memset(out, 0, sizeof(*out));
+    if (!config) return;
 
-    float total = 0.0f;
     for (int i = 0; i < config->count; i++) {
-        total += calculate_free_surface_moment(&config->tanks[i]);
+        TankTotals c;
+        tank_contents(&config->tanks[i], config->tanks[i].fill_fraction, &c);
+        out->weight_t  += c.weight_t;
+        out->vmoment_t += c.vmoment_t;
+        out->fsm       += c.fsm;
+    }
+}
+
+int tank_columns_init(TankColumns *cols, const TankConfig *config) {
+    memset(cols, 0, sizeof(*cols));
+    int n = config ? config->count : 0;
+    if (n == 0) return 0;
+
+    float *block = malloc((size_t)n * 5 * sizeof(float));
+    cols->tabled = malloc((size_t)n * sizeof(*cols->tabled));
+    if (!block || !cols->tabled) {
+        free(block);
+        free(cols->tabled);
+        cols->tabled = NULL;
+        return -1;
     }
-    return total;
+    cols->count   = n;
+    cols->volume  = block;
+    cols->density = block + n;
+    cols->pos_z   = block + 2 * n;
+    cols->height  = block + 3 * n;
+    cols->fsm     = block + 4 * n;
+
+    for (int i = 0; i < n; i++) {
+        const Tank *t = &config->tanks[i];
+        cols->volume[i]  = tank_capacity(t);
+        cols->density[i] = t->density;
+        cols->pos_z[i]   = t->pos_z;
+        cols->height[i]  = t->height;
+        cols->fsm[i]     = t->table ? 0.0f : rect_fsm(t);
+        cols->tabled[i]  = t->table ? t : NULL;
+    }
+    return 0;
+}
+
+void tank_columns_free(TankColumns *cols) {
+    if (!cols) return;
+    free(cols->volume);
+    free(cols->tabled);
+    memset(cols, 0, sizeof(*cols));
+}
+
+void tank_columns_sum(const TankColumns *cols, const float *fill, TankTotals *out) {
+    float weight = 0.0f, moment = 0.0f, fsm = 0.0f;
+    for (int i = 0; i < cols->count; i++) {
+        TankTotals c;
+        if (cols->tabled[i])
+            tabled_contents(cols->tabled[i], fill[i], &c);
+        else
+            rect_contents(cols->volume[i], cols->density[i], cols->pos_z[i],
+                          cols->height[i], cols->fsm[i], fill[i], &c);
+        weight += c.weight_t;
+        moment += c.vmoment_t;
+        fsm    += c.fsm;
+    }
+    out->weight_t  = weight;
+    out->vmoment_t = moment;
+    out->fsm       = fsm;
+}
+
+float calculate_free_surface_moment(const Tank *tank) {
+    if (!tank) return 0.0f;
+
+    TankTotals c;
+    tank_contents(tank, tank->fill_fraction, &c);
+    return c.fsm;
+}
+
+float calculate_total_fsm(const TankConfig *config) {
+    TankTotals t;
+    tank_config_totals(config, &t);
+    return t.fsm;
 }
 
 float calculate_virtual_kg_rise(const TankConfig *config, float displacement_t) {
@@ -95,28 +380,13 @@ float calculate_virtual_kg_rise(const TankConfig *config, float displacement_t)
 }
 
 float calculate_tank_weight(const TankConfig *config) {
-    if (!config) return 0.0f;
-
-    float total = 0.0f;
-    for (int i = 0; i < config->count; i++) {
-        const Tank *t = &config->tanks[i];
-        float volume = t->length * t->breadth * t->height * t->fill_fraction;
-        total += volume * t->density;
-    }
-    return total;
+    TankTotals t;
+    tank_config_totals(config, &t);
+    return t.weight_t;
 }
 
 float calculate_tank_vertical_moment(const TankConfig *config) {
-    if (!config) return 0.0f;
-
-    float moment = 0.0f;
-    for (int i = 0; i < config->count; i++) {
-        const Tank *t = &config->tanks[i];
-        float volume = t->length * t->breadth * t->height * t->fill_fraction;
-        float weight = volume * t->density;
-        /* CG of liquid in a partially filled rectangular tank is at half the fill height */
-        float liquid_cg = t->pos_z + (t->height * t->fill_fraction) / 2.0f;
-        moment += weight * liquid_cg;
-    }
-    return moment;
+    TankTotals t;
+    tank_config_totals(config, &t);
+    return t.vmoment_t;
 }
@@ -0,0 +1,232 @@
+/*
+ * thread_pool.c - Fixed-size worker thread pool
+ *
+ * Workers pull tasks from a growable FIFO ring guarded by one mutex.
+ * parallel_for queues up to one helper task per worker; each helper (and
+ * the caller) claim indices from a shared counter until the range is
+ * exhausted. Helpers that never got to run are pulled back out of the
+ * queue by the caller, so a parallel_for issued from a busy pool cannot
+ * wait on work stuck behind itself.
+ */
+
+#include "thread_pool.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct {
+    ThreadPoolFn fn;
+    void *arg;
+} PoolTask;
+
+struct ThreadPool_ {
+    pthread_mutex_t lock;
+    pthread_cond_t  has_work;
+
+    PoolTask *queue;          /* ring buffer */
+    int head, count, capacity;
+    int shutdown;
+
+    pthread_t *threads;
+    int nthreads;
+};
+
+/* Shared state for one parallel_for call (lives on the caller's stack) */
+typedef struct {
+    ThreadPoolRangeFn fn;
+    void *ctx;
+    int n;
+    int next;                 /* next unclaimed index */
+    int helpers;              /* helper tasks queued or running */
+    pthread_mutex_t lock;
+    pthread_cond_t  done;
+} ParallelBatch;
+
+int thread_pool_cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (int)n : 1;
+}
+
+static void *worker_main(void *arg) {
+    ThreadPool *pool = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->count == 0 && !pool->shutdown)
+            pthread_cond_wait(&pool->has_work, &pool->lock);
+        if (pool->count == 0 && pool->shutdown) break;
+
+        PoolTask task = pool->queue[pool->head];
+        pool->head = (pool->head + 1) % pool->capacity;
+        pool->count--;
+
+        pthread_mutex_unlock(&pool->lock);
+        task.fn(task.arg);
+        pthread_mutex_lock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+ThreadPool *thread_pool_create(int nthreads) {
+    if (nthreads <= 0) nthreads = thread_pool_cpu_count();
+
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+    if (!pool) return NULL;
+
+    pool->threads = calloc((size_t)nthreads, sizeof(pthread_t));
+    if (!pool->threads) {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->has_work, NULL);
+
+    for (int i = 0; i < nthreads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, worker_main, pool) != 0)
+            break;
+        pool->nthreads++;
+    }
+
+    if (pool->nthreads == 0) {
+        thread_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool *pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->has_work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->nthreads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->has_work);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool->queue);
+    free(pool);
+}
+
+int thread_pool_size(const ThreadPool *pool) {
+    return pool ? pool->nthreads : 0;
+}
+
+/* Caller must hold pool->lock */
+static int queue_push(ThreadPool *pool, ThreadPoolFn fn, void *arg) {
+    if (pool->count >= pool->capacity) {
+        int new_cap = (pool->capacity > 0) ? pool->capacity * 2 : 16;
+        PoolTask *grown = malloc((size_t)new_cap * sizeof(PoolTask));
+        if (!grown) return -1;
+        for (int i = 0; i < pool->count; i++)
+            grown[i] = pool->queue[(pool->head + i) % pool->capacity];
+        free(pool->queue);
+        pool->queue = grown;
+        pool->head = 0;
+        pool->capacity = new_cap;
+    }
+    int tail = (pool->head + pool->count) % pool->capacity;
+    pool->queue[tail].fn = fn;
+    pool->queue[tail].arg = arg;
+    pool->count++;
+    return 0;
+}
+
+int thread_pool_submit(ThreadPool *pool, ThreadPoolFn fn, void *arg) {
+    if (!pool || !fn) return -1;
+
+    pthread_mutex_lock(&pool->lock);
+    int rc = pool->shutdown ? -1 : queue_push(pool, fn, arg);
+    if (rc == 0) pthread_cond_signal(&pool->has_work);
+    pthread_mutex_unlock(&pool->lock);
+    return rc;
+}
+
+/* Claim and run indices until the range is exhausted */
+static void batch_run(ParallelBatch *b) {
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        int i = b->next++;
+        pthread_mutex_unlock(&b->lock);
+        if (i >= b->n) break;
+        b->fn(b->ctx, i);
+    }
+}
+
+static void batch_helper(void *arg) {
+    ParallelBatch *b = arg;
+    batch_run(b);
+
+    pthread_mutex_lock(&b->lock);
+    if (--b->helpers == 0) pthread_cond_signal(&b->done);
+    pthread_mutex_unlock(&b->lock);
+}
+
+/* Remove helpers of batch b that no worker has picked up yet */
+static int withdraw_helpers(ThreadPool *pool, ParallelBatch *b) {
+    int removed = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    int kept = 0;
+    for (int i = 0; i < pool->count; i++) {
+        PoolTask t = pool->queue[(pool->head + i) % pool->capacity];
+        if (t.fn == batch_helper && t.arg == b) {
+            removed++;
+            continue;
+        }
+        pool->queue[(pool->head + kept) % pool->capacity] = t;
+        kept++;
+    }
+    pool->count = kept;
+    pthread_mutex_unlock(&pool->lock);
+
+    return removed;
+}
+
+void thread_pool_parallel_for(ThreadPool *pool, int n, ThreadPoolRangeFn fn, void *ctx) {
+    if (n <= 0 || !fn) return;
+
+    if (!pool || n == 1) {
+        for (int i = 0; i < n; i++) fn(ctx, i);
+        return;
+    }
+
+    ParallelBatch b;
+    b.fn = fn;
+    b.ctx = ctx;
+    b.n = n;
+    b.next = 0;
+    b.helpers = 0;
+    pthread_mutex_init(&b.lock, NULL);
+    pthread_cond_init(&b.done, NULL);
+
+    /* The caller is one participant, so at most n-1 helpers are useful */
+    int want = (n - 1 < pool->nthreads) ? n - 1 : pool->nthreads;
+
+    pthread_mutex_lock(&pool->lock);
+    for (int h = 0; h < want && !pool->shutdown; h++) {
+        if (queue_push(pool, batch_helper, &b) != 0) break;
+        b.helpers++;
+    }
+    if (b.helpers > 0) pthread_cond_broadcast(&pool->has_work);
+    pthread_mutex_unlock(&pool->lock);
+
+    batch_run(&b);
+
+    int withdrawn = withdraw_helpers(pool, &b);
+
+    pthread_mutex_lock(&b.lock);
+    b.helpers -= withdrawn;
+    while (b.helpers > 0)
+        pthread_cond_wait(&b.done, &b.lock);
+    pthread_mutex_unlock(&b.lock);
+
+    pthread_cond_destroy(&b.done);
+    pthread_mutex_destroy(&b.lock);
+}
@@ -32,7 +32,7 @@ void print_cargo_layout_ascii(const Ship *ship) {
     // Draw cargo items
     for (int i = 0; i < ship->cargo_count; i++) {
         const Cargo *c = &ship->cargo[i];
-        if (c->pos_x < 0) continue;  // Skip unplaced cargo
+        if (!CARGO_IS_PLACED(c)) continue;  // Skip unplaced cargo
 
         // Map cargo position to grid coordinates
         int grid_x = (int)(c->pos_x * scale_x);
@@ -92,7 +92,7 @@ void print_cargo_summary(const Ship *ship) {
         char pos_str[20];
         const char *status;
 
-        if (c->pos_x >= 0) {
+        if (CARGO_IS_PLACED(c)) {
             snprintf(pos_str, sizeof(pos_str), "%.1f,%.1f,%.1f",
                      c->pos_x, c->pos_y, c->pos_z);
             status = "Placed";
@@ -103,8 +103,8 @@ void print_cargo_summary(const Ship *ship) {
         }
 
         printf("%-15s | %-10s | %7.1ft | %8s | %.1fx%.1fx%.1f | %-10s\n",
-               c->id,
-               c->type,
+               CARGO_ID(c),
+               CARGO_TYPE(c),
                c->weight / 1000.0f,  // Convert to tonnes
                pos_str,
                c->dimensions[0], c->dimensions[1], c->dimensions[2],
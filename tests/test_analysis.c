@@ -5,11 +5,20 @@
  */
 
 #include "cargoforge.h"
+#include "longitudinal_strength.h"
+#include "hydrostatics.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
 #include <assert.h>
 
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Label for a hand-built item, alive to the end of the enclosing block */
+#define LABEL(id, type) (&(const CargoLabel){ id, type })
+
 static Ship create_test_ship(void) {
     Ship ship = {
         .length = 100.0f,
@@ -51,8 +60,8 @@ void test_single_cargo_centered(void) {
     Ship ship = create_test_ship();
     ship.cargo_count = 1;
     ship.cargo[0] = (Cargo){
-        .id = "TestCargo", .weight = 500000.0f,
-        .dimensions = {5.0f, 4.0f, 3.0f}, .type = "standard",
+        .label = LABEL("TestCargo", "standard"), .weight = 500000.0f,
+        .dimensions = {5.0f, 4.0f, 3.0f}, .flags = CARGO_PLACED,
         .pos_x = 47.5f, .pos_y = 8.0f, .pos_z = 0.0f
     };
 
@@ -75,8 +84,8 @@ void test_overweight_ship(void) {
     Ship ship = create_test_ship();
     ship.cargo_count = 1;
     ship.cargo[0] = (Cargo){
-        .id = "HeavyCargo", .weight = 9000000.0f,
-        .dimensions = {10.0f, 10.0f, 5.0f}, .type = "heavy",
+        .label = LABEL("HeavyCargo", "heavy"), .weight = 9000000.0f,
+        .dimensions = {10.0f, 10.0f, 5.0f}, .flags = CARGO_PLACED,
         .pos_x = 0.0f, .pos_y = 0.0f, .pos_z = 0.0f
     };
 
@@ -93,8 +102,8 @@ void test_trim_from_forward_cargo(void) {
     Ship ship = create_test_ship();
     ship.cargo_count = 1;
     ship.cargo[0] = (Cargo){
-        .id = "ForwardCargo", .weight = 500000.0f,
-        .dimensions = {5.0f, 4.0f, 3.0f}, .type = "standard",
+        .label = LABEL("ForwardCargo", "standard"), .weight = 500000.0f,
+        .dimensions = {5.0f, 4.0f, 3.0f}, .flags = CARGO_PLACED,
         .pos_x = 5.0f, .pos_y = 8.0f, .pos_z = 0.0f
     };
 
@@ -118,8 +127,8 @@ void test_heel_from_offset_cargo(void) {
     ship.cargo_count = 1;
     /* Cargo placed far to starboard (y >> width/2) */
     ship.cargo[0] = (Cargo){
-        .id = "StarboardCargo", .weight = 500000.0f,
-        .dimensions = {5.0f, 4.0f, 3.0f}, .type = "standard",
+        .label = LABEL("StarboardCargo", "standard"), .weight = 500000.0f,
+        .dimensions = {5.0f, 4.0f, 3.0f}, .flags = CARGO_PLACED,
         .pos_x = 47.5f, .pos_y = 15.0f, .pos_z = 0.0f
     };
 
@@ -138,18 +147,18 @@ void test_multiple_cargo(void) {
     Ship ship = create_test_ship();
     ship.cargo_count = 3;
     ship.cargo[0] = (Cargo){
-        .id = "C1", .weight = 300000.0f,
-        .dimensions = {4.0f, 3.0f, 2.0f}, .type = "standard",
+        .label = LABEL("C1", "standard"), .weight = 300000.0f,
+        .dimensions = {4.0f, 3.0f, 2.0f}, .flags = CARGO_PLACED,
         .pos_x = 10.0f, .pos_y = 5.0f, .pos_z = 0.0f
     };
     ship.cargo[1] = (Cargo){
-        .id = "C2", .weight = 400000.0f,
-        .dimensions = {5.0f, 4.0f, 3.0f}, .type = "standard",
+        .label = LABEL("C2", "standard"), .weight = 400000.0f,
+        .dimensions = {5.0f, 4.0f, 3.0f}, .flags = CARGO_PLACED,
         .pos_x = 50.0f, .pos_y = 8.0f, .pos_z = 0.0f
     };
     ship.cargo[2] = (Cargo){
-        .id = "C3", .weight = 300000.0f,
-        .dimensions = {4.0f, 3.0f, 2.0f}, .type = "standard",
+        .label = LABEL("C3", "standard"), .weight = 300000.0f,
+        .dimensions = {4.0f, 3.0f, 2.0f}, .flags = CARGO_PLACED,
         .pos_x = 85.0f, .pos_y = 5.0f, .pos_z = 0.0f
     };
 
@@ -168,13 +177,13 @@ void test_unplaced_cargo(void) {
     Ship ship = create_test_ship();
     ship.cargo_count = 2;
     ship.cargo[0] = (Cargo){
-        .id = "Placed", .weight = 300000.0f,
-        .dimensions = {4.0f, 3.0f, 2.0f}, .type = "standard",
+        .label = LABEL("Placed", "standard"), .weight = 300000.0f,
+        .dimensions = {4.0f, 3.0f, 2.0f}, .flags = CARGO_PLACED,
         .pos_x = 50.0f, .pos_y = 10.0f, .pos_z = 0.0f
     };
     ship.cargo[1] = (Cargo){
-        .id = "Unplaced", .weight = 200000.0f,
-        .dimensions = {3.0f, 3.0f, 2.0f}, .type = "standard",
+        .label = LABEL("Unplaced", "standard"), .weight = 200000.0f,
+        .dimensions = {3.0f, 3.0f, 2.0f},
         .pos_x = -1.0f, .pos_y = -1.0f, .pos_z = -1.0f
     };
 
@@ -192,8 +201,8 @@ void test_gm_reasonable_range(void) {
     Ship ship = create_test_ship();
     ship.cargo_count = 1;
     ship.cargo[0] = (Cargo){
-        .id = "MedLoad", .weight = 3000000.0f,
-        .dimensions = {10.0f, 10.0f, 4.0f}, .type = "standard",
+        .label = LABEL("MedLoad", "standard"), .weight = 3000000.0f,
+        .dimensions = {10.0f, 10.0f, 4.0f}, .flags = CARGO_PLACED,
         .pos_x = 45.0f, .pos_y = 5.0f, .pos_z = -2.0f
     };
 
@@ -212,13 +221,13 @@ void test_imo_compliance(void) {
     ship.cargo_count = 2;
     /* Balanced, moderate loading - should be IMO compliant */
     ship.cargo[0] = (Cargo){
-        .id = "FwdLoad", .weight = 1500000.0f,
-        .dimensions = {8.0f, 8.0f, 4.0f}, .type = "standard",
+        .label = LABEL("FwdLoad", "standard"), .weight = 1500000.0f,
+        .dimensions = {8.0f, 8.0f, 4.0f}, .flags = CARGO_PLACED,
         .pos_x = 20.0f, .pos_y = 6.0f, .pos_z = -4.0f
     };
     ship.cargo[1] = (Cargo){
-        .id = "AftLoad", .weight = 1500000.0f,
-        .dimensions = {8.0f, 8.0f, 4.0f}, .type = "standard",
+        .label = LABEL("AftLoad", "standard"), .weight = 1500000.0f,
+        .dimensions = {8.0f, 8.0f, 4.0f}, .flags = CARGO_PLACED,
         .pos_x = 70.0f, .pos_y = 6.0f, .pos_z = -4.0f
     };
 
@@ -244,8 +253,8 @@ void test_hydrostatic_fields(void) {
     Ship ship = create_test_ship();
     ship.cargo_count = 1;
     ship.cargo[0] = (Cargo){
-        .id = "Load", .weight = 2000000.0f,
-        .dimensions = {10.0f, 10.0f, 4.0f}, .type = "standard",
+        .label = LABEL("Load", "standard"), .weight = 2000000.0f,
+        .dimensions = {10.0f, 10.0f, 4.0f}, .flags = CARGO_PLACED,
         .pos_x = 45.0f, .pos_y = 5.0f, .pos_z = -2.0f
     };
 
@@ -266,6 +275,217 @@ void test_hydrostatic_fields(void) {
     printf("PASS\n");
 }
 
+/* Test 11: Running moment sums give the same analysis as a full scan */
+void test_incremental_moments(void) {
+    printf("Test 11: Incremental moment sums... ");
+    Ship ship = create_test_ship();
+    ship.cargo_count = 3;
+    ship.cargo[0] = (Cargo){ .label = LABEL("A", "standard"), .weight = 400000.0f, .dimensions = {10, 5, 3},
+                             .flags = CARGO_PLACED, .pos_x = 10, .pos_y = 2, .pos_z = -4 };
+    ship.cargo[1] = (Cargo){ .label = LABEL("B", "standard"), .weight = 250000.0f, .dimensions = {6, 4, 2},
+                             .flags = CARGO_PLACED, .pos_x = 70, .pos_y = 12, .pos_z = 0 };
+    ship.cargo[2] = (Cargo){ .label = LABEL("C", "standard"), .weight = 100000.0f, .dimensions = {2, 2, 2},
+                             .pos_x = -1, .pos_y = -1, .pos_z = -1 };
+
+    CargoMoments m;
+    cargo_moments_compute(&ship, &m);
+    assert(m.placed_count == 2);
+    assert(fabs(m.weight - 650000.0) < 1e-6);
+
+    /* Move B: retire its old contribution, add the new one */
+    cargo_moments_remove(&m, &ship.cargo[1]);
+    ship.cargo[1].pos_x = 40.0f;
+    cargo_moments_add(&m, &ship.cargo[1]);
+    /* Unplaced items contribute nothing */
+    cargo_moments_add(&m, &ship.cargo[2]);
+
+    AnalysisResult inc = perform_analysis_moments(&ship, &m);
+    AnalysisResult full = perform_analysis(&ship);
+    assert(inc.placed_item_count == full.placed_item_count);
+    assert(fabsf(inc.total_cargo_weight_kg - full.total_cargo_weight_kg) < 1e-3f);
+    assert(fabsf(inc.kg - full.kg) < 1e-5f);
+    assert(fabsf(inc.trim - full.trim) < 1e-5f);
+    assert(fabsf(inc.heel - full.heel) < 1e-5f);
+    assert(fabsf(inc.cg.perc_x - full.cg.perc_x) < 1e-4f);
+
+    free(ship.cargo);
+    printf("PASS\n");
+}
+
+/* Positive-part area under the wall-sided curve, fine trapezoid in double */
+static double ref_gz_area(double gm, double bm, double a_deg, double b_deg) {
+    const int steps = 20000;
+    double h = (b_deg - a_deg) / steps * M_PI / 180.0, area = 0.0, prev = 0.0;
+    for (int i = 0; i <= steps; i++) {
+        double t = a_deg * M_PI / 180.0 + i * h;
+        double gz = sin(t) * (gm + bm * tan(t) * tan(t) / 2.0);
+        if (gz < 0.0) gz = 0.0;
+        if (i > 0) area += (prev + gz) * 0.5 * h;
+        prev = gz;
+    }
+    return area;
+}
+
+/* Test 12: GZ curve samples and IMO areas */
+void test_gz_curve(void) {
+    printf("Test 12: GZ curve and areas... ");
+    Ship ship = create_test_ship();
+
+    for (int tender = 0; tender <= 1; tender++) {
+        ship.lightship_kg = tender ? 40.0f : 5.0f;   /* tender: GM < 0 */
+        AnalysisResult r = perform_analysis(&ship);
+        float gm = r.gm_corrected;
+        assert((gm < 0.0f) == tender);
+
+        assert(r.gz_curve[0] == 0.0f);
+        assert(r.gz_curve[30] == r.gz_at_30);
+        float max = 0.0f;
+        for (int k = 1; k < GZ_CURVE_POINTS; k++) {
+            double t = k * M_PI / 180.0;
+            assert(fabs(r.gz_curve[k] - sin(t) * (gm + r.bm * tan(t) * tan(t) / 2.0)) <
+                   1e-4 * (1.0 + fabs(r.gz_curve[k])));
+            if (r.gz_curve[k] > max) max = r.gz_curve[k];
+        }
+        assert(r.gz_max == max && r.gz_curve[(int)r.gz_max_angle] == max);
+
+        assert(fabs(r.area_0_30 - ref_gz_area(gm, r.bm, 0, 30)) < 1e-4 * (1.0 + r.area_0_30));
+        assert(fabs(r.area_0_40 - ref_gz_area(gm, r.bm, 0, 40)) < 1e-4 * (1.0 + r.area_0_40));
+        assert(fabs(r.area_30_40 - ref_gz_area(gm, r.bm, 30, 40)) < 1e-4 * (1.0 + r.area_30_40));
+        assert(fabsf(r.area_0_30 + r.area_30_40 - r.area_0_40) < 1e-4f * (1.0f + r.area_0_40));
+    }
+
+    free(ship.cargo);
+    printf("PASS\n");
+}
+
+/* Test 13: Load sequence replays the plan and undoes itself */
+void test_load_sequence(void) {
+    printf("Test 13: Load sequence simulation... ");
+    Ship ship = create_test_ship();
+    StrengthLimits limits = { .permissible_sf = 5000.0f, .permissible_bm_hog = 50000.0f,
+                              .permissible_bm_sag = 50000.0f };
+    ship.strength_limits = &limits;
+    ship.cargo_count = 4;
+    ship.cargo[0] = (Cargo){ .label = LABEL("A", "standard"), .weight = 400000.0f, .dimensions = {10, 5, 3},
+                             .flags = CARGO_PLACED, .pos_x = 10, .pos_y = 2, .pos_z = 0 };
+    ship.cargo[1] = (Cargo){ .label = LABEL("B", "standard"), .weight = 250000.0f, .dimensions = {6, 4, 2},
+                             .flags = CARGO_PLACED, .pos_x = 70, .pos_y = 12, .pos_z = 0 };
+    ship.cargo[2] = (Cargo){ .label = LABEL("C", "standard"), .weight = 300000.0f, .dimensions = {8, 6, 2},
+                             .flags = CARGO_PLACED, .pos_x = 45, .pos_y = 7, .pos_z = 3 };
+    ship.cargo[3] = (Cargo){ .label = LABEL("D", "standard"), .weight = 100000.0f, .dimensions = {2, 2, 2},
+                             .pos_x = -1, .pos_y = -1, .pos_z = -1 };
+
+    /* Load everything placed, then discharge it in reverse */
+    SequenceMove moves[6] = {
+        { 0, SEQ_LOAD }, { 1, SEQ_LOAD }, { 2, SEQ_LOAD },
+        { 2, SEQ_DISCHARGE }, { 1, SEQ_DISCHARGE }, { 0, SEQ_DISCHARGE }
+    };
+    SequenceStep steps[7];
+    assert(simulate_load_sequence(&ship, moves, 6, steps) == 0);
+
+    assert(steps[0].cargo == -1 && steps[0].op == 0 && steps[0].on_board == 0);
+    assert(steps[0].cargo_weight_t == 0.0f);
+    assert(steps[3].cargo == 2 && steps[3].op == SEQ_LOAD && steps[3].on_board == 3);
+
+    AnalysisResult full = perform_analysis(&ship);
+    assert(fabsf(steps[3].cargo_weight_t * 1000.0f - full.total_cargo_weight_kg) < 1.0f);
+    assert(fabsf(steps[3].draft - full.draft) < 1e-4f);
+    assert(fabsf(steps[3].trim - full.trim) < 1e-4f);
+    assert(fabsf(steps[3].heel - full.heel) < 1e-3f);
+    assert(fabsf(steps[3].gm_corrected - full.gm_corrected) < 1e-4f);
+    assert(fabsf(steps[3].max_shear_force - full.max_shear_force) < 1e-3f * (1.0f + full.max_shear_force));
+    assert(fabsf(steps[3].max_bending_moment - full.max_bending_moment) <
+           1e-3f * (1.0f + full.max_bending_moment));
+    assert(steps[3].strength_compliant == full.strength_compliant);
+    assert(steps[3].imo_compliant == full.imo_compliant);
+
+    /* Back to the empty ship */
+    assert(steps[6].on_board == 0);
+    assert(fabsf(steps[6].cargo_weight_t) < 1e-3f);
+    assert(fabsf(steps[6].draft - steps[0].draft) < 1e-4f);
+    assert(fabsf(steps[6].gm_corrected - steps[0].gm_corrected) < 1e-4f);
+    assert(fabsf(steps[6].max_bending_moment - steps[0].max_bending_moment) <
+           1e-3f * (1.0f + steps[0].max_bending_moment));
+
+    /* A discharge first means the item starts on board; unnamed placed
+     * items stay on board throughout */
+    SequenceMove off = { 1, SEQ_DISCHARGE };
+    assert(simulate_load_sequence(&ship, &off, 1, steps) == 0);
+    assert(steps[0].on_board == 3 && steps[1].on_board == 2);
+    assert(fabsf(steps[0].gm_corrected - full.gm_corrected) < 1e-4f);
+
+    /* Bad moves: unplaced item, double load, unknown op or index */
+    SequenceMove unplaced = { 3, SEQ_LOAD };
+    SequenceMove twice[2] = { { 0, SEQ_LOAD }, { 0, SEQ_LOAD } };
+    SequenceMove bad_op = { 0, 7 };
+    SequenceMove bad_index = { 4, SEQ_LOAD };
+    assert(simulate_load_sequence(&ship, &unplaced, 1, steps) == -1);
+    assert(simulate_load_sequence(&ship, twice, 2, steps) == -1);
+    assert(simulate_load_sequence(&ship, &bad_op, 1, steps) == -1);
+    assert(simulate_load_sequence(&ship, &bad_index, 1, steps) == -1);
+
+    free(ship.cargo);
+    printf("PASS\n");
+}
+
+/* Test 14: Batch weight deltas enter the strength weight curve */
+void test_batch_weight_strength(void) {
+    printf("Test 14: Batch weights in strength... ");
+    Ship ship = create_test_ship();
+    StrengthLimits limits = { .permissible_sf = 5000.0f, .permissible_bm_hog = 50000.0f,
+                              .permissible_bm_sag = 50000.0f };
+    ship.strength_limits = &limits;
+    ship.cargo_count = 1;
+    ship.cargo[0] = (Cargo){ .label = LABEL("A", "standard"), .weight = 400000.0f, .dimensions = {10, 5, 3},
+                             .flags = CARGO_PLACED, .pos_x = 40, .pos_y = 8, .pos_z = 0 };
+
+    /* 500 t near the bow, as a delta and as a short placed item */
+    WeightDelta d = { 500000.0f, 90.01f, 10.0f, 2.0f };
+    LoadCondition cond = { NULL, &d, 1 };
+    AnalysisResult batch;
+    assert(perform_analysis_batch(&ship, &cond, 1, &batch, NULL) == 0);
+
+    ship.cargo[1] = (Cargo){ .label = LABEL("W", "standard"), .weight = 500000.0f,
+                             .dimensions = {0.02f, 0.02f, 0.02f}, .flags = CARGO_PLACED,
+                             .pos_x = 90.0f, .pos_y = 9.99f, .pos_z = 1.99f };
+    ship.cargo_count = 2;
+    AnalysisResult full = perform_analysis(&ship);
+
+    assert(fabsf(batch.gm_corrected - full.gm_corrected) < 1e-3f);
+    assert(fabsf(batch.max_shear_force - full.max_shear_force) < 1e-3f * (1.0f + full.max_shear_force));
+    assert(fabsf(batch.max_bending_moment - full.max_bending_moment) <
+           1e-3f * (1.0f + full.max_bending_moment));
+    assert(batch.strength_compliant == full.strength_compliant);
+
+    free(ship.cargo);
+    printf("PASS\n");
+}
+
+/* Test 15: A loaded but unindexed table falls back to the box hull */
+void test_unindexed_hydro_table(void) {
+    printf("Test 15: Unindexed hydro table... ");
+    Ship ship = create_test_ship();
+    ship.cargo_count = 1;
+    ship.cargo[0] = (Cargo){ .label = LABEL("A", "standard"), .weight = 2000000.0f,
+                             .dimensions = {10, 10, 4}, .flags = CARGO_PLACED,
+                             .pos_x = 45, .pos_y = 5, .pos_z = 0 };
+    AnalysisResult box = perform_analysis(&ship);
+
+    HydroTable table = {0};
+    table.loaded = 1;
+    ship.hydro = &table;
+    AnalysisResult r = perform_analysis(&ship);
+
+    assert(r.hydro_table_used == 0);
+    assert(r.draft == box.draft);
+    assert(r.kb == box.kb);
+    assert(r.bm == box.bm);
+    assert(r.gm == box.gm);
+
+    free(ship.cargo);
+    printf("PASS\n");
+}
+
 int main(void) {
     printf("\n=== Running Analysis Module Tests ===\n\n");
 
@@ -279,6 +499,11 @@ int main(void) {
     test_gm_reasonable_range();
     test_imo_compliance();
     test_hydrostatic_fields();
+    test_incremental_moments();
+    test_gz_curve();
+    test_load_sequence();
+    test_batch_weight_strength();
+    test_unindexed_hydro_table();
 
     printf("\n=== All Analysis Tests Passed! ===\n\n");
     return 0;
@@ -0,0 +1,144 @@
+/*
+ * test_arena.c - Tests for the bump allocator
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define ASSERT(cond, msg) do { \
+    tests_run++; \
+    if (!(cond)) { \
+        fprintf(stderr, "  FAIL: %s (line %d)\n", msg, __LINE__); \
+    } else { \
+        tests_passed++; \
+    } \
+} while(0)
+
+static void test_alloc_alignment(void) {
+    Arena a;
+    arena_init(&a);
+    ASSERT(arena_used(&a) == 0 && a.reserved == 0, "fresh arena holds nothing");
+
+    int aligned = 1, distinct = 1;
+    unsigned char *prev = NULL;
+    for (int i = 1; i <= 200; i++) {
+        unsigned char *p = arena_alloc(&a, (size_t)i);
+        if (!p || ((uintptr_t)p % 16) != 0) aligned = 0;
+        if (p) memset(p, i, (size_t)i);
+        if (prev && prev == p) distinct = 0;
+        prev = p;
+    }
+    ASSERT(aligned, "allocations are 16-byte aligned");
+    ASSERT(distinct, "allocations do not overlap");
+    ASSERT(arena_used(&a) >= 200 * 201 / 2, "used covers every request");
+
+    /* Bigger than a block: gets a block of its own */
+    void *big = arena_alloc(&a, ARENA_MAX_BLOCK + 1);
+    ASSERT(big != NULL, "oversized allocation succeeds");
+    ASSERT(a.reserved >= ARENA_MAX_BLOCK + 1, "oversized block counted");
+
+    arena_free(&a);
+    ASSERT(a.head == NULL && a.reserved == 0, "free leaves the arena empty");
+}
+
+static void test_reset_reuses_blocks(void) {
+    Arena a;
+    arena_init(&a);
+
+    /* Fill several blocks, then do it again after each reset */
+    size_t reserved = 0;
+    int same_start = 1, stable = 1;
+    void *first = NULL;
+    for (int round = 0; round < 5; round++) {
+        void *p = arena_alloc(&a, 100);
+        if (round == 0) first = p;
+        else if (p != first) same_start = 0;
+        for (int i = 0; i < 2000; i++) arena_alloc(&a, 1000);
+        if (round == 0) reserved = a.reserved;
+        else if (a.reserved != reserved) stable = 0;
+        arena_reset(&a);
+        if (arena_used(&a) != 0) stable = 0;
+    }
+    ASSERT(same_start, "reset hands out the first block again");
+    ASSERT(stable, "repeating the same work allocates no new blocks");
+
+    arena_free(&a);
+}
+
+static void test_realloc_in_place(void) {
+    Arena a;
+    arena_init(&a);
+
+    int *v = arena_realloc(&a, NULL, 0, 16 * sizeof(int));
+    for (int i = 0; i < 16; i++) v[i] = i;
+    int *grown = arena_realloc(&a, v, 16 * sizeof(int), 64 * sizeof(int));
+    ASSERT(grown == v, "latest allocation grows in place");
+
+    arena_alloc(&a, 8);
+    int *moved = arena_realloc(&a, grown, 64 * sizeof(int), 128 * sizeof(int));
+    int kept = moved != NULL && moved != grown;
+    for (int i = 0; kept && i < 16; i++) kept = moved[i] == i;
+    ASSERT(kept, "older allocation is copied with its contents");
+    ASSERT(arena_realloc(&a, moved, 128 * sizeof(int), 4) == moved, "shrinking is a no-op");
+
+    /* Growing past the block moves to a new one */
+    size_t n = 1000;
+    int *big = arena_realloc(&a, NULL, 0, n * sizeof(int));
+    for (size_t i = 0; i < n; i++) big[i] = (int)i;
+    while (n < 4 * ARENA_FIRST_BLOCK) {
+        big = arena_realloc(&a, big, n * sizeof(int), 2 * n * sizeof(int));
+        if (!big) break;
+        n *= 2;
+    }
+    kept = big != NULL;
+    for (size_t i = 0; kept && i < 1000; i++) kept = big[i] == (int)i;
+    ASSERT(kept, "repeated growth keeps the contents");
+
+    arena_free(&a);
+}
+
+static void test_mark_rewind(void) {
+    Arena a;
+    arena_init(&a);
+
+    ArenaMark empty = arena_mark(&a);
+    char *keep = arena_alloc(&a, 32);
+    strcpy(keep, "ship tables");
+    size_t used = arena_used(&a);
+    ArenaMark m = arena_mark(&a);
+
+    void *after = NULL;
+    for (int round = 0; round < 3; round++) {
+        arena_rewind(&a, m);
+        ASSERT(arena_used(&a) == used, "rewind drops later allocations");
+        void *p = arena_alloc(&a, 64);
+        if (round == 0) after = p;
+        ASSERT(p == after, "rewound space is handed out again");
+        for (int i = 0; i < 500; i++) arena_alloc(&a, 1024);
+    }
+    ASSERT(strcmp(keep, "ship tables") == 0, "memory before the mark is untouched");
+
+    arena_rewind(&a, empty);
+    ASSERT(arena_used(&a) == 0, "rewind to an empty mark resets");
+    ASSERT(arena_alloc(&a, 32) == keep, "and starts from the first block");
+
+    arena_free(&a);
+}
+
+int main(void) {
+    printf("=== Arena Tests ===\n");
+
+    test_alloc_alignment();
+    test_reset_reuses_blocks();
+    test_realloc_in_place();
+    test_mark_rewind();
+
+    printf("Arena: %d/%d tests passed\n\n", tests_passed, tests_run);
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+/*
+ * test_batch.c - Tests for batch runs (run from the repository root)
+ */
+
+#include "batch.h"
+#include "libcargoforge.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define ASSERT(cond, msg) do { \
+    tests_run++; \
+    if (!(cond)) { \
+        fprintf(stderr, "  FAIL: %s (line %d)\n", msg, __LINE__); \
+    } else { \
+        tests_passed++; \
+    } \
+} while(0)
+
+static const char *JOBS_PATH = "/tmp/test_batch_jobs.txt";
+static const char *OUT_PATH  = "/tmp/test_batch_out.txt";
+static const char *DIR_PATH  = "/tmp/test_batch_dir";
+
+static const char *SHIPS[] = {
+    "examples/sample_ship.cfg", "examples/sample_ship_full.cfg", "examples/sample_ship_holds.cfg"
+};
+static const char *MANIFESTS[] = {
+    "examples/sample_cargo.txt", "examples/sample_cargo_dg.txt", "examples/large_cargo.txt"
+};
+
+static void write_file(const char *path, const char *text) {
+    FILE *f = fopen(path, "w");
+    if (!f) return;
+    fputs(text, f);
+    fclose(f);
+}
+
+/** Output lines of the last run, or 0 if the file is missing */
+static int read_lines(char lines[][16384], int max) {
+    FILE *f = fopen(OUT_PATH, "r");
+    if (!f) return 0;
+    int n = 0;
+    while (n < max && fgets(lines[n], sizeof(lines[n]), f)) n++;
+    fclose(f);
+    return n;
+}
+
+static int starts_with(const char *s, const char *prefix) {
+    return strncmp(s, prefix, strlen(prefix)) == 0;
+}
+
+/** What a single handle makes of the job, as compact JSON (malloc'd) */
+static char *single_run(const char *ship, const char *cargo) {
+    CargoForge *cf;
+    if (cargoforge_open(&cf) != CF_OK) return NULL;
+    cargoforge_set_option(cf, CF_OPT_JSON_COMPACT, 1);
+    char *copy = NULL;
+    if (cargoforge_load_ship(cf, ship) == CF_OK &&
+        cargoforge_load_cargo(cf, cargo) == CF_OK &&
+        cargoforge_optimize(cf) == CF_OK) {
+        const char *json = cargoforge_result_json(cf);
+        if (json) {
+            copy = malloc(strlen(json) + 1);
+            if (copy) strcpy(copy, json);
+        }
+    }
+    cargoforge_close(cf);
+    return copy;
+}
+
+static char lines[64][16384];
+
+static void test_job_list_ndjson(void) {
+    /* 27 jobs through a 3-slot window on 2 workers: the ring wraps often */
+    char text[4096] = "# ship and manifest pairs\n\n";
+    for (int i = 0; i < 27; i++) {
+        char line[256];
+        snprintf(line, sizeof(line), "%s\t%s\n", SHIPS[i % 3], MANIFESTS[(i / 3) % 3]);
+        strcat(text, line);
+    }
+    write_file(JOBS_PATH, text);
+
+    BatchOptions opts;
+    batch_options_init(&opts);
+    opts.jobs = JOBS_PATH;
+    opts.output_file = OUT_PATH;
+    opts.workers = 2;
+    opts.in_flight = 3;
+    BatchStats stats;
+    ASSERT(batch_run(&opts, &stats) == 0, "batch run succeeds");
+    ASSERT(stats.jobs == 27 && stats.failed == 0, "every job ran and none failed");
+
+    int n = read_lines(lines, 64);
+    ASSERT(n == 27, "one line per job");
+
+    int ordered = 1, same = 1;
+    for (int i = 0; i < n; i++) {
+        char prefix[512];
+        snprintf(prefix, sizeof(prefix),
+                 "{\"job\":%d,\"ship_config\":\"%s\",\"cargo_manifest\":\"%s\",\"status\":\"ok\",",
+                 i + 1, SHIPS[i % 3], MANIFESTS[(i / 3) % 3]);
+        size_t pl = strlen(prefix);
+        if (strncmp(lines[i], prefix, pl) != 0) {
+            ordered = 0;
+            continue;
+        }
+        char *json = single_run(SHIPS[i % 3], MANIFESTS[(i / 3) % 3]);
+        size_t jl = json ? strlen(json) : 0;
+        if (!json || strncmp(lines[i] + pl, json + 1, jl - 1) != 0 ||
+            strcmp(lines[i] + pl + jl - 1, "\n") != 0)
+            same = 0;
+        free(json);
+    }
+    ASSERT(ordered, "lines come out in job order with the job's fields");
+    ASSERT(same, "each line holds the result a single handle produces");
+}
+
+static void test_failed_jobs(void) {
+    write_file(JOBS_PATH,
+               "examples/sample_ship.cfg examples/no_such_manifest.txt\n"
+               "examples/sample_cargo.txt\n"
+               "examples/no_such_ship.cfg examples/sample_cargo.txt\n"
+               "a b c\n"
+               "examples/sample_ship.cfg examples/sample_cargo.txt\n");
+
+    BatchOptions opts;
+    batch_options_init(&opts);
+    opts.jobs = JOBS_PATH;
+    opts.output_file = OUT_PATH;
+    opts.workers = 2;
+    BatchStats stats;
+    ASSERT(batch_run(&opts, &stats) == 0, "failing jobs do not stop the run");
+    ASSERT(stats.jobs == 5 && stats.failed == 4, "failed jobs are counted");
+
+    int n = read_lines(lines, 64);
+    ASSERT(n == 5, "failed jobs get a line too");
+    ASSERT(n == 5 && strstr(lines[0], "\"status\":\"error\",\"error\":\"") != NULL,
+           "missing manifest reports an error");
+    ASSERT(n == 5 && strstr(lines[1], "\"ship_config\":null") != NULL &&
+           strstr(lines[1], "No ship config") != NULL,
+           "manifest without a ship or default ship is an error");
+    ASSERT(n == 5 && strstr(lines[2], "\"status\":\"error\"") != NULL, "missing ship reports an error");
+    ASSERT(n == 5 && strstr(lines[3], "more than two fields") != NULL, "malformed line is an error");
+    ASSERT(n == 5 && starts_with(lines[4], "{\"job\":5,") &&
+           strstr(lines[4], "\"status\":\"ok\"") != NULL, "later jobs still run");
+
+    /* A default ship fills in one-field lines */
+    opts.ship_config = "examples/sample_ship.cfg";
+    ASSERT(batch_run(&opts, &stats) == 0 && stats.failed == 3, "default ship is used");
+    n = read_lines(lines, 64);
+    ASSERT(n == 5 && strstr(lines[1], "\"ship_config\":\"examples/sample_ship.cfg\"") != NULL &&
+           strstr(lines[1], "\"status\":\"ok\"") != NULL, "one-field line runs on the default ship");
+
+    opts.jobs = "/tmp/test_batch_no_such_list.txt";
+    ASSERT(batch_run(&opts, &stats) == -1, "missing job list fails the run");
+}
+
+static void test_directory_csv(void) {
+    mkdir(DIR_PATH, 0755);
+    write_file("/tmp/test_batch_dir/b.txt", "C1 250 12.0x2.4x2.6 standard\n");
+    write_file("/tmp/test_batch_dir/a.txt",
+               "C1 250 12.0x2.4x2.6 standard\nC2 180 6.0x2.4x2.6 standard\n");
+    write_file("/tmp/test_batch_dir/.hidden", "not a manifest\n");
+
+    BatchOptions opts;
+    batch_options_init(&opts);
+    opts.jobs = DIR_PATH;
+    opts.output_file = OUT_PATH;
+    opts.format = BATCH_CSV;
+    opts.in_flight = 1;
+    BatchStats stats;
+    ASSERT(batch_run(&opts, &stats) == -1, "a directory needs a ship config");
+
+    opts.ship_config = "examples/sample_ship.cfg";
+    ASSERT(batch_run(&opts, &stats) == 0, "directory run succeeds");
+    ASSERT(stats.jobs == 2 && stats.failed == 0, "regular files run, dotfiles skipped");
+
+    int n = read_lines(lines, 64);
+    ASSERT(n == 3, "header plus one row per job");
+    ASSERT(n == 3 && starts_with(lines[0], "job,ship_config,cargo_manifest,status,placed,total,"),
+           "CSV header");
+    ASSERT(n == 3 && starts_with(lines[1], "1,examples/sample_ship.cfg,/tmp/test_batch_dir/a.txt,ok,2,2,"),
+           "files run in name order");
+    ASSERT(n == 3 && starts_with(lines[2], "2,examples/sample_ship.cfg,/tmp/test_batch_dir/b.txt,ok,1,1,"),
+           "second row");
+
+    int fields = 1;
+    for (const char *p = n == 3 ? lines[1] : ""; *p; p++) fields += (*p == ',');
+    ASSERT(fields == 16, "rows have one field per header column");
+
+    remove("/tmp/test_batch_dir/a.txt");
+    remove("/tmp/test_batch_dir/b.txt");
+    remove("/tmp/test_batch_dir/.hidden");
+    rmdir(DIR_PATH);
+}
+
+static void test_csv_quoting(void) {
+    write_file("/tmp/test_batch,quoted\".txt", "C1 250 12.0x2.4x2.6 standard\n");
+    write_file(JOBS_PATH, "examples/sample_ship.cfg /tmp/test_batch,quoted\".txt\n");
+
+    BatchOptions opts;
+    batch_options_init(&opts);
+    opts.jobs = JOBS_PATH;
+    opts.output_file = OUT_PATH;
+    opts.format = BATCH_CSV;
+    BatchStats stats;
+    ASSERT(batch_run(&opts, &stats) == 0 && stats.failed == 0, "quoted-path job runs");
+
+    int n = read_lines(lines, 64);
+    ASSERT(n == 2 && starts_with(lines[1], "1,examples/sample_ship.cfg,\"/tmp/test_batch,quoted\"\".txt\",ok,"),
+           "fields with commas and quotes are quoted");
+    remove("/tmp/test_batch,quoted\".txt");
+}
+
+int main(void) {
+    printf("=== Batch Tests ===\n");
+
+    test_job_list_ndjson();
+    test_failed_jobs();
+    test_directory_csv();
+    test_csv_quoting();
+
+    remove(JOBS_PATH);
+    remove(OUT_PATH);
+
+    printf("Batch: %d/%d tests passed\n\n", tests_passed, tests_run);
+    return (tests_passed == tests_run) ? 0 : 1;
+}
@@ -0,0 +1,318 @@
+/*
+ * test_binfmt.c - Unit tests for the binary manifest / plan format
+ */
+
+#include "cargoforge.h"
+#include "binfmt.h"
+#include "imdg.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+/* Serialise through a real stream and return the bytes */
+static unsigned char *write_image(const Ship *ship, const AnalysisResult *result, size_t *len) {
+    FILE *f = tmpfile();
+    assert(f != NULL);
+    assert(cfb_write(f, ship, result) == 0);
+    long size = ftell(f);
+    assert(size > 0);
+    rewind(f);
+    unsigned char *buf = malloc((size_t)size);
+    assert(buf != NULL);
+    assert(fread(buf, 1, (size_t)size, f) == (size_t)size);
+    fclose(f);
+    *len = (size_t)size;
+    return buf;
+}
+
+static void assert_same_cargo(const Ship *a, const Ship *b) {
+    assert(a->cargo_count == b->cargo_count);
+    for (int i = 0; i < a->cargo_count; i++) {
+        const Cargo *x = &a->cargo[i], *y = &b->cargo[i];
+        assert(strcmp(CARGO_ID(x), CARGO_ID(y)) == 0);
+        assert(strcmp(CARGO_TYPE(x), CARGO_TYPE(y)) == 0);
+        assert((x->flags & CARGO_TYPE_FLAGS) == (y->flags & CARGO_TYPE_FLAGS));
+        assert(x->weight == y->weight);
+        assert(memcmp(x->dimensions, y->dimensions, sizeof(x->dimensions)) == 0);
+        assert((x->dg == NULL) == (y->dg == NULL));
+        assert(x->dg_index == y->dg_index);
+        if (x->dg) {
+            const DGInfo *p = (const DGInfo *)x->dg, *q = (const DGInfo *)y->dg;
+            assert(p->dg_class == q->dg_class && p->dg_division == q->dg_division);
+            assert(p->stowage == q->stowage);
+            assert(strcmp(p->un_number, q->un_number) == 0);
+            assert(strcmp(p->ems, q->ems) == 0);
+        }
+    }
+}
+
+/* Test 1: Manifest survives text -> binary -> memory */
+void test_manifest_round_trip(void) {
+    printf("Test 1: Manifest round trip... ");
+
+    Ship text = {0};
+    assert(parse_cargo_list("examples/sample_cargo_dg.txt", &text) == 0);
+
+    size_t len;
+    unsigned char *buf = write_image(&text, NULL, &len);
+    assert(memcmp(buf, CFB_MAGIC, CFB_MAGIC_LEN) == 0);
+
+    CfbImage img;
+    assert(cfb_open_buffer(buf, len, &img) == 0);
+    assert(img.cargo_count == (uint32_t)text.cargo_count);
+    assert(img.dg_count == 3);
+    assert(!(img.flags & (CFB_FLAG_PLAN | CFB_FLAG_RESULT)));
+
+    Ship bin = {0};
+    AnalysisResult result;
+    assert(cfb_load(&img, &bin, &result) == 0);
+    assert_same_cargo(&text, &bin);
+    for (int i = 0; i < bin.cargo_count; i++)
+        assert(!CARGO_IS_PLACED(&bin.cargo[i]) &&
+               bin.cargo[i].pos_x == -1.0f && bin.cargo[i].pos_z == -1.0f);
+    assert(result.placed_item_count == 0 && result.gm == 0.0f);
+
+    cfb_close(&img);
+    ship_cleanup(&text);
+    ship_cleanup(&bin);
+    free(buf);
+    printf("PASS\n");
+}
+
+/* Test 2: A plan keeps positions, results and particulars */
+void test_plan_round_trip(void) {
+    printf("Test 2: Plan and results round trip... ");
+
+    Ship ship = {0};
+    ship.length = 150.0f;
+    ship.width = 25.0f;
+    ship.max_weight = 8e6f;
+    ship.lightship_weight = 2e6f;
+    ship.lightship_kg = 7.5f;
+    assert(parse_cargo_list("examples/sample_cargo_dg.txt", &ship) == 0);
+    for (int i = 0; i < ship.cargo_count; i++)
+        CARGO_PLACE(&ship.cargo[i], 1.25f * (float)i, (i % 2) ? 3.5f : -1.0f, -8.0f + (float)i);
+    CARGO_UNPLACE(&ship.cargo[1]);
+
+    AnalysisResult res;
+    memset(&res, 0, sizeof(res));
+    res.cg.perc_x = 48.5f;
+    res.placed_item_count = ship.cargo_count - 1;
+    res.gm_corrected = 1.375f;
+    res.trim = -0.25f;
+    res.imo_compliant = 1;
+    res.strength_compliant = -1;
+    res.hydro_table_used = 1;
+
+    size_t len;
+    unsigned char *buf = write_image(&ship, &res, &len);
+    CfbImage img;
+    assert(cfb_open_buffer(buf, len, &img) == 0);
+    assert(img.flags == (CFB_FLAG_PLAN | CFB_FLAG_RESULT));
+
+    Ship back = {0};
+    AnalysisResult got;
+    assert(cfb_load(&img, &back, &got) == 0);
+    assert_same_cargo(&ship, &back);
+    for (int i = 0; i < ship.cargo_count; i++) {
+        assert(back.cargo[i].pos_x == ship.cargo[i].pos_x);
+        assert(back.cargo[i].pos_y == ship.cargo[i].pos_y);
+        assert(back.cargo[i].pos_z == ship.cargo[i].pos_z);
+        assert(CARGO_IS_PLACED(&back.cargo[i]) == CARGO_IS_PLACED(&ship.cargo[i]));
+    }
+    assert(back.length == 150.0f && back.width == 25.0f && back.lightship_kg == 7.5f);
+    assert(memcmp(&got, &res, sizeof(res)) == 0);
+
+    // A ship that already has particulars keeps them
+    Ship configured = {0};
+    configured.length = 99.0f;
+    assert(cfb_load(&img, &configured, NULL) == 0);
+    assert(configured.length == 99.0f && configured.width == 0.0f);
+
+    cfb_close(&img);
+    ship_cleanup(&ship);
+    ship_cleanup(&back);
+    ship_cleanup(&configured);
+    free(buf);
+    printf("PASS\n");
+}
+
+/* Test 3: Damaged images are rejected, never half-loaded */
+void test_rejects_malformed(void) {
+    printf("Test 3: Malformed images rejected... ");
+
+    Ship ship = {0};
+    assert(parse_cargo_list("examples/sample_cargo_dg.txt", &ship) == 0);
+    size_t len;
+    unsigned char *good = write_image(&ship, NULL, &len);
+    unsigned char *buf = malloc(len);
+    assert(buf != NULL);
+    CfbImage img;
+
+    /* Header-level damage */
+    memcpy(buf, good, len);
+    buf[0] = 'X';
+    assert(cfb_open_buffer(buf, len, &img) == -1);
+
+    memcpy(buf, good, len);
+    buf[8] = 2;                                  // version 2
+    assert(cfb_open_buffer(buf, len, &img) == -1);
+
+    assert(cfb_open_buffer(good, len - 1, &img) == -1);   // truncated
+    assert(cfb_open_buffer(good, 40, &img) == -1);
+
+    memcpy(buf, good, len);
+    buf[36] = 0xff; buf[37] = 0xff;              // cargo_count past the end
+    assert(cfb_open_buffer(buf, len, &img) == -1);
+
+    /* Ship particulars outside the config parser's limits */
+    const float bad_particulars[] = { -5.0f, NAN, INFINITY, 0.05f, 2e9f };
+    for (size_t k = 0; k < sizeof(bad_particulars) / sizeof(bad_particulars[0]); k++) {
+        memcpy(buf, good, len);
+        memcpy(buf + 16, &bad_particulars[k], sizeof(float));   // length
+        assert(cfb_open_buffer(buf, len, &img) == -1);
+    }
+    memcpy(buf, good, len);
+    float huge_weight = 5e12f;
+    memcpy(buf + 24, &huge_weight, sizeof(huge_weight));      // max_weight (kg)
+    assert(cfb_open_buffer(buf, len, &img) == -1);
+
+    /* Record-level damage passes the header check but fails the load */
+    uint64_t cargo_off = CFB_HEADER_SIZE;
+    unsigned char *rec = buf + cargo_off + CFB_RECORD_SIZE;   // 2nd record
+
+    memcpy(buf, good, len);
+    memset(rec, 0xff, 4);                        // ID offset out of range
+    assert(cfb_open_buffer(buf, len, &img) == 0);
+    Ship bad = {0};
+    assert(cfb_load(&img, &bad, NULL) == -1);
+    assert(bad.cargo == NULL && bad.cargo_count == 0 && bad.dg_pool == NULL);
+    assert(bad.label_pool == NULL);
+
+    memcpy(buf, good, len);
+    float nan_w = NAN;
+    memcpy(rec + 8, &nan_w, sizeof(nan_w));      // weight
+    assert(cfb_open_buffer(buf, len, &img) == 0);
+    assert(cfb_load(&img, &bad, NULL) == -1);
+    assert(bad.cargo == NULL && bad.dg_pool == NULL && bad.label_pool == NULL);
+
+    /* Weight and dimensions outside the text parser's limits */
+    const float bad_weights[] = { 50.0f, 2e9f };   // kg: below 0.1 t, above 1e6 t
+    for (int k = 0; k < 2; k++) {
+        memcpy(buf, good, len);
+        memcpy(rec + 8, &bad_weights[k], sizeof(float));
+        assert(cfb_open_buffer(buf, len, &img) == 0);
+        assert(cfb_load(&img, &bad, NULL) == -1);
+    }
+    memcpy(buf, good, len);
+    float long_dim = 2e4f;
+    memcpy(rec + 12, &long_dim, sizeof(long_dim));   // dimensions[0]
+    assert(cfb_open_buffer(buf, len, &img) == 0);
+    assert(cfb_load(&img, &bad, NULL) == -1);
+
+    memcpy(buf, good, len);
+    rec[36] = 7; rec[37] = rec[38] = rec[39] = 0; // DG index 7 of 3
+    assert(cfb_open_buffer(buf, len, &img) == 0);
+    assert(cfb_load(&img, &bad, NULL) == -1);
+
+    ship_cleanup(&ship);
+    free(good);
+    free(buf);
+    printf("PASS\n");
+}
+
+/* Test 4: Text export parses back to the same values */
+void test_text_export(void) {
+    printf("Test 4: Text export round trip... ");
+
+    Ship ship = {0};
+    assert(parse_cargo_list("examples/sample_cargo_dg.txt", &ship) == 0);
+    ship.cargo[0].weight = 123456.7f;            // not a whole number of grams
+    ship.cargo[2].dimensions[1] = 2.4375f;
+    DGInfo *dg = (DGInfo *)ship.cargo[1].dg;
+    dg->stowage = STOW_UNDER_DECK;
+
+    char *text = NULL;
+    size_t text_len = 0;
+    FILE *f = tmpfile();
+    assert(f != NULL);
+    assert(cfb_write_manifest_text(f, &ship) == 0);
+    text_len = (size_t)ftell(f);
+    rewind(f);
+    text = malloc(text_len);
+    assert(text != NULL && fread(text, 1, text_len, f) == text_len);
+    fclose(f);
+
+    Ship back = {0};
+    assert(parse_cargo_list_buffer(text, text_len, &back) == 0);
+    assert_same_cargo(&ship, &back);
+
+    ship_cleanup(&ship);
+    ship_cleanup(&back);
+    free(text);
+    printf("PASS\n");
+}
+
+/* Test 5: File entry points, text or binary */
+void test_file_loading(void) {
+    printf("Test 5: Mapped files and manifest sniffing... ");
+
+    const char *path = "_binfmt_test.cfb";
+    Ship ship = {0};
+    assert(parse_cargo_list("examples/sample_cargo_dg.txt", &ship) == 0);
+    for (int i = 0; i < ship.cargo_count; i++)
+        CARGO_PLACE(&ship.cargo[i], 1.0f, 1.0f, 1.0f);
+    AnalysisResult res;
+    memset(&res, 0, sizeof(res));
+
+    FILE *f = fopen(path, "wb");
+    assert(f != NULL);
+    assert(cfb_write(f, &ship, &res) == 0);
+    fclose(f);
+
+    assert(cfb_is_binary_file(path));
+    assert(!cfb_is_binary_file("examples/sample_cargo_dg.txt"));
+    assert(!cfb_is_binary_file("-"));
+    assert(!cfb_is_binary_file("_binfmt_no_such_file"));
+
+    CfbImage img;
+    assert(cfb_open(path, &img) == 0);
+    assert(img.owned != CFB_OWN_NONE);
+    Ship mapped = {0};
+    assert(cfb_load(&img, &mapped, NULL) == 0);
+    assert(mapped.cargo[0].pos_x == 1.0f && CARGO_IS_PLACED(&mapped.cargo[0]));  // plan kept
+    cfb_close(&img);
+
+    // As an optimizer input the stored plan is dropped
+    Ship manifest = {0};
+    assert(cfb_load_manifest(path, &manifest) == 0);
+    assert_same_cargo(&ship, &manifest);
+    for (int i = 0; i < manifest.cargo_count; i++)
+        assert(manifest.cargo[i].pos_x == -1.0f && !CARGO_IS_PLACED(&manifest.cargo[i]));
+
+    Ship text = {0};
+    assert(cfb_load_manifest("examples/sample_cargo_dg.txt", &text) == 0);
+    assert_same_cargo(&ship, &text);
+
+    remove(path);
+    ship_cleanup(&ship);
+    ship_cleanup(&mapped);
+    ship_cleanup(&manifest);
+    ship_cleanup(&text);
+    printf("PASS\n");
+}
+
+int main(void) {
+    printf("Running binary format tests...\n\n");
+
+    test_manifest_round_trip();
+    test_plan_round_trip();
+    test_rejects_malformed();
+    test_text_export();
+    test_file_loading();
+
+    printf("\nAll binary format tests passed!\n");
+    return 0;
+}
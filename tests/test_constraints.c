@@ -7,12 +7,19 @@
 #include "cargoforge.h"
 #include "constraints.h"
 #include "placement_3d.h"
+#include "spatial_index.h"
+#include "stack_grid.h"
+#include "holds.h"
+#include "imdg.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <assert.h>
 
+/* Label for a hand-built item, alive to the end of the enclosing block */
+#define LABEL(id, type) (&(const CargoLabel){ id, type })
+
 static Ship create_test_ship(void) {
     Ship ship = {
         .length = 100.0f,
@@ -28,14 +35,13 @@ static Ship create_test_ship(void) {
     return ship;
 }
 
-static Bin3D create_test_bin(const char *name, float max_wt) {
+static Bin3D create_test_bin(const char *name, float max_wt, unsigned int flags) {
     Bin3D bin;
     memset(&bin, 0, sizeof(bin));
     strncpy(bin.name, name, sizeof(bin.name) - 1);
     bin.max_weight = max_wt;
+    bin.flags = flags;
     bin.current_weight = 0;
-    bin.spaces[0] = (Space3D){0, 0, 0, 100, 20, 8, 1};
-    bin.space_count = 1;
     return bin;
 }
 
@@ -43,10 +49,10 @@ static Bin3D create_test_bin(const char *name, float max_wt) {
 void test_cargo_type_detection(void) {
     printf("Test 1: Cargo type detection... ");
 
-    Cargo haz = {.type = "hazardous"};
-    Cargo fra = {.type = "fragile"};
-    Cargo ref = {.type = "reefer"};
-    Cargo std = {.type = "standard"};
+    Cargo haz = {.flags = CARGO_HAZARDOUS};
+    Cargo fra = {.flags = CARGO_FRAGILE};
+    Cargo ref = {.flags = CARGO_REEFER};
+    Cargo std = {0};
 
     assert(is_hazardous(&haz) == 1);
     assert(is_hazardous(&std) == 0);
@@ -82,14 +88,14 @@ void test_hazmat_too_close(void) {
     Ship ship = create_test_ship();
     ship.cargo_count = 1;
     ship.cargo[0] = (Cargo){
-        .id = "Haz1", .weight = 5000.0f,
-        .dimensions = {2.0f, 2.0f, 2.0f}, .type = "hazardous",
+        .label = LABEL("Haz1", "hazardous"), .weight = 5000.0f,
+        .dimensions = {2.0f, 2.0f, 2.0f}, .flags = CARGO_HAZARDOUS | CARGO_PLACED,
         .pos_x = 10.0f, .pos_y = 10.0f, .pos_z = 0.0f
     };
 
     Cargo new_haz = {
-        .id = "Haz2", .weight = 5000.0f,
-        .dimensions = {2.0f, 2.0f, 2.0f}, .type = "hazardous"
+        .label = LABEL("Haz2", "hazardous"), .weight = 5000.0f,
+        .dimensions = {2.0f, 2.0f, 2.0f}, .flags = CARGO_HAZARDOUS
     };
 
     /* 1m away - should fail (min 3m) */
@@ -109,14 +115,14 @@ void test_hazmat_non_hazardous(void) {
     Ship ship = create_test_ship();
     ship.cargo_count = 1;
     ship.cargo[0] = (Cargo){
-        .id = "Haz1", .weight = 5000.0f,
-        .dimensions = {2.0f, 2.0f, 2.0f}, .type = "hazardous",
+        .label = LABEL("Haz1", "hazardous"), .weight = 5000.0f,
+        .dimensions = {2.0f, 2.0f, 2.0f}, .flags = CARGO_HAZARDOUS | CARGO_PLACED,
         .pos_x = 10.0f, .pos_y = 10.0f, .pos_z = 0.0f
     };
 
     Cargo standard = {
-        .id = "Std1", .weight = 5000.0f,
-        .dimensions = {2.0f, 2.0f, 2.0f}, .type = "standard"
+        .label = LABEL("Std1", "standard"), .weight = 5000.0f,
+        .dimensions = {2.0f, 2.0f, 2.0f}
     };
 
     /* Standard cargo right next to hazmat - should pass */
@@ -148,8 +154,8 @@ void test_stack_pressure_with_load(void) {
     ship.cargo_count = 1;
     /* 10t cargo directly above (full overlap) */
     ship.cargo[0] = (Cargo){
-        .id = "Top", .weight = 10000.0f,  /* 10t */
-        .dimensions = {4.0f, 3.0f, 2.0f}, .type = "standard",
+        .label = LABEL("Top", "standard"), .weight = 10000.0f,  /* 10t */
+        .dimensions = {4.0f, 3.0f, 2.0f}, .flags = CARGO_PLACED,
         .pos_x = 10.0f, .pos_y = 5.0f, .pos_z = 2.0f  /* above z=0 */
     };
 
@@ -170,8 +176,8 @@ void test_stack_pressure_partial_overlap(void) {
     ship.cargo_count = 1;
     /* 12t cargo at (10,5,2), dims 4x3 */
     ship.cargo[0] = (Cargo){
-        .id = "Top", .weight = 12000.0f,  /* 12t */
-        .dimensions = {4.0f, 3.0f, 2.0f}, .type = "standard",
+        .label = LABEL("Top", "standard"), .weight = 12000.0f,  /* 12t */
+        .dimensions = {4.0f, 3.0f, 2.0f}, .flags = CARGO_PLACED,
         .pos_x = 10.0f, .pos_y = 5.0f, .pos_z = 2.0f
     };
 
@@ -194,19 +200,20 @@ void test_deck_weight_limit(void) {
     Ship ship = create_test_ship();
     ship.cargo_count = 0;
 
-    Bin3D deck = create_test_bin("Deck", ship.max_weight * 0.4f);
+    Bin3D deck = create_test_bin("Deck", ship.max_weight * 0.4f, HOLD_FLAG_DECK);
     /* Already 29% loaded */
     deck.current_weight = ship.max_weight * 0.29f;
     Space3D space = {0, 0, 0, 100, 20, 4, 1};
 
     /* Adding 2% more - total 31% > 30% limit */
     Cargo heavy = {
-        .id = "DeckH", .weight = ship.max_weight * 0.02f,
-        .dimensions = {5.0f, 5.0f, 2.0f}, .type = "standard"
+        .label = LABEL("DeckH", "standard"), .weight = ship.max_weight * 0.02f,
+        .dimensions = {5.0f, 5.0f, 2.0f}
     };
 
     int ok = check_cargo_constraints(&ship, &heavy, &deck, &space);
     assert(ok == 0);  /* Should be rejected */
+    assert(constraint_check(&ship, &heavy, &deck, &space) == DIAG_DECK_WEIGHT);
 
     free(ship.cargo);
     printf("PASS\n");
@@ -219,12 +226,12 @@ void test_standard_cargo_passes(void) {
     Ship ship = create_test_ship();
     ship.cargo_count = 0;
 
-    Bin3D hold = create_test_bin("ForwardHold", ship.max_weight * 0.3f);
+    Bin3D hold = create_test_bin("ForwardHold", ship.max_weight * 0.3f, 0);
     Space3D space = {10, 5, -8, 10, 10, 8, 1};
 
     Cargo normal = {
-        .id = "Normal", .weight = 50000.0f,
-        .dimensions = {4.0f, 3.0f, 2.0f}, .type = "standard"
+        .label = LABEL("Normal", "standard"), .weight = 50000.0f,
+        .dimensions = {4.0f, 3.0f, 2.0f}
     };
 
     int ok = check_cargo_constraints(&ship, &normal, &hold, &space);
@@ -234,6 +241,493 @@ void test_standard_cargo_passes(void) {
     printf("PASS\n");
 }
 
+/* Test 10: Indexed queries agree with the linear scans */
+void test_spatial_index_matches_scan(void) {
+    printf("Test 10: Spatial index matches linear scan... ");
+
+    Ship ship = create_test_ship();
+    ship.cargo_count = 4;
+    ship.cargo[0] = (Cargo){ .label = LABEL("A", "standard"), .weight = 9000.0f, .dimensions = {12.0f, 2.4f, 2.6f},
+                             .flags = CARGO_PLACED, .pos_x = 10.0f, .pos_y = 5.0f, .pos_z = 2.0f };
+    ship.cargo[1] = (Cargo){ .label = LABEL("B", "hazardous"), .weight = 4000.0f, .dimensions = {3.0f, 3.0f, 2.0f},
+                             .flags = CARGO_HAZARDOUS | CARGO_PLACED, .pos_x = 40.0f, .pos_y = 10.0f, .pos_z = 0.0f };
+    ship.cargo[2] = (Cargo){ .label = LABEL("C", "standard"), .weight = 7000.0f, .dimensions = {6.0f, 2.4f, 2.6f},
+                             .flags = CARGO_PLACED, .pos_x = 14.0f, .pos_y = 6.0f, .pos_z = 4.6f };
+    ship.cargo[3] = (Cargo){ .label = LABEL("D", "standard"), .weight = 1000.0f, .dimensions = {2.0f, 2.0f, 2.0f},
+                             .pos_x = -1.0f, .pos_y = -1.0f, .pos_z = -1.0f };
+
+    Cargo haz = { .label = LABEL("H", "hazardous"), .weight = 1000.0f, .dimensions = {2.0f, 2.0f, 2.0f},
+                  .flags = CARGO_HAZARDOUS };
+
+    float p_scan = calculate_stack_pressure(&ship, 12.0f, 5.0f, 0.0f, 6.0f, 3.0f);
+    int   h_near_scan = check_hazmat_separation(&ship, &haz, 41.0f, 11.0f, 0.0f);
+    int   h_far_scan  = check_hazmat_separation(&ship, &haz, 60.0f, 11.0f, 0.0f);
+
+    SpatialIndex *idx = spatial_index_create(ship.length, ship.width, SPATIAL_CELL_SIZE);
+    assert(idx != NULL);
+    for (int i = 0; i < ship.cargo_count; i++) {
+        if (CARGO_IS_PLACED(&ship.cargo[i]))
+            assert(spatial_index_insert(idx, &ship.cargo[i], i) == 0);
+    }
+    ship.placed_index = idx;
+
+    assert(fabsf(calculate_stack_pressure(&ship, 12.0f, 5.0f, 0.0f, 6.0f, 3.0f) - p_scan) < 1e-6f);
+    assert(p_scan > 0.0f);
+    assert(check_hazmat_separation(&ship, &haz, 41.0f, 11.0f, 0.0f) == h_near_scan);
+    assert(check_hazmat_separation(&ship, &haz, 60.0f, 11.0f, 0.0f) == h_far_scan);
+    assert(h_near_scan == 0 && h_far_scan == 1);
+
+    ship.placed_index = NULL;
+    spatial_index_destroy(idx);
+    free(ship.cargo);
+    printf("PASS\n");
+}
+
+/* Test 11: Deck rules follow the bin flags, not the bin name */
+void test_deck_rules_use_flags(void) {
+    printf("Test 11: Deck rules keyed on flags... ");
+
+    Ship ship = create_test_ship();
+    ship.cargo_count = 0;
+    Space3D space = {0, 0, 0, 100, 20, 4, 1};
+    Cargo heavy = {
+        .label = LABEL("DeckH", "standard"), .weight = ship.max_weight * 0.02f,
+        .dimensions = {5.0f, 5.0f, 2.0f}
+    };
+
+    /* Named "Deck" but not flagged: no deck weight-ratio limit */
+    Bin3D named = create_test_bin("Deck", ship.max_weight, 0);
+    named.current_weight = ship.max_weight * 0.29f;
+    assert(check_cargo_constraints(&ship, &heavy, &named, &space) == 1);
+
+    /* Any name with the deck flag gets the limit */
+    Bin3D bay = create_test_bin("Bay14", ship.max_weight, HOLD_FLAG_DECK);
+    bay.current_weight = ship.max_weight * 0.29f;
+    assert(check_cargo_constraints(&ship, &heavy, &bay, &space) == 0);
+
+    free(ship.cargo);
+    printf("PASS\n");
+}
+
+/* Test 12: Placement uses the configured compartments */
+void test_placement_in_configured_holds(void) {
+    printf("Test 12: Placement into configured holds... ");
+
+    Ship ship = create_test_ship();
+    ship.quiet = 1;
+    HoldConfig holds = {0};
+    for (int h = 0; h < 9; h++) {
+        HoldDef def = { "", 5.0f + 10.0f * h, 1.0f, -6.0f, 9.0f, 18.0f, 6.0f,
+                        200000.0f, h == 8 ? HOLD_FLAG_DECK : 0 };
+        snprintf(def.name, sizeof(def.name), "Hold%d", h + 1);
+        if (h == 8) { def.x = 0.0f; def.z = 0.0f; def.length = 100.0f; def.height = 3.0f; }
+        assert(hold_config_add(&holds, &def) == 0);
+    }
+    ship.holds = &holds;
+
+    ship.cargo_count = 10;
+    CargoLabel labels[10];
+    memset(labels, 0, sizeof(labels));
+    for (int i = 0; i < ship.cargo_count; i++) {
+        snprintf(labels[i].id, sizeof(labels[i].id), "Box%d", i);
+        strcpy(labels[i].type, "standard");
+        Cargo c = { .weight = 5000.0f, .dimensions = {4.0f, 3.0f, 2.5f}, .label = &labels[i] };
+        ship.cargo[i] = c;
+    }
+
+    place_cargo_3d(&ship);
+
+    for (int i = 0; i < ship.cargo_count; i++) {
+        const Cargo *c = &ship.cargo[i];
+        assert(c->pos_x >= 0.0f);   /* plenty of room */
+        int inside = 0;
+        for (int h = 0; h < holds.count; h++) {
+            const HoldDef *d = &holds.holds[h];
+            if (c->pos_x >= d->x && c->pos_x < d->x + d->length &&
+                c->pos_y >= d->y && c->pos_y < d->y + d->width &&
+                c->pos_z >= d->z && c->pos_z < d->z + d->height)
+                inside = 1;
+        }
+        assert(inside);
+    }
+    /* First hold fills first (tightest fit, earliest bin on ties) */
+    assert(ship.cargo[0].pos_x == 5.0f && ship.cargo[0].pos_z == -6.0f);
+
+    hold_config_free(&holds);
+    free(ship.cargo);
+    printf("PASS\n");
+}
+
+/* Test 13: A kept plan can release a stack and refill the freed space */
+void test_placement_state_edit(void) {
+    printf("Test 13: Edit a kept placement state... ");
+
+    Ship ship = create_test_ship();
+    ship.quiet = 1;
+    HoldConfig holds = {0};
+    HoldDef def = { "Shaft", 10.0f, 5.0f, -6.0f, 4.0f, 3.0f, 6.0f, 100000.0f, 0 };
+    assert(hold_config_add(&holds, &def) == 0);
+    ship.holds = &holds;
+
+    ship.cargo_count = 3;
+    CargoLabel labels[4];
+    memset(labels, 0, sizeof(labels));
+    for (int i = 0; i < ship.cargo_count; i++) {
+        snprintf(labels[i].id, sizeof(labels[i].id), "Tier%d", i);
+        strcpy(labels[i].type, "standard");
+        Cargo c = { .weight = 1000.0f, .dimensions = {4.0f, 3.0f, 2.0f}, .label = &labels[i] };
+        ship.cargo[i] = c;
+    }
+
+    PlacementState state;
+    placement_state_init(&state);
+    PlacementOptions opts;
+    placement_options_init(&opts);
+    opts.state = &state;
+    place_cargo_3d_opts(&ship, &opts);
+
+    assert(state.bin_count == 1 && state.slot_count == 3);
+    assert(ship.cargo[0].pos_z == -6.0f && ship.cargo[1].pos_z == -4.0f &&
+           ship.cargo[2].pos_z == -2.0f);
+    assert(fabsf(state.bins[0].current_weight - 3000.0f) < 0.01f);
+
+    /* Everything above an item depends on it */
+    int out[10];
+    assert(placement_state_dependents(&state, &ship, 0, out) == 3);
+    assert(placement_state_dependents(&state, &ship, 1, out) == 2);
+    assert(out[0] == 1 && out[1] == 2);
+    assert(placement_state_dependents(&state, &ship, 2, out) == 1);
+
+    /* Cancel the bottom tier: release the stack, drop it, re-place the rest */
+    int n = placement_state_dependents(&state, &ship, 0, out);
+    for (int k = 0; k < n; k++)
+        assert(placement_state_release(&state, &ship, out[k]) == 0);
+    assert(ship.cargo[1].pos_x < 0.0f && fabsf(state.bins[0].current_weight) < 0.01f);
+    placement_state_erase(&state, 0);
+    memmove(&ship.cargo[0], &ship.cargo[1], 2 * sizeof(Cargo));
+    ship.cargo_count = 2;
+
+    int again[2] = { 0, 1 };
+    assert(placement_state_place(&state, &ship, again, 2, NULL) == 2);
+    assert(ship.cargo[0].pos_z == -6.0f && ship.cargo[1].pos_z == -4.0f);
+
+    /* Two late items: one fits the freed top tier, one does not */
+    ship.cargo_count = 4;
+    for (int i = 2; i < 4; i++) {
+        snprintf(labels[i].id, sizeof(labels[i].id), "Late%d", i);
+        strcpy(labels[i].type, "standard");
+        Cargo c = { .weight = 1000.0f, .dimensions = {4.0f, 3.0f, 2.0f}, .label = &labels[i],
+                    .pos_x = -1.0f, .pos_y = -1.0f, .pos_z = -1.0f };
+        ship.cargo[i] = c;
+    }
+    int late[2] = { 2, 3 };
+    assert(placement_state_place(&state, &ship, late, 2, NULL) == 1);
+    assert(state.slot_count == 4);
+    assert(ship.cargo[2].pos_z == -2.0f && ship.cargo[3].pos_x < 0.0f);
+    assert(state.slots[3].bin == -1);
+
+    placement_state_free(&state);
+    assert(state.bins == NULL && state.slots == NULL);
+    hold_config_free(&holds);
+    free(ship.cargo);
+    printf("PASS\n");
+}
+
+/* Test 14: IMDG checks use the placed-class mask and the rule table */
+void test_imdg_segregation_lookup(void) {
+    printf("Test 14: IMDG segregation via class mask... ");
+
+    DGInfo flammable = { .dg_class = 3, .dg_division = 0 };
+    DGInfo oxidizer  = { .dg_class = 5, .dg_division = 1 };
+    DGInfo misc      = { .dg_class = 9, .dg_division = 0 };
+    DGInfo explosive = { .dg_class = 1, .dg_division = 1 };
+
+    Ship ship = create_test_ship();
+    ship.quiet = 1;
+    ship.cargo_count = 1;
+    ship.cargo[0] = (Cargo){ .label = LABEL("FL", "hazardous"), .weight = 9000.0f, .dimensions = {6.0f, 2.4f, 2.6f},
+                             .flags = CARGO_HAZARDOUS | CARGO_PLACED, .pos_x = 20.0f, .pos_y = 5.0f, .pos_z = 0.0f,
+                             .dg_index = (unsigned char)(imdg_class_index(3, 0) + 1),
+                             .dg = &flammable };
+
+    SpatialIndex *idx = spatial_index_create(ship.length, ship.width, SPATIAL_CELL_SIZE);
+    assert(idx != NULL);
+    assert(spatial_index_insert(idx, &ship.cargo[0], 0) == 0);
+    assert(idx->dg_classes == 1u << imdg_class_index(3, 0));
+    ship.placed_index = idx;
+
+    Bin3D hold = create_test_bin("Hold", ship.max_weight, 0);
+    Space3D near = {24, 5, 0, 10, 10, 8, 1};
+    Space3D far  = {60, 5, 0, 10, 10, 8, 1};
+    Cargo item = { .label = LABEL("NEW", "hazardous"), .weight = 9000.0f, .dimensions = {6.0f, 2.4f, 2.6f},
+                   .flags = CARGO_HAZARDOUS };
+
+    /* 3 vs 5.1 is "separated from": 6 m */
+    item.dg = &oxidizer;
+    assert(imdg_rules[imdg_cargo_class(&item)][imdg_class_index(3, 0)].min_distance == 6.0f);
+    assert(check_cargo_constraints(&ship, &item, &hold, &near) == 0);
+    assert(check_cargo_constraints(&ship, &item, &hold, &far) == 1);
+
+    /* Class 9 conflicts with nothing placed, so close stowage is fine */
+    item.dg = &misc;
+    assert(!(idx->dg_classes & imdg_conflicts[imdg_cargo_class(&item)]));
+    assert(check_cargo_constraints(&ship, &item, &hold, &near) == 1);
+
+    /* Explosives are incompatible at any distance */
+    item.dg = &explosive;
+    assert(check_cargo_constraints(&ship, &item, &hold, &far) == 0);
+
+    /* The inline index wins over the DGInfo record once the parser set it */
+    item.dg = &explosive;
+    item.dg_index = (unsigned char)(imdg_class_index(9, 0) + 1);
+    assert(check_cargo_constraints(&ship, &item, &hold, &far) == 1);
+
+    ship.placed_index = NULL;
+    spatial_index_destroy(idx);
+    free(ship.cargo);
+    printf("PASS\n");
+}
+
+/* Test 15: Placement reports rejections once per item, into a ring */
+void test_placement_diagnostics(void) {
+    printf("Test 15: Per-item placement diagnostics... ");
+
+    /* Ring wrap-around and totals */
+    DiagLog log;
+    assert(diag_log_init(&log, 2) == 0);
+    int counts[DIAG_CODE_COUNT] = {0};
+    diag_log_record(&log, 0, "QUIET", counts);          /* nothing to say */
+    assert(diag_log_count(&log) == 0 && log.written == 0);
+    for (int i = 1; i <= 3; i++) {
+        counts[DIAG_STACK_PRESSURE] = i;
+        diag_log_record(&log, i, "ITEM", counts);
+    }
+    assert(diag_log_count(&log) == 2 && log.written == 3);
+    assert(diag_log_get(&log, 0)->cargo_idx == 2 && diag_log_get(&log, 1)->cargo_idx == 3);
+    assert(diag_log_get(&log, 2) == NULL);
+    assert(log.totals[DIAG_STACK_PRESSURE] == 6);
+    diag_log_clear(&log);
+    assert(diag_log_count(&log) == 0 && log.totals[DIAG_STACK_PRESSURE] == 0);
+    diag_log_free(&log);
+
+    /* Explosives placed last have every candidate refused, and the
+     * reefer gets a note only if it went below deck */
+    DGInfo flammable = { .dg_class = 3, .dg_division = 0 };
+    DGInfo explosive = { .dg_class = 1, .dg_division = 1 };
+    Ship ship = create_test_ship();
+    ship.quiet = 1;
+    ship.cargo_count = 3;
+    ship.cargo[0] = (Cargo){ .label = LABEL("REEF", "reefer"), .weight = 900.0f, .dimensions = {3.0f, 3.0f, 3.0f},
+                             .flags = CARGO_REEFER };
+    ship.cargo[1] = (Cargo){ .label = LABEL("FLAM", "hazardous"), .weight = 900.0f, .dimensions = {2.0f, 2.0f, 2.0f},
+                             .flags = CARGO_HAZARDOUS, .dg = &flammable };
+    ship.cargo[2] = (Cargo){ .label = LABEL("EXPL", "hazardous"), .weight = 900.0f, .dimensions = {1.0f, 1.0f, 1.0f},
+                             .flags = CARGO_HAZARDOUS, .dg = &explosive };
+
+    assert(diag_log_init(&log, 8) == 0);
+    PlacementOptions opts;
+    placement_options_init(&opts);
+    opts.diag = &log;
+    place_cargo_3d_opts(&ship, &opts);
+
+    assert(ship.cargo[2].pos_x < 0 && ship.cargo[0].pos_x >= 0 && ship.cargo[1].pos_x >= 0);
+    int reefer_noted = ship.cargo[0].pos_z < 0.0f;
+    assert(diag_log_count(&log) == 1 + reefer_noted);
+    const DiagRecord *last = diag_log_get(&log, diag_log_count(&log) - 1);
+    assert(last->cargo_idx == 2 && strcmp(last->cargo_id, "EXPL") == 0);
+    assert(last->counts[DIAG_UNPLACED] == 1 && last->counts[DIAG_IMDG_INCOMPATIBLE] > 0);
+    assert(log.totals[DIAG_REEFER_PLACEMENT] == reefer_noted);
+    diag_log_free(&log);
+
+    free(ship.cargo);
+    printf("PASS\n");
+}
+
+/* Overlap of [a0, a0+al) and [b0, b0+bl), 0 if they only touch */
+static float span_overlap(float a0, float al, float b0, float bl) {
+    float lo = fmaxf(a0, b0), hi = fminf(a0 + al, b0 + bl);
+    return hi - lo > 1e-3f ? hi - lo : 0.0f;
+}
+
+/* Test 16: Extreme-point placements stay in the hold, apart and supported */
+void test_extreme_point_placement(void) {
+    printf("Test 16: Extreme-point placement... ");
+
+    static const float sides[4] = { 2.5f, 2.0f, 1.5f, 1.0f };
+    HoldConfig holds = {0};
+    HoldDef def = { "Hold", 10.0f, -4.0f, -6.0f, 12.0f, 8.0f, 6.0f, 1e7f, 0 };
+    assert(hold_config_add(&holds, &def) == 0);
+
+    int placed[2];
+    for (int engine = PLACER_GUILLOTINE; engine <= PLACER_EXTREME_POINTS; engine++) {
+        Ship ship = create_test_ship();
+        ship.quiet = 1;
+        ship.holds = &holds;
+        ship.cargo_count = 90;
+        ship.cargo = realloc(ship.cargo, 90 * sizeof(Cargo));
+        CargoLabel labels[90];
+        memset(labels, 0, sizeof(labels));
+        for (int i = 0; i < ship.cargo_count; i++) {
+            snprintf(labels[i].id, sizeof(labels[i].id), "Cube%d", i);
+            strcpy(labels[i].type, "standard");
+            float a = sides[(i * 7) % 4];
+            ship.cargo[i] = (Cargo){ .weight = 100.0f, .dimensions = {a, a, a}, .label = &labels[i] };
+        }
+
+        PlacementOptions opts;
+        placement_options_init(&opts);
+        opts.engine = engine;
+        place_cargo_3d_opts(&ship, &opts);
+
+        placed[engine] = 0;
+        for (int i = 0; i < ship.cargo_count; i++) {
+            const Cargo *c = &ship.cargo[i];
+            if (!CARGO_IS_PLACED(c)) continue;
+            placed[engine]++;
+            float a = c->dimensions[0];
+            assert(c->pos_x >= def.x - 1e-3f && c->pos_x + a <= def.x + def.length + 1e-3f);
+            assert(c->pos_y >= def.y - 1e-3f && c->pos_y + a <= def.y + def.width + 1e-3f);
+            assert(c->pos_z >= def.z - 1e-3f && c->pos_z + a <= def.z + def.height + 1e-3f);
+
+            /* Nothing overlaps it, and the tops right below cover its base */
+            float base = c->pos_z <= def.z + 1e-3f ? a * a : 0.0f;
+            for (int j = 0; j < ship.cargo_count; j++) {
+                const Cargo *o = &ship.cargo[j];
+                if (j == i || !CARGO_IS_PLACED(o)) continue;
+                float b = o->dimensions[0];
+                float area = span_overlap(c->pos_x, a, o->pos_x, b) *
+                             span_overlap(c->pos_y, a, o->pos_y, b);
+                assert(area == 0.0f || span_overlap(c->pos_z, a, o->pos_z, b) == 0.0f);
+                if (fabsf(o->pos_z + b - c->pos_z) < 1e-3f) base += area;
+            }
+            assert(fabsf(base - a * a) < 1e-2f);
+        }
+        ship.cargo_count = 0;
+        free(ship.cargo);
+    }
+    /* 630 m3 of cubes for 576 m3 of hold: both engines fill most of it */
+    assert(placed[PLACER_GUILLOTINE] > 45 && placed[PLACER_EXTREME_POINTS] > 45);
+
+    /* A kept extreme-point plan can be edited like a guillotine one */
+    Ship ship = create_test_ship();
+    ship.quiet = 1;
+    HoldDef shaft = { "Shaft", 10.0f, 5.0f, -6.0f, 4.0f, 3.0f, 6.0f, 100000.0f, 0 };
+    HoldConfig one = {0};
+    assert(hold_config_add(&one, &shaft) == 0);
+    ship.holds = &one;
+    ship.cargo_count = 3;
+    CargoLabel labels[3];
+    memset(labels, 0, sizeof(labels));
+    for (int i = 0; i < ship.cargo_count; i++) {
+        snprintf(labels[i].id, sizeof(labels[i].id), "Tier%d", i);
+        strcpy(labels[i].type, "standard");
+        ship.cargo[i] = (Cargo){ .weight = 1000.0f, .dimensions = {4.0f, 3.0f, 2.0f}, .label = &labels[i] };
+    }
+    PlacementState state;
+    placement_state_init(&state);
+    PlacementOptions opts;
+    placement_options_init(&opts);
+    opts.state = &state;
+    opts.engine = PLACER_EXTREME_POINTS;
+    place_cargo_3d_opts(&ship, &opts);
+    assert(state.engine == PLACER_EXTREME_POINTS);
+    assert(ship.cargo[0].pos_z == -6.0f && ship.cargo[1].pos_z == -4.0f &&
+           ship.cargo[2].pos_z == -2.0f);
+
+    /* Release the top two tiers and put one back: it lands on the first */
+    assert(placement_state_release(&state, &ship, 2) == 0);
+    assert(placement_state_release(&state, &ship, 1) == 0);
+    int again[1] = { 1 };
+    assert(placement_state_place(&state, &ship, again, 1, NULL) == 1);
+    assert(ship.cargo[1].pos_z == -4.0f && ship.cargo[2].pos_x < 0.0f);
+
+    /* Releasing a whole stack bottom first gives the shaft back in one piece */
+    int out[3];
+    int n = placement_state_dependents(&state, &ship, 0, out);
+    assert(n == 2);
+    for (int k = 0; k < n; k++)
+        assert(placement_state_release(&state, &ship, out[k]) == 0);
+    assert(state.bins[0].spaces.count == 1 && state.bins[0].spaces.height[0] == 6.0f);
+    int all[3] = { 0, 1, 2 };
+    assert(placement_state_place(&state, &ship, all, 3, NULL) == 3);
+    assert(ship.cargo[0].pos_z == -6.0f && ship.cargo[1].pos_z == -4.0f &&
+           ship.cargo[2].pos_z == -2.0f);
+
+    placement_state_free(&state);
+    hold_config_free(&one);
+    hold_config_free(&holds);
+    free(ship.cargo);
+    printf("PASS\n");
+}
+
+/* Test 17: The stack weight grid gives the scan's pressure */
+void test_stack_grid_matches_scan(void) {
+    printf("Test 17: Stack weight grid matches linear scan... ");
+
+    Ship ship = create_test_ship();
+    free(ship.cargo);
+    ship.cargo_capacity = 300;
+    ship.cargo = calloc((size_t)ship.cargo_capacity, sizeof(Cargo));
+    assert(ship.cargo != NULL);
+
+    /* Boxes of all sizes, some spanning many cells, some off the hull */
+    unsigned int seed = 12345;
+    for (int i = 0; i < ship.cargo_capacity; i++) {
+        Cargo *c = &ship.cargo[i];
+        seed = seed * 1103515245u + 12345u;
+        c->label = LABEL("S", "standard");
+        c->weight = 500.0f + (float)(seed % 20000);
+        c->dimensions[0] = 0.5f + (float)((seed >> 8) % 120) / 10.0f;
+        c->dimensions[1] = 0.5f + (float)((seed >> 12) % 30) / 10.0f;
+        c->dimensions[2] = 2.0f;
+        CARGO_PLACE(c, (float)((seed >> 4) % 1050) / 10.0f - 2.0f,
+                    (float)((seed >> 14) % 210) / 10.0f - 0.5f,
+                    (float)((seed >> 20) % 6) * 2.0f);
+        if (i % 37 == 0) CARGO_UNPLACE(c);
+    }
+    ship.cargo_count = ship.cargo_capacity;
+
+    StackGrid *grid = stack_grid_create(ship.length, ship.width, STACK_CELL_SIZE);
+    assert(grid != NULL);
+    for (int i = 0; i < ship.cargo_count; i++) {
+        if (CARGO_IS_PLACED(&ship.cargo[i]))
+            assert(stack_grid_insert(grid, &ship.cargo[i]) == 0);
+    }
+
+    int nonzero = 0;
+    for (int q = 0; q < 500; q++) {
+        seed = seed * 1103515245u + 12345u;
+        float x = (float)(seed % 1000) / 10.0f, y = (float)((seed >> 10) % 200) / 10.0f;
+        float w = 0.5f + (float)((seed >> 4) % 130) / 10.0f;
+        float d = 0.5f + (float)((seed >> 16) % 30) / 10.0f;
+        float z = (float)((seed >> 22) % 6) * 2.0f;
+
+        float p_scan = calculate_stack_pressure(&ship, x, y, z, w, d);
+        ship.stack_grid = grid;
+        float p_grid = calculate_stack_pressure(&ship, x, y, z, w, d);
+        ship.stack_grid = NULL;
+        assert(fabsf(p_grid - p_scan) <= 1e-4f * fmaxf(1.0f, p_scan));
+        if (p_scan > 0.0f) nonzero++;
+    }
+    assert(nonzero > 50);
+
+    /* z bounds are exclusive at both ends */
+    StackGrid *one = stack_grid_create(10.0f, 10.0f, 0.0f);
+    assert(one != NULL && one->cell_size == STACK_CELL_SIZE);
+    Cargo box = { .label = LABEL("Z", "standard"), .weight = 6000.0f, .dimensions = {4.0f, 4.0f, 2.0f} };
+    CARGO_PLACE(&box, 1.0f, 1.0f, 2.0f);
+    assert(stack_grid_insert(one, &box) == 0);
+    assert(fabsf(stack_grid_weight(one, 1.0f, 1.0f, 2.0f, 4.0f, 0.0f, 4.0f) - 3.0f) < 1e-5f);
+    assert(stack_grid_weight(one, 1.0f, 1.0f, 4.0f, 4.0f, 2.0f, 4.0f) == 0.0f);
+    assert(stack_grid_weight(one, 1.0f, 1.0f, 4.0f, 4.0f, 0.0f, 2.0f) == 0.0f);
+    assert(stack_grid_weight(one, 6.0f, 6.0f, 2.0f, 2.0f, 0.0f, 4.0f) == 0.0f);
+    stack_grid_destroy(one);
+
+    stack_grid_destroy(grid);
+    free(ship.cargo);
+    printf("PASS\n");
+}
+
 int main(void) {
     printf("\n=== Running Constraints Module Tests ===\n\n");
 
@@ -246,6 +740,14 @@ int main(void) {
     test_stack_pressure_partial_overlap();
     test_deck_weight_limit();
     test_standard_cargo_passes();
+    test_spatial_index_matches_scan();
+    test_deck_rules_use_flags();
+    test_placement_in_configured_holds();
+    test_placement_state_edit();
+    test_imdg_segregation_lookup();
+    test_placement_diagnostics();
+    test_extreme_point_placement();
+    test_stack_grid_matches_scan();
 
     printf("\n=== All Constraints Tests Passed! ===\n\n");
     return 0;
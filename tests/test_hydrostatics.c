@@ -148,6 +148,80 @@ static void test_draft_from_displacement(void) {
     ASSERT_NEAR(draft, 5.0f, 0.01f, "5000t -> 5.0m draft");
 }
 
+static void test_parse_reject_displacement_decrease(void) {
+    printf("  test_parse_reject_displacement_decrease...\n");
+    const char *path = "/tmp/test_hydro_disp.csv";
+    FILE *fp = fopen(path, "w");
+    fprintf(fp, "2.0,2000,10.0,1.0,9.0,8.0,180.0,3000,1.0\n");
+    fprintf(fp, "4.0,1900,8.0,2.0,6.0,10.0,200.0,3500,0.5\n");
+    fclose(fp);
+
+    HydroTable table;
+    int ret = parse_hydro_table(path, &table);
+    ASSERT(ret == -1, "reject decreasing displacement");
+}
+
+/* Reference: the straightforward scan-and-lerp over entries */
+static float ref_km(const HydroTable *t, float draft) {
+    if (draft <= t->entries[0].draft) return t->entries[0].km;
+    for (int i = 0; i < t->count - 1; i++) {
+        const HydroEntry *lo = &t->entries[i], *hi = &t->entries[i + 1];
+        if (draft <= hi->draft)
+            return lo->km + (draft - lo->draft) / (hi->draft - lo->draft) * (hi->km - lo->km);
+    }
+    return t->entries[t->count - 1].km;
+}
+
+static float ref_draft(const HydroTable *t, float disp) {
+    if (disp <= t->entries[0].displacement) return t->entries[0].draft;
+    for (int i = 0; i < t->count - 1; i++) {
+        const HydroEntry *lo = &t->entries[i], *hi = &t->entries[i + 1];
+        if (disp <= hi->displacement)
+            return lo->draft + (disp - lo->displacement) /
+                   (hi->displacement - lo->displacement) * (hi->draft - lo->draft);
+    }
+    return t->entries[t->count - 1].draft;
+}
+
+static void test_index_matches_scan(void) {
+    printf("  test_index_matches_scan...\n");
+    for (int uneven = 0; uneven <= 1; uneven++) {
+        HydroTable table;
+        memset(&table, 0, sizeof(table));
+        table.count = 150;
+        float d = 1.0f;
+        for (int i = 0; i < table.count; i++) {
+            HydroEntry *e = &table.entries[i];
+            e->draft = d;
+            e->displacement = 900.0f * d + 40.0f * d * d;
+            e->km = 6.0f + 8.0f / d;
+            d += uneven ? 0.05f + 0.01f * (float)(i % 7) : 0.1f;
+        }
+
+        HydroEntry r;
+        ASSERT(hydro_interpolate(&table, 3.0f, &r) == -1, "unindexed table refused");
+        ASSERT(hydro_table_build_index(&table) == 0, "build index");
+        ASSERT((table.inv_step > 0.0f) == !uneven, "uniform spacing detected");
+
+        int bad = 0;
+        float top = table.entries[table.count - 1].draft;
+        for (int k = 0; k <= 20000; k++) {
+            float draft = 0.5f + (top + 0.5f) * (float)k / 20000.0f;
+            hydro_interpolate(&table, draft, &r);
+            if (fabsf(r.km - ref_km(&table, draft)) > 1e-4f) bad++;
+            float disp = 500.0f + r.displacement * 1.01f;
+            if (fabsf(hydro_draft_from_displacement(&table, disp) - ref_draft(&table, disp)) > 1e-4f)
+                bad++;
+        }
+        /* Exactly on every row */
+        for (int i = 0; i < table.count; i++) {
+            hydro_interpolate(&table, table.entries[i].draft, &r);
+            if (fabsf(r.km - table.entries[i].km) > 1e-4f) bad++;
+        }
+        ASSERT(bad == 0, "indexed lookups match the scan");
+    }
+}
+
 int main(void) {
     printf("=== Hydrostatics Tests ===\n");
 
@@ -159,6 +233,8 @@ int main(void) {
     test_interpolate_clamp_low();
     test_interpolate_clamp_high();
     test_draft_from_displacement();
+    test_parse_reject_displacement_decrease();
+    test_index_matches_scan();
 
     printf("Hydrostatics: %d/%d tests passed\n\n", tests_passed, tests_run);
     return (tests_passed == tests_run) ? 0 : 1;
@@ -119,24 +119,22 @@ static void test_imdg_check_all_compliant(void) {
     DGInfo dg1 = { .dg_class = 3, .dg_division = 1 }; /* flammable liquid */
     DGInfo dg2 = { .dg_class = 8, .dg_division = 0 }; /* corrosive */
 
-    strcpy(cargo[0].id, "FlammLiq");
+    static const CargoLabel flamm = { "FlammLiq", "" };
+    cargo[0].label = &flamm;
     cargo[0].weight = 25000.0f;
     cargo[0].dimensions[0] = 6.0f;
     cargo[0].dimensions[1] = 2.5f;
     cargo[0].dimensions[2] = 2.6f;
-    cargo[0].pos_x = 10.0f;
-    cargo[0].pos_y = 5.0f;
-    cargo[0].pos_z = 0.0f;
+    CARGO_PLACE(&cargo[0], 10.0f, 5.0f, 0.0f);
     cargo[0].dg = &dg1;
 
-    strcpy(cargo[1].id, "Corrosive");
+    static const CargoLabel corrosive = { "Corrosive", "" };
+    cargo[1].label = &corrosive;
     cargo[1].weight = 20000.0f;
     cargo[1].dimensions[0] = 6.0f;
     cargo[1].dimensions[1] = 2.5f;
     cargo[1].dimensions[2] = 2.6f;
-    cargo[1].pos_x = 100.0f; /* far away */
-    cargo[1].pos_y = 5.0f;
-    cargo[1].pos_z = 0.0f;
+    CARGO_PLACE(&cargo[1], 100.0f, 5.0f, 0.0f); /* far away */
     cargo[1].dg = &dg2;
 
     Ship ship;
@@ -150,6 +148,7 @@ static void test_imdg_check_all_compliant(void) {
     /* Class 3 vs 8: away from (1), min distance 3m. Items are ~84m apart. */
     ASSERT(result.compliant == 1, "far apart DG cargo is compliant");
     ASSERT(result.violation_count == 0, "no violations");
+    imdg_result_free(&result);
 }
 
 static void test_imdg_check_all_violation(void) {
@@ -162,24 +161,22 @@ static void test_imdg_check_all_violation(void) {
     DGInfo dg1 = { .dg_class = 3, .dg_division = 1 }; /* flammable liquid */
     DGInfo dg2 = { .dg_class = 5, .dg_division = 1 }; /* oxidizer */
 
-    strcpy(cargo[0].id, "FlammLiq");
+    static const CargoLabel flamm = { "FlammLiq", "" };
+    cargo[0].label = &flamm;
     cargo[0].weight = 25000.0f;
     cargo[0].dimensions[0] = 6.0f;
     cargo[0].dimensions[1] = 2.5f;
     cargo[0].dimensions[2] = 2.6f;
-    cargo[0].pos_x = 10.0f;
-    cargo[0].pos_y = 5.0f;
-    cargo[0].pos_z = 0.0f;
+    CARGO_PLACE(&cargo[0], 10.0f, 5.0f, 0.0f);
     cargo[0].dg = &dg1;
 
-    strcpy(cargo[1].id, "Oxidizer");
+    static const CargoLabel oxidizer = { "Oxidizer", "" };
+    cargo[1].label = &oxidizer;
     cargo[1].weight = 15000.0f;
     cargo[1].dimensions[0] = 6.0f;
     cargo[1].dimensions[1] = 2.5f;
     cargo[1].dimensions[2] = 2.6f;
-    cargo[1].pos_x = 17.0f; /* only 1m gap */
-    cargo[1].pos_y = 5.0f;
-    cargo[1].pos_z = 0.0f;
+    CARGO_PLACE(&cargo[1], 17.0f, 5.0f, 0.0f); /* only 1m gap */
     cargo[1].dg = &dg2;
 
     Ship ship;
@@ -193,6 +190,175 @@ static void test_imdg_check_all_violation(void) {
     /* Class 3 vs 5.1: separated from (2), min distance 6m. Items are ~1m apart. */
     ASSERT(result.compliant == 0, "close DG cargo has violations");
     ASSERT(result.violation_count > 0, "at least one violation");
+    imdg_result_free(&result);
+}
+
+static void test_rule_table(void) {
+    printf("  test_rule_table...\n");
+
+    int consistent = 1;
+    for (int a = 0; a < IMDG_MATRIX_SIZE; a++) {
+        for (int b = 0; b < IMDG_MATRIX_SIZE; b++) {
+            const IMDGRule *r = &imdg_rules[a][b];
+            if (r->min_distance != imdg_min_distance(r->seg)) consistent = 0;
+            if (!!(imdg_conflicts[a] & (1u << b)) != (r->seg != SEG_NONE)) consistent = 0;
+        }
+    }
+    ASSERT(consistent, "rule distances and conflict masks agree with the matrix");
+
+    ASSERT(imdg_class_index(1, 4) == 0, "1.4 shares the 1.1-1.6 row");
+    ASSERT(imdg_class_index(9, 0) == IMDG_MATRIX_SIZE - 1, "class 9 is the last row");
+    ASSERT(imdg_class_index(10, 0) == -1, "unknown class has no row");
+
+    DGInfo dg = { .dg_class = 5, .dg_division = 2 };
+    Cargo c;
+    memset(&c, 0, sizeof(c));
+    ASSERT(imdg_cargo_class(&c) == -1, "non-DG cargo has no class");
+    c.dg = &dg;
+    ASSERT(imdg_cargo_class(&c) == imdg_class_index(5, 2), "class resolved from DGInfo");
+    c.dg_index = (unsigned char)(imdg_class_index(8, 0) + 1);
+    ASSERT(imdg_cargo_class(&c) == imdg_class_index(8, 0), "inline index is used when set");
+}
+
+/* Reference: the plain all-pairs check the sweep replaces */
+static float edge_distance(const Cargo *a, const Cargo *b) {
+    float ax = a->pos_x + a->dimensions[0] / 2.0f;
+    float ay = a->pos_y + a->dimensions[1] / 2.0f;
+    float bx = b->pos_x + b->dimensions[0] / 2.0f;
+    float by = b->pos_y + b->dimensions[1] / 2.0f;
+    float dx = fabsf(ax - bx) - (a->dimensions[0] + b->dimensions[0]) / 2.0f;
+    float dy = fabsf(ay - by) - (a->dimensions[1] + b->dimensions[1]) / 2.0f;
+    if (dx < 0) dx = 0;
+    if (dy < 0) dy = 0;
+    return sqrtf(dx * dx + dy * dy);
+}
+
+static int naive_violations(const Ship *ship, int *pairs, int max_pairs) {
+    int n = 0;
+    for (int i = 0; i < ship->cargo_count; i++) {
+        const Cargo *a = &ship->cargo[i];
+        if (!CARGO_IS_PLACED(a) || !a->dg) continue;
+        for (int j = i + 1; j < ship->cargo_count; j++) {
+            const Cargo *b = &ship->cargo[j];
+            if (!CARGO_IS_PLACED(b) || !b->dg) continue;
+            SegregationType req = imdg_get_segregation(a->dg->dg_class, a->dg->dg_division,
+                                                       b->dg->dg_class, b->dg->dg_division);
+            if (req == SEG_NONE) continue;
+            if (req != SEG_INCOMPATIBLE && edge_distance(a, b) >= imdg_min_distance(req))
+                continue;
+            if (n < max_pairs) {
+                pairs[2 * n] = i;
+                pairs[2 * n + 1] = j;
+            }
+            n++;
+        }
+    }
+    return n;
+}
+
+static unsigned int rng_state = 12345u;
+
+static float rand_unit(void) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return (float)((rng_state >> 8) & 0xFFFF) / 65536.0f;
+}
+
+static void test_sweep_matches_all_pairs(void) {
+    printf("  test_sweep_matches_all_pairs...\n");
+
+    /* Classes without class 1, so incompatible pairs stay rare */
+    static const DGInfo classes[] = {
+        {.dg_class = 2, .dg_division = 1}, {.dg_class = 2, .dg_division = 2},
+        {.dg_class = 2, .dg_division = 3}, {.dg_class = 3, .dg_division = 0},
+        {.dg_class = 4, .dg_division = 1}, {.dg_class = 4, .dg_division = 2},
+        {.dg_class = 4, .dg_division = 3}, {.dg_class = 5, .dg_division = 1},
+        {.dg_class = 5, .dg_division = 2}, {.dg_class = 6, .dg_division = 1},
+        {.dg_class = 7, .dg_division = 0}, {.dg_class = 8, .dg_division = 0},
+        {.dg_class = 9, .dg_division = 0}, {.dg_class = 1, .dg_division = 4},
+    };
+    int nclasses = (int)(sizeof(classes) / sizeof(classes[0]));
+
+    enum { N = 400, MAX_PAIRS = 20000 };
+    Cargo *cargo = calloc(N, sizeof(*cargo));
+    static CargoLabel labels[N];
+    int *pairs = malloc(2 * MAX_PAIRS * sizeof(*pairs));
+    int all_match = 1;
+
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < N; i++) {
+            Cargo *c = &cargo[i];
+            snprintf(labels[i].id, sizeof(labels[i].id), "DG%d", i);
+            c->label = &labels[i];
+            c->dimensions[0] = (rand_unit() < 0.5f) ? 6.1f : 12.2f;
+            c->dimensions[1] = 2.44f;
+            c->dimensions[2] = 2.59f;
+            float x = rand_unit() * 180.0f;
+            float y = rand_unit() * 30.0f;
+            /* Some unplaced items and some non-DG items */
+            if (rand_unit() < 0.1f) CARGO_UNPLACE(c);
+            else CARGO_PLACE(c, x, y, 0.0f);
+            c->dg = (rand_unit() < 0.15f) ? NULL
+                  : (DGInfo *)&classes[(int)(rand_unit() * nclasses) % nclasses];
+        }
+        Ship ship;
+        memset(&ship, 0, sizeof(ship));
+        ship.length = 200.0f;
+        ship.width = 32.0f;
+        ship.cargo = cargo;
+        ship.cargo_count = N;
+
+        int expected = naive_violations(&ship, pairs, MAX_PAIRS);
+        IMDGCheckResult result = imdg_check_all(&ship);
+        if (result.violation_count != expected || expected > MAX_PAIRS ||
+            result.compliant != (expected == 0))
+            all_match = 0;
+        for (int k = 0; all_match && k < expected; k++) {
+            if (result.violations[k].cargo_idx_a != pairs[2 * k] ||
+                result.violations[k].cargo_idx_b != pairs[2 * k + 1])
+                all_match = 0;
+        }
+        imdg_result_free(&result);
+    }
+    ASSERT(all_match, "sweep finds exactly the all-pairs violations, in order");
+
+    free(pairs);
+    free(cargo);
+}
+
+static void test_violation_list_grows(void) {
+    printf("  test_violation_list_grows...\n");
+
+    /* 30 explosives in a row: every pair is incompatible, 435 violations */
+    enum { N = 30 };
+    Cargo cargo[N];
+    memset(cargo, 0, sizeof(cargo));
+    CargoLabel labels[N];
+    memset(labels, 0, sizeof(labels));
+    DGInfo dg = { .dg_class = 1, .dg_division = 1 };
+    for (int i = 0; i < N; i++) {
+        snprintf(labels[i].id, sizeof(labels[i].id), "EXP%d", i);
+        cargo[i].label = &labels[i];
+        cargo[i].dimensions[0] = 6.0f;
+        cargo[i].dimensions[1] = 2.5f;
+        CARGO_PLACE(&cargo[i], 7.0f * i, 0.0f, 0.0f);
+        cargo[i].dg = &dg;
+    }
+    Ship ship;
+    memset(&ship, 0, sizeof(ship));
+    ship.cargo = cargo;
+    ship.cargo_count = N;
+
+    IMDGCheckResult result = imdg_check_all(&ship);
+    ASSERT(result.violation_count == N * (N - 1) / 2, "no cap on recorded violations");
+    ASSERT(result.violation_capacity >= result.violation_count, "capacity covers the list");
+    ASSERT(result.violations[0].cargo_idx_a == 0 && result.violations[0].cargo_idx_b == 1,
+           "first violation is the lowest pair");
+    ASSERT(result.violations[N * (N - 1) / 2 - 1].cargo_idx_a == N - 2,
+           "last violation is the highest pair");
+    ASSERT(result.violations[5].required == SEG_INCOMPATIBLE, "explosives are incompatible");
+    imdg_result_free(&result);
+    ASSERT(result.violations == NULL && result.violation_count == 0, "free resets the result");
+    imdg_result_free(&result);
 }
 
 int main(void) {
@@ -206,6 +372,9 @@ int main(void) {
     test_segregation_names();
     test_imdg_check_all_compliant();
     test_imdg_check_all_violation();
+    test_rule_table();
+    test_sweep_matches_all_pairs();
+    test_violation_list_grows();
 
     printf("IMDG: %d/%d tests passed\n\n", tests_passed, tests_run);
     return (tests_passed == tests_run) ? 0 : 1;
@@ -0,0 +1,270 @@
+/*
+ * test_json_output.c - Unit tests for the JSON writer
+ */
+
+#include "json_output.h"
+#include "json_parse.h"
+#include "holds.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+static int fixed_matches(double v, int decimals) {
+    char want[400];
+    snprintf(want, sizeof(want), "%.*f", decimals, v);
+    JsonWriter w;
+    json_writer_init(&w, 0);
+    json_put_fixed(&w, v, decimals);
+    int ok = w.len == strlen(want) && memcmp(w.data, want, w.len) == 0;
+    if (!ok) fprintf(stderr, "%.17g/%d: got %s want %s\n", v, decimals, w.data, want);
+    json_writer_free(&w);
+    return ok;
+}
+
+static unsigned long long rng = 88172645463325252ULL;
+
+static unsigned long long next_rand(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+/* Test 1: Fixed-precision numbers are exactly what printf gives */
+void test_fixed(void) {
+    printf("Test 1: Fixed-precision formatting... ");
+
+    const double edge[] = {
+        0.0, -0.0, 0.5, 1.5, 2.5, -2.5, 0.125, 0.375, 1.005, 2.675, -0.001,
+        0.045, 9.995, 99.995, 1e-7, 123456789.0, 4503599627370495.0,
+        4503599627370496.0, 1e300, -1e300, INFINITY, -INFINITY, NAN,
+    };
+    for (size_t i = 0; i < sizeof(edge) / sizeof(edge[0]); i++)
+        for (int d = 0; d <= 9; d++)
+            assert(fixed_matches(edge[i], d));
+
+    /* Floats as the result fields hold them, and arbitrary doubles */
+    for (int i = 0; i < 200000; i++) {
+        unsigned long long r = next_rand();
+        int d = (int)(r % 6);
+        float f = (float)((double)(r >> 11) / 9007199254740992.0 * pow(10.0, (double)(r % 9)) - 1000.0);
+        assert(fixed_matches(f, d));
+        /* Values right on a tie at d decimals */
+        assert(fixed_matches((double)(long long)(r % 100000) / 8.0, d));
+        double x;
+        unsigned long long bits = next_rand();
+        memcpy(&x, &bits, sizeof(x));
+        if (isfinite(x) && fabs(x) < 1e12) assert(fixed_matches(x, d));
+    }
+
+    printf("PASS\n");
+}
+
+/* Test 2: Strings, integers and buffer growth */
+void test_scalars(void) {
+    printf("Test 2: Strings and integers... ");
+
+    JsonWriter w;
+    json_writer_init(&w, 0);
+    json_put_string(&w, "a\"b\\c\n\t\x01z");
+    assert(strcmp(w.data, "\"a\\\"b\\\\c\\n\\t\\u0001z\"") == 0);
+    json_writer_free(&w);
+
+    char text[] = "x";
+    json_put_int(&w, 0);
+    json_put_cstr(&w, " ");
+    json_put_int(&w, -9223372036854775807LL - 1);
+    json_put_cstr(&w, " ");
+    json_put_int(&w, 42);
+    assert(strcmp(w.data, "0 -9223372036854775808 42") == 0);
+
+    for (int i = 0; i < 100000; i++) json_put_raw(&w, text, 1);
+    assert(w.len == 25 + 100000 && !w.oom && w.data[w.len] == '\0');
+
+    char *taken = json_writer_take(&w);
+    assert(taken && strlen(taken) == 25 + 100000);
+    assert(w.data == NULL && w.len == 0);
+    free(taken);
+
+    printf("PASS\n");
+}
+
+static Ship make_ship(Cargo *cargo, int count) {
+    Ship ship;
+    memset(&ship, 0, sizeof(ship));
+    ship.length = 150.0f;
+    ship.width = 25.0f;
+    ship.max_weight = 40000000.0f;
+    ship.lightship_weight = 9000000.0f;
+    ship.lightship_kg = 7.25f;
+    ship.cargo = cargo;
+    ship.cargo_count = count;
+    ship.cargo_capacity = count;
+    return ship;
+}
+
+/** Drop whitespace outside strings */
+static size_t squeeze(const char *s, size_t len, char *out) {
+    size_t n = 0;
+    int in_str = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = s[i];
+        if (in_str) {
+            out[n++] = c;
+            if (c == '\\') out[n++] = s[++i];
+            else if (c == '"') in_str = 0;
+        } else if (c == '"') {
+            out[n++] = c;
+            in_str = 1;
+        } else if (c != ' ' && c != '\n') {
+            out[n++] = c;
+        }
+    }
+    return n;
+}
+
+/* Test 3: Compact and pretty results hold the same document */
+void test_layouts(void) {
+    printf("Test 3: Compact and pretty layouts... ");
+
+    Cargo cargo[2];
+    memset(cargo, 0, sizeof(cargo));
+    static const CargoLabel box = { "BOX \"A\"", "standard" };
+    static const CargoLabel loose = { "LOOSE", "standard" };
+    cargo[0].label = &box;
+    cargo[0].weight = 25000.0f;
+    cargo[0].dimensions[0] = 12.0f;
+    cargo[0].dimensions[1] = 2.4f;
+    cargo[0].dimensions[2] = 2.6f;
+    CARGO_PLACE(&cargo[0], 10.0f, -0.0f, 1.125f);
+    cargo[1] = cargo[0];
+    cargo[1].label = &loose;
+    CARGO_UNPLACE(&cargo[1]);
+
+    Ship ship = make_ship(cargo, 2);
+    AnalysisResult result;
+    memset(&result, 0, sizeof(result));
+    result.placed_item_count = 1;
+    result.total_cargo_weight_kg = 25000.0f;
+    result.gm = 1.234f;
+    result.strength_compliant = -1;
+
+    for (int overweight = 0; overweight <= 1; overweight++) {
+        if (overweight) result.gm = NAN;
+
+        JsonWriter pretty, compact;
+        json_writer_init(&pretty, 1);
+        json_writer_init(&compact, 0);
+        json_write_results(&pretty, &ship, &result);
+        json_write_results(&compact, &ship, &result);
+        assert(!pretty.oom && !compact.oom);
+
+        assert(pretty.data[pretty.len - 1] == '\n');
+        assert(strstr(pretty.data, "\"dimensions\": [12.00, 2.40, 2.60]"));
+        assert(strstr(pretty.data, "\"position\": {\"x\": 10.00, \"y\": -0.00, \"z\": 1.12}"));
+        assert(strstr(compact.data, "\"position\":null"));
+
+        /* Compact is pretty without the whitespace, and valid JSON */
+        char *squeezed = malloc(pretty.len);
+        size_t n = squeeze(pretty.data, pretty.len, squeezed);
+        assert(n == compact.len && memcmp(squeezed, compact.data, n) == 0);
+        free(squeezed);
+
+        JsonReader r;
+        json_reader_init(&r, compact.data, compact.len);
+        assert(json_read_value(&r, NULL) == 0 && json_reader_finish(&r) == 0);
+
+        json_writer_free(&pretty);
+        json_writer_free(&compact);
+    }
+
+    /* An empty manifest keeps the original layout */
+    Ship empty = make_ship(NULL, 0);
+    JsonWriter w;
+    json_writer_init(&w, 1);
+    json_write_results(&w, &empty, &result);
+    assert(strstr(w.data, "  \"cargo\": [\n  ],\n"));
+    json_writer_free(&w);
+
+    printf("PASS\n");
+}
+
+/* Test 4: The load map spreads each item over the floor cells it covers */
+void test_load_map(void) {
+    printf("Test 4: Compartment load map... ");
+
+    static const CargoLabel box = { "BOX", "standard" };
+    Cargo cargo[4];
+    memset(cargo, 0, sizeof(cargo));
+    const float dims[4][3] = { {4, 2, 2}, {2, 2, 2}, {1, 2, 2}, {2, 2, 2} };
+    const float pos[4][3]  = { {0, 0, 0}, {0, 0, 2}, {6, 2, 0}, {2, 2, 0} };
+    const float kg[4]      = { 8000, 4000, 2000, 9000 };
+    for (int i = 0; i < 4; i++) {
+        cargo[i].label = &box;
+        cargo[i].weight = kg[i];
+        memcpy(cargo[i].dimensions, dims[i], sizeof(dims[i]));
+        CARGO_PLACE(&cargo[i], pos[i][0], pos[i][1], pos[i][2]);
+    }
+    CARGO_UNPLACE(&cargo[3]);   /* unplaced cargo carries no load */
+
+    /* 7 m x 4 m floor: four columns, the last one 1 m wide */
+    HoldConfig holds = {0};
+    HoldDef hold = { "H1", 0.0f, 0.0f, 0.0f, 7.0f, 4.0f, 10.0f, 1e6f, 0 };
+    assert(hold_config_add(&holds, &hold) == 0);
+
+    Ship ship = make_ship(cargo, 4);
+    ship.holds = &holds;
+    AnalysisResult result;
+    memset(&result, 0, sizeof(result));
+    result.placed_item_count = 3;
+
+    JsonWriter pretty, compact;
+    json_writer_init(&pretty, 1);
+    json_writer_init(&compact, 0);
+    pretty.load_map = compact.load_map = 1;
+    json_write_results(&pretty, &ship, &result);
+    json_write_results(&compact, &ship, &result);
+    assert(!pretty.oom && !compact.oom);
+
+    assert(strstr(compact.data, "\"load_map\":[{\"name\":\"H1\",\"deck\":false,"
+                                "\"cell_m\":2.00,\"cols\":4,\"rows\":2,\"max_t_m2\":2.000,"
+                                "\"t_m2\":[[2.000,1.000,0.000,0.000],"
+                                "[0.000,0.000,0.000,1.000]]}]}"));
+
+    char *squeezed = malloc(pretty.len);
+    size_t n = squeeze(pretty.data, pretty.len, squeezed);
+    assert(n == compact.len && memcmp(squeezed, compact.data, n) == 0);
+    free(squeezed);
+
+    JsonReader r;
+    json_reader_init(&r, pretty.data, pretty.len);
+    assert(json_read_value(&r, NULL) == 0 && json_reader_finish(&r) == 0);
+    json_writer_free(&pretty);
+    json_writer_free(&compact);
+
+    /* Without holds the map covers the legacy layout */
+    ship.holds = NULL;
+    json_writer_init(&compact, 0);
+    compact.load_map = 1;
+    json_write_results(&compact, &ship, &result);
+    assert(strstr(compact.data, "{\"name\":\"ForwardHold\""));
+    assert(strstr(compact.data, "{\"name\":\"Deck\",\"deck\":true,"));
+    json_writer_free(&compact);
+
+    hold_config_free(&holds);
+    printf("PASS\n");
+}
+
+int main(void) {
+    printf("Running JSON writer tests...\n\n");
+
+    test_fixed();
+    test_scalars();
+    test_layouts();
+    test_load_map();
+
+    printf("\nAll JSON writer tests passed!\n");
+    return 0;
+}
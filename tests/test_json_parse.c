@@ -0,0 +1,175 @@
+/*
+ * test_json_parse.c - Unit tests for the single-pass JSON reader
+ */
+
+#include "json_parse.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+static int parses(const char *text) {
+    JsonReader r;
+    json_reader_init(&r, text, strlen(text));
+    return json_read_value(&r, NULL) == 0 && json_reader_finish(&r) == 0;
+}
+
+/* Test 1: Scalars come back as spans into the input */
+void test_scalars(void) {
+    printf("Test 1: Scalar values... ");
+
+    const char *text = " [\"ab\\\"c\", -12.5e3, 42, true, false, null] ";
+    JsonReader r;
+    JsonSpan v;
+    json_reader_init(&r, text, strlen(text));
+    assert(json_peek(&r) == JSON_ARRAY);
+    assert(json_array_begin(&r) == 0);
+
+    assert(json_array_next(&r) == 1);
+    assert(json_read_value(&r, &v) == 0);
+    assert(v.type == JSON_STRING && v.len == 5 && v.escaped);
+    assert(strncmp(v.start, "ab\\\"c", 5) == 0);
+
+    assert(json_array_next(&r) == 1);
+    assert(json_read_value(&r, &v) == 0);
+    long long n;
+    assert(v.type == JSON_NUMBER && v.len == 7);
+    assert(json_span_int(&v, &n) == -1);         // not an integer
+
+    assert(json_array_next(&r) == 1);
+    assert(json_read_value(&r, &v) == 0);
+    assert(json_span_int(&v, &n) == 0 && n == 42);
+
+    JsonType want[] = { JSON_TRUE, JSON_FALSE, JSON_NULL };
+    for (int i = 0; i < 3; i++) {
+        assert(json_array_next(&r) == 1);
+        assert(json_read_value(&r, &v) == 0 && v.type == want[i]);
+    }
+    assert(json_array_next(&r) == 0);
+    assert(json_reader_finish(&r) == 0 && r.depth == 0);
+
+    printf("PASS\n");
+}
+
+/* Test 2: Walking an object, skipping what is not wanted */
+void test_object_walk(void) {
+    printf("Test 2: Object members and skipping... ");
+
+    /* A nested value mentioning "id" must not be mistaken for the member */
+    const char *text = "{\"params\":{\"id\":\"method\",\"x\":[1,{\"id\":2}]},"
+                       "\"method\":\"optimize\",\"id\":7}";
+    JsonReader r;
+    JsonSpan key, v, params = {0}, method = {0}, id = {0};
+    json_reader_init(&r, text, strlen(text));
+    assert(json_object_begin(&r) == 0);
+    int rc, members = 0;
+    while ((rc = json_object_next(&r, &key)) > 0) {
+        members++;
+        assert(json_read_value(&r, &v) == 0);
+        if (json_span_is(&key, "params")) params = v;
+        else if (json_span_is(&key, "method")) method = v;
+        else if (json_span_is(&key, "id")) id = v;
+    }
+    assert(rc == 0 && members == 3);
+    assert(params.type == JSON_OBJECT && params.start[0] == '{' &&
+           params.start[params.len - 1] == '}');
+    assert(json_span_is(&method, "optimize"));
+    long long n;
+    assert(json_span_int(&id, &n) == 0 && n == 7);
+
+    /* Descend into the captured params span */
+    json_reader_init(&r, params.start, params.len);
+    assert(json_object_begin(&r) == 0);
+    assert(json_object_next(&r, &key) == 1 && json_span_is(&key, "id"));
+    assert(json_read_value(&r, &v) == 0 && json_span_is(&v, "method"));
+    assert(json_object_next(&r, &key) == 1 && json_span_is(&key, "x"));
+    assert(json_read_value(&r, &v) == 0 && v.type == JSON_ARRAY);
+    assert(json_object_next(&r, &key) == 0);
+
+    assert(parses("{}") && parses("[]") && parses("{\"a\":{},\"b\":[]}"));
+
+    printf("PASS\n");
+}
+
+/* Test 3: Malformed documents are rejected */
+void test_malformed(void) {
+    printf("Test 3: Malformed input rejected... ");
+
+    const char *bad[] = {
+        "", "{", "[1,]", "{\"a\":1,}", "{\"a\" 1}", "{a:1}", "[1 2]",
+        "{\"a\":{} \"b\":1}", "\"abc", "\"a\\qb\"", "\"\\u12G4\"", "\"tab\there\"",
+        "01", "-", "1.", "1e", "tru", "nul", "[1]]", "{\"a\":1} x",
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        JsonReader r;
+        json_reader_init(&r, bad[i], strlen(bad[i]));
+        int ok = json_read_value(&r, NULL) == 0 && json_reader_finish(&r) == 0;
+        if (ok) fprintf(stderr, "accepted: %s\n", bad[i]);
+        assert(!ok && r.error != NULL);
+    }
+
+    /* Nesting is bounded */
+    char deep[JSON_MAX_DEPTH * 2 + 8];
+    size_t n = JSON_MAX_DEPTH + 1;
+    memset(deep, '[', n);
+    memset(deep + n, ']', n);
+    deep[2 * n] = '\0';
+    assert(!parses(deep));
+    deep[0] = ' ';
+    deep[2 * n - 1] = ' ';
+    assert(parses(deep));
+
+    /* Length-delimited: bytes past len are never looked at */
+    JsonReader r;
+    json_reader_init(&r, "[1,2]xyz", 5);
+    assert(json_read_value(&r, NULL) == 0 && json_reader_finish(&r) == 0);
+
+    printf("PASS\n");
+}
+
+/* Test 4: String decoding, in place */
+void test_decode(void) {
+    printf("Test 4: String decoding... ");
+
+    char text[] = "\"line1\\nline2\\t\\\"q\\\" \\/ \\u00e9 \\u20ac \\ud83d\\ude80 \\\\\"";
+    JsonReader r;
+    JsonSpan v;
+    json_reader_init(&r, text, strlen(text));
+    assert(json_read_value(&r, &v) == 0);
+    size_t len = json_string_decode(&v, (char *)v.start);
+    const char *want = "line1\nline2\t\"q\" / \xc3\xa9 \xe2\x82\xac \xf0\x9f\x9a\x80 \\";
+    assert(len == strlen(want));
+    assert(memcmp(v.start, want, len) == 0 && v.start[len] == '\0');
+
+    /* Lone or mismatched surrogates */
+    const char *bad[] = { "\"\\ud83d\"", "\"\\ude80\"", "\"\\ud83d\\u0041\"" };
+    for (int i = 0; i < 3; i++) {
+        char buf[32];
+        json_reader_init(&r, bad[i], strlen(bad[i]));
+        assert(json_read_value(&r, &v) == 0);
+        assert(json_string_decode(&v, buf) == (size_t)-1);
+    }
+
+    /* Escaped keys still compare by value; integer limits */
+    json_reader_init(&r, "\"m\\u0065thod\"", 13);
+    assert(json_read_value(&r, &v) == 0 && json_span_is(&v, "method"));
+    long long n;
+    json_reader_init(&r, "-9223372036854775808", 20);
+    assert(json_read_value(&r, &v) == 0 && json_span_int(&v, &n) == 0 && n == (-9223372036854775807LL - 1));
+    json_reader_init(&r, "9223372036854775808", 19);
+    assert(json_read_value(&r, &v) == 0 && json_span_int(&v, &n) == -1);
+
+    printf("PASS\n");
+}
+
+int main(void) {
+    printf("Running JSON reader tests...\n\n");
+
+    test_scalars();
+    test_object_walk();
+    test_malformed();
+    test_decode();
+
+    printf("\nAll JSON reader tests passed!\n");
+    return 0;
+}
@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
 
 static int tests_run = 0;
 static int tests_passed = 0;
@@ -103,6 +104,8 @@ static void test_optimize_from_strings(void) {
     ASSERT_GT_FLOAT(r->draft, 0.0f, "draft > 0");
     ASSERT_GT_FLOAT(r->gm, 0.0f, "GM > 0");
     ASSERT_GT_FLOAT(r->gm_corrected, 0.0f, "GM corrected > 0");
+    ASSERT(r->gz_curve[0] == 0.0f && r->gz_curve[30] == r->gz_at_30 &&
+           r->gz_curve[(int)r->gz_max_angle] == r->gz_max, "GZ curve matches the criteria");
 
     /* Check JSON output */
     const char *json = cargoforge_result_json(cf);
@@ -113,10 +116,51 @@ static void test_optimize_from_strings(void) {
     /* Second call returns cached */
     const char *json2 = cargoforge_result_json(cf);
     ASSERT(json == json2, "JSON is cached");
+    ASSERT(strchr(json, '\n') != NULL, "JSON indented by default");
+
+    /* Compact output: same document, no whitespace outside strings */
+    size_t pretty_len = strlen(json);
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_JSON_COMPACT, 2), CF_ERROR, "bad compact value");
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_JSON_COMPACT, 1), CF_OK, "set compact");
+    ASSERT_EQ_INT(cargoforge_get_option(cf, CF_OPT_JSON_COMPACT), 1, "compact option reads back");
+    json = cargoforge_result_json(cf);
+    ASSERT(json != NULL && strchr(json, '\n') == NULL && strchr(json, ' ') == NULL,
+           "compact JSON has no whitespace");
+    ASSERT(json && strlen(json) < pretty_len, "compact JSON is shorter");
+    ASSERT(json && strstr(json, "\"placed_count\":") != NULL, "compact JSON has placed_count");
 
     cargoforge_close(cf);
 }
 
+static void test_load_from_buffers(void) {
+    printf("  test_load_from_buffers\n");
+    CargoForge *cf;
+    cargoforge_open(&cf);
+
+    /* Text embedded in a larger, unterminated buffer: only len bytes count */
+    size_t ship_len = strlen(SHIP_CONFIG), cargo_len = strlen(CARGO_MANIFEST);
+    const char *junk = "JUNK 1.5.5 1x1x1 standard";   /* invalid weight */
+    size_t junk_len = strlen(junk);
+    char *buf = malloc(ship_len + cargo_len + junk_len);
+    memcpy(buf, SHIP_CONFIG, ship_len);
+    memcpy(buf + ship_len, CARGO_MANIFEST, cargo_len);
+    memcpy(buf + ship_len + cargo_len, junk, junk_len);
+
+    int rc = cargoforge_load_ship_buffer(cf, buf, ship_len);
+    ASSERT_EQ_INT(rc, CF_OK, "load ship buffer");
+    rc = cargoforge_load_cargo_buffer(cf, buf + ship_len, cargo_len);
+    ASSERT_EQ_INT(rc, CF_OK, "load cargo buffer");
+    ASSERT_EQ_INT(cargoforge_cargo_count(cf), 5, "trailing bytes ignored");
+
+    /* The same bytes are parsed once len covers them */
+    rc = cargoforge_load_cargo_buffer(cf, buf + ship_len, cargo_len + junk_len);
+    ASSERT_EQ_INT(rc, CF_ERR_PARSE, "unterminated last line parsed");
+    ASSERT_EQ_INT(cargoforge_load_cargo_buffer(cf, NULL, 4), CF_ERROR, "NULL text");
+
+    free(buf);
+    cargoforge_close(cf);
+}
+
 static void test_cargo_info(void) {
     printf("  test_cargo_info\n");
     CargoForge *cf;
@@ -208,6 +252,1095 @@ static void test_imdg_before_optimize(void) {
     cargoforge_close(cf);
 }
 
+/* Mixed manifest large enough that bins hold several search chunks */
+static char *make_large_manifest(int n) {
+    static const char *types[] = { "standard", "standard", "reefer", "fragile", "hazardous" };
+    char *buf = malloc((size_t)n * 64 + 1);
+    if (!buf) return NULL;
+
+    size_t len = 0;
+    unsigned seed = 12345u;
+    for (int i = 0; i < n; i++) {
+        seed = seed * 1103515245u + 12345u;
+        float l = 1.0f + (float)((seed >> 8) % 110) / 10.0f;
+        seed = seed * 1103515245u + 12345u;
+        float w = 1.0f + (float)((seed >> 8) % 20) / 10.0f;
+        seed = seed * 1103515245u + 12345u;
+        float h = 0.5f + (float)((seed >> 8) % 25) / 10.0f;
+        len += (size_t)sprintf(buf + len, "ITEM%04d %d %.1fx%.1fx%.1f %s\n",
+                               i, 500 + (int)(seed % 9000), l, w, h, types[seed % 5]);
+    }
+    return buf;
+}
+
+static void test_threaded_matches_serial(void) {
+    printf("  test_threaded_matches_serial\n");
+    char *manifest = make_large_manifest(600);
+    CargoForge *serial, *threaded;
+    cargoforge_open(&serial);
+    cargoforge_open(&threaded);
+
+    ASSERT_EQ_INT(cargoforge_get_option(serial, CF_OPT_THREADS), 1, "serial by default");
+    ASSERT_EQ_INT(cargoforge_set_option(threaded, CF_OPT_THREADS, 4), CF_OK, "set threads");
+    ASSERT_EQ_INT(cargoforge_get_option(threaded, CF_OPT_THREADS), 4, "threads option read back");
+    ASSERT_EQ_INT(cargoforge_set_option(threaded, CF_OPT_THREADS, -1), CF_ERROR, "negative threads rejected");
+    ASSERT_EQ_INT(cargoforge_set_option(threaded, 9999, 1), CF_ERROR, "unknown option rejected");
+
+    CargoForge *handles[2] = { serial, threaded };
+    for (int h = 0; h < 2; h++) {
+        cargoforge_load_ship_string(handles[h], SHIP_CONFIG);
+        cargoforge_load_cargo_string(handles[h], manifest);
+        ASSERT_EQ_INT(cargoforge_optimize(handles[h]), CF_OK, "optimize large manifest");
+    }
+
+    const CfResult *rs = cargoforge_result(serial);
+    const CfResult *rt = cargoforge_result(threaded);
+    ASSERT(rs && rt && rs->placed_count == rt->placed_count, "same placed count");
+
+    int same = cargoforge_cargo_count(serial) == cargoforge_cargo_count(threaded);
+    for (int i = 0; same && i < cargoforge_cargo_count(serial); i++) {
+        CfCargoInfo a, b;
+        cargoforge_cargo_info(serial, i, &a);
+        cargoforge_cargo_info(threaded, i, &b);
+        same = strcmp(a.id, b.id) == 0 && a.pos_x == b.pos_x &&
+               a.pos_y == b.pos_y && a.pos_z == b.pos_z;
+    }
+    ASSERT(same, "threaded placement identical to serial");
+    ASSERT(rs && rt && rs->gm_corrected == rt->gm_corrected, "same GM");
+
+    cargoforge_close(serial);
+    cargoforge_close(threaded);
+    free(manifest);
+}
+
+static void test_multistart_option(void) {
+    printf("  test_multistart_option\n");
+    char *manifest = make_large_manifest(300);
+    CargoForge *ffd, *ms;
+    cargoforge_open(&ffd);
+    cargoforge_open(&ms);
+
+    ASSERT_EQ_INT(cargoforge_get_option(ms, CF_OPT_STRATEGY), CF_STRATEGY_FFD, "FFD by default");
+    ASSERT_EQ_INT(cargoforge_set_option(ms, CF_OPT_STRATEGY, CF_STRATEGY_MULTISTART), CF_OK,
+                  "select multistart");
+    ASSERT_EQ_INT(cargoforge_set_option(ms, CF_OPT_STRATEGY, 7), CF_ERROR, "unknown strategy rejected");
+    ASSERT_EQ_INT(cargoforge_set_option(ms, CF_OPT_BEAM_WIDTH, 0), CF_ERROR, "zero beam rejected");
+    ASSERT_EQ_INT(cargoforge_set_option(ms, CF_OPT_BEAM_WIDTH, 2), CF_OK, "set beam width");
+    ASSERT_EQ_INT(cargoforge_set_option(ms, CF_OPT_THREADS, 2), CF_OK, "set threads");
+
+    CargoForge *handles[2] = { ffd, ms };
+    for (int h = 0; h < 2; h++) {
+        cargoforge_load_ship_string(handles[h], SHIP_CONFIG);
+        cargoforge_load_cargo_string(handles[h], manifest);
+        ASSERT_EQ_INT(cargoforge_optimize(handles[h]), CF_OK, "optimize");
+    }
+
+    const CfResult *rf = cargoforge_result(ffd);
+    const CfResult *rm = cargoforge_result(ms);
+    ASSERT(rf && rm && rm->placed_count >= rf->placed_count, "multistart places at least as many");
+    ASSERT(rm && rm->total_count == 300, "multistart keeps every item");
+
+    cargoforge_close(ffd);
+    cargoforge_close(ms);
+    free(manifest);
+}
+
+static void test_placer_option(void) {
+    printf("  test_placer_option\n");
+    char *manifest = make_large_manifest(300);
+    CargoForge *cf;
+    cargoforge_open(&cf);
+    ASSERT_EQ_INT(cargoforge_get_option(cf, CF_OPT_PLACER), CF_PLACER_GUILLOTINE, "guillotine by default");
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_PLACER, 2), CF_ERROR, "unknown placer rejected");
+    cargoforge_load_ship_string(cf, SHIP_CONFIG);
+    cargoforge_load_cargo_string(cf, manifest);
+    ASSERT_EQ_INT(cargoforge_optimize(cf), CF_OK, "optimize with guillotine");
+    int guillotine = cargoforge_result(cf)->placed_count;
+
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_PLACER, CF_PLACER_EXTREME_POINTS), CF_OK,
+                  "select extreme points");
+    ASSERT_EQ_INT(cargoforge_get_option(cf, CF_OPT_PLACER), CF_PLACER_EXTREME_POINTS, "placer read back");
+    ASSERT_EQ_INT(cargoforge_optimize(cf), CF_OK, "optimize with extreme points");
+    const CfResult *r = cargoforge_result(cf);
+    ASSERT(r && r->total_count == 300 && r->placed_count * 10 >= guillotine * 9,
+           "extreme points place about as many");
+
+    int listed = 0;
+    for (int i = 0; i < 300; i++) {
+        CfCargoInfo info;
+        cargoforge_cargo_info(cf, i, &info);
+        listed += info.placed;
+    }
+    ASSERT(r && listed == r->placed_count, "cargo info agrees with the result");
+
+    cargoforge_close(cf);
+    free(manifest);
+}
+
+/* Full re-analysis of the edited plan matches the incrementally updated one */
+static int result_matches_full_analysis(CargoForge *cf) {
+    const CfResult *r = cargoforge_result(cf);
+    if (!r) return 0;
+    CfResult inc = *r;
+    if (cargoforge_analyze(cf) != CF_OK) return 0;
+    r = cargoforge_result(cf);
+    return r->placed_count == inc.placed_count &&
+           fabsf(r->cargo_weight - inc.cargo_weight) < 1.0f &&
+           fabsf(r->kg - inc.kg) < 1e-4f &&
+           fabsf(r->gm_corrected - inc.gm_corrected) < 1e-4f &&
+           fabsf(r->trim - inc.trim) < 1e-4f &&
+           fabsf(r->heel - inc.heel) < 1e-4f;
+}
+
+static void test_incremental_add_remove(void) {
+    printf("  test_incremental_add_remove\n");
+    char *manifest = make_large_manifest(300);
+    const int strategies[2] = { CF_STRATEGY_FFD, CF_STRATEGY_MULTISTART };
+
+    /* Both strategies on both placement engines */
+    for (int s = 0; s < 4; s++) {
+        CargoForge *cf;
+        cargoforge_open(&cf);
+        cargoforge_set_option(cf, CF_OPT_STRATEGY, strategies[s % 2]);
+        cargoforge_set_option(cf, CF_OPT_PLACER, s < 2 ? CF_PLACER_GUILLOTINE : CF_PLACER_EXTREME_POINTS);
+        cargoforge_load_ship_string(cf, SHIP_CONFIG);
+        cargoforge_load_cargo_string(cf, manifest);
+        ASSERT_EQ_INT(cargoforge_optimize(cf), CF_OK, "optimize before edits");
+        int placed0 = cargoforge_result(cf)->placed_count;
+
+        float before[300][3];
+        for (int i = 0; i < 300; i++) {
+            CfCargoInfo info;
+            cargoforge_cargo_info(cf, i, &info);
+            before[i][0] = info.pos_x;
+            before[i][1] = info.pos_y;
+            before[i][2] = info.pos_z;
+        }
+
+        /* Late addition goes into free space; nothing else moves */
+        ASSERT_EQ_INT(cargoforge_add_cargo(cf, "LATE1", 2000.0f, 2.0f, 2.0f, 2.0f, NULL), CF_OK,
+                      "add late cargo");
+        ASSERT_EQ_INT(cargoforge_cargo_count(cf), 301, "manifest grew");
+        CfCargoInfo late;
+        cargoforge_cargo_info(cf, 300, &late);
+        ASSERT(strcmp(late.id, "LATE1") == 0 && strcmp(late.type, "standard") == 0, "late cargo appended");
+        ASSERT(late.placed, "late cargo placed");
+        ASSERT_EQ_INT(cargoforge_result(cf)->placed_count, placed0 + 1, "result counts late cargo");
+
+        int unmoved = 1;
+        for (int i = 0; unmoved && i < 300; i++) {
+            CfCargoInfo info;
+            cargoforge_cargo_info(cf, i, &info);
+            unmoved = info.pos_x == before[i][0] && info.pos_y == before[i][1] &&
+                      info.pos_z == before[i][2];
+        }
+        ASSERT(unmoved, "existing plan untouched by add");
+        ASSERT(result_matches_full_analysis(cf), "incremental result after add");
+
+        ASSERT_EQ_INT(cargoforge_add_cargo(cf, "LATE1", 1000.0f, 1.0f, 1.0f, 1.0f, NULL), CF_ERROR,
+                      "duplicate id rejected");
+        ASSERT_EQ_INT(cargoforge_add_cargo(cf, "BAD", -1.0f, 1.0f, 1.0f, 1.0f, NULL), CF_ERROR,
+                      "negative weight rejected");
+
+        /* Cancelling a bottom-tier item re-places only what sat on it */
+        CfCargoInfo first;
+        cargoforge_cargo_info(cf, 0, &first);
+        char first_id[32];
+        snprintf(first_id, sizeof(first_id), "%s", first.id);
+        ASSERT_EQ_INT(cargoforge_remove_cargo(cf, first_id), CF_OK, "remove cargo");
+        ASSERT_EQ_INT(cargoforge_cargo_count(cf), 300, "manifest shrank");
+        int gone = 1;
+        for (int i = 0; i < cargoforge_cargo_count(cf); i++) {
+            CfCargoInfo info;
+            cargoforge_cargo_info(cf, i, &info);
+            if (strcmp(info.id, first_id) == 0) gone = 0;
+        }
+        ASSERT(gone, "removed id no longer listed");
+        ASSERT(result_matches_full_analysis(cf), "incremental result after remove");
+        ASSERT_EQ_INT(cargoforge_remove_cargo(cf, "NOPE"), CF_ERROR, "unknown id rejected");
+
+        cargoforge_close(cf);
+    }
+
+    /* Without a plan, edits only change the manifest */
+    CargoForge *cf;
+    cargoforge_open(&cf);
+    ASSERT_EQ_INT(cargoforge_add_cargo(cf, "X", 1.0f, 1.0f, 1.0f, 1.0f, NULL), CF_ERR_NO_SHIP,
+                  "add before ship fails");
+    cargoforge_load_ship_string(cf, SHIP_CONFIG);
+    ASSERT_EQ_INT(cargoforge_add_cargo(cf, "A", 5000.0f, 6.0f, 2.4f, 2.6f, "standard"), CF_OK,
+                  "add to empty manifest");
+    ASSERT(cargoforge_result(cf) == NULL, "no result before optimize");
+    ASSERT_EQ_INT(cargoforge_optimize(cf), CF_OK, "optimize added cargo");
+    ASSERT_EQ_INT(cargoforge_result(cf)->placed_count, 1, "added cargo placed by optimize");
+    ASSERT_EQ_INT(cargoforge_remove_cargo(cf, "A"), CF_OK, "remove only item");
+    ASSERT_EQ_INT(cargoforge_result(cf)->placed_count, 0, "plan empty after remove");
+    cargoforge_close(cf);
+
+    free(manifest);
+}
+
+static void test_result_cache(void) {
+    printf("  test_result_cache\n");
+    CfCache *cache;
+    ASSERT_EQ_INT(cargoforge_cache_open(&cache, 0), CF_ERROR, "zero-size cache rejected");
+    ASSERT_EQ_INT(cargoforge_cache_open(&cache, 4096), CF_OK, "open cache");
+
+    /* Line endings, blank lines and comments do not change the key */
+    const char *ship = SHIP_CONFIG;
+    const char *ship_crlf = "# fleet ship\r\nlength_m=180\r\nwidth_m=32\r\n\r\n"
+                            "max_weight_tonnes=50000\r\nlightship_weight_tonnes=12000\r\n"
+                            "lightship_kg_m=7.5";
+    const char *cargo = CARGO_MANIFEST;
+    CfCacheKey k1, k2, k3;
+    cargoforge_cache_key(NULL, ship, strlen(ship), cargo, strlen(cargo), &k1);
+    cargoforge_cache_key(NULL, ship_crlf, strlen(ship_crlf), cargo, strlen(cargo), &k2);
+    ASSERT(memcmp(&k1, &k2, sizeof(k1)) == 0, "normalized texts share a key");
+
+    /* Content, the ship/cargo split and result options all do */
+    cargoforge_cache_key(NULL, ship, strlen(ship), cargo, strlen(cargo) - 2, &k2);
+    ASSERT(memcmp(&k1, &k2, sizeof(k1)) != 0, "different manifest, different key");
+    cargoforge_cache_key(NULL, "", 0, "length_m=180\n", 13, &k2);
+    cargoforge_cache_key(NULL, "length_m=180\n", 13, "", 0, &k3);
+    ASSERT(memcmp(&k2, &k3, sizeof(k2)) != 0, "ship and cargo text are kept apart");
+    CargoForge *cf;
+    cargoforge_open(&cf);
+    cargoforge_cache_key(cf, ship, strlen(ship), cargo, strlen(cargo), &k2);
+    cargoforge_set_option(cf, CF_OPT_JSON_COMPACT, 1);
+    cargoforge_cache_key(cf, ship, strlen(ship), cargo, strlen(cargo), &k3);
+    ASSERT(memcmp(&k2, &k3, sizeof(k2)) != 0, "options change the key");
+
+    char *json = NULL;
+    size_t len = 0;
+    ASSERT_EQ_INT(cargoforge_cache_get(cache, &k1, &json, &len), CF_ERROR, "empty cache misses");
+    ASSERT_EQ_INT(cargoforge_cache_put(cache, &k1, "{\"a\":1}", 7), CF_OK, "put");
+    ASSERT_EQ_INT(cargoforge_cache_get(cache, &k1, &json, &len), CF_OK, "hit");
+    ASSERT(json && len == 7 && strcmp(json, "{\"a\":1}") == 0, "hit returns a copy of the result");
+    free(json);
+    ASSERT_EQ_INT(cargoforge_cache_put(cache, &k1, "[2]", 3), CF_OK, "replace");
+    cargoforge_cache_get(cache, &k1, &json, &len);
+    ASSERT(json && strcmp(json, "[2]") == 0, "replaced entry");
+    free(json);
+
+    /* Least recently used entries go first; the bound holds */
+    char big[5000];
+    memset(big, 'x', sizeof(big));
+    ASSERT_EQ_INT(cargoforge_cache_put(cache, &k2, big, sizeof(big)), CF_ERROR,
+                  "result larger than the cache is not stored");
+    ASSERT_EQ_INT(cargoforge_cache_put(cache, &k2, big, 1500), CF_OK, "put second");
+    cargoforge_cache_get(cache, &k1, &json, NULL);            /* k1 is now newest */
+    free(json);
+    ASSERT_EQ_INT(cargoforge_cache_put(cache, &k3, big, 2600), CF_OK, "put third");
+    ASSERT_EQ_INT(cargoforge_cache_get(cache, &k2, &json, NULL), CF_ERROR, "LRU entry evicted");
+    ASSERT_EQ_INT(cargoforge_cache_get(cache, &k1, &json, NULL), CF_OK, "recently used entry kept");
+    free(json);
+
+    CfCacheStats st;
+    cargoforge_cache_stats(cache, &st);
+    ASSERT_EQ_INT((int)st.entries, 2, "two entries");
+    ASSERT(st.bytes <= st.max_bytes && st.max_bytes == 4096, "within max_bytes");
+    ASSERT_EQ_INT((int)st.hits, 4, "hit count");
+    ASSERT_EQ_INT((int)st.misses, 2, "miss count");
+    ASSERT_EQ_INT((int)st.evictions, 1, "eviction count");
+
+    cargoforge_cache_clear(cache);
+    cargoforge_cache_stats(cache, &st);
+    ASSERT(st.entries == 0 && st.bytes == 0 && st.hits == 4, "clear keeps counters");
+
+    cargoforge_close(cf);
+    cargoforge_cache_close(cache);
+    cargoforge_cache_close(NULL);
+}
+
+/* --- Ship templates --- */
+
+typedef struct {
+    CfShipTemplate *tpl;
+    float gm;
+    int rc;
+} TemplateWorker;
+
+static void *template_worker(void *arg) {
+    TemplateWorker *w = arg;
+    CargoForge *cf;
+    w->rc = cargoforge_open(&cf);
+    if (w->rc == CF_OK) w->rc = cargoforge_load_ship_template(cf, w->tpl);
+    if (w->rc == CF_OK) w->rc = cargoforge_load_cargo_string(cf, CARGO_MANIFEST);
+    if (w->rc == CF_OK) w->rc = cargoforge_optimize(cf);
+    if (w->rc == CF_OK) w->gm = cargoforge_result(cf)->gm_corrected;
+    cargoforge_close(cf);
+    return NULL;
+}
+
+static void test_ship_template(void) {
+    printf("  test_ship_template\n");
+    const char *path = "examples/sample_ship_full.cfg";
+    CfShipTemplate *tpl;
+    ASSERT_EQ_INT(cargoforge_template_load(&tpl, "examples/no_such_ship.cfg"), CF_ERR_PARSE,
+                  "missing config fails");
+    ASSERT(tpl == NULL, "no template on failure");
+    ASSERT_EQ_INT(cargoforge_template_load(&tpl, path), CF_OK, "load template");
+
+    /* Reference: the same config loaded the ordinary way */
+    CargoForge *ref;
+    cargoforge_open(&ref);
+    cargoforge_load_ship(ref, path);
+    cargoforge_load_cargo_string(ref, CARGO_MANIFEST);
+    ASSERT_EQ_INT(cargoforge_optimize(ref), CF_OK, "reference optimize");
+    const CfResult *rr = cargoforge_result(ref);
+
+    CargoForge *a, *b;
+    cargoforge_open(&a);
+    cargoforge_open(&b);
+    ASSERT_EQ_INT(cargoforge_load_ship_template(a, tpl), CF_OK, "attach to a");
+    ASSERT_EQ_INT(cargoforge_load_ship_template(b, tpl), CF_OK, "attach to b");
+    cargoforge_template_release(tpl);          /* the handles keep it alive */
+
+    cargoforge_load_cargo_string(a, CARGO_MANIFEST);
+    cargoforge_load_cargo_string(b, CARGO_MANIFEST);
+    ASSERT_EQ_INT(cargoforge_optimize(a), CF_OK, "optimize a");
+    ASSERT_EQ_INT(cargoforge_optimize(b), CF_OK, "optimize b");
+    const CfResult *ra = cargoforge_result(a);
+    ASSERT(ra->hydro_table_used && ra->strength_compliant >= 0, "tables come from the template");
+    ASSERT(ra->gm_corrected == rr->gm_corrected && ra->draft == rr->draft &&
+           ra->max_bending_moment == rr->max_bending_moment,
+           "template result matches a parsed ship");
+    ASSERT(strcmp(cargoforge_result_json(a), cargoforge_result_json(ref)) == 0,
+           "template JSON matches a parsed ship");
+
+    /* Tank fills are per handle */
+    int tanks = cargoforge_tank_count(a);
+    ASSERT(tanks > 0, "tanks present");
+    ASSERT_EQ_INT(cargoforge_set_tank_fill(a, tanks, 0.5f), CF_ERROR, "bad tank index");
+    ASSERT_EQ_INT(cargoforge_set_tank_fill(a, 0, 1.5f), CF_ERROR, "bad fill");
+    for (int i = 0; i < tanks; i++)
+        ASSERT_EQ_INT(cargoforge_set_tank_fill(a, i, 0.5f), CF_OK, "set fill");
+    ASSERT(cargoforge_result(a) == NULL, "fill change invalidates results");
+    ASSERT_EQ_INT(cargoforge_analyze(a), CF_OK, "re-analyze a");
+    ASSERT(fabsf(cargoforge_result(a)->free_surface_correction -
+                 cargoforge_result(b)->free_surface_correction) > 1e-4f,
+           "fill change moves FSC on a");
+    ASSERT_EQ_INT(cargoforge_analyze(b), CF_OK, "re-analyze b");
+    ASSERT(cargoforge_result(b)->gm_corrected == rr->gm_corrected, "b is unaffected");
+
+    /* A sounding halfway up a box tank is a half fill (BallastFP is 6 m high) */
+    float gm_half = cargoforge_result(a)->gm_corrected;
+    ASSERT_EQ_INT(cargoforge_set_tank_sounding(a, tanks, 1.0f), CF_ERROR, "bad sounding index");
+    ASSERT_EQ_INT(cargoforge_set_tank_sounding(a, 0, NAN), CF_ERROR, "bad sounding");
+    ASSERT_EQ_INT(cargoforge_set_tank_sounding(a, 0, 3.0f), CF_OK, "set sounding");
+    ASSERT_EQ_INT(cargoforge_analyze(a), CF_OK, "analyze after sounding");
+    ASSERT(cargoforge_result(a)->gm_corrected == gm_half, "sounding gives the same fill");
+
+    /* Reloading, resetting and closing hand the tables back */
+    cargoforge_reset(a);
+    ASSERT_EQ_INT(cargoforge_load_ship_string(a, SHIP_CONFIG), CF_OK, "plain ship after template");
+    cargoforge_close(a);
+
+    /* Concurrent handles on one template */
+    ASSERT_EQ_INT(cargoforge_template_load(&tpl, path), CF_OK, "reload template");
+    pthread_t threads[4];
+    TemplateWorker workers[4];
+    for (int i = 0; i < 4; i++) {
+        workers[i].tpl = tpl;
+        workers[i].rc = CF_ERROR;
+        pthread_create(&threads[i], NULL, template_worker, &workers[i]);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        ASSERT(workers[i].rc == CF_OK && workers[i].gm == rr->gm_corrected,
+               "threaded template handle matches");
+    }
+    cargoforge_template_release(tpl);
+
+    cargoforge_close(b);
+    cargoforge_close(ref);
+}
+
+/* --- Batched what-if analysis --- */
+
+static void test_analyze_batch(void) {
+    printf("  test_analyze_batch\n");
+    const char *path = "examples/sample_ship_full.cfg";
+    CargoForge *cf, *ref;
+    cargoforge_open(&cf);
+    cargoforge_open(&ref);
+    cargoforge_load_ship(cf, path);
+    cargoforge_load_ship(ref, path);
+    cargoforge_load_cargo_string(cf, CARGO_MANIFEST);
+    cargoforge_load_cargo_string(ref, CARGO_MANIFEST);
+    cargoforge_optimize(cf);
+    cargoforge_optimize(ref);
+    CfResult before = *cargoforge_result(cf);
+
+    enum { N = 100 };
+    int tanks = cargoforge_tank_count(cf);
+    ASSERT(tanks > 0 && tanks <= 50, "sample ship has tanks");
+    static float fills[N][50];
+    CfCondition conds[N];
+    CfWeight swap[2] = {{40000.0f, 60.0f, 12.0f, 9.0f}, {-40000.0f, 60.0f, 12.0f, 9.0f}};
+    CfWeight added = {300000.0f, 80.0f, 12.5f, 4.0f};
+    for (int i = 0; i < N; i++) {
+        for (int t = 0; t < tanks; t++)
+            fills[i][t] = (float)((i * 7 + t * 3) % 11) / 10.0f;
+        conds[i].tank_fill = (i % 10 == 9) ? NULL : fills[i];
+        conds[i].weights = NULL;
+        conds[i].weight_count = 0;
+    }
+    conds[0].weights = swap;
+    conds[0].weight_count = 2;
+    conds[1].tank_fill = NULL;
+    conds[1].weights = &added;
+    conds[1].weight_count = 1;
+
+    CfResult results[N], threaded[N];
+    ASSERT_EQ_INT(cargoforge_analyze_batch(cf, conds, N, results), CF_OK, "batch");
+    ASSERT(memcmp(cargoforge_result(cf), &before, sizeof(before)) == 0,
+           "handle result untouched");
+
+    /* Each condition equals setting the fills and analyzing; weights that
+     * cancel change nothing, and no fills means the handle's own */
+    int same = 1;
+    for (int i = 0; i < N; i++) {
+        if (i == 1) continue;
+        const CfResult *want = &before;
+        if (conds[i].tank_fill) {
+            for (int t = 0; t < tanks; t++) cargoforge_set_tank_fill(ref, t, fills[i][t]);
+            cargoforge_analyze(ref);
+            want = cargoforge_result(ref);
+        }
+        if (memcmp(want, &results[i], sizeof(CfResult)) != 0) same = 0;
+    }
+    ASSERT(same, "batch results match per-condition analysis");
+    ASSERT(results[1].cargo_weight == before.cargo_weight + 300000.0f &&
+           results[1].displacement == before.displacement + 300000.0f &&
+           results[1].kg != before.kg,
+           "added weight counts");
+
+    cargoforge_set_option(cf, CF_OPT_THREADS, 4);
+    ASSERT_EQ_INT(cargoforge_analyze_batch(cf, conds, N, threaded), CF_OK, "threaded batch");
+    ASSERT(memcmp(results, threaded, sizeof(results)) == 0, "threaded batch matches serial");
+
+    fills[5][0] = 1.5f;
+    ASSERT_EQ_INT(cargoforge_analyze_batch(cf, conds, N, results), CF_ERROR, "bad fill");
+    ASSERT(strstr(cargoforge_errmsg(cf), "condition 5") != NULL, "bad fill reported");
+
+    CargoForge *bare;
+    cargoforge_open(&bare);
+    ASSERT_EQ_INT(cargoforge_analyze_batch(bare, conds, 1, results), CF_ERR_NO_SHIP, "no ship");
+    cargoforge_load_ship_string(bare, SHIP_CONFIG);
+    cargoforge_load_cargo_string(bare, CARGO_MANIFEST);
+    cargoforge_optimize(bare);
+    ASSERT_EQ_INT(cargoforge_analyze_batch(bare, conds, 1, results), CF_ERROR, "fills without tanks");
+    ASSERT_EQ_INT(cargoforge_analyze_batch(bare, &conds[1], 1, results), CF_OK, "weights only");
+
+    cargoforge_close(bare);
+    cargoforge_close(cf);
+    cargoforge_close(ref);
+}
+
+/* --- Main --- */
+
+static void test_diagnostics(void) {
+    printf("  test_diagnostics\n");
+    static const char *manifest =
+        "BOX1 20 12.0x2.4x2.6 standard\n"
+        "FLAM 2 2.0x2.0x2.0 hazardous DG:3:UN1203:A:F-E\n"
+        "EXPL 2 2.0x2.0x2.0 hazardous DG:1.1:UN0081:A:F-B\n";
+
+    CargoForge *cf;
+    cargoforge_open(&cf);
+    cargoforge_load_ship_string(cf, SHIP_CONFIG);
+    cargoforge_load_cargo_string(cf, manifest);
+
+    ASSERT_EQ_INT(cargoforge_get_option(cf, CF_OPT_DIAGNOSTICS), 0, "diagnostics off by default");
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_DIAGNOSTICS, -1), CF_ERROR, "negative size rejected");
+    ASSERT_EQ_INT(cargoforge_optimize(cf), CF_OK, "optimize without diagnostics");
+    long long totals[CF_DIAG_CODE_COUNT], entries = -1;
+    ASSERT_EQ_INT(cargoforge_diag_totals(cf, totals, &entries), CF_OK, "totals");
+    ASSERT(cargoforge_diag_count(cf) == 0 && entries == 0 && totals[CF_DIAG_UNPLACED] == 0,
+           "nothing recorded while off");
+
+    /* The two DG items are incompatible: whichever comes second is refused */
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_DIAGNOSTICS, 16), CF_OK, "enable diagnostics");
+    ASSERT_EQ_INT(cargoforge_optimize(cf), CF_OK, "optimize with diagnostics");
+    int n = cargoforge_diag_count(cf);
+    ASSERT(n >= 1 && n <= 16, "entries recorded");
+
+    long long sum[CF_DIAG_CODE_COUNT] = {0};
+    int refused = -1;
+    for (int k = 0; k < n; k++) {
+        CfDiagnostic d;
+        ASSERT_EQ_INT(cargoforge_diag_get(cf, k, &d), CF_OK, "get entry");
+        for (int c = 0; c < CF_DIAG_CODE_COUNT; c++) sum[c] += d.counts[c];
+        if (d.counts[CF_DIAG_UNPLACED]) refused = k;
+    }
+    CfDiagnostic d;
+    ASSERT(refused >= 0 && cargoforge_diag_get(cf, refused, &d) == CF_OK &&
+           d.counts[CF_DIAG_IMDG_INCOMPATIBLE] > 0 &&
+           (strcmp(d.cargo_id, "FLAM") == 0 || strcmp(d.cargo_id, "EXPL") == 0),
+           "refused DG item lists the incompatible rejections");
+    CfCargoInfo info;
+    ASSERT(cargoforge_cargo_info(cf, d.cargo_index, &info) == CF_OK && !info.placed &&
+           strcmp(info.id, d.cargo_id) == 0, "entry index names the item");
+    ASSERT_EQ_INT(cargoforge_diag_get(cf, n, &d), CF_ERROR, "index past the end");
+
+    cargoforge_diag_totals(cf, totals, &entries);
+    int same = entries == n;
+    for (int c = 0; c < CF_DIAG_CODE_COUNT; c++) same &= totals[c] == sum[c];
+    ASSERT(same, "totals are the sum of the entries");
+    ASSERT(strcmp(cargoforge_diag_name(CF_DIAG_IMDG_INCOMPATIBLE), "IMDG incompatible") == 0,
+           "code name");
+
+    /* A one-entry ring keeps the newest entry and every total */
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_DIAGNOSTICS, 1), CF_OK, "shrink the ring");
+    ASSERT_EQ_INT(cargoforge_optimize(cf), CF_OK, "optimize again");
+    long long entries1;
+    cargoforge_diag_totals(cf, totals, &entries1);
+    ASSERT(cargoforge_diag_count(cf) == 1 && entries1 == entries &&
+           totals[CF_DIAG_UNPLACED] == 1, "ring overwrites, totals keep counting");
+
+    cargoforge_diag_clear(cf);
+    cargoforge_diag_totals(cf, totals, &entries1);
+    ASSERT(cargoforge_diag_count(cf) == 0 && entries1 == 0, "clear empties the log");
+
+    /* Multistart replays its winning plan for the log */
+    cargoforge_set_option(cf, CF_OPT_STRATEGY, CF_STRATEGY_MULTISTART);
+    ASSERT_EQ_INT(cargoforge_optimize(cf), CF_OK, "multistart with diagnostics");
+    cargoforge_diag_totals(cf, totals, &entries1);
+    ASSERT(totals[CF_DIAG_UNPLACED] == 1 && totals[CF_DIAG_IMDG_INCOMPATIBLE] > 0,
+           "multistart plan recorded");
+
+    /* The threaded search folds each work unit's tally */
+    cargoforge_set_option(cf, CF_OPT_STRATEGY, CF_STRATEGY_FFD);
+    cargoforge_set_option(cf, CF_OPT_THREADS, 2);
+    ASSERT_EQ_INT(cargoforge_optimize(cf), CF_OK, "threaded optimize with diagnostics");
+    cargoforge_diag_totals(cf, totals, &entries1);
+    ASSERT(totals[CF_DIAG_UNPLACED] == 1 && totals[CF_DIAG_IMDG_INCOMPATIBLE] > 0,
+           "threaded plan recorded");
+
+    cargoforge_close(cf);
+}
+
+/** Optimize path's ship (or tpl) with cargo file, return a copy of the JSON */
+static char *arena_cycle(CargoForge *cf, const char *ship, CfShipTemplate *tpl,
+                         const char *cargo) {
+    cargoforge_reset(cf);
+    int rc = tpl ? cargoforge_load_ship_template(cf, tpl) : cargoforge_load_ship(cf, ship);
+    if (rc == CF_OK) rc = cargoforge_load_cargo(cf, cargo);
+    if (rc == CF_OK) rc = cargoforge_optimize(cf);
+    const char *json = rc == CF_OK ? cargoforge_result_json(cf) : NULL;
+    if (!json) return NULL;
+    char *copy = malloc(strlen(json) + 1);
+    if (copy) strcpy(copy, json);
+    return copy;
+}
+
+static void test_arena(void) {
+    printf("  test_arena\n");
+    const char *ships[] = { "examples/sample_ship_full.cfg", "examples/sample_ship_holds.cfg" };
+    const char *cargo = "examples/sample_cargo_dg.txt";
+    CfShipTemplate *tpl;
+    ASSERT_EQ_INT(cargoforge_template_load(&tpl, ships[0]), CF_OK, "load template");
+
+    CargoForge *heap, *cf;
+    cargoforge_open(&heap);
+    cargoforge_open(&cf);
+    ASSERT_EQ_INT(cargoforge_get_option(cf, CF_OPT_ARENA), 0, "arena off by default");
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_ARENA, 2), CF_ERROR, "bad value rejected");
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_ARENA, 1), CF_OK, "enable the arena");
+    ASSERT_EQ_INT(cargoforge_get_option(cf, CF_OPT_ARENA), 1, "arena on");
+
+    /* Same results as heap memory, for parsed ships and templates */
+    int same = 1;
+    for (int k = 0; k < 3; k++) {
+        const char *ship = k < 2 ? ships[k] : NULL;
+        CfShipTemplate *t = k < 2 ? NULL : tpl;
+        char *want = arena_cycle(heap, ship, t, cargo);
+        char *got = arena_cycle(cf, ship, t, cargo);
+        same &= want && got && strcmp(want, got) == 0;
+        free(want);
+        free(got);
+    }
+    ASSERT(same, "arena handle gives the heap handle's results");
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_ARENA, 0), CF_ERR_STATE,
+                  "arena cannot change with a ship loaded");
+
+    /* Warm: the same work again fits in the blocks already held */
+    size_t used, reserved, reserved2;
+    free(arena_cycle(cf, ships[0], NULL, cargo));
+    cargoforge_arena_stats(cf, &used, &reserved);
+    ASSERT(used > 0 && reserved >= used, "ship and cargo live in the arena");
+    int stable = 1;
+    for (int i = 0; i < 20; i++) {
+        free(arena_cycle(cf, i & 1 ? NULL : ships[0], i & 1 ? tpl : NULL, cargo));
+        cargoforge_arena_stats(cf, NULL, &reserved2);
+        stable &= reserved2 == reserved;
+    }
+    ASSERT(stable, "reuse after reset does not grow the arena");
+
+    /* Reloading cargo rewinds to the end of the ship's tables */
+    cargoforge_arena_stats(cf, &used, NULL);
+    for (int i = 0; i < 5; i++) cargoforge_load_cargo(cf, cargo);
+    size_t used2;
+    cargoforge_arena_stats(cf, &used2, NULL);
+    ASSERT(used2 <= used, "cargo reload reuses its region");
+
+    /* Edits grow the cargo array inside the arena */
+    int added = 1;
+    char id[16];
+    for (int i = 0; i < 40; i++) {
+        snprintf(id, sizeof(id), "EXTRA%d", i);
+        added &= cargoforge_add_cargo(cf, id, 1000.0f, 2.0f, 2.0f, 2.0f, "standard") == CF_OK;
+    }
+    CfCargoInfo info;
+    ASSERT(added && cargoforge_cargo_count(cf) > 40 &&
+           cargoforge_cargo_info(cf, cargoforge_cargo_count(cf) - 1, &info) == CF_OK &&
+           strcmp(info.id, "EXTRA39") == 0, "cargo added to an arena manifest");
+
+    cargoforge_reset(cf);
+    cargoforge_arena_stats(cf, &used, NULL);
+    ASSERT(used == 0, "reset empties the arena");
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_ARENA, 0), CF_OK, "disable after reset");
+    cargoforge_arena_stats(cf, &used, &reserved);
+    ASSERT(used == 0 && reserved == 0, "disabling releases the blocks");
+
+    cargoforge_close(cf);
+    cargoforge_close(heap);
+    cargoforge_template_release(tpl);
+}
+
+static void test_stats(void) {
+    printf("  test_stats\n");
+    static const char *manifest =
+        "BOX1 20 12.0x2.4x2.6 standard\n"
+        "FLAM 2 2.0x2.0x2.0 hazardous DG:3:UN1203:A:F-E\n"
+        "EXPL 2 2.0x2.0x2.0 hazardous DG:1.1:UN0081:A:F-B\n";
+
+    CargoForge *cf;
+    CfStats st;
+    cargoforge_open(&cf);
+    ASSERT_EQ_INT(cargoforge_get_option(cf, CF_OPT_STATS), 0, "stats off by default");
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_STATS, 2), CF_ERROR, "bad value rejected");
+    ASSERT_EQ_INT(cargoforge_stats(cf, NULL), CF_ERROR, "NULL stats rejected");
+
+    cargoforge_load_ship_string(cf, SHIP_CONFIG);
+    cargoforge_load_cargo_string(cf, manifest);
+    cargoforge_optimize(cf);
+    ASSERT_EQ_INT(cargoforge_stats(cf, &st), CF_OK, "stats while off");
+    ASSERT(st.place_ms == 0.0 && st.items_searched == 0 && st.spaces_scanned == 0,
+           "nothing counted while off");
+    ASSERT(st.bin_count == 3, "the plan's bins are reported anyway");
+
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_STATS, 1), CF_OK, "enable stats");
+    cargoforge_load_ship_string(cf, SHIP_CONFIG);
+    cargoforge_load_cargo_string(cf, manifest);
+    ASSERT_EQ_INT(cargoforge_optimize(cf), CF_OK, "optimize with stats");
+    ASSERT_EQ_INT(cargoforge_check_imdg(cf), CF_OK, "imdg with stats");
+    ASSERT(cargoforge_result_json(cf) != NULL, "json with stats");
+    cargoforge_stats(cf, &st);
+    ASSERT(st.ship_parse_ms > 0.0 && st.cargo_parse_ms > 0.0 && st.place_ms > 0.0 &&
+           st.analysis_ms > 0.0 && st.imdg_ms > 0.0 && st.serialize_ms > 0.0,
+           "every phase timed");
+    ASSERT(st.items_searched == 3 && st.spaces_scanned >= 3, "one search per item");
+    ASSERT(st.counts[CF_DIAG_UNPLACED] == 1 && st.counts[CF_DIAG_IMDG_INCOMPATIBLE] > 0,
+           "rejections counted by reason");
+
+    /* Per-bin free spaces sum to what the search would scan next */
+    int free_spaces = 0;
+    CfBinStats b;
+    for (int i = 0; i < st.bin_count; i++) {
+        ASSERT_EQ_INT(cargoforge_bin_stats(cf, i, &b), CF_OK, "bin stats");
+        free_spaces += b.free_spaces;
+    }
+    ASSERT(free_spaces >= st.bin_count, "every bin has free space left");
+    ASSERT_EQ_INT(cargoforge_bin_stats(cf, st.bin_count, &b), CF_ERROR, "bin past the end");
+
+    /* Counters restart with each optimize, and edits add to them */
+    cargoforge_optimize(cf);
+    cargoforge_stats(cf, &st);
+    ASSERT(st.items_searched == 3, "optimize restarts the counters");
+    cargoforge_add_cargo(cf, "LATE", 1000.0f, 2.0f, 2.0f, 2.0f, NULL);
+    cargoforge_stats(cf, &st);
+    ASSERT(st.items_searched == 4, "added item searched once");
+
+    /* Multistart trials are not counted; its replayed winner is */
+    cargoforge_set_option(cf, CF_OPT_STRATEGY, CF_STRATEGY_MULTISTART);
+    cargoforge_optimize(cf);
+    cargoforge_stats(cf, &st);
+    ASSERT(st.items_searched == 4 && st.bin_count == 3, "multistart winner replayed");
+
+    cargoforge_reset(cf);
+    cargoforge_stats(cf, &st);
+    ASSERT(st.ship_parse_ms == 0.0 && st.items_searched == 0 && st.bin_count == 0,
+           "reset clears the stats");
+    ASSERT_EQ_INT(cargoforge_get_option(cf, CF_OPT_STATS), 1, "option survives reset");
+
+    cargoforge_close(cf);
+}
+
+/* Threaded search tallies the same rejections as the serial scan */
+static void test_threaded_stats(void) {
+    printf("  test_threaded_stats\n");
+    static const char *types[] = { "standard", "hazardous", "reefer", "fragile", "bulk" };
+    size_t cap = 3000 * 64, len = 0;
+    char *manifest = malloc(cap);
+    unsigned int seed = 3;
+    for (int i = 0; i < 3000; i++) {
+        float v[4];
+        for (int k = 0; k < 4; k++) {
+            seed = seed * 1103515245u + 12345u;
+            v[k] = (float)((seed >> 16) & 0x7fff) / 32767.0f;
+        }
+        len += (size_t)snprintf(manifest + len, cap - len, "I%d %d %.1fx%.1fx%.1f %s\n", i,
+                                1 + (int)(v[0] * 39.0f), 1.0f + v[1] * 11.0f, 1.0f + v[2] * 2.0f,
+                                1.0f + v[3] * 2.0f, types[i % 5]);
+    }
+
+    CfStats st[2];
+    for (int run = 0; run < 2; run++) {
+        CargoForge *cf;
+        cargoforge_open(&cf);
+        cargoforge_set_option(cf, CF_OPT_STATS, 1);
+        cargoforge_set_option(cf, CF_OPT_THREADS, run ? 4 : 1);
+        cargoforge_load_ship(cf, "examples/sample_ship_full.cfg");
+        cargoforge_load_cargo_string(cf, manifest);
+        ASSERT_EQ_INT(cargoforge_optimize(cf), CF_OK, "optimize");
+        cargoforge_stats(cf, &st[run]);
+        cargoforge_close(cf);
+    }
+    free(manifest);
+
+    long long rejected = 0;
+    int same = 1;
+    for (int k = 0; k < CF_DIAG_CODE_COUNT; k++) {
+        rejected += st[0].counts[k];
+        same &= st[0].counts[k] == st[1].counts[k];
+    }
+    ASSERT(rejected > 0, "manifest draws rejections");
+    ASSERT(same, "threaded rejection counts match serial");
+}
+
+typedef struct {
+    int calls;
+    int status;
+    int placed;                    /* result seen from the callback, -1 = none */
+} JobRecord;
+
+static void record_job(CfJob *job, int status, void *user) {
+    JobRecord *rec = user;
+    const CfResult *r = cargoforge_result(cargoforge_job_handle(job));
+    rec->calls++;
+    rec->status = status;
+    rec->placed = r ? r->placed_count : -1;
+}
+
+static void test_async_jobs(void) {
+    printf("  test_async_jobs\n");
+    CargoForge *sync, *cf;
+    cargoforge_open(&sync);
+    cargoforge_open(&cf);
+    cargoforge_load_ship_string(sync, SHIP_CONFIG);
+    cargoforge_load_cargo_string(sync, CARGO_MANIFEST);
+    cargoforge_optimize(sync);
+    cargoforge_load_ship_string(cf, SHIP_CONFIG);
+    cargoforge_load_cargo_string(cf, CARGO_MANIFEST);
+
+    /* A completed job leaves what the direct call would */
+    JobRecord rec = {0, 0, 0};
+    CfJobOptions opts;
+    cargoforge_job_options_init(&opts);
+    ASSERT_EQ_INT(opts.op, CF_JOB_OPTIMIZE, "optimize by default");
+    opts.on_done = record_job;
+    opts.user = &rec;
+
+    CfJob *job = NULL;
+    ASSERT_EQ_INT(cargoforge_submit(cf, &opts, &job), CF_OK, "submit optimize");
+    ASSERT_EQ_INT(cargoforge_job_wait(job, -1), CF_OK, "job completes");
+    ASSERT_EQ_INT(cargoforge_job_poll(job), CF_OK, "poll after completion");
+    ASSERT(cargoforge_job_handle(job) == cf, "job knows its handle");
+    ASSERT(rec.calls == 1 && rec.status == CF_OK, "callback ran once with the status");
+    const CfResult *rs = cargoforge_result(sync);
+    const CfResult *ra = cargoforge_result(cf);
+    ASSERT(rs && ra && ra->placed_count == rs->placed_count &&
+           ra->gm_corrected == rs->gm_corrected, "async result matches direct call");
+    ASSERT(rs && rec.placed == rs->placed_count, "callback sees the result");
+    cargoforge_job_release(job);
+
+    opts.op = CF_JOB_ANALYZE;
+    ASSERT_EQ_INT(cargoforge_submit(cf, &opts, &job), CF_OK, "submit analyze");
+    ASSERT_EQ_INT(cargoforge_job_wait(job, 10000), CF_OK, "analyze completes");
+    ASSERT(rec.calls == 2, "callback for the second job");
+    cargoforge_job_release(job);
+
+    opts.op = 5;
+    ASSERT_EQ_INT(cargoforge_submit(cf, &opts, &job), CF_ERROR, "unknown op rejected");
+    ASSERT(job == NULL, "no job on error");
+    ASSERT_EQ_INT(cargoforge_submit(cf, NULL, NULL), CF_ERROR, "NULL out rejected");
+
+    /* A long multistart search, cancelled as a planner edits again */
+    char *manifest = make_large_manifest(1500);
+    CargoForge *big;
+    cargoforge_open(&big);
+    cargoforge_set_option(big, CF_OPT_STRATEGY, CF_STRATEGY_MULTISTART);
+    cargoforge_load_ship_string(big, SHIP_CONFIG);
+    cargoforge_load_cargo_string(big, manifest);
+
+    JobRecord stale = {0, 0, 0};
+    cargoforge_job_options_init(&opts);
+    opts.on_done = record_job;
+    opts.user = &stale;
+    ASSERT_EQ_INT(cargoforge_submit(big, &opts, &job), CF_OK, "submit long job");
+    CfJob *second = NULL;
+    ASSERT_EQ_INT(cargoforge_submit(big, NULL, &second), CF_ERR_STATE, "one job per handle");
+    cargoforge_job_cancel(job);
+    ASSERT_EQ_INT(cargoforge_job_wait(job, -1), CF_ERR_CANCELLED, "cancelled job");
+    ASSERT(stale.calls == 1 && stale.status == CF_ERR_CANCELLED && stale.placed == -1,
+           "callback reports the cancel, no result");
+    ASSERT(cargoforge_result(big) == NULL, "no result after cancel");
+    ASSERT_EQ_INT(cargoforge_cargo_count(big), 1500, "cargo kept");
+    int any_placed = 0;
+    for (int i = 0; i < 1500; i++) {
+        CfCargoInfo info;
+        cargoforge_cargo_info(big, i, &info);
+        any_placed |= info.placed;
+    }
+    ASSERT(!any_placed, "cancelled plan discarded");
+    cargoforge_job_release(job);
+
+    /* A deadline stops it the same way */
+    opts.deadline_ms = 1;
+    ASSERT_EQ_INT(cargoforge_submit(big, &opts, &job), CF_OK, "submit with deadline");
+    ASSERT_EQ_INT(cargoforge_job_wait(job, -1), CF_ERR_TIMEOUT, "deadline passed");
+    ASSERT(strcmp(cargoforge_errmsg(big), "Job deadline passed") == 0, "deadline message");
+    cargoforge_job_release(job);
+
+    /* The handle is usable again */
+    cargoforge_set_option(big, CF_OPT_STRATEGY, CF_STRATEGY_FFD);
+    ASSERT_EQ_INT(cargoforge_optimize(big), CF_OK, "direct call after a stopped job");
+    ASSERT(cargoforge_result(big) != NULL, "result after re-optimize");
+
+    /* Closing a handle cancels its job; the caller's reference stays valid */
+    cargoforge_set_option(big, CF_OPT_STRATEGY, CF_STRATEGY_MULTISTART);
+    ASSERT_EQ_INT(cargoforge_submit(big, NULL, &job), CF_OK, "submit before close");
+    cargoforge_close(big);
+    ASSERT_EQ_INT(cargoforge_job_poll(job), CF_ERR_CANCELLED, "close cancels the job");
+    cargoforge_job_release(job);
+
+    ASSERT(strcmp(cargoforge_errstr(CF_ERR_CANCELLED), "Job cancelled") == 0, "cancel string");
+    ASSERT(strcmp(cargoforge_errstr(CF_ERR_TIMEOUT), "Job deadline passed") == 0, "timeout string");
+
+    free(manifest);
+    cargoforge_close(sync);
+    cargoforge_close(cf);
+}
+
+static void test_result_mask(void) {
+    printf("  test_result_mask\n");
+    static const char *ship =
+        "length_m=180\n"
+        "width_m=32\n"
+        "max_weight_tonnes=50000\n"
+        "lightship_weight_tonnes=12000\n"
+        "lightship_kg_m=7.5\n"
+        "permissible_sf_tonnes=5000\n"
+        "permissible_bm_hog_t_m=120000\n"
+        "permissible_bm_sag_t_m=100000\n";
+    CargoForge *full, *cf;
+    cargoforge_open(&full);
+    cargoforge_open(&cf);
+    ASSERT_EQ_INT(cargoforge_get_option(cf, CF_OPT_RESULT_MASK), CF_RESULT_ALL, "everything by default");
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_RESULT_MASK, 0x10), CF_ERROR, "unknown section rejected");
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_JSON_CARGO_FIRST, -1), CF_ERROR, "negative first rejected");
+
+    CargoForge *handles[2] = { full, cf };
+    for (int h = 0; h < 2; h++) {
+        cargoforge_load_ship_string(handles[h], ship);
+        cargoforge_load_cargo_string(handles[h], CARGO_MANIFEST);
+    }
+    cargoforge_optimize(full);
+    const CfResult *rf = cargoforge_result(full);
+    ASSERT(rf && rf->strength_compliant >= 0 && rf->gm_corrected != 0.0f, "full result");
+
+    /* Placements only: the summary without stability or strength */
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_RESULT_MASK, CF_RESULT_CARGO), CF_OK, "placements only");
+    ASSERT_EQ_INT(cargoforge_optimize(cf), CF_OK, "optimize");
+    const CfResult *r = cargoforge_result(cf);
+    ASSERT(r && rf && r->placed_count == rf->placed_count &&
+           r->cargo_weight == rf->cargo_weight && r->displacement == rf->displacement,
+           "summary always there");
+    ASSERT(r && r->gm_corrected == 0.0f && r->gz_max == 0.0f && r->strength_compliant == -1,
+           "stages left out not computed");
+    const char *json = cargoforge_result_json(cf);
+    ASSERT(json && strstr(json, "\"cargo\"") && !strstr(json, "\"ship\"") &&
+           !strstr(json, "hydrostatics") && !strstr(json, "longitudinal_strength") &&
+           strstr(json, "\"overweight\": false"), "placement sections only");
+
+    /* Adding a stage later computes just that one, on access */
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_RESULT_MASK, CF_RESULT_STRENGTH), CF_OK, "strength");
+    r = cargoforge_result(cf);
+    ASSERT(r && rf && r->strength_compliant == rf->strength_compliant &&
+           r->max_bending_moment == rf->max_bending_moment && r->gm_corrected == 0.0f,
+           "strength alone");
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_RESULT_MASK, CF_RESULT_STABILITY), CF_OK, "stability");
+    r = cargoforge_result(cf);
+    ASSERT(r && rf && r->gm_corrected == rf->gm_corrected && r->gz_max == rf->gz_max &&
+           r->max_bending_moment == rf->max_bending_moment, "stability added, strength kept");
+    json = cargoforge_result_json(cf);
+    ASSERT(json && !strstr(json, "\"cargo\"") && strstr(json, "hydrostatics") &&
+           !strstr(json, "longitudinal_strength"), "stability sections only");
+
+    /* With everything selected the JSON is the full document */
+    cargoforge_set_option(cf, CF_OPT_RESULT_MASK, CF_RESULT_ALL);
+    json = cargoforge_result_json(cf);
+    const char *jf = cargoforge_result_json(full);
+    ASSERT(json && jf && strcmp(json, jf) == 0, "all sections match the default");
+
+    /* A page of the cargo array */
+    cargoforge_set_option(cf, CF_OPT_RESULT_MASK, CF_RESULT_CARGO);
+    cargoforge_set_option(cf, CF_OPT_JSON_COMPACT, 1);
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_JSON_CARGO_FIRST, 1), CF_OK, "first");
+    ASSERT_EQ_INT(cargoforge_set_option(cf, CF_OPT_JSON_CARGO_COUNT, 2), CF_OK, "count");
+    ASSERT_EQ_INT(cargoforge_get_option(cf, CF_OPT_JSON_CARGO_COUNT), 2, "count read back");
+    json = cargoforge_result_json(cf);
+    CfCargoInfo a, b, c;
+    cargoforge_cargo_info(cf, 0, &a);
+    cargoforge_cargo_info(cf, 1, &b);
+    cargoforge_cargo_info(cf, 3, &c);
+    char id[64];
+    snprintf(id, sizeof(id), "\"id\":\"%s\"", a.id);
+    ASSERT(json && !strstr(json, id), "items before the page left out");
+    snprintf(id, sizeof(id), "{\"cargo\":[{\"id\":\"%s\"", b.id);
+    ASSERT(json && strncmp(json, id, strlen(id)) == 0, "page starts at first");
+    snprintf(id, sizeof(id), "\"id\":\"%s\"", c.id);
+    ASSERT(json && !strstr(json, id), "items after the page left out");
+    ASSERT(json && strstr(json, "\"cargo_page\":{\"first\":1,\"count\":2,\"total\":5}"),
+           "page bounds reported");
+    cargoforge_set_option(cf, CF_OPT_JSON_CARGO_FIRST, 9);
+    json = cargoforge_result_json(cf);
+    ASSERT(json && strstr(json, "\"cargo\":[],\"cargo_page\":{\"first\":5,\"count\":0,"),
+           "page past the end is empty");
+
+    cargoforge_close(full);
+    cargoforge_close(cf);
+}
+
+static void test_plan_view(void) {
+    printf("  test_plan_view\n");
+    CargoForge *cf;
+    cargoforge_open(&cf);
+    CfPlanView v;
+    ASSERT_EQ_INT(cargoforge_plan_view(cf, &v), CF_ERR_NO_CARGO, "no manifest");
+
+    cargoforge_load_ship_string(cf, SHIP_CONFIG);
+    cargoforge_load_cargo_string(cf, CARGO_MANIFEST);
+    ASSERT_EQ_INT(cargoforge_plan_view(cf, &v), CF_OK, "view before optimize");
+    ASSERT(v.count == 5 && v.placed[0] == 0 && v.pos[0] == -1.0f, "unplaced items");
+
+    ASSERT_EQ_INT(cargoforge_optimize(cf), CF_OK, "optimize");
+    ASSERT_EQ_INT(cargoforge_plan_view(cf, &v), CF_OK, "view");
+    const CfPlanHeader *h = v.data;
+    ASSERT(memcmp(h->magic, CF_PLAN_MAGIC, CF_PLAN_MAGIC_LEN) == 0 &&
+           h->version == CF_PLAN_VERSION && h->count == 5 && h->size == v.size, "header");
+    ASSERT(((size_t)v.data | (size_t)v.id_offsets | (size_t)v.ids | (size_t)v.pos |
+            (size_t)v.dims | (size_t)v.weight | (size_t)v.placed) % 64 == 0,
+           "arrays on 64-byte boundaries");
+
+    int same = 1;
+    for (int i = 0; i < v.count; i++) {
+        CfCargoInfo info;
+        cargoforge_cargo_info(cf, i, &info);
+        int len = v.id_offsets[i + 1] - v.id_offsets[i];
+        same &= len == (int)strlen(info.id) &&
+                memcmp(v.ids + v.id_offsets[i], info.id, (size_t)len) == 0;
+        same &= v.pos[3 * i] == info.pos_x && v.pos[3 * i + 1] == info.pos_y &&
+                v.pos[3 * i + 2] == info.pos_z;
+        same &= v.dims[3 * i] == info.length && v.dims[3 * i + 1] == info.width &&
+                v.dims[3 * i + 2] == info.height;
+        same &= v.weight[i] == info.weight && v.placed[i] == (info.placed ? 1 : 0);
+    }
+    ASSERT(same, "arrays match cargoforge_cargo_info");
+    ASSERT(v.id_offsets[0] == 0 && v.id_offsets[5] == (int32_t)strlen(
+               "CONTAINER1CONTAINER2CONTAINER3DRUMS1REEFER1"), "id offsets cover the ids");
+
+    CfPlanView again;
+    cargoforge_plan_view(cf, &again);
+    ASSERT(again.data == v.data && again.pos == v.pos, "view is kept between calls");
+
+    /* An export is the block byte for byte */
+    const char *path = "/tmp/test_library_plan.cfp";
+    ASSERT_EQ_INT(cargoforge_plan_export(cf, path), CF_OK, "export");
+    FILE *fp = fopen(path, "rb");
+    unsigned char *buf = malloc(v.size + 1);
+    size_t got = fp && buf ? fread(buf, 1, v.size + 1, fp) : 0;
+    if (fp) fclose(fp);
+    ASSERT(got == v.size && memcmp(buf, v.data, v.size) == 0, "export matches the view");
+    free(buf);
+    remove(path);
+    ASSERT_EQ_INT(cargoforge_plan_export(cf, "/nonexistent-dir/plan.cfp"), CF_ERR_FILE,
+                  "unwritable export path");
+
+    /* Plan changes rebuild the view */
+    ASSERT_EQ_INT(cargoforge_remove_cargo(cf, "CONTAINER1"), CF_OK, "remove");
+    ASSERT_EQ_INT(cargoforge_plan_view(cf, &v), CF_OK, "view after remove");
+    ASSERT(v.count == 4 && v.id_offsets[4] == (int32_t)strlen("CONTAINER2CONTAINER3DRUMS1REEFER1"),
+           "rebuilt");
+
+    cargoforge_reset(cf);
+    ASSERT_EQ_INT(cargoforge_plan_view(cf, &v), CF_ERR_NO_CARGO, "no view after reset");
+    cargoforge_close(cf);
+}
+
+static void test_simulate_sequence(void) {
+    printf("  test_simulate_sequence\n");
+    CargoForge *cf;
+    cargoforge_open(&cf);
+    CfSequenceStep steps[12];
+    ASSERT_EQ_INT(cargoforge_simulate_sequence(cf, NULL, 0, steps), CF_ERR_NO_SHIP, "no ship");
+    cargoforge_load_ship(cf, "examples/sample_ship_full.cfg");
+    ASSERT_EQ_INT(cargoforge_simulate_sequence(cf, NULL, 0, steps), CF_ERR_NO_CARGO, "no cargo");
+    cargoforge_load_cargo_string(cf, CARGO_MANIFEST);
+    ASSERT_EQ_INT(cargoforge_optimize(cf), CF_OK, "optimize");
+    CfResult before = *cargoforge_result(cf);
+    int placed = before.placed_count;
+    ASSERT(placed > 0 && placed <= 5, "items placed");
+
+    /* Replaying the plan ends in the optimized condition */
+    ASSERT_EQ_INT(cargoforge_simulate_sequence(cf, NULL, placed, steps), CF_OK, "replay");
+    ASSERT(steps[0].cargo == -1 && steps[0].on_board == 0 && steps[0].cargo_weight == 0.0f,
+           "starts empty");
+    const CfSequenceStep *last = &steps[placed];
+    ASSERT(last->on_board == placed && last->op == CF_MOVE_LOAD, "all loaded");
+    ASSERT(fabsf(last->cargo_weight - before.cargo_weight) < 1.0f &&
+           last->displacement >= before.displacement, "weights match (tanks included)");
+    ASSERT(fabsf(last->draft - before.draft) < 1e-4f &&
+           fabsf(last->gm_corrected - before.gm_corrected) < 1e-4f &&
+           fabsf(last->trim - before.trim) < 1e-4f, "stability matches");
+    ASSERT(fabsf(last->max_bending_moment - before.max_bending_moment) <
+               1e-3f * (1.0f + before.max_bending_moment) &&
+           last->strength_compliant == before.strength_compliant, "strength matches");
+    ASSERT(memcmp(cargoforge_result(cf), &before, sizeof(before)) == 0,
+           "handle result untouched");
+    ASSERT_EQ_INT(cargoforge_simulate_sequence(cf, NULL, placed + 1, steps), CF_ERROR,
+                  "replay count checked");
+
+    /* Discharge and reload one item */
+    int item = steps[1].cargo;
+    CfMove moves[2] = { { item, CF_MOVE_DISCHARGE }, { item, CF_MOVE_LOAD } };
+    ASSERT_EQ_INT(cargoforge_simulate_sequence(cf, moves, 2, steps), CF_OK, "discharge, load");
+    ASSERT(steps[0].on_board == placed && steps[1].on_board == placed - 1 &&
+           steps[1].op == CF_MOVE_DISCHARGE && steps[1].cargo == item, "discharge step");
+    ASSERT(steps[2].gm_corrected == steps[0].gm_corrected ||
+           fabsf(steps[2].gm_corrected - steps[0].gm_corrected) < 1e-4f, "reload restores");
+
+    moves[1].op = CF_MOVE_DISCHARGE;
+    ASSERT_EQ_INT(cargoforge_simulate_sequence(cf, moves, 2, steps), CF_ERROR, "double discharge");
+    ASSERT(strstr(cargoforge_errmsg(cf), "Invalid move") != NULL, "reported");
+    moves[0].cargo = 99;
+    ASSERT_EQ_INT(cargoforge_simulate_sequence(cf, moves, 1, steps), CF_ERROR, "bad index");
+
+    cargoforge_close(cf);
+}
+
 /* --- Main --- */
 
 int main(void) {
@@ -218,11 +1351,27 @@ int main(void) {
     test_open_close();
     test_load_before_ship();
     test_optimize_from_strings();
+    test_load_from_buffers();
     test_cargo_info();
     test_imdg_check();
     test_reset();
     test_optimize_no_data();
     test_imdg_before_optimize();
+    test_threaded_matches_serial();
+    test_multistart_option();
+    test_placer_option();
+    test_incremental_add_remove();
+    test_result_cache();
+    test_ship_template();
+    test_analyze_batch();
+    test_diagnostics();
+    test_arena();
+    test_stats();
+    test_threaded_stats();
+    test_async_jobs();
+    test_result_mask();
+    test_plan_view();
+    test_simulate_sequence();
 
     printf("\n%d / %d tests passed\n", tests_passed, tests_run);
 
@@ -69,15 +69,14 @@ static void test_cargo_increases_bm(void) {
         &ship, 3.0f, disp_no_cargo, ship.length, ship.width);
 
     /* Now add heavy cargo at midship */
+    static const CargoLabel heavy_label = { "Heavy", "standard" };
     Cargo heavy = {0};
-    strcpy(heavy.id, "Heavy");
+    heavy.label = &heavy_label;
     heavy.weight = 5000000.0f; /* 5000 t */
     heavy.dimensions[0] = 20.0f;
     heavy.dimensions[1] = 10.0f;
     heavy.dimensions[2] = 5.0f;
-    heavy.pos_x = 65.0f; /* near midship */
-    heavy.pos_y = 7.5f;
-    heavy.pos_z = 0.0f;
+    CARGO_PLACE(&heavy, 65.0f, 7.5f, 0.0f); /* near midship */
 
     ship.cargo = &heavy;
     ship.cargo_count = 1;
@@ -125,12 +124,108 @@ static void test_check_strength_limits(void) {
     ASSERT(check_strength_limits(&r, &limits) == 0, "exceeds BM sag limit");
 }
 
+/* Reference: every item against every station window */
+static void naive_cargo(const Ship *ship, const float *pos, int n, double *dist) {
+    double dx = pos[1] - pos[0];
+    for (int s = 0; s < n; s++) dist[s] = 0.0;
+    for (int i = 0; i < ship->cargo_count; i++) {
+        const Cargo *c = &ship->cargo[i];
+        if (!CARGO_IS_PLACED(c)) continue;
+        double xs = c->pos_x, xe = c->pos_x + c->dimensions[0];
+        double wt = c->weight / 1000.0 / (xe - xs);
+        for (int s = 0; s < n; s++) {
+            double lo = (s == 0) ? 0.0 : pos[s] - dx / 2.0;
+            double hi = (s == n - 1) ? pos[n - 1] : pos[s] + dx / 2.0;
+            double ov = fmin(hi, xe) - fmax(lo, xs);
+            if (ov > 0) dist[s] += wt * ov / dx;
+        }
+    }
+}
+
+static void test_model_grids(void) {
+    printf("  test_model_grids...\n");
+    Ship ship = make_test_ship();
+    enum { ITEMS = 400 };
+    Cargo *cargo = calloc(ITEMS, sizeof(Cargo));
+    unsigned seed = 12345;
+    for (int i = 0; i < ITEMS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        cargo[i].weight = 5000.0f + (float)(seed % 40000);
+        cargo[i].dimensions[0] = 0.05f + (float)((seed >> 8) % 300) / 10.0f;
+        float room = ship.length - cargo[i].dimensions[0];
+        if (i % 17 == 0) CARGO_UNPLACE(&cargo[i]);
+        else CARGO_PLACE(&cargo[i], room * (float)((seed >> 4) % 1000) / 1000.0f, 0.0f, 0.0f);
+    }
+    cargo[1].pos_x = 140.0f;                  /* overhangs the bow */
+    cargo[1].dimensions[0] = 25.0f;
+    ship.cargo = cargo;
+    ship.cargo_count = ITEMS;
+    float disp = ship.lightship_weight / 1000.0f;
+    for (int i = 0; i < ITEMS; i++) {
+        if (!CARGO_IS_PLACED(&cargo[i])) continue;
+        float inside = fminf(cargo[i].pos_x + cargo[i].dimensions[0], ship.length) - cargo[i].pos_x;
+        disp += cargo[i].weight / 1000.0f * inside / cargo[i].dimensions[0];
+    }
+
+    StrengthModel m;
+    ASSERT(strength_model_init(&m, &ship, 2) == -1, "too few stations");
+    ASSERT(strength_model_init(&m, &ship, LS_MAX_STATIONS + 1) == -1, "too many stations");
+
+    /* The default grid is the fixed one */
+    ASSERT(strength_model_init(&m, &ship, 0) == 0 && m.station_count == LS_NUM_STATIONS,
+           "default grid");
+    LongStrengthResult r = calculate_longitudinal_strength(&ship, 5.0f, 9000.0f,
+                                                           ship.length, ship.width);
+    StrengthSummary sum;
+    float sf[LS_NUM_STATIONS];
+    StrengthProfile prof = { NULL, NULL, sf, NULL };
+    strength_model_solve(&m, 9000.0f, &sum, &prof);
+    ASSERT(memcmp(m.weight_dist, r.weight_dist, sizeof(r.weight_dist)) == 0 &&
+           memcmp(sf, r.shear_force, sizeof(sf)) == 0 &&
+           sum.max_bm_hog == r.max_bm_hog && sum.max_bm_sag == r.max_bm_sag,
+           "model matches fixed-grid result");
+    strength_model_free(&m);
+
+    /* The sweep spreads cargo the way the per-station scan does */
+    const int grids[] = { 21, 101, 401, 2001 };
+    float prev_bm = 0.0f;
+    for (int g = 0; g < 4; g++) {
+        Ship empty = ship;
+        empty.cargo_count = 0;
+        StrengthModel full, bare;
+        ASSERT(strength_model_init(&full, &ship, grids[g]) == 0, "init grid");
+        ASSERT(strength_model_init(&bare, &empty, grids[g]) == 0, "init bare grid");
+
+        double *want = malloc((size_t)grids[g] * sizeof(double));
+        naive_cargo(&ship, full.station_pos, grids[g], want);
+        int bad = 0;
+        for (int s = 0; s < grids[g]; s++) {
+            double got = full.weight_dist[s] - bare.weight_dist[s];
+            if (fabs(got - want[s]) > 1e-3 * (1.0 + fabs(want[s]))) bad++;
+        }
+        ASSERT(bad == 0, "sweep matches per-station distribution");
+        free(want);
+
+        /* Finer grids converge */
+        strength_model_solve(&full, disp, &sum, NULL);
+        float bm = fmaxf(sum.max_bm_hog, sum.max_bm_sag);
+        if (g >= 2) ASSERT(fabsf(bm - prev_bm) < 0.01f * prev_bm, "BM converges with stations");
+        prev_bm = bm;
+
+        strength_model_free(&full);
+        strength_model_free(&bare);
+    }
+    strength_model_free(&m);                 /* double free is harmless */
+    free(cargo);
+}
+
 int main(void) {
     printf("=== Longitudinal Strength Tests ===\n");
 
     test_boundary_conditions();
     test_cargo_increases_bm();
     test_check_strength_limits();
+    test_model_grids();
 
     printf("Longitudinal Strength: %d/%d tests passed\n\n", tests_passed, tests_run);
     return (tests_passed == tests_run) ? 0 : 1;
@@ -0,0 +1,200 @@
+/*
+ * test_optimizer.c - Unit tests for the multi-start / beam-search optimizer
+ */
+
+#include "cargoforge.h"
+#include "placement_3d.h"
+#include "optimizer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+/* Mixed manifest on a ship that cannot take all of it */
+static Ship create_test_ship(int n) {
+    static const char *types[] = { "standard", "standard", "reefer", "fragile", "hazardous" };
+    Ship ship;
+    memset(&ship, 0, sizeof(ship));
+    ship.length = 80.0f;
+    ship.width = 16.0f;
+    ship.max_weight = 20000000.0f;
+    ship.lightship_weight = 3000000.0f;
+    ship.lightship_kg = 5.0f;
+    ship.cargo_capacity = n;
+    ship.cargo_count = n;
+    ship.cargo = calloc((size_t)n, sizeof(Cargo));
+    ship.quiet = 1;
+
+    unsigned seed = 777u;
+    for (int i = 0; i < n; i++) {
+        Cargo *c = &ship.cargo[i];
+        char id[16];
+        snprintf(id, sizeof(id), "C%03d", i);
+        seed = seed * 1103515245u + 12345u;
+        c->dimensions[0] = 1.0f + (float)((seed >> 8) % 100) / 10.0f;
+        seed = seed * 1103515245u + 12345u;
+        c->dimensions[1] = 1.0f + (float)((seed >> 8) % 30) / 10.0f;
+        seed = seed * 1103515245u + 12345u;
+        c->dimensions[2] = 0.5f + (float)((seed >> 8) % 30) / 10.0f;
+        c->weight = 1000.0f + (float)(seed % 20000);
+        const char *type = types[seed % 5];
+        assert(cargo_set_label(&ship, c, id, strlen(id), type, strlen(type)) == 0);
+        CARGO_UNPLACE(c);
+    }
+    return ship;
+}
+
+static int placed_count(const Ship *ship) {
+    int n = 0;
+    for (int i = 0; i < ship->cargo_count; i++)
+        if (CARGO_IS_PLACED(&ship->cargo[i])) n++;
+    return n;
+}
+
+static int id_cmp(const void *a, const void *b) {
+    return strcmp(CARGO_ID((const Cargo *)a), CARGO_ID((const Cargo *)b));
+}
+
+/* Test 1: Never worse than the plain FFD pass */
+void test_not_worse_than_ffd(void) {
+    printf("Test 1: Multistart >= FFD placed count... ");
+
+    Ship ffd = create_test_ship(400);
+    place_cargo_3d(&ffd);
+
+    Ship ms = create_test_ship(400);
+    OptimizerOptions opts;
+    OptimizerStats stats;
+    optimizer_options_init(&opts);
+    opts.threads = 1;
+    assert(optimize_multi_start(&ms, &opts, &stats) == 0);
+
+    assert(stats.best_placed == placed_count(&ms));
+    assert(placed_count(&ms) >= placed_count(&ffd));
+    assert(stats.rounds == opts.max_rounds);
+    assert(stats.attempts == SORT_KEY_COUNT + opts.random_starts * opts.max_rounds);
+    assert(!stats.budget_exhausted);
+
+    ship_cleanup(&ffd);
+    ship_cleanup(&ms);
+    printf("PASS\n");
+}
+
+/* Test 2: Result is a permutation of the manifest */
+void test_result_is_permutation(void) {
+    printf("Test 2: Winning plan keeps every item... ");
+
+    Ship ship = create_test_ship(200);
+    assert(optimize_multi_start(&ship, NULL, NULL) == 0);
+    assert(ship.cargo_count == 200);
+
+    qsort(ship.cargo, 200, sizeof(Cargo), id_cmp);
+    for (int i = 0; i < 200; i++) {
+        char expect[32];
+        snprintf(expect, sizeof(expect), "C%03d", i);
+        assert(strcmp(CARGO_ID(&ship.cargo[i]), expect) == 0);
+    }
+
+    ship_cleanup(&ship);
+    printf("PASS\n");
+}
+
+/* Test 3: Same plan for any thread count */
+void test_deterministic_across_threads(void) {
+    printf("Test 3: Deterministic across thread counts... ");
+
+    Ship a = create_test_ship(300);
+    Ship b = create_test_ship(300);
+    OptimizerOptions opts;
+    optimizer_options_init(&opts);
+    opts.seed = 42;
+
+    opts.threads = 1;
+    assert(optimize_multi_start(&a, &opts, NULL) == 0);
+    opts.threads = 4;
+    assert(optimize_multi_start(&b, &opts, NULL) == 0);
+
+    for (int i = 0; i < 300; i++) {
+        assert(strcmp(CARGO_ID(&a.cargo[i]), CARGO_ID(&b.cargo[i])) == 0);
+        assert(a.cargo[i].pos_x == b.cargo[i].pos_x);
+        assert(a.cargo[i].pos_y == b.cargo[i].pos_y);
+        assert(a.cargo[i].pos_z == b.cargo[i].pos_z);
+    }
+
+    ship_cleanup(&a);
+    ship_cleanup(&b);
+    printf("PASS\n");
+}
+
+/* Test 4: A tiny budget still returns the baseline plan */
+void test_time_budget(void) {
+    printf("Test 4: Time budget stops the search... ");
+
+    Ship ship = create_test_ship(400);
+    OptimizerOptions opts;
+    OptimizerStats stats;
+    optimizer_options_init(&opts);
+    opts.threads = 1;
+    opts.max_rounds = 1000;
+    opts.time_budget_ms = 1;
+
+    assert(optimize_multi_start(&ship, &opts, &stats) == 0);
+    assert(stats.budget_exhausted);
+    assert(stats.attempts >= 1);
+    assert(stats.rounds < 1000);
+    assert(placed_count(&ship) > 0);
+
+    ship_cleanup(&ship);
+    printf("PASS\n");
+}
+
+/* Test 5: Sort key names */
+void test_sort_key_names(void) {
+    printf("Test 5: Sort key names... ");
+    assert(strcmp(sort_key_name(SORT_VOLUME), "volume") == 0);
+    assert(strcmp(sort_key_name(SORT_DG_FIRST), "dg-first") == 0);
+    assert(strcmp(sort_key_name(SORT_PERTURBED), "perturbed") == 0);
+    assert(strcmp(sort_key_name(99), "unknown") == 0);
+    printf("PASS\n");
+}
+
+/* Test 6: An overweight plan never beats a feasible one */
+void test_overweight_ranks_last(void) {
+    printf("Test 6: Overweight plans rank last... ");
+
+    /* Cap displacement at the FFD plan's, so heavier plans are overweight */
+    Ship ffd = create_test_ship(400);
+    place_cargo_3d(&ffd);
+    AnalysisResult base = perform_analysis(&ffd);
+    float cap = ffd.lightship_weight + base.total_cargo_weight_kg;
+
+    Ship ms = create_test_ship(400);
+    ms.max_weight = cap;
+    OptimizerOptions opts;
+    optimizer_options_init(&opts);
+    opts.threads = 1;
+    assert(optimize_multi_start(&ms, &opts, NULL) == 0);
+
+    AnalysisResult r = perform_analysis(&ms);
+    assert(!isnan(r.gm));
+    assert(ms.lightship_weight + r.total_cargo_weight_kg <= cap);
+
+    ship_cleanup(&ffd);
+    ship_cleanup(&ms);
+    printf("PASS\n");
+}
+
+int main(void) {
+    printf("Running optimizer tests...\n\n");
+
+    test_not_worse_than_ffd();
+    test_result_is_permutation();
+    test_deterministic_across_threads();
+    test_time_budget();
+    test_sort_key_names();
+    test_overweight_ranks_last();
+
+    printf("\nAll optimizer tests passed!\n");
+    return 0;
+}
@@ -3,7 +3,11 @@
  */
 #include <assert.h>    // For the assert() macro
 #include <stdio.h>
+#include <string.h>
 #include "cargoforge.h"
+#include "holds.h"
+#include "imdg.h"
+#include "longitudinal_strength.h"
 
 int main() {
     printf("--- Running Parser Tests ---\n");
@@ -37,7 +41,7 @@ int main() {
     {
         Ship s = {0};
         assert(parse_ship_config("examples/sample_ship.cfg", &s) == 0);
-        const char *path = "build/_bad_cargo_test.txt";
+        const char *path = "_bad_cargo_test.txt";
         FILE *f = fopen(path, "w");
         assert(f != NULL);
         fputs("GoodItem 10 5x5x5 standard\nBadItem notanumber 5x5x5 reefer\n", f);
@@ -49,6 +53,208 @@ int main() {
     printf(" OK\n");
 
 
+    // Test 4: hold= lines become the ship's compartment list.
+    printf("Testing hold definitions in sample_ship_holds.cfg...");
+    {
+        Ship s = {0};
+        assert(parse_ship_config("examples/sample_ship_holds.cfg", &s) == 0);
+        const HoldConfig *hc = s.holds;
+        assert(hc != NULL && hc->count == 9);
+        assert(strcmp(hc->holds[0].name, "Hold7") == 0);
+        assert(hc->holds[0].z == -10.0f && hc->holds[0].height == 10.0f);
+        assert(hc->holds[0].max_weight == 5000.0f * 1000.0f);
+        assert(hc->holds[0].flags == 0);
+        assert(hc->holds[1].flags == HOLD_FLAG_REEFER);
+        assert(hc->holds[7].flags == (HOLD_FLAG_DECK | HOLD_FLAG_REEFER));
+        assert(hc->holds[8].flags == HOLD_FLAG_DECK);
+        ship_cleanup(&s);
+        assert(s.holds == NULL);
+    }
+    printf(" OK\n");
+
+    // Test 5: malformed hold lines reject the whole config.
+    printf("Testing rejection of malformed hold definitions...");
+    {
+        const char *bad[] = {
+            "hold=H1,0,0,-8,20,10\n",                 // too few fields
+            "hold=H1,0,0,-8,20,10,8,-5\n",            // negative capacity
+            "hold=H1,0,0,-8,20,10,8,500,bilge\n",     // unknown flag
+        };
+        for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+            const char *path = "_bad_hold_test.cfg";
+            FILE *f = fopen(path, "w");
+            assert(f != NULL);
+            fputs("length_m=100\nwidth_m=20\nmax_weight_tonnes=1000\n", f);
+            fputs(bad[i], f);
+            fclose(f);
+            Ship s = {0};
+            assert(parse_ship_config(path, &s) == -1);
+            assert(s.holds == NULL);
+            remove(path);
+        }
+    }
+    printf(" OK\n");
+
+    // Test 6: buffers parse in place, honour len, and need no terminator.
+    printf("Testing in-memory buffer parsing...");
+    {
+        const char cfg[] = "length_m=120\r\n# comment\nwidth_m=24\nmax_weight_tonnes=9000\nlength_m=999";
+        Ship s = {0};
+        assert(parse_ship_config_buffer(cfg, strlen(cfg) - 13, &s) == 0); // stop before last line
+        assert(s.length == 120.0f && s.width == 24.0f && s.max_weight == 9000000.0f);
+
+        char manifest[] = "A 10 5x4x3 standard\n\nB 2 1x1x1 hazardous DG:3.1:UN1203:A:F-E\nC 1 1x1x1 standardXXXX";
+        size_t len = strlen(manifest) - 4;
+        manifest[len] = '!'; // not NUL-terminated at len
+        assert(parse_cargo_list_buffer(manifest, len, &s) == 0);
+        assert(s.cargo_count == 3);
+        assert(strcmp(CARGO_ID(&s.cargo[0]), "A") == 0 && s.cargo[0].weight == 10000.0f);
+        assert(s.cargo[0].dimensions[2] == 3.0f);
+        assert(s.cargo[1].dg != NULL && strcmp(CARGO_TYPE(&s.cargo[2]), "standard") == 0);
+        assert(s.cargo[1].flags == CARGO_HAZARDOUS && s.cargo[2].flags == 0);
+        assert(!CARGO_IS_PLACED(&s.cargo[0]) && s.cargo[0].pos_x == -1.0f);
+        assert(s.cargo[1].dg_index == imdg_class_index(3, 1) + 1 && s.cargo[0].dg_index == 0);
+        ship_cleanup(&s);
+
+        assert(parse_cargo_list_buffer("", 0, &s) == 0 && s.cargo_count == 0);
+        ship_cleanup(&s);
+        assert(parse_cargo_list_buffer("X 1 2x2 standard\n", 17, &s) == -1); // missing dim
+        assert(s.cargo == NULL);
+    }
+    printf(" OK\n");
+
+    // Test 7: streaming parse across chunk boundaries matches the buffer parse.
+    printf("Testing chunked streaming parse...");
+    {
+        FILE *f = tmpfile();
+        assert(f != NULL);
+        int n = 60000;                       // ~2.4 MB: several read chunks
+        for (int i = 0; i < n; i++) {
+            if (i % 7 == 0)
+                fprintf(f, "DG%06d 1.5 2x1x1 hazardous DG:%d.1:UN%04d:U:F-E\n", i, 1 + i % 9, i % 10000);
+            else
+                fprintf(f, "BOX%06d %d.5 %dx2.4x2.6 standard\n", i, 1 + i % 40, 1 + i % 12);
+        }
+        fputs("# trailing comment\nLAST 3 1x1x1 standard", f);  // no final newline
+        rewind(f);
+
+        Ship s = {0};
+        assert(parse_cargo_stream(f, &s) == 0);
+        assert(s.cargo_count == n + 1);
+        assert(s.cargo_capacity >= s.cargo_count);
+        assert(strcmp(CARGO_ID(&s.cargo[n]), "LAST") == 0);
+        for (int i = 0; i < n; i++) {
+            const Cargo *c = &s.cargo[i];
+            if (i % 7 == 0) {
+                const DGInfo *dg = (const DGInfo *)c->dg;
+                assert(dg != NULL && dg->dg_class == 1 + i % 9);
+                assert(dg->stowage == STOW_UNDER_DECK);
+                assert(imdg_cargo_class(c) == imdg_class_index(1 + i % 9, 1));
+                assert(c->flags == CARGO_HAZARDOUS);
+            } else {
+                assert(c->dg == NULL && c->dimensions[0] == (float)(1 + i % 12));
+                assert(c->flags == 0);
+            }
+        }
+        ship_cleanup(&s);
+        assert(s.dg_pool == NULL && s.label_pool == NULL);
+
+        fclose(f);
+
+        // A single line longer than the read chunk still parses
+        f = tmpfile();
+        assert(f != NULL);
+        fputs("LONG 1 1x1x1 standard ", f);
+        for (int i = 0; i < (1 << 20) + 100; i++) fputc(' ', f);
+        fputs("DG:3:UN1203:A:F-E\n", f);
+        rewind(f);
+        assert(parse_cargo_stream(f, &s) == 0);
+        assert(s.cargo_count == 1 && strcmp(CARGO_ID(&s.cargo[0]), "LONG") == 0);
+        assert(s.cargo[0].dg != NULL);
+        ship_cleanup(&s);
+        fclose(f);
+    }
+    printf(" OK\n");
+
+    // Test 8: a mapped file parses exactly like the same bytes from memory.
+    printf("Testing memory-mapped manifest parse...");
+    {
+        const char *path = "_mapped_cargo_test.txt";
+        FILE *f = fopen(path, "w");
+        assert(f != NULL);
+        int n = 5000;                        // ~200 KB: above the mmap threshold
+        for (int i = 0; i < n; i++) {
+            if (i % 5 == 0)
+                fprintf(f, "H%05d %d.25 1.5x2x0.75 hazardous DG:8:UN%04d:A:F-A,S-B\n", i, 2 + i % 30, 1000 + i);
+            else
+                fprintf(f, "B%05d\t%de-1 %d.125x2.44x2.59 reefer\r\n", i, 10 + i % 90, 1 + i % 12);
+        }
+        fputs("TAIL 1 1x1x1 standard", f);  // no final newline
+        long size = ftell(f);
+        fclose(f);
+
+        char *text = malloc((size_t)size);
+        f = fopen(path, "rb");
+        assert(text != NULL && f != NULL);
+        assert(fread(text, 1, (size_t)size, f) == (size_t)size);
+        fclose(f);
+
+        Ship a = {0}, b = {0};
+        assert(parse_cargo_list_mapped(path, &a) == 0);
+        assert(parse_cargo_list_buffer(text, (size_t)size, &b) == 0);
+        assert(a.cargo_count == n + 1 && b.cargo_count == n + 1);
+        for (int i = 0; i <= n; i++) {
+            const Cargo *x = &a.cargo[i], *y = &b.cargo[i];
+            assert(strcmp(CARGO_ID(x), CARGO_ID(y)) == 0 && strcmp(CARGO_TYPE(x), CARGO_TYPE(y)) == 0);
+            assert(x->flags == y->flags);
+            assert(x->weight == y->weight);
+            assert(memcmp(x->dimensions, y->dimensions, sizeof(x->dimensions)) == 0);
+            assert((x->dg == NULL) == (y->dg == NULL));
+        }
+        assert(a.cargo[1].weight == 1100.0f);      // 11e-1 t, exactly as strtof
+        assert(a.cargo[1].dimensions[0] == 2.125f);
+        assert(a.cargo[1].flags == CARGO_REEFER && a.cargo[0].flags == CARGO_HAZARDOUS);
+        ship_cleanup(&a);
+        ship_cleanup(&b);
+        free(text);
+
+        // Unparsable numbers still fail on the fast path's fallback
+        f = fopen(path, "w");
+        assert(f != NULL);
+        for (int i = 0; i < 4000; i++) fprintf(f, "OK%04d 1 1x1x1 standard\n", i);
+        fputs("BAD 1.5.5 1x1x1 standard\n", f);
+        fclose(f);
+        assert(parse_cargo_list(path, &a) == -1);
+        assert(a.cargo == NULL && a.cargo_count == 0);
+        remove(path);
+    }
+    printf(" OK\n");
+
+    // Test 9: the strength station grid is configurable and validated.
+    printf("Testing strength_stations...");
+    {
+        const char base[] = "length_m=100\nwidth_m=20\nmax_weight_tonnes=1000\npermissible_sf_tonnes=500\n";
+        char cfg[256];
+        Ship s = {0};
+        snprintf(cfg, sizeof(cfg), "%sstrength_stations=201\n", base);
+        assert(parse_ship_config_buffer(cfg, strlen(cfg), &s) == 0);
+        assert(((StrengthLimits *)s.strength_limits)->stations == 201);
+        ship_cleanup(&s);
+
+        assert(parse_ship_config_buffer(base, strlen(base), &s) == 0);
+        assert(((StrengthLimits *)s.strength_limits)->stations == 0);
+        ship_cleanup(&s);
+
+        const char *bad[] = { "2", "10.5", "5000" };
+        for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+            Ship b = {0};
+            snprintf(cfg, sizeof(cfg), "%sstrength_stations=%s\n", base, bad[i]);
+            assert(parse_ship_config_buffer(cfg, strlen(cfg), &b) == -1);
+            ship_cleanup(&b);
+        }
+    }
+    printf(" OK\n");
+
     printf("--- All Parser Tests Passed ---\n");
     return 0;
 }
\ No newline at end of file
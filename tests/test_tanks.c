@@ -77,55 +77,52 @@ static void test_fsm_empty_tank(void) {
 
 static void test_total_fsm(void) {
     printf("  test_total_fsm...\n");
-    TankConfig config;
-    memset(&config, 0, sizeof(config));
-    config.count = 2;
+    TankConfig config = {0};
 
     /* Tank 1: partially filled */
-    config.tanks[0] = (Tank){
+    tank_config_add(&config, &(Tank){
         .id = "T1", .length = 10.0f, .breadth = 6.0f, .height = 5.0f,
         .fill_fraction = 0.5f, .density = 1.025f
-    };
+    });
     /* Tank 2: partially filled */
-    config.tanks[1] = (Tank){
+    tank_config_add(&config, &(Tank){
         .id = "T2", .length = 8.0f, .breadth = 4.0f, .height = 4.0f,
         .fill_fraction = 0.3f, .density = 0.95f
-    };
+    });
 
     /* T1 FSM = 1.025 * 10 * 216 / 12 = 184.5 */
     /* T2 FSM = 0.95 * 8 * 64 / 12 = 40.533 */
     float total = calculate_total_fsm(&config);
     ASSERT_NEAR(total, 225.03f, 0.1f, "total FSM of two tanks");
+    tank_config_free(&config);
 }
 
 static void test_virtual_kg_rise(void) {
     printf("  test_virtual_kg_rise...\n");
-    TankConfig config;
-    memset(&config, 0, sizeof(config));
-    config.count = 1;
-    config.tanks[0] = (Tank){
+    TankConfig config = {0};
+    tank_config_add(&config, &(Tank){
         .id = "T1", .length = 10.0f, .breadth = 6.0f, .height = 5.0f,
         .fill_fraction = 0.5f, .density = 1.025f
-    };
+    });
 
     /* GG' = FSM / displacement = 184.5 / 5000 = 0.0369 */
     float gg = calculate_virtual_kg_rise(&config, 5000.0f);
     ASSERT_NEAR(gg, 0.0369f, 0.001f, "virtual KG rise");
+    tank_config_free(&config);
 }
 
 static void test_tank_weight(void) {
     printf("  test_tank_weight...\n");
-    TankConfig config;
-    memset(&config, 0, sizeof(config));
-    config.count = 1;
-    config.tanks[0] = (Tank){
+    TankConfig config = {0};
+    tank_config_add(&config, &(Tank){
         .id = "T1", .length = 10.0f, .breadth = 6.0f, .height = 5.0f,
         .fill_fraction = 0.5f, .density = 1.025f
-    };
+    });
 
     /* Weight = 10 * 6 * 5 * 0.5 * 1.025 = 153.75 t */
     float weight = calculate_tank_weight(&config);
     ASSERT_NEAR(weight, 153.75f, 0.01f, "tank weight");
+    tank_config_free(&config);
 }
 
 static void test_parse_tank_csv(void) {
@@ -144,6 +141,152 @@ static void test_parse_tank_csv(void) {
     ASSERT(strcmp(config.tanks[0].id, "BallastFP") == 0, "first tank id");
     ASSERT_NEAR(config.tanks[0].fill_fraction, 0.5f, 0.01f, "fill fraction");
     ASSERT_NEAR(config.tanks[1].density, 0.95f, 0.01f, "fuel oil density");
+    tank_config_free(&config);
+}
+
+static void test_many_tanks(void) {
+    printf("  test_many_tanks...\n");
+    const char *path = "/tmp/test_tanks_many.csv";
+    FILE *fp = fopen(path, "w");
+    for (int i = 0; i < 180; i++)
+        fprintf(fp, "WB%03d,6.0,4.0,3.0,%d.0,0.0,0.0,0.40,1.025\n", i, i);
+    fclose(fp);
+
+    TankConfig config;
+    ASSERT(parse_tank_config(path, &config) == 0, "parse returns 0");
+    ASSERT(config.count == 180, "no cap on the number of tanks");
+    ASSERT(strcmp(config.tanks[179].id, "WB179") == 0, "last tank kept");
+    /* 180 * 6 * 4 * 3 * 0.4 * 1.025 = 5313.6 t */
+    ASSERT_NEAR(calculate_tank_weight(&config), 5313.6f, 0.5f, "weight of all tanks");
+    tank_config_free(&config);
+    remove(path);
+}
+
+/* A wedge-shaped tank: 10 m long, breadth growing from 0 to 6 m over 3 m */
+static void wedge_tank(Tank *t) {
+    memset(t, 0, sizeof(*t));
+    strcpy(t->id, "Wedge");
+    t->length = 10.0f;
+    t->breadth = 6.0f;
+    t->height = 3.0f;
+    t->pos_z = 1.0f;
+    t->density = 1.0f;
+    for (int k = 0; k <= 3; k++) {
+        float h = (float)k, b = 2.0f * h;
+        TankSoundingPoint p = {
+            h, 10.0f * b * h / 2.0f, 1.0f + 2.0f * h / 3.0f, 10.0f * b * b * b / 12.0f
+        };
+        tank_add_sounding(t, &p);
+    }
+}
+
+static void test_sounding_table(void) {
+    printf("  test_sounding_table...\n");
+    Tank t;
+    wedge_tank(&t);
+    ASSERT(t.table_count == 4, "4 sounding points");
+    ASSERT_NEAR(tank_capacity(&t), 90.0f, 0.001f, "capacity from the table");
+
+    TankSoundingPoint back = { 1.5f, 10.0f, 2.0f, 1.0f };
+    ASSERT(tank_add_sounding(&t, &back) != 0, "out-of-order sounding rejected");
+    TankSoundingPoint shrink = { 4.0f, 80.0f, 3.0f, 1.0f };
+    ASSERT(tank_add_sounding(&t, &shrink) != 0, "falling volume rejected");
+
+    /* Sounding 2 m holds 40 m3 of 90: fill 4/9, contents straight from the row */
+    float f = tank_fill_at_sounding(&t, 2.0f);
+    ASSERT_NEAR(f, 40.0f / 90.0f, 1e-5f, "fill at a table row");
+    ASSERT_NEAR(tank_fill_at_ullage(&t, 1.0f), f, 1e-5f, "ullage is height - sounding");
+    ASSERT_NEAR(tank_fill_at_sounding(&t, 9.0f), 1.0f, 1e-6f, "clamped to full");
+    ASSERT_NEAR(tank_fill_at_sounding(&t, -1.0f), 0.0f, 1e-6f, "clamped to empty");
+
+    TankTotals c;
+    tank_contents(&t, f, &c);
+    ASSERT_NEAR(c.weight_t, 40.0f, 1e-3f, "weight from table volume");
+    ASSERT_NEAR(c.vmoment_t, 40.0f * (1.0f + 4.0f / 3.0f), 1e-3f, "VCG from table");
+    ASSERT_NEAR(c.fsm, 10.0f * 64.0f / 12.0f, 1e-3f, "FSM from table inertia");
+
+    /* Between rows the VCG and inertia are interpolated by volume:
+     * 25 m3 is halfway from 10 to 40 m3 (the 1 m and 2 m rows). */
+    tank_contents(&t, 25.0f / 90.0f, &c);
+    ASSERT_NEAR(c.weight_t, 25.0f, 1e-3f, "weight between rows");
+    float vcg = (5.0f / 3.0f) + 0.5f * (2.0f / 3.0f);
+    ASSERT_NEAR(c.vmoment_t, 25.0f * vcg, 1e-3f, "VCG between rows");
+    ASSERT_NEAR(c.fsm, 0.5f * (10.0f * 8.0f / 12.0f + 10.0f * 64.0f / 12.0f), 1e-3f,
+                "inertia between rows");
+
+    t.fill_fraction = 1.0f;
+    ASSERT_NEAR(calculate_free_surface_moment(&t), 0.0f, 1e-6f, "full tabled tank has no FSM");
+    free(t.table);
+}
+
+static void test_parse_sounding_csv(void) {
+    printf("  test_parse_sounding_csv...\n");
+    const char *path = "/tmp/test_tanks_sounding.csv";
+    FILE *fp = fopen(path, "w");
+    fprintf(fp, "Box,10.0,6.0,5.0,30.0,0.0,0.0,0.50,1.025\n");
+    fprintf(fp, "Hopper,10.0,6.0,3.0,60.0,0.0,1.0,0.50,1.000\n");
+    fprintf(fp, "sounding,Hopper,0.0,0.0,1.0,0.0\n");
+    fprintf(fp, "sounding,Hopper,3.0,90.0,3.0,180.0\n");
+    fclose(fp);
+
+    TankConfig config;
+    ASSERT(parse_tank_config(path, &config) == 0, "parse returns 0");
+    ASSERT(config.count == 2, "sounding rows are not tanks");
+    ASSERT(config.tanks[0].table == NULL, "box tank has no table");
+    ASSERT(config.tanks[1].table_count == 2, "hopper table parsed");
+    ASSERT_NEAR(calculate_tank_weight(&config), 153.75f + 45.0f, 0.01f, "weights");
+
+    TankConfig copy;
+    ASSERT(tank_config_copy(&copy, &config) == 0, "copy");
+    ASSERT(copy.tanks[1].table != config.tanks[1].table, "table copied, not shared");
+    ASSERT_NEAR(calculate_total_fsm(&copy), calculate_total_fsm(&config), 1e-6f, "copy agrees");
+    tank_config_free(&copy);
+    tank_config_free(&config);
+
+    fp = fopen(path, "w");
+    fprintf(fp, "Hopper,10.0,6.0,3.0,60.0,0.0,1.0,0.50,1.000\n");
+    fprintf(fp, "sounding,Nowhere,0.0,0.0,1.0,0.0\n");
+    fclose(fp);
+    ASSERT(parse_tank_config(path, &config) != 0, "unknown tank rejected");
+    ASSERT(config.count == 0 && config.tanks == NULL, "left empty on error");
+
+    fp = fopen(path, "w");
+    fprintf(fp, "Hopper,10.0,6.0,3.0,60.0,0.0,1.0,0.50,1.000\n");
+    fprintf(fp, "sounding,Hopper,0.0,0.0,1.0,0.0\n");
+    fclose(fp);
+    ASSERT(parse_tank_config(path, &config) != 0, "single-point table rejected");
+    remove(path);
+}
+
+static void test_columns_match_totals(void) {
+    printf("  test_columns_match_totals...\n");
+    TankConfig config = {0};
+    for (int i = 0; i < 120; i++) {
+        Tank t = { .length = 4.0f + (float)(i % 7), .breadth = 3.0f + (float)(i % 5),
+                   .height = 2.0f + (float)(i % 3), .pos_z = 0.5f * (float)(i % 4),
+                   .fill_fraction = (float)(i % 11) / 10.0f, .density = 1.025f };
+        if (i % 9 == 0) wedge_tank(&t);
+        t.fill_fraction = (float)(i % 11) / 10.0f;
+        snprintf(t.id, sizeof(t.id), "T%d", i);
+        tank_config_add(&config, &t);
+    }
+
+    TankColumns cols;
+    ASSERT(tank_columns_init(&cols, &config) == 0, "columns built");
+    float fill[120];
+    for (int i = 0; i < 120; i++) fill[i] = config.tanks[i].fill_fraction;
+
+    TankTotals a, b;
+    tank_config_totals(&config, &a);
+    tank_columns_sum(&cols, fill, &b);
+    ASSERT(a.weight_t == b.weight_t && a.vmoment_t == b.vmoment_t && a.fsm == b.fsm,
+           "column pass is bit-identical to the row pass");
+    ASSERT(a.weight_t == calculate_tank_weight(&config) &&
+           a.vmoment_t == calculate_tank_vertical_moment(&config) &&
+           a.fsm == calculate_total_fsm(&config), "fused pass matches each sum");
+
+    tank_columns_free(&cols);
+    tank_config_free(&config);
 }
 
 int main(void) {
@@ -156,6 +299,10 @@ int main(void) {
     test_virtual_kg_rise();
     test_tank_weight();
     test_parse_tank_csv();
+    test_many_tanks();
+    test_sounding_table();
+    test_parse_sounding_csv();
+    test_columns_match_totals();
 
     printf("Tanks: %d/%d tests passed\n\n", tests_passed, tests_run);
     return (tests_passed == tests_run) ? 0 : 1;
@@ -0,0 +1,153 @@
+/*
+ * test_thread_pool.c - Tests for the worker thread pool
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "thread_pool.h"
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define ASSERT(cond, msg) do { \
+    tests_run++; \
+    if (!(cond)) { \
+        fprintf(stderr, "  FAIL: %s (line %d)\n", msg, __LINE__); \
+    } else { \
+        tests_passed++; \
+    } \
+} while(0)
+
+/* --- Helpers --- */
+
+static void square_index(void *ctx, int i) {
+    int *out = ctx;
+    out[i] = i * i;
+}
+
+typedef struct {
+    pthread_mutex_t lock;
+    int count;
+} Counter;
+
+static void bump_counter(void *arg) {
+    Counter *c = arg;
+    pthread_mutex_lock(&c->lock);
+    c->count++;
+    pthread_mutex_unlock(&c->lock);
+}
+
+typedef struct {
+    ThreadPool *pool;
+    int results[8][64];
+} NestedCtx;
+
+static void nested_row(void *ctx, int row) {
+    NestedCtx *n = ctx;
+    thread_pool_parallel_for(n->pool, 64, square_index, n->results[row]);
+}
+
+/* --- Tests --- */
+
+static void test_cpu_count(void) {
+    printf("  test_cpu_count...\n");
+    ASSERT(thread_pool_cpu_count() >= 1, "at least one CPU");
+}
+
+static void test_create_destroy(void) {
+    printf("  test_create_destroy...\n");
+    ThreadPool *pool = thread_pool_create(3);
+    ASSERT(pool != NULL, "pool created");
+    ASSERT(thread_pool_size(pool) == 3, "3 workers");
+    thread_pool_destroy(pool);
+
+    pool = thread_pool_create(0);
+    ASSERT(pool != NULL, "default-sized pool created");
+    ASSERT(thread_pool_size(pool) == thread_pool_cpu_count(), "one worker per CPU");
+    thread_pool_destroy(pool);
+
+    thread_pool_destroy(NULL);
+    ASSERT(thread_pool_size(NULL) == 0, "NULL pool has no workers");
+}
+
+static void test_parallel_for_covers_range(void) {
+    printf("  test_parallel_for_covers_range...\n");
+    ThreadPool *pool = thread_pool_create(4);
+    int out[1000];
+    memset(out, -1, sizeof(out));
+
+    thread_pool_parallel_for(pool, 1000, square_index, out);
+
+    int ok = 1;
+    for (int i = 0; i < 1000; i++)
+        if (out[i] != i * i) ok = 0;
+    ASSERT(ok, "every index visited exactly once");
+
+    thread_pool_destroy(pool);
+}
+
+static void test_parallel_for_serial_fallback(void) {
+    printf("  test_parallel_for_serial_fallback...\n");
+    int out[16];
+    memset(out, -1, sizeof(out));
+    thread_pool_parallel_for(NULL, 16, square_index, out);
+    ASSERT(out[0] == 0 && out[15] == 225, "NULL pool runs serially");
+
+    thread_pool_parallel_for(NULL, 0, square_index, out);
+    ASSERT(out[1] == 1, "empty range is a no-op");
+}
+
+static void test_parallel_for_nested(void) {
+    printf("  test_parallel_for_nested...\n");
+    /* Fewer workers than outer rows: inner loops must not wait on helpers
+     * queued behind the busy workers. */
+    ThreadPool *pool = thread_pool_create(2);
+    NestedCtx *n = calloc(1, sizeof(NestedCtx));
+    n->pool = pool;
+
+    thread_pool_parallel_for(pool, 8, nested_row, n);
+
+    int ok = 1;
+    for (int r = 0; r < 8; r++)
+        for (int i = 0; i < 64; i++)
+            if (n->results[r][i] != i * i) ok = 0;
+    ASSERT(ok, "nested parallel_for completes");
+
+    free(n);
+    thread_pool_destroy(pool);
+}
+
+static void test_submit_drains_on_destroy(void) {
+    printf("  test_submit_drains_on_destroy...\n");
+    ThreadPool *pool = thread_pool_create(2);
+    Counter c;
+    pthread_mutex_init(&c.lock, NULL);
+    c.count = 0;
+
+    int rc = 0;
+    for (int i = 0; i < 500; i++)
+        rc |= thread_pool_submit(pool, bump_counter, &c);
+    ASSERT(rc == 0, "all submits accepted");
+
+    thread_pool_destroy(pool);
+    ASSERT(c.count == 500, "queued tasks run before destroy returns");
+    pthread_mutex_destroy(&c.lock);
+
+    ASSERT(thread_pool_submit(NULL, bump_counter, &c) == -1, "submit to NULL pool fails");
+}
+
+int main(void) {
+    printf("=== Thread Pool Tests ===\n");
+
+    test_cpu_count();
+    test_create_destroy();
+    test_parallel_for_covers_range();
+    test_parallel_for_serial_fallback();
+    test_parallel_for_nested();
+    test_submit_drains_on_destroy();
+
+    printf("Thread pool: %d/%d tests passed\n\n", tests_passed, tests_run);
+    return (tests_passed == tests_run) ? 0 : 1;
+}
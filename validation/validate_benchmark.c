@@ -74,21 +74,30 @@ static void check_true(const char *param, int condition) {
 /* HELPER: Add manually positioned cargo                              */
 /* ------------------------------------------------------------------ */
 
+/* Labels for hand-built cargo; the ships here are set up without a pool */
+static CargoLabel labels[64];
+static int label_count = 0;
+
+static const CargoLabel *make_label(const char *id, const char *type) {
+    if (label_count >= (int)(sizeof(labels) / sizeof(labels[0]))) return NULL;
+    CargoLabel *l = &labels[label_count++];
+    strncpy(l->id, id, sizeof(l->id) - 1);
+    strncpy(l->type, type, sizeof(l->type) - 1);
+    return l;
+}
+
 static void add_cargo(Ship *ship, const char *id, float weight_t,
                       float l, float w, float h,
                       float px, float py, float pz) {
     if (ship->cargo_count >= ship->cargo_capacity) return;
     Cargo *c = &ship->cargo[ship->cargo_count];
     memset(c, 0, sizeof(*c));
-    strncpy(c->id, id, sizeof(c->id) - 1);
-    strcpy(c->type, "standard");
+    c->label = make_label(id, "standard");
     c->weight = weight_t * 1000.0f;
     c->dimensions[0] = l;
     c->dimensions[1] = w;
     c->dimensions[2] = h;
-    c->pos_x = px;
-    c->pos_y = py;
-    c->pos_z = pz;
+    CARGO_PLACE(c, px, py, pz);
     ship->cargo_count++;
 }
 
@@ -205,14 +214,12 @@ static void test_longitudinal_strength(void) {
 
     Cargo cargo[1];
     memset(cargo, 0, sizeof(cargo));
-    strcpy(cargo[0].id, "CENTER");
+    cargo[0].label = make_label("CENTER", "standard");
     cargo[0].weight = 4000000.0f;
     cargo[0].dimensions[0] = 20.0f;
     cargo[0].dimensions[1] = 16.0f;
     cargo[0].dimensions[2] = 5.0f;
-    cargo[0].pos_x = 46.0f;
-    cargo[0].pos_y = 1.3f;
-    cargo[0].pos_z = 0.0f;
+    CARGO_PLACE(&cargo[0], 46.0f, 1.3f, 0.0f);
     ship.cargo = cargo;
     ship.cargo_count = 1;
     ship.cargo_capacity = 1;
@@ -543,28 +550,27 @@ static void test_imdg(void) {
     ship.cargo_count = 3;
     ship.cargo_capacity = 3;
 
-    strcpy(cargo[0].id, "GENERAL");
+    cargo[0].label = make_label("GENERAL", "standard");
     cargo[0].weight = 500000.0f;
     cargo[0].dimensions[0] = 10.0f; cargo[0].dimensions[1] = 5.0f; cargo[0].dimensions[2] = 3.0f;
-    cargo[0].pos_x = 50.0f; cargo[0].pos_y = 5.0f; cargo[0].pos_z = 0.0f;
-    strcpy(cargo[0].type, "standard");
+    CARGO_PLACE(&cargo[0], 50.0f, 5.0f, 0.0f);
 
     static DGInfo dg1 = { .dg_class = 3, .dg_division = 0,
                     .stowage = STOW_ANY, .un_number = "1203", .ems = "F-E" };
-    strcpy(cargo[1].id, "DG_FUEL");
+    cargo[1].label = make_label("DG_FUEL", "hazardous");
+    cargo[1].flags = CARGO_HAZARDOUS;
     cargo[1].weight = 200000.0f;
     cargo[1].dimensions[0] = 3.0f; cargo[1].dimensions[1] = 2.0f; cargo[1].dimensions[2] = 1.5f;
-    cargo[1].pos_x = 20.0f; cargo[1].pos_y = 5.0f; cargo[1].pos_z = 0.0f;
-    strcpy(cargo[1].type, "hazardous");
+    CARGO_PLACE(&cargo[1], 20.0f, 5.0f, 0.0f);
     cargo[1].dg = (struct DGInfo_ *)&dg1;
 
     static DGInfo dg2 = { .dg_class = 8, .dg_division = 0,
                     .stowage = STOW_ANY, .un_number = "1830", .ems = "F-A" };
-    strcpy(cargo[2].id, "DG_ACID");
+    cargo[2].label = make_label("DG_ACID", "hazardous");
+    cargo[2].flags = CARGO_HAZARDOUS;
     cargo[2].weight = 150000.0f;
     cargo[2].dimensions[0] = 3.0f; cargo[2].dimensions[1] = 2.0f; cargo[2].dimensions[2] = 1.5f;
-    cargo[2].pos_x = 22.0f; cargo[2].pos_y = 5.0f; cargo[2].pos_z = 0.0f;
-    strcpy(cargo[2].type, "hazardous");
+    CARGO_PLACE(&cargo[2], 22.0f, 5.0f, 0.0f);
     cargo[2].dg = (struct DGInfo_ *)&dg2;
 
     IMDGCheckResult result = imdg_check_all(&ship);
@@ -572,6 +578,7 @@ static void test_imdg(void) {
 
     printf("  INFO  Violations: %d, Compliant: %s\n",
            result.violation_count, result.compliant ? "YES" : "NO");
+    imdg_result_free(&result);
 
     cargo[1].dg = NULL;
     cargo[2].dg = NULL;